@@ -20,6 +20,7 @@
 
 #include <android/binder_ibinder_platform.h>
 #include <log/log.h>
+#include <stdio.h>
 
 #include "aidl_camera_device_session.h"
 #include "aidl_profiler.h"
@@ -105,9 +106,12 @@ ScopedAStatus AidlCameraDevice::getCameraCharacteristics(
         static_cast<int32_t>(Status::ILLEGAL_ARGUMENT));
   }
   characteristics_ret->metadata.clear();
-  std::unique_ptr<HalCameraMetadata> characteristics;
-  status_t res =
-      google_camera_device_->GetCameraCharacteristics(&characteristics);
+  status_t res = characteristics_cache_.GetCharacteristics(
+      [this](std::unique_ptr<HalCameraMetadata>* characteristics) {
+        return google_camera_device_->GetCameraCharacteristics(
+            characteristics);
+      },
+      &characteristics_ret->metadata);
   if (res != OK) {
     ALOGE("%s: Getting camera characteristics for camera %u failed: %s(%d)",
           __FUNCTION__, camera_id_, strerror(-res), res);
@@ -115,17 +119,6 @@ ScopedAStatus AidlCameraDevice::getCameraCharacteristics(
         static_cast<int32_t>(Status::INTERNAL_ERROR));
   }
 
-  if (characteristics == nullptr) {
-    ALOGE("%s: Camera characteristics for camera %u is nullptr.", __FUNCTION__,
-          camera_id_);
-    return ScopedAStatus::fromServiceSpecificError(
-        static_cast<int32_t>(Status::INTERNAL_ERROR));
-  }
-
-  uint32_t metadata_size = characteristics->GetCameraMetadataSize();
-  uint8_t* chars_p = (uint8_t*)characteristics->GetRawCameraMetadata();
-  characteristics_ret->metadata.assign(chars_p, chars_p + metadata_size);
-
   return ScopedAStatus::ok();
 }
 
@@ -211,6 +204,11 @@ ScopedAStatus AidlCameraDevice::isStreamCombinationWithSettingsSupported(
 ScopedAStatus AidlCameraDevice::getSessionCharacteristics(
     const StreamConfiguration& session_config,
     CameraMetadata* characteristics_ret) {
+  if (characteristics_ret == nullptr) {
+    return ScopedAStatus::fromServiceSpecificError(
+        static_cast<int32_t>(Status::ILLEGAL_ARGUMENT));
+  }
+  characteristics_ret->metadata.clear();
   google_camera_hal::StreamConfiguration stream_config;
   status_t res =
       aidl_utils::ConvertToHalStreamConfig(session_config, &stream_config);
@@ -220,14 +218,14 @@ ScopedAStatus AidlCameraDevice::getSessionCharacteristics(
         static_cast<int32_t>(Status::INTERNAL_ERROR));
   }
 
-  if (characteristics_ret == nullptr) {
-    return ScopedAStatus::fromServiceSpecificError(
-        static_cast<int32_t>(Status::ILLEGAL_ARGUMENT));
-  }
-  characteristics_ret->metadata.clear();
-  std::unique_ptr<HalCameraMetadata> session_characteristics;
-  res = google_camera_device_->GetSessionCharacteristics(
-      stream_config, session_characteristics);
+  res = characteristics_cache_.GetSessionCharacteristics(
+      stream_config,
+      [this, &stream_config](
+          std::unique_ptr<HalCameraMetadata>* session_characteristics) {
+        return google_camera_device_->GetSessionCharacteristics(
+            stream_config, *session_characteristics);
+      },
+      &characteristics_ret->metadata);
   if (res != OK) {
     ALOGE("%s: Getting session characteristics for camera %u failed: %s(%d)",
           __FUNCTION__, camera_id_, strerror(-res), res);
@@ -235,17 +233,6 @@ ScopedAStatus AidlCameraDevice::getSessionCharacteristics(
         static_cast<int32_t>(Status::INTERNAL_ERROR));
   }
 
-  if (session_characteristics == nullptr) {
-    ALOGE("%s: Session characteristics for camera %u is nullptr.", __FUNCTION__,
-          camera_id_);
-    return ScopedAStatus::fromServiceSpecificError(
-        static_cast<int32_t>(Status::INTERNAL_ERROR));
-  }
-
-  uint32_t metadata_size = session_characteristics->GetCameraMetadataSize();
-  uint8_t* chars_p = (uint8_t*)session_characteristics->GetRawCameraMetadata();
-  characteristics_ret->metadata.assign(chars_p, chars_p + metadata_size);
-
   return ScopedAStatus::ok();
 }
 
@@ -256,31 +243,28 @@ ScopedAStatus AidlCameraDevice::getPhysicalCameraCharacteristics(
         static_cast<int32_t>(Status::ILLEGAL_ARGUMENT));
   }
   characteristics_ret->metadata.clear();
-  std::unique_ptr<HalCameraMetadata> physical_characteristics;
   uint32_t physical_camera_id = atoi(physicalCameraId.c_str());
-  status_t res = google_camera_device_->GetPhysicalCameraCharacteristics(
-      physical_camera_id, &physical_characteristics);
+  status_t res = characteristics_cache_.GetPhysicalCharacteristics(
+      physical_camera_id,
+      [this, physical_camera_id](
+          std::unique_ptr<HalCameraMetadata>* physical_characteristics) {
+        return google_camera_device_->GetPhysicalCameraCharacteristics(
+            physical_camera_id, physical_characteristics);
+      },
+      &characteristics_ret->metadata);
   if (res != OK) {
     ALOGE("%s: Getting physical characteristics for camera %u failed: %s(%d)",
           __FUNCTION__, camera_id_, strerror(-res), res);
     return aidl_utils::ConvertToAidlReturn(res);
   }
 
-  if (physical_characteristics == nullptr) {
-    ALOGE("%s: Physical characteristics for camera %u is nullptr.",
-          __FUNCTION__, physical_camera_id);
-    return ScopedAStatus::fromServiceSpecificError(
-        static_cast<int32_t>(Status::INTERNAL_ERROR));
-  }
-
-  uint32_t metadata_size = physical_characteristics->GetCameraMetadataSize();
-  uint8_t* physical_characteristics_p =
-      (uint8_t*)physical_characteristics->GetRawCameraMetadata();
-  characteristics_ret->metadata.assign(
-      physical_characteristics_p, physical_characteristics_p + metadata_size);
   return ScopedAStatus::ok();
 }
 
+void AidlCameraDevice::InvalidateCharacteristicsCache() {
+  characteristics_cache_.Invalidate();
+}
+
 ScopedAStatus AidlCameraDevice::open(
     const std::shared_ptr<ICameraDeviceCallback>& callback,
     std::shared_ptr<ICameraDeviceSession>* session_ret) {
@@ -329,6 +313,9 @@ ScopedAStatus AidlCameraDevice::openInjectionSession(
 binder_status_t AidlCameraDevice::dump(int fd, const char** /*args*/,
                                        uint32_t /*numArgs*/) {
   google_camera_device_->DumpState(fd);
+
+  dprintf(fd, "Characteristics cache of camera %u:\n", camera_id_);
+  characteristics_cache_.Dump(fd);
   return OK;
 }
 
@@ -20,8 +20,11 @@
 #include <aidl/android/hardware/camera/device/BnCameraDevice.h>
 #include <aidl/android/hardware/camera/device/ICameraDeviceCallback.h>
 
+#include <string>
+
 #include "aidl_profiler.h"
 #include "camera_device.h"
+#include "characteristics_cache.h"
 
 namespace android {
 namespace hardware {
@@ -46,6 +49,10 @@ using ::android::google_camera_hal::CameraDevice;
 // AidlCameraDevice implements the AIDL camera device interface, ICameraDevice,
 // using Google Camera HAL to provide information about the associated camera
 // device.
+//
+// Camera, physical camera and session characteristics are kept in a
+// CharacteristicsCache, which is cleared with InvalidateCharacteristicsCache()
+// when the device state changes.
 class AidlCameraDevice : public BnCameraDevice {
  public:
   static const std::string kDeviceVersion;
@@ -99,6 +106,9 @@ class AidlCameraDevice : public BnCameraDevice {
   // End of override functions in ICameraDevice
   AidlCameraDevice() = default;
 
+  // Drop the cached characteristics, which may change with the device state.
+  void InvalidateCharacteristicsCache();
+
  protected:
   ::ndk::SpAIBinder createBinder() override;
 
@@ -112,6 +122,8 @@ class AidlCameraDevice : public BnCameraDevice {
   ScopedAStatus isStreamCombinationSupportedInternal(
       const StreamConfiguration& streamConfiguration, bool* supported,
       bool checkSettings);
+
+  google_camera_hal::CharacteristicsCache characteristics_cache_;
 };
 
 }  // namespace implementation
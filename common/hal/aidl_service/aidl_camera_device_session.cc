@@ -107,8 +107,7 @@ void AidlCameraDeviceSession::ProcessCaptureResult(
   TryLogFirstFrameDone(*hal_result, __FUNCTION__);
 
   for (auto& buffer : hal_result->output_buffers) {
-    aidl_profiler_->ProfileFrameRate("Stream " +
-                                     std::to_string(buffer.stream_id));
+    aidl_profiler_->ProfileFrameRate(buffer.stream_id);
   }
   if (ATRACE_ENABLED()) {
     bool dump_preview_stream_time = false;
@@ -175,8 +174,7 @@ void AidlCameraDeviceSession::ProcessBatchCaptureResult(
     TryLogFirstFrameDone(*hal_result, __FUNCTION__);
 
     for (auto& buffer : hal_result->output_buffers) {
-      aidl_profiler_->ProfileFrameRate("Stream " +
-                                       std::to_string(buffer.stream_id));
+      aidl_profiler_->ProfileFrameRate(buffer.stream_id);
     }
 
     status_t res = aidl_utils::ConvertToAidlCaptureResult(
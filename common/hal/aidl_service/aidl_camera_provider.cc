@@ -20,6 +20,7 @@
 
 #include <log/log.h>
 
+#include <algorithm>
 #include <regex>
 
 #include "aidl_camera_device.h"
@@ -377,13 +378,25 @@ ScopedAStatus AidlCameraProvider::getCameraDeviceInterface(
     return aidl_utils::ConvertToAidlReturn(res);
   }
 
-  *device = device::implementation::AidlCameraDevice::Create(
+  auto aidl_device = device::implementation::AidlCameraDevice::Create(
       std::move(google_camera_device));
-  if (*device == nullptr) {
+  if (aidl_device == nullptr) {
     ALOGE("%s: Creating AidlCameraDevice failed", __FUNCTION__);
     return ScopedAStatus::fromServiceSpecificError(
         static_cast<int32_t>(Status::INTERNAL_ERROR));
   }
+
+  {
+    std::lock_guard<std::mutex> lock(devices_lock_);
+    devices_.erase(std::remove_if(devices_.begin(), devices_.end(),
+                                  [](const auto& weak_device) {
+                                    return weak_device.expired();
+                                  }),
+                   devices_.end());
+    devices_.push_back(aidl_device);
+  }
+
+  *device = aidl_device;
   return ScopedAStatus::ok();
 }
 
@@ -393,6 +406,15 @@ ScopedAStatus AidlCameraProvider::notifyDeviceStateChange(int64_t new_state) {
   ::android::hardware::camera::implementation::aidl_utils::ConvertToHalDeviceState(
       new_state, device_state);
   google_camera_provider_->NotifyDeviceStateChange(device_state);
+
+  // Characteristics may change with the device state.
+  std::lock_guard<std::mutex> lock(devices_lock_);
+  for (auto& weak_device : devices_) {
+    auto device = weak_device.lock();
+    if (device != nullptr) {
+      device->InvalidateCharacteristicsCache();
+    }
+  }
   return ScopedAStatus::ok();
 }
 
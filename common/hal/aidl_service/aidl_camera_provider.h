@@ -21,7 +21,9 @@
 #include <aidl/android/hardware/camera/provider/ICameraProviderCallback.h>
 
 #include <regex>
+#include <vector>
 
+#include "aidl_camera_device.h"
 #include "camera_provider.h"
 
 namespace android {
@@ -88,6 +90,14 @@ class AidlCameraProvider : public BnCameraProvider {
 
   std::unique_ptr<CameraProvider> google_camera_provider_;
   google_camera_hal::CameraProviderCallback camera_provider_callback_;
+
+  std::mutex devices_lock_;
+
+  // Devices created by getCameraDeviceInterface(), whose cached
+  // characteristics are invalidated when the device state changes.
+  // Protected by devices_lock_.
+  std::vector<std::weak_ptr<device::implementation::AidlCameraDevice>>
+      devices_;
 };
 
 }  // namespace implementation
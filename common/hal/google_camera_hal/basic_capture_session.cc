@@ -292,7 +292,15 @@ status_t BasicCaptureSession::Initialize(
 status_t BasicCaptureSession::ProcessRequest(const CaptureRequest& request) {
   ATRACE_CALL();
   result_dispatcher_->AddPendingRequest(request);
-  return request_processor_->ProcessRequest(request);
+  status_t res = request_processor_->ProcessRequest(request);
+  if (res != OK) {
+    // The request won't get any results. Don't hold back the results of the
+    // following requests for it.
+    ALOGE("%s: ProcessRequest (%u) failed and remove pending request",
+          __FUNCTION__, request.frame_number);
+    result_dispatcher_->RemovePendingRequest(request.frame_number);
+  }
+  return res;
 }
 
 status_t BasicCaptureSession::Flush() {
@@ -32,6 +32,8 @@
 
 #include "hwl_types.h"
 #include "log/log_main.h"
+#include "memory_tracker.h"
+#include "thread_role_manager.h"
 #include "utils.h"
 #include "vendor_tags.h"
 
@@ -399,7 +401,30 @@ status_t CameraDevice::ConstructDefaultRequestSettings(
 
 status_t CameraDevice::DumpState(int fd) {
   ATRACE_CALL();
-  return camera_device_hwl_->DumpState(fd);
+  status_t res = camera_device_hwl_->DumpState(fd);
+  if (res != OK) {
+    return res;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(session_watchdogs_lock_);
+    for (auto it = session_watchdogs_.begin();
+         it != session_watchdogs_.end();) {
+      std::shared_ptr<RequestWatchdog> watchdog = it->second.lock();
+      if (watchdog == nullptr) {
+        it = session_watchdogs_.erase(it);
+        continue;
+      }
+      dprintf(fd, "Requests of camera %u session %u:\n", public_camera_id_,
+              it->first);
+      dprintf(fd, "%s", watchdog->DumpStats("  ").c_str());
+      it++;
+    }
+  }
+
+  ThreadRoleManager::GetInstance().Dump(fd);
+  MemoryTracker::GetInstance().Dump(fd);
+  return OK;
 }
 
 status_t CameraDevice::CreateCameraDeviceSession(
@@ -428,6 +453,16 @@ status_t CameraDevice::CreateCameraDeviceSession(
     return UNKNOWN_ERROR;
   }
 
+  {
+    std::lock_guard<std::mutex> lock(session_watchdogs_lock_);
+    // Forget the sessions that were closed.
+    for (auto it = session_watchdogs_.begin();
+         it != session_watchdogs_.end();) {
+      it = it->second.expired() ? session_watchdogs_.erase(it) : std::next(it);
+    }
+    session_watchdogs_[session_count_++] = (*session)->GetRequestWatchdog();
+  }
+
   std::lock_guard<std::mutex> lock(applied_memory_config_mutex_);
   HwlMemoryConfig memory_config = camera_device_hwl_->GetMemoryConfig();
   std::thread t(LoadLibraries, memory_config, GetAppliedMemoryConfig());
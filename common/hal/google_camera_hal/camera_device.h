@@ -18,6 +18,8 @@
 #define HARDWARE_GOOGLE_CAMERA_HAL_GOOGLE_CAMERA_HAL_CAMERA_DEVICE_H_
 
 #include <map>
+#include <memory>
+#include <mutex>
 
 #include "camera_buffer_allocator_hwl.h"
 #include "camera_device_hwl.h"
@@ -25,6 +27,7 @@
 #include "hal_camera_metadata.h"
 #include "hwl_types.h"
 #include "profiler.h"
+#include "request_watchdog.h"
 
 namespace android {
 namespace google_camera_hal {
@@ -154,6 +157,12 @@ class CameraDevice {
   std::vector<void*> external_capture_session_lib_handles_;
   // Stream use cases supported by this camera device
   std::map<uint32_t, std::set<int64_t>> camera_id_to_stream_use_cases_;
+
+  std::mutex session_watchdogs_lock_;
+  // Request watchdogs of the open sessions, by the number of the session
+  // since the device was created. Protected by session_watchdogs_lock_.
+  std::map<uint32_t, std::weak_ptr<RequestWatchdog>> session_watchdogs_;
+  uint32_t session_count_ = 0;  // Protected by session_watchdogs_lock_.
 };
 
 }  // namespace google_camera_hal
@@ -25,10 +25,12 @@
 #include <utils/Trace.h>
 
 #include "basic_capture_session.h"
+#include "caching_buffer_allocator.h"
 #include "capture_session_utils.h"
 #include "hal_types.h"
 #include "hal_utils.h"
 #include "system/camera_metadata.h"
+#include "thermal_mailbox.h"
 #include "ui/GraphicBufferMapper.h"
 #include "vendor_tag_defs.h"
 #include "vendor_tag_types.h"
@@ -369,6 +371,44 @@ status_t CameraDeviceSession::InitializeBufferManagement(
   return OK;
 }
 
+status_t CameraDeviceSession::InitializeRequestWatchdog(
+    HalCameraMetadata* characteristics) {
+  ATRACE_CALL();
+
+  if (characteristics == nullptr) {
+    ALOGE("%s: characteristics cannot be nullptr.", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  RequestWatchdog::Config config;
+  camera_metadata_ro_entry entry = {};
+  if (characteristics->Get(ANDROID_REQUEST_PARTIAL_RESULT_COUNT, &entry) ==
+          OK &&
+      entry.count == 1 && entry.data.i32[0] > 0) {
+    config.partial_result_count = entry.data.i32[0];
+  }
+  // The shutter is due once the request went through the pipeline, and the
+  // results one frame later.
+  if (characteristics->Get(ANDROID_REQUEST_PIPELINE_MAX_DEPTH, &entry) == OK &&
+      entry.count == 1 && entry.data.u8[0] > 0) {
+    config.shutter_slo_frames = entry.data.u8[0];
+    config.result_slo_frames = entry.data.u8[0] + 1;
+  }
+
+  uint32_t camera_id = camera_id_;
+  request_watchdog_ = RequestWatchdog::Create(
+      config, [camera_id](uint32_t frame_number, const std::string& dump) {
+        ALOGE("%s: Camera %u request %u stalled. %s", __FUNCTION__, camera_id,
+              frame_number, dump.c_str());
+      });
+  if (request_watchdog_ == nullptr) {
+    ALOGE("%s: Creating request watchdog failed.", __FUNCTION__);
+    return NO_INIT;
+  }
+
+  return OK;
+}
+
 status_t CameraDeviceSession::Initialize(
     std::unique_ptr<CameraDeviceSessionHwl> device_session_hwl,
     CameraBufferAllocatorHwl* camera_allocator_hwl,
@@ -384,9 +424,20 @@ status_t CameraDeviceSession::Initialize(
         measure_buffer_allocation_time_);
 
   camera_id_ = device_session_hwl->GetCameraId();
+  memory_session_ = MemoryTracker::GetInstance().AddSession(
+      "camera " + std::to_string(camera_id_));
+  ScopedMemorySession memory_session(memory_session_);
+  CachingBufferAllocator::AddSharedGrallocAllocatorUser();
+  shared_buffer_cache_user_ = true;
   device_session_hwl_ = std::move(device_session_hwl);
   camera_allocator_hwl_ = camera_allocator_hwl;
 
+  thermal_mailbox_ = ThermalMailbox::Create();
+  if (thermal_mailbox_ == nullptr) {
+    ALOGE("%s: Creating thermal mailbox failed.", __FUNCTION__);
+    return NO_INIT;
+  }
+
   GraphicBufferMapper::preloadHal();
   InitializeCallbacks();
 
@@ -398,6 +449,13 @@ status_t CameraDeviceSession::Initialize(
     return res;
   }
 
+  res = InitializeRequestWatchdog(characteristics.get());
+  if (res != OK) {
+    ALOGE("%s: Initializing request watchdog failed: %s(%d)", __FUNCTION__,
+          strerror(-res), res);
+    return res;
+  }
+
   res = utils::GetStreamUseCases(
       characteristics.get(),
       &camera_id_to_stream_use_cases_[device_session_hwl_->GetCameraId()]);
@@ -570,6 +628,7 @@ CameraDeviceSession::~CameraDeviceSession() {
 
   capture_session_ = nullptr;
   device_session_hwl_ = nullptr;
+  request_watchdog_ = nullptr;
 
   for (auto external_session : external_capture_session_entries_) {
     delete external_session;
@@ -577,6 +636,14 @@ CameraDeviceSession::~CameraDeviceSession() {
   external_capture_session_entries_.clear();
 
   FreeImportedBufferHandles();
+
+  if (shared_buffer_cache_user_) {
+    CachingBufferAllocator::RemoveSharedGrallocAllocatorUser();
+  }
+
+  // The ended session stays in the dump for a while, so memory it still holds
+  // once the members are destroyed shows up as a leak.
+  MemoryTracker::GetInstance().EndSession(memory_session_);
 }
 
 void CameraDeviceSession::UnregisterThermalCallback() {
@@ -594,6 +661,41 @@ void CameraDeviceSession::SetSessionCallback(
   session_callback_ = session_callback;
   thermal_callback_ = thermal_callback;
 
+  // Let the request watchdog see all results and messages sent to the client,
+  // including the errors raised by the session itself.
+  if (session_callback.process_capture_result != nullptr) {
+    session_callback_.process_capture_result = ProcessCaptureResultFunc(
+        [this,
+         process_capture_result = session_callback.process_capture_result](
+            std::unique_ptr<CaptureResult> result) {
+          if (result != nullptr) {
+            request_watchdog_->OnResult(*result);
+          }
+          process_capture_result(std::move(result));
+        });
+  }
+  if (session_callback.process_batch_capture_result != nullptr) {
+    session_callback_.process_batch_capture_result =
+        ProcessBatchCaptureResultFunc(
+            [this, process_batch_capture_result =
+                       session_callback.process_batch_capture_result](
+                std::vector<std::unique_ptr<CaptureResult>> results) {
+              for (auto& result : results) {
+                if (result != nullptr) {
+                  request_watchdog_->OnResult(*result);
+                }
+              }
+              process_batch_capture_result(std::move(results));
+            });
+  }
+  if (session_callback.notify != nullptr) {
+    session_callback_.notify = NotifyFunc(
+        [this, notify = session_callback.notify](const NotifyMessage& message) {
+          request_watchdog_->OnNotify(message);
+          notify(message);
+        });
+  }
+
   status_t res = thermal_callback_.register_thermal_changed_callback(
       NotifyThrottlingFunc([this](const Temperature& temperature) {
         NotifyThrottling(temperature);
@@ -607,28 +709,26 @@ void CameraDeviceSession::SetSessionCallback(
 }
 
 void CameraDeviceSession::NotifyThrottling(const Temperature& temperature) {
-  switch (temperature.throttling_status) {
-    case ThrottlingSeverity::kNone:
-    case ThrottlingSeverity::kLight:
-    case ThrottlingSeverity::kModerate:
-      ALOGI("%s: temperature type: %d, severity: %u, value: %f", __FUNCTION__,
-            temperature.type, temperature.throttling_status, temperature.value);
-      return;
-    case ThrottlingSeverity::kSevere:
-    case ThrottlingSeverity::kCritical:
-    case ThrottlingSeverity::kEmergency:
-    case ThrottlingSeverity::kShutdown:
-      ALOGW("%s: temperature type: %d, severity: %u, value: %f", __FUNCTION__,
-            temperature.type, temperature.throttling_status, temperature.value);
-      {
-        std::lock_guard<std::mutex> lock(session_lock_);
-        thermal_throttling_ = true;
-      }
-      return;
-    default:
-      ALOGE("%s: Unknown throttling status %u for type %d", __FUNCTION__,
-            temperature.throttling_status, temperature.type);
-      return;
+  if (temperature.throttling_status < ThrottlingSeverity::kNone ||
+      temperature.throttling_status > ThrottlingSeverity::kShutdown) {
+    ALOGE("%s: Unknown throttling status %u for type %d", __FUNCTION__,
+          temperature.throttling_status, temperature.type);
+    return;
+  }
+
+  // Thermal storms can deliver many notifications per frame. Post them to the
+  // mailbox without taking session_lock_ and only log severity changes.
+  ThrottlingSeverity previous_severity = thermal_mailbox_->Post(temperature);
+  if (previous_severity == temperature.throttling_status) {
+    return;
+  }
+
+  if (temperature.throttling_status >= ThrottlingSeverity::kSevere) {
+    ALOGW("%s: temperature type: %d, severity: %u, value: %f", __FUNCTION__,
+          temperature.type, temperature.throttling_status, temperature.value);
+  } else {
+    ALOGI("%s: temperature type: %d, severity: %u, value: %f", __FUNCTION__,
+          temperature.type, temperature.throttling_status, temperature.value);
   }
 }
 
@@ -651,6 +751,7 @@ status_t CameraDeviceSession::ConfigureStreams(
     const StreamConfiguration& stream_config, bool v2,
     ConfigureStreamsReturn* configured_streams) {
   ATRACE_CALL();
+  ScopedMemorySession memory_session(memory_session_);
   bool set_realtime_thread = false;
   int32_t schedule_policy;
   struct sched_param schedule_param = {0};
@@ -794,6 +895,7 @@ status_t CameraDeviceSession::ConfigureStreams(
 
   // Derives all stream ids within a group to a representative stream id
   DeriveGroupedStreamIdMap();
+  request_watchdog_->Reset(grouped_stream_id_map_);
 
   // If buffer management is support, create a pending request tracker for
   // capture request throttling.
@@ -817,6 +919,7 @@ status_t CameraDeviceSession::ConfigureStreams(
   }
 
   has_valid_settings_ = false;
+  thermal_mailbox_->ResetThrottling();
   thermal_throttling_ = false;
   thermal_throttling_notified_ = false;
   last_request_settings_ = nullptr;
@@ -895,6 +998,7 @@ status_t CameraDeviceSession::CreateCaptureRequestLocked(
 
   // Returns -1 if kThermalThrottling is not defined, skip following process.
   if (get_camera_metadata_tag_type(VendorTagIds::kThermalThrottling) != -1) {
+    thermal_throttling_ = thermal_mailbox_->IsThrottling();
     // Create settings to set thermal throttling key if needed.
     if (thermal_throttling_ && !thermal_throttling_notified_ &&
         updated_request->settings == nullptr) {
@@ -1317,6 +1421,7 @@ status_t CameraDeviceSession::ProcessCaptureRequest(
     const std::vector<CaptureRequest>& requests,
     uint32_t* num_processed_requests) {
   ATRACE_CALL();
+  ScopedMemorySession memory_session(memory_session_);
   std::lock_guard<std::mutex> lock(session_lock_);
   if (num_processed_requests == nullptr) {
     return BAD_VALUE;
@@ -1415,10 +1520,25 @@ status_t CameraDeviceSession::ProcessCaptureRequest(
           return NO_INIT;
         }
 
+        // Results may arrive before ProcessRequest() returns.
+        request_watchdog_->OnRequestSubmitted(updated_request);
         res = capture_session_->ProcessRequest(updated_request);
         if (res != OK) {
           ALOGE("%s: Submitting request to HWL session failed: %s (%d)",
                 __FUNCTION__, strerror(-res), res);
+          request_watchdog_->OnRequestDropped(updated_request.frame_number);
+          // Release what was tracked for the request, which won't return
+          // any buffers.
+          std::vector<StreamBuffer> buffers = updated_request.output_buffers;
+          {
+            std::lock_guard<std::mutex> request_lock(request_record_lock_);
+            pending_request_streams_.erase(updated_request.frame_number);
+            pending_results_.erase(updated_request.frame_number);
+          }
+          if (pending_requests_tracker_->TrackReturnedResultBuffers(buffers) !=
+              OK) {
+            ALOGE("%s: Tracking requested quota buffers failed", __FUNCTION__);
+          }
           return res;
         }
       }
@@ -1949,6 +2069,14 @@ CameraDeviceSession::GetProfiler(uint32_t camera_id, int option) {
   return device_session_hwl_->GetProfiler(camera_id, option);
 }
 
+RequestWatchdog::Stats CameraDeviceSession::GetRequestWatchdogStats() {
+  return request_watchdog_->GetStats();
+}
+
+std::shared_ptr<RequestWatchdog> CameraDeviceSession::GetRequestWatchdog() {
+  return request_watchdog_;
+}
+
 bool CameraDeviceSession::TryHandleCaptureResult(
     std::unique_ptr<CaptureResult>& result) {
   if (result == nullptr) {
@@ -30,8 +30,11 @@
 #include "hal_camera_metadata.h"
 #include "hal_types.h"
 #include "hwl_types.h"
+#include "memory_tracker.h"
 #include "pending_requests_tracker.h"
+#include "request_watchdog.h"
 #include "stream_buffer_cache_manager.h"
+#include "thermal_mailbox.h"
 #include "thermal_types.h"
 #include "zoom_ratio_mapper.h"
 
@@ -133,6 +136,12 @@ class CameraDeviceSession {
   std::unique_ptr<google::camera_common::Profiler> GetProfiler(uint32_t camere_id,
                                                                int option);
 
+  // Get the latency and stall statistics of the capture requests.
+  RequestWatchdog::Stats GetRequestWatchdogStats();
+
+  // Get the watchdog of the capture requests, which may outlive the session.
+  std::shared_ptr<RequestWatchdog> GetRequestWatchdog();
+
  protected:
   CameraDeviceSession() = default;
 
@@ -158,6 +167,9 @@ class CameraDeviceSession {
   // Initialize buffer management support.
   status_t InitializeBufferManagement(HalCameraMetadata* characteristics);
 
+  // Create the watchdog of the capture requests.
+  status_t InitializeRequestWatchdog(HalCameraMetadata* characteristics);
+
   // Update all buffer handles in buffers with the imported buffer handles.
   // Must be protected by imported_buffer_handle_map_lock_.
   status_t UpdateBufferHandlesLocked(
@@ -275,7 +287,7 @@ class CameraDeviceSession {
   // session_lock_.
   status_t ValidateRequestLocked(const CaptureRequest& request);
 
-  // Invoked when thermal status changes.
+  // Invoked when thermal status changes. Does not take session_lock_.
   void NotifyThrottling(const Temperature& temperature);
 
   // Unregister thermal callback.
@@ -303,6 +315,14 @@ class CameraDeviceSession {
   uint32_t camera_id_ = 0;
   std::unique_ptr<CameraDeviceSessionHwl> device_session_hwl_;
 
+  // Session in MemoryTracker the allocations of this session are attributed
+  // to.
+  uint32_t memory_session_ = MemoryTracker::kNoSession;
+
+  // Whether this session is registered as a user of the shared gralloc
+  // CachingBufferAllocator.
+  bool shared_buffer_cache_user_ = false;
+
   // Assuming callbacks to framework is thread-safe, the shared mutex is only
   // used to protect member variable writing and reading.
   std::shared_mutex session_callback_lock_;
@@ -349,8 +369,17 @@ class CameraDeviceSession {
   // Last valid settings in capture request. Must be protected by session_lock_.
   std::unique_ptr<HalCameraMetadata> last_request_settings_;
 
+  // Latest thermal status posted by the thermal callback. Thread-safe.
+  std::unique_ptr<ThermalMailbox> thermal_mailbox_;
+
+  // Measures the capture requests against their latency SLOs and reports
+  // stalled requests. Fed with the requests sent to the capture session and
+  // the results and messages sent to the client. Shared with the camera
+  // device, which dumps it. Thread-safe.
+  std::shared_ptr<RequestWatchdog> request_watchdog_;
+
   // If thermal status has become >= ThrottlingSeverity::Severe since stream
-  // configuration.
+  // configuration, sampled from thermal_mailbox_ for each request.
   // Must be protected by session_lock_.
   uint8_t thermal_throttling_ = false;
 
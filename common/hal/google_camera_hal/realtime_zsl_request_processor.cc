@@ -126,13 +126,15 @@ std::unique_ptr<RealtimeZslRequestProcessor> RealtimeZslRequestProcessor::Create
     ALOGE("%s: device_session_hwl is nullptr", __FUNCTION__);
     return nullptr;
   }
-  if (pixel_format != android_pixel_format_t::HAL_PIXEL_FORMAT_YCBCR_420_888) {
-    ALOGE("%s: only YCBCR_420_888 is supported for YUV ZSL", __FUNCTION__);
+  if (pixel_format != android_pixel_format_t::HAL_PIXEL_FORMAT_YCBCR_420_888 &&
+      pixel_format != android_pixel_format_t::HAL_PIXEL_FORMAT_RAW16) {
+    ALOGE("%s: only YCBCR_420_888 and RAW16 are supported for ZSL",
+          __FUNCTION__);
     return nullptr;
   }
 
   auto request_processor = std::unique_ptr<RealtimeZslRequestProcessor>(
-      new RealtimeZslRequestProcessor(device_session_hwl));
+      new RealtimeZslRequestProcessor(device_session_hwl, pixel_format));
   if (request_processor == nullptr) {
     ALOGE("%s: Creating RealtimeZslRequestProcessor failed.", __FUNCTION__);
     return nullptr;
@@ -189,21 +191,37 @@ status_t RealtimeZslRequestProcessor::ConfigureStreams(
     return BAD_VALUE;
   }
 
-  // For YUV ZSL, we will use the JPEG size for ZSL buffer size. We already
-  // checked the size is supported in capture session.
-  for (const auto& stream : stream_config.streams) {
-    if (utils::IsSoftwareDenoiseEligibleSnapshotStream(stream)) {
-      if (SelectWidthAndHeight(stream.width, stream.height,
-                               *device_session_hwl_, active_array_width_,
-                               active_array_height_) != OK) {
-        ALOGE("%s: failed to select ZSL YUV buffer width and height",
-              __FUNCTION__);
-        return BAD_VALUE;
+  // For RAW ZSL, we will use the largest RAW16 size. For YUV ZSL, we will use
+  // the JPEG size for ZSL buffer size. We already checked the size is
+  // supported in capture session.
+  if (pixel_format_ == HAL_PIXEL_FORMAT_RAW16) {
+    std::unique_ptr<HalCameraMetadata> characteristics;
+    status_t res =
+        device_session_hwl_->GetCameraCharacteristics(&characteristics);
+    if (res != OK || hal_utils::GetMaxOutputSize(
+                         characteristics.get(), HAL_PIXEL_FORMAT_RAW16,
+                         &active_array_width_, &active_array_height_) != OK) {
+      ALOGE("%s: failed to select ZSL RAW buffer width and height",
+            __FUNCTION__);
+      return BAD_VALUE;
+    }
+    ALOGI("%s, RAW ZSL size is (%d x %d)", __FUNCTION__, active_array_width_,
+          active_array_height_);
+  } else {
+    for (const auto& stream : stream_config.streams) {
+      if (utils::IsSoftwareDenoiseEligibleSnapshotStream(stream)) {
+        if (SelectWidthAndHeight(stream.width, stream.height,
+                                 *device_session_hwl_, active_array_width_,
+                                 active_array_height_) != OK) {
+          ALOGE("%s: failed to select ZSL YUV buffer width and height",
+                __FUNCTION__);
+          return BAD_VALUE;
+        }
+        ALOGI("%s, Snapshot size is (%d x %d), selected size is (%d x %d)",
+              __FUNCTION__, stream.width, stream.height, active_array_width_,
+              active_array_height_);
+        break;
       }
-      ALOGI("%s, Snapshot size is (%d x %d), selected size is (%d x %d)",
-            __FUNCTION__, stream.width, stream.height, active_array_width_,
-            active_array_height_);
-      break;
     }
   }
 
@@ -212,11 +230,11 @@ status_t RealtimeZslRequestProcessor::ConfigureStreams(
   stream_to_add.stream_type = StreamType::kOutput;
   stream_to_add.width = active_array_width_;
   stream_to_add.height = active_array_height_;
-  stream_to_add.format = HAL_PIXEL_FORMAT_YCBCR_420_888;
+  stream_to_add.format = pixel_format_;
   stream_to_add.usage = 0;
   stream_to_add.rotation = StreamRotation::kRotation0;
   stream_to_add.data_space = HAL_DATASPACE_ARBITRARY;
-  // For YUV ZSL buffer, if the stream configuration constains physical stream,
+  // For ZSL buffer, if the stream configuration constains physical stream,
   // we will add the new stream as physical stream. As we support physical
   // streams only or logical streams only combination. We can check the stream
   // type of the first stream in the list.
@@ -29,6 +29,8 @@ namespace google_camera_hal {
 
 // RealtimeZslRequestProcessor implements a RequestProcessor that adds
 // internal stream to request and forwards the request to its ProcessBlock.
+// The internal stream is a YCBCR_420_888 stream of the snapshot size, or a
+// RAW16 stream of the largest RAW size for RAW ZSL.
 class RealtimeZslRequestProcessor : public RequestProcessor {
  public:
   // device_session_hwl is owned by the caller and must be valid during the
@@ -61,8 +63,9 @@ class RealtimeZslRequestProcessor : public RequestProcessor {
   // Override functions of RequestProcessor end.
 
  protected:
-  RealtimeZslRequestProcessor(CameraDeviceSessionHwl* device_session_hwl)
-      : device_session_hwl_(device_session_hwl) {};
+  RealtimeZslRequestProcessor(CameraDeviceSessionHwl* device_session_hwl,
+                              android_pixel_format_t pixel_format)
+      : device_session_hwl_(device_session_hwl), pixel_format_(pixel_format) {};
 
  private:
   status_t Initialize(CameraDeviceSessionHwl* device_session_hwl);
@@ -73,6 +76,7 @@ class RealtimeZslRequestProcessor : public RequestProcessor {
 
   InternalStreamManager* internal_stream_manager_ = nullptr;
   CameraDeviceSessionHwl* device_session_hwl_ = nullptr;
+  const android_pixel_format_t pixel_format_;
   bool preview_intent_seen_ = false;
   int32_t stream_id_ = -1;
   uint32_t active_array_width_ = 0;
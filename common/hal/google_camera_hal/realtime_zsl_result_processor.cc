@@ -37,8 +37,10 @@ std::unique_ptr<RealtimeZslResultProcessor> RealtimeZslResultProcessor::Create(
     ALOGE("%s: internal_stream_manager is nullptr.", __FUNCTION__);
     return nullptr;
   }
-  if (pixel_format != android_pixel_format_t::HAL_PIXEL_FORMAT_YCBCR_420_888) {
-    ALOGE("%s: only YCBCR_420_888 is supported for YUV ZSL", __FUNCTION__);
+  if (pixel_format != android_pixel_format_t::HAL_PIXEL_FORMAT_YCBCR_420_888 &&
+      pixel_format != android_pixel_format_t::HAL_PIXEL_FORMAT_RAW16) {
+    ALOGE("%s: only YCBCR_420_888 and RAW16 are supported for ZSL",
+          __FUNCTION__);
     return nullptr;
   }
 
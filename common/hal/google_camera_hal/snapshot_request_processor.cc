@@ -18,9 +18,14 @@
 #include "system/graphics-base-v1.0.h"
 #define LOG_TAG "GCH_SnapshotRequestProcessor"
 #define ATRACE_TAG ATRACE_TAG_CAMERA
+#include <inttypes.h>
 #include <log/log.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <ctime>
+
+#include "hal_utils.h"
 #include "snapshot_request_processor.h"
 #include "vendor_tag_defs.h"
 
@@ -29,7 +34,8 @@ namespace google_camera_hal {
 
 std::unique_ptr<SnapshotRequestProcessor> SnapshotRequestProcessor::Create(
     CameraDeviceSessionHwl* device_session_hwl,
-    HwlSessionCallback session_callback, int32_t yuv_stream_id) {
+    HwlSessionCallback session_callback, int32_t zsl_stream_id,
+    uint32_t max_in_flight_snapshots, android_pixel_format_t zsl_format) {
   ATRACE_CALL();
   if (device_session_hwl == nullptr) {
     ALOGE("%s: device_session_hwl (%p) is nullptr", __FUNCTION__,
@@ -44,8 +50,8 @@ std::unique_ptr<SnapshotRequestProcessor> SnapshotRequestProcessor::Create(
     return nullptr;
   }
 
-  status_t res =
-      request_processor->Initialize(device_session_hwl, yuv_stream_id);
+  status_t res = request_processor->Initialize(
+      device_session_hwl, zsl_stream_id, max_in_flight_snapshots, zsl_format);
   if (res != OK) {
     ALOGE("%s: Initializing SnapshotRequestProcessor failed: %s (%d).",
           __FUNCTION__, strerror(-res), res);
@@ -56,8 +62,19 @@ std::unique_ptr<SnapshotRequestProcessor> SnapshotRequestProcessor::Create(
 }
 
 status_t SnapshotRequestProcessor::Initialize(
-    CameraDeviceSessionHwl* device_session_hwl, int32_t yuv_stream_id) {
+    CameraDeviceSessionHwl* device_session_hwl, int32_t zsl_stream_id,
+    uint32_t max_in_flight_snapshots, android_pixel_format_t zsl_format) {
   ATRACE_CALL();
+  if (max_in_flight_snapshots == 0) {
+    ALOGE("%s: max_in_flight_snapshots must be at least 1.", __FUNCTION__);
+    return BAD_VALUE;
+  }
+  if (zsl_format != HAL_PIXEL_FORMAT_YCBCR_420_888 &&
+      zsl_format != HAL_PIXEL_FORMAT_RAW16) {
+    ALOGE("%s: ZSL format 0x%x is not supported.", __FUNCTION__, zsl_format);
+    return BAD_VALUE;
+  }
+
   std::unique_ptr<HalCameraMetadata> characteristics;
   status_t res = device_session_hwl->GetCameraCharacteristics(&characteristics);
   if (res != OK) {
@@ -65,21 +82,37 @@ status_t SnapshotRequestProcessor::Initialize(
     return BAD_VALUE;
   }
 
-  camera_metadata_ro_entry entry;
-  res = characteristics->Get(
-      ANDROID_SENSOR_INFO_PRE_CORRECTION_ACTIVE_ARRAY_SIZE, &entry);
-  if (res == OK) {
-    active_array_width_ = entry.data.i32[2];
-    active_array_height_ = entry.data.i32[3];
-    ALOGI("%s Active size (%d x %d).", __FUNCTION__, active_array_width_,
-          active_array_height_);
+  // RAW ZSL buffers have the largest RAW16 size, as in
+  // RealtimeZslRequestProcessor.
+  if (zsl_format == HAL_PIXEL_FORMAT_RAW16) {
+    res = hal_utils::GetMaxOutputSize(characteristics.get(),
+                                      HAL_PIXEL_FORMAT_RAW16, &zsl_width_,
+                                      &zsl_height_);
+    if (res != OK) {
+      ALOGE("%s Get RAW size failed: %s (%d).", __FUNCTION__, strerror(-res),
+            res);
+      return res;
+    }
+    ALOGI("%s RAW ZSL size (%d x %d).", __FUNCTION__, zsl_width_, zsl_height_);
   } else {
-    ALOGE("%s Get active size failed: %s (%d).", __FUNCTION__, strerror(-res),
-          res);
-    return res;
+    camera_metadata_ro_entry entry;
+    res = characteristics->Get(
+        ANDROID_SENSOR_INFO_PRE_CORRECTION_ACTIVE_ARRAY_SIZE, &entry);
+    if (res == OK) {
+      zsl_width_ = entry.data.i32[2];
+      zsl_height_ = entry.data.i32[3];
+      ALOGI("%s Active size (%d x %d).", __FUNCTION__, zsl_width_,
+            zsl_height_);
+    } else {
+      ALOGE("%s Get active size failed: %s (%d).", __FUNCTION__,
+            strerror(-res), res);
+      return res;
+    }
   }
 
-  yuv_stream_id_ = yuv_stream_id;
+  zsl_stream_id_ = zsl_stream_id;
+  zsl_format_ = zsl_format;
+  max_in_flight_snapshots_ = max_in_flight_snapshots;
 
   return OK;
 }
@@ -100,20 +133,20 @@ status_t SnapshotRequestProcessor::ConfigureStreams(
 
   internal_stream_manager_ = internal_stream_manager;
 
-  Stream yuv_stream;
-  yuv_stream.stream_type = StreamType::kInput;
-  yuv_stream.width = active_array_width_;
-  yuv_stream.height = active_array_height_;
-  yuv_stream.format = HAL_PIXEL_FORMAT_YCBCR_420_888;
-  yuv_stream.usage = 0;
-  yuv_stream.rotation = StreamRotation::kRotation0;
-  yuv_stream.data_space = HAL_DATASPACE_ARBITRARY;
-  // Set id back to yuv_stream and then HWL can get correct HAL stream ID
-  yuv_stream.id = yuv_stream_id_;
+  Stream zsl_stream;
+  zsl_stream.stream_type = StreamType::kInput;
+  zsl_stream.width = zsl_width_;
+  zsl_stream.height = zsl_height_;
+  zsl_stream.format = zsl_format_;
+  zsl_stream.usage = 0;
+  zsl_stream.rotation = StreamRotation::kRotation0;
+  zsl_stream.data_space = HAL_DATASPACE_ARBITRARY;
+  // Set id back to zsl_stream and then HWL can get correct HAL stream ID
+  zsl_stream.id = zsl_stream_id_;
 
   process_block_stream_config->streams = stream_config.streams;
-  // Add internal yuv stream
-  process_block_stream_config->streams.push_back(yuv_stream);
+  // Add internal ZSL stream
+  process_block_stream_config->streams.push_back(zsl_stream);
   process_block_stream_config->operation_mode = stream_config.operation_mode;
   process_block_stream_config->session_params =
       HalCameraMetadata::Clone(stream_config.session_params.get());
@@ -124,6 +157,46 @@ status_t SnapshotRequestProcessor::ConfigureStreams(
   return OK;
 }
 
+SnapshotRequestProcessor::~SnapshotRequestProcessor() {
+  if (stats_.snapshots > 0) {
+    ALOGI("%s: %s ZSL: %" PRIu64 " snapshots, mean input age %" PRId64
+          " us, max %" PRId64 " us",
+          __FUNCTION__, zsl_format_ == HAL_PIXEL_FORMAT_RAW16 ? "RAW" : "YUV",
+          stats_.snapshots, stats_.total_zsl_age_ns / 1000 / stats_.snapshots,
+          stats_.max_zsl_age_ns / 1000);
+  }
+}
+
+void SnapshotRequestProcessor::UpdateZslAge(
+    const std::vector<std::unique_ptr<HalCameraMetadata>>& input_metadata) {
+  int64_t newest_timestamp = 0;
+  for (const auto& metadata : input_metadata) {
+    camera_metadata_ro_entry entry = {};
+    if (metadata != nullptr &&
+        metadata->Get(ANDROID_SENSOR_TIMESTAMP, &entry) == OK &&
+        entry.count == 1) {
+      newest_timestamp = std::max(newest_timestamp, entry.data.i64[0]);
+    }
+  }
+  // ZSL buffer timestamps are compared to BOOT_TIME, as in
+  // ZslBufferManager.
+  struct timespec ts;
+  if (newest_timestamp == 0 || clock_gettime(CLOCK_BOOTTIME, &ts) != 0) {
+    return;
+  }
+  int64_t age_ns = ts.tv_sec * 1000000000LL + ts.tv_nsec - newest_timestamp;
+
+  std::lock_guard<std::mutex> lock(stats_lock_);
+  stats_.snapshots++;
+  stats_.total_zsl_age_ns += age_ns;
+  stats_.max_zsl_age_ns = std::max(stats_.max_zsl_age_ns, age_ns);
+}
+
+SnapshotRequestProcessor::Stats SnapshotRequestProcessor::GetStats() {
+  std::lock_guard<std::mutex> lock(stats_lock_);
+  return stats_;
+}
+
 status_t SnapshotRequestProcessor::SetProcessBlock(
     std::unique_ptr<ProcessBlock> process_block) {
   ATRACE_CALL();
@@ -148,7 +221,11 @@ bool SnapshotRequestProcessor::IsReadyForNextRequest() {
     ALOGW("%s: internal_stream_manager_ nullptr", __FUNCTION__);
     return false;
   }
-  if (internal_stream_manager_->IsPendingBufferEmpty(yuv_stream_id_) == false) {
+  uint32_t in_flight_snapshots =
+      internal_stream_manager_->GetPendingRequestCount(zsl_stream_id_);
+  if (in_flight_snapshots >= max_in_flight_snapshots_) {
+    ALOGD("%s: All %u snapshot slots are busy.", __FUNCTION__,
+          max_in_flight_snapshots_);
     return false;
   }
   return true;
@@ -181,10 +258,22 @@ status_t SnapshotRequestProcessor::ProcessRequest(const CaptureRequest& request)
         HalCameraMetadata::Clone(physical_metadata.get());
   }
 
-  // Get multiple yuv buffer and metadata from internal stream as input
-  status_t result = internal_stream_manager_->GetMostRecentStreamBuffer(
-      yuv_stream_id_, &(block_request.input_buffers),
-      &(block_request.input_buffer_metadata), /*payload_frames=*/kZslBufferSize);
+  // Get multiple yuv buffers, or one settled RAW buffer, and metadata from
+  // internal stream as input
+  status_t result;
+  if (zsl_format_ == HAL_PIXEL_FORMAT_RAW16) {
+    result = internal_stream_manager_->GetMostRecentStreamBuffer(
+        zsl_stream_id_, request.frame_number, &(block_request.input_buffers),
+        &(block_request.input_buffer_metadata),
+        /*payload_frames=*/kRawZslBufferSize,
+        /*min_filled_buffers=*/kRawZslBufferSize,
+        ZslBufferManager::SelectionPolicy::kSettled);
+  } else {
+    result = internal_stream_manager_->GetMostRecentStreamBuffer(
+        zsl_stream_id_, request.frame_number, &(block_request.input_buffers),
+        &(block_request.input_buffer_metadata),
+        /*payload_frames=*/kZslBufferSize);
+  }
   if (result != OK) {
     ALOGE("%s: frame:%d GetStreamBuffer failed.", __FUNCTION__,
           request.frame_number);
@@ -192,6 +281,8 @@ status_t SnapshotRequestProcessor::ProcessRequest(const CaptureRequest& request)
     return UNKNOWN_ERROR;
   }
 
+  UpdateZslAge(block_request.input_buffer_metadata);
+
   // TODO(mhtan): may need to remove some metadata here.
   std::vector<ProcessBlockRequest> block_requests(1);
   block_requests[0].request = std::move(block_request);
@@ -202,6 +293,9 @@ status_t SnapshotRequestProcessor::ProcessRequest(const CaptureRequest& request)
   if (result != OK) {
     session_callback_.return_stream_buffers(
         block_requests[0].request.output_buffers);
+    // Free the slot for the next snapshot.
+    internal_stream_manager_->ReturnZslStreamBuffers(request.frame_number,
+                                                     zsl_stream_id_);
   }
 
   return result;
@@ -17,6 +17,7 @@
 #ifndef HARDWARE_GOOGLE_CAMERA_HAL_GOOGLE_CAMERA_HAL_SNAPSHOT_REQUEST_PROCESSOR_H_
 #define HARDWARE_GOOGLE_CAMERA_HAL_GOOGLE_CAMERA_HAL_SNAPSHOT_REQUEST_PROCESSOR_H_
 
+#include <mutex>
 #include <vector>
 
 #include "process_block.h"
@@ -26,17 +27,49 @@ namespace android {
 namespace google_camera_hal {
 
 // SnapshotRequestProcessor implements a RequestProcessor that adds
-// internal yuv stream as input stream to request and forwards the request to
+// internal ZSL stream as input stream to request and forwards the request to
 // its ProcessBlock.
+//
+// With a YCBCR_420_888 ZSL stream, a snapshot uses the kZslBufferSize most
+// recent frames. With a RAW16 ZSL stream, a snapshot reprocesses the most
+// recent frame captured with 3A settled, which the process block develops
+// into its YUV and JPEG outputs.
+//
+// Up to max_in_flight_snapshots snapshots can be processed at the same time,
+// each holding its own ZSL input buffers until its result returns them. When
+// all slots are busy, ProcessRequest() fails right away so the caller can
+// capture the snapshot with the realtime pipeline instead of stalling the
+// request thread.
 class SnapshotRequestProcessor : public RequestProcessor {
  public:
+  // Number of YUV and RAW ZSL buffers used as input by a snapshot.
+  static constexpr int kZslBufferSize = 3;
+  static constexpr int kRawZslBufferSize = 1;
+  static constexpr uint32_t kDefaultMaxInFlightSnapshots = 2;
+
+  static constexpr int GetZslBufferSize(android_pixel_format_t zsl_format) {
+    return zsl_format == HAL_PIXEL_FORMAT_RAW16 ? kRawZslBufferSize
+                                                : kZslBufferSize;
+  }
+
+  // Age of the newest ZSL input when snapshots are submitted, the shutter
+  // lag of ZSL snapshots.
+  struct Stats {
+    uint64_t snapshots = 0;
+    int64_t total_zsl_age_ns = 0;
+    int64_t max_zsl_age_ns = 0;
+  };
+
   // device_session_hwl is owned by the caller and must be valid during the
-  // lifetime of this SnapshotRequestProcessor.
+  // lifetime of this SnapshotRequestProcessor. zsl_format is the format of
+  // the internal stream zsl_stream_id, YCBCR_420_888 or RAW16.
   static std::unique_ptr<SnapshotRequestProcessor> Create(
       CameraDeviceSessionHwl* device_session_hwl,
-      HwlSessionCallback session_callback, int32_t yuv_stream_id);
+      HwlSessionCallback session_callback, int32_t zsl_stream_id,
+      uint32_t max_in_flight_snapshots = kDefaultMaxInFlightSnapshots,
+      android_pixel_format_t zsl_format = HAL_PIXEL_FORMAT_YCBCR_420_888);
 
-  virtual ~SnapshotRequestProcessor() = default;
+  virtual ~SnapshotRequestProcessor();
 
   // Override functions of RequestProcessor start.
   status_t ConfigureStreams(
@@ -46,7 +79,7 @@ class SnapshotRequestProcessor : public RequestProcessor {
 
   status_t SetProcessBlock(std::unique_ptr<ProcessBlock> process_block) override;
 
-  // Adds internal yuv stream as input stream to request and forwards the
+  // Adds internal ZSL stream as input stream to request and forwards the
   // request to its ProcessBlock.
   status_t ProcessRequest(const CaptureRequest& request) override;
 
@@ -56,6 +89,8 @@ class SnapshotRequestProcessor : public RequestProcessor {
   void RepeatingRequestEnd(int32_t frame_number,
                            const std::vector<int32_t>& stream_ids) override;
 
+  Stats GetStats();
+
  protected:
   explicit SnapshotRequestProcessor(HwlSessionCallback session_callback)
       : session_callback_(session_callback) {
@@ -63,19 +98,32 @@ class SnapshotRequestProcessor : public RequestProcessor {
 
  private:
   status_t Initialize(CameraDeviceSessionHwl* device_session_hwl,
-                      int32_t yuv_stream_id);
+                      int32_t zsl_stream_id, uint32_t max_in_flight_snapshots,
+                      android_pixel_format_t zsl_format);
+
+  // Return if a snapshot slot is free.
   bool IsReadyForNextRequest();
 
-  static constexpr int kZslBufferSize = 3;
+  // Add the age of the newest ZSL input to stats_.
+  void UpdateZslAge(
+      const std::vector<std::unique_ptr<HalCameraMetadata>>& input_metadata);
+
   std::mutex process_block_lock_;
 
   // Protected by process_block_lock_.
   std::unique_ptr<ProcessBlock> process_block_;
 
   InternalStreamManager* internal_stream_manager_ = nullptr;
-  int32_t yuv_stream_id_ = -1;
-  uint32_t active_array_width_ = 0;
-  uint32_t active_array_height_ = 0;
+  int32_t zsl_stream_id_ = -1;
+  android_pixel_format_t zsl_format_ = HAL_PIXEL_FORMAT_YCBCR_420_888;
+  uint32_t max_in_flight_snapshots_ = kDefaultMaxInFlightSnapshots;
+  // Size of the ZSL stream.
+  uint32_t zsl_width_ = 0;
+  uint32_t zsl_height_ = 0;
+
+  std::mutex stats_lock_;
+  // Protected by stats_lock_.
+  Stats stats_;
 
   HwlSessionCallback session_callback_;
 };
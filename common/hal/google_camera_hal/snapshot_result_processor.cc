@@ -91,20 +91,22 @@ void SnapshotResultProcessor::ProcessResult(ProcessBlockResult block_result) {
     return;
   }
 
-  // Return yuv buffer to internal stream manager and remove it from result
+  // Return yuv buffer to internal stream manager and remove it from result.
+  // Other snapshots may still hold their buffers, so only the buffers of this
+  // frame are returned.
   status_t res;
-  if (result->output_buffers.size() != 0 &&
-      internal_stream_manager_->IsPendingBufferEmpty(yuv_stream_id_) == false) {
+  if (result->output_buffers.size() != 0) {
     res = internal_stream_manager_->ReturnZslStreamBuffers(result->frame_number,
                                                            yuv_stream_id_);
-    if (res != OK) {
-      ALOGE("%s: (%d)ReturnZslStreamBuffers fail", __FUNCTION__,
-            result->frame_number);
-    } else {
+    if (res == OK) {
       ALOGI("%s: (%d)ReturnZslStreamBuffers ok", __FUNCTION__,
             result->frame_number);
+      result->input_buffers.clear();
+    } else if (res != NAME_NOT_FOUND) {
+      ALOGE("%s: (%d)ReturnZslStreamBuffers fail", __FUNCTION__,
+            result->frame_number);
+      result->input_buffers.clear();
     }
-    result->input_buffers.clear();
   }
 
   if (result->result_metadata) {
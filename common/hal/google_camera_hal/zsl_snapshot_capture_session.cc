@@ -21,11 +21,13 @@
 
 #include "zsl_snapshot_capture_session.h"
 
+#include <cutils/properties.h>
 #include <dlfcn.h>
 #include <log/log.h>
 #include <sys/stat.h>
 #include <utils/Trace.h>
 
+#include "burst_merge_process_block.h"
 #include "hal_utils.h"
 #include "libgooglecamerahal_flags.h"
 #include "realtime_zsl_result_request_processor.h"
@@ -51,6 +53,12 @@ constexpr char kExternalProcessBlockDir[] =
 #endif
 #endif  // GCH_HWL_USE_DLOPEN
 
+// Use a RAW16 ZSL ring if the HWL supports RAW reprocessing.
+constexpr char kRawZslProp[] = "persist.vendor.camera.raw_zsl";
+
+// Merge the YUV ZSL inputs of a snapshot before the snapshot process block.
+constexpr char kBurstMergeProp[] = "persist.vendor.camera.burst_merge";
+
 bool IsSwDenoiseSnapshotCompatible(const CaptureRequest& request) {
   if (request.settings == nullptr) {
     return false;
@@ -91,9 +99,12 @@ bool IsSwDenoiseSnapshotCompatible(const CaptureRequest& request) {
 }
 }  // namespace
 
-std::unique_ptr<ProcessBlock>
-ZslSnapshotCaptureSession::CreateSnapshotProcessBlock() {
+ExternalProcessBlockFactory*
+ZslSnapshotCaptureSession::LoadSnapshotProcessBlockFactory() {
   ATRACE_CALL();
+  if (snapshot_process_block_factory_ != nullptr) {
+    return snapshot_process_block_factory_();
+  }
 #if GCH_HWL_USE_DLOPEN
   bool found_process_block = false;
   for (const auto& lib_path :
@@ -128,18 +139,24 @@ ZslSnapshotCaptureSession::CreateSnapshotProcessBlock() {
     ALOGE("%s: snapshot process block does not exist", __FUNCTION__);
     return nullptr;
   }
-
-  return snapshot_process_block_factory_()->CreateProcessBlock(
-      camera_device_session_hwl_);
 #else
   if (GetSnapshotProcessBlockFactory == nullptr) {
     ALOGE("%s: snapshot process block does not exist", __FUNCTION__);
     return nullptr;
   }
   snapshot_process_block_factory_ = GetSnapshotProcessBlockFactory;
-  return GetSnapshotProcessBlockFactory()->CreateProcessBlock(
-      camera_device_session_hwl_);
 #endif
+  return snapshot_process_block_factory_();
+}
+
+std::unique_ptr<ProcessBlock>
+ZslSnapshotCaptureSession::CreateSnapshotProcessBlock() {
+  ATRACE_CALL();
+  ExternalProcessBlockFactory* factory = LoadSnapshotProcessBlockFactory();
+  if (factory == nullptr) {
+    return nullptr;
+  }
+  return factory->CreateProcessBlock(camera_device_session_hwl_);
 }
 
 std::unique_ptr<ProcessBlock>
@@ -338,18 +355,25 @@ status_t ZslSnapshotCaptureSession::BuildPipelines(
     return res;
   }
 
+  // Reserve the ZSL buffers held by in flight snapshots.
+  const uint32_t additional_buffer_number =
+      SnapshotRequestProcessor::GetZslBufferSize(zsl_format_) *
+      SnapshotRequestProcessor::kDefaultMaxInFlightSnapshots;
   for (uint32_t i = 0; i < hal_configured_streams->size(); i++) {
     if (hal_configured_streams->at(i).id == additional_stream_id_) {
+      HalStream& zsl_stream = hal_configured_streams->at(i);
       // Reserve additional buffer(s).
-      hal_configured_streams->at(i).max_buffers += kAdditionalBufferNumber;
-      // Allocate internal YUV stream buffers
+      zsl_stream.max_buffers += additional_buffer_number;
+      // Allocate internal ZSL stream buffers
       res = internal_stream_manager_->AllocateBuffers(
-          hal_configured_streams->at(i),
-          /*additional_num_buffers=*/kAdditionalBufferNumber);
+          zsl_stream, /*additional_num_buffers=*/additional_buffer_number);
       if (res != OK) {
         ALOGE("%s: AllocateBuffers failed.", __FUNCTION__);
         return UNKNOWN_ERROR;
       }
+      ALOGI("%s: %s ZSL ring of %u buffers, %u for in flight snapshots",
+            __FUNCTION__, zsl_format_ == HAL_PIXEL_FORMAT_RAW16 ? "RAW" : "YUV",
+            zsl_stream.max_buffers, additional_buffer_number);
       break;
     }
   }
@@ -432,8 +456,8 @@ status_t ZslSnapshotCaptureSession::ConfigureStreams(
     realtime_result_processor = std::move(processor);
   } else {
     realtime_result_processor = RealtimeZslResultProcessor::Create(
-        internal_stream_manager_.get(), additional_stream_id,
-        HAL_PIXEL_FORMAT_YCBCR_420_888, partial_result_count_);
+        internal_stream_manager_.get(), additional_stream_id, zsl_format_,
+        partial_result_count_);
   }
 
   if (realtime_result_processor == nullptr) {
@@ -578,10 +602,19 @@ status_t ZslSnapshotCaptureSession::SetupSnapshotProcessChain(
     ALOGE("%s: Creating SnapshotProcessBlock failed.", __FUNCTION__);
     return UNKNOWN_ERROR;
   }
+  if (burst_merge_enabled_) {
+    snapshot_process_block =
+        BurstMergeProcessBlock::Create(std::move(snapshot_process_block));
+    if (snapshot_process_block == nullptr) {
+      ALOGE("%s: Creating BurstMergeProcessBlock failed.", __FUNCTION__);
+      return UNKNOWN_ERROR;
+    }
+  }
   snapshot_process_block_ = snapshot_process_block.get();
 
   snapshot_request_processor_ = SnapshotRequestProcessor::Create(
-      camera_device_session_hwl_, hwl_session_callback_, additional_stream_id_);
+      camera_device_session_hwl_, hwl_session_callback_, additional_stream_id_,
+      SnapshotRequestProcessor::kDefaultMaxInFlightSnapshots, zsl_format_);
   if (snapshot_request_processor_ == nullptr) {
     ALOGE("%s: Creating SnapshotRequestProcessor failed.", __FUNCTION__);
     return UNKNOWN_ERROR;
@@ -645,7 +678,7 @@ status_t ZslSnapshotCaptureSession::SetupRealtimeProcessChain(
 
   // Create realtime request processor.
   realtime_request_processor_ = RealtimeZslRequestProcessor::Create(
-      camera_device_session_hwl_, HAL_PIXEL_FORMAT_YCBCR_420_888);
+      camera_device_session_hwl_, zsl_format_);
   if (realtime_request_processor_ == nullptr) {
     ALOGE("%s: Creating RealtimeZslRequestProcessor failed.", __FUNCTION__);
     return UNKNOWN_ERROR;
@@ -744,6 +777,32 @@ status_t ZslSnapshotCaptureSession::Initialize(
     ALOGI("%s: video sw denoise is disabled.", __FUNCTION__);
   }
 
+  if (property_get_bool(kRawZslProp, false)) {
+    if (video_sw_denoise_enabled_) {
+      ALOGI("%s: RAW ZSL is disabled by video sw denoise.", __FUNCTION__);
+    } else if (!hal_utils::IsReprocessInputSupported(characteristics.get(),
+                                                     HAL_PIXEL_FORMAT_RAW16)) {
+      ALOGI("%s: RAW ZSL is not supported by the HWL.", __FUNCTION__);
+    } else if (ExternalProcessBlockFactory* factory =
+                   LoadSnapshotProcessBlockFactory();
+               factory == nullptr ||
+               !factory->IsInputFormatSupported(HAL_PIXEL_FORMAT_RAW16)) {
+      // Keep the YUV ring the snapshot process block supports.
+      ALOGI("%s: RAW ZSL is not supported by the snapshot process block.",
+            __FUNCTION__);
+    } else {
+      zsl_format_ = HAL_PIXEL_FORMAT_RAW16;
+      ALOGI("%s: RAW ZSL is enabled.", __FUNCTION__);
+    }
+  }
+
+  // BurstMerger only merges YUV.
+  if (property_get_bool(kBurstMergeProp, false) &&
+      zsl_format_ == HAL_PIXEL_FORMAT_YCBCR_420_888) {
+    burst_merge_enabled_ = true;
+    ALOGI("%s: ZSL burst merge is enabled.", __FUNCTION__);
+  }
+
   for (auto stream : stream_config.streams) {
     if (utils::IsPreviewStream(stream)) {
       hal_preview_stream_id_ = stream.id;
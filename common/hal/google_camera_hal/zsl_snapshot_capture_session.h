@@ -50,6 +50,16 @@ class CameraDeviceSession;
 //                                    ||  /\
 //                                    \/  ||
 //                             embedded capture session
+//
+// The ZSL ring is a YCBCR_420_888 internal stream. When
+// persist.vendor.camera.raw_zsl is set and the HWL reprocesses RAW16 inputs
+// into YUV and JPEG, it is a RAW16 stream instead and snapshots reprocess a
+// RAW frame. The snapshot process block must also declare RAW16 inputs with
+// IsInputFormatSupported(). Video denoise needs the YUV ring and keeps it.
+//
+// When persist.vendor.camera.burst_merge is set with the YUV ring,
+// BurstMergeProcessBlock merges the ZSL inputs of a snapshot into a scratch
+// buffer that SnapshotProcessBlock processes in place of the newest one.
 class ZslSnapshotCaptureSession : public CaptureSession {
  public:
   // Return if the device session HWL and stream configuration are supported.
@@ -100,7 +110,6 @@ class ZslSnapshotCaptureSession : public CaptureSession {
 
  private:
   static constexpr uint32_t kPartialResult = 1;
-  static constexpr int kAdditionalBufferNumber = 3;
 
   status_t Initialize(CameraDeviceSessionHwl* device_session_hwl,
                       const StreamConfiguration& stream_config,
@@ -134,6 +143,9 @@ class ZslSnapshotCaptureSession : public CaptureSession {
       const StreamConfiguration& stream_config,
       std::vector<HalStream>* hal_configured_streams);
 
+  // Load the factory of the snapshot process block once. Return nullptr if
+  // there is no snapshot process block.
+  ExternalProcessBlockFactory* LoadSnapshotProcessBlockFactory();
   std::unique_ptr<ProcessBlock> CreateSnapshotProcessBlock();
   std::unique_ptr<ProcessBlock> CreateDenoiseProcessBlock();
 
@@ -165,6 +177,11 @@ class ZslSnapshotCaptureSession : public CaptureSession {
   int32_t hal_preview_stream_id_ = -1;
 
   int32_t additional_stream_id_ = -1;
+  // Format of the ZSL ring, the additional stream.
+  android_pixel_format_t zsl_format_ = HAL_PIXEL_FORMAT_YCBCR_420_888;
+
+  // Whether the YUV ZSL inputs of snapshots are merged.
+  bool burst_merge_enabled_ = false;
 
   std::unique_ptr<ZslResultDispatcher> result_dispatcher_;
 
@@ -186,7 +203,7 @@ class ZslSnapshotCaptureSession : public CaptureSession {
   std::vector<HalStream>* hal_config_ = nullptr;
 
   using GetProcessBlockFactoryFunc = ExternalProcessBlockFactory* (*)();
-  GetProcessBlockFactoryFunc snapshot_process_block_factory_;
+  GetProcessBlockFactoryFunc snapshot_process_block_factory_ = nullptr;
   // Opened library handles that should be closed on destruction
   void* snapshot_process_block_lib_handle_ = nullptr;
 
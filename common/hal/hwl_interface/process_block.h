@@ -113,6 +113,12 @@ class ExternalProcessBlockFactory {
       CameraDeviceSessionHwl* device_session_hwl) = 0;
 
   virtual std::string GetBlockName() const = 0;
+
+  // Return if the process block can process input buffers of format, such as
+  // the ZSL inputs of a snapshot. By default only YCBCR_420_888 is supported.
+  virtual bool IsInputFormatSupported(android_pixel_format_t format) const {
+    return format == HAL_PIXEL_FORMAT_YCBCR_420_888;
+  }
 };
 
 #if !GCH_HWL_USE_DLOPEN
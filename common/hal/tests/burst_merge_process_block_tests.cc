@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BurstMergeProcessBlockTests"
+#include <log/log.h>
+
+#include <gtest/gtest.h>
+#include <hardware/gralloc.h>
+#include <ui/GraphicBufferMapper.h>
+#include <ui/Rect.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "burst_merge_process_block.h"
+#include "gralloc_buffer_allocator.h"
+#include "mock_process_block.h"
+#include "mock_result_processor.h"
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace android {
+namespace google_camera_hal {
+
+static constexpr int32_t kZslStreamId = 10;
+static constexpr uint32_t kWidth = 320;
+static constexpr uint32_t kHeight = 240;
+static constexpr uint32_t kNumInputs = 4;
+static constexpr float kNoiseSigma = 6.0f;
+
+// Queue a request of frame_number with one output buffer of stream 1 and
+// input_buffers of the ZSL stream.
+static void QueueRequest(BurstMergeProcessBlock* block, uint32_t frame_number,
+                         const std::vector<buffer_handle_t>& input_buffers = {}) {
+  std::vector<ProcessBlockRequest> block_requests(1);
+  block_requests[0].request_id = frame_number;
+  block_requests[0].request.frame_number = frame_number;
+  block_requests[0].request.output_buffers = {
+      {.stream_id = 1, .buffer_id = frame_number}};
+  for (auto buffer : input_buffers) {
+    block_requests[0].request.input_buffers.push_back(
+        {.stream_id = kZslStreamId, .buffer = buffer});
+  }
+
+  CaptureRequest remaining_session_request;
+  remaining_session_request.frame_number = frame_number;
+  remaining_session_request.input_buffers =
+      block_requests[0].request.input_buffers;
+  EXPECT_EQ(block->ProcessRequests(block_requests, remaining_session_request),
+            OK);
+}
+
+// Smooth textured luma of the test scene.
+static float Scene(uint32_t x, uint32_t y) {
+  return 128.0f + 48.0f * std::sin(x / 7.0f) * std::cos(y / 5.0f);
+}
+
+// Render the scene with gaussian noise of sigma into buffer.
+static void RenderFrame(buffer_handle_t buffer, float sigma,
+                        std::minstd_rand* random) {
+  android_ycbcr ycbcr = {};
+  ASSERT_EQ(GraphicBufferMapper::get().lockYCbCr(
+                buffer, GRALLOC_USAGE_SW_WRITE_OFTEN,
+                android::Rect(kWidth, kHeight), &ycbcr),
+            OK);
+  std::normal_distribution<float> noise(0, sigma);
+  for (uint32_t y = 0; y < kHeight; y++) {
+    auto row = static_cast<uint8_t*>(ycbcr.y) + y * ycbcr.ystride;
+    for (uint32_t x = 0; x < kWidth; x++) {
+      row[x] = static_cast<uint8_t>(
+          std::clamp(Scene(x, y) + noise(*random) + 0.5f, 0.0f, 255.0f));
+    }
+  }
+  for (uint32_t y = 0; y < kHeight / 2; y++) {
+    for (uint32_t x = 0; x < kWidth / 2; x++) {
+      size_t offset = y * ycbcr.cstride + x * ycbcr.chroma_step;
+      static_cast<uint8_t*>(ycbcr.cb)[offset] = 128;
+      static_cast<uint8_t*>(ycbcr.cr)[offset] = 128;
+    }
+  }
+  GraphicBufferMapper::get().unlock(buffer);
+}
+
+// Return the luma of buffer.
+static std::vector<uint8_t> ReadLuma(buffer_handle_t buffer) {
+  android_ycbcr ycbcr = {};
+  if (GraphicBufferMapper::get().lockYCbCr(buffer, GRALLOC_USAGE_SW_READ_OFTEN,
+                                           android::Rect(kWidth, kHeight),
+                                           &ycbcr) != OK) {
+    return {};
+  }
+  std::vector<uint8_t> luma(kWidth * kHeight);
+  for (uint32_t y = 0; y < kHeight; y++) {
+    memcpy(luma.data() + y * kWidth,
+           static_cast<uint8_t*>(ycbcr.y) + y * ycbcr.ystride, kWidth);
+  }
+  GraphicBufferMapper::get().unlock(buffer);
+  return luma;
+}
+
+// Mean absolute difference of luma and the scene, away from the borders.
+static float MeanSceneError(const std::vector<uint8_t>& luma) {
+  const uint32_t kMargin = 16;
+  float error = 0;
+  for (uint32_t y = kMargin; y < kHeight - kMargin; y++) {
+    for (uint32_t x = kMargin; x < kWidth - kMargin; x++) {
+      error += std::abs(luma[y * kWidth + x] - Scene(x, y));
+    }
+  }
+  return error / ((kWidth - 2 * kMargin) * (kHeight - 2 * kMargin));
+}
+
+// Stream configuration with a YUV ZSL input stream.
+static StreamConfiguration GetZslStreamConfig() {
+  StreamConfiguration stream_config;
+  stream_config.streams = {{.id = kZslStreamId,
+                            .stream_type = StreamType::kInput,
+                            .width = kWidth,
+                            .height = kHeight,
+                            .format = HAL_PIXEL_FORMAT_YCBCR_420_888}};
+  return stream_config;
+}
+
+TEST(BurstMergeProcessBlockTests, Create) {
+  EXPECT_EQ(BurstMergeProcessBlock::Create(nullptr), nullptr);
+  EXPECT_NE(BurstMergeProcessBlock::Create(std::make_unique<MockProcessBlock>()),
+            nullptr);
+}
+
+TEST(BurstMergeProcessBlockTests, ForwardRequestsInOrder) {
+  auto snapshot_process_block = std::make_unique<MockProcessBlock>();
+  MockProcessBlock* mock_block = snapshot_process_block.get();
+  std::vector<uint32_t> forwarded_frames;
+  EXPECT_CALL(*mock_block, ProcessRequests(_, _))
+      .Times(3)
+      .WillRepeatedly(
+          Invoke([&forwarded_frames](
+                     const std::vector<ProcessBlockRequest>& block_requests,
+                     const CaptureRequest& remaining_session_request) {
+            EXPECT_EQ(block_requests.size(), 1u);
+            EXPECT_EQ(block_requests[0].request.frame_number,
+                      remaining_session_request.frame_number);
+            forwarded_frames.push_back(remaining_session_request.frame_number);
+            return OK;
+          }));
+
+  auto block = BurstMergeProcessBlock::Create(std::move(snapshot_process_block));
+  ASSERT_NE(block, nullptr);
+  for (uint32_t frame_number = 1; frame_number <= 3; frame_number++) {
+    QueueRequest(block.get(), frame_number);
+  }
+
+  // The queued requests are forwarded before the block is destroyed.
+  block = nullptr;
+  EXPECT_EQ(forwarded_frames, std::vector<uint32_t>({1, 2, 3}));
+}
+
+TEST(BurstMergeProcessBlockTests, FailRejectedRequests) {
+  auto result_processor = std::make_unique<MockResultProcessor>();
+  MockResultProcessor* mock_result_processor = result_processor.get();
+  EXPECT_CALL(*mock_result_processor, Notify(_))
+      .WillOnce(Invoke([](const ProcessBlockNotifyMessage& message) {
+        EXPECT_EQ(message.request_id, 5u);
+        EXPECT_EQ(message.message.type, MessageType::kError);
+        EXPECT_EQ(message.message.message.error.frame_number, 5u);
+        EXPECT_EQ(message.message.message.error.error_code,
+                  ErrorCode::kErrorRequest);
+      }));
+  EXPECT_CALL(*mock_result_processor, ProcessResult(_))
+      .WillOnce(Invoke([](ProcessBlockResult result) {
+        EXPECT_EQ(result.request_id, 5u);
+        ASSERT_NE(result.result, nullptr);
+        EXPECT_EQ(result.result->frame_number, 5u);
+        ASSERT_EQ(result.result->output_buffers.size(), 1u);
+        EXPECT_EQ(result.result->output_buffers[0].buffer_id, 5u);
+        EXPECT_EQ(result.result->output_buffers[0].status,
+                  BufferStatus::kError);
+      }));
+
+  // The snapshot process block owns the result processor.
+  auto snapshot_process_block = std::make_unique<MockProcessBlock>();
+  MockProcessBlock* mock_block = snapshot_process_block.get();
+  std::unique_ptr<ResultProcessor> owned_result_processor;
+  EXPECT_CALL(*mock_block, SetResultProcessor(_))
+      .WillOnce(Invoke([&owned_result_processor](
+                           std::unique_ptr<ResultProcessor> processor) {
+        owned_result_processor = std::move(processor);
+        return OK;
+      }));
+  EXPECT_CALL(*mock_block, ProcessRequests(_, _))
+      .WillOnce(Return(BAD_VALUE));
+
+  auto block = BurstMergeProcessBlock::Create(std::move(snapshot_process_block));
+  ASSERT_NE(block, nullptr);
+  ASSERT_EQ(block->SetResultProcessor(std::move(result_processor)), OK);
+
+  // The request is accepted and fails when it is forwarded.
+  QueueRequest(block.get(), 5);
+  block = nullptr;
+}
+
+TEST(BurstMergeProcessBlockTests, FlushDropsQueuedRequests) {
+  auto result_processor = std::make_unique<MockResultProcessor>();
+  MockResultProcessor* mock_result_processor = result_processor.get();
+  std::vector<uint32_t> failed_frames;
+  EXPECT_CALL(*mock_result_processor, Notify(_)).Times(2);
+  EXPECT_CALL(*mock_result_processor, ProcessResult(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&failed_frames](ProcessBlockResult result) {
+        ASSERT_NE(result.result, nullptr);
+        EXPECT_EQ(result.result->output_buffers[0].status,
+                  BufferStatus::kError);
+        failed_frames.push_back(result.result->frame_number);
+      }));
+
+  // The first request blocks in the snapshot process block until released.
+  auto snapshot_process_block = std::make_unique<MockProcessBlock>();
+  MockProcessBlock* mock_block = snapshot_process_block.get();
+  std::unique_ptr<ResultProcessor> owned_result_processor;
+  EXPECT_CALL(*mock_block, SetResultProcessor(_))
+      .WillOnce(Invoke([&owned_result_processor](
+                           std::unique_ptr<ResultProcessor> processor) {
+        owned_result_processor = std::move(processor);
+        return OK;
+      }));
+  std::promise<void> forwarding;
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  EXPECT_CALL(*mock_block, ProcessRequests(_, _))
+      .WillOnce(Invoke([&forwarding, released](
+                           const std::vector<ProcessBlockRequest>& block_requests,
+                           const CaptureRequest&) {
+        EXPECT_EQ(block_requests[0].request.frame_number, 1u);
+        forwarding.set_value();
+        released.wait();
+        return OK;
+      }));
+  EXPECT_CALL(*mock_block, Flush()).WillOnce(Return(OK));
+
+  auto block = BurstMergeProcessBlock::Create(std::move(snapshot_process_block));
+  ASSERT_NE(block, nullptr);
+  ASSERT_EQ(block->SetResultProcessor(std::move(result_processor)), OK);
+  for (uint32_t frame_number = 1; frame_number <= 3; frame_number++) {
+    QueueRequest(block.get(), frame_number);
+  }
+  forwarding.get_future().wait();
+
+  // Flush() takes the queued requests and waits for the forwarded one.
+  auto flush = std::async(std::launch::async, [&block] { return block->Flush(); });
+  EXPECT_EQ(flush.wait_for(std::chrono::milliseconds(100)),
+            std::future_status::timeout);
+  release.set_value();
+  EXPECT_EQ(flush.get(), OK);
+  EXPECT_EQ(failed_frames, std::vector<uint32_t>({2, 3}));
+}
+
+TEST(BurstMergeProcessBlockTests, MergeIntoScratchBuffer) {
+  auto allocator = GrallocBufferAllocator::Create();
+  ASSERT_NE(allocator, nullptr);
+  HalBufferDescriptor buffer_descriptor = {
+      .width = kWidth,
+      .height = kHeight,
+      .format = HAL_PIXEL_FORMAT_YCBCR_420_888,
+      .producer_flags = GRALLOC_USAGE_SW_WRITE_OFTEN,
+      .consumer_flags = GRALLOC_USAGE_SW_READ_OFTEN,
+      .immediate_num_buffers = kNumInputs,
+      .max_num_buffers = kNumInputs};
+  std::vector<buffer_handle_t> zsl_buffers;
+  ASSERT_EQ(allocator->AllocateBuffers(buffer_descriptor, &zsl_buffers), OK);
+  std::minstd_rand random(7);
+  std::vector<std::vector<uint8_t>> zsl_lumas;
+  for (auto buffer : zsl_buffers) {
+    RenderFrame(buffer, kNoiseSigma, &random);
+    zsl_lumas.push_back(ReadLuma(buffer));
+    ASSERT_FALSE(zsl_lumas.back().empty());
+  }
+
+  // The result processor of the session sees the ZSL buffers.
+  auto result_processor = std::make_unique<MockResultProcessor>();
+  MockResultProcessor* mock_result_processor = result_processor.get();
+  EXPECT_CALL(*mock_result_processor, ProcessResult(_))
+      .Times(3)
+      .WillRepeatedly(Invoke([&zsl_buffers](ProcessBlockResult result) {
+        ASSERT_NE(result.result, nullptr);
+        ASSERT_EQ(result.result->input_buffers.size(), kNumInputs);
+        for (uint32_t i = 0; i < kNumInputs; i++) {
+          EXPECT_EQ(result.result->input_buffers[i].buffer, zsl_buffers[i]);
+        }
+      }));
+
+  auto snapshot_process_block = std::make_unique<MockProcessBlock>();
+  MockProcessBlock* mock_block = snapshot_process_block.get();
+  std::unique_ptr<ResultProcessor> owned_result_processor;
+  EXPECT_CALL(*mock_block, ConfigureStreams(_, _)).WillOnce(Return(OK));
+  EXPECT_CALL(*mock_block, SetResultProcessor(_))
+      .WillOnce(Invoke([&owned_result_processor](
+                           std::unique_ptr<ResultProcessor> processor) {
+        owned_result_processor = std::move(processor);
+        return OK;
+      }));
+  std::vector<CaptureRequest> forwarded_requests;
+  std::promise<void> forwarded;
+  EXPECT_CALL(*mock_block, ProcessRequests(_, _))
+      .Times(3)
+      .WillRepeatedly(Invoke(
+          [&](const std::vector<ProcessBlockRequest>& block_requests,
+              const CaptureRequest& remaining_session_request) {
+            const auto& inputs = block_requests[0].request.input_buffers;
+            EXPECT_EQ(remaining_session_request.input_buffers.size(),
+                      inputs.size());
+            for (uint32_t i = 0; i < inputs.size(); i++) {
+              EXPECT_EQ(remaining_session_request.input_buffers[i].buffer,
+                        inputs[i].buffer);
+            }
+            CaptureRequest request;
+            request.frame_number = block_requests[0].request.frame_number;
+            request.input_buffers = block_requests[0].request.input_buffers;
+            request.output_buffers = block_requests[0].request.output_buffers;
+            forwarded_requests.push_back(std::move(request));
+            if (forwarded_requests.size() == 3) {
+              forwarded.set_value();
+            }
+            return OK;
+          }));
+
+  auto block = BurstMergeProcessBlock::Create(std::move(snapshot_process_block));
+  ASSERT_NE(block, nullptr);
+  ASSERT_EQ(block->ConfigureStreams(GetZslStreamConfig(), GetZslStreamConfig()),
+            OK);
+  ASSERT_EQ(block->SetResultProcessor(std::move(result_processor)), OK);
+
+  // Both scratch buffers are in use by the first two requests, the third one
+  // is forwarded unmerged.
+  for (uint32_t frame_number = 1; frame_number <= 3; frame_number++) {
+    QueueRequest(block.get(), frame_number, zsl_buffers);
+  }
+  ASSERT_EQ(forwarded.get_future().wait_for(std::chrono::seconds(10)),
+            std::future_status::ready);
+  ASSERT_EQ(forwarded_requests.size(), 3u);
+
+  float reference_error = MeanSceneError(zsl_lumas.back());
+  for (uint32_t i = 0; i < 2; i++) {
+    const auto& inputs = forwarded_requests[i].input_buffers;
+    ASSERT_EQ(inputs.size(), kNumInputs);
+    for (uint32_t j = 0; j + 1 < kNumInputs; j++) {
+      EXPECT_EQ(inputs[j].buffer, zsl_buffers[j]);
+    }
+    EXPECT_NE(inputs.back().buffer, zsl_buffers.back());
+    auto merged_luma = ReadLuma(inputs.back().buffer);
+    ASSERT_FALSE(merged_luma.empty());
+    EXPECT_LT(MeanSceneError(merged_luma), reference_error * 0.75f);
+  }
+  EXPECT_NE(forwarded_requests[0].input_buffers.back().buffer,
+            forwarded_requests[1].input_buffers.back().buffer);
+  EXPECT_EQ(forwarded_requests[2].input_buffers.back().buffer,
+            zsl_buffers.back());
+
+  // The ZSL buffers are not written.
+  for (uint32_t i = 0; i < kNumInputs; i++) {
+    EXPECT_EQ(ReadLuma(zsl_buffers[i]), zsl_lumas[i]);
+  }
+
+  // Results put the ZSL reference back and release the scratch buffers.
+  for (auto& request : forwarded_requests) {
+    auto result = std::make_unique<CaptureResult>(CaptureResult({}));
+    result->frame_number = request.frame_number;
+    result->output_buffers = request.output_buffers;
+    result->input_buffers = request.input_buffers;
+    owned_result_processor->ProcessResult(
+        {.request_id = request.frame_number, .result = std::move(result)});
+  }
+
+  block = nullptr;
+  allocator->FreeBuffers(&zsl_buffers);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BurstMergerTests"
+#include <log/log.h>
+
+#include <burst_merger.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+static constexpr uint32_t kWidth = 320;
+static constexpr uint32_t kHeight = 240;
+static constexpr float kNoiseSigma = 6.0f;
+
+// Textured scene, defined everywhere so frames can be shifted.
+static float Scene(int32_t x, int32_t y) {
+  // Value noise: hashed values on a 6 pixel lattice, interpolated
+  // bilinearly.
+  auto lattice = [](int32_t x, int32_t y) {
+    uint32_t h = static_cast<uint32_t>(x) * 73856093u ^
+                 static_cast<uint32_t>(y) * 19349663u;
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return static_cast<float>(h % 160) + 48.0f;
+  };
+  float fx = (x + 1000) / 6.0f;
+  float fy = (y + 1000) / 6.0f;
+  int32_t ix = static_cast<int32_t>(fx);
+  int32_t iy = static_cast<int32_t>(fy);
+  float ax = fx - ix;
+  float ay = fy - iy;
+  return (lattice(ix, iy) * (1 - ax) + lattice(ix + 1, iy) * ax) * (1 - ay) +
+         (lattice(ix, iy + 1) * (1 - ax) + lattice(ix + 1, iy + 1) * ax) * ay;
+}
+
+// Planar frame owning its pixels. Moves keep the pixels in place.
+class TestFrame {
+ public:
+  TestFrame(uint32_t width, uint32_t height)
+      : data_(width * height * 3 / 2, 128) {
+    image_ = {.y = data_.data(),
+              .cb = data_.data() + width * height,
+              .cr = data_.data() + width * height * 5 / 4,
+              .y_stride = width,
+              .cbcr_stride = width / 2,
+              .cbcr_step = 1,
+              .width = width,
+              .height = height};
+  }
+
+  TestFrame(TestFrame&&) = default;
+  TestFrame(const TestFrame&) = delete;
+  TestFrame& operator=(const TestFrame&) = delete;
+
+  // Render the scene moved by -dx, -dy with gaussian noise of sigma.
+  // Chroma follows the luma at half resolution.
+  void Render(int32_t dx, int32_t dy, float sigma, std::minstd_rand* random) {
+    std::normal_distribution<float> noise(0, sigma);
+    auto clamp = [](float value) {
+      return static_cast<uint8_t>(std::clamp(value + 0.5f, 0.0f, 255.0f));
+    };
+    for (uint32_t y = 0; y < image_.height; y++) {
+      for (uint32_t x = 0; x < image_.width; x++) {
+        float value = Scene(x + dx, y + dy);
+        image_.y[y * image_.y_stride + x] =
+            clamp(value + (sigma > 0 ? noise(*random) : 0));
+      }
+    }
+    for (uint32_t y = 0; y < image_.height / 2; y++) {
+      for (uint32_t x = 0; x < image_.width / 2; x++) {
+        float value = Scene(2 * x + dx, 2 * y + dy);
+        image_.cb[y * image_.cbcr_stride + x] = clamp(value * 0.5f + 64);
+        image_.cr[y * image_.cbcr_stride + x] = clamp(192 - value * 0.5f);
+      }
+    }
+  }
+
+  // Draw a size x size square of value on the luma.
+  void DrawSquare(uint32_t x0, uint32_t y0, uint32_t size, uint8_t value) {
+    for (uint32_t y = y0; y < y0 + size; y++) {
+      std::fill_n(image_.y + y * image_.y_stride + x0, size, value);
+    }
+  }
+
+  uint8_t GetY(uint32_t x, uint32_t y) const {
+    return image_.y[y * image_.y_stride + x];
+  }
+
+  const BurstImage& GetImage() const {
+    return image_;
+  }
+
+ private:
+  std::vector<uint8_t> data_;
+  BurstImage image_;
+};
+
+// Mean absolute luma difference of a and b over a region.
+static float MeanLumaError(const TestFrame& a, const TestFrame& b, uint32_t x0,
+                           uint32_t y0, uint32_t x1, uint32_t y1) {
+  float error = 0;
+  for (uint32_t y = y0; y < y1; y++) {
+    for (uint32_t x = x0; x < x1; x++) {
+      error += std::abs(static_cast<int32_t>(a.GetY(x, y)) - b.GetY(x, y));
+    }
+  }
+  return error / ((x1 - x0) * (y1 - y0));
+}
+
+TEST(BurstMergerTests, Create) {
+  EXPECT_EQ(BurstMerger::Create({.width = 0, .height = kHeight}), nullptr);
+  EXPECT_EQ(BurstMerger::Create({.width = 321, .height = kHeight}), nullptr);
+  EXPECT_EQ(BurstMerger::Create(
+                {.width = kWidth, .height = kHeight, .max_frames = 0}),
+            nullptr);
+  EXPECT_EQ(BurstMerger::Create(
+                {.width = kWidth, .height = kHeight, .noise_sigma = -1}),
+            nullptr);
+  EXPECT_NE(BurstMerger::Create({.width = kWidth, .height = kHeight}),
+            nullptr);
+}
+
+TEST(BurstMergerTests, InvalidFrames) {
+  auto merger = BurstMerger::Create(
+      {.width = kWidth, .height = kHeight, .max_frames = 2});
+  ASSERT_NE(merger, nullptr);
+  TestFrame frame(kWidth, kHeight);
+  TestFrame small_frame(kWidth / 2, kHeight / 2);
+  const BurstImage& image = frame.GetImage();
+
+  EXPECT_NE(merger->Merge({}, 0, image), OK);
+  EXPECT_NE(merger->Merge({image}, 1, image), OK);
+  EXPECT_NE(merger->Merge({image, image, image}, 0, image), OK);
+  EXPECT_NE(merger->Merge({image, small_frame.GetImage()}, 0, image), OK);
+  EXPECT_NE(merger->Merge({image}, 0, small_frame.GetImage()), OK);
+  EXPECT_EQ(merger->Merge({image}, 0, image), OK);
+}
+
+// Frames of a shaking camera align to the reference and average its noise
+// out.
+TEST(BurstMergerTests, AlignAndDenoise) {
+  static const int32_t kShifts[][2] = {
+      {0, 0}, {4, -2}, {-6, 8}, {10, 6}, {-14, -10}, {2, 18}};
+  std::minstd_rand random(1);
+  TestFrame clean(kWidth, kHeight);
+  clean.Render(0, 0, 0, &random);
+  std::vector<TestFrame> frames;
+  std::vector<BurstImage> images;
+  for (auto& shift : kShifts) {
+    frames.emplace_back(kWidth, kHeight);
+    frames.back().Render(shift[0], shift[1], kNoiseSigma, &random);
+  }
+  for (auto& frame : frames) {
+    images.push_back(frame.GetImage());
+  }
+
+  auto merger = BurstMerger::Create({.width = kWidth, .height = kHeight});
+  ASSERT_NE(merger, nullptr);
+  TestFrame output(kWidth, kHeight);
+  ASSERT_EQ(merger->Merge(images, 0, output.GetImage()), OK);
+
+  // The noise estimate is within the slack of the scene gradients.
+  float sigma = merger->GetStats().last_noise_sigma;
+  EXPECT_GT(sigma, kNoiseSigma * 0.8f);
+  EXPECT_LT(sigma, kNoiseSigma * 1.5f);
+
+  // Away from the borders, which some frames don't cover.
+  const uint32_t kBorder = 32;
+  float noisy_error = MeanLumaError(frames[0], clean, kBorder, kBorder,
+                                    kWidth - kBorder, kHeight - kBorder);
+  float merged_error = MeanLumaError(output, clean, kBorder, kBorder,
+                                     kWidth - kBorder, kHeight - kBorder);
+  ALOGI("%s: Mean error %.2f before and %.2f after merging %zu frames",
+        __FUNCTION__, noisy_error, merged_error, frames.size());
+  EXPECT_LT(merged_error, noisy_error * 0.6f);
+}
+
+// An object moving in the other frames leaves no ghost in the merge.
+TEST(BurstMergerTests, RejectMotion) {
+  static const uint32_t kNumFrames = 4;
+  static const uint32_t kSquareSize = 48;
+  std::minstd_rand random(2);
+  std::vector<TestFrame> frames;
+  std::vector<BurstImage> images;
+  for (uint32_t i = 0; i < kNumFrames; i++) {
+    frames.emplace_back(kWidth, kHeight);
+    frames.back().Render(0, 0, kNoiseSigma, &random);
+    frames.back().DrawSquare(32 + i * 64, 96, kSquareSize, 255);
+  }
+  for (auto& frame : frames) {
+    images.push_back(frame.GetImage());
+  }
+
+  auto merger = BurstMerger::Create(
+      {.width = kWidth, .height = kHeight, .noise_sigma = kNoiseSigma});
+  ASSERT_NE(merger, nullptr);
+  // Merge in place into the reference.
+  const TestFrame& reference = frames[0];
+  ASSERT_EQ(merger->Merge(images, 0, reference.GetImage()), OK);
+
+  // The square of the reference stays, the squares of the other frames
+  // don't show up.
+  for (uint32_t i = 0; i < kNumFrames; i++) {
+    float mean = 0;
+    for (uint32_t y = 96; y < 96 + kSquareSize; y++) {
+      for (uint32_t x = 32 + i * 64; x < 32 + i * 64 + kSquareSize; x++) {
+        mean += reference.GetY(x, y);
+      }
+    }
+    mean /= kSquareSize * kSquareSize;
+    if (i == 0) {
+      EXPECT_GT(mean, 250) << "frame " << i;
+    } else {
+      EXPECT_LT(mean, 200) << "frame " << i;
+    }
+  }
+}
+
+// Copy of a planar frame in NV21, chroma samples interleaved cr first.
+class SemiPlanarFrame {
+ public:
+  explicit SemiPlanarFrame(const BurstImage& planar)
+      : data_(planar.width * planar.height * 3 / 2) {
+    uint8_t* chroma = data_.data() + planar.width * planar.height;
+    image_ = {.y = data_.data(),
+              .cb = chroma + 1,
+              .cr = chroma,
+              .y_stride = planar.width,
+              .cbcr_stride = planar.width,
+              .cbcr_step = 2,
+              .width = planar.width,
+              .height = planar.height};
+    for (uint32_t y = 0; y < planar.height; y++) {
+      std::copy_n(planar.y + y * planar.y_stride, planar.width,
+                  image_.y + y * image_.y_stride);
+    }
+    for (uint32_t y = 0; y < planar.height / 2; y++) {
+      for (uint32_t x = 0; x < planar.width / 2; x++) {
+        uint32_t offset = y * image_.cbcr_stride + x * image_.cbcr_step;
+        image_.cb[offset] = planar.cb[y * planar.cbcr_stride + x];
+        image_.cr[offset] = planar.cr[y * planar.cbcr_stride + x];
+      }
+    }
+  }
+
+  const BurstImage& GetImage() const {
+    return image_;
+  }
+
+ private:
+  std::vector<uint8_t> data_;
+  BurstImage image_;
+};
+
+// Interleaved chroma merges as its planar copy does.
+TEST(BurstMergerTests, SemiPlanarMatchesPlanar) {
+  static const uint32_t kNumFrames = 3;
+  std::minstd_rand random(4);
+  std::vector<TestFrame> frames;
+  std::vector<SemiPlanarFrame> semi_planar_frames;
+  std::vector<BurstImage> images, semi_planar_images;
+  for (uint32_t i = 0; i < kNumFrames; i++) {
+    frames.emplace_back(kWidth, kHeight);
+    frames.back().Render(i * 5, -i * 3, kNoiseSigma, &random);
+  }
+  for (uint32_t i = 0; i < kNumFrames; i++) {
+    images.push_back(frames[i].GetImage());
+    semi_planar_frames.emplace_back(frames[i].GetImage());
+  }
+  for (auto& frame : semi_planar_frames) {
+    semi_planar_images.push_back(frame.GetImage());
+  }
+
+  auto merger = BurstMerger::Create({.width = kWidth,
+                                     .height = kHeight,
+                                     .noise_sigma = kNoiseSigma});
+  ASSERT_NE(merger, nullptr);
+  TestFrame output(kWidth, kHeight);
+  ASSERT_EQ(merger->Merge(images, 0, output.GetImage()), OK);
+  // In place, as the snapshot process block merges.
+  const BurstImage& semi_planar_output = semi_planar_images[0];
+  ASSERT_EQ(merger->Merge(semi_planar_images, 0, semi_planar_output), OK);
+
+  const BurstImage& planar_output = output.GetImage();
+  for (uint32_t y = 0; y < kHeight / 2; y++) {
+    for (uint32_t x = 0; x < kWidth / 2; x++) {
+      uint32_t offset = y * semi_planar_output.cbcr_stride + 2 * x;
+      ASSERT_EQ(semi_planar_output.cb[offset],
+                planar_output.cb[y * planar_output.cbcr_stride + x])
+          << x << ", " << y;
+      ASSERT_EQ(semi_planar_output.cr[offset],
+                planar_output.cr[y * planar_output.cbcr_stride + x])
+          << x << ", " << y;
+    }
+  }
+  for (uint32_t y = 0; y < kHeight; y++) {
+    ASSERT_TRUE(std::equal(planar_output.y + y * planar_output.y_stride,
+                           planar_output.y + y * planar_output.y_stride + kWidth,
+                           semi_planar_output.y + y * kWidth))
+        << "row " << y;
+  }
+}
+
+// Report the merge time per megapixel for a few burst lengths.
+TEST(BurstMergerTests, Benchmark) {
+  static const uint32_t kBenchmarkWidth = 1920;
+  static const uint32_t kBenchmarkHeight = 1440;
+  static const uint32_t kMaxFrames = 8;
+  static const uint32_t kIterations = 3;
+  std::minstd_rand random(3);
+  std::vector<TestFrame> frames;
+  for (uint32_t i = 0; i < kMaxFrames; i++) {
+    frames.emplace_back(kBenchmarkWidth, kBenchmarkHeight);
+    frames.back().Render(i * 3, -i * 2, kNoiseSigma, &random);
+  }
+  TestFrame output(kBenchmarkWidth, kBenchmarkHeight);
+
+  for (uint32_t num_threads : {1u, 0u}) {
+    auto merger = BurstMerger::Create({.width = kBenchmarkWidth,
+                                       .height = kBenchmarkHeight,
+                                       .max_frames = kMaxFrames,
+                                       .num_threads = num_threads});
+    ASSERT_NE(merger, nullptr);
+    for (uint32_t num_frames = 2; num_frames <= kMaxFrames; num_frames *= 2) {
+      std::vector<BurstImage> images;
+      for (uint32_t i = 0; i < num_frames; i++) {
+        images.push_back(frames[i].GetImage());
+      }
+      auto start = std::chrono::steady_clock::now();
+      for (uint32_t i = 0; i < kIterations; i++) {
+        ASSERT_EQ(merger->Merge(images, 0, output.GetImage()), OK);
+      }
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      ALOGI("%s: %u frames on %s: %.2f ms per MP", __FUNCTION__, num_frames,
+            num_threads == 1 ? "one thread" : "all threads",
+            std::chrono::duration<double, std::milli>(elapsed).count() /
+                kIterations / (kBenchmarkWidth * kBenchmarkHeight * 1e-6));
+    }
+  }
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
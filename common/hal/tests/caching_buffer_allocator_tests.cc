@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "CachingBufferAllocatorTests"
+#include <log/log.h>
+
+#include <caching_buffer_allocator.h>
+#include <gtest/gtest.h>
+#include <hardware/gralloc1.h>
+#include <inttypes.h>
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+namespace android {
+namespace google_camera_hal {
+
+// Heap-backed allocator. Each buffer is a native handle with a zero-filled
+// heap allocation of the estimated buffer size so allocation cost resembles
+// a real allocator.
+class HeapBufferAllocator : public IHalBufferAllocator {
+ public:
+  ~HeapBufferAllocator() {
+    EXPECT_TRUE(buffers_.empty()) << buffers_.size() << " buffers leaked";
+  }
+
+  status_t AllocateBuffers(const HalBufferDescriptor& buffer_descriptor,
+                           std::vector<buffer_handle_t>* buffers) override {
+    uint64_t size = CachingBufferAllocator::GetBufferSizeBytes(buffer_descriptor);
+    for (uint32_t i = 0; i < buffer_descriptor.immediate_num_buffers; i++) {
+      native_handle_t* handle = native_handle_create(/*numFds=*/0,
+                                                     /*numInts=*/0);
+      buffers_[handle] = std::vector<uint8_t>(size, 0);
+      buffers->push_back(handle);
+      num_allocations_++;
+    }
+    return OK;
+  }
+
+  void FreeBuffers(std::vector<buffer_handle_t>* buffers) override {
+    for (auto buffer : *buffers) {
+      auto it = buffers_.find(buffer);
+      ASSERT_NE(it, buffers_.end()) << "Freeing an unknown buffer";
+      buffers_.erase(it);
+      native_handle_delete(const_cast<native_handle_t*>(buffer));
+      num_frees_++;
+    }
+    buffers->clear();
+  }
+
+  uint32_t num_allocations_ = 0;
+  uint32_t num_frees_ = 0;
+
+ private:
+  std::unordered_map<buffer_handle_t, std::vector<uint8_t>> buffers_;
+};
+
+static HalBufferDescriptor GetDescriptor(uint32_t width, uint32_t height,
+                                         uint32_t num_buffers) {
+  HalBufferDescriptor buffer_descriptor = {};
+  buffer_descriptor.width = width;
+  buffer_descriptor.height = height;
+  buffer_descriptor.format = HAL_PIXEL_FORMAT_YCBCR_420_888;
+  buffer_descriptor.producer_flags = GRALLOC1_PRODUCER_USAGE_CAMERA;
+  buffer_descriptor.consumer_flags = GRALLOC1_CONSUMER_USAGE_CAMERA;
+  buffer_descriptor.immediate_num_buffers = num_buffers;
+  buffer_descriptor.max_num_buffers = num_buffers;
+  return buffer_descriptor;
+}
+
+static std::unique_ptr<CachingBufferAllocator> CreateAllocator(
+    uint64_t max_cached_bytes, HeapBufferAllocator** heap_allocator) {
+  auto allocator = std::make_unique<HeapBufferAllocator>();
+  *heap_allocator = allocator.get();
+  return CachingBufferAllocator::Create(std::move(allocator), max_cached_bytes);
+}
+
+TEST(CachingBufferAllocatorTests, ReuseFreedBuffers) {
+  HeapBufferAllocator* heap_allocator = nullptr;
+  auto allocator = CreateAllocator(/*max_cached_bytes=*/64 << 20,
+                                   &heap_allocator);
+  ASSERT_NE(allocator, nullptr);
+
+  auto descriptor = GetDescriptor(1920, 1080, /*num_buffers=*/4);
+  std::vector<buffer_handle_t> buffers;
+  ASSERT_EQ(allocator->AllocateBuffers(descriptor, &buffers), OK);
+  ASSERT_EQ(buffers.size(), 4u);
+  std::vector<buffer_handle_t> first_buffers = buffers;
+  allocator->FreeBuffers(&buffers);
+  EXPECT_TRUE(buffers.empty());
+  EXPECT_EQ(heap_allocator->num_frees_, 0u);
+
+  // Asking for more buffers of the same size class reuses the cached ones.
+  descriptor.immediate_num_buffers = 6;
+  ASSERT_EQ(allocator->AllocateBuffers(descriptor, &buffers), OK);
+  ASSERT_EQ(buffers.size(), 6u);
+  EXPECT_EQ(heap_allocator->num_allocations_, 6u);
+  for (auto buffer : first_buffers) {
+    EXPECT_NE(std::find(buffers.begin(), buffers.end(), buffer), buffers.end());
+  }
+
+  auto stats = allocator->GetStats();
+  EXPECT_EQ(stats.hit_count, 4u);
+  EXPECT_EQ(stats.miss_count, 6u);
+  EXPECT_EQ(stats.cached_buffer_count, 0u);
+
+  allocator->FreeBuffers(&buffers);
+  allocator->ReleaseCachedBuffers();
+  EXPECT_EQ(heap_allocator->num_frees_, 6u);
+  EXPECT_EQ(allocator->GetStats().cached_bytes, 0u);
+}
+
+TEST(CachingBufferAllocatorTests, SizeClassesAreSeparate) {
+  HeapBufferAllocator* heap_allocator = nullptr;
+  auto allocator = CreateAllocator(/*max_cached_bytes=*/64 << 20,
+                                   &heap_allocator);
+  ASSERT_NE(allocator, nullptr);
+
+  std::vector<buffer_handle_t> buffers;
+  ASSERT_EQ(allocator->AllocateBuffers(GetDescriptor(640, 480, 2), &buffers),
+            OK);
+  allocator->FreeBuffers(&buffers);
+
+  auto descriptor = GetDescriptor(640, 480, 2);
+  descriptor.format = HAL_PIXEL_FORMAT_RAW16;
+  ASSERT_EQ(allocator->AllocateBuffers(descriptor, &buffers), OK);
+  EXPECT_EQ(allocator->GetStats().hit_count, 0u);
+  EXPECT_EQ(heap_allocator->num_allocations_, 4u);
+  allocator->FreeBuffers(&buffers);
+}
+
+TEST(CachingBufferAllocatorTests, EvictLeastRecentlyUsed) {
+  auto small = GetDescriptor(640, 480, /*num_buffers=*/1);
+  auto large = GetDescriptor(1280, 720, /*num_buffers=*/1);
+  uint64_t large_bytes = CachingBufferAllocator::GetBufferSizeBytes(large);
+
+  HeapBufferAllocator* heap_allocator = nullptr;
+  auto allocator =
+      CreateAllocator(/*max_cached_bytes=*/2 * large_bytes, &heap_allocator);
+  ASSERT_NE(allocator, nullptr);
+
+  std::vector<buffer_handle_t> small_buffers;
+  std::vector<buffer_handle_t> large_buffers;
+  std::vector<buffer_handle_t> other_buffers;
+  ASSERT_EQ(allocator->AllocateBuffers(small, &small_buffers), OK);
+  ASSERT_EQ(allocator->AllocateBuffers(large, &large_buffers), OK);
+  ASSERT_EQ(allocator->AllocateBuffers(large, &other_buffers), OK);
+
+  // small is freed first, so it is evicted when the budget is exceeded.
+  allocator->FreeBuffers(&small_buffers);
+  allocator->FreeBuffers(&large_buffers);
+  allocator->FreeBuffers(&other_buffers);
+
+  auto stats = allocator->GetStats();
+  EXPECT_EQ(stats.eviction_count, 1u);
+  EXPECT_EQ(stats.cached_buffer_count, 2u);
+  EXPECT_EQ(stats.cached_bytes, 2 * large_bytes);
+  EXPECT_EQ(heap_allocator->num_frees_, 1u);
+}
+
+TEST(CachingBufferAllocatorTests, ForwardUnknownBuffers) {
+  HeapBufferAllocator* heap_allocator = nullptr;
+  auto allocator = CreateAllocator(/*max_cached_bytes=*/64 << 20,
+                                   &heap_allocator);
+  ASSERT_NE(allocator, nullptr);
+
+  std::vector<buffer_handle_t> buffers;
+  ASSERT_EQ(heap_allocator->AllocateBuffers(GetDescriptor(320, 240, 1),
+                                            &buffers),
+            OK);
+  allocator->FreeBuffers(&buffers);
+  EXPECT_EQ(heap_allocator->num_frees_, 1u);
+  EXPECT_EQ(allocator->GetStats().cached_buffer_count, 0u);
+}
+
+// Measure allocation latency and hit rate of repeated reconfigurations that
+// alternate between two stream configurations.
+TEST(CachingBufferAllocatorTests, ReconfigurationLatency) {
+  static const uint32_t kNumReconfigurations = 50;
+  const std::vector<HalBufferDescriptor> kConfigurations = {
+      GetDescriptor(4032, 3024, /*num_buffers=*/4),
+      GetDescriptor(1920, 1080, /*num_buffers=*/8),
+  };
+
+  auto measure = [&](uint64_t max_cached_bytes) {
+    HeapBufferAllocator* heap_allocator = nullptr;
+    auto allocator = CreateAllocator(max_cached_bytes, &heap_allocator);
+    std::chrono::nanoseconds total_time(0);
+    for (uint32_t i = 0; i < kNumReconfigurations; i++) {
+      std::vector<std::vector<buffer_handle_t>> buffers(kConfigurations.size());
+      auto start = std::chrono::steady_clock::now();
+      for (uint32_t j = 0; j < kConfigurations.size(); j++) {
+        EXPECT_EQ(allocator->AllocateBuffers(kConfigurations[j], &buffers[j]),
+                  OK);
+      }
+      total_time += std::chrono::steady_clock::now() - start;
+      for (auto& stream_buffers : buffers) {
+        allocator->FreeBuffers(&stream_buffers);
+      }
+    }
+
+    auto stats = allocator->GetStats();
+    double hit_rate = static_cast<double>(stats.hit_count) /
+                      (stats.hit_count + stats.miss_count);
+    ALOGI("Cache %" PRIu64 " MB: %.3f ms per configuration, hit rate %.2f",
+          max_cached_bytes >> 20,
+          total_time.count() / 1e6 / kNumReconfigurations, hit_rate);
+    allocator->ReleaseCachedBuffers();
+    return hit_rate;
+  };
+
+  EXPECT_EQ(measure(/*max_cached_bytes=*/0), 0.0);
+  EXPECT_GT(measure(/*max_cached_bytes=*/256 << 20), 0.9);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
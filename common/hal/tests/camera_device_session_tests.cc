@@ -21,6 +21,7 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <thread>
 
 #include "gralloc_buffer_allocator.h"
 #include "mock_device_session_hwl.h"
@@ -488,6 +489,110 @@ TEST_F(CameraDeviceSessionTests, PreviewRequests) {
     EXPECT_EQ(WaitForResult(request, kCaptureTimeoutMs), OK);
   }
 
+  RequestWatchdog::Stats stats = session->GetRequestWatchdogStats();
+  EXPECT_EQ(stats.requests, kNumPreviewRequests);
+  EXPECT_EQ(stats.pending_requests, 0u);
+  EXPECT_EQ(stats.shutter.count, kNumPreviewRequests);
+  EXPECT_EQ(stats.stalls, 0u);
+
+  allocator->FreeBuffers(&preview_buffers);
+}
+
+// A request stuck in the HWL is reported by the request watchdog.
+TEST_F(CameraDeviceSessionTests, StalledHwlRequest) {
+  // Longer than the minimum stall timeout of the watchdog.
+  static constexpr uint32_t kStallTimeoutMs = 5000;
+  static constexpr uint32_t kPollIntervalMs = 50;
+
+  std::unique_ptr<MockDeviceSessionHwl> session_hwl;
+  CreateMockSessionHwlAndCheck(&session_hwl);
+  session_hwl->DelegateCallsToFakeSession();
+
+  // The HWL accepts the request but never returns its shutter or results.
+  EXPECT_CALL(*session_hwl, SubmitRequests(_, _)).WillOnce(Return(OK));
+
+  std::unique_ptr<CameraDeviceSession> session;
+  CreateSessionAndCheck(std::move(session_hwl), &session);
+
+  CameraDeviceSessionCallback session_callback = {
+      .process_capture_result =
+          [&](std::unique_ptr<CaptureResult> result) {
+            ProcessCaptureResult(std::move(result));
+          },
+      .process_batch_capture_result =
+          [&](std::vector<std::unique_ptr<CaptureResult>> results) {
+            ProcessBatchCaptureResult(std::move(results));
+          },
+      .notify = [&](const NotifyMessage& message) { Notify(message); },
+  };
+  ThermalCallback thermal_callback = {
+      .register_thermal_changed_callback =
+          google_camera_hal::RegisterThermalChangedCallbackFunc(
+              [](google_camera_hal::NotifyThrottlingFunc /*notify_throttling*/,
+                 bool /*filter_type*/,
+                 google_camera_hal::TemperatureType /*type*/) {
+                return INVALID_OPERATION;
+              }),
+      .unregister_thermal_changed_callback =
+          google_camera_hal::UnregisterThermalChangedCallbackFunc([]() {}),
+  };
+  session->SetSessionCallback(session_callback, thermal_callback);
+
+  StreamConfiguration preview_config;
+  test_utils::GetPreviewOnlyStreamConfiguration(&preview_config, 640, 480);
+  ConfigureStreamsReturn hal_config;
+  ASSERT_EQ(session->ConfigureStreams(preview_config, /*interfaceV3*/ false,
+                                      &hal_config),
+            OK);
+  ASSERT_EQ(hal_config.hal_streams.size(), static_cast<uint32_t>(1));
+
+  auto allocator = GrallocBufferAllocator::Create();
+  ASSERT_NE(allocator, nullptr);
+  HalBufferDescriptor buffer_descriptor = {
+      .width = preview_config.streams[0].width,
+      .height = preview_config.streams[0].height,
+      .format = hal_config.hal_streams[0].override_format,
+      .producer_flags = hal_config.hal_streams[0].producer_usage |
+                        preview_config.streams[0].usage,
+      .consumer_flags = hal_config.hal_streams[0].consumer_usage,
+      .immediate_num_buffers = 1,
+      .max_num_buffers = 1,
+  };
+  std::vector<buffer_handle_t> preview_buffers;
+  ASSERT_EQ(allocator->AllocateBuffers(buffer_descriptor, &preview_buffers), OK);
+
+  std::unique_ptr<HalCameraMetadata> preview_settings;
+  ASSERT_EQ(session->ConstructDefaultRequestSettings(RequestTemplate::kPreview,
+                                                     &preview_settings),
+            OK);
+  std::vector<CaptureRequest> requests;
+  requests.push_back({
+      .frame_number = 0,
+      .settings = std::move(preview_settings),
+      .output_buffers = {{.stream_id = preview_config.streams[0].id,
+                          .buffer_id = 0,
+                          .buffer = preview_buffers[0]}},
+  });
+
+  ClearResultsAndMessages();
+  uint32_t num_processed_requests = 0;
+  ASSERT_EQ(session->ProcessCaptureRequest(requests, &num_processed_requests),
+            OK);
+  ASSERT_EQ(num_processed_requests, requests.size());
+
+  RequestWatchdog::Stats stats = session->GetRequestWatchdogStats();
+  for (uint32_t waited_ms = 0; stats.stalls == 0 && waited_ms < kStallTimeoutMs;
+       waited_ms += kPollIntervalMs) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kPollIntervalMs));
+    stats = session->GetRequestWatchdogStats();
+  }
+  EXPECT_EQ(stats.stalls, 1u);
+  EXPECT_EQ(stats.requests, 1u);
+  EXPECT_EQ(stats.pending_requests, 1u);
+  EXPECT_EQ(stats.shutter.count, 0u);
+  EXPECT_EQ(WaitForShutter(/*frame_number=*/0, /*timeout_ms=*/0), TIMED_OUT);
+
+  session = nullptr;
   allocator->FreeBuffers(&preview_buffers);
 }
 
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "CharacteristicsCacheTests"
+#include <log/log.h>
+
+#include <characteristics_cache.h>
+#include <gtest/gtest.h>
+#include <inttypes.h>
+
+#include <chrono>
+#include <thread>
+
+namespace android {
+namespace google_camera_hal {
+
+using Query = CharacteristicsCache::Query;
+
+static constexpr int32_t kFpsRange[] = {30, 30};
+
+// Duration of a slow device query.
+static constexpr auto kQueryDuration = std::chrono::milliseconds(20);
+
+static Stream GetStream(int32_t id, uint32_t width, uint32_t height,
+                        android_pixel_format_t format) {
+  Stream stream;
+  stream.id = id;
+  stream.width = width;
+  stream.height = height;
+  stream.format = format;
+  stream.data_space = HAL_DATASPACE_V0_JFIF;
+  return stream;
+}
+
+static StreamConfiguration GetStreamConfiguration(
+    const std::vector<Stream>& streams) {
+  StreamConfiguration stream_config;
+  stream_config.streams = streams;
+  stream_config.operation_mode = StreamConfigurationMode::kNormal;
+  stream_config.session_params = HalCameraMetadata::Create(1, 16);
+  stream_config.session_params->Set(ANDROID_CONTROL_AE_TARGET_FPS_RANGE,
+                                    kFpsRange, 2);
+  return stream_config;
+}
+
+// Query returning a metadata with one entry of value, counting its calls.
+static CharacteristicsCache::QueryFunc GetQuery(int32_t value,
+                                                uint32_t* num_queries) {
+  return [value, num_queries](std::unique_ptr<HalCameraMetadata>* metadata) {
+    (*num_queries)++;
+    *metadata = HalCameraMetadata::Create(1, 16);
+    return (*metadata)->Set(ANDROID_SENSOR_ORIENTATION, &value, 1);
+  };
+}
+
+TEST(CharacteristicsCacheTests, SessionKeyIgnoresStreamOrderAndIds) {
+  Stream preview =
+      GetStream(0, 1920, 1080, HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED);
+  Stream jpeg = GetStream(1, 4032, 3024, HAL_PIXEL_FORMAT_BLOB);
+  auto config = GetStreamConfiguration({preview, jpeg});
+
+  preview.id = 7;
+  jpeg.id = 3;
+  auto other = GetStreamConfiguration({jpeg, preview});
+  other.stream_config_counter = 5;
+  other.log_id = 42;
+  EXPECT_EQ(CharacteristicsCache::GetSessionKey(config),
+            CharacteristicsCache::GetSessionKey(other));
+}
+
+TEST(CharacteristicsCacheTests, SessionKeyDiffers) {
+  Stream preview =
+      GetStream(0, 1920, 1080, HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED);
+  Stream jpeg = GetStream(1, 4032, 3024, HAL_PIXEL_FORMAT_BLOB);
+  auto config = GetStreamConfiguration({preview, jpeg});
+  const std::string key = CharacteristicsCache::GetSessionKey(config);
+
+  auto high_speed = GetStreamConfiguration({preview, jpeg});
+  high_speed.operation_mode = StreamConfigurationMode::kConstrainedHighSpeed;
+  EXPECT_NE(CharacteristicsCache::GetSessionKey(high_speed), key);
+
+  Stream small_jpeg = jpeg;
+  small_jpeg.width = 1920;
+  small_jpeg.height = 1440;
+  EXPECT_NE(CharacteristicsCache::GetSessionKey(
+                GetStreamConfiguration({preview, small_jpeg})),
+            key);
+
+  EXPECT_NE(
+      CharacteristicsCache::GetSessionKey(GetStreamConfiguration({preview})),
+      key);
+
+  auto other_params = GetStreamConfiguration({preview, jpeg});
+  const int32_t fps_range[] = {15, 30};
+  other_params.session_params->Set(ANDROID_CONTROL_AE_TARGET_FPS_RANGE,
+                                   fps_range, 2);
+  EXPECT_NE(CharacteristicsCache::GetSessionKey(other_params), key);
+
+  auto no_params = GetStreamConfiguration({preview, jpeg});
+  no_params.session_params = nullptr;
+  EXPECT_NE(CharacteristicsCache::GetSessionKey(no_params), key);
+}
+
+TEST(CharacteristicsCacheTests, CacheAndInvalidate) {
+  CharacteristicsCache cache;
+  uint32_t num_queries = 0;
+  std::vector<uint8_t> characteristics;
+  std::vector<uint8_t> cached;
+  ASSERT_EQ(cache.GetCharacteristics(GetQuery(90, &num_queries),
+                                     &characteristics),
+            OK);
+  ASSERT_FALSE(characteristics.empty());
+  ASSERT_EQ(cache.GetCharacteristics(GetQuery(90, &num_queries), &cached),
+            OK);
+  EXPECT_EQ(cached, characteristics);
+  EXPECT_EQ(num_queries, 1u);
+
+  // Physical cameras are cached by ID, session characteristics by key.
+  uint32_t num_physical_queries = 0;
+  for (uint32_t id : {2, 3, 2, 3}) {
+    ASSERT_EQ(cache.GetPhysicalCharacteristics(
+                  id, GetQuery(id, &num_physical_queries), &cached),
+              OK);
+  }
+  EXPECT_EQ(num_physical_queries, 2u);
+
+  uint32_t num_session_queries = 0;
+  Stream preview =
+      GetStream(0, 1920, 1080, HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED);
+  Stream jpeg = GetStream(1, 4032, 3024, HAL_PIXEL_FORMAT_BLOB);
+  ASSERT_EQ(cache.GetSessionCharacteristics(
+                GetStreamConfiguration({preview, jpeg}),
+                GetQuery(0, &num_session_queries), &cached),
+            OK);
+  jpeg.id = 0;
+  preview.id = 1;
+  ASSERT_EQ(cache.GetSessionCharacteristics(
+                GetStreamConfiguration({jpeg, preview}),
+                GetQuery(0, &num_session_queries), &cached),
+            OK);
+  EXPECT_EQ(num_session_queries, 1u);
+
+  // Everything is queried again after the device state changed.
+  cache.Invalidate();
+  ASSERT_EQ(cache.GetCharacteristics(GetQuery(270, &num_queries), &cached),
+            OK);
+  EXPECT_NE(cached, characteristics);
+  ASSERT_EQ(cache.GetPhysicalCharacteristics(
+                2, GetQuery(2, &num_physical_queries), &cached),
+            OK);
+  ASSERT_EQ(cache.GetSessionCharacteristics(
+                GetStreamConfiguration({preview, jpeg}),
+                GetQuery(0, &num_session_queries), &cached),
+            OK);
+  EXPECT_EQ(num_queries, 2u);
+  EXPECT_EQ(num_physical_queries, 3u);
+  EXPECT_EQ(num_session_queries, 2u);
+
+  auto stats = cache.GetStats(Query::kPhysicalCharacteristics);
+  EXPECT_EQ(stats.hits, 2u);
+  EXPECT_EQ(stats.misses, 3u);
+}
+
+TEST(CharacteristicsCacheTests, EvictOldestSessions) {
+  CharacteristicsCache cache;
+  uint32_t num_queries = 0;
+  std::vector<uint8_t> characteristics;
+  for (uint32_t i = 0; i <= CharacteristicsCache::kMaxEntries; i++) {
+    auto config = GetStreamConfiguration(
+        {GetStream(0, 640 + i * 16, 480, HAL_PIXEL_FORMAT_BLOB)});
+    ASSERT_EQ(cache.GetSessionCharacteristics(
+                  config, GetQuery(0, &num_queries), &characteristics),
+              OK);
+  }
+
+  // The first configuration was dropped, the last one is still cached.
+  auto last = GetStreamConfiguration(
+      {GetStream(0, 640 + CharacteristicsCache::kMaxEntries * 16, 480,
+                 HAL_PIXEL_FORMAT_BLOB)});
+  ASSERT_EQ(cache.GetSessionCharacteristics(last, GetQuery(0, &num_queries),
+                                            &characteristics),
+            OK);
+  EXPECT_EQ(num_queries, CharacteristicsCache::kMaxEntries + 1);
+  auto first =
+      GetStreamConfiguration({GetStream(0, 640, 480, HAL_PIXEL_FORMAT_BLOB)});
+  ASSERT_EQ(cache.GetSessionCharacteristics(first, GetQuery(0, &num_queries),
+                                            &characteristics),
+            OK);
+  EXPECT_EQ(num_queries, CharacteristicsCache::kMaxEntries + 2);
+}
+
+TEST(CharacteristicsCacheTests, InvalidateDuringQuery) {
+  CharacteristicsCache cache;
+  uint32_t num_queries = 0;
+  std::vector<uint8_t> characteristics;
+
+  // The cache is not locked during the query, and a result that may be stale
+  // is returned but not cached.
+  auto query = GetQuery(90, &num_queries);
+  ASSERT_EQ(cache.GetCharacteristics(
+                [&cache, &query](std::unique_ptr<HalCameraMetadata>* metadata) {
+                  cache.Invalidate();
+                  return query(metadata);
+                },
+                &characteristics),
+            OK);
+  EXPECT_FALSE(characteristics.empty());
+  ASSERT_EQ(cache.GetCharacteristics(query, &characteristics), OK);
+  EXPECT_EQ(num_queries, 2u);
+  ASSERT_EQ(cache.GetCharacteristics(query, &characteristics), OK);
+  EXPECT_EQ(num_queries, 2u);
+}
+
+TEST(CharacteristicsCacheTests, FailedQueryNotCached) {
+  CharacteristicsCache cache;
+  std::vector<uint8_t> characteristics;
+  EXPECT_NE(cache.GetCharacteristics(
+                [](std::unique_ptr<HalCameraMetadata>*) { return NO_INIT; },
+                &characteristics),
+            OK);
+  EXPECT_NE(cache.GetCharacteristics(
+                [](std::unique_ptr<HalCameraMetadata>*) { return OK; },
+                &characteristics),
+            OK);
+
+  uint32_t num_queries = 0;
+  ASSERT_EQ(cache.GetCharacteristics(GetQuery(90, &num_queries),
+                                     &characteristics),
+            OK);
+  EXPECT_EQ(num_queries, 1u);
+  EXPECT_EQ(cache.GetStats(Query::kCharacteristics).misses, 1u);
+}
+
+TEST(CharacteristicsCacheTests, QueryLatency) {
+  constexpr uint32_t kNumQueries = 10;
+  CharacteristicsCache cache;
+  uint32_t num_queries = 0;
+  auto query = GetQuery(90, &num_queries);
+  auto slow_query = [&query](std::unique_ptr<HalCameraMetadata>* metadata) {
+    std::this_thread::sleep_for(kQueryDuration);
+    return query(metadata);
+  };
+
+  std::vector<uint8_t> characteristics;
+  for (uint32_t i = 0; i < kNumQueries; i++) {
+    ASSERT_EQ(cache.GetCharacteristics(slow_query, &characteristics), OK);
+  }
+  EXPECT_EQ(num_queries, 1u);
+
+  auto stats = cache.GetStats(Query::kCharacteristics);
+  ASSERT_EQ(stats.misses, 1u);
+  ASSERT_EQ(stats.hits, kNumQueries - 1);
+  nsecs_t miss_latency = stats.miss_duration;
+  nsecs_t hit_latency = stats.hit_duration / (nsecs_t)stats.hits;
+  ALOGI("%s: miss %" PRId64 " us, hit %" PRId64 " us", __FUNCTION__,
+        ns2us(miss_latency), ns2us(hit_latency));
+  EXPECT_GE(miss_latency, std::chrono::nanoseconds(kQueryDuration).count());
+  EXPECT_LT(hit_latency * 100, miss_latency);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
@@ -0,0 +1,528 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "FaultInjectionDeviceSessionHwl"
+#include "fault_injection_device_session_hwl.h"
+
+#include <log/log.h>
+
+#include <set>
+
+namespace android {
+namespace google_camera_hal {
+
+std::unique_ptr<FaultInjectionDeviceSessionHwl>
+FaultInjectionDeviceSessionHwl::Create(
+    std::unique_ptr<CameraDeviceSessionHwl> device_session_hwl,
+    const Config& config) {
+  if (device_session_hwl == nullptr) {
+    ALOGE("%s: device_session_hwl is nullptr.", __FUNCTION__);
+    return nullptr;
+  }
+
+  for (float probability : config.probabilities) {
+    if (probability < 0 || probability > 1) {
+      ALOGE("%s: Invalid fault probability %f.", __FUNCTION__, probability);
+      return nullptr;
+    }
+  }
+
+  return std::unique_ptr<FaultInjectionDeviceSessionHwl>(
+      new FaultInjectionDeviceSessionHwl(std::move(device_session_hwl),
+                                         config));
+}
+
+FaultInjectionDeviceSessionHwl::FaultInjectionDeviceSessionHwl(
+    std::unique_ptr<CameraDeviceSessionHwl> device_session_hwl,
+    const Config& config)
+    : device_session_hwl_(std::move(device_session_hwl)), config_(config) {
+  delay_thread_ = std::thread([this] { DelayThreadLoop(); });
+}
+
+FaultInjectionDeviceSessionHwl::~FaultInjectionDeviceSessionHwl() {
+  {
+    std::lock_guard<std::mutex> lock(delay_lock_);
+    delay_thread_exiting_ = true;
+  }
+  delay_condition_.notify_one();
+  if (delay_thread_.joinable()) {
+    delay_thread_.join();
+  }
+}
+
+bool FaultInjectionDeviceSessionHwl::IsFaultScheduled(
+    Fault fault, uint32_t frame_number) const {
+  float probability = config_.probabilities[static_cast<uint32_t>(fault)];
+  if (probability <= 0) {
+    return false;
+  }
+
+  // SplitMix64 of the seed, the fault and the frame number.
+  uint64_t x = config_.seed ^
+               (static_cast<uint64_t>(fault) + 1) * 0x9e3779b97f4a7c15ull ^
+               static_cast<uint64_t>(frame_number) * 0xc2b2ae3d27d4eb4full;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  // Uniform in [0, 1) from the top 53 bits.
+  return static_cast<double>(x >> 11) * 0x1.0p-53 < probability;
+}
+
+FaultInjectionDeviceSessionHwl::Stats
+FaultInjectionDeviceSessionHwl::GetStats() {
+  Stats stats;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stats = stats_;
+    stats.held_results = held_results_.size();
+  }
+  std::lock_guard<std::mutex> lock(delay_lock_);
+  stats.delayed_messages = delayed_messages_.size();
+  return stats;
+}
+
+const char* FaultInjectionDeviceSessionHwl::GetFaultName(Fault fault) {
+  switch (fault) {
+    case Fault::kFailSubmit:
+      return "fail submit";
+    case Fault::kDropResult:
+      return "drop result";
+    case Fault::kDelayShutter:
+      return "delay shutter";
+    case Fault::kBufferError:
+      return "buffer error";
+    case Fault::kReorderPartials:
+      return "reorder partials";
+    case Fault::kFailBufferRequest:
+      return "fail buffer request";
+    default:
+      return "unknown";
+  }
+}
+
+void FaultInjectionDeviceSessionHwl::CountFault(Fault fault) {
+  std::lock_guard<std::mutex> lock(lock_);
+  stats_.injected[static_cast<uint32_t>(fault)]++;
+}
+
+// Send a result with the single result callback if the pipeline has one, or
+// with the batch callback.
+static void SendResult(const HwlPipelineCallback& callback,
+                       std::unique_ptr<HwlPipelineResult> result) {
+  if (callback.process_pipeline_result != nullptr) {
+    callback.process_pipeline_result(std::move(result));
+  } else if (callback.process_pipeline_batch_result != nullptr) {
+    std::vector<std::unique_ptr<HwlPipelineResult>> results;
+    results.push_back(std::move(result));
+    callback.process_pipeline_batch_result(std::move(results));
+  }
+}
+
+std::unique_ptr<HwlPipelineResult>
+FaultInjectionDeviceSessionHwl::InjectResultFaults(
+    const HwlPipelineCallback& callback,
+    std::unique_ptr<HwlPipelineResult> result) {
+  if (result == nullptr) {
+    return nullptr;
+  }
+
+  uint32_t frame_number = result->frame_number;
+  if (IsFaultScheduled(Fault::kDropResult, frame_number)) {
+    CountFault(Fault::kDropResult);
+    std::lock_guard<std::mutex> lock(lock_);
+    held_results_.emplace_back(callback, std::move(result));
+    return nullptr;
+  }
+
+  if (IsFaultScheduled(Fault::kBufferError, frame_number)) {
+    bool injected = false;
+    for (auto& buffer : result->output_buffers) {
+      if (buffer.status != BufferStatus::kOk) {
+        continue;
+      }
+      buffer.status = BufferStatus::kError;
+      NotifyMessage message = {.type = MessageType::kError};
+      message.message.error.frame_number = frame_number;
+      message.message.error.error_stream_id = buffer.stream_id;
+      message.message.error.error_code = ErrorCode::kErrorBuffer;
+      callback.notify(result->pipeline_id, message);
+      injected = true;
+    }
+    if (injected) {
+      CountFault(Fault::kBufferError);
+    }
+  }
+
+  if (result->result_metadata != nullptr &&
+      IsFaultScheduled(Fault::kReorderPartials, frame_number)) {
+    CountFault(Fault::kReorderPartials);
+    // std::function must be copyable, so share the split off partial result.
+    auto partial = std::make_shared<HwlPipelineResult>();
+    partial->camera_id = result->camera_id;
+    partial->pipeline_id = result->pipeline_id;
+    partial->frame_number = frame_number;
+    partial->result_metadata = std::move(result->result_metadata);
+    partial->physical_camera_results =
+        std::move(result->physical_camera_results);
+    partial->partial_result = result->partial_result;
+    result->physical_camera_results.clear();
+    result->partial_result = 0;
+
+    DelayMessage(config_.reorder_delay_ms,
+                 {.frame_number = frame_number, .send = [callback, partial]() {
+                    SendResult(callback, std::make_unique<HwlPipelineResult>(
+                                             std::move(*partial)));
+                  }});
+
+    if (result->output_buffers.empty() && result->input_buffers.empty()) {
+      return nullptr;
+    }
+  }
+
+  return result;
+}
+
+void FaultInjectionDeviceSessionHwl::InjectNotifyFaults(
+    const HwlPipelineCallback& callback, uint32_t pipeline_id,
+    const NotifyMessage& message) {
+  if (message.type == MessageType::kShutter &&
+      IsFaultScheduled(Fault::kDelayShutter,
+                       message.message.shutter.frame_number)) {
+    CountFault(Fault::kDelayShutter);
+    DelayMessage(config_.shutter_delay_ms,
+                 {.frame_number = message.message.shutter.frame_number,
+                  .send = [callback, pipeline_id, message]() {
+                    callback.notify(pipeline_id, message);
+                  }});
+    return;
+  }
+
+  callback.notify(pipeline_id, message);
+}
+
+void FaultInjectionDeviceSessionHwl::DelayMessage(uint32_t delay_ms,
+                                                  DelayedMessage message) {
+  {
+    std::lock_guard<std::mutex> lock(delay_lock_);
+    delayed_messages_.emplace(
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(delay_ms),
+        std::move(message));
+  }
+  delay_condition_.notify_one();
+}
+
+void FaultInjectionDeviceSessionHwl::DelayThreadLoop() {
+  std::unique_lock<std::mutex> lock(delay_lock_);
+  while (!delay_thread_exiting_) {
+    if (delayed_messages_.empty()) {
+      delay_condition_.wait(lock);
+      continue;
+    }
+
+    auto send_time = delayed_messages_.begin()->first;
+    if (std::chrono::steady_clock::now() < send_time) {
+      delay_condition_.wait_until(lock, send_time);
+      continue;
+    }
+
+    // send_lock_ is taken before delay_lock_, like in Flush().
+    lock.unlock();
+    {
+      std::lock_guard<std::mutex> send_lock(send_lock_);
+      DelayedMessage message;
+      {
+        std::lock_guard<std::mutex> delay_lock(delay_lock_);
+        // Flush() may have sent the message meanwhile.
+        if (!delayed_messages_.empty() &&
+            delayed_messages_.begin()->first <= send_time) {
+          message = std::move(delayed_messages_.begin()->second);
+          delayed_messages_.erase(delayed_messages_.begin());
+        }
+      }
+      if (message.send != nullptr) {
+        message.send();
+      }
+    }
+    lock.lock();
+  }
+}
+
+void FaultInjectionDeviceSessionHwl::SendDelayedMessages() {
+  std::multimap<std::chrono::steady_clock::time_point, DelayedMessage>
+      messages;
+  {
+    std::lock_guard<std::mutex> lock(delay_lock_);
+    messages.swap(delayed_messages_);
+  }
+
+  for (auto& [send_time, message] : messages) {
+    ALOGV("%s: Sending a delayed message of frame %u", __FUNCTION__,
+          message.frame_number);
+    message.send();
+  }
+}
+
+void FaultInjectionDeviceSessionHwl::SendHeldResultsAsErrors() {
+  std::vector<
+      std::pair<HwlPipelineCallback, std::unique_ptr<HwlPipelineResult>>>
+      held_results;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    held_results.swap(held_results_);
+  }
+
+  // Frames whose metadata error was sent.
+  std::set<uint32_t> metadata_error_frames;
+  for (auto& [callback, result] : held_results) {
+    uint32_t frame_number = result->frame_number;
+    NotifyMessage message = {.type = MessageType::kError};
+    message.message.error.frame_number = frame_number;
+
+    if (result->result_metadata != nullptr &&
+        metadata_error_frames.insert(frame_number).second) {
+      message.message.error.error_stream_id = -1;
+      message.message.error.error_code = ErrorCode::kErrorResult;
+      callback.notify(result->pipeline_id, message);
+    }
+
+    for (auto& buffer : result->output_buffers) {
+      buffer.status = BufferStatus::kError;
+      message.message.error.error_stream_id = buffer.stream_id;
+      message.message.error.error_code = ErrorCode::kErrorBuffer;
+      callback.notify(result->pipeline_id, message);
+    }
+
+    if (result->output_buffers.empty() && result->input_buffers.empty()) {
+      continue;
+    }
+
+    result->result_metadata = nullptr;
+    result->physical_camera_results.clear();
+    result->partial_result = 0;
+    SendResult(callback, std::move(result));
+  }
+}
+
+status_t FaultInjectionDeviceSessionHwl::ConstructDefaultRequestSettings(
+    RequestTemplate type,
+    std::unique_ptr<HalCameraMetadata>* default_settings) {
+  return device_session_hwl_->ConstructDefaultRequestSettings(type,
+                                                              default_settings);
+}
+
+status_t FaultInjectionDeviceSessionHwl::PrepareConfigureStreams(
+    const StreamConfiguration& request_config) {
+  device_session_hwl_->setConfigureStreamsV2(configure_streams_v2());
+  return device_session_hwl_->PrepareConfigureStreams(request_config);
+}
+
+status_t FaultInjectionDeviceSessionHwl::ConfigurePipeline(
+    uint32_t camera_id, HwlPipelineCallback hwl_pipeline_callback,
+    const StreamConfiguration& request_config,
+    const StreamConfiguration& overall_config, uint32_t* pipeline_id) {
+  HwlPipelineCallback callback;
+  if (hwl_pipeline_callback.process_pipeline_result != nullptr) {
+    callback.process_pipeline_result =
+        [this, hwl_pipeline_callback](
+            std::unique_ptr<HwlPipelineResult> result) {
+          result =
+              InjectResultFaults(hwl_pipeline_callback, std::move(result));
+          if (result != nullptr) {
+            hwl_pipeline_callback.process_pipeline_result(std::move(result));
+          }
+        };
+  }
+
+  if (hwl_pipeline_callback.process_pipeline_batch_result != nullptr) {
+    callback.process_pipeline_batch_result =
+        [this, hwl_pipeline_callback](
+            std::vector<std::unique_ptr<HwlPipelineResult>> results) {
+          std::vector<std::unique_ptr<HwlPipelineResult>> sent_results;
+          for (auto& result : results) {
+            result =
+                InjectResultFaults(hwl_pipeline_callback, std::move(result));
+            if (result != nullptr) {
+              sent_results.push_back(std::move(result));
+            }
+          }
+          if (!sent_results.empty()) {
+            hwl_pipeline_callback.process_pipeline_batch_result(
+                std::move(sent_results));
+          }
+        };
+  }
+
+  callback.notify = [this, hwl_pipeline_callback](
+                        uint32_t pipeline_id, const NotifyMessage& message) {
+    InjectNotifyFaults(hwl_pipeline_callback, pipeline_id, message);
+  };
+
+  device_session_hwl_->setConfigureStreamsV2(configure_streams_v2());
+  return device_session_hwl_->ConfigurePipeline(
+      camera_id, callback, request_config, overall_config, pipeline_id);
+}
+
+status_t FaultInjectionDeviceSessionHwl::BuildPipelines() {
+  return device_session_hwl_->BuildPipelines();
+}
+
+status_t FaultInjectionDeviceSessionHwl::PreparePipeline(
+    uint32_t pipeline_id, uint32_t frame_number) {
+  return device_session_hwl_->PreparePipeline(pipeline_id, frame_number);
+}
+
+status_t FaultInjectionDeviceSessionHwl::GetRequiredIntputStreams(
+    const StreamConfiguration& overall_config,
+    HwlOfflinePipelineRole pipeline_role, std::vector<Stream>* streams) {
+  return device_session_hwl_->GetRequiredIntputStreams(overall_config,
+                                                       pipeline_role, streams);
+}
+
+status_t FaultInjectionDeviceSessionHwl::GetConfiguredHalStream(
+    uint32_t pipeline_id, std::vector<HalStream>* hal_streams) const {
+  return device_session_hwl_->GetConfiguredHalStream(pipeline_id, hal_streams);
+}
+
+void FaultInjectionDeviceSessionHwl::DestroyPipelines() {
+  device_session_hwl_->DestroyPipelines();
+}
+
+status_t FaultInjectionDeviceSessionHwl::SubmitRequests(
+    uint32_t frame_number, std::vector<HwlPipelineRequest>& requests) {
+  if (IsFaultScheduled(Fault::kFailSubmit, frame_number)) {
+    CountFault(Fault::kFailSubmit);
+    ALOGI("%s: Failing the requests of frame %u", __FUNCTION__, frame_number);
+    return UNKNOWN_ERROR;
+  }
+
+  return device_session_hwl_->SubmitRequests(frame_number, requests);
+}
+
+status_t FaultInjectionDeviceSessionHwl::Flush() {
+  status_t res = device_session_hwl_->Flush();
+
+  std::lock_guard<std::mutex> lock(send_lock_);
+  SendDelayedMessages();
+  SendHeldResultsAsErrors();
+  return res;
+}
+
+void FaultInjectionDeviceSessionHwl::RepeatingRequestEnd(
+    int32_t frame_number, const std::vector<int32_t>& stream_ids) {
+  device_session_hwl_->RepeatingRequestEnd(frame_number, stream_ids);
+}
+
+uint32_t FaultInjectionDeviceSessionHwl::GetCameraId() const {
+  return device_session_hwl_->GetCameraId();
+}
+
+std::vector<uint32_t> FaultInjectionDeviceSessionHwl::GetPhysicalCameraIds()
+    const {
+  return device_session_hwl_->GetPhysicalCameraIds();
+}
+
+status_t FaultInjectionDeviceSessionHwl::GetCameraCharacteristics(
+    std::unique_ptr<HalCameraMetadata>* characteristics) const {
+  return device_session_hwl_->GetCameraCharacteristics(characteristics);
+}
+
+status_t FaultInjectionDeviceSessionHwl::GetPhysicalCameraCharacteristics(
+    uint32_t physical_camera_id,
+    std::unique_ptr<HalCameraMetadata>* characteristics) const {
+  return device_session_hwl_->GetPhysicalCameraCharacteristics(
+      physical_camera_id, characteristics);
+}
+
+status_t FaultInjectionDeviceSessionHwl::SetSessionData(SessionDataKey key,
+                                                        void* value) {
+  return device_session_hwl_->SetSessionData(key, value);
+}
+
+status_t FaultInjectionDeviceSessionHwl::GetSessionData(SessionDataKey key,
+                                                        void** value) const {
+  return device_session_hwl_->GetSessionData(key, value);
+}
+
+void FaultInjectionDeviceSessionHwl::SetSessionCallback(
+    const HwlSessionCallback& hwl_session_callback) {
+  HwlSessionCallback callback = hwl_session_callback;
+  if (hwl_session_callback.request_stream_buffers != nullptr) {
+    callback.request_stream_buffers =
+        [this, request_stream_buffers =
+                   hwl_session_callback.request_stream_buffers](
+            uint32_t stream_id, uint32_t num_buffers,
+            std::vector<StreamBuffer>* buffers, uint32_t frame_number) {
+          if (IsFaultScheduled(Fault::kFailBufferRequest, frame_number)) {
+            CountFault(Fault::kFailBufferRequest);
+            return static_cast<status_t>(UNKNOWN_ERROR);
+          }
+          return request_stream_buffers(stream_id, num_buffers, buffers,
+                                        frame_number);
+        };
+  }
+
+  device_session_hwl_->SetSessionCallback(callback);
+}
+
+status_t FaultInjectionDeviceSessionHwl::FilterResultMetadata(
+    HalCameraMetadata* metadata) const {
+  return device_session_hwl_->FilterResultMetadata(metadata);
+}
+
+std::unique_ptr<IMulticamCoordinatorHwl>
+FaultInjectionDeviceSessionHwl::CreateMulticamCoordinatorHwl() {
+  return device_session_hwl_->CreateMulticamCoordinatorHwl();
+}
+
+status_t FaultInjectionDeviceSessionHwl::IsReconfigurationRequired(
+    const HalCameraMetadata* old_session, const HalCameraMetadata* new_session,
+    bool* reconfiguration_required) const {
+  return device_session_hwl_->IsReconfigurationRequired(
+      old_session, new_session, reconfiguration_required);
+}
+
+std::unique_ptr<ZoomRatioMapperHwl>
+FaultInjectionDeviceSessionHwl::GetZoomRatioMapperHwl() {
+  return device_session_hwl_->GetZoomRatioMapperHwl();
+}
+
+std::set<int32_t> FaultInjectionDeviceSessionHwl::GetHalBufferManagedStreams(
+    const StreamConfiguration& config) {
+  return device_session_hwl_->GetHalBufferManagedStreams(config);
+}
+
+bool FaultInjectionDeviceSessionHwl::CanStreamSimultaneously(
+    uint32_t physical_camera_id_1, uint32_t physical_camera_id_2) const {
+  return device_session_hwl_->CanStreamSimultaneously(physical_camera_id_1,
+                                                      physical_camera_id_2);
+}
+
+int FaultInjectionDeviceSessionHwl::GetMaxSupportedConcurrentCameras() const {
+  return device_session_hwl_->GetMaxSupportedConcurrentCameras();
+}
+
+std::unique_ptr<google::camera_common::Profiler>
+FaultInjectionDeviceSessionHwl::GetProfiler(uint32_t camera_id, int option) {
+  return device_session_hwl_->GetProfiler(camera_id, option);
+}
+
+void FaultInjectionDeviceSessionHwl::RemoveCachedBuffers(
+    const native_handle_t* handle) {
+  device_session_hwl_->RemoveCachedBuffers(handle);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_TESTS_FAULT_INJECTION_DEVICE_SESSION_HWL_H_
+#define HARDWARE_GOOGLE_CAMERA_HAL_TESTS_FAULT_INJECTION_DEVICE_SESSION_HWL_H_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "camera_device_session_hwl.h"
+
+namespace android {
+namespace google_camera_hal {
+
+// FaultInjectionDeviceSessionHwl wraps a CameraDeviceSessionHwl and injects
+// faults into the requests and results passing through it.
+//
+// Whether a fault hits a frame only depends on the seed, the fault and the
+// frame number, so a schedule replays identically regardless of thread
+// timing. Faults behave as follows:
+//   kFailSubmit: SubmitRequests() fails without reaching the wrapped HWL.
+//   kDropResult: the results of the frame are held back until Flush(), which
+//     returns them as a metadata error and buffers in error.
+//   kDelayShutter: the shutter is sent shutter_delay_ms late.
+//   kBufferError: output buffers are returned in error, with buffer errors.
+//   kReorderPartials: the metadata of a result is split off and sent
+//     reorder_delay_ms late, after the buffers and later results.
+//   kFailBufferRequest: requesting stream buffers for the frame fails.
+// Flush() sends everything delayed or held back right away.
+class FaultInjectionDeviceSessionHwl : public CameraDeviceSessionHwl {
+ public:
+  enum class Fault : uint32_t {
+    kFailSubmit = 0,
+    kDropResult,
+    kDelayShutter,
+    kBufferError,
+    kReorderPartials,
+    kFailBufferRequest,
+    kNumFaults,
+  };
+
+  static constexpr uint32_t kNumFaults =
+      static_cast<uint32_t>(Fault::kNumFaults);
+
+  struct Config {
+    uint64_t seed = 0;
+    // Probability of each fault per frame, indexed by Fault.
+    std::array<float, kNumFaults> probabilities = {};
+    uint32_t shutter_delay_ms = 50;
+    uint32_t reorder_delay_ms = 10;
+  };
+
+  struct Stats {
+    // Number of injected faults, indexed by Fault.
+    std::array<uint64_t, kNumFaults> injected = {};
+    // Number of results held back until Flush().
+    uint32_t held_results = 0;
+    // Number of shutters and partial results waiting to be sent.
+    uint32_t delayed_messages = 0;
+  };
+
+  static std::unique_ptr<FaultInjectionDeviceSessionHwl> Create(
+      std::unique_ptr<CameraDeviceSessionHwl> device_session_hwl,
+      const Config& config);
+
+  virtual ~FaultInjectionDeviceSessionHwl();
+
+  // Whether the schedule injects fault into frame_number.
+  bool IsFaultScheduled(Fault fault, uint32_t frame_number) const;
+
+  Stats GetStats();
+
+  static const char* GetFaultName(Fault fault);
+
+  // Override functions in CameraDeviceSessionHwl.
+  status_t ConstructDefaultRequestSettings(
+      RequestTemplate type,
+      std::unique_ptr<HalCameraMetadata>* default_settings) override;
+
+  status_t PrepareConfigureStreams(
+      const StreamConfiguration& request_config) override;
+
+  status_t ConfigurePipeline(uint32_t camera_id,
+                             HwlPipelineCallback hwl_pipeline_callback,
+                             const StreamConfiguration& request_config,
+                             const StreamConfiguration& overall_config,
+                             uint32_t* pipeline_id) override;
+
+  status_t BuildPipelines() override;
+
+  status_t PreparePipeline(uint32_t pipeline_id,
+                           uint32_t frame_number) override;
+
+  status_t GetRequiredIntputStreams(const StreamConfiguration& overall_config,
+                                    HwlOfflinePipelineRole pipeline_role,
+                                    std::vector<Stream>* streams) override;
+
+  status_t GetConfiguredHalStream(
+      uint32_t pipeline_id, std::vector<HalStream>* hal_streams) const override;
+
+  void DestroyPipelines() override;
+
+  status_t SubmitRequests(uint32_t frame_number,
+                          std::vector<HwlPipelineRequest>& requests) override;
+
+  status_t Flush() override;
+
+  void RepeatingRequestEnd(int32_t frame_number,
+                           const std::vector<int32_t>& stream_ids) override;
+
+  uint32_t GetCameraId() const override;
+
+  std::vector<uint32_t> GetPhysicalCameraIds() const override;
+
+  status_t GetCameraCharacteristics(
+      std::unique_ptr<HalCameraMetadata>* characteristics) const override;
+
+  status_t GetPhysicalCameraCharacteristics(
+      uint32_t physical_camera_id,
+      std::unique_ptr<HalCameraMetadata>* characteristics) const override;
+
+  status_t SetSessionData(SessionDataKey key, void* value) override;
+
+  status_t GetSessionData(SessionDataKey key, void** value) const override;
+
+  void SetSessionCallback(
+      const HwlSessionCallback& hwl_session_callback) override;
+
+  status_t FilterResultMetadata(HalCameraMetadata* metadata) const override;
+
+  std::unique_ptr<IMulticamCoordinatorHwl> CreateMulticamCoordinatorHwl()
+      override;
+
+  status_t IsReconfigurationRequired(
+      const HalCameraMetadata* old_session,
+      const HalCameraMetadata* new_session,
+      bool* reconfiguration_required) const override;
+
+  std::unique_ptr<ZoomRatioMapperHwl> GetZoomRatioMapperHwl() override;
+
+  std::set<int32_t> GetHalBufferManagedStreams(
+      const StreamConfiguration& config) override;
+
+  bool CanStreamSimultaneously(uint32_t physical_camera_id_1,
+                               uint32_t physical_camera_id_2) const override;
+
+  int GetMaxSupportedConcurrentCameras() const override;
+
+  std::unique_ptr<google::camera_common::Profiler> GetProfiler(
+      uint32_t camera_id, int option) override;
+
+  void RemoveCachedBuffers(const native_handle_t* handle) override;
+  // End of override functions in CameraDeviceSessionHwl.
+
+ protected:
+  FaultInjectionDeviceSessionHwl(
+      std::unique_ptr<CameraDeviceSessionHwl> device_session_hwl,
+      const Config& config);
+
+ private:
+  // A shutter or partial result sent late.
+  struct DelayedMessage {
+    uint32_t frame_number = 0;
+    std::function<void()> send;
+  };
+
+  // Inject the faults into a result of the pipeline with callback. Returns
+  // the result to send right away, or nullptr if it was held back.
+  std::unique_ptr<HwlPipelineResult> InjectResultFaults(
+      const HwlPipelineCallback& callback,
+      std::unique_ptr<HwlPipelineResult> result);
+
+  void InjectNotifyFaults(const HwlPipelineCallback& callback,
+                          uint32_t pipeline_id, const NotifyMessage& message);
+
+  // Count an injected fault.
+  void CountFault(Fault fault);
+
+  // Send a message after delay_ms from the delay thread.
+  void DelayMessage(uint32_t delay_ms, DelayedMessage message);
+
+  // Send all delayed messages right away.
+  void SendDelayedMessages();
+
+  // Send the held back results as errors.
+  void SendHeldResultsAsErrors();
+
+  void DelayThreadLoop();
+
+  const std::unique_ptr<CameraDeviceSessionHwl> device_session_hwl_;
+  const Config config_;
+
+  std::mutex lock_;
+  Stats stats_;  // Protected by lock_.
+  // Held back results and the callback of their pipeline. Protected by lock_.
+  std::vector<
+      std::pair<HwlPipelineCallback, std::unique_ptr<HwlPipelineResult>>>
+      held_results_;
+
+  // Serializes sending delayed messages and held back results, so none of
+  // them is sent after Flush() returns.
+  std::mutex send_lock_;
+
+  std::mutex delay_lock_;
+  std::condition_variable delay_condition_;
+  // Maps from the send time to a delayed message. Protected by delay_lock_.
+  std::multimap<std::chrono::steady_clock::time_point, DelayedMessage>
+      delayed_messages_;
+  bool delay_thread_exiting_ = false;  // Protected by delay_lock_.
+  std::thread delay_thread_;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_TESTS_FAULT_INJECTION_DEVICE_SESSION_HWL_H_
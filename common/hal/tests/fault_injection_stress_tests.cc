@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "FaultInjectionStressTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+#include "fault_injection_device_session_hwl.h"
+#include "gralloc_buffer_allocator.h"
+#include "mock_device_session_hwl.h"
+#include "test_utils.h"
+
+namespace android {
+namespace google_camera_hal {
+namespace {
+
+using Fault = FaultInjectionDeviceSessionHwl::Fault;
+using Clock = std::chrono::steady_clock;
+
+// Probability of each fault per frame.
+static constexpr float kFaultProbability = 0.05f;
+
+static double ToMs(Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+TEST(FaultInjectionDeviceSessionHwlTests, Create) {
+  FaultInjectionDeviceSessionHwl::Config config;
+  EXPECT_EQ(FaultInjectionDeviceSessionHwl::Create(nullptr, config), nullptr);
+
+  config.probabilities[static_cast<uint32_t>(Fault::kDropResult)] = 1.5f;
+  EXPECT_EQ(FaultInjectionDeviceSessionHwl::Create(
+                std::make_unique<FakeCameraDeviceSessionHwl>(
+                    /*camera_id=*/3, std::vector<uint32_t>()),
+                config),
+            nullptr);
+}
+
+// The same seed gives the same schedule, with the configured fault rates.
+TEST(FaultInjectionDeviceSessionHwlTests, DeterministicSchedule) {
+  static constexpr uint32_t kNumFrames = 10000;
+  auto create = [](uint64_t seed) {
+    FaultInjectionDeviceSessionHwl::Config config = {.seed = seed};
+    config.probabilities.fill(kFaultProbability);
+    return FaultInjectionDeviceSessionHwl::Create(
+        std::make_unique<FakeCameraDeviceSessionHwl>(/*camera_id=*/3,
+                                                     std::vector<uint32_t>()),
+        config);
+  };
+  auto hwl = create(/*seed=*/1);
+  auto same_seed_hwl = create(/*seed=*/1);
+  auto other_seed_hwl = create(/*seed=*/2);
+  ASSERT_NE(hwl, nullptr);
+  ASSERT_NE(same_seed_hwl, nullptr);
+  ASSERT_NE(other_seed_hwl, nullptr);
+
+  for (uint32_t i = 0; i < FaultInjectionDeviceSessionHwl::kNumFaults; i++) {
+    Fault fault = static_cast<Fault>(i);
+    uint32_t num_scheduled = 0;
+    uint32_t num_different = 0;
+    for (uint32_t frame_number = 0; frame_number < kNumFrames;
+         frame_number++) {
+      bool scheduled = hwl->IsFaultScheduled(fault, frame_number);
+      EXPECT_EQ(same_seed_hwl->IsFaultScheduled(fault, frame_number),
+                scheduled);
+      num_scheduled += scheduled;
+      num_different +=
+          other_seed_hwl->IsFaultScheduled(fault, frame_number) != scheduled;
+    }
+    EXPECT_NEAR(num_scheduled, kNumFrames * kFaultProbability,
+                kNumFrames * kFaultProbability * 0.2f)
+        << FaultInjectionDeviceSessionHwl::GetFaultName(fault);
+    EXPECT_GT(num_different, 0u)
+        << FaultInjectionDeviceSessionHwl::GetFaultName(fault);
+  }
+}
+
+// Runs a preview stream through a CameraDeviceSession on top of a fault
+// injecting HWL, like an app that recycles a few buffers and flushes when a
+// request gets stuck.
+class FaultInjectionStressTests : public ::testing::Test {
+ protected:
+  struct Frame {
+    Clock::time_point submit_time;
+    Clock::time_point complete_time;
+    bool shutter_received = false;
+    bool metadata_received = false;
+    uint32_t pending_buffers = 0;
+    bool complete = false;
+  };
+
+  void ProcessCaptureResult(std::unique_ptr<CaptureResult> result) {
+    ASSERT_NE(result, nullptr);
+    std::lock_guard<std::mutex> lock(callback_lock_);
+    auto frame = frames_.find(result->frame_number);
+    if (frame == frames_.end()) {
+      ADD_FAILURE() << "Unexpected result of frame " << result->frame_number;
+      return;
+    }
+
+    // The fake HWL sends a single partial result.
+    if (result->result_metadata != nullptr && result->partial_result == 1) {
+      frame->second.metadata_received = true;
+    }
+    for (auto& buffer : result->output_buffers) {
+      if (frame->second.pending_buffers == 0) {
+        ADD_FAILURE() << "Unexpected buffer of frame " << result->frame_number;
+        break;
+      }
+      frame->second.pending_buffers--;
+      num_error_buffers_ += buffer.status != BufferStatus::kOk;
+    }
+    UpdateCompleteLocked(&frame->second);
+  }
+
+  void Notify(const NotifyMessage& message) {
+    std::lock_guard<std::mutex> lock(callback_lock_);
+    uint32_t frame_number = message.type == MessageType::kShutter
+                                ? message.message.shutter.frame_number
+                                : message.message.error.frame_number;
+    auto frame = frames_.find(frame_number);
+    if (frame == frames_.end()) {
+      ADD_FAILURE() << "Unexpected message of frame " << frame_number;
+      return;
+    }
+
+    if (message.type == MessageType::kShutter) {
+      frame->second.shutter_received = true;
+    } else {
+      switch (message.message.error.error_code) {
+        case ErrorCode::kErrorRequest:
+        case ErrorCode::kErrorResult:
+          // The shutter may be dropped along with the metadata.
+          frame->second.shutter_received = true;
+          frame->second.metadata_received = true;
+          break;
+        case ErrorCode::kErrorBuffer:
+          break;
+        default:
+          ADD_FAILURE() << "Unexpected error "
+                        << static_cast<uint32_t>(
+                               message.message.error.error_code);
+          break;
+      }
+    }
+    UpdateCompleteLocked(&frame->second);
+  }
+
+  void UpdateCompleteLocked(Frame* frame) {
+    if (!frame->complete && frame->shutter_received &&
+        frame->metadata_received && frame->pending_buffers == 0) {
+      frame->complete = true;
+      frame->complete_time = Clock::now();
+      callback_condition_.notify_all();
+    }
+  }
+
+  // Whether all submitted frames up to frame_number are complete.
+  bool IsCompleteLocked(uint32_t frame_number) {
+    for (auto& [number, frame] : frames_) {
+      if (number > frame_number) {
+        break;
+      }
+      if (!frame.complete) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool WaitForFrames(uint32_t frame_number, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(callback_lock_);
+    return callback_condition_.wait_for(
+        lock, std::chrono::milliseconds(timeout_ms),
+        [&] { return IsCompleteLocked(frame_number); });
+  }
+
+  // Flush the session and wait for all submitted frames. Returns the time
+  // from the flush until the last of them completed.
+  Clock::duration FlushAndWait(CameraDeviceSession* session,
+                               uint32_t last_frame_number) {
+    auto flush_time = Clock::now();
+    EXPECT_EQ(session->Flush(), OK);
+    EXPECT_TRUE(WaitForFrames(last_frame_number, kCaptureTimeoutMs));
+    return Clock::now() - flush_time;
+  }
+
+  static constexpr uint32_t kCaptureTimeoutMs = 3000;
+
+  std::mutex callback_lock_;
+  std::condition_variable callback_condition_;
+  // Maps from frame number to the submitted frame. Protected by
+  // callback_lock_.
+  std::map<uint32_t, Frame> frames_;
+  uint32_t num_error_buffers_ = 0;  // Protected by callback_lock_.
+};
+
+TEST_F(FaultInjectionStressTests, RecoverFromFaults) {
+  static constexpr uint32_t kNumRequests = 300;
+  // Longer than the shutter delay: the request is stuck and needs a flush.
+  static constexpr uint32_t kStuckTimeoutMs = 300;
+
+  FaultInjectionDeviceSessionHwl::Config config = {.seed = 1};
+  config.probabilities.fill(kFaultProbability);
+
+  auto mock_session_hwl = std::make_unique<MockDeviceSessionHwl>();
+  mock_session_hwl->DelegateCallsToFakeSession();
+  auto fault_session_hwl = FaultInjectionDeviceSessionHwl::Create(
+      std::move(mock_session_hwl), config);
+  ASSERT_NE(fault_session_hwl, nullptr);
+  FaultInjectionDeviceSessionHwl* fault_injection = fault_session_hwl.get();
+
+  auto session = CameraDeviceSession::Create(std::move(fault_session_hwl),
+                                             /*external_session_factory=*/{});
+  ASSERT_NE(session, nullptr);
+
+  CameraDeviceSessionCallback session_callback = {
+      .process_capture_result =
+          [&](std::unique_ptr<CaptureResult> result) {
+            ProcessCaptureResult(std::move(result));
+          },
+      .process_batch_capture_result =
+          [&](std::vector<std::unique_ptr<CaptureResult>> results) {
+            for (auto& result : results) {
+              ProcessCaptureResult(std::move(result));
+            }
+          },
+      .notify = [&](const NotifyMessage& message) { Notify(message); },
+  };
+  ThermalCallback thermal_callback = {
+      .register_thermal_changed_callback =
+          google_camera_hal::RegisterThermalChangedCallbackFunc(
+              [](google_camera_hal::NotifyThrottlingFunc /*notify_throttling*/,
+                 bool /*filter_type*/,
+                 google_camera_hal::TemperatureType /*type*/) {
+                return INVALID_OPERATION;
+              }),
+      .unregister_thermal_changed_callback =
+          google_camera_hal::UnregisterThermalChangedCallbackFunc([]() {}),
+  };
+  session->SetSessionCallback(session_callback, thermal_callback);
+
+  StreamConfiguration preview_config;
+  test_utils::GetPreviewOnlyStreamConfiguration(&preview_config, 640, 480);
+  ConfigureStreamsReturn hal_config;
+  ASSERT_EQ(session->ConfigureStreams(preview_config, /*interfaceV3*/ false,
+                                      &hal_config),
+            OK);
+  ASSERT_EQ(hal_config.hal_streams.size(), static_cast<uint32_t>(1));
+
+  // Requests in flight are bounded by the buffers.
+  const uint32_t num_buffers = hal_config.hal_streams[0].max_buffers;
+  auto allocator = GrallocBufferAllocator::Create();
+  ASSERT_NE(allocator, nullptr);
+  HalBufferDescriptor buffer_descriptor = {
+      .width = preview_config.streams[0].width,
+      .height = preview_config.streams[0].height,
+      .format = hal_config.hal_streams[0].override_format,
+      .producer_flags = hal_config.hal_streams[0].producer_usage |
+                        preview_config.streams[0].usage,
+      .consumer_flags = hal_config.hal_streams[0].consumer_usage,
+      .immediate_num_buffers = num_buffers,
+      .max_num_buffers = num_buffers,
+  };
+  std::vector<buffer_handle_t> preview_buffers;
+  ASSERT_EQ(allocator->AllocateBuffers(buffer_descriptor, &preview_buffers),
+            OK);
+
+  std::unique_ptr<HalCameraMetadata> preview_settings;
+  ASSERT_EQ(session->ConstructDefaultRequestSettings(RequestTemplate::kPreview,
+                                                     &preview_settings),
+            OK);
+
+  uint32_t num_rejected = 0;
+  std::vector<Clock::duration> flush_latencies;
+  for (uint32_t frame_number = 0; frame_number < kNumRequests;
+       frame_number++) {
+    // Wait for the buffer of this request to come back, and flush if the
+    // request holding it got stuck.
+    if (frame_number >= num_buffers &&
+        !WaitForFrames(frame_number - num_buffers, kStuckTimeoutMs)) {
+      flush_latencies.push_back(
+          FlushAndWait(session.get(), frame_number - 1));
+    }
+
+    std::vector<CaptureRequest> requests;
+    requests.push_back({
+        .frame_number = frame_number,
+        .settings = HalCameraMetadata::Clone(preview_settings.get()),
+        .output_buffers = {{.stream_id = preview_config.streams[0].id,
+                            .buffer_id = frame_number % num_buffers,
+                            .buffer =
+                                preview_buffers[frame_number % num_buffers]}},
+    });
+    {
+      std::lock_guard<std::mutex> lock(callback_lock_);
+      frames_[frame_number] = {.submit_time = Clock::now(),
+                               .pending_buffers = 1};
+    }
+
+    uint32_t num_processed_requests = 0;
+    if (session->ProcessCaptureRequest(requests, &num_processed_requests) !=
+        OK) {
+      EXPECT_TRUE(fault_injection->IsFaultScheduled(Fault::kFailSubmit,
+                                                    frame_number));
+      std::lock_guard<std::mutex> lock(callback_lock_);
+      frames_.erase(frame_number);
+      num_rejected++;
+    }
+  }
+
+  // Drain the requests in flight.
+  if (!WaitForFrames(kNumRequests - 1, kStuckTimeoutMs)) {
+    flush_latencies.push_back(FlushAndWait(session.get(), kNumRequests - 1));
+  }
+
+  // Report the latency of the requests hit by a fault against the others.
+  Clock::duration clean_total{}, clean_max{}, faulty_total{}, faulty_max{};
+  uint32_t num_clean = 0, num_faulty = 0, leaked_requests = 0,
+           leaked_buffers = 0, error_buffers = 0;
+  {
+    std::lock_guard<std::mutex> lock(callback_lock_);
+    for (auto& [frame_number, frame] : frames_) {
+      if (!frame.complete) {
+        ALOGE("%s: Frame %u never completed", __FUNCTION__, frame_number);
+        leaked_requests++;
+        leaked_buffers += frame.pending_buffers;
+        continue;
+      }
+
+      bool faulty = false;
+      for (uint32_t i = 0; i < FaultInjectionDeviceSessionHwl::kNumFaults;
+           i++) {
+        faulty |= fault_injection->IsFaultScheduled(static_cast<Fault>(i),
+                                                    frame_number);
+      }
+      Clock::duration latency = frame.complete_time - frame.submit_time;
+      if (faulty) {
+        num_faulty++;
+        faulty_total += latency;
+        faulty_max = std::max(faulty_max, latency);
+      } else {
+        num_clean++;
+        clean_total += latency;
+        clean_max = std::max(clean_max, latency);
+      }
+    }
+    error_buffers = num_error_buffers_;
+  }
+
+  FaultInjectionDeviceSessionHwl::Stats fault_stats =
+      fault_injection->GetStats();
+  for (uint32_t i = 0; i < FaultInjectionDeviceSessionHwl::kNumFaults; i++) {
+    ALOGI("%s: Injected %s %" PRIu64 " times", __FUNCTION__,
+          FaultInjectionDeviceSessionHwl::GetFaultName(static_cast<Fault>(i)),
+          fault_stats.injected[i]);
+  }
+  ALOGI("%s: %u clean requests: mean %.2f ms, max %.2f ms", __FUNCTION__,
+        num_clean, num_clean > 0 ? ToMs(clean_total) / num_clean : 0,
+        ToMs(clean_max));
+  ALOGI("%s: %u faulty requests: mean %.2f ms, max %.2f ms", __FUNCTION__,
+        num_faulty, num_faulty > 0 ? ToMs(faulty_total) / num_faulty : 0,
+        ToMs(faulty_max));
+  Clock::duration flush_max{};
+  for (auto& latency : flush_latencies) {
+    flush_max = std::max(flush_max, latency);
+  }
+  ALOGI("%s: %zu flushes recovered in up to %.2f ms", __FUNCTION__,
+        flush_latencies.size(), ToMs(flush_max));
+  ALOGI("%s: %u rejected requests, %u error buffers, %u leaked requests, %u "
+        "leaked buffers",
+        __FUNCTION__, num_rejected, error_buffers, leaked_requests,
+        leaked_buffers);
+
+  EXPECT_EQ(num_rejected,
+            fault_stats.injected[static_cast<uint32_t>(Fault::kFailSubmit)]);
+  EXPECT_GT(num_faulty, 0u);
+  EXPECT_EQ(leaked_requests, 0u);
+  EXPECT_EQ(leaked_buffers, 0u);
+  EXPECT_EQ(fault_stats.held_results, 0u);
+  EXPECT_EQ(fault_stats.delayed_messages, 0u);
+  // Dropped results need a flush to recover.
+  if (fault_stats.injected[static_cast<uint32_t>(Fault::kDropResult)] > 0) {
+    EXPECT_FALSE(flush_latencies.empty());
+  }
+
+  RequestWatchdog::Stats watchdog_stats = session->GetRequestWatchdogStats();
+  EXPECT_EQ(watchdog_stats.requests, kNumRequests - num_rejected);
+  EXPECT_EQ(watchdog_stats.pending_requests, 0u);
+
+  session = nullptr;
+  allocator->FreeBuffers(&preview_buffers);
+}
+
+}  // namespace
+}  // namespace google_camera_hal
+}  // namespace android
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "FrameRateCounterTests"
+#include <log/log.h>
+
+#include <frame_rate_counter.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+static constexpr int64_t kFrameDurationNs = 33333333;
+
+TEST(FrameRateCounterTests, CountPerStream) {
+  FrameRateCounter counter(/*print_interval_ns=*/0);
+  EXPECT_TRUE(counter.GetStats().empty());
+
+  for (int64_t i = 0; i < 31; i++) {
+    EXPECT_TRUE(counter.Count(/*stream_id=*/0, (i + 1) * kFrameDurationNs));
+  }
+  for (int64_t i = 0; i < 11; i++) {
+    EXPECT_TRUE(counter.Count(/*stream_id=*/3, (i + 1) * 3 * kFrameDurationNs));
+  }
+
+  auto stats = counter.GetStats();
+  ASSERT_EQ(stats.size(), 2u);
+  EXPECT_EQ(stats[0].stream_id, 0);
+  EXPECT_EQ(stats[0].frame_count, 30u);
+  EXPECT_NEAR(stats[0].average_fps, 30.0f, 0.01f);
+  EXPECT_EQ(stats[1].stream_id, 3);
+  EXPECT_EQ(stats[1].frame_count, 10u);
+  EXPECT_NEAR(stats[1].average_fps, 10.0f, 0.01f);
+}
+
+TEST(FrameRateCounterTests, RejectStreamsBeyondSlots) {
+  FrameRateCounter counter(/*print_interval_ns=*/0);
+  for (int32_t i = 0; i < static_cast<int32_t>(FrameRateCounter::kMaxStreams);
+       i++) {
+    EXPECT_TRUE(counter.Count(i, kFrameDurationNs));
+  }
+  EXPECT_FALSE(counter.Count(FrameRateCounter::kMaxStreams, kFrameDurationNs));
+  EXPECT_EQ(counter.GetStats().size(), FrameRateCounter::kMaxStreams);
+}
+
+TEST(FrameRateCounterTests, ReuseSlotsAfterReset) {
+  FrameRateCounter counter(/*print_interval_ns=*/0);
+  // Stream ids keep growing across reconfigurations.
+  for (int32_t config = 0; config < 4; config++) {
+    for (int32_t i = 0;
+         i < static_cast<int32_t>(FrameRateCounter::kMaxStreams); i++) {
+      int32_t stream_id = config * FrameRateCounter::kMaxStreams + i;
+      EXPECT_TRUE(counter.Count(stream_id, kFrameDurationNs));
+      EXPECT_TRUE(counter.Count(stream_id, 2 * kFrameDurationNs));
+    }
+
+    auto stats = counter.GetStats();
+    ASSERT_EQ(stats.size(), FrameRateCounter::kMaxStreams);
+    EXPECT_EQ(stats[0].stream_id, config * FrameRateCounter::kMaxStreams);
+    EXPECT_EQ(stats[0].frame_count, 1u);
+
+    counter.Reset();
+    EXPECT_TRUE(counter.GetStats().empty());
+  }
+}
+
+// Count frames of a few streams from several result threads, as the AIDL
+// service does for batched results.
+TEST(FrameRateCounterTests, ConcurrentCount) {
+  static const uint32_t kNumThreads = 4;
+  static const uint32_t kNumStreams = 3;
+  static const uint32_t kNumFramesPerThread = 100000;
+  FrameRateCounter counter(/*print_interval_ns=*/1000000000LL);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&counter]() {
+      for (uint32_t i = 0; i < kNumFramesPerThread; i++) {
+        counter.Count(i % kNumStreams, FrameRateCounter::GetBootTimeNs());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  ALOGI("%s: %.1f ns per frame", __FUNCTION__,
+        std::chrono::duration<double, std::nano>(elapsed).count() /
+            (kNumThreads * kNumFramesPerThread));
+
+  auto stats = counter.GetStats();
+  ASSERT_EQ(stats.size(), kNumStreams);
+  uint64_t total_frames = 0;
+  for (auto& stream_stats : stats) {
+    // The first frame of each stream only starts the measurement.
+    total_frames += stream_stats.frame_count + 1;
+    EXPECT_GE(stream_stats.last_frame_ns, stream_stats.first_frame_ns);
+  }
+  EXPECT_EQ(total_frames, kNumThreads * kNumFramesPerThread);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
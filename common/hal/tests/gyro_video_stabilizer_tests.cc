@@ -0,0 +1,447 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "GyroVideoStabilizerTests"
+#include <log/log.h>
+
+#include <gtest/gtest.h>
+#include <gyro_video_stabilizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+static constexpr int64_t kGyroPeriodNs = 1'000'000;    // 1 kHz
+static constexpr int64_t kFramePeriodNs = 33'333'333;  // 30 fps
+
+static GyroVideoStabilizer::Config GetConfig() {
+  return {.width = 640,
+          .height = 480,
+          .focal_length_px = 600,
+          .margin = 0.1f,
+          .smoothing_time_ns = 500'000'000,
+          .latency_budget_ns = 1'000'000'000};
+}
+
+// Feed a synthetic yaw trace of angle(t) in rad sampled at 1 kHz, and call
+// check with the yaw of the trace and the correction of each frame.
+static void RunYawTrace(
+    GyroVideoStabilizer* stabilizer, uint32_t num_frames,
+    const std::function<float(int64_t)>& angle,
+    const std::function<void(uint32_t, float, const StabilizationCorrection&)>&
+        check) {
+  int64_t gyro_time = 0;
+  for (uint32_t frame = 1; frame <= num_frames; frame++) {
+    int64_t frame_time = frame * kFramePeriodNs;
+    std::vector<GyroSample> samples;
+    for (; gyro_time <= frame_time; gyro_time += kGyroPeriodNs) {
+      // Central difference of the angle.
+      float rate = (angle(gyro_time + 500'000) - angle(gyro_time - 500'000)) /
+                   (kGyroPeriodNs * 1e-9f);
+      samples.push_back({.timestamp_ns = gyro_time, .y = rate});
+    }
+    ASSERT_EQ(stabilizer->AddGyroSamples(samples), OK);
+
+    StabilizationCorrection correction;
+    ASSERT_EQ(stabilizer->ComputeCorrection(frame_time, &correction), OK);
+    check(frame, angle(frame_time), correction);
+  }
+}
+
+TEST(GyroVideoStabilizerTests, Create) {
+  EXPECT_NE(GyroVideoStabilizer::Create(GetConfig()), nullptr);
+
+  auto config = GetConfig();
+  config.focal_length_px = 0;
+  EXPECT_EQ(GyroVideoStabilizer::Create(config), nullptr);
+
+  config = GetConfig();
+  config.margin = 0.3f;
+  EXPECT_EQ(GyroVideoStabilizer::Create(config), nullptr);
+
+  config = GetConfig();
+  config.width = 0;
+  EXPECT_EQ(GyroVideoStabilizer::Create(config), nullptr);
+}
+
+TEST(GyroVideoStabilizerTests, RejectOutOfOrderSamples) {
+  auto stabilizer = GyroVideoStabilizer::Create(GetConfig());
+  ASSERT_NE(stabilizer, nullptr);
+
+  EXPECT_EQ(
+      stabilizer->AddGyroSamples({{.timestamp_ns = 2}, {.timestamp_ns = 1}}),
+      BAD_VALUE);
+  EXPECT_EQ(stabilizer->AddGyroSamples({{.timestamp_ns = 1}}), OK);
+  EXPECT_EQ(stabilizer->AddGyroSamples({{.timestamp_ns = 1}}), BAD_VALUE);
+
+  StabilizationCorrection correction;
+  EXPECT_EQ(stabilizer->ComputeCorrection(100, &correction), OK);
+  EXPECT_EQ(stabilizer->ComputeCorrection(100, &correction), BAD_VALUE);
+  EXPECT_EQ(stabilizer->AddGyroSamples({{.timestamp_ns = 50}}), BAD_VALUE);
+}
+
+TEST(GyroVideoStabilizerTests, StillCameraIsNotCorrected) {
+  auto stabilizer = GyroVideoStabilizer::Create(GetConfig());
+  ASSERT_NE(stabilizer, nullptr);
+
+  RunYawTrace(stabilizer.get(), /*num_frames=*/30,
+              [](int64_t) { return 0.f; },
+              [](uint32_t, float, const StabilizationCorrection& correction) {
+                EXPECT_EQ(correction.dx, 0.f);
+                EXPECT_EQ(correction.dy, 0.f);
+                EXPECT_EQ(correction.roll, 0.f);
+              });
+}
+
+TEST(GyroVideoStabilizerTests, AttenuateHandshake) {
+  auto config = GetConfig();
+  auto stabilizer = GyroVideoStabilizer::Create(config);
+  ASSERT_NE(stabilizer, nullptr);
+
+  // 8 Hz shake of +-10 pixels.
+  const float amplitude = 10.f / config.focal_length_px;
+  auto angle = [amplitude](int64_t t) {
+    return amplitude * std::sin(2.f * M_PI * 8.f * t * 1e-9f);
+  };
+
+  float min_input = 0, max_input = 0, min_output = 0, max_output = 0;
+  RunYawTrace(stabilizer.get(), /*num_frames=*/90, angle,
+              [&](uint32_t frame, float yaw,
+                  const StabilizationCorrection& correction) {
+                if (frame < 30) {
+                  return;
+                }
+                // Position of the image content in the output window.
+                float input = -config.focal_length_px * yaw;
+                float output = input - correction.dx;
+                min_input = std::min(min_input, input);
+                max_input = std::max(max_input, input);
+                min_output = std::min(min_output, output);
+                max_output = std::max(max_output, output);
+                EXPECT_EQ(correction.dy, 0.f);
+              });
+
+  EXPECT_GT(max_input - min_input, 10.f);
+  EXPECT_LT(max_output - min_output, 0.2f * (max_input - min_input));
+}
+
+TEST(GyroVideoStabilizerTests, CorrectionFollowsFocalLength) {
+  auto config = GetConfig();
+  auto stabilizer = GyroVideoStabilizer::Create(config);
+  auto zoomed = GyroVideoStabilizer::Create(config);
+  ASSERT_NE(stabilizer, nullptr);
+  ASSERT_NE(zoomed, nullptr);
+  EXPECT_EQ(zoomed->SetFocalLength(0), BAD_VALUE);
+
+  // 8 Hz shake of +-5 pixels, which the 2x zoom doubles within the margin.
+  const float amplitude = 5.f / config.focal_length_px;
+  auto angle = [amplitude](int64_t t) {
+    return amplitude * std::sin(2.f * M_PI * 8.f * t * 1e-9f);
+  };
+  std::vector<float> corrections;
+  RunYawTrace(stabilizer.get(), /*num_frames=*/30, angle,
+              [&corrections](uint32_t, float,
+                             const StabilizationCorrection& correction) {
+                corrections.push_back(correction.dx);
+              });
+
+  // Zooming in the middle of the trace keeps the camera path.
+  std::vector<float> zoomed_corrections;
+  RunYawTrace(zoomed.get(), /*num_frames=*/30, angle,
+              [&](uint32_t frame, float,
+                  const StabilizationCorrection& correction) {
+                zoomed_corrections.push_back(correction.dx);
+                if (frame == 15) {
+                  ASSERT_EQ(zoomed->SetFocalLength(2 * config.focal_length_px),
+                            OK);
+                }
+              });
+
+  ASSERT_EQ(zoomed_corrections.size(), corrections.size());
+  bool corrected = false;
+  for (size_t i = 0; i < corrections.size(); i++) {
+    float scale = (i < 15) ? 1.f : 2.f;
+    EXPECT_NEAR(zoomed_corrections[i], scale * corrections[i], 1e-3f)
+        << "Frame " << i + 1;
+    corrected |= std::fabs(corrections[i]) > 1.f;
+  }
+  EXPECT_TRUE(corrected);
+}
+
+TEST(GyroVideoStabilizerTests, FollowPanWithinMargin) {
+  auto config = GetConfig();
+  auto stabilizer = GyroVideoStabilizer::Create(config);
+  ASSERT_NE(stabilizer, nullptr);
+
+  const float max_dx = config.margin * config.width;
+  float last_dx = 0;
+  RunYawTrace(stabilizer.get(), /*num_frames=*/90,
+              [](int64_t t) { return 0.5f * t * 1e-9f; },
+              [&](uint32_t, float, const StabilizationCorrection& correction) {
+                EXPECT_LE(std::fabs(correction.dx), max_dx + 1e-3f);
+                last_dx = correction.dx;
+              });
+
+  // The virtual camera lags the pan at the edge of the margin.
+  EXPECT_NEAR(last_dx, -max_dx, 1.f);
+}
+
+class GyroVideoStabilizerWarpTests : public ::testing::Test {
+ protected:
+  static constexpr uint32_t kWidth = 64;
+  static constexpr uint32_t kHeight = 48;
+
+  void SetUp() override {
+    input_data_.resize(kWidth * kHeight * 3 / 2);
+    for (uint32_t y = 0; y < kHeight; y++) {
+      for (uint32_t x = 0; x < kWidth; x++) {
+        input_data_[y * kWidth + x] = x * 2 + y * 2;
+      }
+    }
+    for (size_t i = kWidth * kHeight; i < input_data_.size(); i++) {
+      input_data_[i] = (i * 7) & 0xFF;
+    }
+    input_ = {.y = input_data_.data(),
+              .cb = input_data_.data() + kWidth * kHeight,
+              .cr = input_data_.data() + kWidth * kHeight * 5 / 4,
+              .y_stride = kWidth,
+              .cbcr_stride = kWidth / 2,
+              .cbcr_step = 1,
+              .width = kWidth,
+              .height = kHeight};
+
+    // Semi-planar output.
+    output_data_.resize(kWidth * kHeight * 3 / 2);
+    output_ = {.y = output_data_.data(),
+               .cb = output_data_.data() + kWidth * kHeight,
+               .cr = output_data_.data() + kWidth * kHeight + 1,
+               .y_stride = kWidth,
+               .cbcr_stride = kWidth,
+               .cbcr_step = 2,
+               .width = kWidth,
+               .height = kHeight};
+  }
+
+  uint8_t GetInput(uint32_t plane, uint32_t x, uint32_t y) const {
+    switch (plane) {
+      case 0:
+        return input_.y[y * input_.y_stride + x];
+      case 1:
+        return input_.cb[y * input_.cbcr_stride + x];
+      default:
+        return input_.cr[y * input_.cbcr_stride + x];
+    }
+  }
+
+  uint8_t GetOutput(uint32_t plane, uint32_t x, uint32_t y) const {
+    switch (plane) {
+      case 0:
+        return output_.y[y * output_.y_stride + x];
+      case 1:
+        return output_.cb[y * output_.cbcr_stride + x * output_.cbcr_step];
+      default:
+        return output_.cr[y * output_.cbcr_stride + x * output_.cbcr_step];
+    }
+  }
+
+  // Expect the output to be the input shifted by an even dx, dy.
+  void ExpectShifted(int32_t dx, int32_t dy) {
+    for (uint32_t plane = 0; plane < 3; plane++) {
+      uint32_t subsampling = plane == 0 ? 1 : 2;
+      uint32_t width = kWidth / subsampling;
+      uint32_t height = kHeight / subsampling;
+      int32_t plane_dx = dx / static_cast<int32_t>(subsampling);
+      int32_t plane_dy = dy / static_cast<int32_t>(subsampling);
+      for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+          int32_t src_x = x + plane_dx;
+          int32_t src_y = y + plane_dy;
+          if (src_x < 0 || src_y < 0 || src_x >= static_cast<int32_t>(width) ||
+              src_y >= static_cast<int32_t>(height)) {
+            continue;
+          }
+          ASSERT_EQ(GetOutput(plane, x, y), GetInput(plane, src_x, src_y))
+              << "plane " << plane << " at " << x << "," << y;
+        }
+      }
+    }
+  }
+
+  std::vector<uint8_t> input_data_;
+  std::vector<uint8_t> output_data_;
+  StabilizerImage input_;
+  StabilizerImage output_;
+};
+
+TEST_F(GyroVideoStabilizerWarpTests, Identity) {
+  auto config = GetConfig();
+  config.width = kWidth;
+  config.height = kHeight;
+  config.margin = 0;
+  auto stabilizer = GyroVideoStabilizer::Create(config);
+  ASSERT_NE(stabilizer, nullptr);
+
+  ASSERT_EQ(stabilizer->Warp(input_, {}, output_), OK);
+  ExpectShifted(0, 0);
+}
+
+TEST_F(GyroVideoStabilizerWarpTests, Shift) {
+  auto config = GetConfig();
+  config.width = kWidth;
+  config.height = kHeight;
+  config.margin = 0;
+  auto stabilizer = GyroVideoStabilizer::Create(config);
+  ASSERT_NE(stabilizer, nullptr);
+
+  ASSERT_EQ(stabilizer->Warp(input_, {.dx = 4, .dy = -2}, output_), OK);
+  ExpectShifted(4, -2);
+}
+
+TEST_F(GyroVideoStabilizerWarpTests, CropMargin) {
+  auto config = GetConfig();
+  config.width = kWidth;
+  config.height = kHeight;
+  config.margin = 0.25f;
+  auto stabilizer = GyroVideoStabilizer::Create(config);
+  ASSERT_NE(stabilizer, nullptr);
+
+  ASSERT_EQ(stabilizer->Warp(input_, {}, output_), OK);
+  // The center half of the input is scaled up by 2, with bilinear
+  // interpolation of the linear luma ramp.
+  for (uint32_t y = 0; y < kHeight; y += 2) {
+    for (uint32_t x = 0; x < kWidth; x += 2) {
+      float src_x = kWidth / 4 + x * 0.5f - 0.25f;
+      float src_y = kHeight / 4 + y * 0.5f - 0.25f;
+      EXPECT_NEAR(GetOutput(0, x, y), src_x * 2 + src_y * 2, 1.f);
+    }
+  }
+}
+
+TEST_F(GyroVideoStabilizerWarpTests, UseFastPathOverBudget) {
+  auto config = GetConfig();
+  config.width = kWidth;
+  config.height = kHeight;
+  config.margin = 0;
+  config.latency_budget_ns = 0;
+  auto stabilizer = GyroVideoStabilizer::Create(config);
+  ASSERT_NE(stabilizer, nullptr);
+
+  ASSERT_EQ(stabilizer->Warp(input_, {}, output_), OK);
+  EXPECT_EQ(stabilizer->GetStats().over_budget_frames, 1u);
+  EXPECT_EQ(stabilizer->GetStats().fast_path_frames, 0u);
+
+  ASSERT_EQ(stabilizer->Warp(input_, {.dx = 4, .dy = 2}, output_), OK);
+  EXPECT_EQ(stabilizer->GetStats().frames, 2u);
+  EXPECT_EQ(stabilizer->GetStats().fast_path_frames, 1u);
+  EXPECT_EQ(stabilizer->GetStats().over_budget_frames, 1u);
+  ExpectShifted(4, 2);
+}
+
+TEST(GyroVideoStabilizerTests, RotatedWarpMatchesReference) {
+  // Widths that are not a multiple of four also exercise the scalar tail.
+  constexpr uint32_t kWidth = 70;
+  constexpr uint32_t kHeight = 46;
+  constexpr uint32_t kChromaWidth = kWidth / 2;
+  constexpr uint32_t kChromaHeight = kHeight / 2;
+  auto config = GetConfig();
+  config.width = kWidth;
+  config.height = kHeight;
+  config.margin = 0.1f;
+  auto stabilizer = GyroVideoStabilizer::Create(config);
+  ASSERT_NE(stabilizer, nullptr);
+
+  std::vector<uint8_t> input_data(kWidth * kHeight * 3 / 2);
+  for (size_t i = 0; i < input_data.size(); i++) {
+    input_data[i] = (i * 37 + (i >> 3) * 11) & 0xFF;
+  }
+  std::vector<uint8_t> output_data(input_data.size());
+  uint8_t* input_planes[3] = {
+      input_data.data(), input_data.data() + kWidth * kHeight,
+      input_data.data() + kWidth * kHeight * 5 / 4};
+  StabilizerImage input = {.y = input_planes[0],
+                           .cb = input_planes[1],
+                           .cr = input_planes[2],
+                           .y_stride = kWidth,
+                           .cbcr_stride = kChromaWidth,
+                           .cbcr_step = 1,
+                           .width = kWidth,
+                           .height = kHeight};
+  StabilizerImage output = {.y = output_data.data(),
+                            .cb = output_data.data() + kWidth * kHeight,
+                            .cr = output_data.data() + kWidth * kHeight + 1,
+                            .y_stride = kWidth,
+                            .cbcr_stride = kWidth,
+                            .cbcr_step = 2,
+                            .width = kWidth,
+                            .height = kHeight};
+  const StabilizationCorrection correction = {
+      .dx = 2.7f, .dy = -1.3f, .roll = 0.02f};
+  ASSERT_EQ(stabilizer->Warp(input, correction, output), OK);
+
+  // Bilinear sample at center + d + scale * R(roll) * (p - center).
+  const float scale = 1.f - 2.f * config.margin;
+  for (uint32_t plane = 0; plane < 3; plane++) {
+    float subsampling = plane == 0 ? 1.f : 2.f;
+    uint32_t width = plane == 0 ? kWidth : kChromaWidth;
+    uint32_t height = plane == 0 ? kHeight : kChromaHeight;
+    uint32_t src_stride = width;
+    uint32_t dst_stride = kWidth;
+    uint32_t dst_step = plane == 0 ? 1 : 2;
+    const uint8_t* dst = plane == 0   ? output.y
+                         : plane == 1 ? output.cb
+                                      : output.cr;
+    for (uint32_t y = 0; y < height; y++) {
+      for (uint32_t x = 0; x < width; x++) {
+        float px = x + 0.5f - 0.5f * width;
+        float py = y + 0.5f - 0.5f * height;
+        float sx = 0.5f * width + correction.dx / subsampling +
+                   scale * (std::cos(correction.roll) * px -
+                            std::sin(correction.roll) * py) -
+                   0.5f;
+        float sy = 0.5f * height + correction.dy / subsampling +
+                   scale * (std::sin(correction.roll) * px +
+                            std::cos(correction.roll) * py) -
+                   0.5f;
+        sx = std::clamp(sx, 0.f, width - 1.f);
+        sy = std::clamp(sy, 0.f, height - 1.f);
+        uint32_t ix = std::min<uint32_t>(sx, width - 2);
+        uint32_t iy = std::min<uint32_t>(sy, height - 2);
+        float fx = sx - ix;
+        float fy = sy - iy;
+        const uint8_t* p = input_planes[plane] + iy * src_stride + ix;
+        float expected =
+            (p[0] * (1 - fx) + p[1] * fx) * (1 - fy) +
+            (p[src_stride] * (1 - fx) + p[src_stride + 1] * fx) * fy;
+        ASSERT_NEAR(dst[y * dst_stride + x * dst_step], expected, 2.f)
+            << "plane " << plane << " at " << x << "," << y;
+      }
+    }
+  }
+}
+
+TEST_F(GyroVideoStabilizerWarpTests, RejectSizeMismatch) {
+  auto config = GetConfig();
+  auto stabilizer = GyroVideoStabilizer::Create(config);
+  ASSERT_NE(stabilizer, nullptr);
+  EXPECT_EQ(stabilizer->Warp(input_, {}, output_), BAD_VALUE);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
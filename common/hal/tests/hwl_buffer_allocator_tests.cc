@@ -19,6 +19,9 @@
 
 #include <gtest/gtest.h>
 #include <hwl_buffer_allocator.h>
+
+#include <set>
+
 #include "mock_buffer_allocator_hwl.h"
 
 namespace android {
@@ -64,5 +67,41 @@ TEST(HwlBufferAllocatorTests, AllocateFreeBuffers) {
   ASSERT_EQ(buffers_.size(), (uint32_t)0)
       << "AllocateBuffers failed with wrong buffer number " << buffers_.size();
 }
+
+// Test that HwlBufferAllocator reuses freed buffers and releases them when it
+// is destroyed.
+TEST(HwlBufferAllocatorTests, ReuseFreedBuffers) {
+  auto mock_allocator_hwl = MockBufferAllocatorHwl::Create();
+  ASSERT_NE(mock_allocator_hwl, nullptr);
+  auto mock = static_cast<MockBufferAllocatorHwl*>(mock_allocator_hwl.get());
+
+  auto allocator = HwlBufferAllocator::Create(mock_allocator_hwl.get());
+  ASSERT_NE(allocator, nullptr) << "Create HwlBufferAllocator failed.";
+
+  HalBufferDescriptor buffer_descriptor = {};
+  buffer_descriptor.width = 640;
+  buffer_descriptor.height = 480;
+  buffer_descriptor.format = HAL_PIXEL_FORMAT_YCBCR_420_888;
+  buffer_descriptor.producer_flags = GRALLOC1_PRODUCER_USAGE_CAMERA;
+  buffer_descriptor.consumer_flags = GRALLOC1_CONSUMER_USAGE_CAMERA;
+  buffer_descriptor.immediate_num_buffers = kMaxBufferDepth;
+  buffer_descriptor.max_num_buffers = kMaxBufferDepth;
+
+  std::vector<buffer_handle_t> buffers;
+  ASSERT_EQ(allocator->AllocateBuffers(buffer_descriptor, &buffers), OK);
+  std::set<buffer_handle_t> first_buffers(buffers.begin(), buffers.end());
+  allocator->FreeBuffers(&buffers);
+  EXPECT_EQ(mock->GetFreedBufferCount(), 0u);
+
+  // A reconfiguration with the same streams gets the same buffers back.
+  ASSERT_EQ(allocator->AllocateBuffers(buffer_descriptor, &buffers), OK);
+  EXPECT_EQ(std::set<buffer_handle_t>(buffers.begin(), buffers.end()),
+            first_buffers);
+  EXPECT_EQ(mock->GetAllocatedBufferCount(), kMaxBufferDepth);
+  allocator->FreeBuffers(&buffers);
+
+  allocator = nullptr;
+  EXPECT_EQ(mock->GetFreedBufferCount(), kMaxBufferDepth);
+}
 }  // namespace google_camera_hal
 }  // namespace android
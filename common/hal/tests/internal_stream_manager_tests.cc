@@ -309,7 +309,7 @@ TEST(InternalStreamManagerTests, GetMostRecentStreamBuffer) {
   std::vector<StreamBuffer> input_buffers;
   std::vector<std::unique_ptr<HalCameraMetadata>> input_buffer_metadata;
   res = stream_manager->GetMostRecentStreamBuffer(
-      raw_hal_stream.id, &input_buffers, &input_buffer_metadata,
+      raw_hal_stream.id, frame_index, &input_buffers, &input_buffer_metadata,
       /*payload_frames*/ 1);
   ASSERT_EQ(res, OK) << "GetMostRecentZslBuffers failed.";
 
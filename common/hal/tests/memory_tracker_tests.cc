@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MemoryTrackerTests"
+#include <log/log.h>
+
+#include <gtest/gtest.h>
+#include <hal_camera_metadata.h>
+#include <memory_tracker.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+// Nothing in the common HAL stages JPEG frames, so the process usage of this
+// category only changes in the tests.
+static constexpr MemoryCategory kTestCategory = MemoryCategory::kJpegStaging;
+
+class MemoryTrackerTests : public ::testing::Test {
+ protected:
+  MemoryTracker& tracker_ = MemoryTracker::GetInstance();
+};
+
+TEST_F(MemoryTrackerTests, CategoryName) {
+  EXPECT_STREQ(MemoryTracker::GetCategoryName(MemoryCategory::kZslBuffer),
+               "zsl_buffer");
+  EXPECT_STREQ(MemoryTracker::GetCategoryName(MemoryCategory::kMetadata),
+               "metadata");
+  EXPECT_STREQ(MemoryTracker::GetCategoryName(MemoryCategory::kNumCategories),
+               "unknown");
+}
+
+TEST_F(MemoryTrackerTests, ProcessUsage) {
+  MemoryUsage base = tracker_.GetUsage(kTestCategory);
+
+  tracker_.Update(kTestCategory, MemoryTracker::kNoSession, 1000);
+  tracker_.Update(kTestCategory, MemoryTracker::kNoSession, 500);
+  tracker_.Update(kTestCategory, MemoryTracker::kNoSession, -1200);
+
+  MemoryUsage usage = tracker_.GetUsage(kTestCategory);
+  EXPECT_EQ(usage.current_bytes, base.current_bytes + 300);
+  EXPECT_GE(usage.peak_bytes, base.current_bytes + 1500);
+
+  tracker_.Update(kTestCategory, MemoryTracker::kNoSession, -300);
+  EXPECT_EQ(tracker_.GetUsage(kTestCategory).current_bytes,
+            base.current_bytes);
+}
+
+TEST_F(MemoryTrackerTests, ConcurrentUpdates) {
+  static constexpr int32_t kNumThreads = 4;
+  static constexpr int32_t kNumUpdates = 1000;
+  MemoryUsage base = tracker_.GetUsage(kTestCategory);
+  uint32_t session = tracker_.AddSession("concurrent");
+
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&] {
+      for (int32_t j = 0; j < kNumUpdates; j++) {
+        tracker_.Update(kTestCategory, session, 64);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  int64_t total_bytes = kNumThreads * kNumUpdates * 64;
+  EXPECT_EQ(tracker_.GetUsage(kTestCategory).current_bytes,
+            base.current_bytes + total_bytes);
+  MemoryUsage usage;
+  ASSERT_EQ(tracker_.GetSessionUsage(session, kTestCategory, &usage), OK);
+  EXPECT_EQ(usage.current_bytes, total_bytes);
+  EXPECT_EQ(usage.peak_bytes, total_bytes);
+
+  tracker_.Update(kTestCategory, session, -total_bytes);
+  tracker_.EndSession(session);
+}
+
+TEST_F(MemoryTrackerTests, SessionUsage) {
+  uint32_t session = tracker_.AddSession("session");
+  uint32_t other_session = tracker_.AddSession("other session");
+  EXPECT_NE(session, MemoryTracker::kNoSession);
+  EXPECT_NE(session, other_session);
+
+  tracker_.Update(kTestCategory, session, 4096);
+  tracker_.Update(kTestCategory, other_session, 1024);
+  tracker_.Update(kTestCategory, session, -1024);
+
+  MemoryUsage usage;
+  ASSERT_EQ(tracker_.GetSessionUsage(session, kTestCategory, &usage), OK);
+  EXPECT_EQ(usage.current_bytes, 3072);
+  EXPECT_EQ(usage.peak_bytes, 4096);
+  ASSERT_EQ(tracker_.GetSessionUsage(other_session, kTestCategory, &usage), OK);
+  EXPECT_EQ(usage.current_bytes, 1024);
+  ASSERT_EQ(tracker_.GetSessionUsage(session, MemoryCategory::kZslBuffer,
+                                     &usage),
+            OK);
+  EXPECT_EQ(usage.peak_bytes, 0);
+
+  EXPECT_EQ(tracker_.GetSessionUsage(session, kTestCategory, nullptr),
+            BAD_VALUE);
+  EXPECT_EQ(tracker_.GetSessionUsage(MemoryTracker::kNoSession, kTestCategory,
+                                     &usage),
+            NAME_NOT_FOUND);
+
+  tracker_.Update(kTestCategory, session, -3072);
+  tracker_.Update(kTestCategory, other_session, -1024);
+  tracker_.EndSession(session);
+  tracker_.EndSession(other_session);
+}
+
+TEST_F(MemoryTrackerTests, EndedSessionsAreEvicted) {
+  uint32_t session = tracker_.AddSession("ended");
+  tracker_.Update(kTestCategory, session, 100);
+  tracker_.EndSession(session);
+
+  // Memory freed after the session ended still counts for it.
+  tracker_.Update(kTestCategory, session, -100);
+  MemoryUsage usage;
+  ASSERT_EQ(tracker_.GetSessionUsage(session, kTestCategory, &usage), OK);
+  EXPECT_EQ(usage.current_bytes, 0);
+  EXPECT_EQ(usage.peak_bytes, 100);
+
+  // Ending a session twice doesn't evict it earlier.
+  tracker_.EndSession(session);
+
+  std::vector<uint32_t> newer_sessions;
+  for (uint32_t i = 0; i < 8; i++) {
+    newer_sessions.push_back(tracker_.AddSession("newer"));
+    tracker_.EndSession(newer_sessions.back());
+  }
+  EXPECT_EQ(tracker_.GetSessionUsage(session, kTestCategory, &usage),
+            NAME_NOT_FOUND);
+  EXPECT_EQ(
+      tracker_.GetSessionUsage(newer_sessions.front(), kTestCategory, &usage),
+      OK);
+}
+
+TEST_F(MemoryTrackerTests, ScopedMemorySession) {
+  EXPECT_EQ(MemoryTracker::GetCurrentSession(), MemoryTracker::kNoSession);
+  uint32_t session = tracker_.AddSession("scoped");
+  uint32_t nested_session = tracker_.AddSession("nested");
+  {
+    ScopedMemorySession memory_session(session);
+    EXPECT_EQ(MemoryTracker::GetCurrentSession(), session);
+    {
+      ScopedMemorySession nested_memory_session(nested_session);
+      EXPECT_EQ(MemoryTracker::GetCurrentSession(), nested_session);
+    }
+    EXPECT_EQ(MemoryTracker::GetCurrentSession(), session);
+
+    // The session is per thread.
+    std::thread([] {
+      EXPECT_EQ(MemoryTracker::GetCurrentSession(), MemoryTracker::kNoSession);
+    }).join();
+  }
+  EXPECT_EQ(MemoryTracker::GetCurrentSession(), MemoryTracker::kNoSession);
+
+  tracker_.EndSession(session);
+  tracker_.EndSession(nested_session);
+}
+
+TEST_F(MemoryTrackerTests, SessionCounters) {
+  EXPECT_EQ(tracker_.GetSessionCounters(MemoryTracker::kNoSession), nullptr);
+  EXPECT_EQ(MemoryTracker::GetCurrentSessionCounters(), nullptr);
+  uint32_t session = tracker_.AddSession("counters");
+  std::shared_ptr<MemoryTracker::SessionCounters> counters;
+  {
+    ScopedMemorySession memory_session(session);
+    counters = MemoryTracker::GetCurrentSessionCounters();
+  }
+  ASSERT_NE(counters, nullptr);
+  EXPECT_EQ(counters, tracker_.GetSessionCounters(session));
+  EXPECT_EQ(MemoryTracker::GetCurrentSessionCounters(), nullptr);
+
+  MemoryUsage base = tracker_.GetUsage(kTestCategory);
+  tracker_.Update(kTestCategory, counters, 2048);
+  tracker_.Update(kTestCategory, counters, -512);
+  MemoryUsage usage;
+  ASSERT_EQ(tracker_.GetSessionUsage(session, kTestCategory, &usage), OK);
+  EXPECT_EQ(usage.current_bytes, 1536);
+  EXPECT_EQ(usage.peak_bytes, 2048);
+  EXPECT_EQ(tracker_.GetUsage(kTestCategory).current_bytes,
+            base.current_bytes + 1536);
+
+  // The counters outlive the session in the tracker.
+  tracker_.EndSession(session);
+  for (uint32_t i = 0; i < 8; i++) {
+    tracker_.EndSession(tracker_.AddSession("newer"));
+  }
+  EXPECT_EQ(tracker_.GetSessionCounters(session), nullptr);
+  tracker_.Update(kTestCategory, counters, -1536);
+  EXPECT_EQ(counters->current_bytes[static_cast<uint32_t>(kTestCategory)], 0);
+  EXPECT_EQ(tracker_.GetUsage(kTestCategory).current_bytes,
+            base.current_bytes);
+}
+
+TEST_F(MemoryTrackerTests, HalCameraMetadata) {
+  uint32_t session = tracker_.AddSession("metadata");
+  MemoryUsage base = tracker_.GetUsage(MemoryCategory::kMetadata);
+
+  std::unique_ptr<HalCameraMetadata> metadata;
+  {
+    ScopedMemorySession memory_session(session);
+    metadata = HalCameraMetadata::Create(/*entry_capacity=*/4,
+                                         /*data_capacity=*/256);
+    ASSERT_NE(metadata, nullptr);
+  }
+
+  MemoryUsage usage;
+  ASSERT_EQ(
+      tracker_.GetSessionUsage(session, MemoryCategory::kMetadata, &usage), OK);
+  EXPECT_EQ(static_cast<size_t>(usage.current_bytes),
+            metadata->GetCameraMetadataSize());
+  EXPECT_EQ(tracker_.GetUsage(MemoryCategory::kMetadata).current_bytes,
+            base.current_bytes + usage.current_bytes);
+
+  // Growing the metadata is accounted too.
+  std::vector<uint8_t> data(1024);
+  ASSERT_EQ(metadata->Set(ANDROID_JPEG_GPS_PROCESSING_METHOD, data.data(),
+                          data.size()),
+            OK);
+  ASSERT_EQ(
+      tracker_.GetSessionUsage(session, MemoryCategory::kMetadata, &usage), OK);
+  EXPECT_EQ(static_cast<size_t>(usage.current_bytes),
+            metadata->GetCameraMetadataSize());
+
+  metadata = nullptr;
+  ASSERT_EQ(
+      tracker_.GetSessionUsage(session, MemoryCategory::kMetadata, &usage), OK);
+  EXPECT_EQ(usage.current_bytes, 0);
+  EXPECT_EQ(tracker_.GetUsage(MemoryCategory::kMetadata).current_bytes,
+            base.current_bytes);
+
+  tracker_.EndSession(session);
+}
+
+TEST_F(MemoryTrackerTests, Dump) {
+  uint32_t session = tracker_.AddSession("DumpTest");
+  tracker_.Update(kTestCategory, session, 8192);
+
+  std::FILE* f = std::tmpfile();
+  ASSERT_NE(f, nullptr);
+  tracker_.Dump(fileno(f));
+
+  std::rewind(f);
+  std::string dump;
+  char line[512];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    dump += line;
+  }
+  std::fclose(f);
+
+  EXPECT_NE(dump.find("Memory usage"), std::string::npos);
+  EXPECT_NE(dump.find("zsl_buffer"), std::string::npos);
+  EXPECT_NE(dump.find("DumpTest"), std::string::npos);
+  EXPECT_NE(dump.find("jpeg_staging: 8 / 8"), std::string::npos);
+
+  tracker_.Update(kTestCategory, session, -8192);
+  tracker_.EndSession(session);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
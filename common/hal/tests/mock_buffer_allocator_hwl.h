@@ -39,25 +39,44 @@ class MockBufferAllocatorHwl : public CameraBufferAllocatorHwl {
     return base_allocator;
   }
 
-  // Allocate HWL buffers
+  // Allocate HWL buffers. The handles are distinct placeholders that must not
+  // be dereferenced.
   status_t AllocateBuffers(const HalBufferDescriptor& buffer_descriptor,
                            std::vector<buffer_handle_t>* buffers) {
-    buffers->resize(buffer_descriptor.max_num_buffers);
+    for (uint32_t i = 0; i < buffer_descriptor.max_num_buffers; i++) {
+      buffers->push_back(
+          reinterpret_cast<buffer_handle_t>(next_buffer_handle_++));
+    }
+    allocated_buffer_count_ += buffer_descriptor.max_num_buffers;
     return OK;
   }
 
   // Free HWL buffers
   status_t FreeBuffers(std::vector<buffer_handle_t>* buffers) {
+    freed_buffer_count_ += buffers->size();
     buffers->clear();
     return OK;
   }
 
+  // Number of buffers allocated and freed.
+  uint32_t GetAllocatedBufferCount() const {
+    return allocated_buffer_count_;
+  }
+  uint32_t GetFreedBufferCount() const {
+    return freed_buffer_count_;
+  }
+
   bool IsHwlAllocatedBuffer(buffer_handle_t /*buffer*/) {
     return false;
   }
 
  protected:
   MockBufferAllocatorHwl() = default;
+
+ private:
+  uintptr_t next_buffer_handle_ = 1;
+  uint32_t allocated_buffer_count_ = 0;
+  uint32_t freed_buffer_count_ = 0;
 };
 }  // namespace google_camera_hal
 }  // namespace android
@@ -18,15 +18,22 @@
 #include <log/log.h>
 
 #include <gtest/gtest.h>
+#include <utils/Timers.h>
+
+#include <cinttypes>
+#include <deque>
 #include <memory>
+#include <set>
 
 #include "basic_request_processor.h"
 #include "mock_device_session_hwl.h"
 #include "mock_process_block.h"
 #include "result_processor.h"
+#include "snapshot_request_processor.h"
 #include "test_utils.h"
 
 using ::testing::_;
+using ::testing::Invoke;
 
 namespace android {
 namespace google_camera_hal {
@@ -152,5 +159,225 @@ TEST_F(RequestProcessorTest, BasicRequestProcessorRequest) {
   ASSERT_EQ(request_processor->ProcessRequest(request), OK);
 }
 
+// Statistics of a simulated snapshot burst.
+struct SnapshotBurstStats {
+  uint32_t snapshots = 0;
+  // Snapshots that could not get a slot and fell back to realtime capture.
+  uint32_t fallbacks = 0;
+  // Average number of frames between two snapshots processed by the
+  // snapshot pipeline.
+  float shot_to_shot_frames = 0;
+  nsecs_t max_process_request_duration = 0;
+};
+
+// Simulate a sensor filling one ZSL buffer per frame while a snapshot is
+// requested every kShotInterval frames. Each accepted snapshot completes
+// kProcessingFrames frames later, when its ZSL buffers are returned like
+// SnapshotResultProcessor does.
+static void RunSnapshotBurst(MockDeviceSessionHwl* session_hwl,
+                             uint32_t max_in_flight_snapshots,
+                             SnapshotBurstStats* stats) {
+  static constexpr uint32_t kWarmUpFrames = 6;
+  static constexpr uint32_t kShotInterval = 3;
+  static constexpr uint32_t kProcessingFrames = 5;
+  static constexpr uint32_t kBurstSnapshots = 20;
+  static constexpr Stream kYuvStream{
+      .stream_type = StreamType::kOutput,
+      .width = 640,
+      .height = 480,
+      .format = HAL_PIXEL_FORMAT_YCBCR_420_888,
+      .usage = 0,
+      .rotation = StreamRotation::kRotation0,
+  };
+
+  auto stream_manager = InternalStreamManager::Create();
+  ASSERT_NE(stream_manager, nullptr);
+  HalStream yuv_hal_stream = {
+      .override_format = HAL_PIXEL_FORMAT_YCBCR_420_888,
+      .producer_usage = GRALLOC_USAGE_HW_CAMERA_WRITE,
+      .max_buffers = SnapshotRequestProcessor::kZslBufferSize *
+                     (max_in_flight_snapshots + 1),
+  };
+  ASSERT_EQ(stream_manager->RegisterNewInternalStream(kYuvStream,
+                                                      &yuv_hal_stream.id),
+            OK);
+  ASSERT_EQ(stream_manager->AllocateBuffers(yuv_hal_stream), OK);
+
+  HwlSessionCallback session_callback = {
+      .request_stream_buffers =
+          [](uint32_t stream_id, uint32_t num_buffers,
+             std::vector<StreamBuffer>* buffers, uint32_t /*frame_number*/) {
+            for (uint32_t i = 0; i < num_buffers; i++) {
+              StreamBuffer buffer = {};
+              buffer.stream_id = stream_id;
+              buffers->push_back(buffer);
+            }
+            return OK;
+          },
+      .return_stream_buffers = [](const std::vector<StreamBuffer>&) {},
+  };
+  auto request_processor =
+      SnapshotRequestProcessor::Create(session_hwl, session_callback,
+                                       yuv_hal_stream.id,
+                                       max_in_flight_snapshots);
+  ASSERT_NE(request_processor, nullptr);
+
+  StreamConfiguration preview_config;
+  test_utils::GetPreviewOnlyStreamConfiguration(&preview_config);
+  StreamConfiguration process_block_stream_config;
+  ASSERT_EQ(request_processor->ConfigureStreams(stream_manager.get(),
+                                                preview_config,
+                                                &process_block_stream_config),
+            OK);
+
+  // Every in flight snapshot must get its own ZSL buffers.
+  std::set<buffer_handle_t> in_flight_buffers;
+  auto process_block = std::make_unique<MockProcessBlock>();
+  ASSERT_NE(process_block, nullptr);
+  EXPECT_CALL(*process_block, ProcessRequests(_, _))
+      .WillRepeatedly(
+          Invoke([&](const std::vector<ProcessBlockRequest>& block_requests,
+                     const CaptureRequest& /*remaining_session_request*/) {
+            EXPECT_EQ(block_requests.size(), 1u);
+            const CaptureRequest& request = block_requests[0].request;
+            EXPECT_EQ(request.input_buffers.size(),
+                      static_cast<size_t>(
+                          SnapshotRequestProcessor::kZslBufferSize));
+            for (auto& buffer : request.input_buffers) {
+              EXPECT_TRUE(in_flight_buffers.insert(buffer.buffer).second)
+                  << "A ZSL buffer is used by two snapshots.";
+            }
+            return OK;
+          }));
+  ASSERT_EQ(request_processor->SetProcessBlock(std::move(process_block)), OK);
+
+  struct InFlightSnapshot {
+    uint32_t frame_number = 0;
+    uint32_t completion_frame_number = 0;
+    std::vector<buffer_handle_t> buffers;
+  };
+  std::deque<InFlightSnapshot> in_flight_snapshots;
+  uint32_t last_shot_frame_number = 0;
+  uint32_t total_shot_to_shot_frames = 0;
+  uint32_t accepted_snapshots = 0;
+  uint32_t num_frames =
+      kWarmUpFrames + kBurstSnapshots * kShotInterval + kProcessingFrames;
+
+  for (uint32_t frame_number = 0; frame_number < num_frames; frame_number++) {
+    // The sensor fills a ZSL buffer.
+    StreamBuffer zsl_buffer;
+    ASSERT_EQ(stream_manager->GetStreamBuffer(yuv_hal_stream.id, &zsl_buffer),
+              OK);
+    ASSERT_EQ(stream_manager->ReturnFilledBuffer(frame_number, zsl_buffer),
+              OK);
+    auto metadata = HalCameraMetadata::Create(/*num_entries=*/1,
+                                              /*data_bytes=*/8);
+    ASSERT_NE(metadata, nullptr);
+    // ZSL buffers are timestamped in BOOT_TIME.
+    struct timespec ts;
+    ASSERT_EQ(clock_gettime(CLOCK_BOOTTIME, &ts), 0);
+    int64_t timestamp = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    ASSERT_EQ(metadata->Set(ANDROID_SENSOR_TIMESTAMP, &timestamp, 1), OK);
+    ASSERT_EQ(stream_manager->ReturnMetadata(yuv_hal_stream.id, frame_number,
+                                             metadata.get()),
+              OK);
+
+    // Complete the snapshots in order.
+    while (!in_flight_snapshots.empty() &&
+           in_flight_snapshots.front().completion_frame_number <=
+               frame_number) {
+      auto& snapshot = in_flight_snapshots.front();
+      for (auto buffer : snapshot.buffers) {
+        in_flight_buffers.erase(buffer);
+      }
+      EXPECT_EQ(stream_manager->ReturnZslStreamBuffers(snapshot.frame_number,
+                                                       yuv_hal_stream.id),
+                OK);
+      in_flight_snapshots.pop_front();
+    }
+
+    if (frame_number < kWarmUpFrames ||
+        (frame_number - kWarmUpFrames) % kShotInterval != 0 ||
+        stats->snapshots == kBurstSnapshots) {
+      continue;
+    }
+
+    CaptureRequest request = {};
+    request.frame_number = frame_number;
+    request.output_buffers.push_back({.stream_id = 0});
+    std::set<buffer_handle_t> buffers_before = in_flight_buffers;
+    nsecs_t start_time = systemTime(SYSTEM_TIME_MONOTONIC);
+    status_t res = request_processor->ProcessRequest(request);
+    stats->max_process_request_duration =
+        std::max(stats->max_process_request_duration,
+                 systemTime(SYSTEM_TIME_MONOTONIC) - start_time);
+    stats->snapshots++;
+    if (res != OK) {
+      stats->fallbacks++;
+      continue;
+    }
+
+    InFlightSnapshot snapshot = {
+        .frame_number = frame_number,
+        .completion_frame_number = frame_number + kProcessingFrames,
+    };
+    for (auto buffer : in_flight_buffers) {
+      if (buffers_before.find(buffer) == buffers_before.end()) {
+        snapshot.buffers.push_back(buffer);
+      }
+    }
+    in_flight_snapshots.push_back(std::move(snapshot));
+    if (accepted_snapshots > 0) {
+      total_shot_to_shot_frames += frame_number - last_shot_frame_number;
+    }
+    last_shot_frame_number = frame_number;
+    accepted_snapshots++;
+  }
+
+  if (accepted_snapshots > 1) {
+    stats->shot_to_shot_frames =
+        static_cast<float>(total_shot_to_shot_frames) /
+        (accepted_snapshots - 1);
+  }
+}
+
+TEST_F(RequestProcessorTest, SnapshotRequestProcessorBurst) {
+  // Report an active array for the internal YUV stream.
+  EXPECT_CALL(*session_hwl_, GetCameraCharacteristics(_))
+      .WillRepeatedly(
+          Invoke([](std::unique_ptr<HalCameraMetadata>* characteristics) {
+            *characteristics = HalCameraMetadata::Create(/*num_entries=*/1,
+                                                         /*data_bytes=*/16);
+            int32_t active_array[4] = {0, 0, 640, 480};
+            return (*characteristics)->Set(
+                ANDROID_SENSOR_INFO_PRE_CORRECTION_ACTIVE_ARRAY_SIZE,
+                active_array, 4);
+          }));
+
+  SnapshotBurstStats single_slot_stats;
+  RunSnapshotBurst(session_hwl_.get(), /*max_in_flight_snapshots=*/1,
+                   &single_slot_stats);
+  SnapshotBurstStats multi_slot_stats;
+  RunSnapshotBurst(session_hwl_.get(),
+                   SnapshotRequestProcessor::kDefaultMaxInFlightSnapshots,
+                   &multi_slot_stats);
+
+  for (auto& [name, stats] :
+       {std::make_pair("single slot", &single_slot_stats),
+        std::make_pair("multi slot", &multi_slot_stats)}) {
+    ALOGI("%s: %u/%u snapshots fell back, %.1f frames shot to shot, %" PRId64
+          " us max ProcessRequest",
+          name, stats->fallbacks, stats->snapshots, stats->shot_to_shot_frames,
+          ns2us(stats->max_process_request_duration));
+  }
+
+  // A snapshot takes longer than the shot interval, so a single slot drops
+  // every other shot to the realtime pipeline while two slots keep up.
+  EXPECT_GT(single_slot_stats.fallbacks, 0u);
+  EXPECT_EQ(multi_slot_stats.fallbacks, 0u);
+  EXPECT_LT(multi_slot_stats.shot_to_shot_frames,
+            single_slot_stats.shot_to_shot_frames);
+}
+
 }  // namespace google_camera_hal
 }  // namespace android
@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RequestWatchdogTests"
+#include <log/log.h>
+
+#include <gtest/gtest.h>
+#include <request_watchdog.h>
+
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+static constexpr int64_t kFrameDurationNs = 33333333;
+static constexpr int32_t kPreviewStreamId = 0;
+static constexpr int32_t kVideoStreamId = 1;
+
+class RequestWatchdogTests : public ::testing::Test {
+ protected:
+  // Create a watchdog on the fake clock now_ns_, without a checker thread.
+  void CreateWatchdog(RequestWatchdog::Config config = {}) {
+    config.check_interval_ms = 0;
+    config.clock = [this] { return now_ns_; };
+    watchdog_ = RequestWatchdog::Create(
+        config, [this](uint32_t frame_number, const std::string& dump) {
+          stalled_frame_numbers_.push_back(frame_number);
+          last_dump_ = dump;
+        });
+    ASSERT_NE(watchdog_, nullptr);
+  }
+
+  void Submit(uint32_t frame_number, const std::vector<int32_t>& stream_ids) {
+    CaptureRequest request = {.frame_number = frame_number};
+    for (int32_t stream_id : stream_ids) {
+      request.output_buffers.push_back({.stream_id = stream_id});
+    }
+    watchdog_->OnRequestSubmitted(request);
+  }
+
+  void Shutter(uint32_t frame_number) {
+    NotifyMessage message = {.type = MessageType::kShutter};
+    message.message.shutter.frame_number = frame_number;
+    watchdog_->OnNotify(message);
+  }
+
+  void Error(uint32_t frame_number, ErrorCode error_code) {
+    NotifyMessage message = {.type = MessageType::kError};
+    message.message.error.frame_number = frame_number;
+    message.message.error.error_code = error_code;
+    watchdog_->OnNotify(message);
+  }
+
+  void Result(uint32_t frame_number, uint32_t partial_result,
+              const std::vector<int32_t>& stream_ids,
+              BufferStatus status = BufferStatus::kOk) {
+    CaptureResult result = {.frame_number = frame_number,
+                            .partial_result = partial_result};
+    if (partial_result > 0) {
+      result.result_metadata = HalCameraMetadata::Create(1, 10);
+    }
+    for (int32_t stream_id : stream_ids) {
+      result.output_buffers.push_back(
+          {.stream_id = stream_id, .status = status});
+    }
+    watchdog_->OnResult(result);
+  }
+
+  int64_t now_ns_ = 0;
+  std::unique_ptr<RequestWatchdog> watchdog_;
+  std::vector<uint32_t> stalled_frame_numbers_;
+  std::string last_dump_;
+};
+
+TEST_F(RequestWatchdogTests, Create) {
+  EXPECT_EQ(RequestWatchdog::Create({.partial_result_count = 0}, nullptr),
+            nullptr);
+  EXPECT_EQ(RequestWatchdog::Create({.shutter_slo_frames = 0}, nullptr),
+            nullptr);
+  EXPECT_EQ(RequestWatchdog::Create({.window_size = 0}, nullptr), nullptr);
+  EXPECT_NE(RequestWatchdog::Create({}, nullptr), nullptr);
+}
+
+TEST_F(RequestWatchdogTests, GetFrameDuration) {
+  EXPECT_EQ(RequestWatchdog::GetFrameDuration(nullptr, kFrameDurationNs),
+            kFrameDurationNs);
+
+  auto settings = HalCameraMetadata::Create(4, 64);
+  ASSERT_NE(settings, nullptr);
+  EXPECT_EQ(RequestWatchdog::GetFrameDuration(settings.get(), 1), 1);
+
+  // AE may run down to 15 fps.
+  const int32_t fps_range[] = {15, 30};
+  ASSERT_EQ(settings->Set(ANDROID_CONTROL_AE_TARGET_FPS_RANGE, fps_range, 2),
+            OK);
+  EXPECT_EQ(RequestWatchdog::GetFrameDuration(settings.get(), 1),
+            1000000000 / 15);
+
+  // The manual frame duration is ignored unless AE is off.
+  const int64_t frame_duration = 100000000;
+  ASSERT_EQ(settings->Set(ANDROID_SENSOR_FRAME_DURATION, &frame_duration, 1),
+            OK);
+  EXPECT_EQ(RequestWatchdog::GetFrameDuration(settings.get(), 1),
+            1000000000 / 15);
+  const uint8_t ae_mode = ANDROID_CONTROL_AE_MODE_OFF;
+  ASSERT_EQ(settings->Set(ANDROID_CONTROL_AE_MODE, &ae_mode, 1), OK);
+  EXPECT_EQ(RequestWatchdog::GetFrameDuration(settings.get(), 1),
+            frame_duration);
+}
+
+// Stages are measured from the submission against SLOs in frame durations.
+TEST_F(RequestWatchdogTests, MeasureLatencies) {
+  CreateWatchdog({.partial_result_count = 2,
+                  .shutter_slo_frames = 2,
+                  .result_slo_frames = 3});
+
+  // Frame 0 is on time.
+  Submit(0, {kPreviewStreamId, kVideoStreamId});
+  now_ns_ += kFrameDurationNs;
+  Shutter(0);
+  Result(0, 1, {kPreviewStreamId});
+  now_ns_ += kFrameDurationNs;
+  Result(0, 2, {kVideoStreamId});
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 0u);
+
+  // Frame 1 is late on the shutter, the final result and the video buffer.
+  Submit(1, {kPreviewStreamId, kVideoStreamId});
+  now_ns_ += kFrameDurationNs;
+  Result(1, 0, {kPreviewStreamId});
+  now_ns_ += kFrameDurationNs * 2;
+  Result(1, 1, {});
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 1u);
+  Shutter(1);
+  now_ns_ += kFrameDurationNs;
+  Result(1, 2, {kVideoStreamId});
+
+  auto stats = watchdog_->GetStats();
+  EXPECT_EQ(stats.requests, 2u);
+  EXPECT_EQ(stats.pending_requests, 0u);
+  EXPECT_EQ(stats.stalls, 0u);
+  EXPECT_EQ(stats.shutter.count, 2u);
+  EXPECT_EQ(stats.shutter.violations, 1u);
+  EXPECT_EQ(stats.shutter.max_latency_ns, kFrameDurationNs * 3);
+  EXPECT_EQ(stats.partial_result.count, 4u);
+  EXPECT_EQ(stats.partial_result.violations, 1u);
+  EXPECT_EQ(stats.partial_result.max_latency_ns, kFrameDurationNs * 4);
+  ASSERT_EQ(stats.buffers.size(), 2u);
+  EXPECT_EQ(stats.buffers[kPreviewStreamId].count, 2u);
+  EXPECT_EQ(stats.buffers[kPreviewStreamId].violations, 0u);
+  EXPECT_EQ(stats.buffers[kVideoStreamId].count, 2u);
+  EXPECT_EQ(stats.buffers[kVideoStreamId].violations, 1u);
+}
+
+// Violations age out of the rolling window but stay in the totals.
+TEST_F(RequestWatchdogTests, RollingWindow) {
+  static constexpr uint32_t kWindowSize = 4;
+  CreateWatchdog({.shutter_slo_frames = 1, .window_size = kWindowSize});
+
+  uint32_t frame_number = 0;
+  for (uint32_t i = 0; i < 2; i++, frame_number++) {
+    Submit(frame_number, {});
+    now_ns_ += kFrameDurationNs * 2;
+    Shutter(frame_number);
+  }
+  auto stats = watchdog_->GetStats();
+  EXPECT_EQ(stats.shutter.window_count, 2u);
+  EXPECT_EQ(stats.shutter.window_violations, 2u);
+
+  for (uint32_t i = 0; i < kWindowSize; i++, frame_number++) {
+    Submit(frame_number, {});
+    now_ns_ += kFrameDurationNs / 2;
+    Shutter(frame_number);
+  }
+  stats = watchdog_->GetStats();
+  EXPECT_EQ(stats.shutter.count, kWindowSize + 2);
+  EXPECT_EQ(stats.shutter.violations, 2u);
+  EXPECT_EQ(stats.shutter.window_count, kWindowSize);
+  EXPECT_EQ(stats.shutter.window_violations, 0u);
+  EXPECT_EQ(stats.shutter.window_max_latency_ns, kFrameDurationNs / 2);
+  EXPECT_EQ(stats.shutter.max_latency_ns, kFrameDurationNs * 2);
+}
+
+// A request that stops making progress is reported once, with what every
+// pending request waits for.
+TEST_F(RequestWatchdogTests, ReportStalls) {
+  CreateWatchdog({.stall_timeout_frames = 30, .min_stall_timeout_ns = 0});
+
+  Submit(0, {kPreviewStreamId, kVideoStreamId});
+  now_ns_ += kFrameDurationNs;
+  Shutter(0);
+  Result(0, 1, {kPreviewStreamId});
+  Submit(1, {kPreviewStreamId});
+  EXPECT_EQ(watchdog_->CheckStalls(), 0u);
+
+  now_ns_ += kFrameDurationNs * 30;
+  EXPECT_EQ(watchdog_->CheckStalls(), 1u);
+  ASSERT_EQ(stalled_frame_numbers_.size(), 1u);
+  EXPECT_EQ(stalled_frame_numbers_[0], 0u);
+  ALOGI("%s: %s", __FUNCTION__, last_dump_.c_str());
+  EXPECT_NE(last_dump_.find("2 pending requests"), std::string::npos);
+  EXPECT_NE(last_dump_.find("1 buffer(s) of stream 1 (stalled)"),
+            std::string::npos);
+  EXPECT_NE(last_dump_.find("frame 0 holds back 1 later requests"),
+            std::string::npos);
+
+  // Frame 0 is not reported again.
+  now_ns_ += kFrameDurationNs;
+  EXPECT_EQ(watchdog_->CheckStalls(), 1u);
+  ASSERT_EQ(stalled_frame_numbers_.size(), 2u);
+  EXPECT_EQ(stalled_frame_numbers_[1], 1u);
+  EXPECT_EQ(watchdog_->CheckStalls(), 0u);
+  EXPECT_EQ(watchdog_->GetStats().stalls, 2u);
+
+  // Stalled requests can still complete.
+  Result(0, 0, {kVideoStreamId});
+  Shutter(1);
+  Result(1, 1, {kPreviewStreamId});
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 0u);
+}
+
+// The stall timeout is at least min_stall_timeout_ns.
+TEST_F(RequestWatchdogTests, MinStallTimeout) {
+  static constexpr int64_t kMinStallTimeoutNs = 2000000000;
+  CreateWatchdog({.min_stall_timeout_ns = kMinStallTimeoutNs});
+
+  Submit(0, {kPreviewStreamId});
+  now_ns_ += kMinStallTimeoutNs;
+  EXPECT_EQ(watchdog_->CheckStalls(), 0u);
+  now_ns_ += 1;
+  EXPECT_EQ(watchdog_->CheckStalls(), 1u);
+}
+
+TEST_F(RequestWatchdogTests, Errors) {
+  CreateWatchdog();
+
+  // The request is not processed.
+  Submit(0, {kPreviewStreamId});
+  Error(0, ErrorCode::kErrorRequest);
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 0u);
+
+  // No shutter or result metadata come after a result error.
+  Submit(1, {kPreviewStreamId});
+  Error(1, ErrorCode::kErrorResult);
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 1u);
+  Result(1, 0, {kPreviewStreamId});
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 0u);
+
+  // Failed buffers are returned in a result.
+  Submit(2, {kPreviewStreamId});
+  Shutter(2);
+  Result(2, 1, {});
+  Error(2, ErrorCode::kErrorBuffer);
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 1u);
+  Result(2, 0, {kPreviewStreamId});
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 0u);
+
+  Submit(3, {kPreviewStreamId});
+  Submit(4, {kPreviewStreamId});
+  watchdog_->OnRequestDropped(4);
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 1u);
+  Error(0, ErrorCode::kErrorDevice);
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 0u);
+}
+
+// Buffers are delivered, returned in error, or dropped with their request.
+TEST_F(RequestWatchdogTests, BufferAccounting) {
+  CreateWatchdog({.window_size = 4});
+
+  Submit(0, {kPreviewStreamId, kVideoStreamId});
+  Shutter(0);
+  Result(0, 1, {kPreviewStreamId});
+  Error(0, ErrorCode::kErrorBuffer);
+  Result(0, 0, {kVideoStreamId}, BufferStatus::kError);
+
+  Submit(1, {kPreviewStreamId, kVideoStreamId});
+  Error(1, ErrorCode::kErrorRequest);
+  // Buffers of a failed request are dropped, even though they are returned.
+  Result(1, 0, {kPreviewStreamId, kVideoStreamId}, BufferStatus::kError);
+
+  Submit(2, {kPreviewStreamId});
+  watchdog_->OnRequestDropped(2);
+  Submit(3, {kPreviewStreamId});
+  Error(3, ErrorCode::kErrorDevice);
+
+  auto stats = watchdog_->GetStats();
+  const auto& preview = stats.buffer_counts[kPreviewStreamId];
+  EXPECT_EQ(preview.requested, 4u);
+  EXPECT_EQ(preview.delivered, 1u);
+  EXPECT_EQ(preview.errors, 0u);
+  EXPECT_EQ(preview.dropped, 3u);
+  const auto& video = stats.buffer_counts[kVideoStreamId];
+  EXPECT_EQ(video.requested, 2u);
+  EXPECT_EQ(video.delivered, 0u);
+  EXPECT_EQ(video.errors, 1u);
+  EXPECT_EQ(video.dropped, 1u);
+
+  // Only the latest 4 preview buffers are in the window.
+  for (uint32_t frame_number = 4; frame_number < 7; frame_number++) {
+    Submit(frame_number, {kPreviewStreamId});
+    Shutter(frame_number);
+    Result(frame_number, 1, {kPreviewStreamId});
+  }
+  stats = watchdog_->GetStats();
+  EXPECT_EQ(stats.buffer_counts[kPreviewStreamId].window_count, 4u);
+  EXPECT_EQ(stats.buffer_counts[kPreviewStreamId].window_errors, 0u);
+  EXPECT_EQ(stats.buffer_counts[kPreviewStreamId].window_dropped, 1u);
+
+  // Buffers pending when the streams are reconfigured are dropped.
+  Submit(7, {kVideoStreamId});
+  watchdog_->Reset();
+  EXPECT_EQ(watchdog_->GetStats().buffer_counts[kVideoStreamId].dropped, 2u);
+
+  std::string dump = watchdog_->DumpStats("  ");
+  EXPECT_NE(dump.find("  8 requests, 0 pending, 0 stalls\n"),
+            std::string::npos);
+  EXPECT_NE(dump.find("stream 0: 7 requested, 4 delivered, 0 errors, "
+                      "3 dropped, window 4 (0 errors, 1 dropped)\n"),
+            std::string::npos)
+      << dump;
+}
+
+// Any stream of a group can return the buffer of the group.
+TEST_F(RequestWatchdogTests, GroupedStreams) {
+  static constexpr int32_t kGroupStreamId = 2;
+  CreateWatchdog();
+  watchdog_->Reset({{kGroupStreamId, kVideoStreamId}});
+
+  Submit(0, {kVideoStreamId});
+  Shutter(0);
+  Result(0, 1, {kGroupStreamId});
+  auto stats = watchdog_->GetStats();
+  EXPECT_EQ(stats.pending_requests, 0u);
+  EXPECT_EQ(stats.buffers[kVideoStreamId].count, 1u);
+
+  Submit(1, {kVideoStreamId});
+  watchdog_->Reset();
+  EXPECT_EQ(watchdog_->GetStats().pending_requests, 0u);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ThreadRoleManagerTests"
+#include <cutils/properties.h>
+#include <log/log.h>
+
+#include <gtest/gtest.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <system/thread_defs.h>
+#include <thread_role_manager.h>
+#include <time.h>
+#include <unistd.h>
+#include <utils/Timers.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+static constexpr ThreadRole kTestRole = ThreadRole::kRender;
+// Scheduling latency of a thread that has a CPU to itself.
+static constexpr nsecs_t kMaxPinnedLateness = 1'000'000;  // 1 ms
+
+class ThreadRoleManagerTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (uint32_t i = 0; i < kNumRoles; i++) {
+      original_policies_[i] = manager_.GetPolicy(static_cast<ThreadRole>(i));
+    }
+  }
+
+  void TearDown() override {
+    for (uint32_t i = 0; i < kNumRoles; i++) {
+      manager_.SetPolicy(static_cast<ThreadRole>(i), original_policies_[i]);
+    }
+  }
+
+  // Find the registered thread with tid in the statistics.
+  bool FindThread(pid_t tid, ThreadStats* stats) {
+    for (const auto& thread : manager_.GetStats()) {
+      if (thread.tid == tid) {
+        *stats = thread;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static constexpr uint32_t kNumRoles =
+      static_cast<uint32_t>(ThreadRole::kNumRoles);
+
+  ThreadRoleManager& manager_ = ThreadRoleManager::GetInstance();
+  ThreadPolicy original_policies_[kNumRoles];
+};
+
+TEST_F(ThreadRoleManagerTests, ParsePolicy) {
+  ThreadPolicy policy;
+  EXPECT_EQ(ThreadRoleManager::ParsePolicy("", &policy), OK);
+  EXPECT_EQ(policy.fifo_priority, 0);
+  EXPECT_EQ(policy.nice, 0);
+  EXPECT_TRUE(policy.cpus.empty());
+
+  EXPECT_EQ(ThreadRoleManager::ParsePolicy("fifo=2,cpus=4-7", &policy), OK);
+  EXPECT_EQ(policy.fifo_priority, 2);
+  EXPECT_EQ(policy.cpus, std::vector<uint32_t>({4, 5, 6, 7}));
+
+  EXPECT_EQ(ThreadRoleManager::ParsePolicy("cpus=6,0-1,1,nice=-4", &policy),
+            OK);
+  EXPECT_EQ(policy.fifo_priority, 0);
+  EXPECT_EQ(policy.nice, -4);
+  EXPECT_EQ(policy.cpus, std::vector<uint32_t>({0, 1, 6}));
+
+  for (const char* spec : {"fifo", "fifo=100", "nice=20", "nice=-21",
+                           "cpus=", "cpus=3-1", "cpus=a", "fifo=1,2",
+                           "priority=1"}) {
+    EXPECT_NE(ThreadRoleManager::ParsePolicy(spec, &policy), OK) << spec;
+  }
+  EXPECT_NE(ThreadRoleManager::ParsePolicy("", nullptr), OK);
+}
+
+TEST_F(ThreadRoleManagerTests, RenderPriority) {
+  char value[PROPERTY_VALUE_MAX];
+  if (property_get("persist.vendor.camera.thread_role.render", value, "") > 0) {
+    GTEST_SKIP() << "The render policy is overridden";
+  }
+
+  // Threads of the render role don't keep the priority of their creator.
+  ThreadPolicy policy = manager_.GetPolicy(ThreadRole::kRender);
+  EXPECT_EQ(policy.fifo_priority, 0);
+  EXPECT_EQ(policy.nice, ANDROID_PRIORITY_URGENT_DISPLAY);
+}
+
+TEST_F(ThreadRoleManagerTests, ApplyPolicy) {
+  cpu_set_t allowed_cpus;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus), 0);
+  uint32_t cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed_cpus)) {
+    cpu++;
+  }
+
+  // Raising the nice value and pinning to an allowed CPU need no privileges.
+  ThreadPolicy policy = {.nice = 5, .cpus = {cpu}};
+  manager_.SetPolicy(kTestRole, policy);
+  std::thread thread([&] {
+    ScopedThreadRole role(kTestRole, "ApplyPolicy");
+    pid_t tid = gettid();
+    // Run for a while, to make sure the thread was scheduled on the CPU.
+    sched_yield();
+
+    ThreadStats stats;
+    ASSERT_TRUE(FindThread(tid, &stats));
+    EXPECT_EQ(stats.name, "ApplyPolicy");
+    EXPECT_EQ(stats.role, kTestRole);
+    EXPECT_FALSE(stats.realtime);
+    EXPECT_TRUE(stats.pinned);
+    EXPECT_EQ(stats.nice, 5);
+    EXPECT_EQ(stats.cpu, static_cast<int32_t>(cpu));
+    EXPECT_GT(stats.voluntary_switches + stats.involuntary_switches, 0u);
+
+    // Registered threads follow the policy of their role.
+    manager_.SetPolicy(kTestRole, {.nice = 6});
+    ASSERT_TRUE(FindThread(tid, &stats));
+    EXPECT_EQ(stats.nice, 6);
+    EXPECT_FALSE(stats.pinned);
+  });
+  thread.join();
+}
+
+TEST_F(ThreadRoleManagerTests, RealtimeFallback) {
+  // SCHED_FIFO may not be permitted, the thread falls back to the nice
+  // value of the policy.
+  manager_.SetPolicy(kTestRole, {.fifo_priority = 1, .nice = 3});
+  std::thread thread([&] {
+    ScopedThreadRole role(kTestRole, "RealtimeFallback");
+    bool realtime = (sched_getscheduler(0) & ~SCHED_RESET_ON_FORK) == SCHED_FIFO;
+
+    ThreadStats stats;
+    ASSERT_TRUE(FindThread(gettid(), &stats));
+    EXPECT_EQ(stats.realtime, realtime);
+    if (!realtime) {
+      EXPECT_EQ(stats.nice, 3);
+    }
+  });
+  thread.join();
+}
+
+TEST_F(ThreadRoleManagerTests, RemoveExitedThreads) {
+  pid_t unregistered_tid = 0;
+  std::thread unregistered([&] {
+    unregistered_tid = gettid();
+    EXPECT_EQ(manager_.RegisterCurrentThread(kTestRole, "Unregistered"), OK);
+  });
+  unregistered.join();
+
+  pid_t scoped_tid = 0;
+  std::thread scoped([&] {
+    scoped_tid = gettid();
+    ScopedThreadRole role(kTestRole, "Scoped");
+  });
+  scoped.join();
+
+  ThreadStats stats;
+  EXPECT_FALSE(FindThread(unregistered_tid, &stats));
+  EXPECT_FALSE(FindThread(scoped_tid, &stats));
+  EXPECT_NE(manager_.RegisterCurrentThread(ThreadRole::kNumRoles, "Invalid"),
+            OK);
+}
+
+// Lateness of the frame pacing wakeups.
+struct FramePacingJitter {
+  nsecs_t median = 0;
+  nsecs_t p99 = 0;
+  nsecs_t max = 0;
+};
+
+// Pace frames on a thread of the frame pacing role, while a housekeeping
+// thread per allowed CPU keeps the CPUs busy.
+static FramePacingJitter MeasureFramePacingJitter(uint32_t num_cpus) {
+  constexpr nsecs_t kFrameInterval = 4'000'000;  // 250 fps
+  constexpr uint32_t kNumFrames = 300;
+
+  std::atomic_bool done = false;
+  std::vector<std::thread> load;
+  for (uint32_t i = 0; i < num_cpus; i++) {
+    load.emplace_back([&done] {
+      ScopedThreadRole role(ThreadRole::kHousekeeping, "Load");
+      while (!done) {
+      }
+    });
+  }
+
+  std::vector<nsecs_t> lateness;
+  std::thread pacing([&lateness] {
+    ScopedThreadRole role(ThreadRole::kFramePacing, "Pacing");
+    nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (uint32_t i = 0; i < kNumFrames; i++) {
+      deadline += kFrameInterval;
+      struct timespec t = {.tv_sec = static_cast<time_t>(deadline / 1000000000),
+                           .tv_nsec = static_cast<long>(deadline % 1000000000)};
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, nullptr) ==
+             EINTR) {
+      }
+      lateness.push_back(systemTime(SYSTEM_TIME_MONOTONIC) - deadline);
+    }
+  });
+  pacing.join();
+  done = true;
+  for (auto& thread : load) {
+    thread.join();
+  }
+
+  std::sort(lateness.begin(), lateness.end());
+  return {.median = lateness[lateness.size() / 2],
+          .p99 = lateness[lateness.size() * 99 / 100],
+          .max = lateness.back()};
+}
+
+TEST_F(ThreadRoleManagerTests, PinnedFramePacingJitter) {
+  cpu_set_t allowed_cpus;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus), 0);
+  std::vector<uint32_t> cpus;
+  for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed_cpus)) {
+      cpus.push_back(cpu);
+    }
+  }
+  if (cpus.size() < 2) {
+    GTEST_SKIP() << "Pinning needs at least 2 CPUs";
+  }
+
+  // Every thread may run anywhere.
+  manager_.SetPolicy(ThreadRole::kFramePacing, {});
+  manager_.SetPolicy(ThreadRole::kHousekeeping, {});
+  FramePacingJitter shared = MeasureFramePacingJitter(cpus.size());
+
+  // Frame pacing gets a CPU of its own, e.g. "cpus=7" with "cpus=0-6" for
+  // housekeeping.
+  manager_.SetPolicy(ThreadRole::kFramePacing, {.cpus = {cpus.back()}});
+  manager_.SetPolicy(ThreadRole::kHousekeeping,
+                     {.cpus = std::vector<uint32_t>(cpus.begin(),
+                                                    cpus.end() - 1)});
+  FramePacingJitter pinned = MeasureFramePacingJitter(cpus.size());
+
+  ALOGI("%s: %zu CPUs, lateness median/p99/max shared %" PRId64 "/%" PRId64
+        "/%" PRId64 " us, pinned %" PRId64 "/%" PRId64 "/%" PRId64 " us",
+        __FUNCTION__, cpus.size(), ns2us(shared.median), ns2us(shared.p99),
+        ns2us(shared.max), ns2us(pinned.median), ns2us(pinned.p99),
+        ns2us(pinned.max));
+  // The CPU of its own keeps the wakeups on time, and never makes them later
+  // than sharing the CPUs with the load.
+  EXPECT_LE(pinned.p99, std::max(shared.p99, kMaxPinnedLateness));
+}
+
+TEST_F(ThreadRoleManagerTests, Dump) {
+  std::FILE* f = std::tmpfile();
+  ASSERT_NE(f, nullptr);
+  {
+    ScopedThreadRole role(kTestRole, "DumpTest");
+    manager_.Dump(fileno(f));
+  }
+
+  std::rewind(f);
+  std::string dump;
+  char line[512];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    dump += line;
+  }
+  std::fclose(f);
+
+  EXPECT_NE(dump.find("Thread roles:"), std::string::npos);
+  EXPECT_NE(dump.find("render"), std::string::npos);
+  EXPECT_NE(dump.find("DumpTest"), std::string::npos);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
@@ -158,6 +158,52 @@ TEST(ZslBufferManagerTests, GetRecentBuffers) {
   }
 }
 
+// Test ZslBufferManager GetMostRecentZslBuffers with the settled policy.
+// Only buffers captured with AE converged are returned, oldest first, and
+// the most recent buffers are returned if none is settled.
+TEST(ZslBufferManagerTests, GetSettledBuffers) {
+  static const uint32_t kNumFilledBuffers = 8;
+  static const uint32_t kGetTotalBufferNum = 3;
+  auto manager = std::make_unique<ZslBufferManager>();
+  ASSERT_NE(manager, nullptr) << "Creating ZslBufferManager failed.";
+  status_t res = manager->AllocateBuffers(kRawBufferDescriptor);
+  ASSERT_EQ(res, OK) << "AllocateBuffers failed: " << strerror(res);
+
+  // Fill the zsl buffers, AE is converged on even frames only.
+  for (uint32_t i = 0; i < kNumFilledBuffers; i++) {
+    StreamBuffer stream_buffer = {.buffer = manager->GetEmptyBuffer()};
+    ASSERT_NE(stream_buffer.buffer, kInvalidBufferHandle);
+    ASSERT_EQ(manager->ReturnFilledBuffer(i, stream_buffer), OK);
+
+    auto metadata = HalCameraMetadata::Create(kNumEntries, kDataBytes);
+    SetMetadata(metadata);
+    uint8_t ae_state = i % 2 == 0 ? ANDROID_CONTROL_AE_STATE_CONVERGED
+                                  : ANDROID_CONTROL_AE_STATE_SEARCHING;
+    ASSERT_EQ(metadata->Set(ANDROID_CONTROL_AE_STATE, &ae_state, 1), OK);
+    ASSERT_EQ(manager->ReturnMetadata(i, metadata.get(), /*partial_result=*/1),
+              OK);
+  }
+
+  std::vector<ZslBufferManager::ZslBuffer> settled_buffers;
+  manager->GetMostRecentZslBuffers(&settled_buffers, kGetTotalBufferNum,
+                                   /*min_buffers=*/1,
+                                   ZslBufferManager::SelectionPolicy::kSettled);
+  ASSERT_EQ(settled_buffers.size(), kGetTotalBufferNum);
+  EXPECT_EQ(settled_buffers[0].frame_number, 2u);
+  EXPECT_EQ(settled_buffers[1].frame_number, 4u);
+  EXPECT_EQ(settled_buffers[2].frame_number, 6u);
+
+  // Only frames 0 and 7 are left, take the settled one.
+  std::vector<ZslBufferManager::ZslBuffer> buffers;
+  manager->GetMostRecentZslBuffers(&buffers, kGetTotalBufferNum,
+                                   /*min_buffers=*/1,
+                                   ZslBufferManager::SelectionPolicy::kSettled);
+  ASSERT_EQ(buffers.size(), 1u);
+  EXPECT_EQ(buffers[0].frame_number, 0u);
+  manager->ReturnZslBuffers(std::move(buffers));
+  manager->ReturnZslBuffers(std::move(settled_buffers));
+}
+
 // Test ZslBufferManager ReturnMetadata.
 // If allocated_metadata_ size is greater than kMaxAllcatedMetadataSize(100),
 // ReturnMetadata() will return error and not allocate new metadata.
@@ -194,7 +240,7 @@ TEST(ZslBufferManagerTests, PendingBuffer) {
   std::vector<ZslBufferManager::ZslBuffer> filled_buffers;
   ZslBufferManager::ZslBuffer zsl_buffer;
   filled_buffers.push_back(std::move(zsl_buffer));
-  manager->AddPendingBuffers(filled_buffers);
+  manager->AddPendingBuffers(/*frame_number=*/0, filled_buffers);
 
   // Pending buffer is not empty after call AddPendingBuffers.
   empty = manager->IsPendingBufferEmpty();
@@ -208,5 +254,45 @@ TEST(ZslBufferManagerTests, PendingBuffer) {
       << "Pending buffer is not empty after CleanPendingBuffers.";
 }
 
+TEST(ZslBufferManagerTests, PendingBuffersPerRequest) {
+  auto manager = std::make_unique<ZslBufferManager>();
+  ASSERT_NE(manager, nullptr) << "Creating ZslBufferManager failed.";
+
+  // Two requests hold their own pending buffers.
+  const uint32_t kRequestFrameNumbers[] = {10, 11};
+  const uint32_t kBuffersPerRequest = 3;
+  for (uint32_t request_frame_number : kRequestFrameNumbers) {
+    std::vector<ZslBufferManager::ZslBuffer> filled_buffers(
+        kBuffersPerRequest);
+    for (auto& zsl_buffer : filled_buffers) {
+      zsl_buffer.frame_number = request_frame_number;
+    }
+    manager->AddPendingBuffers(request_frame_number, filled_buffers);
+  }
+  EXPECT_EQ(manager->GetPendingRequestCount(), 2u);
+
+  // Cleaning the buffers of one request keeps the buffers of the other one.
+  std::vector<ZslBufferManager::ZslBuffer> buffers;
+  ASSERT_EQ(manager->CleanPendingBuffers(kRequestFrameNumbers[0], &buffers),
+            OK);
+  ASSERT_EQ(buffers.size(), kBuffersPerRequest);
+  for (auto& zsl_buffer : buffers) {
+    EXPECT_EQ(zsl_buffer.frame_number, kRequestFrameNumbers[0]);
+  }
+  EXPECT_EQ(manager->GetPendingRequestCount(), 1u);
+  EXPECT_FALSE(manager->IsPendingBufferEmpty());
+
+  buffers.clear();
+  EXPECT_EQ(manager->CleanPendingBuffers(kRequestFrameNumbers[0], &buffers),
+            NAME_NOT_FOUND);
+  EXPECT_TRUE(buffers.empty());
+
+  ASSERT_EQ(manager->CleanPendingBuffers(kRequestFrameNumbers[1], &buffers),
+            OK);
+  EXPECT_EQ(buffers.size(), kBuffersPerRequest);
+  EXPECT_EQ(manager->GetPendingRequestCount(), 0u);
+  EXPECT_TRUE(manager->IsPendingBufferEmpty());
+}
+
 }  // namespace google_camera_hal
 }  // namespace android
@@ -0,0 +1,489 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "GCH_BurstMergeProcessBlock"
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+#include "burst_merge_process_block.h"
+
+#include <hardware/gralloc.h>
+#include <inttypes.h>
+#include <log/log.h>
+#include <pthread.h>
+#include <ui/GraphicBufferMapper.h>
+#include <ui/Rect.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+
+#include "gralloc_buffer_allocator.h"
+#include "result_processor.h"
+#include "thread_role_manager.h"
+
+namespace android {
+namespace google_camera_hal {
+
+namespace {
+
+CaptureRequest CopyRequest(const CaptureRequest& request) {
+  CaptureRequest copy;
+  copy.frame_number = request.frame_number;
+  copy.settings = HalCameraMetadata::Clone(request.settings.get());
+  copy.input_buffers = request.input_buffers;
+  for (const auto& metadata : request.input_buffer_metadata) {
+    copy.input_buffer_metadata.push_back(
+        HalCameraMetadata::Clone(metadata.get()));
+  }
+  copy.output_buffers = request.output_buffers;
+  for (const auto& [camera_id, settings] : request.physical_camera_settings) {
+    copy.physical_camera_settings[camera_id] =
+        HalCameraMetadata::Clone(settings.get());
+  }
+  copy.input_width = request.input_width;
+  copy.input_height = request.input_height;
+  return copy;
+}
+
+// Lock buffer for usage and describe its planes in image.
+status_t LockImage(buffer_handle_t buffer, uint32_t usage, uint32_t width,
+                   uint32_t height, BurstImage* image) {
+  android_ycbcr ycbcr = {};
+  status_t res = GraphicBufferMapper::get().lockYCbCr(
+      buffer, usage, android::Rect(width, height), &ycbcr);
+  if (res != OK) {
+    ALOGE("%s: Locking a buffer failed: %s (%d)", __FUNCTION__, strerror(-res),
+          res);
+    return res;
+  }
+
+  *image = {.y = static_cast<uint8_t*>(ycbcr.y),
+            .cb = static_cast<uint8_t*>(ycbcr.cb),
+            .cr = static_cast<uint8_t*>(ycbcr.cr),
+            .y_stride = static_cast<uint32_t>(ycbcr.ystride),
+            .cbcr_stride = static_cast<uint32_t>(ycbcr.cstride),
+            .cbcr_step = static_cast<uint32_t>(ycbcr.chroma_step),
+            .width = width,
+            .height = height};
+  return OK;
+}
+
+}  // namespace
+
+class BurstMergeProcessBlock::ScratchReleasingResultProcessor
+    : public ResultProcessor {
+ public:
+  ScratchReleasingResultProcessor(
+      BurstMergeProcessBlock* block,
+      std::unique_ptr<ResultProcessor> result_processor)
+      : block_(block), result_processor_(std::move(result_processor)) {
+  }
+
+  void SetResultCallback(
+      ProcessCaptureResultFunc process_capture_result, NotifyFunc notify,
+      ProcessBatchCaptureResultFunc process_batch_capture_result) override {
+    result_processor_->SetResultCallback(process_capture_result, notify,
+                                         process_batch_capture_result);
+  }
+
+  status_t AddPendingRequests(
+      const std::vector<ProcessBlockRequest>& process_block_requests,
+      const CaptureRequest& remaining_session_request) override {
+    return result_processor_->AddPendingRequests(process_block_requests,
+                                                 remaining_session_request);
+  }
+
+  void ProcessResult(ProcessBlockResult block_result) override {
+    ReleaseScratchBuffer(&block_result);
+    result_processor_->ProcessResult(std::move(block_result));
+  }
+
+  void ProcessBatchResult(
+      std::vector<ProcessBlockResult> block_results) override {
+    for (auto& block_result : block_results) {
+      ReleaseScratchBuffer(&block_result);
+    }
+    result_processor_->ProcessBatchResult(std::move(block_results));
+  }
+
+  void Notify(const ProcessBlockNotifyMessage& block_message) override {
+    result_processor_->Notify(block_message);
+  }
+
+  status_t FlushPendingRequests() override {
+    return result_processor_->FlushPendingRequests();
+  }
+
+ private:
+  void ReleaseScratchBuffer(ProcessBlockResult* block_result) {
+    // Like SnapshotResultProcessor returns the ZSL inputs, the inputs are
+    // done once the output buffers are.
+    CaptureResult* result = block_result->result.get();
+    if (result != nullptr && !result->output_buffers.empty()) {
+      block_->ReleaseScratchBuffer(result->frame_number,
+                                   &result->input_buffers);
+    }
+  }
+
+  BurstMergeProcessBlock* const block_;
+  std::unique_ptr<ResultProcessor> result_processor_;
+};
+
+std::unique_ptr<BurstMergeProcessBlock> BurstMergeProcessBlock::Create(
+    std::unique_ptr<ProcessBlock> snapshot_process_block) {
+  ATRACE_CALL();
+  if (snapshot_process_block == nullptr) {
+    ALOGE("%s: snapshot_process_block is nullptr", __FUNCTION__);
+    return nullptr;
+  }
+
+  auto buffer_allocator = GrallocBufferAllocator::Create();
+  if (buffer_allocator == nullptr) {
+    ALOGE("%s: Creating the scratch buffer allocator failed.", __FUNCTION__);
+    return nullptr;
+  }
+
+  return std::unique_ptr<BurstMergeProcessBlock>(new BurstMergeProcessBlock(
+      std::move(snapshot_process_block), std::move(buffer_allocator)));
+}
+
+BurstMergeProcessBlock::BurstMergeProcessBlock(
+    std::unique_ptr<ProcessBlock> snapshot_process_block,
+    std::unique_ptr<IHalBufferAllocator> buffer_allocator)
+    : snapshot_process_block_(std::move(snapshot_process_block)),
+      buffer_allocator_(std::move(buffer_allocator)) {
+  merge_thread_ = std::thread([this] { MergeThreadLoop(); });
+}
+
+BurstMergeProcessBlock::~BurstMergeProcessBlock() {
+  {
+    std::lock_guard<std::mutex> lock(queue_lock_);
+    merge_thread_exiting_ = true;
+  }
+  queue_condition_.notify_one();
+  merge_thread_.join();
+
+  if (merger_ != nullptr) {
+    const BurstMerger::Stats& stats = merger_->GetStats();
+    if (stats.merges > 0) {
+      ALOGI("%s: %" PRIu64 " merges of %" PRIu64 " frames, mean %" PRId64
+            " us, max %" PRId64 " us",
+            __FUNCTION__, stats.merges, stats.frames,
+            stats.total_duration_ns / 1000 / stats.merges,
+            stats.max_duration_ns / 1000);
+    }
+  }
+
+  // Results stop before the scratch buffers are freed.
+  snapshot_process_block_ = nullptr;
+  buffer_allocator_->FreeBuffers(&scratch_buffers_);
+}
+
+status_t BurstMergeProcessBlock::ConfigureStreams(
+    const StreamConfiguration& stream_config,
+    const StreamConfiguration& overall_config) {
+  ATRACE_CALL();
+  for (const auto& stream : stream_config.streams) {
+    if (stream.stream_type != StreamType::kInput ||
+        stream.format != HAL_PIXEL_FORMAT_YCBCR_420_888) {
+      continue;
+    }
+
+    merger_ = BurstMerger::Create(
+        {.width = stream.width, .height = stream.height});
+    if (merger_ == nullptr) {
+      ALOGW("%s: ZSL stream %dx%d can't be merged.", __FUNCTION__,
+            stream.width, stream.height);
+      break;
+    }
+
+    HalBufferDescriptor buffer_descriptor = {
+        .width = stream.width,
+        .height = stream.height,
+        .format = HAL_PIXEL_FORMAT_YCBCR_420_888,
+        .producer_flags = GRALLOC_USAGE_SW_WRITE_OFTEN,
+        .consumer_flags =
+            GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_CAMERA_READ,
+        .immediate_num_buffers = kNumScratchBuffers,
+        .max_num_buffers = kNumScratchBuffers};
+    buffer_allocator_->FreeBuffers(&scratch_buffers_);
+    status_t res = buffer_allocator_->AllocateBuffers(buffer_descriptor,
+                                                      &scratch_buffers_);
+    if (res != OK) {
+      ALOGW("%s: Allocating scratch buffers failed: %s (%d)", __FUNCTION__,
+            strerror(-res), res);
+      merger_ = nullptr;
+      break;
+    }
+    {
+      std::lock_guard<std::mutex> lock(scratch_lock_);
+      free_scratch_buffers_ = scratch_buffers_;
+      used_scratch_buffers_.clear();
+    }
+    zsl_stream_id_ = stream.id;
+    zsl_width_ = stream.width;
+    zsl_height_ = stream.height;
+    ALOGI("%s: Merging the inputs of ZSL stream %d (%ux%u).", __FUNCTION__,
+          zsl_stream_id_, zsl_width_, zsl_height_);
+    break;
+  }
+
+  return snapshot_process_block_->ConfigureStreams(stream_config,
+                                                   overall_config);
+}
+
+status_t BurstMergeProcessBlock::SetResultProcessor(
+    std::unique_ptr<ResultProcessor> result_processor) {
+  ATRACE_CALL();
+  if (result_processor == nullptr) {
+    ALOGE("%s: result_processor is nullptr", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  ResultProcessor* processor = result_processor.get();
+  status_t res = snapshot_process_block_->SetResultProcessor(
+      std::make_unique<ScratchReleasingResultProcessor>(
+          this, std::move(result_processor)));
+  if (res == OK) {
+    result_processor_ = processor;
+  }
+  return res;
+}
+
+status_t BurstMergeProcessBlock::GetConfiguredHalStreams(
+    std::vector<HalStream>* hal_streams) const {
+  return snapshot_process_block_->GetConfiguredHalStreams(hal_streams);
+}
+
+status_t BurstMergeProcessBlock::ProcessRequests(
+    const std::vector<ProcessBlockRequest>& process_block_requests,
+    const CaptureRequest& remaining_session_request) {
+  ATRACE_CALL();
+  PendingRequests requests;
+  for (const auto& block_request : process_block_requests) {
+    ProcessBlockRequest request;
+    request.request_id = block_request.request_id;
+    request.request = CopyRequest(block_request.request);
+    requests.block_requests.push_back(std::move(request));
+  }
+  requests.remaining_session_request = CopyRequest(remaining_session_request);
+
+  {
+    std::lock_guard<std::mutex> lock(queue_lock_);
+    pending_requests_.push_back(std::move(requests));
+  }
+  queue_condition_.notify_one();
+  return OK;
+}
+
+status_t BurstMergeProcessBlock::Flush() {
+  ATRACE_CALL();
+  std::deque<PendingRequests> dropped_requests;
+  {
+    std::unique_lock<std::mutex> lock(queue_lock_);
+    dropped_requests.swap(pending_requests_);
+    idle_condition_.wait(lock, [this] { return !merging_; });
+  }
+
+  for (auto& requests : dropped_requests) {
+    FailRequests(&requests);
+  }
+  return snapshot_process_block_->Flush();
+}
+
+void BurstMergeProcessBlock::RepeatingRequestEnd(
+    int32_t frame_number, const std::vector<int32_t>& stream_ids) {
+  snapshot_process_block_->RepeatingRequestEnd(frame_number, stream_ids);
+}
+
+void BurstMergeProcessBlock::MergeThreadLoop() {
+  pthread_setname_np(pthread_self(), "BurstMerge");
+  ScopedThreadRole role(ThreadRole::kRender, "BurstMerge");
+
+  while (true) {
+    PendingRequests requests;
+    {
+      std::unique_lock<std::mutex> lock(queue_lock_);
+      queue_condition_.wait(lock, [this] {
+        return merge_thread_exiting_ || !pending_requests_.empty();
+      });
+      // Forward the queued requests before exiting.
+      if (pending_requests_.empty()) {
+        return;
+      }
+      requests = std::move(pending_requests_.front());
+      pending_requests_.pop_front();
+      merging_ = true;
+    }
+
+    for (auto& block_request : requests.block_requests) {
+      status_t res = MergeInputs(&block_request.request,
+                                 &requests.remaining_session_request);
+      if (res != OK) {
+        ALOGW("%s: Frame %u is processed without merging: %s (%d)",
+              __FUNCTION__, block_request.request.frame_number,
+              strerror(-res), res);
+      }
+    }
+    ForwardRequests(&requests);
+
+    {
+      std::lock_guard<std::mutex> lock(queue_lock_);
+      merging_ = false;
+    }
+    idle_condition_.notify_all();
+  }
+}
+
+status_t BurstMergeProcessBlock::MergeInputs(
+    CaptureRequest* request, CaptureRequest* remaining_session_request) {
+  ATRACE_CALL();
+  if (merger_ == nullptr || request->input_buffers.size() < 2) {
+    return OK;
+  }
+
+  buffer_handle_t scratch_buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(scratch_lock_);
+    if (free_scratch_buffers_.empty() ||
+        used_scratch_buffers_.count(request->frame_number) > 0) {
+      return NO_MEMORY;
+    }
+    scratch_buffer = free_scratch_buffers_.back();
+    free_scratch_buffers_.pop_back();
+  }
+
+  // ZSL inputs are ordered from the oldest to the newest. Their fences are
+  // not set, ZslBufferManager only hands out filled buffers.
+  uint32_t num_frames = std::min<uint32_t>(request->input_buffers.size(),
+                                           BurstMerger::Config().max_frames);
+  auto first_input = request->input_buffers.end() - num_frames;
+  std::vector<BurstImage> frames;
+  std::vector<buffer_handle_t> locked_buffers;
+  status_t res = OK;
+  for (auto input = first_input; input != request->input_buffers.end();
+       input++) {
+    if (input->stream_id != zsl_stream_id_) {
+      ALOGE("%s: Input of stream %d is not a ZSL buffer.", __FUNCTION__,
+            input->stream_id);
+      res = BAD_VALUE;
+      break;
+    }
+
+    frames.emplace_back();
+    res = LockImage(input->buffer, GRALLOC_USAGE_SW_READ_OFTEN, zsl_width_,
+                    zsl_height_, &frames.back());
+    if (res != OK) {
+      break;
+    }
+    locked_buffers.push_back(input->buffer);
+  }
+
+  BurstImage output;
+  if (res == OK) {
+    res = LockImage(scratch_buffer, GRALLOC_USAGE_SW_WRITE_OFTEN, zsl_width_,
+                    zsl_height_, &output);
+    if (res == OK) {
+      locked_buffers.push_back(scratch_buffer);
+    }
+  }
+  if (res == OK) {
+    res = merger_->Merge(frames, frames.size() - 1, output);
+  }
+
+  for (auto buffer : locked_buffers) {
+    GraphicBufferMapper::get().unlock(buffer);
+  }
+
+  std::lock_guard<std::mutex> lock(scratch_lock_);
+  if (res != OK) {
+    free_scratch_buffers_.push_back(scratch_buffer);
+    return res;
+  }
+
+  buffer_handle_t reference = request->input_buffers.back().buffer;
+  request->input_buffers.back().buffer = scratch_buffer;
+  for (auto& input : remaining_session_request->input_buffers) {
+    if (input.buffer == reference) {
+      input.buffer = scratch_buffer;
+    }
+  }
+  used_scratch_buffers_[request->frame_number] = {scratch_buffer, reference};
+  return OK;
+}
+
+void BurstMergeProcessBlock::ForwardRequests(PendingRequests* requests) {
+  ATRACE_CALL();
+  status_t res = snapshot_process_block_->ProcessRequests(
+      requests->block_requests, requests->remaining_session_request);
+  if (res == OK) {
+    return;
+  }
+
+  ALOGE("%s: Snapshot process block failed: %s (%d)", __FUNCTION__,
+        strerror(-res), res);
+  FailRequests(requests);
+}
+
+void BurstMergeProcessBlock::FailRequests(PendingRequests* requests) {
+  ATRACE_CALL();
+  for (auto& block_request : requests->block_requests) {
+    CaptureRequest& request = block_request.request;
+    ReleaseScratchBuffer(request.frame_number, &request.input_buffers);
+    if (result_processor_ == nullptr) {
+      continue;
+    }
+
+    NotifyMessage message = {
+        .type = MessageType::kError,
+        .message.error = {.frame_number = request.frame_number,
+                          .error_stream_id = -1,
+                          .error_code = ErrorCode::kErrorRequest}};
+    result_processor_->Notify(
+        {.request_id = block_request.request_id, .message = message});
+
+    // The result processor returns the ZSL inputs with the output buffers.
+    auto result = std::make_unique<CaptureResult>(CaptureResult({}));
+    result->frame_number = request.frame_number;
+    result->output_buffers = request.output_buffers;
+    for (auto& buffer : result->output_buffers) {
+      buffer.status = BufferStatus::kError;
+    }
+    result->input_buffers = request.input_buffers;
+    result_processor_->ProcessResult(
+        {.request_id = block_request.request_id, .result = std::move(result)});
+  }
+}
+
+void BurstMergeProcessBlock::ReleaseScratchBuffer(
+    uint32_t frame_number, std::vector<StreamBuffer>* input_buffers) {
+  std::lock_guard<std::mutex> lock(scratch_lock_);
+  auto used = used_scratch_buffers_.find(frame_number);
+  if (used == used_scratch_buffers_.end()) {
+    return;
+  }
+
+  auto [scratch_buffer, reference] = used->second;
+  for (auto& input : *input_buffers) {
+    if (input.buffer == scratch_buffer) {
+      input.buffer = reference;
+    }
+  }
+  free_scratch_buffers_.push_back(scratch_buffer);
+  used_scratch_buffers_.erase(used);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_BURST_MERGE_PROCESS_BLOCK_H_
+#define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_BURST_MERGE_PROCESS_BLOCK_H_
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "burst_merger.h"
+#include "hal_buffer_allocator.h"
+#include "process_block.h"
+
+namespace android {
+namespace google_camera_hal {
+
+// BurstMergeProcessBlock implements a ProcessBlock that denoises the YUV ZSL
+// inputs of snapshot requests with BurstMerger, and forwards the requests to
+// the snapshot process block it wraps.
+//
+// SnapshotRequestProcessor gathers the inputs from ZslBufferManager, from the
+// oldest to the newest. The newest is the reference. The merge is written
+// into a scratch buffer that replaces the reference in the forwarded request,
+// so the ZSL buffers are never written and return to the ZSL ring unchanged.
+// A later snapshot can pick them again without merging a merged frame. The
+// scratch buffer is reused once the result with the output buffers of the
+// request arrives, and the reference is put back into its input buffers.
+//
+// A merge takes tens of milliseconds, so requests are merged and forwarded in
+// order on a merge thread instead of the thread of ProcessRequests(). A
+// request the wrapped block rejects there fails with an error notification
+// and error buffers. Requests that can't be merged, e.g. when all scratch
+// buffers are in use, are forwarded unchanged.
+class BurstMergeProcessBlock : public ProcessBlock {
+ public:
+  // Create a BurstMergeProcessBlock forwarding the requests to
+  // snapshot_process_block.
+  static std::unique_ptr<BurstMergeProcessBlock> Create(
+      std::unique_ptr<ProcessBlock> snapshot_process_block);
+
+  virtual ~BurstMergeProcessBlock();
+
+  // Override functions of ProcessBlock start.
+  // The YCBCR_420_888 input stream of stream_config is the ZSL stream.
+  status_t ConfigureStreams(const StreamConfiguration& stream_config,
+                            const StreamConfiguration& overall_config) override;
+
+  status_t SetResultProcessor(
+      std::unique_ptr<ResultProcessor> result_processor) override;
+
+  status_t GetConfiguredHalStreams(
+      std::vector<HalStream>* hal_streams) const override;
+
+  status_t ProcessRequests(
+      const std::vector<ProcessBlockRequest>& process_block_requests,
+      const CaptureRequest& remaining_session_request) override;
+
+  // Fail the queued requests that aren't being merged yet, wait for the one
+  // being merged, and flush the snapshot process block.
+  status_t Flush() override;
+  // Override functions of ProcessBlock end.
+
+  void RepeatingRequestEnd(int32_t frame_number,
+                           const std::vector<int32_t>& stream_ids) override;
+
+ protected:
+  BurstMergeProcessBlock(
+      std::unique_ptr<ProcessBlock> snapshot_process_block,
+      std::unique_ptr<IHalBufferAllocator> buffer_allocator);
+
+ private:
+  // Number of scratch buffers, i.e. of merged snapshots in flight at a time.
+  static constexpr uint32_t kNumScratchBuffers = 2;
+
+  struct PendingRequests {
+    std::vector<ProcessBlockRequest> block_requests;
+    CaptureRequest remaining_session_request;
+  };
+
+  // Result processor given to the snapshot process block. Releases the
+  // scratch buffers and forwards to the result processor of this block.
+  class ScratchReleasingResultProcessor;
+
+  void MergeThreadLoop();
+
+  // Merge the ZSL inputs of request into a scratch buffer, and replace the
+  // newest input of request and remaining_session_request with it.
+  status_t MergeInputs(CaptureRequest* request,
+                       CaptureRequest* remaining_session_request);
+
+  // Forward requests to the snapshot process block, and fail them if they are
+  // rejected.
+  void ForwardRequests(PendingRequests* requests);
+
+  // Send an error notification and error buffers for requests.
+  void FailRequests(PendingRequests* requests);
+
+  // Release the scratch buffer of frame_number, if any, and put the ZSL
+  // reference back in place of it in input_buffers.
+  void ReleaseScratchBuffer(uint32_t frame_number,
+                            std::vector<StreamBuffer>* input_buffers);
+
+  std::unique_ptr<ProcessBlock> snapshot_process_block_;
+  // Owned by snapshot_process_block_.
+  ResultProcessor* result_processor_ = nullptr;
+
+  std::unique_ptr<IHalBufferAllocator> buffer_allocator_;
+
+  // ZSL stream, set by ConfigureStreams() before the first request.
+  int32_t zsl_stream_id_ = -1;
+  uint32_t zsl_width_ = 0;
+  uint32_t zsl_height_ = 0;
+  // Used by the merge thread only after ConfigureStreams(). nullptr if the
+  // ZSL stream is not YUV or the scratch buffers can't be allocated.
+  std::unique_ptr<BurstMerger> merger_;
+  // Allocated by ConfigureStreams().
+  std::vector<buffer_handle_t> scratch_buffers_;
+
+  std::mutex scratch_lock_;
+  // Scratch buffers not in use. Protected by scratch_lock_.
+  std::vector<buffer_handle_t> free_scratch_buffers_;
+  // Maps from frame number to the scratch buffer holding its merge and the
+  // ZSL reference it replaced. Protected by scratch_lock_.
+  std::map<uint32_t, std::pair<buffer_handle_t, buffer_handle_t>>
+      used_scratch_buffers_;
+
+  std::mutex queue_lock_;
+  // Wakes up the merge thread when requests are queued or it exits.
+  std::condition_variable queue_condition_;
+  // Signaled when the merge thread is done with the queued requests.
+  std::condition_variable idle_condition_;
+  // Protected by queue_lock_.
+  std::deque<PendingRequests> pending_requests_;
+  // Whether the merge thread is processing a request. Protected by
+  // queue_lock_.
+  bool merging_ = false;
+  // Protected by queue_lock_.
+  bool merge_thread_exiting_ = false;
+
+  std::thread merge_thread_;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_UTILS_BURST_MERGE_PROCESS_BLOCK_H_
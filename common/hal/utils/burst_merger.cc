@@ -0,0 +1,641 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "GCH_BurstMerger"
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "burst_merger.h"
+
+namespace android {
+namespace google_camera_hal {
+
+// Tile distances, as a mean absolute difference per pixel, of this many
+// noise sigmas halve the weight of a tile.
+static constexpr float kTileNoiseScale = 2.0f;
+// Pixels that differ from the reference by this many noise sigmas get no
+// weight.
+static constexpr float kPixelNoiseScale = 4.0f;
+// Lower bound of the estimated noise, so clean frames still merge.
+static constexpr float kMinNoiseSigma = 0.5f;
+// Rows sampled by the noise estimate.
+static constexpr uint32_t kNoiseRowStep = 8;
+
+std::unique_ptr<BurstMerger> BurstMerger::Create(const Config& config) {
+  if (config.width < 2 * kTileSize || config.height < 2 * kTileSize ||
+      config.width % 2 != 0 || config.height % 2 != 0 ||
+      config.max_frames == 0 || config.noise_sigma < 0) {
+    ALOGE("%s: Invalid config %ux%u max frames %u noise sigma %f",
+          __FUNCTION__, config.width, config.height, config.max_frames,
+          config.noise_sigma);
+    return nullptr;
+  }
+
+  return std::unique_ptr<BurstMerger>(new BurstMerger(config));
+}
+
+BurstMerger::BurstMerger(const Config& config) : config_(config) {
+  uint32_t width = config_.width;
+  uint32_t height = config_.height;
+  do {
+    grids_[num_levels_] = {.columns = (width + kTileSize - 1) / kTileSize,
+                           .rows = (height + kTileSize - 1) / kTileSize};
+    num_levels_++;
+    width /= 2;
+    height /= 2;
+  } while (num_levels_ < kMaxPyramidLevels && width >= kMinPyramidLevelSize &&
+           height >= kMinPyramidLevelSize);
+
+  pyramids_.resize(config_.max_frames);
+  pyramid_buffers_.resize(config_.max_frames);
+  alignments_.resize(config_.max_frames);
+  for (uint32_t frame = 0; frame < config_.max_frames; frame++) {
+    pyramids_[frame].resize(num_levels_);
+    pyramid_buffers_[frame].resize(num_levels_);
+    alignments_[frame].resize(num_levels_);
+    for (uint32_t level = 0; level < num_levels_; level++) {
+      uint32_t level_width = config_.width >> level;
+      uint32_t level_height = config_.height >> level;
+      if (level > 0) {
+        pyramid_buffers_[frame][level].resize(level_width * level_height);
+        pyramids_[frame][level] = {
+            .data = pyramid_buffers_[frame][level].data(),
+            .stride = level_width,
+            .width = level_width,
+            .height = level_height};
+      }
+      alignments_[frame][level].resize(grids_[level].columns *
+                                       grids_[level].rows);
+    }
+  }
+
+  uint32_t num_threads = config_.num_threads;
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min(num_threads, kMaxThreads);
+  for (uint32_t i = 1; i < num_threads; i++) {
+    workers_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+BurstMerger::~BurstMerger() {
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    exiting_ = true;
+  }
+  job_condition_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void BurstMerger::WorkerLoop() {
+  uint64_t generation = 0;
+  std::unique_lock<std::mutex> lock(pool_mutex_);
+  while (true) {
+    job_condition_.wait(lock, [this, generation] {
+      return exiting_ || job_generation_ != generation;
+    });
+    if (exiting_) {
+      return;
+    }
+
+    generation = job_generation_;
+    const std::function<void(uint32_t)>* job = job_;
+    uint32_t count = job_count_;
+    lock.unlock();
+    RunJobs(*job, count);
+    lock.lock();
+    if (--busy_workers_ == 0) {
+      done_condition_.notify_one();
+    }
+  }
+}
+
+void BurstMerger::RunJobs(const std::function<void(uint32_t)>& job,
+                          uint32_t count) {
+  for (uint32_t i = next_job_++; i < count; i = next_job_++) {
+    job(i);
+  }
+}
+
+void BurstMerger::RunParallel(uint32_t count,
+                              const std::function<void(uint32_t)>& job) {
+  if (workers_.empty() || count <= 1) {
+    for (uint32_t i = 0; i < count; i++) {
+      job(i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    job_ = &job;
+    job_count_ = count;
+    next_job_ = 0;
+    busy_workers_ = workers_.size();
+    job_generation_++;
+  }
+  job_condition_.notify_all();
+  RunJobs(job, count);
+
+  std::unique_lock<std::mutex> lock(pool_mutex_);
+  done_condition_.wait(lock, [this] { return busy_workers_ == 0; });
+  job_ = nullptr;
+}
+
+void BurstMerger::BuildPyramid(uint32_t frame) {
+  auto& pyramid = pyramids_[frame];
+  for (uint32_t level = 1; level < num_levels_; level++) {
+    const PyramidLevel& src = pyramid[level - 1];
+    PyramidLevel& dst = pyramid[level];
+    uint8_t* dst_row = pyramid_buffers_[frame][level].data();
+    for (uint32_t y = 0; y < dst.height; y++, dst_row += dst.stride) {
+      const uint8_t* src_row0 = src.data + 2 * y * src.stride;
+      const uint8_t* src_row1 = src_row0 + src.stride;
+      for (uint32_t x = 0; x < dst.width; x++) {
+        dst_row[x] = (src_row0[2 * x] + src_row0[2 * x + 1] +
+                      src_row1[2 * x] + src_row1[2 * x + 1] + 2) >>
+                     2;
+      }
+    }
+  }
+}
+
+namespace {
+
+typedef uint8_t Uint8x4 __attribute__((vector_size(4)));
+typedef float Float4 __attribute__((vector_size(16)));
+
+// Pixels per float vector of the merge.
+constexpr uint32_t kLanes = 4;
+
+// Sum of absolute differences between two kTileSize wide rows of height
+// rows.
+inline uint32_t TileRowsDistance(const uint8_t* a, uint32_t a_stride,
+                                 const uint8_t* b, uint32_t b_stride,
+                                 uint32_t height) {
+  static_assert(BurstMerger::kTileSize == 16, "Rows must be one vector");
+#if defined(__ARM_NEON) && defined(__aarch64__)
+  // 16 rows of 2 * 255 fit the 16-bit lanes.
+  uint16x8_t sum = vdupq_n_u16(0);
+  for (uint32_t y = 0; y < height; y++, a += a_stride, b += b_stride) {
+    sum = vpadalq_u8(sum, vabdq_u8(vld1q_u8(a), vld1q_u8(b)));
+  }
+  return vaddlvq_u16(sum);
+#elif defined(__SSE2__)
+  __m128i sum = _mm_setzero_si128();
+  for (uint32_t y = 0; y < height; y++, a += a_stride, b += b_stride) {
+    sum = _mm_add_epi64(
+        sum, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(b))));
+  }
+  return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#else
+  uint32_t distance = 0;
+  for (uint32_t y = 0; y < height; y++, a += a_stride, b += b_stride) {
+    for (uint32_t x = 0; x < BurstMerger::kTileSize; x++) {
+      distance += std::abs(static_cast<int32_t>(a[x]) - b[x]);
+    }
+  }
+  return distance;
+#endif
+}
+
+// Sum of absolute differences between two width x height blocks.
+uint32_t BlockDistance(const uint8_t* a, uint32_t a_stride, const uint8_t* b,
+                       uint32_t b_stride, uint32_t width, uint32_t height) {
+  if (width == BurstMerger::kTileSize) {
+    return TileRowsDistance(a, a_stride, b, b_stride, height);
+  }
+
+  uint32_t distance = 0;
+  for (uint32_t y = 0; y < height; y++, a += a_stride, b += b_stride) {
+    for (uint32_t x = 0; x < width; x++) {
+      distance += std::abs(static_cast<int32_t>(a[x]) - b[x]);
+    }
+  }
+  return distance;
+}
+
+inline Float4 LoadFloat4(const uint8_t* data) {
+#if defined(__ARM_NEON) && defined(__aarch64__)
+  uint32_t word;
+  std::memcpy(&word, data, sizeof(word));
+  uint8x8_t bytes = vreinterpret_u8_u32(vdup_n_u32(word));
+  float32x4_t value_neon =
+      vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(bytes))));
+  Float4 value;
+  std::memcpy(&value, &value_neon, sizeof(value));
+  return value;
+#elif defined(__SSE2__)
+  int32_t word;
+  std::memcpy(&word, data, sizeof(word));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i bytes = _mm_cvtsi32_si128(word);
+  return (Float4)_mm_cvtepi32_ps(
+      _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+#else
+  Uint8x4 bytes;
+  std::memcpy(&bytes, data, sizeof(bytes));
+  return __builtin_convertvector(bytes, Float4);
+#endif
+}
+
+// Round value, which must be in [0, 255], and store it.
+inline void StoreFloat4(Float4 value, uint8_t* data) {
+  value += 0.5f;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+  float32x4_t value_neon;
+  std::memcpy(&value_neon, &value, sizeof(value_neon));
+  uint16x4_t words = vmovn_u32(vcvtq_u32_f32(value_neon));
+  uint8x8_t bytes = vmovn_u16(vcombine_u16(words, words));
+  uint32_t word = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+  std::memcpy(data, &word, sizeof(word));
+#elif defined(__SSE2__)
+  __m128i words = _mm_cvttps_epi32((__m128)value);
+  words = _mm_packs_epi32(words, words);
+  int32_t word = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+  std::memcpy(data, &word, sizeof(word));
+#else
+  Uint8x4 bytes = __builtin_convertvector(value, Uint8x4);
+  std::memcpy(data, &bytes, sizeof(bytes));
+#endif
+}
+
+inline Float4 LoadFloat4(const float* data) {
+  Float4 value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+inline void StoreFloat4(Float4 value, float* data) {
+  std::memcpy(data, &value, sizeof(value));
+}
+
+}  // namespace
+
+void BurstMerger::AlignTileRow(uint32_t frame, uint32_t reference,
+                               uint32_t level, uint32_t row) {
+  const PyramidLevel& ref = pyramids_[reference][level];
+  const PyramidLevel& alt = pyramids_[frame][level];
+  const TileGrid& grid = grids_[level];
+  auto& alignments = alignments_[frame][level];
+  bool coarsest = level + 1 == num_levels_;
+  int32_t radius = coarsest ? kCoarseSearchRadius
+                            : (level == 0 ? kFineSearchRadius : kSearchRadius);
+
+  uint32_t y0 = row * kTileSize;
+  uint32_t height = std::min(kTileSize, ref.height - y0);
+  for (uint32_t column = 0; column < grid.columns; column++) {
+    uint32_t x0 = column * kTileSize;
+    uint32_t width = std::min(kTileSize, ref.width - x0);
+
+    // Start from the displacement of the tile of the level above that covers
+    // this one, which is twice as large on this level.
+    int32_t start_dx = 0;
+    int32_t start_dy = 0;
+    if (!coarsest) {
+      const TileGrid& parent_grid = grids_[level + 1];
+      uint32_t parent_column = std::min(column / 2, parent_grid.columns - 1);
+      uint32_t parent_row = std::min(row / 2, parent_grid.rows - 1);
+      const TileAlignment& parent =
+          alignments_[frame][level + 1]
+                     [parent_row * parent_grid.columns + parent_column];
+      start_dx = parent.dx * 2;
+      start_dy = parent.dy * 2;
+    }
+
+    // Zero displacement is always in range and the fallback of tiles whose
+    // search area is out of range.
+    const uint8_t* ref_tile = ref.data + y0 * ref.stride + x0;
+    TileAlignment best = {
+        .dx = 0,
+        .dy = 0,
+        .distance = BlockDistance(ref_tile, ref.stride,
+                                  alt.data + y0 * alt.stride + x0, alt.stride,
+                                  width, height)};
+    for (int32_t dy = start_dy - radius; dy <= start_dy + radius; dy++) {
+      int32_t y = static_cast<int32_t>(y0) + dy;
+      if (y < 0 || y + height > alt.height) {
+        continue;
+      }
+      for (int32_t dx = start_dx - radius; dx <= start_dx + radius; dx++) {
+        int32_t x = static_cast<int32_t>(x0) + dx;
+        if (x < 0 || x + width > alt.width || (dx == 0 && dy == 0)) {
+          continue;
+        }
+        uint32_t distance =
+            BlockDistance(ref_tile, ref.stride, alt.data + y * alt.stride + x,
+                          alt.stride, width, height);
+        // Prefer the smaller displacement on ties, which keeps flat areas
+        // in place.
+        if (distance < best.distance ||
+            (distance == best.distance &&
+             dx * dx + dy * dy < best.dx * best.dx + best.dy * best.dy)) {
+          best = {.dx = dx, .dy = dy, .distance = distance};
+        }
+      }
+    }
+    alignments[row * grid.columns + column] = best;
+  }
+}
+
+// Accumulate a width x height block of a frame, whose samples are step bytes
+// apart in a row, into sum and weight, which are kTileSize samples apart in
+// a row. Samples differing from the reference by more than the noise get
+// less weight, down to none at inv_threshold2^-1/2.
+static void AccumulateBlock(const uint8_t* ref, uint32_t ref_stride,
+                            const uint8_t* src, uint32_t src_stride,
+                            uint32_t step, uint32_t width, uint32_t height,
+                            float tile_weight, float inv_threshold2,
+                            float* sum, float* weight) {
+  for (uint32_t y = 0; y < height; y++) {
+    const uint8_t* ref_row = ref + y * ref_stride;
+    const uint8_t* src_row = src + y * src_stride;
+    float* sum_row = sum + y * BurstMerger::kTileSize;
+    float* weight_row = weight + y * BurstMerger::kTileSize;
+    uint32_t x = 0;
+    if (step == 1) {
+      const Float4 zero = {};
+      for (; x + kLanes <= width; x += kLanes) {
+        Float4 value = LoadFloat4(src_row + x);
+        Float4 diff = value - LoadFloat4(ref_row + x);
+        Float4 w = 1.0f - diff * diff * inv_threshold2;
+        w = (w > zero ? w : zero) * tile_weight;
+        StoreFloat4(LoadFloat4(sum_row + x) + value * w, sum_row + x);
+        StoreFloat4(LoadFloat4(weight_row + x) + w, weight_row + x);
+      }
+    }
+    for (; x < width; x++) {
+      float value = src_row[x * step];
+      float diff = value - ref_row[x * step];
+      float w = std::max(0.0f, 1.0f - diff * diff * inv_threshold2) *
+                tile_weight;
+      sum_row[x] += value * w;
+      weight_row[x] += w;
+    }
+  }
+}
+
+// Write the weighted average of a block, seeded with the reference.
+static void ResolveBlock(const float* sum, const float* weight, uint8_t* dst,
+                         uint32_t dst_stride, uint32_t step, uint32_t width,
+                         uint32_t height) {
+  for (uint32_t y = 0; y < height; y++) {
+    const float* sum_row = sum + y * BurstMerger::kTileSize;
+    const float* weight_row = weight + y * BurstMerger::kTileSize;
+    uint8_t* dst_row = dst + y * dst_stride;
+    uint32_t x = 0;
+    if (step == 1) {
+      for (; x + kLanes <= width; x += kLanes) {
+        StoreFloat4(LoadFloat4(sum_row + x) / LoadFloat4(weight_row + x),
+                    dst_row + x);
+      }
+    }
+    for (; x < width; x++) {
+      dst_row[x * step] =
+          static_cast<uint8_t>(sum_row[x] / weight_row[x] + 0.5f);
+    }
+  }
+}
+
+// Seed sum and weight with a block of the reference.
+static void SeedBlock(const uint8_t* ref, uint32_t ref_stride, uint32_t step,
+                      uint32_t width, uint32_t height, float* sum,
+                      float* weight) {
+  for (uint32_t y = 0; y < height; y++) {
+    const uint8_t* ref_row = ref + y * ref_stride;
+    float* sum_row = sum + y * BurstMerger::kTileSize;
+    float* weight_row = weight + y * BurstMerger::kTileSize;
+    uint32_t x = 0;
+    if (step == 1) {
+      for (; x + kLanes <= width; x += kLanes) {
+        StoreFloat4(LoadFloat4(ref_row + x), sum_row + x);
+        StoreFloat4(Float4{} + 1.0f, weight_row + x);
+      }
+    }
+    for (; x < width; x++) {
+      sum_row[x] = ref_row[x * step];
+      weight_row[x] = 1.0f;
+    }
+  }
+}
+
+void BurstMerger::MergeTileRow(const std::vector<BurstImage>& frames,
+                               uint32_t reference, const BurstImage& output,
+                               float noise_sigma, bool interleaved_chroma,
+                               uint32_t row) {
+  constexpr uint32_t kTilePixels = kTileSize * kTileSize;
+  const BurstImage& ref = frames[reference];
+  const TileGrid& grid = grids_[0];
+  const float tile_scale = 1.0f / (kTileNoiseScale * noise_sigma);
+  const float inv_threshold2 =
+      1.0f / (kPixelNoiseScale * kPixelNoiseScale * noise_sigma * noise_sigma);
+
+  // Interleaved chroma is merged as a single plane of both components, whose
+  // samples are adjacent.
+  const uint32_t num_chroma_planes = interleaved_chroma ? 1 : 2;
+  auto get_chroma_plane = [interleaved_chroma](const BurstImage& image,
+                                               uint32_t plane) {
+    if (interleaved_chroma) {
+      return std::min(image.cb, image.cr);
+    }
+    return plane == 0 ? image.cb : image.cr;
+  };
+
+  float y_sum[kTilePixels], y_weight[kTilePixels];
+  float chroma_sum[2][kTilePixels], chroma_weight[2][kTilePixels];
+
+  uint32_t y0 = row * kTileSize;
+  uint32_t height = std::min(kTileSize, ref.height - y0);
+  uint32_t cy0 = y0 / 2;
+  uint32_t chroma_height = height / 2;
+  for (uint32_t column = 0; column < grid.columns; column++) {
+    uint32_t x0 = column * kTileSize;
+    uint32_t width = std::min(kTileSize, ref.width - x0);
+    uint32_t cx0 = x0 / 2;
+    uint32_t chroma_width = interleaved_chroma ? width : width / 2;
+    uint32_t chroma_step = interleaved_chroma ? 1 : ref.cbcr_step;
+
+    const uint8_t* ref_y = ref.y + y0 * ref.y_stride + x0;
+    uint32_t ref_chroma_offset = cy0 * ref.cbcr_stride + cx0 * ref.cbcr_step;
+    SeedBlock(ref_y, ref.y_stride, 1, width, height, y_sum, y_weight);
+    for (uint32_t plane = 0; plane < num_chroma_planes; plane++) {
+      SeedBlock(get_chroma_plane(ref, plane) + ref_chroma_offset,
+                ref.cbcr_stride, chroma_step, chroma_width, chroma_height,
+                chroma_sum[plane], chroma_weight[plane]);
+    }
+
+    for (uint32_t frame = 0; frame < frames.size(); frame++) {
+      if (frame == reference) {
+        continue;
+      }
+      const BurstImage& alt = frames[frame];
+      const TileAlignment& alignment =
+          alignments_[frame][0][row * grid.columns + column];
+      float tile_distance =
+          alignment.distance * tile_scale / (width * height);
+      float tile_weight = 1.0f / (1.0f + tile_distance * tile_distance);
+
+      const uint8_t* alt_y =
+          alt.y + (y0 + alignment.dy) * alt.y_stride + x0 + alignment.dx;
+      AccumulateBlock(ref_y, ref.y_stride, alt_y, alt.y_stride, 1, width,
+                      height, tile_weight, inv_threshold2, y_sum, y_weight);
+
+      // Chroma moves by half the luma displacement, rounded down. The block
+      // stays in range since the luma tile does.
+      uint32_t alt_chroma_offset =
+          (cy0 + (alignment.dy >> 1)) * alt.cbcr_stride +
+          (cx0 + (alignment.dx >> 1)) * alt.cbcr_step;
+      for (uint32_t plane = 0; plane < num_chroma_planes; plane++) {
+        AccumulateBlock(get_chroma_plane(ref, plane) + ref_chroma_offset,
+                        ref.cbcr_stride,
+                        get_chroma_plane(alt, plane) + alt_chroma_offset,
+                        alt.cbcr_stride, chroma_step, chroma_width,
+                        chroma_height, tile_weight, inv_threshold2,
+                        chroma_sum[plane], chroma_weight[plane]);
+      }
+    }
+
+    uint32_t out_chroma_offset =
+        cy0 * output.cbcr_stride + cx0 * output.cbcr_step;
+    ResolveBlock(y_sum, y_weight, output.y + y0 * output.y_stride + x0,
+                 output.y_stride, 1, width, height);
+    for (uint32_t plane = 0; plane < num_chroma_planes; plane++) {
+      ResolveBlock(chroma_sum[plane], chroma_weight[plane],
+                   get_chroma_plane(output, plane) + out_chroma_offset,
+                   output.cbcr_stride,
+                   interleaved_chroma ? 1 : output.cbcr_step, chroma_width,
+                   chroma_height);
+    }
+  }
+}
+
+float BurstMerger::EstimateNoise(const BurstImage& image) {
+  // The second difference 2 * a - b - c of neighbors cancels out gradients.
+  // Its median absolute value is 0.6745 * sqrt(6) sigma for gaussian noise.
+  uint32_t histogram[4 * 256] = {0};
+  uint32_t count = 0;
+  for (uint32_t y = kNoiseRowStep / 2; y < image.height; y += kNoiseRowStep) {
+    const uint8_t* row = image.y + y * image.y_stride;
+    for (uint32_t x = 1; x + 1 < image.width; x++) {
+      histogram[std::abs(2 * row[x] - row[x - 1] - row[x + 1])]++;
+      count++;
+    }
+  }
+
+  uint32_t median = 0;
+  for (uint32_t seen = histogram[0]; seen * 2 < count;) {
+    seen += histogram[++median];
+  }
+  return std::max(kMinNoiseSigma, median / (0.6745f * std::sqrt(6.0f)));
+}
+
+status_t BurstMerger::Merge(const std::vector<BurstImage>& frames,
+                            uint32_t reference, const BurstImage& output) {
+  ATRACE_CALL();
+  if (frames.empty() || frames.size() > config_.max_frames ||
+      reference >= frames.size()) {
+    ALOGE("%s: Invalid reference %u of %zu frames, max %u", __FUNCTION__,
+          reference, frames.size(), config_.max_frames);
+    return BAD_VALUE;
+  }
+  auto valid = [this](const BurstImage& image) {
+    return image.y != nullptr && image.cb != nullptr && image.cr != nullptr &&
+           image.width == config_.width && image.height == config_.height &&
+           image.y_stride >= image.width && image.cbcr_step > 0 &&
+           image.cbcr_stride >= image.width / 2 * image.cbcr_step;
+  };
+  if (!std::all_of(frames.begin(), frames.end(), valid) || !valid(output)) {
+    ALOGE("%s: Frames must be %ux%u", __FUNCTION__, config_.width,
+          config_.height);
+    return BAD_VALUE;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  float noise_sigma = config_.noise_sigma;
+  if (noise_sigma == 0) {
+    noise_sigma = EstimateNoise(frames[reference]);
+  }
+
+  uint32_t num_frames = frames.size();
+  for (uint32_t frame = 0; frame < num_frames; frame++) {
+    pyramids_[frame][0] = {.data = frames[frame].y,
+                           .stride = frames[frame].y_stride,
+                           .width = config_.width,
+                           .height = config_.height};
+  }
+  RunParallel(num_frames, [this](uint32_t frame) { BuildPyramid(frame); });
+
+  for (int32_t level = num_levels_ - 1; level >= 0; level--) {
+    uint32_t rows = grids_[level].rows;
+    RunParallel(num_frames * rows, [this, rows, reference, level](uint32_t i) {
+      uint32_t frame = i / rows;
+      if (frame != reference) {
+        AlignTileRow(frame, reference, level, i % rows);
+      }
+    });
+  }
+
+  // Semi-planar frames, e.g. NV21, with the same chroma order.
+  auto get_chroma_order = [](const BurstImage& image) -> int32_t {
+    if (image.cbcr_step != 2 || std::abs(image.cr - image.cb) != 1) {
+      return 0;
+    }
+    return static_cast<int32_t>(image.cr - image.cb);
+  };
+  int32_t chroma_order = get_chroma_order(output);
+  bool interleaved_chroma =
+      chroma_order != 0 &&
+      std::all_of(frames.begin(), frames.end(),
+                  [&](const BurstImage& image) {
+                    return get_chroma_order(image) == chroma_order;
+                  });
+
+  RunParallel(grids_[0].rows, [&](uint32_t row) {
+    MergeTileRow(frames, reference, output, noise_sigma, interleaved_chroma,
+                 row);
+  });
+
+  int64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+  stats_.merges++;
+  stats_.frames += num_frames;
+  stats_.total_duration_ns += duration_ns;
+  stats_.max_duration_ns = std::max(stats_.max_duration_ns, duration_ns);
+  stats_.last_noise_sigma = noise_sigma;
+  return OK;
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
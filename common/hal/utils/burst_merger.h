@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_BURST_MERGER_H_
+#define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_BURST_MERGER_H_
+
+#include <utils/Errors.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+// 8-bit YUV420 frame of a burst. cbcr_step is the distance in bytes between
+// two chroma samples of a row, 1 for planar and 2 for semi-planar layouts.
+struct BurstImage {
+  uint8_t* y = nullptr;
+  uint8_t* cb = nullptr;
+  uint8_t* cr = nullptr;
+  uint32_t y_stride = 0;
+  uint32_t cbcr_stride = 0;
+  uint32_t cbcr_step = 1;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+// BurstMerger denoises a reference frame by merging other frames of a burst,
+// usually the ZSL frames captured just before a snapshot, into it.
+//
+// Each frame is aligned to the reference per kTileSize x kTileSize tile with
+// a coarse-to-fine search on a luma pyramid: a wide search on the coarsest
+// level is refined on each finer level around the displacement found on the
+// level above. Aligned tiles are then averaged with the reference with
+// weights that fall off with the tile distance to the reference, and per
+// pixel with the difference to the reference, both relative to the noise
+// level. Tiles or pixels that differ by more than the noise, such as moving
+// objects or alignment failures, keep the reference instead of ghosting.
+//
+// Pyramids, alignment and merge are split by tile rows over a pool of worker
+// threads. Tile distances use the SAD instructions of NEON and SSE2, and the
+// merge runs on 4 pixels at a time, interleaved chroma included.
+//
+// The pool is private because the HAL has no shared compute pool to borrow:
+// ThreadRoleManager only schedules threads, and the render pool of the
+// emulated camera is behind the HWL. The workers sleep between merges.
+//
+// Not thread safe.
+class BurstMerger {
+ public:
+  struct Config {
+    // Frame size, width and height must be even.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Maximum number of frames passed to Merge().
+    uint32_t max_frames = 8;
+    // Standard deviation of the luma noise in 8-bit levels. 0 to estimate it
+    // from the reference frame of each merge.
+    float noise_sigma = 0;
+    // Threads merging a burst, including the caller of Merge(). 0 to use all
+    // CPUs, up to kMaxThreads.
+    uint32_t num_threads = 0;
+  };
+
+  struct Stats {
+    uint64_t merges = 0;
+    uint64_t frames = 0;
+    int64_t total_duration_ns = 0;
+    int64_t max_duration_ns = 0;
+    // Noise level used by the last merge.
+    float last_noise_sigma = 0;
+  };
+
+  static constexpr uint32_t kTileSize = 16;
+  static constexpr uint32_t kMaxThreads = 8;
+
+  static std::unique_ptr<BurstMerger> Create(const Config& config);
+
+  virtual ~BurstMerger();
+
+  // Merge frames into output. frames[reference] is the frame the others are
+  // aligned to. All frames and output must have the configured size. Output
+  // may be the reference frame, but must not overlap any other frame.
+  status_t Merge(const std::vector<BurstImage>& frames, uint32_t reference,
+                 const BurstImage& output);
+
+  const Stats& GetStats() const {
+    return stats_;
+  }
+
+ protected:
+  explicit BurstMerger(const Config& config);
+
+ private:
+  // Levels of the luma pyramid, each half the size of the level below.
+  static constexpr uint32_t kMaxPyramidLevels = 4;
+  // The coarsest level is at least this size.
+  static constexpr uint32_t kMinPyramidLevelSize = 32;
+  // Search radius in pixels on the coarsest, the middle and the finest
+  // levels.
+  static constexpr int32_t kCoarseSearchRadius = 4;
+  static constexpr int32_t kSearchRadius = 2;
+  static constexpr int32_t kFineSearchRadius = 1;
+
+  struct PyramidLevel {
+    const uint8_t* data = nullptr;
+    uint32_t stride = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+  };
+
+  // Displacement of a tile of a frame from the reference tile, and the sum
+  // of absolute differences between the two.
+  struct TileAlignment {
+    int32_t dx = 0;
+    int32_t dy = 0;
+    uint32_t distance = 0;
+  };
+
+  struct TileGrid {
+    uint32_t columns = 0;
+    uint32_t rows = 0;
+  };
+
+  // Build the levels above level 0 of the pyramid of frame.
+  void BuildPyramid(uint32_t frame);
+
+  // Align the tiles of a row of frame on level, starting from the
+  // displacements of the level above.
+  void AlignTileRow(uint32_t frame, uint32_t reference, uint32_t level,
+                    uint32_t row);
+
+  // Merge a row of full size tiles of frames into output. interleaved_chroma
+  // is set if all frames are semi-planar with the same chroma order.
+  void MergeTileRow(const std::vector<BurstImage>& frames, uint32_t reference,
+                    const BurstImage& output, float noise_sigma,
+                    bool interleaved_chroma, uint32_t row);
+
+  // Estimate the standard deviation of the luma noise of image.
+  static float EstimateNoise(const BurstImage& image);
+
+  // Run job(0) to job(count - 1) on the worker threads and the caller, and
+  // return when all are done.
+  void RunParallel(uint32_t count, const std::function<void(uint32_t)>& job);
+  void RunJobs(const std::function<void(uint32_t)>& job, uint32_t count);
+  void WorkerLoop();
+
+  const Config config_;
+  Stats stats_;
+
+  uint32_t num_levels_ = 0;
+  TileGrid grids_[kMaxPyramidLevels];
+
+  // Indexed by frame. Level 0 points to the luma of the frame and the other
+  // levels to pyramid_buffers_.
+  std::vector<std::vector<PyramidLevel>> pyramids_;
+  std::vector<std::vector<std::vector<uint8_t>>> pyramid_buffers_;
+  // Indexed by frame, level and tile.
+  std::vector<std::vector<std::vector<TileAlignment>>> alignments_;
+
+  std::vector<std::thread> workers_;
+  std::mutex pool_mutex_;
+  // Wakes up the workers when a job is posted or the pool exits.
+  std::condition_variable job_condition_;
+  // Wakes up RunParallel() when the last worker is done.
+  std::condition_variable done_condition_;
+  const std::function<void(uint32_t)>* job_ = nullptr;
+  uint32_t job_count_ = 0;
+  uint64_t job_generation_ = 0;
+  uint32_t busy_workers_ = 0;
+  bool exiting_ = false;
+  std::atomic<uint32_t> next_job_ = 0;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_UTILS_BURST_MERGER_H_
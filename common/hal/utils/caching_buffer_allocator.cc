@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "GCH_CachingBufferAllocator"
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+#include <cutils/properties.h>
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <inttypes.h>
+#include <algorithm>
+#include <iterator>
+
+#include "caching_buffer_allocator.h"
+#include "gralloc_buffer_allocator.h"
+
+namespace android {
+namespace google_camera_hal {
+
+namespace {
+// Byte budget of the caching allocators in MB.
+constexpr char kBufferCacheSizeMbProp[] =
+    "persist.vendor.camera.hal.buffer_cache_size_mb";
+constexpr int32_t kDefaultBufferCacheSizeMb = 96;
+
+// Protects the shared gralloc allocator and its user count.
+std::mutex shared_allocator_lock;
+// Intentionally leaked so buffers can be returned during static destruction.
+CachingBufferAllocator* shared_allocator = nullptr;
+uint32_t shared_allocator_users = 0;
+}  // namespace
+
+std::unique_ptr<CachingBufferAllocator> CachingBufferAllocator::Create(
+    std::unique_ptr<IHalBufferAllocator> allocator, uint64_t max_cached_bytes) {
+  ATRACE_CALL();
+  if (allocator == nullptr) {
+    ALOGE("%s: allocator is nullptr.", __FUNCTION__);
+    return nullptr;
+  }
+
+  return std::unique_ptr<CachingBufferAllocator>(
+      new CachingBufferAllocator(std::move(allocator), max_cached_bytes));
+}
+
+uint64_t CachingBufferAllocator::GetDefaultMaxCachedBytes() {
+  int32_t cache_size_mb =
+      property_get_int32(kBufferCacheSizeMbProp, kDefaultBufferCacheSizeMb);
+  return static_cast<uint64_t>(std::max(cache_size_mb, 0)) * 1024 * 1024;
+}
+
+CachingBufferAllocator* CachingBufferAllocator::GetSharedGrallocAllocator() {
+  std::lock_guard<std::mutex> lock(shared_allocator_lock);
+  if (shared_allocator != nullptr) {
+    return shared_allocator;
+  }
+
+  std::unique_ptr<IHalBufferAllocator> gralloc_allocator =
+      GrallocBufferAllocator::Create();
+  if (gralloc_allocator == nullptr) {
+    ALOGE("%s: Creating a gralloc buffer allocator failed.", __FUNCTION__);
+    return nullptr;
+  }
+
+  uint64_t max_cached_bytes = GetDefaultMaxCachedBytes();
+  ALOGI("%s: Buffer cache size %" PRIu64 " bytes", __FUNCTION__,
+        max_cached_bytes);
+  shared_allocator =
+      Create(std::move(gralloc_allocator), max_cached_bytes).release();
+  return shared_allocator;
+}
+
+void CachingBufferAllocator::AddSharedGrallocAllocatorUser() {
+  std::lock_guard<std::mutex> lock(shared_allocator_lock);
+  shared_allocator_users++;
+}
+
+void CachingBufferAllocator::RemoveSharedGrallocAllocatorUser() {
+  CachingBufferAllocator* allocator = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(shared_allocator_lock);
+    if (shared_allocator_users == 0) {
+      ALOGE("%s: No user is registered.", __FUNCTION__);
+      return;
+    }
+    shared_allocator_users--;
+    if (shared_allocator_users > 0) {
+      return;
+    }
+    allocator = shared_allocator;
+  }
+
+  // Buffers cached across stream configurations are not reused once every
+  // camera is closed.
+  if (allocator != nullptr) {
+    allocator->ReleaseCachedBuffers();
+  }
+}
+
+CachingBufferAllocator::CachingBufferAllocator(
+    std::unique_ptr<IHalBufferAllocator> allocator, uint64_t max_cached_bytes)
+    : allocator_(std::move(allocator)), max_cached_bytes_(max_cached_bytes) {
+}
+
+CachingBufferAllocator::~CachingBufferAllocator() {
+  ReleaseCachedBuffers();
+
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  if (!allocated_buffers_.empty()) {
+    ALOGW("%s: %zu buffers are still allocated.", __FUNCTION__,
+          allocated_buffers_.size());
+  }
+}
+
+uint64_t CachingBufferAllocator::GetBufferSizeBytes(
+    const HalBufferDescriptor& buffer_descriptor) {
+  uint64_t num_pixels =
+      static_cast<uint64_t>(buffer_descriptor.width) * buffer_descriptor.height;
+  switch (buffer_descriptor.format) {
+    case HAL_PIXEL_FORMAT_BLOB:
+    case HAL_PIXEL_FORMAT_Y8:
+      return num_pixels;
+    case HAL_PIXEL_FORMAT_RAW10:
+      return num_pixels * 5 / 4;
+    case HAL_PIXEL_FORMAT_RAW16:
+    case HAL_PIXEL_FORMAT_Y16:
+    case HAL_PIXEL_FORMAT_RGB_565:
+    case HAL_PIXEL_FORMAT_YCBCR_422_SP:
+    case HAL_PIXEL_FORMAT_YCBCR_422_I:
+      return num_pixels * 2;
+    case HAL_PIXEL_FORMAT_RGB_888:
+      return num_pixels * 3;
+    case HAL_PIXEL_FORMAT_RGBA_8888:
+    case HAL_PIXEL_FORMAT_RGBX_8888:
+    case HAL_PIXEL_FORMAT_BGRA_8888:
+      return num_pixels * 4;
+    default:
+      // YUV 4:2:0, implementation defined and opaque RAW formats.
+      return num_pixels * 3 / 2;
+  }
+}
+
+CachingBufferAllocator::BufferKey CachingBufferAllocator::GetBufferKey(
+    const HalBufferDescriptor& buffer_descriptor) {
+  return BufferKey{
+      .width = buffer_descriptor.width,
+      .height = buffer_descriptor.height,
+      .format = static_cast<int32_t>(buffer_descriptor.format),
+      .producer_flags = buffer_descriptor.producer_flags,
+      .consumer_flags = buffer_descriptor.consumer_flags,
+  };
+}
+
+status_t CachingBufferAllocator::AllocateBuffers(
+    const HalBufferDescriptor& buffer_descriptor,
+    std::vector<buffer_handle_t>* buffers) {
+  ATRACE_CALL();
+  if (buffers == nullptr) {
+    ALOGE("%s: buffers is nullptr.", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  BufferKey key = GetBufferKey(buffer_descriptor);
+  uint64_t size_bytes = GetBufferSizeBytes(buffer_descriptor);
+  uint32_t num_buffers = buffer_descriptor.immediate_num_buffers;
+  std::vector<buffer_handle_t> allocated_buffers;
+  allocated_buffers.reserve(num_buffers);
+
+  {
+    std::lock_guard<std::mutex> lock(cache_lock_);
+    auto size_class_it = size_classes_.find(key);
+    while (size_class_it != size_classes_.end() &&
+           allocated_buffers.size() < num_buffers) {
+      // Reuse the most recently freed buffer of this size class.
+      LruList::iterator it = size_class_it->second.back();
+      allocated_buffers.push_back(it->buffer);
+      RemoveCachedBufferLocked(it);
+      size_class_it = size_classes_.find(key);
+    }
+    stats_.hit_count += allocated_buffers.size();
+  }
+
+  uint32_t num_cached_buffers = allocated_buffers.size();
+  if (num_cached_buffers < num_buffers) {
+    HalBufferDescriptor remaining_descriptor = buffer_descriptor;
+    remaining_descriptor.immediate_num_buffers =
+        num_buffers - num_cached_buffers;
+    std::vector<buffer_handle_t> new_buffers;
+    status_t res =
+        allocator_->AllocateBuffers(remaining_descriptor, &new_buffers);
+    if (res != OK) {
+      ALOGE("%s: Allocating %u buffers failed: %s(%d)", __FUNCTION__,
+            remaining_descriptor.immediate_num_buffers, strerror(-res), res);
+      // Put the reused buffers back to the cache.
+      std::lock_guard<std::mutex> lock(cache_lock_);
+      for (auto buffer : allocated_buffers) {
+        lru_buffers_.push_front(
+            CachedBuffer{.buffer = buffer, .key = key, .size_bytes = size_bytes});
+        size_classes_[key].push_back(lru_buffers_.begin());
+        stats_.cached_bytes += size_bytes;
+        stats_.cached_buffer_count++;
+      }
+      stats_.hit_count -= allocated_buffers.size();
+      return res;
+    }
+    allocated_buffers.insert(allocated_buffers.end(), new_buffers.begin(),
+                             new_buffers.end());
+  }
+
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  for (uint32_t i = 0; i < allocated_buffers.size(); i++) {
+    if (allocated_buffers[i] == kInvalidBufferHandle) {
+      continue;
+    }
+    allocated_buffers_[allocated_buffers[i]] = {key, size_bytes};
+    if (i >= num_cached_buffers) {
+      stats_.miss_count++;
+    }
+  }
+
+  buffers->insert(buffers->end(), allocated_buffers.begin(),
+                  allocated_buffers.end());
+  return OK;
+}
+
+void CachingBufferAllocator::FreeBuffers(std::vector<buffer_handle_t>* buffers) {
+  ATRACE_CALL();
+  if (buffers == nullptr) {
+    return;
+  }
+
+  std::vector<buffer_handle_t> buffers_to_free;
+  {
+    std::lock_guard<std::mutex> lock(cache_lock_);
+    for (auto buffer : *buffers) {
+      if (buffer == kInvalidBufferHandle) {
+        continue;
+      }
+
+      auto allocated_it = allocated_buffers_.find(buffer);
+      if (allocated_it == allocated_buffers_.end()) {
+        buffers_to_free.push_back(buffer);
+        continue;
+      }
+
+      auto [key, size_bytes] = allocated_it->second;
+      allocated_buffers_.erase(allocated_it);
+      if (size_bytes > max_cached_bytes_) {
+        buffers_to_free.push_back(buffer);
+        continue;
+      }
+
+      lru_buffers_.push_front(
+          CachedBuffer{.buffer = buffer, .key = key, .size_bytes = size_bytes});
+      size_classes_[key].push_back(lru_buffers_.begin());
+      stats_.cached_bytes += size_bytes;
+      stats_.cached_buffer_count++;
+    }
+
+    stats_.eviction_count += EvictLocked(max_cached_bytes_, &buffers_to_free);
+  }
+
+  if (!buffers_to_free.empty()) {
+    allocator_->FreeBuffers(&buffers_to_free);
+  }
+  buffers->clear();
+}
+
+void CachingBufferAllocator::ReleaseCachedBuffers() {
+  ATRACE_CALL();
+  std::vector<buffer_handle_t> buffers_to_free;
+  {
+    std::lock_guard<std::mutex> lock(cache_lock_);
+    EvictLocked(/*max_cached_bytes=*/0, &buffers_to_free);
+  }
+
+  if (!buffers_to_free.empty()) {
+    ALOGV("%s: Releasing %zu cached buffers", __FUNCTION__,
+          buffers_to_free.size());
+    allocator_->FreeBuffers(&buffers_to_free);
+  }
+}
+
+CachingBufferAllocator::Stats CachingBufferAllocator::GetStats() {
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  return stats_;
+}
+
+void CachingBufferAllocator::RemoveCachedBufferLocked(LruList::iterator it) {
+  auto size_class_it = size_classes_.find(it->key);
+  if (size_class_it != size_classes_.end()) {
+    auto& entries = size_class_it->second;
+    for (auto entry = entries.begin(); entry != entries.end(); entry++) {
+      if (*entry == it) {
+        entries.erase(entry);
+        break;
+      }
+    }
+    if (entries.empty()) {
+      size_classes_.erase(size_class_it);
+    }
+  }
+
+  stats_.cached_bytes -= it->size_bytes;
+  stats_.cached_buffer_count--;
+  lru_buffers_.erase(it);
+}
+
+uint32_t CachingBufferAllocator::EvictLocked(
+    uint64_t max_cached_bytes, std::vector<buffer_handle_t>* evicted_buffers) {
+  uint32_t num_evicted = 0;
+  while (!lru_buffers_.empty() && stats_.cached_bytes > max_cached_bytes) {
+    auto oldest = std::prev(lru_buffers_.end());
+    evicted_buffers->push_back(oldest->buffer);
+    RemoveCachedBufferLocked(oldest);
+    num_evicted++;
+  }
+  return num_evicted;
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
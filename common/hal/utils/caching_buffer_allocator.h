@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_CACHING_BUFFER_ALLOCATOR_H
+#define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_CACHING_BUFFER_ALLOCATOR_H
+
+#include <utils/Errors.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "hal_buffer_allocator.h"
+
+namespace android {
+namespace google_camera_hal {
+
+// CachingBufferAllocator implements IHalBufferAllocator on top of another
+// IHalBufferAllocator. Freed buffers are kept in size classes keyed by
+// (width, height, format, usage) instead of being released, so that a stream
+// reconfiguration asking for the same buffers reuses them. Cached buffers are
+// released in LRU order once their total size exceeds the byte budget.
+class CachingBufferAllocator : public IHalBufferAllocator {
+ public:
+  // Statistics of a caching allocator.
+  struct Stats {
+    // Buffers served from the cache.
+    uint64_t hit_count = 0;
+    // Buffers allocated from the underlying allocator.
+    uint64_t miss_count = 0;
+    // Cached buffers released to stay within the byte budget.
+    uint64_t eviction_count = 0;
+    // Number and size of buffers currently cached.
+    uint32_t cached_buffer_count = 0;
+    uint64_t cached_bytes = 0;
+  };
+
+  // Create a caching allocator on top of allocator. Up to max_cached_bytes of
+  // freed buffers are kept for reuse.
+  static std::unique_ptr<CachingBufferAllocator> Create(
+      std::unique_ptr<IHalBufferAllocator> allocator,
+      uint64_t max_cached_bytes);
+
+  // Byte budget of the caching allocators created by the HAL, read from
+  // persist.vendor.camera.hal.buffer_cache_size_mb.
+  static uint64_t GetDefaultMaxCachedBytes();
+
+  // Return the process-wide caching allocator backed by gralloc, creating it
+  // on first use, with the default byte budget. Returns nullptr if the
+  // gralloc allocator cannot be created.
+  static CachingBufferAllocator* GetSharedGrallocAllocator();
+
+  // Register a user (e.g. a camera device session) of the shared gralloc
+  // allocator. Cached buffers stay available for reuse across sessions while
+  // at least one user is registered.
+  static void AddSharedGrallocAllocatorUser();
+
+  // Unregister a user added by AddSharedGrallocAllocatorUser. When the last
+  // user is removed, the cached buffers of the shared gralloc allocator are
+  // released. Does not create the shared allocator if it was never used.
+  static void RemoveSharedGrallocAllocatorUser();
+
+  virtual ~CachingBufferAllocator();
+
+  // Allocate buffers and return buffer via buffers.
+  // The buffers is owned by caller
+  status_t AllocateBuffers(const HalBufferDescriptor& buffer_descriptor,
+                           std::vector<buffer_handle_t>* buffers) override;
+
+  // Return buffers to the cache. Buffers that were not allocated by this
+  // allocator are freed by the underlying allocator.
+  void FreeBuffers(std::vector<buffer_handle_t>* buffers) override;
+
+  // Release all cached buffers to the underlying allocator.
+  void ReleaseCachedBuffers();
+
+  Stats GetStats();
+
+  // Estimated size in bytes of a buffer described by buffer_descriptor.
+  static uint64_t GetBufferSizeBytes(
+      const HalBufferDescriptor& buffer_descriptor);
+
+ protected:
+  CachingBufferAllocator(std::unique_ptr<IHalBufferAllocator> allocator,
+                         uint64_t max_cached_bytes);
+
+ private:
+  // Size class of a buffer.
+  struct BufferKey {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    int32_t format = 0;
+    uint64_t producer_flags = 0;
+    uint64_t consumer_flags = 0;
+
+    bool operator<(const BufferKey& other) const {
+      return std::tie(width, height, format, producer_flags, consumer_flags) <
+             std::tie(other.width, other.height, other.format,
+                      other.producer_flags, other.consumer_flags);
+    }
+  };
+
+  // A cached buffer in the LRU list.
+  struct CachedBuffer {
+    buffer_handle_t buffer = kInvalidBufferHandle;
+    BufferKey key;
+    uint64_t size_bytes = 0;
+  };
+
+  using LruList = std::list<CachedBuffer>;
+
+  static BufferKey GetBufferKey(const HalBufferDescriptor& buffer_descriptor);
+
+  // Remove a cached buffer from the LRU list and its size class.
+  // Must be called with cache_lock_ locked.
+  void RemoveCachedBufferLocked(LruList::iterator it);
+
+  // Move the least recently used buffers to evicted_buffers until cached
+  // bytes fit max_cached_bytes. Returns the number of buffers moved.
+  // Must be called with cache_lock_ locked.
+  uint32_t EvictLocked(uint64_t max_cached_bytes,
+                       std::vector<buffer_handle_t>* evicted_buffers);
+
+  // Do not support the copy constructor or assignment operator
+  CachingBufferAllocator(const CachingBufferAllocator&) = delete;
+  CachingBufferAllocator& operator=(const CachingBufferAllocator&) = delete;
+
+  const std::unique_ptr<IHalBufferAllocator> allocator_;
+  const uint64_t max_cached_bytes_;
+
+  std::mutex cache_lock_;
+
+  // Cached buffers, most recently freed at the front. Protected by
+  // cache_lock_.
+  LruList lru_buffers_;
+
+  // Map from size class to its cached buffers in lru_buffers_, most recently
+  // freed at the back. Protected by cache_lock_.
+  std::map<BufferKey, std::vector<LruList::iterator>> size_classes_;
+
+  // Map from a buffer handed out by this allocator to its size class and size.
+  // Protected by cache_lock_.
+  std::unordered_map<buffer_handle_t, std::pair<BufferKey, uint64_t>>
+      allocated_buffers_;
+
+  // Protected by cache_lock_.
+  Stats stats_;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_UTILS_CACHING_BUFFER_ALLOCATOR_H
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "GCH_CharacteristicsCache"
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <algorithm>
+
+#include "characteristics_cache.h"
+
+namespace android {
+namespace google_camera_hal {
+
+status_t CharacteristicsCache::GetCharacteristics(
+    const QueryFunc& query, std::vector<uint8_t>* characteristics) {
+  return Get(Query::kCharacteristics, /*key=*/"", query, characteristics);
+}
+
+status_t CharacteristicsCache::GetPhysicalCharacteristics(
+    uint32_t physical_camera_id, const QueryFunc& query,
+    std::vector<uint8_t>* characteristics) {
+  return Get(Query::kPhysicalCharacteristics,
+             std::to_string(physical_camera_id), query, characteristics);
+}
+
+status_t CharacteristicsCache::GetSessionCharacteristics(
+    const StreamConfiguration& stream_config, const QueryFunc& query,
+    std::vector<uint8_t>* characteristics) {
+  return Get(Query::kSessionCharacteristics, GetSessionKey(stream_config),
+             query, characteristics);
+}
+
+status_t CharacteristicsCache::Get(Query query, const std::string& key,
+                                   const QueryFunc& query_func,
+                                   std::vector<uint8_t>* characteristics) {
+  ATRACE_CALL();
+  if (characteristics == nullptr || query_func == nullptr) {
+    ALOGE("%s: characteristics or query_func is nullptr.", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  nsecs_t start_time = systemTime(SYSTEM_TIME_MONOTONIC);
+  Entries& entries = entries_[static_cast<uint32_t>(query)];
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(cache_lock_);
+    auto cached = entries.characteristics.find(key);
+    if (cached != entries.characteristics.end()) {
+      *characteristics = cached->second;
+      UpdateStatsLocked(query, /*hit=*/true, start_time);
+      return OK;
+    }
+    generation = generation_;
+  }
+
+  // Query the device without the lock, so that other queries and
+  // invalidations are not blocked behind it.
+  std::unique_ptr<HalCameraMetadata> metadata;
+  status_t res = query_func(&metadata);
+  if (res != OK) {
+    return res;
+  }
+  if (metadata == nullptr) {
+    ALOGE("%s: Queried characteristics are nullptr.", __FUNCTION__);
+    return UNKNOWN_ERROR;
+  }
+
+  auto raw_metadata =
+      reinterpret_cast<const uint8_t*>(metadata->GetRawCameraMetadata());
+  characteristics->assign(raw_metadata,
+                          raw_metadata + metadata->GetCameraMetadataSize());
+
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  // The device state changed during the query, so the result may be stale.
+  if (generation == generation_ &&
+      entries.characteristics.find(key) == entries.characteristics.end()) {
+    if (entries.keys.size() >= kMaxEntries) {
+      entries.characteristics.erase(entries.keys.front());
+      entries.keys.pop_front();
+    }
+    entries.characteristics.emplace(key, *characteristics);
+    entries.keys.push_back(key);
+  }
+  UpdateStatsLocked(query, /*hit=*/false, start_time);
+  return OK;
+}
+
+void CharacteristicsCache::Invalidate() {
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  for (auto& entries : entries_) {
+    entries.characteristics.clear();
+    entries.keys.clear();
+  }
+  generation_++;
+}
+
+CharacteristicsCache::Stats CharacteristicsCache::GetStats(Query query) {
+  if (query >= Query::kNumQueries) {
+    ALOGE("%s: Invalid query %u.", __FUNCTION__,
+          static_cast<uint32_t>(query));
+    return {};
+  }
+
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  return entries_[static_cast<uint32_t>(query)].stats;
+}
+
+void CharacteristicsCache::Dump(int fd) {
+  static const char* kQueryNames[] = {"characteristics",
+                                      "physical characteristics",
+                                      "session characteristics"};
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  for (uint32_t i = 0; i < static_cast<uint32_t>(Query::kNumQueries); i++) {
+    const Stats& stats = entries_[i].stats;
+    dprintf(fd,
+            "  %s: %" PRIu64 " hits (%" PRId64 " us avg), %" PRIu64
+            " misses (%" PRId64 " us avg)\n",
+            kQueryNames[i], stats.hits,
+            stats.hits > 0 ? ns2us(stats.hit_duration) / (int64_t)stats.hits
+                           : 0,
+            stats.misses,
+            stats.misses > 0
+                ? ns2us(stats.miss_duration) / (int64_t)stats.misses
+                : 0);
+  }
+}
+
+void CharacteristicsCache::UpdateStatsLocked(Query query, bool hit,
+                                             nsecs_t start_time) {
+  Stats& stats = entries_[static_cast<uint32_t>(query)].stats;
+  nsecs_t duration = systemTime(SYSTEM_TIME_MONOTONIC) - start_time;
+  if (hit) {
+    stats.hits++;
+    stats.hit_duration += duration;
+  } else {
+    stats.misses++;
+    stats.miss_duration += duration;
+  }
+}
+
+std::string CharacteristicsCache::GetSessionKey(
+    const StreamConfiguration& stream_config) {
+  // Every stream field but the ID.
+  std::vector<std::string> streams;
+  for (auto& stream : stream_config.streams) {
+    streams.push_back(
+        std::to_string(static_cast<int32_t>(stream.stream_type)) + "," +
+        std::to_string(stream.width) + "x" + std::to_string(stream.height) +
+        "," + std::to_string(static_cast<int32_t>(stream.format)) + "," +
+        std::to_string(stream.usage) + "," +
+        std::to_string(static_cast<int32_t>(stream.data_space)) + "," +
+        std::to_string(static_cast<int32_t>(stream.rotation)) + "," +
+        std::to_string(stream.is_physical_camera_stream) + "," +
+        std::to_string(stream.physical_camera_id) + "," +
+        std::to_string(stream.buffer_size) + "," +
+        std::to_string(stream.group_id) + "," +
+        std::to_string(stream.intended_for_max_resolution_mode) + "," +
+        std::to_string(stream.intended_for_default_resolution_mode) + "," +
+        std::to_string(static_cast<int64_t>(stream.dynamic_profile)) + "," +
+        std::to_string(static_cast<int64_t>(stream.use_case)) + "," +
+        std::to_string(static_cast<int64_t>(stream.color_space)));
+  }
+  std::sort(streams.begin(), streams.end());
+
+  std::string key =
+      std::to_string(static_cast<uint32_t>(stream_config.operation_mode)) +
+      (stream_config.multi_resolution_input_image ? "|multi_res" : "");
+  for (auto& stream : streams) {
+    key += "|" + stream;
+  }
+  key += "|";
+  if (stream_config.session_params != nullptr) {
+    auto session_params = reinterpret_cast<const char*>(
+        stream_config.session_params->GetRawCameraMetadata());
+    key.append(session_params,
+               stream_config.session_params->GetCameraMetadataSize());
+  }
+  return key;
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_CHARACTERISTICS_CACHE_H
+#define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_CHARACTERISTICS_CACHE_H
+
+#include <utils/Errors.h>
+#include <utils/Timers.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hal_camera_metadata.h"
+#include "hal_types.h"
+
+namespace android {
+namespace google_camera_hal {
+
+// CharacteristicsCache keeps the serialized camera, physical camera and
+// session characteristics of a camera device, as the camera service queries
+// them repeatedly while setting up a session. Session characteristics are
+// cached per stream configuration, see GetSessionKey(). The device is queried
+// without holding the cache lock, and a result queried before Invalidate() is
+// not cached.
+class CharacteristicsCache {
+ public:
+  // Cached queries.
+  enum class Query : uint32_t {
+    kCharacteristics = 0,
+    kPhysicalCharacteristics,
+    kSessionCharacteristics,
+    kNumQueries,
+  };
+
+  // Counters of a cached query.
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    nsecs_t hit_duration = 0;
+    nsecs_t miss_duration = 0;
+  };
+
+  // Maximum number of cached entries per query. The oldest entry is dropped
+  // first.
+  static constexpr size_t kMaxEntries = 16;
+
+  // Query of the device on a cache miss.
+  using QueryFunc =
+      std::function<status_t(std::unique_ptr<HalCameraMetadata>* metadata)>;
+
+  CharacteristicsCache() = default;
+
+  // Get the camera characteristics, calling query on a cache miss.
+  status_t GetCharacteristics(const QueryFunc& query,
+                              std::vector<uint8_t>* characteristics);
+
+  // Get the characteristics of a physical camera, calling query on a cache
+  // miss.
+  status_t GetPhysicalCharacteristics(uint32_t physical_camera_id,
+                                      const QueryFunc& query,
+                                      std::vector<uint8_t>* characteristics);
+
+  // Get the session characteristics of stream_config, calling query on a
+  // cache miss.
+  status_t GetSessionCharacteristics(const StreamConfiguration& stream_config,
+                                     const QueryFunc& query,
+                                     std::vector<uint8_t>* characteristics);
+
+  // Drop the cached characteristics, which may change with the device state.
+  void Invalidate();
+
+  Stats GetStats(Query query);
+
+  // Print the stats of the queries to fd.
+  void Dump(int fd);
+
+  // Get a key that is the same for stream configurations that only differ in
+  // stream IDs, stream order, configuration counters or log IDs.
+  static std::string GetSessionKey(const StreamConfiguration& stream_config);
+
+ private:
+  // Cached entries of a query.
+  struct Entries {
+    std::unordered_map<std::string, std::vector<uint8_t>> characteristics;
+    // Keys from the oldest to the newest entry.
+    std::deque<std::string> keys;
+    Stats stats;
+  };
+
+  status_t Get(Query query, const std::string& key, const QueryFunc& query_func,
+               std::vector<uint8_t>* characteristics);
+
+  // Update the stats of query with a lookup that took the time since
+  // start_time. Must be called with cache_lock_ locked.
+  void UpdateStatsLocked(Query query, bool hit, nsecs_t start_time);
+
+  // Do not support the copy constructor or assignment operator
+  CharacteristicsCache(const CharacteristicsCache&) = delete;
+  CharacteristicsCache& operator=(const CharacteristicsCache&) = delete;
+
+  std::mutex cache_lock_;
+
+  // Protected by cache_lock_.
+  Entries entries_[static_cast<uint32_t>(Query::kNumQueries)];
+
+  // Incremented by Invalidate(). Protected by cache_lock_.
+  uint64_t generation_ = 0;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_UTILS_CHARACTERISTICS_CACHE_H
@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "GCH_GyroVideoStabilizer"
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#include "gyro_video_stabilizer.h"
+
+namespace android {
+namespace google_camera_hal {
+
+std::unique_ptr<GyroVideoStabilizer> GyroVideoStabilizer::Create(
+    const Config& config) {
+  if (config.width < 2 || config.height < 2 || config.focal_length_px <= 0 ||
+      config.margin < 0 || config.margin > 0.25f ||
+      config.smoothing_time_ns <= 0) {
+    ALOGE("%s: Invalid config %ux%u focal length %f margin %f smoothing %"
+          PRId64,
+          __FUNCTION__, config.width, config.height, config.focal_length_px,
+          config.margin, config.smoothing_time_ns);
+    return nullptr;
+  }
+
+  return std::unique_ptr<GyroVideoStabilizer>(new GyroVideoStabilizer(config));
+}
+
+status_t GyroVideoStabilizer::AddGyroSamples(
+    const std::vector<GyroSample>& samples) {
+  int64_t last_timestamp_ns = INT64_MIN;
+  if (!samples_.empty()) {
+    last_timestamp_ns = samples_.back().timestamp_ns;
+  } else if (has_last_sample_) {
+    last_timestamp_ns = last_sample_.timestamp_ns;
+  }
+  for (auto& sample : samples) {
+    if (sample.timestamp_ns <= last_timestamp_ns) {
+      ALOGE("%s: Sample at %" PRId64 " is not newer than %" PRId64,
+            __FUNCTION__, sample.timestamp_ns, last_timestamp_ns);
+      return BAD_VALUE;
+    }
+    last_timestamp_ns = sample.timestamp_ns;
+  }
+
+  samples_.insert(samples_.end(), samples.begin(), samples.end());
+  return OK;
+}
+
+void GyroVideoStabilizer::Integrate(int64_t timestamp_ns) {
+  while (!samples_.empty() && samples_.front().timestamp_ns <= timestamp_ns) {
+    const GyroSample& sample = samples_.front();
+    if (has_last_sample_) {
+      // Trapezoidal integration between consecutive samples.
+      float dt = (sample.timestamp_ns - last_sample_.timestamp_ns) * 1e-9f;
+      orientation_[0] += 0.5f * (last_sample_.x + sample.x) * dt;
+      orientation_[1] += 0.5f * (last_sample_.y + sample.y) * dt;
+      orientation_[2] += 0.5f * (last_sample_.z + sample.z) * dt;
+    }
+    last_sample_ = sample;
+    has_last_sample_ = true;
+    samples_.pop_front();
+  }
+
+  // Hold the last rate until the frame, the next sample continues from there.
+  if (has_last_sample_ && timestamp_ns > last_sample_.timestamp_ns) {
+    float dt = (timestamp_ns - last_sample_.timestamp_ns) * 1e-9f;
+    orientation_[0] += last_sample_.x * dt;
+    orientation_[1] += last_sample_.y * dt;
+    orientation_[2] += last_sample_.z * dt;
+    last_sample_.timestamp_ns = timestamp_ns;
+  }
+}
+
+status_t GyroVideoStabilizer::ComputeCorrection(
+    int64_t timestamp_ns, StabilizationCorrection* correction) {
+  ATRACE_CALL();
+  if (correction == nullptr) {
+    ALOGE("%s: correction is nullptr", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  if (path_started_ && timestamp_ns <= last_frame_timestamp_ns_) {
+    ALOGE("%s: Frame at %" PRId64 " is not newer than %" PRId64, __FUNCTION__,
+          timestamp_ns, last_frame_timestamp_ns_);
+    return BAD_VALUE;
+  }
+
+  Integrate(timestamp_ns);
+
+  if (!path_started_) {
+    std::copy(orientation_, orientation_ + 3, smooth_orientation_);
+    path_started_ = true;
+  } else {
+    // First order low-pass filter of the orientation.
+    float alpha =
+        1.f - std::exp(-static_cast<float>(timestamp_ns -
+                                           last_frame_timestamp_ns_) /
+                       config_.smoothing_time_ns);
+    for (size_t i = 0; i < 3; i++) {
+      smooth_orientation_[i] +=
+          alpha * (orientation_[i] - smooth_orientation_[i]);
+    }
+  }
+  last_frame_timestamp_ns_ = timestamp_ns;
+
+  // Turning the camera right (+y) moves the content left and turning it up
+  // (+x) moves the content down.
+  const float f = focal_length_px_;
+  float dx = f * std::tan(smooth_orientation_[1] - orientation_[1]);
+  float dy = -f * std::tan(smooth_orientation_[0] - orientation_[0]);
+  float roll = smooth_orientation_[2] - orientation_[2];
+
+  // Half of the margin is available to the rotation, which moves the corners
+  // of the scaled window by about half its size times the angle.
+  const float scale = 1.f - 2.f * config_.margin;
+  const float half_width = 0.5f * scale * config_.width;
+  const float half_height = 0.5f * scale * config_.height;
+  const float margin_x = config_.margin * config_.width;
+  const float margin_y = config_.margin * config_.height;
+  const float max_roll =
+      std::min(0.5f * margin_x / half_height, 0.5f * margin_y / half_width);
+  float clamped_roll = std::clamp(roll, -max_roll, max_roll);
+  float max_dx = margin_x - half_height * std::fabs(clamped_roll);
+  float max_dy = margin_y - half_width * std::fabs(clamped_roll);
+  float clamped_dx = std::clamp(dx, -max_dx, max_dx);
+  float clamped_dy = std::clamp(dy, -max_dy, max_dy);
+
+  // Pull the virtual camera back when the correction hits the limits, so
+  // it follows intentional motion like panning.
+  if (clamped_roll != roll) {
+    smooth_orientation_[2] = orientation_[2] + clamped_roll;
+  }
+  if (clamped_dx != dx) {
+    smooth_orientation_[1] = orientation_[1] + std::atan(clamped_dx / f);
+  }
+  if (clamped_dy != dy) {
+    smooth_orientation_[0] = orientation_[0] - std::atan(clamped_dy / f);
+  }
+
+  *correction = {.dx = clamped_dx, .dy = clamped_dy, .roll = clamped_roll};
+  return OK;
+}
+
+namespace {
+
+typedef uint8_t Uint8x8 __attribute__((vector_size(8)));
+typedef uint8_t Uint8x16 __attribute__((vector_size(16)));
+typedef uint16_t Uint16x8 __attribute__((vector_size(16)));
+typedef int32_t Int32x8 __attribute__((vector_size(32)));
+
+#if (defined(__ARM_NEON) && defined(__aarch64__)) || defined(__SSSE3__)
+constexpr bool kHasVectorLookUp = true;
+#else
+constexpr bool kHasVectorLookUp = false;
+#endif
+
+// Pixels warped per vector block.
+constexpr uint32_t kBlockSize = 8;
+// Source samples a block may span, including the right neighbours.
+constexpr int32_t kWindowSize = 16;
+
+// Coordinates are 16.16 fixed point.
+constexpr int32_t kFixedOne = 1 << 16;
+
+// Look up the 16 bytes of window at index, which must be in [0, 16).
+inline Uint8x16 LookUp(const uint8_t* window, Uint8x16 index) {
+#if defined(__ARM_NEON) && defined(__aarch64__)
+  uint8x16_t table_neon = vld1q_u8(window);
+  uint8x16_t index_neon;
+  std::memcpy(&index_neon, &index, sizeof(index_neon));
+  uint8x16_t result_neon = vqtbl1q_u8(table_neon, index_neon);
+  Uint8x16 result;
+  std::memcpy(&result, &result_neon, sizeof(result));
+  return result;
+#elif defined(__SSSE3__)
+  __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(window));
+  return (Uint8x16)_mm_shuffle_epi8(table, (__m128i)index);
+#else
+  Uint8x16 result;
+  for (int32_t i = 0; i < kWindowSize; i++) {
+    result[i] = window[index[i]];
+  }
+  return result;
+#endif
+}
+
+// Blend with 8-bit weights in [0, 256], rounding after each direction so
+// the vector blocks can stay in 16 bits.
+inline uint32_t Lerp(uint32_t a, uint32_t b, uint32_t w) {
+  return (a * (256 - w) + b * w + 128) >> 8;
+}
+
+}  // namespace
+
+void GyroVideoStabilizer::WarpPlane(const uint8_t* src, uint32_t src_stride,
+                                    uint32_t src_step, uint8_t* dst,
+                                    uint32_t dst_stride, uint32_t dst_step,
+                                    uint32_t width, uint32_t height,
+                                    const float origin[2],
+                                    const float x_axis[2],
+                                    const float y_axis[2], bool bilinear) {
+  const int32_t max_u = (width - 1) * kFixedOne;
+  const int32_t max_v = (height - 1) * kFixedOne;
+  // Top left sample of the bilinear footprint, keeping one sample to its
+  // right and below.
+  const int32_t max_ix = std::max<int32_t>(width - 2, 0);
+  const int32_t max_iy = std::max<int32_t>(height - 2, 0);
+  const int32_t next_x = width > 1 ? src_step : 0;
+  const int32_t next_y = height > 1 ? src_stride : 0;
+  const int32_t du = std::lround(x_axis[0] * kFixedOne);
+  const int32_t dv = std::lround(x_axis[1] * kFixedOne);
+  // Positions whose footprint needs no clamping.
+  const int32_t max_inner_u = (max_ix + 1) * kFixedOne - 1;
+  const int32_t max_inner_v = (max_iy + 1) * kFixedOne - 1;
+  // Blocks read a whole window from the left sample, which must stay in the
+  // row.
+  const int32_t max_window_ix = static_cast<int32_t>(width) - kWindowSize;
+  const bool use_blocks = kHasVectorLookUp && bilinear && src_step == 1 &&
+                          max_window_ix >= 0 && height > 1;
+
+  const Int32x8 lanes = {0, 1, 2, 3, 4, 5, 6, 7};
+  const Int32x8 lane_du = lanes * du;
+  const Int32x8 lane_dv = lanes * dv;
+
+  for (uint32_t y = 0; y < height; y++) {
+    const int32_t row_u =
+        std::lround((origin[0] + y * y_axis[0]) * kFixedOne);
+    const int32_t row_v =
+        std::lround((origin[1] + y * y_axis[1]) * kFixedOne);
+    uint8_t* out = dst + y * dst_stride;
+
+    uint32_t x = 0;
+    while (x < width) {
+      int32_t u = row_u + static_cast<int32_t>(x) * du;
+      int32_t v = row_v + static_cast<int32_t>(x) * dv;
+      if (use_blocks && x + kBlockSize <= width) {
+        // The footprint moves linearly, so the first and last pixels bound
+        // the block. Use the vector path when the block reads one row pair
+        // within a window and needs no clamping.
+        int32_t last_u = u + (kBlockSize - 1) * du;
+        int32_t last_v = v + (kBlockSize - 1) * dv;
+        int32_t iy = v >> 16;
+        int32_t left = std::min(u, last_u) >> 16;
+        int32_t right = std::max(u, last_u) >> 16;
+        if (std::min(u, last_u) >= 0 && std::max(u, last_u) <= max_inner_u &&
+            std::min(v, last_v) >= 0 && std::max(v, last_v) <= max_inner_v &&
+            iy == (last_v >> 16) && right - left < kWindowSize - 1 &&
+            left <= max_window_ix) {
+          Int32x8 block_u = u + lane_du;
+          Int32x8 block_v = v + lane_dv;
+          // Each 16-bit lane looks up a sample and its right neighbour,
+          // which land in the low and high byte of the lane.
+          Uint16x8 offset =
+              __builtin_convertvector((block_u >> 16) - left, Uint16x8);
+          Uint8x16 index = (Uint8x16)(offset | ((offset + 1) << 8));
+          Uint16x8 wx =
+              __builtin_convertvector((block_u >> 8) & 0xFF, Uint16x8);
+          Uint16x8 wy =
+              __builtin_convertvector((block_v >> 8) & 0xFF, Uint16x8);
+
+          const uint8_t* window = src + iy * src_stride + left;
+          Uint16x8 top_row = (Uint16x8)LookUp(window, index);
+          Uint16x8 bottom_row = (Uint16x8)LookUp(window + src_stride, index);
+          Uint16x8 top =
+              ((top_row & 0xFF) * (256 - wx) + (top_row >> 8) * wx + 128) >> 8;
+          Uint16x8 bottom = ((bottom_row & 0xFF) * (256 - wx) +
+                             (bottom_row >> 8) * wx + 128) >>
+                            8;
+          Uint8x8 value = __builtin_convertvector(
+              (top * (256 - wy) + bottom * wy + 128) >> 8, Uint8x8);
+          if (dst_step == 1) {
+            std::memcpy(out + x, &value, sizeof(value));
+          } else {
+            for (uint32_t i = 0; i < kBlockSize; i++) {
+              out[(x + i) * dst_step] = value[i];
+            }
+          }
+          x += kBlockSize;
+          continue;
+        }
+      }
+
+      // Clamped scalar path for the borders, blocks the vector path cannot
+      // load and nearest sampling.
+      uint32_t end = use_blocks ? std::min(x + kBlockSize, width) : width;
+      for (; x < end; x++, u += du, v += dv) {
+        int32_t su = std::clamp(u, 0, max_u);
+        int32_t sv = std::clamp(v, 0, max_v);
+        if (!bilinear) {
+          int32_t ix = (su + kFixedOne / 2) >> 16;
+          int32_t iy = (sv + kFixedOne / 2) >> 16;
+          out[x * dst_step] = src[iy * src_stride + ix * src_step];
+          continue;
+        }
+        int32_t ix = std::min(su >> 16, max_ix);
+        int32_t iy = std::min(sv >> 16, max_iy);
+        uint32_t wx = (su - ix * kFixedOne) >> 8;
+        uint32_t wy = (sv - iy * kFixedOne) >> 8;
+        const uint8_t* p = src + iy * src_stride + ix * src_step;
+        out[x * dst_step] = static_cast<uint8_t>(
+            Lerp(Lerp(p[0], p[next_x], wx),
+                 Lerp(p[next_y], p[next_y + next_x], wx), wy));
+      }
+    }
+  }
+}
+
+status_t GyroVideoStabilizer::Warp(const StabilizerImage& input,
+                                   const StabilizationCorrection& correction,
+                                   const StabilizerImage& output) {
+  ATRACE_CALL();
+  if (input.width != config_.width || input.height != config_.height ||
+      output.width != config_.width || output.height != config_.height) {
+    ALOGE("%s: Input %ux%u or output %ux%u does not match %ux%u",
+          __FUNCTION__, input.width, input.height, output.width,
+          output.height, config_.width, config_.height);
+    return BAD_VALUE;
+  }
+  if (input.y == nullptr || input.cb == nullptr || input.cr == nullptr ||
+      output.y == nullptr || output.cb == nullptr || output.cr == nullptr) {
+    ALOGE("%s: Missing planes", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  bool bilinear = fast_path_frames_left_ == 0;
+  if (!bilinear) {
+    fast_path_frames_left_--;
+    stats_.fast_path_frames++;
+  }
+
+  // The source position of an output pixel center p is
+  // center + d + scale * R(roll) * (p - center), in pixel center units.
+  const float scale = 1.f - 2.f * config_.margin;
+  const float cos_roll = scale * std::cos(correction.roll);
+  const float sin_roll = scale * std::sin(correction.roll);
+  const float x_axis[2] = {cos_roll, sin_roll};
+  const float y_axis[2] = {-sin_roll, cos_roll};
+  auto get_origin = [&](float width, float height, float subsampling,
+                        float origin[2]) {
+    float center_x = 0.5f * width;
+    float center_y = 0.5f * height;
+    float px = 0.5f - center_x;
+    float py = 0.5f - center_y;
+    origin[0] = center_x + correction.dx / subsampling +
+                cos_roll * px - sin_roll * py - 0.5f;
+    origin[1] = center_y + correction.dy / subsampling +
+                sin_roll * px + cos_roll * py - 0.5f;
+  };
+
+  float origin[2];
+  get_origin(config_.width, config_.height, /*subsampling=*/1.f, origin);
+  WarpPlane(input.y, input.y_stride, /*src_step=*/1, output.y,
+            output.y_stride, /*dst_step=*/1, config_.width, config_.height,
+            origin, x_axis, y_axis, bilinear);
+
+  uint32_t chroma_width = (config_.width + 1) / 2;
+  uint32_t chroma_height = (config_.height + 1) / 2;
+  get_origin(chroma_width, chroma_height, /*subsampling=*/2.f, origin);
+  WarpPlane(input.cb, input.cbcr_stride, input.cbcr_step, output.cb,
+            output.cbcr_stride, output.cbcr_step, chroma_width, chroma_height,
+            origin, x_axis, y_axis, bilinear);
+  WarpPlane(input.cr, input.cbcr_stride, input.cbcr_step, output.cr,
+            output.cbcr_stride, output.cbcr_step, chroma_width, chroma_height,
+            origin, x_axis, y_axis, bilinear);
+
+  int64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+  stats_.frames++;
+  stats_.max_warp_duration_ns =
+      std::max(stats_.max_warp_duration_ns, duration_ns);
+  if (bilinear && duration_ns > config_.latency_budget_ns) {
+    ALOGV("%s: Warp took %" PRId64 " ns, budget %" PRId64 " ns", __FUNCTION__,
+          duration_ns, config_.latency_budget_ns);
+    stats_.over_budget_frames++;
+    fast_path_frames_left_ = kFastPathFrames;
+  }
+
+  return OK;
+}
+
+void GyroVideoStabilizer::Reset() {
+  samples_.clear();
+  has_last_sample_ = false;
+  path_started_ = false;
+  last_frame_timestamp_ns_ = 0;
+  std::fill(orientation_, orientation_ + 3, 0.f);
+  std::fill(smooth_orientation_, smooth_orientation_ + 3, 0.f);
+}
+
+status_t GyroVideoStabilizer::SetFocalLength(float focal_length_px) {
+  if (focal_length_px <= 0) {
+    ALOGE("%s: Invalid focal length %f", __FUNCTION__, focal_length_px);
+    return BAD_VALUE;
+  }
+
+  focal_length_px_ = focal_length_px;
+  return OK;
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_GYRO_VIDEO_STABILIZER_H_
+#define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_GYRO_VIDEO_STABILIZER_H_
+
+#include <utils/Errors.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+// Angular velocity of the camera in rad/s. The axes follow the image: x
+// points right, y points down and z along the optical axis.
+struct GyroSample {
+  int64_t timestamp_ns = 0;
+  float x = 0;
+  float y = 0;
+  float z = 0;
+};
+
+// Output window of a stabilized frame in the input frame.
+struct StabilizationCorrection {
+  // Offset in pixels of the window center from the image center.
+  float dx = 0;
+  float dy = 0;
+  // Rotation of the window around its center in radians.
+  float roll = 0;
+};
+
+// 8-bit YUV420 image. cbcr_step is the distance in bytes between two chroma
+// samples of a row, 1 for planar and 2 for semi-planar layouts.
+struct StabilizerImage {
+  uint8_t* y = nullptr;
+  uint8_t* cb = nullptr;
+  uint8_t* cr = nullptr;
+  uint32_t y_stride = 0;
+  uint32_t cbcr_stride = 0;
+  uint32_t cbcr_step = 1;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+// GyroVideoStabilizer is a CPU electronic image stabilization stage for
+// YUV streams. It integrates gyro samples into the camera orientation at each
+// frame, low-pass filters the orientation into a smooth virtual camera path
+// and warps each frame from the real camera into the virtual one. The output
+// is cropped by the configured margin on every side to leave room for the
+// correction, which is limited so the window never leaves the input.
+//
+// The bilinear warp runs within a per frame latency budget. When a warp
+// exceeds the budget, the following frames use nearest sampling until the
+// bilinear warp is probed again.
+//
+// Not thread safe.
+class GyroVideoStabilizer {
+ public:
+  struct Config {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Focal length in pixels of the image.
+    float focal_length_px = 0;
+    // Fraction of the width and height reserved on each side for the
+    // correction, in [0, 0.25].
+    float margin = 0.1f;
+    // Time constant of the virtual camera path.
+    int64_t smoothing_time_ns = 500'000'000;
+    int64_t latency_budget_ns = 5'000'000;
+  };
+
+  struct Stats {
+    uint64_t frames = 0;
+    // Frames that used nearest sampling to stay within the budget.
+    uint64_t fast_path_frames = 0;
+    // Bilinear warps that exceeded the budget.
+    uint64_t over_budget_frames = 0;
+    int64_t max_warp_duration_ns = 0;
+  };
+
+  static std::unique_ptr<GyroVideoStabilizer> Create(const Config& config);
+
+  // Queue gyro samples, which must be in timestamp order and newer than the
+  // last frame passed to ComputeCorrection().
+  status_t AddGyroSamples(const std::vector<GyroSample>& samples);
+
+  // Integrate the queued gyro samples up to timestamp_ns, usually the middle
+  // of the frame exposure, and compute the correction of the frame.
+  // Timestamps must increase between calls.
+  status_t ComputeCorrection(int64_t timestamp_ns,
+                             StabilizationCorrection* correction);
+
+  // Warp input into output, which must have the configured size and must not
+  // overlap input.
+  status_t Warp(const StabilizerImage& input,
+                const StabilizationCorrection& correction,
+                const StabilizerImage& output);
+
+  // Restart the virtual camera path at the next frame.
+  void Reset();
+
+  // Change the focal length of the image, e.g. when the stream is zoomed.
+  // The camera path is kept.
+  status_t SetFocalLength(float focal_length_px);
+
+  const Stats& GetStats() const {
+    return stats_;
+  }
+
+ protected:
+  explicit GyroVideoStabilizer(const Config& config)
+      : config_(config), focal_length_px_(config.focal_length_px) {
+  }
+
+ private:
+  // Frames using nearest sampling after a warp exceeded the budget.
+  static constexpr uint32_t kFastPathFrames = 30;
+
+  // Integrate the gyro samples up to timestamp_ns into orientation_.
+  void Integrate(int64_t timestamp_ns);
+
+  // Warp one plane of width x height samples, which are step bytes apart in
+  // a row. The source position of output sample (x, y) is
+  // origin + x * x_axis + y * y_axis. Bilinear blocks of pixels that read
+  // one row pair of a planar source are interpolated with vector table
+  // lookups, the rest sample one pixel at a time.
+  static void WarpPlane(const uint8_t* src, uint32_t src_stride,
+                        uint32_t src_step, uint8_t* dst, uint32_t dst_stride,
+                        uint32_t dst_step, uint32_t width, uint32_t height,
+                        const float origin[2], const float x_axis[2],
+                        const float y_axis[2], bool bilinear);
+
+  const Config config_;
+  // Starts at config_.focal_length_px.
+  float focal_length_px_;
+  Stats stats_;
+
+  std::deque<GyroSample> samples_;
+  // Last integrated sample, the integration continues from here.
+  GyroSample last_sample_;
+  bool has_last_sample_ = false;
+  int64_t last_frame_timestamp_ns_ = 0;
+
+  // Orientation of the real and the virtual camera around x, y and z.
+  float orientation_[3] = {0};
+  float smooth_orientation_[3] = {0};
+  bool path_started_ = false;
+
+  uint32_t fast_path_frames_left_ = 0;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_UTILS_GYRO_VIDEO_STABILIZER_H_
@@ -98,11 +98,27 @@ HalCameraMetadata::~HalCameraMetadata() {
 
   if (metadata_ != nullptr) {
     free_camera_metadata(metadata_);
+    metadata_ = nullptr;
   }
+  UpdateTrackedBytesLocked();
 }
 
 HalCameraMetadata::HalCameraMetadata(camera_metadata_t* metadata)
-    : metadata_(metadata) {
+    : metadata_(metadata),
+      memory_session_(MemoryTracker::GetCurrentSessionCounters()) {
+  std::unique_lock<std::mutex> lock(metadata_lock_);
+  UpdateTrackedBytesLocked();
+}
+
+void HalCameraMetadata::UpdateTrackedBytesLocked() {
+  size_t bytes =
+      (metadata_ == nullptr) ? 0 : get_camera_metadata_size(metadata_);
+  if (bytes != tracked_bytes_) {
+    MemoryTracker::GetInstance().Update(
+        MemoryCategory::kMetadata, memory_session_,
+        static_cast<int64_t>(bytes) - static_cast<int64_t>(tracked_bytes_));
+    tracked_bytes_ = bytes;
+  }
 }
 
 camera_metadata_t* HalCameraMetadata::ReleaseCameraMetadata() {
@@ -110,6 +126,7 @@ camera_metadata_t* HalCameraMetadata::ReleaseCameraMetadata() {
 
   camera_metadata_t* metadata = metadata_;
   metadata_ = nullptr;
+  UpdateTrackedBytesLocked();
 
   return metadata;
 }
@@ -161,6 +178,7 @@ status_t HalCameraMetadata::ResizeIfNeeded(size_t extra_entries,
     }
     append_camera_metadata(metadata_, metadata);
     free_camera_metadata(metadata);
+    UpdateTrackedBytesLocked();
   }
 
   return OK;
@@ -457,6 +475,7 @@ status_t HalCameraMetadata::Erase(const std::unordered_set<uint32_t>& tags) {
   }
 
   free_camera_metadata(orig_metadata);
+  UpdateTrackedBytesLocked();
   return OK;
 }
 
@@ -24,6 +24,8 @@
 #include <unordered_set>
 #include <vector>
 
+#include "memory_tracker.h"
+
 namespace android {
 namespace google_camera_hal {
 
@@ -145,9 +147,16 @@ class HalCameraMetadata {
   status_t CopyEntry(const camera_metadata_t* src, camera_metadata_t* dest,
                      size_t entry_index) const;
 
+  // Report the size change of metadata_ to MemoryTracker.
+  void UpdateTrackedBytesLocked();
+
   // Camera metadata owned by this HalCameraMetadata.
   mutable std::mutex metadata_lock_;
   camera_metadata_t* metadata_ = nullptr;
+  // Counters of the memory session of the metadata, nullptr if it has none,
+  // and the size reported for it.
+  std::shared_ptr<MemoryTracker::SessionCounters> memory_session_;
+  size_t tracked_bytes_ = 0;
 };
 
 }  // namespace google_camera_hal
@@ -22,6 +22,7 @@
 #include <inttypes.h>
 #include <log/log.h>
 
+#include <algorithm>
 #include <string>
 
 #include "vendor_tag_defs.h"
@@ -239,6 +240,78 @@ bool IsFixedFocusCamera(const HalCameraMetadata* characteristics) {
   return entry.data.f[0] == 0.0f;
 }
 
+status_t GetMaxOutputSize(const HalCameraMetadata* characteristics,
+                          int32_t format, uint32_t* width, uint32_t* height) {
+  if (characteristics == nullptr || width == nullptr || height == nullptr) {
+    ALOGE("%s: characteristics (%p), width (%p) or height (%p) is nullptr",
+          __FUNCTION__, characteristics, width, height);
+    return BAD_VALUE;
+  }
+
+  camera_metadata_ro_entry entry = {};
+  status_t res = characteristics->Get(
+      ANDROID_SCALER_AVAILABLE_STREAM_CONFIGURATIONS, &entry);
+  if (res != OK) {
+    ALOGE("%s: Getting ANDROID_SCALER_AVAILABLE_STREAM_CONFIGURATIONS failed",
+          __FUNCTION__);
+    return res;
+  }
+
+  uint64_t max_area = 0;
+  for (size_t i = 0; i + 3 < entry.count; i += 4) {
+    if (entry.data.i32[i] != format ||
+        entry.data.i32[i + 3] !=
+            ANDROID_SCALER_AVAILABLE_STREAM_CONFIGURATIONS_OUTPUT) {
+      continue;
+    }
+    uint64_t area = static_cast<uint64_t>(entry.data.i32[i + 1]) *
+                    entry.data.i32[i + 2];
+    if (area > max_area) {
+      max_area = area;
+      *width = entry.data.i32[i + 1];
+      *height = entry.data.i32[i + 2];
+    }
+  }
+
+  if (max_area == 0) {
+    ALOGE("%s: No output size for format 0x%x", __FUNCTION__, format);
+    return NAME_NOT_FOUND;
+  }
+  return OK;
+}
+
+bool IsReprocessInputSupported(const HalCameraMetadata* characteristics,
+                               int32_t format) {
+  if (characteristics == nullptr) {
+    ALOGE("%s: characteristics (%p) is nullptr", __FUNCTION__, characteristics);
+    return false;
+  }
+
+  camera_metadata_ro_entry entry = {};
+  if (characteristics->Get(ANDROID_SCALER_AVAILABLE_INPUT_OUTPUT_FORMATS_MAP,
+                           &entry) != OK) {
+    return false;
+  }
+
+  // The map is a list of input formats, each followed by the number of its
+  // output formats and the output formats.
+  size_t i = 0;
+  while (i + 1 < entry.count) {
+    int32_t input_format = entry.data.i32[i];
+    size_t num_outputs = entry.data.i32[i + 1];
+    i += 2;
+    for (size_t j = i; j < std::min(i + num_outputs, entry.count); j++) {
+      if (input_format == format &&
+          (entry.data.i32[j] == HAL_PIXEL_FORMAT_YCBCR_420_888 ||
+           entry.data.i32[j] == HAL_PIXEL_FORMAT_BLOB)) {
+        return true;
+      }
+    }
+    i += num_outputs;
+  }
+  return false;
+}
+
 bool IsRequestHdrplusCompatible(const CaptureRequest& request,
                                 int32_t preview_stream_id) {
   if (request.settings == nullptr) {
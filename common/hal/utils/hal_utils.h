@@ -70,6 +70,16 @@ bool IsRequestHdrplusCompatible(const CaptureRequest& request,
 // Return true if this is a fixed-focus camera.
 bool IsFixedFocusCamera(const HalCameraMetadata* characteristics);
 
+// Get the largest output size of format in
+// ANDROID_SCALER_AVAILABLE_STREAM_CONFIGURATIONS.
+status_t GetMaxOutputSize(const HalCameraMetadata* characteristics,
+                          int32_t format, uint32_t* width, uint32_t* height);
+
+// Return if format inputs can be reprocessed into YUV or JPEG outputs
+// according to ANDROID_SCALER_AVAILABLE_INPUT_OUTPUT_FORMATS_MAP.
+bool IsReprocessInputSupported(const HalCameraMetadata* characteristics,
+                               int32_t format);
+
 // Return if HDR+ stream is supported
 bool IsStreamHdrplusCompatible(const StreamConfiguration& stream_config,
                                const HalCameraMetadata* characteristics);
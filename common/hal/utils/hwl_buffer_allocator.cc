@@ -20,6 +20,7 @@
 #include <log/log.h>
 #include <utils/Trace.h>
 
+#include "caching_buffer_allocator.h"
 #include "hwl_buffer_allocator.h"
 
 namespace android {
@@ -47,7 +48,12 @@ std::unique_ptr<IHalBufferAllocator> HwlBufferAllocator::Create(
   std::unique_ptr<IHalBufferAllocator> base_allocator;
   base_allocator.reset(hwl_buffer_allocator.release());
 
-  return base_allocator;
+  // The HWL allocates the same internal stream buffers again when a session
+  // reconfigures its streams. The buffers belong to this allocator instance,
+  // so they are cached per instance and released with it.
+  return CachingBufferAllocator::Create(
+      std::move(base_allocator),
+      CachingBufferAllocator::GetDefaultMaxCachedBytes());
 }
 
 status_t HwlBufferAllocator::Initialize(
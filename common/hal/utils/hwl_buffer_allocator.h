@@ -33,7 +33,9 @@ namespace google_camera_hal {
 // of HWL allocator implementation
 class HwlBufferAllocator : IHalBufferAllocator {
  public:
-  // Creates HwlBuffer and allocate buffers
+  // Creates HwlBuffer and allocate buffers. Freed buffers are kept for reuse
+  // up to CachingBufferAllocator::GetDefaultMaxCachedBytes() and released
+  // when the returned allocator is destroyed.
   static std::unique_ptr<IHalBufferAllocator> Create(
       CameraBufferAllocatorHwl* camera_buffer_allocator_hwl);
 
@@ -59,6 +59,7 @@ void InternalStreamManager::Initialize(IHalBufferAllocator* buffer_allocator,
                                        int partial_result_count) {
   hwl_buffer_allocator_ = buffer_allocator;
   partial_result_count_ = partial_result_count;
+  memory_session_ = MemoryTracker::GetCurrentSession();
 }
 
 status_t InternalStreamManager::IsStreamRegisteredLocked(int32_t stream_id) const {
@@ -174,9 +175,13 @@ status_t InternalStreamManager::AllocateBuffersLocked(
     return res;
   }
 
+  // Buffers beyond the configured ones hold the ZSL history.
+  ScopedMemorySession memory_session(memory_session_);
   auto buffer_manager = std::make_unique<ZslBufferManager>(
       need_vendor_buffer ? hwl_buffer_allocator_ : nullptr,
-      partial_result_count_);
+      partial_result_count_,
+      additional_num_buffers > 0 ? MemoryCategory::kZslBuffer
+                                 : MemoryCategory::kInternalStreamBuffer);
   if (buffer_manager == nullptr) {
     ALOGE("%s: Failed to create a buffer manager for stream %d", __FUNCTION__,
           stream_id);
@@ -429,10 +434,30 @@ bool InternalStreamManager::IsPendingBufferEmpty(int32_t stream_id) {
   return buffer_managers_[owner_stream_id]->IsPendingBufferEmpty();
 }
 
+uint32_t InternalStreamManager::GetPendingRequestCount(int32_t stream_id) {
+  ATRACE_CALL();
+  std::lock_guard<std::mutex> lock(stream_mutex_);
+  if (!IsStreamAllocatedLocked(stream_id)) {
+    ALOGE("%s: Stream %d was not allocated.", __FUNCTION__, stream_id);
+    return 0;
+  }
+
+  int32_t owner_stream_id = GetBufferManagerOwnerIdLocked(stream_id);
+  if (owner_stream_id == kInvalidStreamId) {
+    ALOGE("%s: Cannot find a owner stream ID for stream %d", __FUNCTION__,
+          stream_id);
+    return 0;
+  }
+
+  return buffer_managers_[owner_stream_id]->GetPendingRequestCount();
+}
+
 status_t InternalStreamManager::GetMostRecentStreamBuffer(
-    int32_t stream_id, std::vector<StreamBuffer>* input_buffers,
+    int32_t stream_id, uint32_t frame_number,
+    std::vector<StreamBuffer>* input_buffers,
     std::vector<std::unique_ptr<HalCameraMetadata>>* input_buffer_metadata,
-    uint32_t payload_frames, int32_t min_filled_buffers) {
+    uint32_t payload_frames, int32_t min_filled_buffers,
+    ZslBufferManager::SelectionPolicy policy) {
   ATRACE_CALL();
   std::lock_guard<std::mutex> lock(stream_mutex_);
 
@@ -461,7 +486,7 @@ status_t InternalStreamManager::GetMostRecentStreamBuffer(
 
   std::vector<ZslBufferManager::ZslBuffer> filled_buffers;
   buffer_managers_[owner_stream_id]->GetMostRecentZslBuffers(
-      &filled_buffers, payload_frames, min_filled_buffers);
+      &filled_buffers, payload_frames, min_filled_buffers, policy);
 
   if (filled_buffers.size() == 0) {
     ALOGE("%s: There is no input buffers.", __FUNCTION__);
@@ -470,7 +495,8 @@ status_t InternalStreamManager::GetMostRecentStreamBuffer(
 
   // TODO(b/138592133): Remove AddPendingBuffers because internal stream manager
   // should not be responsible for saving the pending buffers' metadata.
-  buffer_managers_[owner_stream_id]->AddPendingBuffers(filled_buffers);
+  buffer_managers_[owner_stream_id]->AddPendingBuffers(frame_number,
+                                                      filled_buffers);
 
   for (uint32_t i = 0; i < filled_buffers.size(); i++) {
     StreamBuffer buffer = {};
@@ -483,7 +509,8 @@ status_t InternalStreamManager::GetMostRecentStreamBuffer(
     input_buffers->push_back(buffer);
     if (filled_buffers[i].metadata == nullptr) {
       std::vector<ZslBufferManager::ZslBuffer> buffers;
-      buffer_managers_[owner_stream_id]->CleanPendingBuffers(&buffers);
+      buffer_managers_[owner_stream_id]->CleanPendingBuffers(frame_number,
+                                                             &buffers);
       buffer_managers_[owner_stream_id]->ReturnZslBuffers(std::move(buffers));
       return INVALID_OPERATION;
     }
@@ -511,9 +538,11 @@ status_t InternalStreamManager::ReturnZslStreamBuffers(uint32_t frame_number,
   }
 
   std::vector<ZslBufferManager::ZslBuffer> zsl_buffers;
-  status_t res =
-      buffer_managers_[owner_stream_id]->CleanPendingBuffers(&zsl_buffers);
-  if (res != OK) {
+  status_t res = buffer_managers_[owner_stream_id]->CleanPendingBuffers(
+      frame_number, &zsl_buffers);
+  if (res == NAME_NOT_FOUND) {
+    return res;
+  } else if (res != OK) {
     ALOGE("%s: frame (%d)fail to return zsl stream buffers", __FUNCTION__,
           frame_number);
     return res;
@@ -25,6 +25,7 @@
 #include "camera_buffer_allocator_hwl.h"
 #include "hal_buffer_allocator.h"
 #include "hal_types.h"
+#include "memory_tracker.h"
 #include "zsl_buffer_manager.h"
 
 namespace android {
@@ -84,18 +85,28 @@ class InternalStreamManager {
                           const HalCameraMetadata* metadata,
                           int partial_result = 1);
 
-  // Get the most recent buffer and metadata.
+  // Get the most recent buffer and metadata as input of request
+  // frame_number, picked with policy. The buffers stay pending until they are
+  // returned with ReturnZslStreamBuffers(frame_number, stream_id).
   status_t GetMostRecentStreamBuffer(
-      int32_t stream_id, std::vector<StreamBuffer>* input_buffers,
+      int32_t stream_id, uint32_t frame_number,
+      std::vector<StreamBuffer>* input_buffers,
       std::vector<std::unique_ptr<HalCameraMetadata>>* input_buffer_metadata,
-      uint32_t payload_frames, int32_t min_filled_buffers = kMinFilledBuffers);
+      uint32_t payload_frames, int32_t min_filled_buffers = kMinFilledBuffers,
+      ZslBufferManager::SelectionPolicy policy =
+          ZslBufferManager::SelectionPolicy::kMostRecent);
 
-  // Return the buffer from GetMostRecentStreamBuffer
+  // Return the buffers GetMostRecentStreamBuffer got for request
+  // frame_number. Returns NAME_NOT_FOUND if the request has no pending
+  // buffers.
   status_t ReturnZslStreamBuffers(uint32_t frame_number, int32_t stream_id);
 
   // Check the pending buffer is empty or not
   bool IsPendingBufferEmpty(int32_t stream_id);
 
+  // Get the number of requests holding pending buffers of a stream.
+  uint32_t GetPendingRequestCount(int32_t stream_id);
+
  private:
   static constexpr int32_t kMinFilledBuffers = 3;
   static constexpr int32_t kStreamIdStart = kHalInternalStreamStart;
@@ -163,6 +174,10 @@ class InternalStreamManager {
 
   // Partial result count reported by camera HAL
   int partial_result_count_ = 1;
+
+  // Memory session of the thread that created the manager, the buffers are
+  // reported for.
+  uint32_t memory_session_ = MemoryTracker::kNoSession;
 };
 
 }  // namespace google_camera_hal
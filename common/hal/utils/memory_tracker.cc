@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "GCH_MemoryTracker"
+#include "memory_tracker.h"
+
+#include <log/log.h>
+#include <unistd.h>
+
+#include <cinttypes>
+
+namespace android {
+namespace google_camera_hal {
+
+static thread_local uint32_t current_session = MemoryTracker::kNoSession;
+static thread_local std::shared_ptr<MemoryTracker::SessionCounters>
+    current_session_counters;
+
+static int64_t ToKiB(int64_t bytes) {
+  return bytes / 1024;
+}
+
+// Raise peak to value if it is higher.
+static void UpdatePeak(std::atomic<int64_t>* peak, int64_t value) {
+  int64_t current_peak = peak->load(std::memory_order_relaxed);
+  while (value > current_peak &&
+         !peak->compare_exchange_weak(current_peak, value,
+                                      std::memory_order_relaxed)) {
+  }
+}
+
+// Add bytes to current, and raise peak if they were allocated.
+static void AddBytes(std::atomic<int64_t>* current, std::atomic<int64_t>* peak,
+                     int64_t bytes) {
+  int64_t value = current->fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  if (bytes > 0) {
+    UpdatePeak(peak, value);
+  }
+}
+
+MemoryTracker& MemoryTracker::GetInstance() {
+  static MemoryTracker instance;
+  return instance;
+}
+
+const char* MemoryTracker::GetCategoryName(MemoryCategory category) {
+  switch (category) {
+    case MemoryCategory::kInternalStreamBuffer:
+      return "internal_stream_buffer";
+    case MemoryCategory::kZslBuffer:
+      return "zsl_buffer";
+    case MemoryCategory::kStreamBufferCache:
+      return "stream_buffer_cache";
+    case MemoryCategory::kMetadata:
+      return "metadata";
+    case MemoryCategory::kJpegStaging:
+      return "jpeg_staging";
+    default:
+      return "unknown";
+  }
+}
+
+uint32_t MemoryTracker::GetCurrentSession() {
+  return current_session;
+}
+
+std::shared_ptr<MemoryTracker::SessionCounters>
+MemoryTracker::GetCurrentSessionCounters() {
+  return current_session_counters;
+}
+
+uint32_t MemoryTracker::AddSession(const std::string& name) {
+  std::lock_guard<std::mutex> lock(lock_);
+  uint32_t session = next_session_++;
+  Session& new_session = sessions_[session];
+  new_session.name = name;
+  new_session.counters = std::make_shared<SessionCounters>();
+  return session;
+}
+
+void MemoryTracker::EndSession(uint32_t session) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = sessions_.find(session);
+  if (it == sessions_.end() || it->second.ended) {
+    return;
+  }
+
+  it->second.ended = true;
+  ended_sessions_.push_back(session);
+  if (ended_sessions_.size() > kMaxEndedSessions) {
+    sessions_.erase(ended_sessions_.front());
+    ended_sessions_.pop_front();
+  }
+}
+
+void MemoryTracker::Update(MemoryCategory category, uint32_t session,
+                           int64_t bytes) {
+  Update(category,
+         session == kNoSession ? nullptr : GetSessionCounters(session), bytes);
+}
+
+void MemoryTracker::Update(
+    MemoryCategory category,
+    const std::shared_ptr<SessionCounters>& session_counters, int64_t bytes) {
+  uint32_t index = static_cast<uint32_t>(category);
+  if (index >= kNumCategories || bytes == 0) {
+    return;
+  }
+
+  AddBytes(&current_bytes_[index], &peak_bytes_[index], bytes);
+  if (session_counters != nullptr) {
+    AddBytes(&session_counters->current_bytes[index],
+             &session_counters->peak_bytes[index], bytes);
+  }
+}
+
+std::shared_ptr<MemoryTracker::SessionCounters>
+MemoryTracker::GetSessionCounters(uint32_t session) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = sessions_.find(session);
+  if (it == sessions_.end()) {
+    return nullptr;
+  }
+
+  return it->second.counters;
+}
+
+MemoryUsage MemoryTracker::GetUsage(MemoryCategory category) {
+  uint32_t index = static_cast<uint32_t>(category);
+  if (index >= kNumCategories) {
+    return {};
+  }
+
+  return {.current_bytes = current_bytes_[index].load(),
+          .peak_bytes = peak_bytes_[index].load()};
+}
+
+status_t MemoryTracker::GetSessionUsage(uint32_t session,
+                                        MemoryCategory category,
+                                        MemoryUsage* usage) {
+  uint32_t index = static_cast<uint32_t>(category);
+  if (usage == nullptr || index >= kNumCategories) {
+    return BAD_VALUE;
+  }
+
+  std::shared_ptr<SessionCounters> counters = GetSessionCounters(session);
+  if (counters == nullptr) {
+    return NAME_NOT_FOUND;
+  }
+
+  *usage = {.current_bytes = counters->current_bytes[index].load(),
+            .peak_bytes = counters->peak_bytes[index].load()};
+  return OK;
+}
+
+void MemoryTracker::Dump(int fd) {
+  dprintf(fd, "Memory usage (current / peak KiB):\n");
+  for (uint32_t i = 0; i < kNumCategories; i++) {
+    MemoryUsage usage = GetUsage(static_cast<MemoryCategory>(i));
+    dprintf(fd, "  %s: %" PRId64 " / %" PRId64 "\n",
+            GetCategoryName(static_cast<MemoryCategory>(i)),
+            ToKiB(usage.current_bytes), ToKiB(usage.peak_bytes));
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  for (const auto& [id, session] : sessions_) {
+    dprintf(fd, "  Session %u (%s%s):\n", id, session.name.c_str(),
+            session.ended ? ", ended" : "");
+    for (uint32_t i = 0; i < kNumCategories; i++) {
+      int64_t peak_bytes = session.counters->peak_bytes[i].load();
+      if (peak_bytes == 0) {
+        continue;
+      }
+      dprintf(fd, "    %s: %" PRId64 " / %" PRId64 "\n",
+              GetCategoryName(static_cast<MemoryCategory>(i)),
+              ToKiB(session.counters->current_bytes[i].load()),
+              ToKiB(peak_bytes));
+    }
+  }
+}
+
+ScopedMemorySession::ScopedMemorySession(uint32_t session)
+    : previous_session_(current_session),
+      previous_session_counters_(std::move(current_session_counters)) {
+  current_session = session;
+  if (session != MemoryTracker::kNoSession) {
+    current_session_counters =
+        MemoryTracker::GetInstance().GetSessionCounters(session);
+  }
+}
+
+ScopedMemorySession::~ScopedMemorySession() {
+  current_session = previous_session_;
+  current_session_counters = std::move(previous_session_counters_);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_MEMORY_TRACKER_H_
+#define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_MEMORY_TRACKER_H_
+
+#include <utils/Errors.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace android {
+namespace google_camera_hal {
+
+// Categories of the memory held by the HAL, tagged where it is allocated.
+enum class MemoryCategory : uint32_t {
+  // Buffers of internal streams, allocated by InternalStreamManager.
+  kInternalStreamBuffer = 0,
+  // Buffers of internal streams kept as ZSL history.
+  kZslBuffer,
+  // Framework buffers cached by StreamBufferCacheManager, and its placeholder
+  // buffers.
+  kStreamBufferCache,
+  // Camera metadata buffers of HalCameraMetadata.
+  kMetadata,
+  // Frames staged for JPEG compression.
+  kJpegStaging,
+  kNumCategories,
+};
+
+struct MemoryUsage {
+  int64_t current_bytes = 0;
+  int64_t peak_bytes = 0;
+};
+
+// MemoryTracker accounts the memory the HAL holds per category, for the whole
+// process and per session. Allocations are attributed to the session the
+// allocating component belongs to, which it takes from the calling thread
+// when it is created, see ScopedMemorySession. Allocations outside of a
+// session, e.g. metadata created by the HWL, count for the process only.
+//
+// Usage is updated with atomics. The lock only guards adding, ending and
+// looking up sessions, so components that keep the counters of their session
+// account allocations without taking it.
+// Sessions that ended stay in the dump until kMaxEndedSessions newer ones
+// ended, so memory a session still holds after it ended shows up as a leak.
+//
+// Thread safe.
+class MemoryTracker {
+ public:
+  // Session of the allocations that aren't attributed to a session.
+  static constexpr uint32_t kNoSession = 0;
+
+  // Current and peak bytes of a session, indexed by category.
+  struct SessionCounters {
+    std::array<std::atomic<int64_t>,
+               static_cast<uint32_t>(MemoryCategory::kNumCategories)>
+        current_bytes = {};
+    std::array<std::atomic<int64_t>,
+               static_cast<uint32_t>(MemoryCategory::kNumCategories)>
+        peak_bytes = {};
+  };
+
+  static MemoryTracker& GetInstance();
+
+  static const char* GetCategoryName(MemoryCategory category);
+
+  // Session the calling thread allocates for, kNoSession by default.
+  static uint32_t GetCurrentSession();
+
+  // Counters of the session the calling thread allocates for, nullptr if it
+  // is kNoSession or unknown.
+  static std::shared_ptr<SessionCounters> GetCurrentSessionCounters();
+
+  // Add a session, name is used in the dump. Returns the session ID.
+  uint32_t AddSession(const std::string& name);
+
+  // End a session. Allocations freed afterwards still count for it.
+  void EndSession(uint32_t session);
+
+  // Record bytes allocated, or freed if negative, in category for session.
+  void Update(MemoryCategory category, uint32_t session, int64_t bytes);
+
+  // Same as above without looking up the session. session_counters can be
+  // nullptr and stay valid after the session is evicted.
+  void Update(MemoryCategory category,
+              const std::shared_ptr<SessionCounters>& session_counters,
+              int64_t bytes);
+
+  // Counters of a session, nullptr if the session is unknown or ended too
+  // long ago.
+  std::shared_ptr<SessionCounters> GetSessionCounters(uint32_t session);
+
+  // Usage of the whole process.
+  MemoryUsage GetUsage(MemoryCategory category);
+
+  // Usage of a session. Returns NAME_NOT_FOUND if the session is unknown or
+  // ended too long ago.
+  status_t GetSessionUsage(uint32_t session, MemoryCategory category,
+                           MemoryUsage* usage);
+
+  // Dump the usage of the process and the sessions in fd.
+  void Dump(int fd);
+
+  // Disallow copy and assignment operators
+  MemoryTracker(MemoryTracker const&) = delete;
+  MemoryTracker& operator=(MemoryTracker const&) = delete;
+
+ private:
+  static constexpr uint32_t kNumCategories =
+      static_cast<uint32_t>(MemoryCategory::kNumCategories);
+  static constexpr size_t kMaxEndedSessions = 8;
+
+  struct Session {
+    std::string name;
+    bool ended = false;
+    std::shared_ptr<SessionCounters> counters;
+  };
+
+  MemoryTracker() = default;
+
+  // Current and peak bytes of the process, indexed by category.
+  std::array<std::atomic<int64_t>, kNumCategories> current_bytes_ = {};
+  std::array<std::atomic<int64_t>, kNumCategories> peak_bytes_ = {};
+
+  std::mutex lock_;
+  // Protected by lock_.
+  uint32_t next_session_ = kNoSession + 1;
+  // Maps from session ID to session. Protected by lock_.
+  std::map<uint32_t, Session> sessions_;
+  // Ended sessions, oldest first. Protected by lock_.
+  std::deque<uint32_t> ended_sessions_;
+};
+
+// Attributes the allocations of the components created by the calling thread
+// to session, for the scope of the object.
+class ScopedMemorySession {
+ public:
+  explicit ScopedMemorySession(uint32_t session);
+  ~ScopedMemorySession();
+
+  ScopedMemorySession(ScopedMemorySession const&) = delete;
+  ScopedMemorySession& operator=(ScopedMemorySession const&) = delete;
+
+ private:
+  uint32_t previous_session_ = MemoryTracker::kNoSession;
+  std::shared_ptr<MemoryTracker::SessionCounters> previous_session_counters_;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_UTILS_MEMORY_TRACKER_H_
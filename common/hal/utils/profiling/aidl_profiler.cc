@@ -21,12 +21,15 @@
 #include <log/log.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cinttypes>
 #include <cstdint>
 #include <memory>
 #include <mutex>
 #include <utility>
 #include <vector>
 
+#include "frame_rate_counter.h"
 #include "profiler.h"
 #include "profiler_util.h"
 #include "tracked_profiler.h"
@@ -47,6 +50,9 @@ constexpr char kPropKeyProfileReprocess[] =
 
 constexpr char kReprocess[] = "Reprocess Frame ";
 
+// Interval of the FPS logs when kPrintFpsPerIntervalBit is set.
+constexpr int64_t kFpsPrintIntervalNs = 1000000000LL;
+
 class AidlProfilerImpl : public AidlProfiler {
  public:
   AidlProfilerImpl(uint32_t camera_id, int32_t latency_flag, int32_t fps_flag,
@@ -55,7 +61,15 @@ class AidlProfilerImpl : public AidlProfiler {
         camera_id_(camera_id),
         latency_flag_(latency_flag),
         fps_flag_(fps_flag),
-        reprocess_latency_flag_(reprocess_latency_flag) {
+        reprocess_latency_flag_(reprocess_latency_flag),
+        frame_rate_counter_(
+            (fps_flag & Profiler::SetPropFlag::kPrintFpsPerIntervalBit) != 0
+                ? kFpsPrintIntervalNs
+                : 0) {
+  }
+
+  ~AidlProfilerImpl() {
+    PrintFrameRateStats();
   }
 
   std::unique_ptr<AidlScopedProfiler> MakeScopedProfiler(
@@ -69,45 +83,29 @@ class AidlProfilerImpl : public AidlProfiler {
      * to see if the event can be used as a continuation of a previous operation
      */
     std::lock_guard lock(api_mutex_);
+    if (type == EventType::kConfigureStream || type == EventType::kClose) {
+      // Stream ids are not reused across configurations, so release the
+      // counter slots of the previous streams.
+      PrintFrameRateStats();
+      frame_rate_counter_.Reset();
+    }
     if (type == EventType::kConfigureStream && fps_profiler_ == nullptr) {
+      bool profile_every_frame = true;
       if (SetFpsProfiler(std::move(custom_fps_profiler)) == false) {
         fps_profiler_ = CreateFpsProfiler();
+        // FPS logs are printed by frame_rate_counter_. The default profiler
+        // only needs every frame to print or dump the result on close.
+        profile_every_frame =
+            (fps_flag_ & (Profiler::SetPropFlag::kPrintBit |
+                          Profiler::SetPropFlag::kDumpBit)) != 0;
       }
-    }
-
-    latency_profilers_.erase(
-        std::remove_if(latency_profilers_.begin(), latency_profilers_.end(),
-                       [type](const auto& profiler) {
-                         return profiler->ShouldDelete(type);
-                       }),
-        latency_profilers_.end());
-
-    for (auto rprofiler = latency_profilers_.rbegin();
-         rprofiler != latency_profilers_.rend(); ++rprofiler) {
-      if (std::unique_ptr<AidlScopedProfiler> ret =
-              (*rprofiler)->AcceptNextState(type);
-          ret != nullptr) {
-        return ret;
+      if (profile_every_frame) {
+        frame_rate_profiler_.store(fps_profiler_.get(),
+                                   std::memory_order_release);
       }
     }
 
-    if (int size = latency_profilers_.size(); size > 2) {
-      ALOGW("%s: Too many overlapping operations (have: %d). Will not profile.",
-            __FUNCTION__, size);
-      return nullptr;
-    }
-
-    if (type == EventType::kOpen || type == EventType::kFlush) {
-      if (SetOrCreateTrackedProfiler(std::move(custom_latency_profiler),
-                                     camera_id_string_)) {
-        return latency_profilers_.back()->AcceptNextState(type);
-      } else {
-        return nullptr;
-      }
-    }
-    ALOGW("%s: Could not find an operation for incoming event: %s",
-          __FUNCTION__, EventTypeToString(type).c_str());
-    return nullptr;
+    return MakeScopedProfilerLocked(type, std::move(custom_latency_profiler));
   }
 
   void FirstFrameStart() override {
@@ -162,14 +160,75 @@ class AidlProfilerImpl : public AidlProfiler {
     }
   }
 
-  void ProfileFrameRate(const std::string& name) override {
-    std::lock_guard lock(api_mutex_);
-    if (fps_profiler_ != nullptr) {
-      fps_profiler_->ProfileFrameRate(name);
+  void ProfileFrameRate(int32_t stream_id) override {
+    if (fps_flag_ != Profiler::SetPropFlag::kDisable) {
+      frame_rate_counter_.Count(stream_id, FrameRateCounter::GetBootTimeNs());
+    }
+    // fps_profiler_ is never released once set, so it can be used without
+    // api_mutex_.
+    Profiler* profiler = frame_rate_profiler_.load(std::memory_order_acquire);
+    if (profiler != nullptr) {
+      profiler->ProfileFrameRate("Stream " + std::to_string(stream_id));
     }
   }
 
  private:
+  // Log the average FPS of the streams counted by frame_rate_counter_.
+  void PrintFrameRateStats() {
+    if ((fps_flag_ & Profiler::SetPropFlag::kPrintFpsPerIntervalBit) == 0) {
+      return;
+    }
+    for (auto& stats : frame_rate_counter_.GetStats()) {
+      ALOGI("%s: %s stream %d: %" PRIu64 " frames, avg FPS %3.2f",
+            __FUNCTION__, camera_id_string_.c_str(), stats.stream_id,
+            stats.frame_count, stats.average_fps);
+    }
+  }
+
+  // Find or create the tracked profiler accepting type. Must be called with
+  // api_mutex_ locked.
+  std::unique_ptr<AidlScopedProfiler> MakeScopedProfilerLocked(
+      EventType type, std::unique_ptr<Profiler> custom_latency_profiler) {
+    latency_profilers_.erase(
+        std::remove_if(latency_profilers_.begin(), latency_profilers_.end(),
+                       [type](const auto& profiler) {
+                         return profiler->ShouldDelete(type);
+                       }),
+        latency_profilers_.end());
+
+    for (auto rprofiler = latency_profilers_.rbegin();
+         rprofiler != latency_profilers_.rend(); ++rprofiler) {
+      // States only change under api_mutex_, so skip profilers that cannot
+      // accept type without taking their locks.
+      if (!TrackedProfiler::AcceptsEvent((*rprofiler)->GetState(), type)) {
+        continue;
+      }
+      if (std::unique_ptr<AidlScopedProfiler> ret =
+              (*rprofiler)->AcceptNextState(type);
+          ret != nullptr) {
+        return ret;
+      }
+    }
+
+    if (int size = latency_profilers_.size(); size > 2) {
+      ALOGW("%s: Too many overlapping operations (have: %d). Will not profile.",
+            __FUNCTION__, size);
+      return nullptr;
+    }
+
+    if (type == EventType::kOpen || type == EventType::kFlush) {
+      if (SetOrCreateTrackedProfiler(std::move(custom_latency_profiler),
+                                     camera_id_string_)) {
+        return latency_profilers_.back()->AcceptNextState(type);
+      } else {
+        return nullptr;
+      }
+    }
+    ALOGW("%s: Could not find an operation for incoming event: %s",
+          __FUNCTION__, EventTypeToString(type).c_str());
+    return nullptr;
+  }
+
   std::shared_ptr<Profiler> CreateLatencyProfiler() {
     if (latency_flag_ == Profiler::SetPropFlag::kDisable) {
       return nullptr;
@@ -208,7 +267,8 @@ class AidlProfilerImpl : public AidlProfiler {
     if (fps_flag_ == Profiler::SetPropFlag::kDisable) {
       return nullptr;
     }
-    std::shared_ptr<Profiler> profiler = Profiler::Create(fps_flag_);
+    std::shared_ptr<Profiler> profiler = Profiler::Create(
+        fps_flag_ & ~Profiler::SetPropFlag::kPrintFpsPerIntervalBit);
     if (profiler == nullptr) {
       ALOGW("%s: Failed to create profiler", __FUNCTION__);
       return nullptr;
@@ -275,6 +335,8 @@ class AidlProfilerImpl : public AidlProfiler {
   std::mutex api_mutex_;
   std::vector<std::shared_ptr<TrackedProfiler>> latency_profilers_;
   std::shared_ptr<Profiler> fps_profiler_;
+  // fps_profiler_ if it needs every frame, published for ProfileFrameRate().
+  std::atomic<Profiler*> frame_rate_profiler_ = nullptr;
   std::shared_ptr<Profiler> reprocessing_profiler_;
 
   const std::string camera_id_string_;
@@ -284,6 +346,9 @@ class AidlProfilerImpl : public AidlProfiler {
   const int32_t reprocess_latency_flag_;
 
   int32_t open_reprocessing_frames_count_;
+
+  // Counts frames per stream without taking api_mutex_.
+  FrameRateCounter frame_rate_counter_;
 };
 
 class AidlProfilerMock : public AidlProfiler {
@@ -295,7 +360,7 @@ class AidlProfilerMock : public AidlProfiler {
 
   void FirstFrameStart() override{};
   void FirstFrameEnd() override{};
-  void ProfileFrameRate(const std::string&) override{};
+  void ProfileFrameRate(int32_t) override{};
   void ReprocessingRequestStart(std::unique_ptr<Profiler>, int32_t) override{};
   void ReprocessingResultEnd(int32_t) override{};
 
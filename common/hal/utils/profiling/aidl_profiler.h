@@ -71,8 +71,9 @@ class AidlProfiler {
   // Delete reprocessing profiler if all open requests have ended.
   virtual void ReprocessingResultEnd(int32_t id) = 0;
 
-  // Call to profile frame rate for each stream.
-  virtual void ProfileFrameRate(const std::string& name) = 0;
+  // Call to profile frame rate for each stream. Called for every output
+  // buffer, so implementations must not take locks.
+  virtual void ProfileFrameRate(int32_t stream_id) = 0;
 
   virtual uint32_t GetCameraId() const = 0;
   virtual int32_t GetLatencyFlag() const = 0;
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "GCH_FrameRateCounter"
+#include "frame_rate_counter.h"
+
+#include <log/log.h>
+#include <time.h>
+
+namespace android {
+namespace google_camera_hal {
+namespace {
+constexpr float kNsPerSec = 1000000000.0f;
+}  // anonymous namespace
+
+FrameRateCounter::FrameRateCounter(int64_t print_interval_ns)
+    : print_interval_ns_(print_interval_ns) {
+}
+
+int64_t FrameRateCounter::GetBootTimeNs() {
+  struct timespec now;
+  clock_gettime(CLOCK_BOOTTIME, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+FrameRateCounter::Slot* FrameRateCounter::GetSlot(int32_t stream_id) {
+  for (auto& slot : slots_) {
+    int32_t slot_stream_id = slot.stream_id.load(std::memory_order_acquire);
+    if (slot_stream_id == stream_id) {
+      return &slot;
+    }
+    if (slot_stream_id == kInvalidStreamId) {
+      // Slots are claimed in order, so stream_id has no slot yet.
+      if (slot.stream_id.compare_exchange_strong(slot_stream_id, stream_id,
+                                                 std::memory_order_acq_rel) ||
+          slot_stream_id == stream_id) {
+        return &slot;
+      }
+    }
+  }
+  return nullptr;
+}
+
+bool FrameRateCounter::Count(int32_t stream_id, int64_t timestamp_ns) {
+  Slot* slot = GetSlot(stream_id);
+  if (slot == nullptr) {
+    return false;
+  }
+
+  int64_t first_frame_ns = 0;
+  if (slot->first_frame_ns.compare_exchange_strong(
+          first_frame_ns, timestamp_ns, std::memory_order_acq_rel)) {
+    slot->interval_start_ns.store(timestamp_ns, std::memory_order_release);
+    return true;
+  }
+
+  slot->frame_count.fetch_add(1, std::memory_order_relaxed);
+  // Frames of a stream may be counted out of order by different threads.
+  int64_t last_frame_ns = slot->last_frame_ns.load(std::memory_order_relaxed);
+  while (last_frame_ns < timestamp_ns &&
+         !slot->last_frame_ns.compare_exchange_weak(
+             last_frame_ns, timestamp_ns, std::memory_order_relaxed)) {
+  }
+
+  if (print_interval_ns_ > 0) {
+    MaybePrintFrameRate(slot, timestamp_ns);
+  }
+  return true;
+}
+
+void FrameRateCounter::MaybePrintFrameRate(Slot* slot, int64_t timestamp_ns) {
+  int64_t interval_start_ns =
+      slot->interval_start_ns.load(std::memory_order_acquire);
+  int64_t elapsed_ns = timestamp_ns - interval_start_ns;
+  if (interval_start_ns == 0 || elapsed_ns <= print_interval_ns_) {
+    return;
+  }
+  // Only the caller that moves the interval forward prints.
+  if (!slot->interval_start_ns.compare_exchange_strong(
+          interval_start_ns, timestamp_ns, std::memory_order_acq_rel)) {
+    return;
+  }
+
+  uint64_t frame_count = slot->frame_count.load(std::memory_order_relaxed);
+  uint64_t interval_frames =
+      frame_count - slot->interval_start_count.exchange(
+                        frame_count, std::memory_order_relaxed);
+  int64_t duration_ns =
+      timestamp_ns - slot->first_frame_ns.load(std::memory_order_relaxed);
+  float fps = interval_frames * kNsPerSec / static_cast<float>(elapsed_ns);
+  float avg_fps = 0.0f;
+  if (duration_ns > 0) {
+    avg_fps = frame_count * kNsPerSec / static_cast<float>(duration_ns);
+  }
+  ALOGI("Stream %d: current FPS %3.2f, avg %3.2f",
+        slot->stream_id.load(std::memory_order_relaxed), fps, avg_fps);
+}
+
+std::vector<FrameRateCounter::StreamStats> FrameRateCounter::GetStats() const {
+  std::vector<StreamStats> stats;
+  for (auto& slot : slots_) {
+    int32_t stream_id = slot.stream_id.load(std::memory_order_acquire);
+    if (stream_id == kInvalidStreamId) {
+      break;
+    }
+
+    StreamStats stream_stats = {
+        .stream_id = stream_id,
+        .frame_count = slot.frame_count.load(std::memory_order_relaxed),
+        .first_frame_ns = slot.first_frame_ns.load(std::memory_order_relaxed),
+        .last_frame_ns = slot.last_frame_ns.load(std::memory_order_relaxed),
+    };
+    int64_t duration_ns =
+        stream_stats.last_frame_ns - stream_stats.first_frame_ns;
+    if (stream_stats.frame_count > 0 && duration_ns > 0) {
+      stream_stats.average_fps = stream_stats.frame_count * kNsPerSec /
+                                 static_cast<float>(duration_ns);
+    }
+    stats.push_back(stream_stats);
+  }
+  return stats;
+}
+
+void FrameRateCounter::Reset() {
+  // Release slots from the back so GetSlot(), which stops at the first free
+  // slot, never skips a slot that is still claimed.
+  for (auto slot = slots_.rbegin(); slot != slots_.rend(); slot++) {
+    slot->frame_count.store(0, std::memory_order_relaxed);
+    slot->first_frame_ns.store(0, std::memory_order_relaxed);
+    slot->last_frame_ns.store(0, std::memory_order_relaxed);
+    slot->interval_start_ns.store(0, std::memory_order_relaxed);
+    slot->interval_start_count.store(0, std::memory_order_relaxed);
+    slot->stream_id.store(kInvalidStreamId, std::memory_order_release);
+  }
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
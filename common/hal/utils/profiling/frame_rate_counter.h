@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_FRAME_RATE_COUNTER_H
+#define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_FRAME_RATE_COUNTER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+// FrameRateCounter counts frames per stream with atomics only, so it can be
+// called for every output buffer without taking a lock. Each stream claims one
+// of kMaxStreams slots on its first frame. When a print interval is set, the
+// first caller that observes the interval has elapsed for a stream logs the
+// current and average FPS of that stream. Reset() releases all slots, e.g.
+// when streams are reconfigured and stream ids change.
+class FrameRateCounter {
+ public:
+  static constexpr size_t kMaxStreams = 16;
+
+  struct StreamStats {
+    int32_t stream_id = -1;
+    // Frames counted after the first frame.
+    uint64_t frame_count = 0;
+    int64_t first_frame_ns = 0;
+    int64_t last_frame_ns = 0;
+    float average_fps = 0.0f;
+  };
+
+  // print_interval_ns of 0 disables periodic FPS logs.
+  explicit FrameRateCounter(int64_t print_interval_ns);
+
+  // Count a frame of stream_id at timestamp_ns. Returns false if the frame
+  // was not counted because all slots are taken by other streams.
+  bool Count(int32_t stream_id, int64_t timestamp_ns);
+
+  // Get the statistics of all streams counted so far.
+  std::vector<StreamStats> GetStats() const;
+
+  // Release all slots and clear their statistics. Frames counted
+  // concurrently with Reset() may be lost or attributed to the new period.
+  void Reset();
+
+  // Return the CLOCK_BOOTTIME timestamp in nanoseconds.
+  static int64_t GetBootTimeNs();
+
+ private:
+  static constexpr int32_t kInvalidStreamId = -1;
+
+  struct Slot {
+    std::atomic<int32_t> stream_id = kInvalidStreamId;
+    // Number of frames after the first frame.
+    std::atomic<uint64_t> frame_count = 0;
+    std::atomic<int64_t> first_frame_ns = 0;
+    std::atomic<int64_t> last_frame_ns = 0;
+    // Start of the current print interval and frame_count at that time.
+    std::atomic<int64_t> interval_start_ns = 0;
+    std::atomic<uint64_t> interval_start_count = 0;
+  };
+
+  // Return the slot of stream_id, claiming a free slot if stream_id has none.
+  // Returns nullptr if all slots are taken.
+  Slot* GetSlot(int32_t stream_id);
+
+  // Log the FPS of slot if the print interval has elapsed.
+  void MaybePrintFrameRate(Slot* slot, int64_t timestamp_ns);
+
+  const int64_t print_interval_ns_;
+  std::array<Slot, kMaxStreams> slots_;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_UTILS_FRAME_RATE_COUNTER_H
@@ -17,6 +17,7 @@
 #ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_PROFILER_UTIL_H
 #define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_PROFILER_UTIL_H
 
+#include <cstddef>
 #include <string>
 
 namespace android {
@@ -37,6 +38,9 @@ enum class EventType {
   kFirstFrameEnd,
 };
 
+constexpr size_t kNumEventTypes =
+    static_cast<size_t>(EventType::kFirstFrameEnd) + 1;
+
 inline std::string EventTypeToString(EventType type) {
   switch (type) {
     case (EventType::kNone):
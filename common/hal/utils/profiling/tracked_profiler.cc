@@ -33,6 +33,28 @@ namespace google_camera_hal {
 
 using ::google::camera_common::Profiler;
 
+namespace {
+
+// kAcceptedEvents[state][incoming] is true if a profiler in state moves to
+// incoming in AcceptNextState(). Indexed by EventType.
+constexpr bool kAcceptedEvents[kNumEventTypes][kNumEventTypes] = {
+    // None, Open, ConfigureStream, Flush, Close, FirstFrameStart, FirstFrameEnd
+    /*kNone=*/{false, true, false, true, false, false, false},
+    /*kOpen=*/{false, false, true, false, false, false, false},
+    /*kConfigureStream=*/{false, false, true, false, false, true, false},
+    /*kFlush=*/{false, false, true, true, true, false, false},
+    /*kClose=*/{false, false, false, false, false, false, false},
+    /*kFirstFrameStart=*/{false, false, false, false, false, false, true},
+    /*kFirstFrameEnd=*/{false, false, false, false, false, false, false},
+};
+
+}  // anonymous namespace
+
+bool TrackedProfiler::AcceptsEvent(EventType state, EventType incoming) {
+  return kAcceptedEvents[static_cast<size_t>(state)]
+                        [static_cast<size_t>(incoming)];
+}
+
 void TrackedProfiler::SetUseCase(std::string name) {
   profiler_->SetUseCase(name);
 }
@@ -55,49 +77,24 @@ void TrackedProfiler::UpdateStateLocked(EventType incoming) {
 std::unique_ptr<AidlScopedProfiler> TrackedProfiler::AcceptNextState(
     EventType incoming) {
   std::lock_guard<std::mutex> lock(tracked_api_mutex_);
-  int32_t id = 0;
-  switch (state_) {
-    case (EventType::kNone):
-      if (incoming == EventType::kOpen) {
-        SetUseCase(camera_id_string_ + "-Open");
-        break;
-      } else if (incoming == EventType::kFlush) {
-        break;
-      }
-      return nullptr;
-    case (EventType::kOpen):
-      if (incoming == EventType::kConfigureStream) {
-        break;
-      }
-      return nullptr;
-    case (EventType::kConfigureStream):
-      if (incoming == EventType::kConfigureStream ||
-          incoming == EventType::kFirstFrameStart) {
-        break;
-      }
-      return nullptr;
-    case (EventType::kFirstFrameStart):
-      if (incoming == EventType::kFirstFrameEnd) {
-        break;
-      }
-      return nullptr;
-    case (EventType::kFlush):
-      if (incoming == EventType::kFlush || incoming == EventType::kClose) {
-        SetUseCase(camera_id_string_ + "-Close");
-        break;
-      }
-      if (incoming == EventType::kConfigureStream) {
-        SetUseCase(camera_id_string_ + "-Reconfiguration");
-        break;
-      }
-      return nullptr;
-    case (EventType::kClose):
-      return nullptr;
-    case (EventType::kFirstFrameEnd):
-      ALOGE("%s: Warning: Operation %s should have already been deleted.",
-            __FUNCTION__, EventTypeToString(state_).c_str());
-      return nullptr;
+  if (state_ == EventType::kFirstFrameEnd) {
+    ALOGE("%s: Warning: Operation %s should have already been deleted.",
+          __FUNCTION__, EventTypeToString(state_).c_str());
+    return nullptr;
+  }
+  if (!AcceptsEvent(state_, incoming)) {
+    return nullptr;
   }
+
+  if (state_ == EventType::kNone && incoming == EventType::kOpen) {
+    SetUseCase(camera_id_string_ + "-Open");
+  } else if (state_ == EventType::kFlush) {
+    SetUseCase(camera_id_string_ + (incoming == EventType::kConfigureStream
+                                        ? "-Reconfiguration"
+                                        : "-Close"));
+  }
+
+  int32_t id = 0;
   UpdateStateLocked(incoming);
   IdleEndLocked();
   if (incoming == EventType::kConfigureStream) {
@@ -41,6 +41,9 @@ class TrackedProfiler {
         profiler_(profiler),
         camera_id_string_(camera_id_string){};
 
+  // Return true if a profiler in state accepts incoming in AcceptNextState().
+  static bool AcceptsEvent(EventType state, EventType incoming);
+
   void SetUseCase(std::string name);
   bool ShouldDelete(EventType incoming);
   void UpdateStateLocked(EventType incoming);
@@ -0,0 +1,459 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "GCH_RequestWatchdog"
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+#include "request_watchdog.h"
+
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <ctime>
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+static constexpr int64_t kNsPerSec = 1000000000;
+static constexpr int64_t kNsPerMs = 1000000;
+
+std::unique_ptr<RequestWatchdog> RequestWatchdog::Create(
+    const Config& config, StallCallback stall_callback) {
+  ATRACE_CALL();
+  if (config.partial_result_count == 0 || config.shutter_slo_frames <= 0 ||
+      config.result_slo_frames <= 0 || config.stall_timeout_frames <= 0 ||
+      config.default_frame_duration_ns <= 0 || config.window_size == 0) {
+    ALOGE("%s: Invalid config.", __FUNCTION__);
+    return nullptr;
+  }
+
+  auto watchdog = std::unique_ptr<RequestWatchdog>(
+      new RequestWatchdog(config, std::move(stall_callback)));
+  if (watchdog == nullptr) {
+    ALOGE("%s: Creating RequestWatchdog failed.", __FUNCTION__);
+    return nullptr;
+  }
+
+  return watchdog;
+}
+
+RequestWatchdog::RequestWatchdog(const Config& config,
+                                 StallCallback stall_callback)
+    : config_(config), stall_callback_(std::move(stall_callback)) {
+  last_frame_duration_ns_ = config_.default_frame_duration_ns;
+  if (config_.check_interval_ms > 0) {
+    checker_thread_ = std::thread([this] { CheckerThreadLoop(); });
+  }
+}
+
+RequestWatchdog::~RequestWatchdog() {
+  {
+    std::lock_guard<std::mutex> lock(checker_lock_);
+    checker_exiting_ = true;
+  }
+  checker_condition_.notify_one();
+  if (checker_thread_.joinable()) {
+    checker_thread_.join();
+  }
+}
+
+int64_t RequestWatchdog::Now() const {
+  if (config_.clock != nullptr) {
+    return config_.clock();
+  }
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * kNsPerSec + ts.tv_nsec;
+}
+
+int64_t RequestWatchdog::GetFrameDuration(const HalCameraMetadata* settings,
+                                          int64_t previous_frame_duration_ns) {
+  if (settings == nullptr) {
+    return previous_frame_duration_ns;
+  }
+
+  // The manual frame duration applies only with AE off.
+  camera_metadata_ro_entry entry = {};
+  bool manual_exposure =
+      (settings->Get(ANDROID_CONTROL_MODE, &entry) == OK &&
+       entry.count == 1 && entry.data.u8[0] == ANDROID_CONTROL_MODE_OFF) ||
+      (settings->Get(ANDROID_CONTROL_AE_MODE, &entry) == OK &&
+       entry.count == 1 && entry.data.u8[0] == ANDROID_CONTROL_AE_MODE_OFF);
+  if (manual_exposure &&
+      settings->Get(ANDROID_SENSOR_FRAME_DURATION, &entry) == OK &&
+      entry.count == 1 && entry.data.i64[0] > 0) {
+    return entry.data.i64[0];
+  }
+
+  // Otherwise AE may run as slow as the lower bound of the target range.
+  if (settings->Get(ANDROID_CONTROL_AE_TARGET_FPS_RANGE, &entry) == OK &&
+      entry.count == 2 && entry.data.i32[0] > 0) {
+    return kNsPerSec / entry.data.i32[0];
+  }
+
+  return previous_frame_duration_ns;
+}
+
+void RequestWatchdog::OnRequestSubmitted(const CaptureRequest& request) {
+  std::lock_guard<std::mutex> lock(lock_);
+  last_frame_duration_ns_ =
+      GetFrameDuration(request.settings.get(), last_frame_duration_ns_);
+
+  PendingRequest& pending_request = pending_requests_[request.frame_number];
+  pending_request = PendingRequest();
+  pending_request.submit_time_ns = Now();
+  pending_request.frame_duration_ns = last_frame_duration_ns_;
+  for (auto& buffer : request.output_buffers) {
+    int32_t stream_id = GetTrackedStreamIdLocked(buffer.stream_id);
+    pending_request.pending_buffers[stream_id]++;
+    buffer_counters_[stream_id].counts.requested++;
+  }
+  requests_++;
+}
+
+void RequestWatchdog::OnRequestDropped(uint32_t frame_number) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto pending_request = pending_requests_.find(frame_number);
+  if (pending_request != pending_requests_.end()) {
+    DropPendingBuffersLocked(pending_request->second);
+    pending_requests_.erase(pending_request);
+  }
+}
+
+void RequestWatchdog::OnNotify(const NotifyMessage& message) {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (message.type == MessageType::kShutter) {
+    uint32_t frame_number = message.message.shutter.frame_number;
+    auto pending_request = pending_requests_.find(frame_number);
+    if (pending_request == pending_requests_.end() ||
+        !pending_request->second.shutter_pending) {
+      return;
+    }
+    AddSampleLocked(&shutter_tracker_, pending_request->second,
+                    config_.shutter_slo_frames);
+    pending_request->second.shutter_pending = false;
+    RemoveIfCompleteLocked(frame_number);
+    return;
+  }
+
+  const ErrorMessage& error = message.message.error;
+  switch (error.error_code) {
+    case ErrorCode::kErrorDevice:
+      for (auto& [frame_number, request] : pending_requests_) {
+        DropPendingBuffersLocked(request);
+      }
+      pending_requests_.clear();
+      break;
+    case ErrorCode::kErrorRequest: {
+      auto pending_request = pending_requests_.find(error.frame_number);
+      if (pending_request != pending_requests_.end()) {
+        DropPendingBuffersLocked(pending_request->second);
+        pending_requests_.erase(pending_request);
+      }
+      break;
+    }
+    case ErrorCode::kErrorResult: {
+      // No more result metadata, and the shutter may be dropped.
+      auto pending_request = pending_requests_.find(error.frame_number);
+      if (pending_request != pending_requests_.end()) {
+        pending_request->second.shutter_pending = false;
+        pending_request->second.metadata_pending = false;
+        RemoveIfCompleteLocked(error.frame_number);
+      }
+      break;
+    }
+    case ErrorCode::kErrorBuffer:
+      // The buffer is still returned in a result.
+      break;
+  }
+}
+
+void RequestWatchdog::OnResult(const CaptureResult& result) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto pending_request = pending_requests_.find(result.frame_number);
+  if (pending_request == pending_requests_.end()) {
+    return;
+  }
+
+  PendingRequest& request = pending_request->second;
+  if (result.result_metadata != nullptr && result.partial_result > 0 &&
+      request.metadata_pending) {
+    AddSampleLocked(&partial_result_tracker_, request,
+                    config_.result_slo_frames);
+    request.partial_results_received++;
+    if (result.partial_result >= config_.partial_result_count) {
+      request.metadata_pending = false;
+    }
+  }
+
+  for (auto& buffer : result.output_buffers) {
+    int32_t stream_id = GetTrackedStreamIdLocked(buffer.stream_id);
+    auto pending_buffers = request.pending_buffers.find(stream_id);
+    if (pending_buffers == request.pending_buffers.end()) {
+      continue;
+    }
+    AddSampleLocked(&buffer_trackers_[stream_id], request,
+                    config_.result_slo_frames);
+    AddBufferOutcomeLocked(stream_id,
+                           buffer.status == BufferStatus::kOk
+                               ? BufferOutcome::kDelivered
+                               : BufferOutcome::kError,
+                           /*count=*/1);
+    if (--pending_buffers->second == 0) {
+      request.pending_buffers.erase(pending_buffers);
+    }
+  }
+
+  RemoveIfCompleteLocked(result.frame_number);
+}
+
+void RequestWatchdog::Reset(
+    const std::unordered_map<int32_t, int32_t>& grouped_stream_id_map) {
+  std::lock_guard<std::mutex> lock(lock_);
+  for (auto& [frame_number, request] : pending_requests_) {
+    DropPendingBuffersLocked(request);
+  }
+  pending_requests_.clear();
+  grouped_stream_id_map_ = grouped_stream_id_map;
+  last_frame_duration_ns_ = config_.default_frame_duration_ns;
+}
+
+void RequestWatchdog::AddSampleLocked(LatencyTracker* tracker,
+                                      const PendingRequest& request,
+                                      float slo_frames) {
+  int64_t latency_ns = Now() - request.submit_time_ns;
+  bool violation =
+      latency_ns > static_cast<double>(slo_frames) * request.frame_duration_ns;
+  LatencyStats& stats = tracker->stats;
+  stats.count++;
+  stats.violations += violation;
+  stats.max_latency_ns = std::max(stats.max_latency_ns, latency_ns);
+
+  tracker->window.emplace_back(latency_ns, violation);
+  if (tracker->window.size() > config_.window_size) {
+    tracker->window.pop_front();
+  }
+}
+
+void RequestWatchdog::AddBufferOutcomeLocked(int32_t stream_id,
+                                             BufferOutcome outcome,
+                                             uint32_t count) {
+  BufferCounter& counter = buffer_counters_[stream_id];
+  switch (outcome) {
+    case BufferOutcome::kDelivered:
+      counter.counts.delivered += count;
+      break;
+    case BufferOutcome::kError:
+      counter.counts.errors += count;
+      break;
+    case BufferOutcome::kDropped:
+      counter.counts.dropped += count;
+      break;
+  }
+
+  counter.window.insert(counter.window.end(), count, outcome);
+  while (counter.window.size() > config_.window_size) {
+    counter.window.pop_front();
+  }
+}
+
+void RequestWatchdog::DropPendingBuffersLocked(const PendingRequest& request) {
+  for (auto& [stream_id, count] : request.pending_buffers) {
+    AddBufferOutcomeLocked(stream_id, BufferOutcome::kDropped, count);
+  }
+}
+
+void RequestWatchdog::RemoveIfCompleteLocked(uint32_t frame_number) {
+  auto pending_request = pending_requests_.find(frame_number);
+  if (pending_request == pending_requests_.end()) {
+    return;
+  }
+  const PendingRequest& request = pending_request->second;
+  if (!request.shutter_pending && !request.metadata_pending &&
+      request.pending_buffers.empty()) {
+    pending_requests_.erase(pending_request);
+  }
+}
+
+int32_t RequestWatchdog::GetTrackedStreamIdLocked(int32_t stream_id) {
+  auto group = grouped_stream_id_map_.find(stream_id);
+  return group == grouped_stream_id_map_.end() ? stream_id : group->second;
+}
+
+uint32_t RequestWatchdog::CheckStalls() {
+  std::vector<uint32_t> stalled_frame_numbers;
+  std::string dump;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    int64_t now = Now();
+    for (auto& [frame_number, request] : pending_requests_) {
+      int64_t timeout_ns = std::max(
+          static_cast<int64_t>(
+              static_cast<double>(config_.stall_timeout_frames) *
+              request.frame_duration_ns),
+          config_.min_stall_timeout_ns);
+      if (!request.stall_reported &&
+          now - request.submit_time_ns > timeout_ns) {
+        request.stall_reported = true;
+        stalled_frame_numbers.push_back(frame_number);
+      }
+    }
+    if (stalled_frame_numbers.empty()) {
+      return 0;
+    }
+    stalls_ += stalled_frame_numbers.size();
+    dump = DumpPendingRequestsLocked(now);
+  }
+
+  if (stall_callback_ != nullptr) {
+    for (uint32_t frame_number : stalled_frame_numbers) {
+      stall_callback_(frame_number, dump);
+    }
+  }
+  return stalled_frame_numbers.size();
+}
+
+RequestWatchdog::Stats RequestWatchdog::GetStats() {
+  auto get_latency_stats = [](const LatencyTracker& tracker) {
+    LatencyStats stats = tracker.stats;
+    stats.window_count = tracker.window.size();
+    for (auto& [latency_ns, violation] : tracker.window) {
+      stats.window_violations += violation;
+      stats.window_max_latency_ns =
+          std::max(stats.window_max_latency_ns, latency_ns);
+    }
+    return stats;
+  };
+
+  std::lock_guard<std::mutex> lock(lock_);
+  Stats stats;
+  stats.shutter = get_latency_stats(shutter_tracker_);
+  stats.partial_result = get_latency_stats(partial_result_tracker_);
+  stats.requests = requests_;
+  stats.stalls = stalls_;
+  stats.pending_requests = pending_requests_.size();
+  for (auto& [stream_id, tracker] : buffer_trackers_) {
+    stats.buffers[stream_id] = get_latency_stats(tracker);
+  }
+  for (auto& [stream_id, counter] : buffer_counters_) {
+    BufferCounts& counts = stats.buffer_counts[stream_id];
+    counts = counter.counts;
+    counts.window_count = counter.window.size();
+    for (auto outcome : counter.window) {
+      counts.window_errors += outcome == BufferOutcome::kError;
+      counts.window_dropped += outcome == BufferOutcome::kDropped;
+    }
+  }
+  return stats;
+}
+
+std::string RequestWatchdog::DumpStats(const std::string& indent) {
+  auto dump_latency_stats = [](const LatencyStats& stats) {
+    return std::to_string(stats.count) + " (" +
+           std::to_string(stats.violations) + " late, max " +
+           std::to_string(stats.max_latency_ns / kNsPerMs) + " ms), window " +
+           std::to_string(stats.window_count) + " (" +
+           std::to_string(stats.window_violations) + " late, max " +
+           std::to_string(stats.window_max_latency_ns / kNsPerMs) + " ms)";
+  };
+
+  Stats stats = GetStats();
+  std::string dump = indent + std::to_string(stats.requests) +
+                     " requests, " + std::to_string(stats.pending_requests) +
+                     " pending, " + std::to_string(stats.stalls) +
+                     " stalls\n";
+  dump += indent + "shutters: " + dump_latency_stats(stats.shutter) + "\n";
+  dump += indent + "partial results: " +
+          dump_latency_stats(stats.partial_result) + "\n";
+  for (auto& [stream_id, counts] : stats.buffer_counts) {
+    dump += indent + "stream " + std::to_string(stream_id) + ": " +
+            std::to_string(counts.requested) + " requested, " +
+            std::to_string(counts.delivered) + " delivered, " +
+            std::to_string(counts.errors) + " errors, " +
+            std::to_string(counts.dropped) + " dropped, window " +
+            std::to_string(counts.window_count) + " (" +
+            std::to_string(counts.window_errors) + " errors, " +
+            std::to_string(counts.window_dropped) + " dropped)\n";
+    auto latency = stats.buffers.find(stream_id);
+    if (latency != stats.buffers.end()) {
+      dump += indent + "  buffers: " + dump_latency_stats(latency->second) +
+              "\n";
+    }
+  }
+  return dump;
+}
+
+std::string RequestWatchdog::DumpPendingRequests() {
+  std::lock_guard<std::mutex> lock(lock_);
+  return DumpPendingRequestsLocked(Now());
+}
+
+std::string RequestWatchdog::DumpPendingRequestsLocked(int64_t now) {
+  std::string dump = std::to_string(pending_requests_.size()) +
+                     " pending requests, oldest first:\n";
+  for (auto& [frame_number, request] : pending_requests_) {
+    dump += "  frame " + std::to_string(frame_number) + ": " +
+            std::to_string((now - request.submit_time_ns) / kNsPerMs) +
+            " ms since submission, frame duration " +
+            std::to_string(request.frame_duration_ns / kNsPerMs) +
+            " ms, waiting for";
+    if (request.shutter_pending) {
+      dump += " shutter,";
+    }
+    if (request.metadata_pending) {
+      dump += " partial result " +
+              std::to_string(request.partial_results_received + 1) + "/" +
+              std::to_string(config_.partial_result_count) + ",";
+    }
+    for (auto& [stream_id, count] : request.pending_buffers) {
+      dump += " " + std::to_string(count) + " buffer(s) of stream " +
+              std::to_string(stream_id) + ",";
+    }
+    dump.back() = request.stall_reported ? ' ' : '\n';
+    if (request.stall_reported) {
+      dump += "(stalled)\n";
+    }
+  }
+
+  // Results are dispatched in frame number order, so the oldest pending
+  // request holds back the results of all the others.
+  if (pending_requests_.size() > 1) {
+    dump += "  frame " + std::to_string(pending_requests_.begin()->first) +
+            " holds back " + std::to_string(pending_requests_.size() - 1) +
+            " later requests\n";
+  }
+  return dump;
+}
+
+void RequestWatchdog::CheckerThreadLoop() {
+  std::unique_lock<std::mutex> lock(checker_lock_);
+  while (!checker_exiting_) {
+    checker_condition_.wait_for(
+        lock, std::chrono::milliseconds(config_.check_interval_ms),
+        [this] { return checker_exiting_; });
+    if (checker_exiting_) {
+      break;
+    }
+    lock.unlock();
+    CheckStalls();
+    lock.lock();
+  }
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
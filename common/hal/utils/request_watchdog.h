@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_REQUEST_WATCHDOG_H_
+#define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_REQUEST_WATCHDOG_H_
+
+#include <android-base/thread_annotations.h>
+#include <utils/Errors.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "hal_types.h"
+
+namespace android {
+namespace google_camera_hal {
+
+// RequestWatchdog measures the stages of in-flight capture requests against
+// latency SLOs and reports requests that stop making progress.
+//
+// Each request is timestamped when it is submitted, and its shutter, every
+// partial result and every output buffer are measured from the submission.
+// The SLOs are a number of frame durations of the request, taken from its
+// settings: the shutter is due within shutter_slo_frames and results and
+// buffers within result_slo_frames. Late stages are counted as violations,
+// in total and over a rolling window of the most recent samples, per stage
+// and per stream.
+//
+// The output buffers of every stream are accounted for: requested, delivered,
+// returned in error, or dropped with a request that failed as a whole or was
+// never sent to the HWL. Outcomes are also kept over a rolling window.
+//
+// A request is stalled when it is still pending stall_timeout_frames frame
+// durations, and at least min_stall_timeout_ns, after its submission. A
+// checker thread looks for stalled requests every check_interval_ms and
+// invokes the stall callback once per stalled request with a dump of all
+// pending requests and what each of them still waits for.
+//
+// Thread safe.
+class RequestWatchdog {
+ public:
+  struct Config {
+    // Number of partial results of a request.
+    uint32_t partial_result_count = 1;
+    // SLOs in frame durations, from the request submission.
+    float shutter_slo_frames = 5;
+    float result_slo_frames = 6;
+    float stall_timeout_frames = 30;
+    int64_t min_stall_timeout_ns = 1000000000;
+    // Frame duration used until a request sets one.
+    int64_t default_frame_duration_ns = 33333333;
+    // Number of the most recent samples of the rolling statistics.
+    uint32_t window_size = 300;
+    // Period of the stall checks. 0 to only check in CheckStalls().
+    uint32_t check_interval_ms = 100;
+    // Monotonic clock in nanoseconds. Uses CLOCK_MONOTONIC if not set.
+    std::function<int64_t()> clock;
+  };
+
+  struct LatencyStats {
+    uint64_t count = 0;
+    uint64_t violations = 0;
+    int64_t max_latency_ns = 0;
+    // Over the most recent Config::window_size samples.
+    uint32_t window_count = 0;
+    uint32_t window_violations = 0;
+    int64_t window_max_latency_ns = 0;
+  };
+
+  struct BufferCounts {
+    uint64_t requested = 0;
+    uint64_t delivered = 0;
+    // Returned in error.
+    uint64_t errors = 0;
+    // Of requests that failed, weren't submitted, or were pending when the
+    // device failed or the watchdog was reset.
+    uint64_t dropped = 0;
+    // Outcomes of the most recent Config::window_size buffers.
+    uint32_t window_count = 0;
+    uint32_t window_errors = 0;
+    uint32_t window_dropped = 0;
+  };
+
+  struct Stats {
+    LatencyStats shutter;
+    LatencyStats partial_result;
+    // Indexed by stream ID.
+    std::map<int32_t, LatencyStats> buffers;
+    std::map<int32_t, BufferCounts> buffer_counts;
+    uint64_t requests = 0;
+    uint64_t stalls = 0;
+    uint32_t pending_requests = 0;
+  };
+
+  // Invoked from the checker thread, or the caller of CheckStalls(), with the
+  // frame number of a stalled request and the dump of the pending requests.
+  using StallCallback =
+      std::function<void(uint32_t frame_number, const std::string& dump)>;
+
+  static std::unique_ptr<RequestWatchdog> Create(const Config& config,
+                                                 StallCallback stall_callback);
+
+  virtual ~RequestWatchdog();
+
+  // Start watching a request. Must be called before the request is sent to
+  // the HWL, whose results may arrive before it returns.
+  void OnRequestSubmitted(const CaptureRequest& request);
+
+  // Stop watching a request that was not processed.
+  void OnRequestDropped(uint32_t frame_number);
+
+  // Track a shutter or an error message.
+  void OnNotify(const NotifyMessage& message);
+
+  // Track the partial result and output buffers of a result.
+  void OnResult(const CaptureResult& result);
+
+  // Stop watching all requests, e.g. when streams are reconfigured. The
+  // statistics are kept. grouped_stream_id_map maps the streams of a stream
+  // group to the one stream the buffers of the group are tracked with, as
+  // the HWL may return the buffer of any stream of the group.
+  void Reset(const std::unordered_map<int32_t, int32_t>&
+                 grouped_stream_id_map = {});
+
+  // Report the requests that became stalled. Returns the number of them.
+  uint32_t CheckStalls();
+
+  Stats GetStats();
+
+  // Dump the pending requests, oldest first.
+  std::string DumpPendingRequests();
+
+  // Dump the statistics, with the lines prefixed with indent.
+  std::string DumpStats(const std::string& indent);
+
+  // Frame duration of a request with settings, or previous_frame_duration_ns
+  // if the settings don't set one.
+  static int64_t GetFrameDuration(const HalCameraMetadata* settings,
+                                  int64_t previous_frame_duration_ns);
+
+ protected:
+  RequestWatchdog(const Config& config, StallCallback stall_callback);
+
+ private:
+  // Latency samples of a stage, with the rolling window.
+  struct LatencyTracker {
+    LatencyStats stats;
+    // Latency and whether it violated the SLO of the most recent samples.
+    std::deque<std::pair<int64_t, bool>> window;
+  };
+
+  enum class BufferOutcome : uint8_t {
+    kDelivered,
+    kError,
+    kDropped,
+  };
+
+  // Outcomes of the buffers of a stream, with the rolling window.
+  struct BufferCounter {
+    BufferCounts counts;
+    std::deque<BufferOutcome> window;
+  };
+
+  struct PendingRequest {
+    int64_t submit_time_ns = 0;
+    int64_t frame_duration_ns = 0;
+    bool shutter_pending = true;
+    uint32_t partial_results_received = 0;
+    bool metadata_pending = true;
+    // Number of output buffers pending per stream ID.
+    std::map<int32_t, uint32_t> pending_buffers;
+    bool stall_reported = false;
+  };
+
+  int64_t Now() const;
+
+  // Record a sample of a stage of request.
+  void AddSampleLocked(LatencyTracker* tracker, const PendingRequest& request,
+                       float slo_frames) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Record count buffer outcomes of stream_id.
+  void AddBufferOutcomeLocked(int32_t stream_id, BufferOutcome outcome,
+                              uint32_t count) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Record the pending buffers of a request as dropped.
+  void DropPendingBuffersLocked(const PendingRequest& request)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Remove the request of frame_number if it is complete.
+  void RemoveIfCompleteLocked(uint32_t frame_number)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Stream ID buffers of stream_id are tracked with.
+  int32_t GetTrackedStreamIdLocked(int32_t stream_id)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  std::string DumpPendingRequestsLocked(int64_t now)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  void CheckerThreadLoop();
+
+  const Config config_;
+  const StallCallback stall_callback_;
+
+  std::mutex lock_;
+  // Maps from frame number to the pending request.
+  std::map<uint32_t, PendingRequest> pending_requests_ GUARDED_BY(lock_);
+  int64_t last_frame_duration_ns_ GUARDED_BY(lock_) = 0;
+  LatencyTracker shutter_tracker_ GUARDED_BY(lock_);
+  LatencyTracker partial_result_tracker_ GUARDED_BY(lock_);
+  std::map<int32_t, LatencyTracker> buffer_trackers_ GUARDED_BY(lock_);
+  std::map<int32_t, BufferCounter> buffer_counters_ GUARDED_BY(lock_);
+  uint64_t requests_ GUARDED_BY(lock_) = 0;
+  uint64_t stalls_ GUARDED_BY(lock_) = 0;
+  std::unordered_map<int32_t, int32_t> grouped_stream_id_map_
+      GUARDED_BY(lock_);
+
+  std::thread checker_thread_;
+  std::mutex checker_lock_;
+  std::condition_variable checker_condition_;
+  bool checker_exiting_ GUARDED_BY(checker_lock_) = false;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_UTILS_REQUEST_WATCHDOG_H_
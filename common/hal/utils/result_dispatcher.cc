@@ -29,6 +29,7 @@
 #include <string_view>
 
 #include "hal_types.h"
+#include "thread_role_manager.h"
 #include "utils.h"
 
 namespace android {
@@ -74,17 +75,6 @@ ResultDispatcher::ResultDispatcher(
   notify_callback_thread_ =
       std::thread([this] { this->NotifyCallbackThreadLoop(); });
 
-  // Assign higher priority to reduce the preemption when CPU usage is high
-  //
-  // As from b/295977499, we need to make it realtime for priority inheritance
-  // to avoid CameraServer thread being the bottleneck
-  status_t res =
-      utils::SetRealtimeThread(notify_callback_thread_.native_handle());
-  if (res != OK) {
-    ALOGE("[%s] %s: SetRealtimeThread fail", name_.c_str(), __FUNCTION__);
-  } else {
-    ALOGI("[%s] %s: SetRealtimeThread OK", name_.c_str(), __FUNCTION__);
-  }
   InitializeGroupStreamIdsMap(stream_config);
 }
 
@@ -386,6 +376,8 @@ void ResultDispatcher::NotifyCallbackThreadLoop() {
   pthread_setname_np(
       pthread_self(),
       name_.substr(/*pos=*/0, /*count=*/kPthreadNameLenMinusOne).c_str());
+  // Result delivery runs in SCHED_FIFO by default, see ThreadRoleManager.
+  ScopedThreadRole role(ThreadRole::kResultDelivery, name_);
 
   while (1) {
     NotifyShutters();
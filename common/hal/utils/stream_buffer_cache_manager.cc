@@ -27,7 +27,9 @@
 
 #include <chrono>
 
+#include "caching_buffer_allocator.h"
 #include "stream_buffer_cache_manager.h"
+#include "thread_role_manager.h"
 #include "utils.h"
 
 using namespace std::chrono_literals;
@@ -52,14 +54,6 @@ StreamBufferCacheManager::StreamBufferCacheManager(
     const std::set<int32_t>& hal_buffer_managed_stream_ids)
     : hal_buffer_managed_streams_(hal_buffer_managed_stream_ids) {
   workload_thread_ = std::thread([this] { this->WorkloadThreadLoop(); });
-  if (utils::SupportRealtimeThread()) {
-    status_t res = utils::SetRealtimeThread(workload_thread_.native_handle());
-    if (res != OK) {
-      ALOGE("%s: SetRealtimeThread fail", __FUNCTION__);
-    } else {
-      ALOGI("%s: SetRealtimeThread OK", __FUNCTION__);
-    }
-  }
 }
 
 StreamBufferCacheManager::~StreamBufferCacheManager() {
@@ -244,6 +238,7 @@ status_t StreamBufferCacheManager::IsStreamActive(int32_t stream_id,
 
 status_t StreamBufferCacheManager::AddStreamBufferCacheLocked(
     const StreamBufferCacheRegInfo& reg_info) {
+  ScopedMemorySession memory_session(memory_session_);
   auto stream_buffer_cache = StreamBufferCacheManager::StreamBufferCache::Create(
       reg_info, [this] { this->NotifyThreadWorkload(); },
       dummy_buffer_allocator_.get());
@@ -258,6 +253,7 @@ status_t StreamBufferCacheManager::AddStreamBufferCacheLocked(
 }
 
 void StreamBufferCacheManager::WorkloadThreadLoop() {
+  ScopedThreadRole role(ThreadRole::kHousekeeping, "StreamBufMgr");
   if (property_get_bool(kRaiseBufAllocationPriority, true)) {
     pid_t tid = gettid();
     setpriority(PRIO_PROCESS, tid, -20);
@@ -335,12 +331,24 @@ StreamBufferCacheManager::StreamBufferCache::StreamBufferCache(
     const StreamBufferCacheRegInfo& reg_info,
     NotifyManagerThreadWorkloadFunc notify,
     IHalBufferAllocator* dummy_buffer_allocator)
-    : cache_info_(reg_info) {
+    : cache_info_(reg_info),
+      memory_session_(MemoryTracker::GetCurrentSession()),
+      buffer_size_bytes_(static_cast<int64_t>(
+          CachingBufferAllocator::GetBufferSizeBytes({
+              .width = reg_info.width,
+              .height = reg_info.height,
+              .format = reg_info.format,
+          }))) {
   std::lock_guard<std::mutex> lock(cache_access_mutex_);
   notify_for_workload_ = notify;
   dummy_buffer_allocator_ = dummy_buffer_allocator;
 }
 
+StreamBufferCacheManager::StreamBufferCache::~StreamBufferCache() {
+  MemoryTracker::GetInstance().Update(MemoryCategory::kStreamBufferCache,
+                                      memory_session_, -tracked_bytes_);
+}
+
 status_t StreamBufferCacheManager::StreamBufferCache::UpdateCache(
     bool forced_flushing) {
   status_t res = OK;
@@ -422,6 +430,7 @@ status_t StreamBufferCacheManager::StreamBufferCache::GetBuffer(
     res->is_dummy_buffer = false;
     res->buffer = cached_buffers_.back();
     cached_buffers_.pop_back();
+    UpdateTrackedBytesLocked();
   }
 
   return OK;
@@ -464,6 +473,7 @@ status_t StreamBufferCacheManager::StreamBufferCache::FlushLocked(
 
   cached_buffers_.clear();
   ReleaseDummyBufferLocked();
+  UpdateTrackedBytesLocked();
 
   return OK;
 }
@@ -543,6 +553,7 @@ status_t StreamBufferCacheManager::StreamBufferCache::Refill() {
     for (auto& buffer : buffers) {
       cached_buffers_.push_back(buffer);
     }
+    UpdateTrackedBytesLocked();
   }
 
   cache_access_cv_.notify_one();
@@ -593,6 +604,7 @@ status_t StreamBufferCacheManager::StreamBufferCache::AllocateDummyBufferLocked(
   dummy_buffer_.buffer = buffers[0];
   ALOGI("%s: [sbc] Dummy buffer allocated: strm %d buffer %p", __FUNCTION__,
         dummy_buffer_.stream_id, dummy_buffer_.buffer);
+  UpdateTrackedBytesLocked();
 
   return OK;
 }
@@ -603,9 +615,19 @@ void StreamBufferCacheManager::StreamBufferCache::ReleaseDummyBufferLocked() {
     std::vector<buffer_handle_t> buffers(1, dummy_buffer_.buffer);
     dummy_buffer_allocator_->FreeBuffers(&buffers);
     dummy_buffer_.buffer = nullptr;
+    UpdateTrackedBytesLocked();
   }
 }
 
+void StreamBufferCacheManager::StreamBufferCache::UpdateTrackedBytesLocked() {
+  size_t num_buffers =
+      cached_buffers_.size() + (dummy_buffer_.buffer != nullptr ? 1 : 0);
+  int64_t bytes = static_cast<int64_t>(num_buffers) * buffer_size_bytes_;
+  MemoryTracker::GetInstance().Update(MemoryCategory::kStreamBufferCache,
+                                      memory_session_, bytes - tracked_bytes_);
+  tracked_bytes_ = bytes;
+}
+
 status_t StreamBufferCacheManager::GetStreamBufferCache(
     int32_t stream_id, StreamBufferCache** stream_buffer_cache) {
   std::unique_lock<std::mutex> map_lock(caches_map_mutex_);
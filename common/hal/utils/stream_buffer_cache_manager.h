@@ -30,6 +30,7 @@
 
 #include "gralloc_buffer_allocator.h"
 #include "hal_types.h"
+#include "memory_tracker.h"
 
 namespace android {
 namespace google_camera_hal {
@@ -171,7 +172,7 @@ class StreamBufferCacheManager {
         NotifyManagerThreadWorkloadFunc notify,
         IHalBufferAllocator* dummy_buffer_allocator);
 
-    virtual ~StreamBufferCache() = default;
+    virtual ~StreamBufferCache();
 
     // Flush the stream buffer cache if the forced_flushing flag is set or if
     // the stream buffer cache has been notified for flushing. Otherwise, check
@@ -230,6 +231,10 @@ class StreamBufferCacheManager {
     // The cache_access_mutex_ needs to be locked before calling this function.
     void ReleaseDummyBufferLocked();
 
+    // Report the bytes of the cached and dummy buffers to MemoryTracker.
+    // The cache_access_mutex_ needs to be locked before calling this function.
+    void UpdateTrackedBytesLocked();
+
     // Any access to the cache content must be guarded by this mutex.
     std::mutex cache_access_mutex_;
     // Condition variable used in timed wait for refilling
@@ -265,6 +270,12 @@ class StreamBufferCacheManager {
     // Allocator of the dummy buffer for this stream. The stream buffer cache
     // manager owns this throughout the life cycle of this stream buffer cahce.
     IHalBufferAllocator* dummy_buffer_allocator_ = nullptr;
+    // Memory session the buffers of this cache are attributed to.
+    const uint32_t memory_session_ = MemoryTracker::kNoSession;
+    // Size of a buffer of this stream in bytes.
+    const int64_t buffer_size_bytes_ = 0;
+    // Bytes reported to MemoryTracker.
+    int64_t tracked_bytes_ = 0;
   };
 
   // Add stream buffer cache. Lock caches_map_mutex_ before calling this func.
@@ -306,6 +317,9 @@ class StreamBufferCacheManager {
   // The dummy buffer allocator allocates the dummy buffer. It only allocates
   // the dummy buffer when a stream buffer cache is NotifyProviderReadiness.
   std::unique_ptr<IHalBufferAllocator> dummy_buffer_allocator_;
+  // Memory session of the thread that created the manager, which the stream
+  // buffer caches are attributed to.
+  const uint32_t memory_session_ = MemoryTracker::GetCurrentSession();
 
   // Guards NotifyFlushingAll. In case the workload thread is processing workload,
   // the NotifyFlushingAll calling should wait until workload loop is done. This
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "GCH_ThermalMailbox"
+#include <log/log.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "thermal_mailbox.h"
+
+namespace android {
+namespace google_camera_hal {
+
+std::unique_ptr<ThermalMailbox> ThermalMailbox::Create() {
+  return std::unique_ptr<ThermalMailbox>(new ThermalMailbox());
+}
+
+size_t ThermalMailbox::GetSlotIndex(TemperatureType type) {
+  int32_t index = static_cast<int32_t>(type) + 1;
+  if (index < 0 || index >= static_cast<int32_t>(kNumTemperatureTypes)) {
+    // Unknown types share the kUnknown slot.
+    return 0;
+  }
+  return index;
+}
+
+ThrottlingSeverity ThermalMailbox::Post(const Temperature& temperature) {
+  uint32_t value_bits = 0;
+  static_assert(sizeof(value_bits) == sizeof(temperature.value));
+  memcpy(&value_bits, &temperature.value, sizeof(value_bits));
+
+  uint64_t slot_value =
+      (static_cast<uint64_t>(value_bits) << 32) |
+      (static_cast<uint64_t>(temperature.throttling_status) & 0xFF) << 1 |
+      kSlotValidBit;
+  uint64_t previous = slots_[GetSlotIndex(temperature.type)].exchange(
+      slot_value, std::memory_order_acq_rel);
+
+  if (temperature.throttling_status >= ThrottlingSeverity::kSevere) {
+    throttling_.store(true, std::memory_order_release);
+  }
+
+  post_count_.fetch_add(1, std::memory_order_relaxed);
+
+  if ((previous & kSlotValidBit) == 0) {
+    return ThrottlingSeverity::kNone;
+  }
+  return static_cast<ThrottlingSeverity>((previous >> 1) & 0xFF);
+}
+
+bool ThermalMailbox::GetLatest(TemperatureType type,
+                               ThrottlingSeverity* severity,
+                               float* value) const {
+  uint64_t slot_value =
+      slots_[GetSlotIndex(type)].load(std::memory_order_acquire);
+  if ((slot_value & kSlotValidBit) == 0) {
+    return false;
+  }
+
+  if (severity != nullptr) {
+    *severity = static_cast<ThrottlingSeverity>((slot_value >> 1) & 0xFF);
+  }
+  if (value != nullptr) {
+    uint32_t value_bits = static_cast<uint32_t>(slot_value >> 32);
+    memcpy(value, &value_bits, sizeof(*value));
+  }
+  return true;
+}
+
+ThrottlingSeverity ThermalMailbox::GetMaxSeverity() const {
+  uint32_t max_severity = 0;
+  for (auto& slot : slots_) {
+    uint64_t slot_value = slot.load(std::memory_order_acquire);
+    if ((slot_value & kSlotValidBit) != 0) {
+      max_severity = std::max(max_severity,
+                              static_cast<uint32_t>((slot_value >> 1) & 0xFF));
+    }
+  }
+  return static_cast<ThrottlingSeverity>(max_severity);
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
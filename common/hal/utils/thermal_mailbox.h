@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_THERMAL_MAILBOX_H_
+#define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_THERMAL_MAILBOX_H_
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include "thermal_types.h"
+
+namespace android {
+namespace google_camera_hal {
+
+// ThermalMailbox decouples thermal notifications from the capture request
+// path. The thermal service thread posts temperatures into an atomic
+// latest-value slot per TemperatureType without taking any lock, and readers
+// on the request path query the throttling state with atomic loads only.
+class ThermalMailbox {
+ public:
+  static std::unique_ptr<ThermalMailbox> Create();
+  virtual ~ThermalMailbox() = default;
+
+  // Post the latest temperature of temperature.type. Lock-free. Returns the
+  // severity previously stored for the same type.
+  ThrottlingSeverity Post(const Temperature& temperature);
+
+  // Get the latest severity and value posted for type. Returns false if
+  // nothing was posted for type.
+  bool GetLatest(TemperatureType type, ThrottlingSeverity* severity,
+                 float* value) const;
+
+  // Return the highest severity among the latest temperatures of all types.
+  ThrottlingSeverity GetMaxSeverity() const;
+
+  // Return true if ThrottlingSeverity::kSevere or worse has been posted since
+  // the last ResetThrottling().
+  bool IsThrottling() const {
+    return throttling_.load(std::memory_order_acquire);
+  }
+
+  // Clear the throttling state, e.g. when streams are reconfigured.
+  void ResetThrottling() {
+    throttling_.store(false, std::memory_order_release);
+  }
+
+  // Total number of posts.
+  uint64_t GetPostCount() const {
+    return post_count_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  ThermalMailbox() = default;
+
+ private:
+  // Number of TemperatureType values, including kUnknown.
+  static constexpr size_t kNumTemperatureTypes =
+      static_cast<size_t>(TemperatureType::kNpu) + 2;
+
+  // Slot value layout: bits 63..32 hold the float temperature value, bits
+  // 8..1 the severity and bit 0 is set once the slot has been written.
+  static constexpr uint64_t kSlotValidBit = 1;
+
+  static size_t GetSlotIndex(TemperatureType type);
+
+  std::array<std::atomic<uint64_t>, kNumTemperatureTypes> slots_ = {};
+  std::atomic<bool> throttling_ = false;
+  std::atomic<uint64_t> post_count_ = 0;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_UTILS_THERMAL_MAILBOX_H_
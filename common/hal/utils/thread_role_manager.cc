@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "GCH_ThreadRoleManager"
+#include "thread_role_manager.h"
+
+#include <cutils/properties.h>
+#include <cutils/threads.h>
+#include <log/log.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <system/thread_defs.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace android {
+namespace google_camera_hal {
+
+static constexpr char kThreadRolePropPrefix[] =
+    "persist.vendor.camera.thread_role.";
+// Also read by utils::SupportRealtimeThread(), not linked here so that the
+// registry builds for the host.
+static constexpr char kRealtimeThreadProp[] =
+    "persist.vendor.camera.realtimethread";
+static constexpr int32_t kMaxFifoPriority = 99;
+static constexpr int32_t kMinNice = -20;
+static constexpr int32_t kMaxNice = 19;
+
+// Fields of /proc/<pid>/task/<tid>/stat, counted from the state field
+// following the command name.
+static constexpr size_t kStatUserTimeField = 11;
+static constexpr size_t kStatSystemTimeField = 12;
+static constexpr size_t kStatNiceField = 16;
+static constexpr size_t kStatCpuField = 36;
+
+static std::string GetTaskPath(pid_t tid, const char* file) {
+  return "/proc/self/task/" + std::to_string(tid) + "/" + file;
+}
+
+static bool ParseInt(const std::string& value, int32_t* result) {
+  if (value.empty()) {
+    return false;
+  }
+  char* end = nullptr;
+  errno = 0;
+  long parsed = strtol(value.c_str(), &end, 10);
+  if (errno != 0 || *end != '\0') {
+    return false;
+  }
+  *result = static_cast<int32_t>(parsed);
+  return true;
+}
+
+// Parse a CPU or a range of CPUs, e.g. "3" or "4-7", into cpus.
+static bool ParseCpuRange(const std::string& range,
+                          std::vector<uint32_t>* cpus) {
+  size_t dash = range.find('-');
+  int32_t first = 0;
+  int32_t last = 0;
+  if (dash == std::string::npos) {
+    if (!ParseInt(range, &first)) {
+      return false;
+    }
+    last = first;
+  } else if (!ParseInt(range.substr(0, dash), &first) ||
+             !ParseInt(range.substr(dash + 1), &last)) {
+    return false;
+  }
+  if (first < 0 || last < first || last >= CPU_SETSIZE) {
+    return false;
+  }
+  for (int32_t cpu = first; cpu <= last; cpu++) {
+    cpus->push_back(cpu);
+  }
+  return true;
+}
+
+static std::string CpusToString(const std::vector<uint32_t>& cpus) {
+  if (cpus.empty()) {
+    return "all";
+  }
+  std::string result;
+  for (auto cpu : cpus) {
+    result += (result.empty() ? "" : ",") + std::to_string(cpu);
+  }
+  return result;
+}
+
+ThreadRoleManager& ThreadRoleManager::GetInstance() {
+  static ThreadRoleManager instance;
+  return instance;
+}
+
+ThreadRoleManager::ThreadRoleManager() {
+  // Result delivery runs in SCHED_FIFO for priority inheritance, to avoid
+  // the camera server threads being the bottleneck.
+  policies_[static_cast<uint32_t>(ThreadRole::kResultDelivery)].fifo_priority =
+      1;
+  // Rendering keeps up with the display, at the priority the render threads
+  // had before they were registered.
+  policies_[static_cast<uint32_t>(ThreadRole::kRender)].nice =
+      ANDROID_PRIORITY_URGENT_DISPLAY;
+  if (property_get_bool(kRealtimeThreadProp, false)) {
+    policies_[static_cast<uint32_t>(ThreadRole::kHousekeeping)].fifo_priority =
+        1;
+  }
+
+  for (uint32_t i = 0; i < kNumRoles; i++) {
+    std::string property =
+        kThreadRolePropPrefix +
+        std::string(GetRoleName(static_cast<ThreadRole>(i)));
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get(property.c_str(), value, "") <= 0) {
+      continue;
+    }
+    ThreadPolicy policy;
+    if (ParsePolicy(value, &policy) != OK) {
+      ALOGE("%s: Invalid policy \"%s\" in %s", __FUNCTION__, value,
+            property.c_str());
+      continue;
+    }
+    policies_[i] = policy;
+  }
+}
+
+const char* ThreadRoleManager::GetRoleName(ThreadRole role) {
+  switch (role) {
+    case ThreadRole::kFramePacing:
+      return "frame_pacing";
+    case ThreadRole::kRender:
+      return "render";
+    case ThreadRole::kEncode:
+      return "encode";
+    case ThreadRole::kResultDelivery:
+      return "result_delivery";
+    case ThreadRole::kHousekeeping:
+      return "housekeeping";
+    default:
+      return "unknown";
+  }
+}
+
+status_t ThreadRoleManager::ParsePolicy(const std::string& spec,
+                                        ThreadPolicy* policy) {
+  if (policy == nullptr) {
+    ALOGE("%s: policy is nullptr", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  ThreadPolicy result;
+  std::stringstream stream(spec);
+  std::string item;
+  std::string key;
+  while (std::getline(stream, item, ',')) {
+    size_t equal = item.find('=');
+    std::string value = item;
+    if (equal != std::string::npos) {
+      key = item.substr(0, equal);
+      value = item.substr(equal + 1);
+    } else if (key != "cpus") {
+      // Only the CPU list continues after a comma.
+      return BAD_VALUE;
+    }
+
+    if (key == "fifo") {
+      if (!ParseInt(value, &result.fifo_priority) ||
+          result.fifo_priority < 0 || result.fifo_priority > kMaxFifoPriority) {
+        return BAD_VALUE;
+      }
+    } else if (key == "nice") {
+      if (!ParseInt(value, &result.nice) || result.nice < kMinNice ||
+          result.nice > kMaxNice) {
+        return BAD_VALUE;
+      }
+    } else if (key == "cpus") {
+      if (!ParseCpuRange(value, &result.cpus)) {
+        return BAD_VALUE;
+      }
+    } else {
+      return BAD_VALUE;
+    }
+  }
+
+  std::sort(result.cpus.begin(), result.cpus.end());
+  result.cpus.erase(std::unique(result.cpus.begin(), result.cpus.end()),
+                    result.cpus.end());
+  *policy = result;
+  return OK;
+}
+
+void ThreadRoleManager::SetPolicy(ThreadRole role, const ThreadPolicy& policy) {
+  if (role >= ThreadRole::kNumRoles) {
+    ALOGE("%s: Invalid role %u", __FUNCTION__, static_cast<uint32_t>(role));
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  policies_[static_cast<uint32_t>(role)] = policy;
+  RemoveExitedThreadsLocked();
+  for (auto& [tid, info] : threads_) {
+    if (info.role == role) {
+      ApplyPolicyLocked(tid, &info);
+    }
+  }
+}
+
+ThreadPolicy ThreadRoleManager::GetPolicy(ThreadRole role) {
+  if (role >= ThreadRole::kNumRoles) {
+    ALOGE("%s: Invalid role %u", __FUNCTION__, static_cast<uint32_t>(role));
+    return ThreadPolicy();
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  return policies_[static_cast<uint32_t>(role)];
+}
+
+status_t ThreadRoleManager::RegisterCurrentThread(ThreadRole role,
+                                                  const std::string& name) {
+  if (role >= ThreadRole::kNumRoles) {
+    ALOGE("%s: Invalid role %u", __FUNCTION__, static_cast<uint32_t>(role));
+    return BAD_VALUE;
+  }
+
+  pid_t tid = gettid();
+  std::lock_guard<std::mutex> lock(lock_);
+  RemoveExitedThreadsLocked();
+  ThreadInfo& info = threads_[tid];
+  info.name = name;
+  info.role = role;
+  ApplyPolicyLocked(tid, &info);
+  ALOGI("%s: %s (%d) registered as %s%s%s", __FUNCTION__, name.c_str(), tid,
+        GetRoleName(role), info.realtime ? ", realtime" : "",
+        info.pinned ? ", pinned" : "");
+  return OK;
+}
+
+void ThreadRoleManager::UnregisterCurrentThread() {
+  pid_t tid = gettid();
+  std::lock_guard<std::mutex> lock(lock_);
+  threads_.erase(tid);
+}
+
+void ThreadRoleManager::ApplyPolicyLocked(pid_t tid, ThreadInfo* info) {
+  const ThreadPolicy& policy = policies_[static_cast<uint32_t>(info->role)];
+  const char* role_name = GetRoleName(info->role);
+
+  if (policy.fifo_priority > 0) {
+    struct sched_param param = {
+        .sched_priority = policy.fifo_priority,
+    };
+    bool realtime =
+        sched_setscheduler(tid, SCHED_FIFO | SCHED_RESET_ON_FORK, &param) == 0;
+    if (!realtime) {
+      ALOGW("%s: SCHED_FIFO not permitted for %s (%s): %s", __FUNCTION__,
+            info->name.c_str(), role_name, strerror(errno));
+    }
+    info->realtime = realtime;
+  } else if (info->realtime) {
+    // Only demote threads this manager made realtime.
+    struct sched_param param = {
+        .sched_priority = 0,
+    };
+    if (sched_setscheduler(tid, SCHED_OTHER, &param) == 0) {
+      info->realtime = false;
+    } else {
+      ALOGW("%s: Couldn't set SCHED_OTHER for %s (%s): %s", __FUNCTION__,
+            info->name.c_str(), role_name, strerror(errno));
+    }
+  }
+
+  if (!info->realtime && policy.nice != 0 &&
+      setpriority(PRIO_PROCESS, tid, policy.nice) != 0) {
+    ALOGW("%s: Couldn't set nice %d for %s (%s): %s", __FUNCTION__,
+          policy.nice, info->name.c_str(), role_name, strerror(errno));
+  }
+
+  if (!policy.cpus.empty() || info->pinned) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (policy.cpus.empty()) {
+      long cpu_count = sysconf(_SC_NPROCESSORS_CONF);
+      for (long cpu = 0; cpu < cpu_count && cpu < CPU_SETSIZE; cpu++) {
+        CPU_SET(cpu, &cpu_set);
+      }
+    } else {
+      for (auto cpu : policy.cpus) {
+        CPU_SET(cpu, &cpu_set);
+      }
+    }
+    if (sched_setaffinity(tid, sizeof(cpu_set), &cpu_set) == 0) {
+      info->pinned = !policy.cpus.empty();
+    } else {
+      ALOGW("%s: Couldn't set CPUs %s for %s (%s): %s", __FUNCTION__,
+            CpusToString(policy.cpus).c_str(), info->name.c_str(), role_name,
+            strerror(errno));
+    }
+  }
+}
+
+void ThreadRoleManager::RemoveExitedThreadsLocked() {
+  for (auto it = threads_.begin(); it != threads_.end();) {
+    if (access(GetTaskPath(it->first, "").c_str(), F_OK) != 0) {
+      it = threads_.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+std::vector<ThreadStats> ThreadRoleManager::GetStats() {
+  std::vector<ThreadStats> stats;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    RemoveExitedThreadsLocked();
+    for (auto& [tid, info] : threads_) {
+      stats.push_back({.tid = tid,
+                       .name = info.name,
+                       .role = info.role,
+                       .realtime = info.realtime,
+                       .pinned = info.pinned});
+    }
+  }
+
+  const int64_t ns_per_tick = 1000000000 / sysconf(_SC_CLK_TCK);
+  for (auto& thread : stats) {
+    std::ifstream stat_file(GetTaskPath(thread.tid, "stat"));
+    std::string line;
+    if (std::getline(stat_file, line)) {
+      // The command name may contain spaces, skip to its closing parenthesis.
+      size_t name_end = line.rfind(')');
+      std::vector<std::string> fields;
+      if (name_end != std::string::npos) {
+        std::istringstream field_stream(line.substr(name_end + 1));
+        std::string field;
+        while (field_stream >> field) {
+          fields.push_back(field);
+        }
+      }
+      if (fields.size() > kStatCpuField) {
+        thread.user_time_ns =
+            strtoll(fields[kStatUserTimeField].c_str(), nullptr, 10) *
+            ns_per_tick;
+        thread.system_time_ns =
+            strtoll(fields[kStatSystemTimeField].c_str(), nullptr, 10) *
+            ns_per_tick;
+        thread.nice = atoi(fields[kStatNiceField].c_str());
+        thread.cpu = atoi(fields[kStatCpuField].c_str());
+      }
+    }
+
+    std::ifstream schedstat_file(GetTaskPath(thread.tid, "schedstat"));
+    schedstat_file >> thread.run_time_ns >> thread.wait_time_ns;
+
+    std::ifstream status_file(GetTaskPath(thread.tid, "status"));
+    while (std::getline(status_file, line)) {
+      std::istringstream line_stream(line);
+      std::string key;
+      line_stream >> key;
+      if (key == "voluntary_ctxt_switches:") {
+        line_stream >> thread.voluntary_switches;
+      } else if (key == "nonvoluntary_ctxt_switches:") {
+        line_stream >> thread.involuntary_switches;
+      }
+    }
+  }
+
+  std::sort(stats.begin(), stats.end(),
+            [](const ThreadStats& a, const ThreadStats& b) {
+              return a.role != b.role ? a.role < b.role : a.tid < b.tid;
+            });
+  return stats;
+}
+
+void ThreadRoleManager::Dump(int fd) {
+  dprintf(fd, "Thread roles:\n");
+  for (uint32_t i = 0; i < kNumRoles; i++) {
+    ThreadPolicy policy = GetPolicy(static_cast<ThreadRole>(i));
+    dprintf(fd, "  %s: fifo %d, nice %d, cpus %s\n",
+            GetRoleName(static_cast<ThreadRole>(i)), policy.fifo_priority,
+            policy.nice, CpusToString(policy.cpus).c_str());
+  }
+
+  dprintf(fd, "Registered threads:\n");
+  for (const auto& thread : GetStats()) {
+    dprintf(fd,
+            "  %s (%d) %s: %s, nice %d, %s, last cpu %d, user %.1f ms, "
+            "system %.1f ms, run %.1f ms, wait %.1f ms, switches %" PRIu64
+            " voluntary %" PRIu64 " involuntary\n",
+            thread.name.c_str(), thread.tid, GetRoleName(thread.role),
+            thread.realtime ? "SCHED_FIFO" : "SCHED_OTHER", thread.nice,
+            thread.pinned ? "pinned" : "unpinned", thread.cpu,
+            thread.user_time_ns / 1e6, thread.system_time_ns / 1e6,
+            thread.run_time_ns / 1e6, thread.wait_time_ns / 1e6,
+            thread.voluntary_switches, thread.involuntary_switches);
+  }
+}
+
+ScopedThreadRole::ScopedThreadRole(ThreadRole role, const std::string& name) {
+  ThreadRoleManager::GetInstance().RegisterCurrentThread(role, name);
+}
+
+ScopedThreadRole::~ScopedThreadRole() {
+  ThreadRoleManager::GetInstance().UnregisterCurrentThread();
+}
+
+}  // namespace google_camera_hal
+}  // namespace android
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HARDWARE_GOOGLE_CAMERA_HAL_UTILS_THREAD_ROLE_MANAGER_H_
+#define HARDWARE_GOOGLE_CAMERA_HAL_UTILS_THREAD_ROLE_MANAGER_H_
+
+#include <sys/types.h>
+#include <utils/Errors.h>
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace google_camera_hal {
+
+// Roles of the HAL threads, each scheduled with the policy of its role.
+enum class ThreadRole : uint32_t {
+  // Paces the frames, e.g. feeding requests to the sensor at every vsync.
+  kFramePacing = 0,
+  // Renders or processes frames.
+  kRender,
+  // Encodes frames, e.g. JPEG compression.
+  kEncode,
+  // Delivers shutters and results to the framework.
+  kResultDelivery,
+  // Everything else, e.g. refilling buffer caches.
+  kHousekeeping,
+  kNumRoles,
+};
+
+struct ThreadPolicy {
+  // SCHED_FIFO priority, or 0 to keep the thread in SCHED_OTHER.
+  int32_t fifo_priority = 0;
+  // Nice value of a SCHED_OTHER thread, also used when SCHED_FIFO isn't
+  // permitted. 0 keeps the nice value of the thread.
+  int32_t nice = 0;
+  // CPUs the thread may run on. Empty for all of them.
+  std::vector<uint32_t> cpus;
+};
+
+// Runtime statistics of a registered thread from /proc.
+struct ThreadStats {
+  pid_t tid = 0;
+  std::string name;
+  ThreadRole role = ThreadRole::kHousekeeping;
+  // Whether the policy of the role could be applied, the thread may lack the
+  // privileges.
+  bool realtime = false;
+  bool pinned = false;
+  int32_t nice = 0;
+  // CPU the thread last ran on.
+  int32_t cpu = -1;
+  int64_t user_time_ns = 0;
+  int64_t system_time_ns = 0;
+  // Time spent running and waiting on a run queue, if schedstat is available.
+  int64_t run_time_ns = 0;
+  int64_t wait_time_ns = 0;
+  uint64_t voluntary_switches = 0;
+  uint64_t involuntary_switches = 0;
+};
+
+// ThreadRoleManager is the registry of the HAL threads. A thread registers
+// itself with a role and gets the policy of the role: its priority, SCHED_FIFO
+// where permitted and the CPUs it may run on. Without the privileges for
+// SCHED_FIFO a thread falls back to the nice value of the policy, and failing
+// to set the priority or CPUs is logged without failing the registration.
+//
+// The default policies keep the current scheduling of the threads, except
+// render, which runs at ANDROID_PRIORITY_URGENT_DISPLAY, result delivery,
+// which runs in SCHED_FIFO, and housekeeping, which does so if
+// persist.vendor.camera.realtimethread is set. The policy of a role is
+// overridden by the property persist.vendor.camera.thread_role.<role name>,
+// set to a comma separated list of "fifo=<priority>", "nice=<nice>" and
+// "cpus=<cpu list>", e.g. "fifo=2,cpus=4-7" or "nice=-4,cpus=0-3,6".
+//
+// Threads that exit without unregistering are removed from the registry the
+// next time it is accessed.
+//
+// Thread safe.
+class ThreadRoleManager {
+ public:
+  static ThreadRoleManager& GetInstance();
+
+  static const char* GetRoleName(ThreadRole role);
+
+  // Parse a policy in the format of the thread role properties.
+  static status_t ParsePolicy(const std::string& spec, ThreadPolicy* policy);
+
+  // Set the policy of a role, and apply it to the threads registered with it.
+  void SetPolicy(ThreadRole role, const ThreadPolicy& policy);
+
+  ThreadPolicy GetPolicy(ThreadRole role);
+
+  // Register the calling thread and apply the policy of its role. Registering
+  // a thread again changes its role.
+  status_t RegisterCurrentThread(ThreadRole role, const std::string& name);
+
+  void UnregisterCurrentThread();
+
+  // Statistics of the registered threads, ordered by role.
+  std::vector<ThreadStats> GetStats();
+
+  // Dump the policies and the registered threads in fd.
+  void Dump(int fd);
+
+  // Disallow copy and assignment operators
+  ThreadRoleManager(ThreadRoleManager const&) = delete;
+  ThreadRoleManager& operator=(ThreadRoleManager const&) = delete;
+
+ private:
+  static constexpr uint32_t kNumRoles =
+      static_cast<uint32_t>(ThreadRole::kNumRoles);
+
+  struct ThreadInfo {
+    std::string name;
+    ThreadRole role = ThreadRole::kHousekeeping;
+    bool realtime = false;
+    bool pinned = false;
+  };
+
+  ThreadRoleManager();
+
+  // Apply the policy of the role of a thread, and record the outcome in info.
+  void ApplyPolicyLocked(pid_t tid, ThreadInfo* info);
+
+  // Remove the threads that exited.
+  void RemoveExitedThreadsLocked();
+
+  std::mutex lock_;
+  // Policies indexed by role. Protected by lock_.
+  std::array<ThreadPolicy, kNumRoles> policies_;
+  // Maps from thread ID to the registered thread. Protected by lock_.
+  std::map<pid_t, ThreadInfo> threads_;
+};
+
+// Registers the calling thread for the scope of the object.
+class ScopedThreadRole {
+ public:
+  ScopedThreadRole(ThreadRole role, const std::string& name);
+  ~ScopedThreadRole();
+
+  ScopedThreadRole(ScopedThreadRole const&) = delete;
+  ScopedThreadRole& operator=(ScopedThreadRole const&) = delete;
+};
+
+}  // namespace google_camera_hal
+}  // namespace android
+
+#endif  // HARDWARE_GOOGLE_CAMERA_HAL_UTILS_THREAD_ROLE_MANAGER_H_
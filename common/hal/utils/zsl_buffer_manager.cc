@@ -29,11 +29,14 @@ namespace android {
 namespace google_camera_hal {
 
 ZslBufferManager::ZslBufferManager(IHalBufferAllocator* allocator,
-                                   int partial_result_count)
+                                   int partial_result_count,
+                                   MemoryCategory memory_category)
     : kMemoryProfilingEnabled(
           property_get_bool("persist.vendor.camera.hal.memoryprofile", false)),
       buffer_allocator_(allocator),
-      partial_result_count_(partial_result_count) {
+      partial_result_count_(partial_result_count),
+      memory_category_(memory_category),
+      memory_session_(MemoryTracker::GetCurrentSession()) {
 }
 
 ZslBufferManager::~ZslBufferManager() {
@@ -42,6 +45,17 @@ ZslBufferManager::~ZslBufferManager() {
   if (buffer_allocator_ != nullptr) {
     buffer_allocator_->FreeBuffers(&buffers_);
   }
+  MemoryTracker::GetInstance().Update(memory_category_, memory_session_,
+                                      -tracked_bytes_);
+}
+
+void ZslBufferManager::UpdateTrackedBytesLocked() {
+  int64_t bytes = static_cast<int64_t>(
+      buffers_.size() *
+      CachingBufferAllocator::GetBufferSizeBytes(buffer_descriptor_));
+  MemoryTracker::GetInstance().Update(memory_category_, memory_session_,
+                                      bytes - tracked_bytes_);
+  tracked_bytes_ = bytes;
 }
 
 status_t ZslBufferManager::AllocateBuffers(
@@ -54,16 +68,14 @@ status_t ZslBufferManager::AllocateBuffers(
     return ALREADY_EXISTS;
   }
 
-  // Create a buffer allocator if the client doesn't specify one.
+  // Use the shared gralloc allocator if the client doesn't specify one, so
+  // buffers freed by a previous configuration can be reused.
   if (buffer_allocator_ == nullptr) {
-    // Create a buffer manager.
-    internal_buffer_allocator_ = GrallocBufferAllocator::Create();
-    if (internal_buffer_allocator_ == nullptr) {
-      ALOGE("%s: Creating a buffer manager failed.", __FUNCTION__);
+    buffer_allocator_ = CachingBufferAllocator::GetSharedGrallocAllocator();
+    if (buffer_allocator_ == nullptr) {
+      ALOGE("%s: Getting the shared buffer allocator failed.", __FUNCTION__);
       return NO_MEMORY;
     }
-
-    buffer_allocator_ = internal_buffer_allocator_.get();
   }
 
   uint32_t num_buffers = buffer_descriptor.immediate_num_buffers;
@@ -100,6 +112,7 @@ status_t ZslBufferManager::AllocateBuffersLocked(uint32_t buffer_number) {
       empty_zsl_buffers_.push_back(buffer);
     }
   }
+  UpdateTrackedBytesLocked();
 
   if (buffers.size() != buffer_number) {
     ALOGE("%s: allocate buffer failed. request %u, get %zu", __FUNCTION__,
@@ -230,6 +243,7 @@ void ZslBufferManager::FreeUnusedBuffersLocked() {
     empty_zsl_buffers_.pop_back();
     buffers_.erase(std::find(buffers_.begin(), buffers_.end(), buffer));
   }
+  UpdateTrackedBytesLocked();
 
   if (kMemoryProfilingEnabled) {
     ALOGI(
@@ -406,9 +420,59 @@ status_t ZslBufferManager::GetCurrentTimestampNs(int64_t* current_timestamp) {
   return OK;
 }
 
+bool ZslBufferManager::IsSettled(const HalCameraMetadata& metadata) {
+  // Buffers without a state are not rejected.
+  camera_metadata_ro_entry entry = {};
+  if (metadata.Get(ANDROID_CONTROL_AE_STATE, &entry) == OK &&
+      entry.count == 1 &&
+      entry.data.u8[0] != ANDROID_CONTROL_AE_STATE_CONVERGED &&
+      entry.data.u8[0] != ANDROID_CONTROL_AE_STATE_LOCKED) {
+    return false;
+  }
+  if (metadata.Get(ANDROID_CONTROL_AF_STATE, &entry) == OK &&
+      entry.count == 1 &&
+      (entry.data.u8[0] == ANDROID_CONTROL_AF_STATE_PASSIVE_SCAN ||
+       entry.data.u8[0] == ANDROID_CONTROL_AF_STATE_ACTIVE_SCAN)) {
+    return false;
+  }
+  if (metadata.Get(ANDROID_LENS_STATE, &entry) == OK && entry.count == 1 &&
+      entry.data.u8[0] == ANDROID_LENS_STATE_MOVING) {
+    return false;
+  }
+  return true;
+}
+
+void ZslBufferManager::GetSettledZslBuffersLocked(
+    std::vector<ZslBuffer>* zsl_buffers, uint32_t num_buffers,
+    int64_t min_timestamp) {
+  std::vector<uint32_t> frame_numbers;
+  for (auto iter = filled_zsl_buffers_.rbegin();
+       iter != filled_zsl_buffers_.rend() && frame_numbers.size() < num_buffers;
+       iter++) {
+    const HalCameraMetadata* metadata = iter->second.metadata.get();
+    camera_metadata_ro_entry entry = {};
+    if (metadata == nullptr ||
+        metadata->Get(ANDROID_SENSOR_TIMESTAMP, &entry) != OK ||
+        entry.count != 1 || entry.data.i64[0] <= min_timestamp) {
+      // The remaining buffers are older.
+      break;
+    }
+    if (IsSettled(*metadata)) {
+      frame_numbers.push_back(iter->first);
+    }
+  }
+
+  for (auto frame_number = frame_numbers.rbegin();
+       frame_number != frame_numbers.rend(); frame_number++) {
+    auto zsl_buffer_iter = filled_zsl_buffers_.find(*frame_number);
+    zsl_buffers->push_back(std::move(zsl_buffer_iter->second));
+    filled_zsl_buffers_.erase(zsl_buffer_iter);
+  }
+}
+
 void ZslBufferManager::GetMostRecentZslBuffers(
     std::vector<ZslBuffer>* zsl_buffers, uint32_t num_buffers,
-    uint32_t min_buffers) {
+    uint32_t min_buffers, SelectionPolicy policy) {
   ATRACE_CALL();
   if (zsl_buffers == nullptr) {
     return;
@@ -458,6 +522,16 @@ void ZslBufferManager::GetMostRecentZslBuffers(
     }
   }
 
+  if (policy == SelectionPolicy::kSettled) {
+    GetSettledZslBuffersLocked(zsl_buffers, num_buffers,
+                               current_timestamp - kMaxBufferTimestampDiff);
+    if (!zsl_buffers->empty()) {
+      return;
+    }
+    ALOGD("%s: No settled ZSL buffer, using the most recent ones.",
+          __FUNCTION__);
+  }
+
   for (uint32_t i = 0; i < num_buffers; i++) {
     camera_metadata_ro_entry entry = {};
     int64_t buffer_timestamp;
@@ -505,9 +579,16 @@ bool ZslBufferManager::IsPendingBufferEmpty() {
   return true;
 }
 
-void ZslBufferManager::AddPendingBuffers(const std::vector<ZslBuffer>& buffers) {
+uint32_t ZslBufferManager::GetPendingRequestCount() {
+  std::lock_guard<std::mutex> lock(pending_zsl_buffers_mutex);
+  return pending_zsl_buffers_.size();
+}
+
+void ZslBufferManager::AddPendingBuffers(
+    uint32_t frame_number, const std::vector<ZslBuffer>& buffers) {
   ATRACE_CALL();
   std::lock_guard<std::mutex> lock(pending_zsl_buffers_mutex);
+  auto& pending_buffers = pending_zsl_buffers_[frame_number];
   for (auto& buffer : buffers) {
     ZslBuffer zsl_buffer = {
         .frame_number = buffer.frame_number,
@@ -515,8 +596,30 @@ void ZslBufferManager::AddPendingBuffers(const std::vector<ZslBuffer>& buffers)
         .metadata = HalCameraMetadata::Clone(buffer.metadata.get()),
     };
 
-    pending_zsl_buffers_.emplace(buffer.buffer.buffer, std::move(zsl_buffer));
+    pending_buffers.push_back(std::move(zsl_buffer));
+  }
+}
+
+status_t ZslBufferManager::CleanPendingBuffers(
+    uint32_t frame_number, std::vector<ZslBuffer>* buffers) {
+  ATRACE_CALL();
+  if (buffers == nullptr) {
+    ALOGE("%s: buffers is nullptr", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  std::lock_guard<std::mutex> lock(pending_zsl_buffers_mutex);
+  auto pending_buffers = pending_zsl_buffers_.find(frame_number);
+  if (pending_buffers == pending_zsl_buffers_.end()) {
+    return NAME_NOT_FOUND;
   }
+
+  for (auto& zsl_buffer : pending_buffers->second) {
+    buffers->push_back(std::move(zsl_buffer));
+  }
+
+  pending_zsl_buffers_.erase(pending_buffers);
+  return OK;
 }
 
 status_t ZslBufferManager::CleanPendingBuffers(std::vector<ZslBuffer>* buffers) {
@@ -532,9 +635,10 @@ status_t ZslBufferManager::CleanPendingBuffers(std::vector<ZslBuffer>* buffers)
     return BAD_VALUE;
   }
 
-  for (auto zsl_buffer_iter = pending_zsl_buffers_.begin();
-       zsl_buffer_iter != pending_zsl_buffers_.end(); zsl_buffer_iter++) {
-    buffers->push_back(std::move(zsl_buffer_iter->second));
+  for (auto& [frame_number, pending_buffers] : pending_zsl_buffers_) {
+    for (auto& zsl_buffer : pending_buffers) {
+      buffers->push_back(std::move(zsl_buffer));
+    }
   }
 
   pending_zsl_buffers_.clear();
@@ -26,8 +26,9 @@
 #include <mutex>
 #include <vector>
 
-#include "gralloc_buffer_allocator.h"
+#include "caching_buffer_allocator.h"
 #include "hal_buffer_allocator.h"
+#include "memory_tracker.h"
 
 #include "hal_types.h"
 
@@ -38,9 +39,12 @@ namespace google_camera_hal {
 class ZslBufferManager {
  public:
   // allocator will be used to allocate buffers. If allocator is nullptr,
-  // GrallocBufferAllocator will be used to allocate buffers.
-  ZslBufferManager(IHalBufferAllocator* allocator = nullptr,
-                   int partial_result_count = 1);
+  // the shared gralloc CachingBufferAllocator will be used to allocate
+  // buffers. The buffers are reported to MemoryTracker in memory_category,
+  // for the memory session of the calling thread.
+  ZslBufferManager(
+      IHalBufferAllocator* allocator = nullptr, int partial_result_count = 1,
+      MemoryCategory memory_category = MemoryCategory::kZslBuffer);
   virtual ~ZslBufferManager();
 
   // Defines a ZSL buffer.
@@ -78,6 +82,16 @@ class ZslBufferManager {
   status_t ReturnMetadata(uint32_t frame_number,
                           const HalCameraMetadata* metadata, int partial_result);
 
+  // Defines how ZSL buffers are picked for a request.
+  enum class SelectionPolicy {
+    // The most recent buffers.
+    kMostRecent,
+    // The most recent buffers captured with AE converged or locked, AF not
+    // scanning and the lens not moving. Falls back to kMostRecent if no
+    // recent buffer is settled.
+    kSettled,
+  };
+
   // Get a number of the most recent ZSL buffers.
   // If numBuffers is larger than available ZSL buffers,
   // zslBuffers will contain all available ZSL buffers,
@@ -88,8 +102,11 @@ class ZslBufferManager {
   // zsl buffer manager should return. If this can not be satisfied
   // (i.e. not enough ZSL buffers exist),
   // this GetMostRecentZslBuffers returns an empty vector.
-  void GetMostRecentZslBuffers(std::vector<ZslBuffer>* zsl_buffers,
-                               uint32_t num_buffers, uint32_t min_buffers);
+  // The buffers are ordered from the oldest to the newest.
+  void GetMostRecentZslBuffers(
+      std::vector<ZslBuffer>* zsl_buffers, uint32_t num_buffers,
+      uint32_t min_buffers,
+      SelectionPolicy policy = SelectionPolicy::kMostRecent);
 
   // Return a ZSL buffer that was previously obtained by
   // GetMostRecentZslBuffers().
@@ -107,10 +124,21 @@ class ZslBufferManager {
   // Check pending_zsl_buffers_ is empty or not.
   bool IsPendingBufferEmpty();
 
-  // Add buffer map to pending_zsl_buffers_
-  void AddPendingBuffers(const std::vector<ZslBuffer>& buffers);
+  // Get the number of requests holding pending buffers.
+  uint32_t GetPendingRequestCount();
+
+  // Add buffers used as input by request frame_number to
+  // pending_zsl_buffers_.
+  void AddPendingBuffers(uint32_t frame_number,
+                         const std::vector<ZslBuffer>& buffers);
 
-  // Clean buffer map from pending_zsl_buffers_
+  // Clean the pending buffers of request frame_number from
+  // pending_zsl_buffers_. Returns NAME_NOT_FOUND if the request has no
+  // pending buffers.
+  status_t CleanPendingBuffers(uint32_t frame_number,
+                               std::vector<ZslBuffer>* buffers);
+
+  // Clean the pending buffers of all requests from pending_zsl_buffers_.
   status_t CleanPendingBuffers(std::vector<ZslBuffer>* buffers);
 
  private:
@@ -131,6 +159,15 @@ class ZslBufferManager {
 
   const bool kMemoryProfilingEnabled;
 
+  // Return if 3A and the lens were settled when the buffer was captured.
+  static bool IsSettled(const HalCameraMetadata& metadata);
+
+  // Move the num_buffers most recent settled buffers captured after
+  // min_timestamp to zsl_buffers. Must be protected by zsl_buffers_lock_.
+  void GetSettledZslBuffersLocked(std::vector<ZslBuffer>* zsl_buffers,
+                                  uint32_t num_buffers,
+                                  int64_t min_timestamp);
+
   // Remove the oldest metadata.
   status_t RemoveOldestMetadataLocked();
 
@@ -146,12 +183,13 @@ class ZslBufferManager {
   // Try to free unused buffers. Must be protected by zsl_buffers_lock_.
   void FreeUnusedBuffersLocked();
 
+  // Report the size change of buffers_ to MemoryTracker. Must be protected by
+  // zsl_buffers_lock_.
+  void UpdateTrackedBytesLocked();
+
   bool allocated_ = false;
   std::mutex zsl_buffers_lock_;
 
-  // Buffer manager for allocating the buffers. Protected by mZslBuffersLock.
-  std::unique_ptr<IHalBufferAllocator> internal_buffer_allocator_;
-
   // external buffer allocator
   IHalBufferAllocator* buffer_allocator_ = nullptr;
 
@@ -175,8 +213,9 @@ class ZslBufferManager {
 
   std::mutex pending_zsl_buffers_mutex;
 
-  // Map from buffer handle to ZSL buffer. Protected by pending_zsl_buffers_mutex.
-  std::unordered_map<buffer_handle_t, ZslBuffer> pending_zsl_buffers_;
+  // Map from request frame number to the ZSL buffers the request uses as
+  // input. Protected by pending_zsl_buffers_mutex.
+  std::map<uint32_t, std::vector<ZslBuffer>> pending_zsl_buffers_;
 
   // Store the buffer descriptor when call AllocateBuffers()
   // Use it for AllocateExtraBuffers()
@@ -187,6 +226,12 @@ class ZslBufferManager {
 
   // Partial result count reported by camera HAL
   int partial_result_count_ = 1;
+
+  const MemoryCategory memory_category_;
+  const uint32_t memory_session_;
+  // Size of buffers_ reported to MemoryTracker. Protected by
+  // zsl_buffers_lock_.
+  int64_t tracked_bytes_ = 0;
 };
 
 }  // namespace google_camera_hal
@@ -102,15 +102,12 @@ void GoogSensorEnvironment::GetLatestNSensorEvents(
   if (num_sample < 0) {
     return;
   }
-  std::lock_guard<std::mutex> l(event_buffer_lock_);
-  int start_index =
-      std::max(0, static_cast<int>(event_buffer_.size()) - num_sample);
-  auto event = event_buffer_.begin();
-  std::advance(event, start_index);
-  for (; event != event_buffer_.end(); ++event) {
-    event_timestamps->push_back(event->sensor_event.timestamp);
-    event_data->push_back(event->sensor_event.u.scalar);
-    event_arrival_timestamps->push_back(event->event_arrival_time_ns);
+  std::vector<ExtendedSensorEvent> events;
+  GetBufferedEvents(num_sample, &events);
+  for (const auto& event : events) {
+    event_timestamps->push_back(event.sensor_event.timestamp);
+    event_data->push_back(event.sensor_event.u.scalar);
+    event_arrival_timestamps->push_back(event.event_arrival_time_ns);
     if (event_arrival_timestamps->size() >= num_sample) {
       break;
     }
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "goog_sensor_event_ring"
+
+#include "goog_sensor_event_ring.h"
+
+#include <algorithm>
+
+#include "utils/Log.h"
+
+namespace android {
+namespace camera_sensor_listener {
+
+std::unique_ptr<GoogSensorEventRing> GoogSensorEventRing::Create(
+    size_t capacity) {
+  if (capacity == 0) {
+    ALOGE("%s %d capacity must be greater than 0.", __func__, __LINE__);
+    return nullptr;
+  }
+
+  size_t rounded_capacity = 1;
+  while (rounded_capacity < capacity) {
+    rounded_capacity <<= 1;
+  }
+
+  return std::unique_ptr<GoogSensorEventRing>(
+      new GoogSensorEventRing(rounded_capacity));
+}
+
+GoogSensorEventRing::GoogSensorEventRing(size_t capacity)
+    : capacity_(capacity),
+      mask_(capacity - 1),
+      slots_(std::make_unique<Slot[]>(capacity)) {
+}
+
+void GoogSensorEventRing::Publish(const ExtendedSensorEvent& event) {
+  uint64_t sequence = head_.load(std::memory_order_relaxed);
+  Slot& slot = slots_[sequence & mask_];
+
+  // Mark the slot as being written before touching the payload so readers
+  // copying the previous occupant notice the overwrite.
+  slot.version.store(2 * sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.event = event;
+  slot.version.store(2 * sequence + 2, std::memory_order_release);
+
+  head_.store(sequence + 1, std::memory_order_release);
+}
+
+GoogSensorEventRing::Cursor GoogSensorEventRing::CreateCursor(
+    size_t num_latest) const {
+  uint64_t head = head_.load(std::memory_order_acquire);
+  uint64_t available = std::min<uint64_t>(head, capacity_);
+  return Cursor{.next_sequence =
+                    head - std::min<uint64_t>(num_latest, available)};
+}
+
+bool GoogSensorEventRing::ReadSlot(uint64_t sequence,
+                                   ExtendedSensorEvent* event) const {
+  const Slot& slot = slots_[sequence & mask_];
+  const uint64_t expected_version = 2 * sequence + 2;
+  if (slot.version.load(std::memory_order_acquire) != expected_version) {
+    return false;
+  }
+
+  *event = slot.event;
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.version.load(std::memory_order_relaxed) == expected_version;
+}
+
+size_t GoogSensorEventRing::Read(Cursor* cursor, size_t max_events,
+                                 std::vector<ExtendedSensorEvent>* events,
+                                 size_t* dropped) const {
+  if (cursor == nullptr || events == nullptr) {
+    ALOGE("%s %d cursor or events is nullptr.", __func__, __LINE__);
+    return 0;
+  }
+
+  size_t num_dropped = 0;
+  uint64_t head = head_.load(std::memory_order_acquire);
+  if (head - cursor->next_sequence > capacity_) {
+    num_dropped += head - capacity_ - cursor->next_sequence;
+    cursor->next_sequence = head - capacity_;
+  }
+
+  size_t num_read = 0;
+  ExtendedSensorEvent event;
+  while (cursor->next_sequence < head && num_read < max_events) {
+    if (ReadSlot(cursor->next_sequence, &event)) {
+      events->push_back(event);
+      num_read++;
+    } else {
+      // The producer lapped this reader while it was copying.
+      num_dropped++;
+    }
+    cursor->next_sequence++;
+  }
+
+  if (dropped != nullptr) {
+    *dropped = num_dropped;
+  }
+  return num_read;
+}
+
+}  // namespace camera_sensor_listener
+}  // namespace android
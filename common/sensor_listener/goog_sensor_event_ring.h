@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VENDOR_GOOGLE_CAMERA_SENSOR_LISTENER_GOOG_SENSOR_EVENT_RING_H_
+#define VENDOR_GOOGLE_CAMERA_SENSOR_LISTENER_GOOG_SENSOR_EVENT_RING_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "goog_sensor_wrapper.h"
+
+namespace android {
+namespace camera_sensor_listener {
+
+// Single-producer, multi-reader ring of sensor events.
+// The producer (the sensor hub callback thread) publishes events without
+// taking any lock. Readers keep their own Cursor and copy events out of the
+// ring; every slot carries a sequence number so a reader detects slots that
+// were overwritten while it was copying them. A reader that falls more than
+// capacity events behind skips ahead and reports the number of events it
+// missed.
+// Sample usage:
+//   GoogSensorEventRing::Cursor cursor = ring->CreateCursor();
+//   std::vector<ExtendedSensorEvent> events;
+//   size_t dropped = 0;
+//   ring->Read(&cursor, /*max_events=*/16, &events, &dropped);
+class GoogSensorEventRing {
+ public:
+  // Position of a reader in the ring. Cursors are owned by readers and must
+  // not be shared between threads.
+  struct Cursor {
+    // Sequence number of the next event to read.
+    uint64_t next_sequence = 0;
+  };
+
+  // Create a ring holding the latest capacity events. capacity is rounded up
+  // to the next power of two. Returns nullptr if capacity is 0.
+  static std::unique_ptr<GoogSensorEventRing> Create(size_t capacity);
+
+  // Publish an event. Must only be called from the producer thread.
+  void Publish(const ExtendedSensorEvent& event);
+
+  // Return a cursor positioned num_latest events before the latest published
+  // event, i.e. the reader will see those events and the ones published from
+  // now on. num_latest is limited to the events still in the ring.
+  Cursor CreateCursor(size_t num_latest = 0) const;
+
+  // Copy up to max_events events after cursor into events (appended, oldest
+  // first) and advance the cursor. dropped is optional and returns the number
+  // of events that were overwritten before this reader could copy them.
+  // Returns the number of events appended.
+  size_t Read(Cursor* cursor, size_t max_events,
+              std::vector<ExtendedSensorEvent>* events,
+              size_t* dropped = nullptr) const;
+
+  // Number of events published since the ring was created.
+  uint64_t GetPublishedCount() const {
+    return head_.load(std::memory_order_acquire);
+  }
+
+  size_t GetCapacity() const {
+    return capacity_;
+  }
+
+ private:
+  struct Slot {
+    // 2 * sequence + 1 while the slot is being written, 2 * sequence + 2 once
+    // the event with that sequence number is complete.
+    std::atomic<uint64_t> version{0};
+    ExtendedSensorEvent event;
+  };
+
+  explicit GoogSensorEventRing(size_t capacity);
+
+  // Copy the event with the given sequence into event. Returns false if the
+  // slot no longer (or not yet) holds that sequence.
+  bool ReadSlot(uint64_t sequence, ExtendedSensorEvent* event) const;
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+
+  // Sequence number of the next event to publish.
+  std::atomic<uint64_t> head_{0};
+};
+
+}  // namespace camera_sensor_listener
+}  // namespace android
+
+#endif  // VENDOR_GOOGLE_CAMERA_SENSOR_LISTENER_GOOG_SENSOR_EVENT_RING_H_
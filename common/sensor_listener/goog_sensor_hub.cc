@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "goog_sensor_hub"
+
+#include "goog_sensor_hub.h"
+
+#include <inttypes.h>
+#include <utils/Log.h>
+#include <utils/SystemClock.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace android {
+namespace camera_sensor_listener {
+namespace {
+
+using ::android::frameworks::sensorservice::V1_0::IEventQueue;
+using ::android::frameworks::sensorservice::V1_0::IEventQueueCallback;
+using ::android::frameworks::sensorservice::V1_0::ISensorManager;
+using ::android::frameworks::sensorservice::V1_0::Result;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::android::hardware::sensors::V1_0::Event;
+using ::android::hardware::sensors::V1_0::SensorType;
+
+// Events whose timestamps are within this fraction of a subscriber's sampling
+// period are still delivered when decimating, to tolerate sensor jitter.
+constexpr int64_t kDecimationTolerancePercent = 10;
+
+class HubEventQueueCallback : public IEventQueueCallback {
+ public:
+  explicit HubEventQueueCallback(std::function<void(const Event&)> callback)
+      : callback_(std::move(callback)) {
+  }
+
+  Return<void> onEvent(const Event& e) override {
+    callback_(e);
+    return Void();
+  }
+
+ private:
+  const std::function<void(const Event&)> callback_;
+};
+
+// SensorEventSource backed by a single sensor service event queue shared by
+// all sensors of the process.
+class SensorServiceEventSource : public SensorEventSource {
+ public:
+  status_t Initialize(std::function<void(const Event&)> event_callback) override {
+    sp<ISensorManager> manager = ISensorManager::getService();
+    if (manager == nullptr) {
+      ALOGE("%s %d Cannot get ISensorManager", __func__, __LINE__);
+      return INVALID_OPERATION;
+    }
+
+    manager->createEventQueue(
+        new HubEventQueueCallback(std::move(event_callback)),
+        [this](const auto& q, auto result) {
+          if (result != Result::OK) {
+            ALOGE("%s %d Cannot create event queue", __func__, __LINE__);
+            return;
+          }
+          event_queue_ = q;
+        });
+
+    return event_queue_ == nullptr ? INVALID_OPERATION : OK;
+  }
+
+  status_t EnableSensor(int32_t sensor_handle,
+                        int64_t sampling_period_us) override {
+    Return<Result> result =
+        event_queue_->enableSensor(sensor_handle, sampling_period_us, 0);
+    if (!result.isOk()) {
+      ALOGE("%s %d enable sensor Hidl call failed: %s", __func__, __LINE__,
+            result.description().c_str());
+      return UNKNOWN_ERROR;
+    }
+    if (result != Result::OK) {
+      ALOGE("%s %d enable sensor %s failed.", __func__, __LINE__,
+            toString(result).c_str());
+      return UNKNOWN_ERROR;
+    }
+    return OK;
+  }
+
+  status_t DisableSensor(int32_t sensor_handle) override {
+    Return<Result> result = event_queue_->disableSensor(sensor_handle);
+    if (!result.isOk()) {
+      ALOGE("%s %d disable sensor Hidl call failed: %s", __func__, __LINE__,
+            result.description().c_str());
+      return UNKNOWN_ERROR;
+    }
+    if (result != Result::OK) {
+      ALOGE("%s %d disable sensor %s failed.", __func__, __LINE__,
+            toString(result).c_str());
+      return UNKNOWN_ERROR;
+    }
+    return OK;
+  }
+
+ private:
+  sp<IEventQueue> event_queue_;
+};
+
+}  // namespace
+
+GoogSensorHub* GoogSensorHub::GetInstance() {
+  // Intentionally leaked: sensor service callbacks may race with static
+  // destruction at process exit.
+  static GoogSensorHub* hub =
+      new GoogSensorHub(std::make_unique<SensorServiceEventSource>());
+  return hub;
+}
+
+std::unique_ptr<GoogSensorHub> GoogSensorHub::Create(
+    std::unique_ptr<SensorEventSource> source) {
+  if (source == nullptr) {
+    ALOGE("%s %d source is nullptr.", __func__, __LINE__);
+    return nullptr;
+  }
+  return std::unique_ptr<GoogSensorHub>(new GoogSensorHub(std::move(source)));
+}
+
+GoogSensorHub::GoogSensorHub(std::unique_ptr<SensorEventSource> source)
+    : source_(std::move(source)),
+      channels_(std::make_shared<const ChannelMap>()) {
+}
+
+GoogSensorHub::~GoogSensorHub() {
+  std::lock_guard<std::mutex> lock(hub_lock_);
+  for (auto& [sensor_handle, period_us] : enabled_sampling_periods_us_) {
+    source_->DisableSensor(sensor_handle);
+  }
+  enabled_sampling_periods_us_.clear();
+}
+
+std::shared_ptr<const GoogSensorHub::ChannelMap> GoogSensorHub::GetChannels()
+    const {
+  std::lock_guard<std::mutex> lock(snapshot_lock_);
+  return channels_;
+}
+
+void GoogSensorHub::SetChannels(std::shared_ptr<const ChannelMap> channels) {
+  std::lock_guard<std::mutex> lock(snapshot_lock_);
+  channels_ = std::move(channels);
+}
+
+status_t GoogSensorHub::Subscribe(int32_t sensor_handle,
+                                  int64_t sampling_period_us,
+                                  EventListener listener,
+                                  SubscriptionId* subscription_id) {
+  if (sensor_handle < 0 || sampling_period_us < 0 ||
+      subscription_id == nullptr) {
+    ALOGE("%s %d invalid sensor handle %d or sampling period %" PRId64,
+          __func__, __LINE__, sensor_handle, sampling_period_us);
+    return BAD_VALUE;
+  }
+
+  std::lock_guard<std::mutex> lock(hub_lock_);
+  if (!initialized_) {
+    status_t res = source_->Initialize(
+        [this](const Event& event) { OnEvent(event); });
+    if (res != OK) {
+      ALOGE("%s %d initializing event source failed: %s(%d)", __func__,
+            __LINE__, strerror(-res), res);
+      return res;
+    }
+    initialized_ = true;
+  }
+
+  auto subscriber = std::make_shared<Subscriber>();
+  subscriber->id = next_subscription_id_++;
+  subscriber->listener = std::move(listener);
+  subscriber->sampling_period_us = sampling_period_us;
+
+  std::shared_ptr<const ChannelMap> channels = GetChannels();
+  auto new_channel = std::make_shared<SensorChannel>();
+  auto channel_it = channels->find(sensor_handle);
+  if (channel_it != channels->end()) {
+    *new_channel = *channel_it->second;
+  }
+  new_channel->subscribers.push_back(subscriber);
+
+  // Publish the channel before enabling the sensor so the first events are
+  // not dropped.
+  auto new_channels = std::make_shared<ChannelMap>(*channels);
+  (*new_channels)[sensor_handle] = new_channel;
+  SetChannels(std::move(new_channels));
+
+  status_t res = UpdateSensorLocked(sensor_handle, *new_channel);
+  if (res != OK) {
+    ALOGE("%s %d enabling sensor %d failed: %s(%d)", __func__, __LINE__,
+          sensor_handle, strerror(-res), res);
+    subscriber->active = false;
+    SetChannels(std::move(channels));
+    return res;
+  }
+
+  subscription_handles_[subscriber->id] = sensor_handle;
+  *subscription_id = subscriber->id;
+  return OK;
+}
+
+status_t GoogSensorHub::Unsubscribe(SubscriptionId subscription_id) {
+  std::lock_guard<std::mutex> lock(hub_lock_);
+  auto handle_it = subscription_handles_.find(subscription_id);
+  if (handle_it == subscription_handles_.end()) {
+    ALOGE("%s %d subscription %u not found.", __func__, __LINE__,
+          subscription_id);
+    return BAD_VALUE;
+  }
+  int32_t sensor_handle = handle_it->second;
+  subscription_handles_.erase(handle_it);
+
+  std::shared_ptr<const ChannelMap> channels = GetChannels();
+  auto channel_it = channels->find(sensor_handle);
+  if (channel_it == channels->end()) {
+    ALOGE("%s %d sensor %d has no channel.", __func__, __LINE__,
+          sensor_handle);
+    return UNKNOWN_ERROR;
+  }
+
+  auto new_channel = std::make_shared<SensorChannel>(*channel_it->second);
+  auto& subscribers = new_channel->subscribers;
+  for (auto it = subscribers.begin(); it != subscribers.end(); it++) {
+    if ((*it)->id == subscription_id) {
+      (*it)->active = false;
+      subscribers.erase(it);
+      break;
+    }
+  }
+
+  status_t res = UpdateSensorLocked(sensor_handle, *new_channel);
+  if (res != OK) {
+    ALOGW("%s %d updating sensor %d failed: %s(%d)", __func__, __LINE__,
+          sensor_handle, strerror(-res), res);
+  }
+
+  auto new_channels = std::make_shared<ChannelMap>(*channels);
+  if (subscribers.empty()) {
+    new_channels->erase(sensor_handle);
+  } else {
+    (*new_channels)[sensor_handle] = std::move(new_channel);
+  }
+  SetChannels(std::move(new_channels));
+  return OK;
+}
+
+status_t GoogSensorHub::UpdateSensorLocked(int32_t sensor_handle,
+                                           const SensorChannel& channel) {
+  auto enabled_it = enabled_sampling_periods_us_.find(sensor_handle);
+  if (channel.subscribers.empty()) {
+    if (enabled_it == enabled_sampling_periods_us_.end()) {
+      return OK;
+    }
+    enabled_sampling_periods_us_.erase(enabled_it);
+    return source_->DisableSensor(sensor_handle);
+  }
+
+  int64_t sampling_period_us = std::numeric_limits<int64_t>::max();
+  for (auto& subscriber : channel.subscribers) {
+    sampling_period_us =
+        std::min(sampling_period_us, subscriber->sampling_period_us);
+  }
+
+  if (enabled_it != enabled_sampling_periods_us_.end() &&
+      enabled_it->second == sampling_period_us) {
+    return OK;
+  }
+
+  status_t res = source_->EnableSensor(sensor_handle, sampling_period_us);
+  if (res != OK) {
+    return res;
+  }
+  enabled_sampling_periods_us_[sensor_handle] = sampling_period_us;
+  return OK;
+}
+
+void GoogSensorHub::OnEvent(const Event& e) {
+  if (e.sensorType == SensorType::ADDITIONAL_INFO) {
+    return;
+  }
+
+  std::shared_ptr<const ChannelMap> channels = GetChannels();
+  auto channel_it = channels->find(e.sensorHandle);
+  if (channel_it == channels->end()) {
+    return;
+  }
+  const SensorChannel& channel = *channel_it->second;
+
+  ExtendedSensorEvent event;
+  memset(&event, 0, sizeof(event));
+  event.sensor_event = e;
+  event.event_arrival_time_ns = elapsedRealtimeNano();
+
+  for (auto& subscriber : channel.subscribers) {
+    if (!subscriber->active.load(std::memory_order_relaxed)) {
+      continue;
+    }
+    // Decimate for subscribers that asked for a longer sampling period than
+    // the sensor is enabled at.
+    int64_t min_interval_ns = subscriber->sampling_period_us * 1000 *
+                              (100 - kDecimationTolerancePercent) / 100;
+    if (subscriber->last_delivered_timestamp_ns != 0 &&
+        e.timestamp - subscriber->last_delivered_timestamp_ns <
+            min_interval_ns) {
+      continue;
+    }
+    subscriber->last_delivered_timestamp_ns = e.timestamp;
+    if (subscriber->listener != nullptr) {
+      subscriber->listener(event);
+    }
+  }
+}
+
+}  // namespace camera_sensor_listener
+}  // namespace android
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VENDOR_GOOGLE_CAMERA_SENSOR_LISTENER_GOOG_SENSOR_HUB_H_
+#define VENDOR_GOOGLE_CAMERA_SENSOR_LISTENER_GOOG_SENSOR_HUB_H_
+
+#include <android-base/thread_annotations.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "goog_sensor_wrapper.h"
+
+namespace android {
+namespace camera_sensor_listener {
+
+// Source of raw sensor events for GoogSensorHub. The default source is backed
+// by ISensorManager; tests provide a fake source to drive the hub on Linux
+// without a sensor service.
+class SensorEventSource {
+ public:
+  virtual ~SensorEventSource() = default;
+
+  // Set the callback invoked for every event of every enabled sensor. Events
+  // must be delivered from a single thread. Called once before any sensor is
+  // enabled.
+  virtual status_t Initialize(
+      std::function<void(const ::android::hardware::sensors::V1_0::Event&)>
+          event_callback) = 0;
+
+  // Enable the sensor, or update its sampling period if already enabled.
+  virtual status_t EnableSensor(int32_t sensor_handle,
+                                int64_t sampling_period_us) = 0;
+
+  // Disable the sensor. Once every enabled sensor is disabled, the source
+  // must not invoke the event callback anymore.
+  virtual status_t DisableSensor(int32_t sensor_handle) = 0;
+};
+
+// Process-wide sensor hub.
+// All sensor listeners in the process subscribe through the hub, which keeps
+// a single sensor service subscription per sensor handle regardless of how
+// many cameras or sessions listen to it. Each sensor's events are fanned out
+// to subscribed listeners from an immutable snapshot, so the event path never
+// waits for subscription changes. Listeners buffer the events they need, e.g.
+// GoogSensorWrapper in its GoogSensorEventRing.
+// The sensor is enabled at the smallest sampling period requested by its
+// subscribers; listeners that asked for a longer period receive a decimated
+// stream.
+class GoogSensorHub {
+ public:
+  using SubscriptionId = uint32_t;
+  using EventListener = std::function<void(const ExtendedSensorEvent& event)>;
+
+  // Return the process-wide hub backed by the sensor service.
+  static GoogSensorHub* GetInstance();
+
+  // Create a standalone hub backed by source. Used by tests.
+  static std::unique_ptr<GoogSensorHub> Create(
+      std::unique_ptr<SensorEventSource> source);
+
+  virtual ~GoogSensorHub();
+
+  // Subscribe listener to the sensor with sensor_handle. The sensor is
+  // enabled on the first subscription. listener is invoked from the source's
+  // callback thread and must not call back into the hub.
+  status_t Subscribe(int32_t sensor_handle, int64_t sampling_period_us,
+                     EventListener listener, SubscriptionId* subscription_id);
+
+  // Remove a subscription. The sensor is disabled when its last subscription
+  // is removed. The listener is not invoked for events arriving after this
+  // returns, but an event already being dispatched may still reach it.
+  status_t Unsubscribe(SubscriptionId subscription_id);
+
+ protected:
+  explicit GoogSensorHub(std::unique_ptr<SensorEventSource> source);
+
+ private:
+  struct Subscriber {
+    SubscriptionId id = 0;
+    EventListener listener;
+    int64_t sampling_period_us = 0;
+    // Cleared on Unsubscribe so in-flight snapshots stop delivering.
+    std::atomic<bool> active = true;
+    // Only accessed from the source callback thread.
+    int64_t last_delivered_timestamp_ns = 0;
+  };
+
+  // Immutable view of one sensor; replaced whenever its subscribers change.
+  struct SensorChannel {
+    std::vector<std::shared_ptr<Subscriber>> subscribers;
+  };
+
+  using ChannelMap =
+      std::unordered_map<int32_t, std::shared_ptr<const SensorChannel>>;
+
+  // Enable the sensor at the smallest sampling period requested by the
+  // subscribers of channel, or disable it if channel has no subscriber.
+  status_t UpdateSensorLocked(int32_t sensor_handle,
+                              const SensorChannel& channel)
+      EXCLUSIVE_LOCKS_REQUIRED(hub_lock_);
+
+  // Invoked by source_ for every event.
+  void OnEvent(const ::android::hardware::sensors::V1_0::Event& event);
+
+  std::shared_ptr<const ChannelMap> GetChannels() const;
+  void SetChannels(std::shared_ptr<const ChannelMap> channels);
+
+  const std::unique_ptr<SensorEventSource> source_;
+
+  // Serializes Subscribe/Unsubscribe.
+  std::mutex hub_lock_;
+  bool initialized_ GUARDED_BY(hub_lock_) = false;
+  SubscriptionId next_subscription_id_ GUARDED_BY(hub_lock_) = 1;
+  // Map from subscription id to sensor handle.
+  std::unordered_map<SubscriptionId, int32_t> subscription_handles_
+      GUARDED_BY(hub_lock_);
+  // Map from sensor handle to the sampling period it is enabled at.
+  std::unordered_map<int32_t, int64_t> enabled_sampling_periods_us_
+      GUARDED_BY(hub_lock_);
+
+  // Copy-on-write snapshot of all channels. Writers hold hub_lock_ and swap
+  // the pointer; the event path only copies the pointer under snapshot_lock_.
+  mutable std::mutex snapshot_lock_;
+  std::shared_ptr<const ChannelMap> channels_ GUARDED_BY(snapshot_lock_);
+};
+
+}  // namespace camera_sensor_listener
+}  // namespace android
+
+#endif  // VENDOR_GOOGLE_CAMERA_SENSOR_LISTENER_GOOG_SENSOR_HUB_H_
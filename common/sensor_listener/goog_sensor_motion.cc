@@ -121,17 +121,14 @@ void GoogSensorMotion::GetLatestNSensorEvents(
   if (num_sample < 0) {
     return;
   }
-  std::lock_guard<std::mutex> l(event_buffer_lock_);
-  int start_index =
-      std::max(0, static_cast<int>(event_buffer_.size()) - num_sample);
-  auto event = event_buffer_.begin();
-  std::advance(event, start_index);
-  for (; event != event_buffer_.end(); ++event) {
-    event_timestamps->push_back(event->sensor_event.timestamp);
-    motion_vector_x->push_back(event->sensor_event.u.vec3.x);
-    motion_vector_y->push_back(event->sensor_event.u.vec3.y);
-    motion_vector_z->push_back(event->sensor_event.u.vec3.z);
-    event_arrival_timestamps->push_back(event->event_arrival_time_ns);
+  std::vector<ExtendedSensorEvent> events;
+  GetBufferedEvents(num_sample, &events);
+  for (const auto& event : events) {
+    event_timestamps->push_back(event.sensor_event.timestamp);
+    motion_vector_x->push_back(event.sensor_event.u.vec3.x);
+    motion_vector_y->push_back(event.sensor_event.u.vec3.y);
+    motion_vector_z->push_back(event.sensor_event.u.vec3.z);
+    event_arrival_timestamps->push_back(event.event_arrival_time_ns);
   }
 }
 
@@ -146,15 +143,17 @@ void GoogSensorMotion::QuerySensorEventsBetweenTimestamps(
   motion_vector_z->clear();
   event_arrival_timestamps->clear();
 
-  std::lock_guard<std::mutex> l(event_buffer_lock_);
+  std::lock_guard<std::mutex> lock(event_buffer_lock_);
+  std::vector<ExtendedSensorEvent>& events = event_buffer_;
+  GetBufferedEvents(&events);
 
-  event_timestamps->reserve(event_buffer_.size());
-  motion_vector_x->reserve(event_buffer_.size());
-  motion_vector_y->reserve(event_buffer_.size());
-  motion_vector_z->reserve(event_buffer_.size());
-  event_arrival_timestamps->reserve(event_buffer_.size());
+  event_timestamps->reserve(events.size());
+  motion_vector_x->reserve(events.size());
+  motion_vector_y->reserve(events.size());
+  motion_vector_z->reserve(events.size());
+  event_arrival_timestamps->reserve(events.size());
 
-  for (const auto& event : event_buffer_) {
+  for (const auto& event : events) {
     int64_t event_time = event.sensor_event.timestamp;
     if (event_time <= start_time || event_time > end_time) {
       continue;
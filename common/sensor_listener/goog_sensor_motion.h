@@ -17,6 +17,11 @@
 #ifndef VENDOR_GOOGLE_CAMERA_SENSOR_LISTENER_GOOG_SENSOR_MOTION_H_
 #define VENDOR_GOOGLE_CAMERA_SENSOR_LISTENER_GOOG_SENSOR_MOTION_H_
 
+#include <android-base/thread_annotations.h>
+
+#include <mutex>
+#include <vector>
+
 #include "goog_sensor_wrapper.h"
 
 namespace android {
@@ -175,6 +180,12 @@ class GoogSensorMotion : public GoogSensorWrapper {
 
   MotionSensorType motion_sensor_type_;
 
+  // Events of QuerySensorEventsBetweenTimestamps, reused so per-frame queries
+  // don't allocate.
+  mutable std::mutex event_buffer_lock_;
+  mutable std::vector<ExtendedSensorEvent> event_buffer_
+      GUARDED_BY(event_buffer_lock_);
+
   static constexpr size_t kDefaultEventQueueSize = 20;
   static constexpr int64_t kDefaultSamplingPeriodUs = 20000;  // = 50 Hz
   static constexpr int64_t kMinSamplingPeriodUs = 2500;       // = 400 Hz
@@ -24,7 +24,7 @@
 
 #include <algorithm>
 #include <cmath>
-#include <deque>
+#include <vector>
 
 #include "utils/Errors.h"
 #include "utils/Log.h"
@@ -110,16 +110,13 @@ void GoogSensorSync::GetLatestNSamples(
   if (num_sample < 0) {
     return;
   }
-  std::lock_guard<std::mutex> el(event_buffer_lock_);
-  int start_index =
-      std::max(0, static_cast<int>(event_buffer_.size()) - num_sample);
-  auto event = event_buffer_.begin();
-  std::advance(event, start_index);
-  for (; event != event_buffer_.end(); ++event) {
-    latest_n_vsync_timestamps->push_back(event->sensor_event.timestamp);
-    latest_n_arrival_timestamps->push_back(event->event_arrival_time_ns);
+  std::vector<ExtendedSensorEvent> events;
+  GetBufferedEvents(num_sample, &events);
+  for (const auto& event : events) {
+    latest_n_vsync_timestamps->push_back(event.sensor_event.timestamp);
+    latest_n_arrival_timestamps->push_back(event.event_arrival_time_ns);
     int64_t frame_id, boottime_timestamp;
-    ExtractFrameIdAndBoottimeTimestamp(*event, &frame_id, &boottime_timestamp);
+    ExtractFrameIdAndBoottimeTimestamp(event, &frame_id, &boottime_timestamp);
     latest_n_frame_ids->push_back(frame_id);
     latest_n_boottime_timestamps->push_back(boottime_timestamp);
   }
@@ -176,10 +173,12 @@ int64_t GoogSensorSync::SyncTimestamp(int64_t timestamp) {
     return timestamp;
   }
 
-  std::lock_guard<std::mutex> el(event_buffer_lock_);
+  std::lock_guard<std::mutex> lock(event_buffer_lock_);
+  std::vector<ExtendedSensorEvent>& events = event_buffer_;
+  GetBufferedEvents(&events);
   int64_t min_delta = kMaxTimeDriftNs;
   int64_t nearest_sync = timestamp;
-  for (auto event : event_buffer_) {
+  for (const auto& event : events) {
     if (llabs(event.sensor_event.timestamp - timestamp) < min_delta) {
       min_delta = llabs(event.sensor_event.timestamp - timestamp);
       nearest_sync = event.sensor_event.timestamp;
@@ -214,10 +213,12 @@ std::optional<ExtendedSensorEvent> GoogSensorSync::FindNearestEvent(
     ALOGE("%s %d sensor_sync sensor is not enabled", __func__, __LINE__);
     return std::nullopt;
   }
-  std::lock_guard<std::mutex> el(event_buffer_lock_);
+  std::lock_guard<std::mutex> lock(event_buffer_lock_);
+  std::vector<ExtendedSensorEvent>& events = event_buffer_;
+  GetBufferedEvents(&events);
   int64_t min_delta = kMaxTimeDriftNs;
   std::optional<ExtendedSensorEvent> nearest_event;
-  for (auto event : event_buffer_) {
+  for (const auto& event : events) {
     int64_t delta = llabs(event.sensor_event.timestamp - timestamp);
     if (delta < min_delta) {
       min_delta = delta;
@@ -233,8 +234,10 @@ int64_t GoogSensorSync::MatchTimestamp(int64_t timestamp, int64_t frame_id) {
     return timestamp;
   }
 
-  std::lock_guard<std::mutex> el(event_buffer_lock_);
-  for (auto event : event_buffer_) {
+  std::lock_guard<std::mutex> lock(event_buffer_lock_);
+  std::vector<ExtendedSensorEvent>& events = event_buffer_;
+  GetBufferedEvents(&events);
+  for (const auto& event : events) {
     int64_t event_frame_id, event_timestamp;
     ExtractFrameIdAndBoottimeTimestamp(event, &event_frame_id, &event_timestamp);
     if (frame_id == event_frame_id && timestamp == event_timestamp) {
@@ -17,6 +17,11 @@
 #ifndef VENDOR_GOOGLE_CAMERA_SENSOR_LISTENER_GOOG_SENSOR_SYNC_H_
 #define VENDOR_GOOGLE_CAMERA_SENSOR_LISTENER_GOOG_SENSOR_SYNC_H_
 
+#include <android-base/thread_annotations.h>
+
+#include <mutex>
+#include <vector>
+
 #include "goog_sensor_wrapper.h"
 
 namespace android {
@@ -157,6 +162,11 @@ class GoogSensorSync : public GoogSensorWrapper {
 
   // The id of the camera linked to this vsync signal.
   uint8_t cam_id_;
+
+  // Events of the per-frame queries, reused so they don't allocate.
+  std::mutex event_buffer_lock_;
+  std::vector<ExtendedSensorEvent> event_buffer_
+      GUARDED_BY(event_buffer_lock_);
 };
 
 }  // namespace camera_sensor_listener
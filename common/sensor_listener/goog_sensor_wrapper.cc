@@ -28,46 +28,20 @@
 #include <algorithm>
 #include <cmath>
 
+#include "goog_sensor_event_ring.h"
+#include "goog_sensor_hub.h"
 #include "goog_sensor_wrapper.h"
 
 namespace android {
 namespace camera_sensor_listener {
 
-using ::android::frameworks::sensorservice::V1_0::IEventQueue;
-using ::android::frameworks::sensorservice::V1_0::IEventQueueCallback;
-using ::android::frameworks::sensorservice::V1_0::ISensorManager;
-using ::android::frameworks::sensorservice::V1_0::Result;
-using ::android::hardware::Return;
-using ::android::hardware::Void;
-using ::android::hardware::sensors::V1_0::Event;
-using ::android::hardware::sensors::V1_0::SensorType;
-
-// Derived IEventQueueCallbak class needed by sensor service.
-class EventQueueCallback : public IEventQueueCallback {
- public:
-  EventQueueCallback(wp<GoogSensorWrapper> master) {
-    assert(master);
-    master_ = master;
-  }
-
-  Return<void> onEvent(const Event& e) {
-    sp<GoogSensorWrapper> master = master_.promote();
-    if (master != nullptr) {
-      master->EventCallback(e);
-    }
-    return Void();
-  }
-
- private:
-  wp<GoogSensorWrapper> master_;
-};
-
 GoogSensorWrapper::GoogSensorWrapper(size_t event_buffer_size,
                                      int64_t sensor_sampling_period_us)
-    : event_queue_(nullptr),
+    : event_ring_(GoogSensorEventRing::Create(event_buffer_size)),
       event_buffer_size_limit_(event_buffer_size),
       sensor_sampling_period_us_(sensor_sampling_period_us),
       handle_(-1),
+      subscription_id_(0),
       enabled_(false) {
   ALOGV("%s %d", __func__, __LINE__);
 }
@@ -82,114 +56,86 @@ status_t GoogSensorWrapper::SetEventProcessor(
 }
 
 status_t GoogSensorWrapper::Enable() {
-  status_t res = OK;
-  std::lock_guard<std::mutex> l(event_queue_lock_);
+  std::lock_guard<std::mutex> l(subscription_lock_);
+  if (enabled_) {
+    return OK;
+  }
 
-  if (event_queue_ == nullptr) {
-    res = InitializeEventQueueLocked();
-    if (res != OK) {
-      ALOGE("%s %d initializing event queue failed: %d(%s)", __func__, __LINE__,
-            res, strerror(-res));
-      return res;
+  if (handle_ < 0) {
+    handle_ = GetSensorHandle();
+    if (handle_ < 0) {
+      ALOGE("%s %d Getting sensor from Sensor Manager failed.", __func__,
+            __LINE__);
+      return INVALID_OPERATION;
     }
   }
-  Return<Result> result =
-      event_queue_->enableSensor(handle_, sensor_sampling_period_us_, 0);
-  if (!result.isOk()) {
-    ALOGE("%s %d enable sensor Hidl call failed: %s", __func__, __LINE__,
-          result.description().c_str());
-    return -1;
-  }
-  if (result != Result::OK) {
-    ALOGE("%s %d enable sensor %s failed.", __func__, __LINE__,
-          toString(result).c_str());
-    return -1;
+
+  // Sensors are shared through the process-wide hub so concurrent cameras
+  // and sessions listening to the same sensor use a single subscription.
+  wp<GoogSensorWrapper> weak_this = this;
+  status_t res = GoogSensorHub::GetInstance()->Subscribe(
+      handle_, sensor_sampling_period_us_,
+      [weak_this](const ExtendedSensorEvent& event) {
+        sp<GoogSensorWrapper> wrapper = weak_this.promote();
+        if (wrapper != nullptr) {
+          wrapper->EventCallback(event);
+        }
+      },
+      &subscription_id_);
+  if (res != OK) {
+    ALOGE("%s %d subscribing to sensor %d failed: %d(%s)", __func__,
+          __LINE__, handle_, res, strerror(-res));
+    return res;
   }
 
   enabled_ = true;
-  return res;
+  return OK;
 }
 
 status_t GoogSensorWrapper::Disable() {
-  std::lock_guard<std::mutex> l(event_queue_lock_);
+  std::lock_guard<std::mutex> l(subscription_lock_);
 
   if (enabled_) {
-    if (event_queue_ != nullptr) {
-      Return<Result> result = event_queue_->disableSensor(handle_);
-      if (!result.isOk()) {
-        ALOGE("%s %d disable sensor Hidl call failed: %s", __func__, __LINE__,
-              result.description().c_str());
-        return -1;
-      }
-      if (result != Result::OK) {
-        ALOGE("%s %d disable sensor %s failed.", __func__, __LINE__,
-              toString(result).c_str());
-        return -1;
-      }
+    status_t res = GoogSensorHub::GetInstance()->Unsubscribe(subscription_id_);
+    if (res != OK) {
+      ALOGE("%s %d unsubscribing from sensor %d failed: %d(%s)", __func__,
+            __LINE__, handle_, res, strerror(-res));
+      return res;
     }
     enabled_ = false;
   }
   return OK;
 }
 
-status_t GoogSensorWrapper::InitializeEventQueueLocked() {
-  ALOGV("%s %d", __func__, __LINE__);
-
-  handle_ = GetSensorHandle();
-  if (handle_ < 0) {
-    ALOGE("%s %d Getting sensor from Sensor Manager failed.", __func__,
-          __LINE__);
-    return INVALID_OPERATION;
-  }
-
-  sp<ISensorManager> manager = ISensorManager::getService();
-  if (manager == nullptr) {
-    ALOGE("%s %d Cannot get ISensorManager", __func__, __LINE__);
-    return INVALID_OPERATION;
+void GoogSensorWrapper::EventCallback(const ExtendedSensorEvent& event) {
+  if (event_ring_ != nullptr) {
+    event_ring_->Publish(event);
   }
 
-  manager->createEventQueue(
-      new EventQueueCallback(this), [this](const auto& q, auto result) {
-        // The lock will be held when this synchronous callback executes
-        base::ScopedLockAssertion assertion(event_queue_lock_);
-        if (result != Result::OK) {
-          ALOGE("%s %d Cannot create event queue", __func__, __LINE__);
-          return;
-        }
-        event_queue_ = q;
-      });
-
-  if (event_queue_ == nullptr) {
-    return INVALID_OPERATION;
+  std::lock_guard<std::mutex> el(event_processor_lock_);
+  if (event_processor_ != nullptr) {
+    event_processor_(event);
   }
-
-  return OK;
 }
 
-int GoogSensorWrapper::EventCallback(const Event& e) {
-  ExtendedSensorEvent event;
-  memset(&event, 0, sizeof(event));
-  std::lock_guard<std::mutex> l(event_queue_lock_);
-  event.sensor_event = e;
-  if (event.sensor_event.sensorHandle == handle_ &&
-      event.sensor_event.sensorType != SensorType::ADDITIONAL_INFO) {
-    {
-      std::lock_guard<std::mutex> l(event_buffer_lock_);
-      if (event_buffer_.size() >= event_buffer_size_limit_) {
-        event_buffer_.pop_front();
-      }
-      event.event_arrival_time_ns = elapsedRealtimeNano();
-      event_buffer_.push_back(event);
-    }
-
-    std::lock_guard<std::mutex> el(event_processor_lock_);
-    if (event_processor_ != nullptr) {
-      event_processor_(event);
-    }
+void GoogSensorWrapper::GetBufferedEvents(
+    size_t num_events, std::vector<ExtendedSensorEvent>* events) const {
+  if (events == nullptr) {
+    ALOGE("%s %d events is nullptr.", __func__, __LINE__);
+    return;
+  }
+  events->clear();
+  if (event_ring_ == nullptr) {
+    return;
   }
+  num_events = std::min(num_events, event_buffer_size_limit_);
+  GoogSensorEventRing::Cursor cursor = event_ring_->CreateCursor(num_events);
+  event_ring_->Read(&cursor, num_events, events);
+}
 
-  // Return 1 to continue receiving callbacks.
-  return 1;
+void GoogSensorWrapper::GetBufferedEvents(
+    std::vector<ExtendedSensorEvent>* events) const {
+  GetBufferedEvents(event_buffer_size_limit_, events);
 }
 
 }  // namespace camera_sensor_listener
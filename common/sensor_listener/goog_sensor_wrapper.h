@@ -21,9 +21,11 @@
 #include <android/frameworks/sensorservice/1.0/ISensorManager.h>
 #include <android/frameworks/sensorservice/1.0/types.h>
 
-#include <deque>
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 #include "utils/Errors.h"
 #include "utils/RefBase.h"
@@ -38,6 +40,8 @@ struct ExtendedSensorEvent {
   int64_t event_arrival_time_ns;
 };
 
+class GoogSensorEventRing;
+
 class GoogSensorWrapper : public virtual RefBase {
  public:
   virtual ~GoogSensorWrapper();
@@ -72,49 +76,51 @@ class GoogSensorWrapper : public virtual RefBase {
   // Virtual function to get different sensor handler, e.g., gyro handler.
   virtual int32_t GetSensorHandle() = 0;
 
-  // Buffer of the most recent events. Oldest in the front.
-  std::deque<ExtendedSensorEvent> event_buffer_ GUARDED_BY(event_buffer_lock_);
+  // Copy the latest num_events buffered events into events (cleared first,
+  // oldest first) through a cursor on the event ring. At most
+  // event_queue_size events are buffered. events keeps its capacity, so
+  // per-frame callers reusing it don't allocate. Never blocks the sensor
+  // callback thread.
+  void GetBufferedEvents(size_t num_events,
+                         std::vector<ExtendedSensorEvent>* events) const;
 
-  // Lock protecting event_buffer_.
-  mutable std::mutex event_buffer_lock_;
+  // Copy all buffered events into events (cleared first, oldest first).
+  void GetBufferedEvents(std::vector<ExtendedSensorEvent>* events) const;
 
  private:
-  // Event callback function.
-  // When invoked, it will enqueue Event e to event_deque_, and further invoke
+  // Event callback function invoked by GoogSensorHub.
+  // When invoked, it will publish event to event_ring_, and further invoke
   // user-defined callback function event_processor_.
-  int EventCallback(const ::android::hardware::sensors::V1_0::Event& e);
-
-  // Initialize sensor handler and set event_queue_.
-  status_t InitializeEventQueueLocked()
-      EXCLUSIVE_LOCKS_REQUIRED(event_queue_lock_);
+  void EventCallback(const ExtendedSensorEvent& event);
 
-  // Strong pointer to IEventQueue allocated by sensor service.
-  sp<::android::frameworks::sensorservice::V1_0::IEventQueue> event_queue_
-      GUARDED_BY(event_queue_lock_);
+  // Ring of the most recent events. Written only from the GoogSensorHub
+  // callback thread and read lock-free through GetBufferedEvents.
+  std::unique_ptr<GoogSensorEventRing> event_ring_;
 
   // User-defined callback functor invoked when sensor event arrives.
   std::function<void(const ExtendedSensorEvent& event)> event_processor_
       GUARDED_BY(event_processor_lock_);
 
-  // Lock protecting event_queue_.
-  mutable std::mutex event_queue_lock_;
+  // Lock protecting subscription state.
+  mutable std::mutex subscription_lock_;
 
   // Lock protecting event_processor_.
   mutable std::mutex event_processor_lock_;
 
   // Size limit for the event buffer.
-  size_t event_buffer_size_limit_;
+  const size_t event_buffer_size_limit_;
 
   // Sampling period to read sensor events.
   int64_t sensor_sampling_period_us_;
 
   // Sensor handler.
-  int handle_;
+  int handle_ GUARDED_BY(subscription_lock_);
 
-  // Whether sensor is enabled.
-  bool enabled_;
+  // GoogSensorHub subscription while the sensor is enabled.
+  uint32_t subscription_id_ GUARDED_BY(subscription_lock_);
 
-  friend class EventQueueCallback;
+  // Whether sensor is enabled.
+  std::atomic<bool> enabled_;
 };
 
 }  // namespace camera_sensor_listener
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "goog_sensor_hub_test"
+
+#include <gtest/gtest.h>
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+
+#include "goog_sensor_event_ring.h"
+#include "goog_sensor_hub.h"
+
+namespace android {
+namespace camera_sensor_listener {
+namespace {
+
+using ::android::hardware::sensors::V1_0::Event;
+using ::android::hardware::sensors::V1_0::SensorType;
+
+constexpr int32_t kGyroHandle = 1;
+constexpr int32_t kAccelHandle = 2;
+
+// Fake event source that records enable/disable calls. Events are injected
+// synchronously with Inject().
+class FakeSensorEventSource : public SensorEventSource {
+ public:
+  status_t Initialize(std::function<void(const Event&)> event_callback) override {
+    std::lock_guard<std::mutex> lock(lock_);
+    event_callback_ = std::move(event_callback);
+    return OK;
+  }
+
+  status_t EnableSensor(int32_t sensor_handle,
+                        int64_t sampling_period_us) override {
+    std::lock_guard<std::mutex> lock(lock_);
+    enable_count_++;
+    enabled_periods_us_[sensor_handle] = sampling_period_us;
+    return OK;
+  }
+
+  status_t DisableSensor(int32_t sensor_handle) override {
+    std::lock_guard<std::mutex> lock(lock_);
+    enabled_periods_us_.erase(sensor_handle);
+    return OK;
+  }
+
+  void Inject(int32_t sensor_handle, int64_t timestamp_ns, float value) {
+    Event event = {};
+    event.sensorHandle = sensor_handle;
+    event.sensorType = SensorType::GYROSCOPE;
+    event.timestamp = timestamp_ns;
+    event.u.vec3.x = value;
+    event_callback_(event);
+  }
+
+  uint32_t GetEnableCount() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return enable_count_;
+  }
+
+  // Return the enabled sampling period, or -1 if the sensor is disabled.
+  int64_t GetEnabledPeriodUs(int32_t sensor_handle) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = enabled_periods_us_.find(sensor_handle);
+    return it == enabled_periods_us_.end() ? -1 : it->second;
+  }
+
+ private:
+  std::mutex lock_;
+  std::function<void(const Event&)> event_callback_;
+  uint32_t enable_count_ = 0;
+  std::map<int32_t, int64_t> enabled_periods_us_;
+};
+
+ExtendedSensorEvent MakeEvent(int64_t timestamp_ns) {
+  ExtendedSensorEvent event = {};
+  event.sensor_event.timestamp = timestamp_ns;
+  event.event_arrival_time_ns = timestamp_ns;
+  return event;
+}
+
+}  // namespace
+
+TEST(GoogSensorEventRingTest, ReadInOrder) {
+  auto ring = GoogSensorEventRing::Create(/*capacity=*/6);
+  ASSERT_NE(ring, nullptr);
+  EXPECT_EQ(ring->GetCapacity(), 8u);
+
+  GoogSensorEventRing::Cursor cursor = ring->CreateCursor();
+  for (int64_t i = 0; i < 5; i++) {
+    ring->Publish(MakeEvent(i));
+  }
+
+  std::vector<ExtendedSensorEvent> events;
+  size_t dropped = 0;
+  EXPECT_EQ(ring->Read(&cursor, /*max_events=*/3, &events, &dropped), 3u);
+  EXPECT_EQ(ring->Read(&cursor, /*max_events=*/3, &events, &dropped), 2u);
+  EXPECT_EQ(dropped, 0u);
+  ASSERT_EQ(events.size(), 5u);
+  for (int64_t i = 0; i < 5; i++) {
+    EXPECT_EQ(events[i].sensor_event.timestamp, i);
+  }
+}
+
+TEST(GoogSensorEventRingTest, SlowReaderSkipsOverwrittenEvents) {
+  auto ring = GoogSensorEventRing::Create(/*capacity=*/4);
+  ASSERT_NE(ring, nullptr);
+
+  GoogSensorEventRing::Cursor cursor = ring->CreateCursor();
+  for (int64_t i = 0; i < 10; i++) {
+    ring->Publish(MakeEvent(i));
+  }
+
+  std::vector<ExtendedSensorEvent> events;
+  size_t dropped = 0;
+  EXPECT_EQ(ring->Read(&cursor, /*max_events=*/10, &events, &dropped), 4u);
+  EXPECT_EQ(dropped, 6u);
+  EXPECT_EQ(events.front().sensor_event.timestamp, 6);
+  EXPECT_EQ(events.back().sensor_event.timestamp, 9);
+
+  // A cursor on the latest events, limited to the events still in the ring.
+  events.clear();
+  cursor = ring->CreateCursor(/*num_latest=*/2);
+  EXPECT_EQ(ring->Read(&cursor, /*max_events=*/10, &events, &dropped), 2u);
+  EXPECT_EQ(events[0].sensor_event.timestamp, 8);
+  EXPECT_EQ(events[1].sensor_event.timestamp, 9);
+  events.clear();
+  cursor = ring->CreateCursor(/*num_latest=*/100);
+  EXPECT_EQ(ring->Read(&cursor, /*max_events=*/10, &events, &dropped), 4u);
+  EXPECT_EQ(dropped, 0u);
+  EXPECT_EQ(events.front().sensor_event.timestamp, 6);
+}
+
+// Measure fan-out throughput of one producer and several cursor readers.
+TEST(GoogSensorEventRingTest, FanOutThroughput) {
+  constexpr uint32_t kNumReaders = 4;
+  constexpr int64_t kNumEvents = 1000000;
+
+  auto ring = GoogSensorEventRing::Create(/*capacity=*/1024);
+  ASSERT_NE(ring, nullptr);
+
+  std::atomic<bool> producer_done = false;
+  std::vector<uint64_t> read_counts(kNumReaders, 0);
+  std::vector<uint64_t> drop_counts(kNumReaders, 0);
+  std::vector<std::thread> readers;
+  for (uint32_t r = 0; r < kNumReaders; r++) {
+    readers.emplace_back([&, r]() {
+      GoogSensorEventRing::Cursor cursor = {};
+      std::vector<ExtendedSensorEvent> events;
+      events.reserve(64);
+      int64_t last_timestamp = 0;
+      while (true) {
+        bool done = producer_done.load();
+        events.clear();
+        size_t dropped = 0;
+        ring->Read(&cursor, /*max_events=*/64, &events, &dropped);
+        drop_counts[r] += dropped;
+        for (auto& event : events) {
+          EXPECT_GT(event.sensor_event.timestamp, last_timestamp);
+          last_timestamp = event.sensor_event.timestamp;
+        }
+        read_counts[r] += events.size();
+        if (done && cursor.next_sequence == ring->GetPublishedCount()) {
+          break;
+        }
+      }
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 1; i <= kNumEvents; i++) {
+    ring->Publish(MakeEvent(i));
+  }
+  producer_done = true;
+  auto producer_end = std::chrono::steady_clock::now();
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  auto producer_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         producer_end - start)
+                         .count();
+  ALOGI("Published %" PRId64 " events to %u readers in %.3f ms (%.1f ns/event)",
+        kNumEvents, kNumReaders, producer_ns / 1000000.0,
+        static_cast<double>(producer_ns) / kNumEvents);
+  for (uint32_t r = 0; r < kNumReaders; r++) {
+    ALOGI("  reader %u: read %" PRIu64 ", dropped %" PRIu64, r, read_counts[r],
+          drop_counts[r]);
+    EXPECT_EQ(read_counts[r] + drop_counts[r], static_cast<uint64_t>(kNumEvents));
+  }
+}
+
+TEST(GoogSensorHubTest, SingleSubscriptionPerSensor) {
+  auto source = std::make_unique<FakeSensorEventSource>();
+  FakeSensorEventSource* fake = source.get();
+  auto hub = GoogSensorHub::Create(std::move(source));
+  ASSERT_NE(hub, nullptr);
+
+  std::atomic<int> count_a = 0;
+  std::atomic<int> count_b = 0;
+  GoogSensorHub::SubscriptionId id_a = 0;
+  GoogSensorHub::SubscriptionId id_b = 0;
+  ASSERT_EQ(hub->Subscribe(kGyroHandle, /*sampling_period_us=*/5000,
+                           [&](const ExtendedSensorEvent&) { count_a++; },
+                           &id_a),
+            OK);
+  ASSERT_EQ(hub->Subscribe(kGyroHandle, /*sampling_period_us=*/5000,
+                           [&](const ExtendedSensorEvent&) { count_b++; },
+                           &id_b),
+            OK);
+  EXPECT_EQ(fake->GetEnableCount(), 1u);
+  EXPECT_EQ(fake->GetEnabledPeriodUs(kGyroHandle), 5000);
+
+  for (int i = 1; i <= 10; i++) {
+    fake->Inject(kGyroHandle, i * 5000000LL, i);
+    // Events of sensors nobody subscribed to are ignored.
+    fake->Inject(kAccelHandle, i * 5000000LL, i);
+  }
+  EXPECT_EQ(count_a, 10);
+  EXPECT_EQ(count_b, 10);
+
+  EXPECT_EQ(hub->Unsubscribe(id_a), OK);
+  fake->Inject(kGyroHandle, 11 * 5000000LL, 11);
+  EXPECT_EQ(count_a, 10);
+  EXPECT_EQ(count_b, 11);
+  EXPECT_EQ(fake->GetEnabledPeriodUs(kGyroHandle), 5000);
+
+  EXPECT_EQ(hub->Unsubscribe(id_b), OK);
+  EXPECT_EQ(fake->GetEnabledPeriodUs(kGyroHandle), -1);
+  EXPECT_NE(hub->Unsubscribe(id_b), OK);
+}
+
+TEST(GoogSensorHubTest, DecimateSlowerSubscribers) {
+  auto source = std::make_unique<FakeSensorEventSource>();
+  FakeSensorEventSource* fake = source.get();
+  auto hub = GoogSensorHub::Create(std::move(source));
+  ASSERT_NE(hub, nullptr);
+
+  int fast_count = 0;
+  int slow_count = 0;
+  GoogSensorHub::SubscriptionId fast_id = 0;
+  GoogSensorHub::SubscriptionId slow_id = 0;
+  ASSERT_EQ(hub->Subscribe(kGyroHandle, /*sampling_period_us=*/20000,
+                           [&](const ExtendedSensorEvent&) { slow_count++; },
+                           &slow_id),
+            OK);
+  ASSERT_EQ(hub->Subscribe(kGyroHandle, /*sampling_period_us=*/5000,
+                           [&](const ExtendedSensorEvent&) { fast_count++; },
+                           &fast_id),
+            OK);
+  // The sensor runs at the fastest requested rate.
+  EXPECT_EQ(fake->GetEnabledPeriodUs(kGyroHandle), 5000);
+
+  for (int i = 1; i <= 40; i++) {
+    fake->Inject(kGyroHandle, i * 5000000LL, i);
+  }
+  EXPECT_EQ(fast_count, 40);
+  EXPECT_EQ(slow_count, 10);
+
+  EXPECT_EQ(hub->Unsubscribe(fast_id), OK);
+  EXPECT_EQ(fake->GetEnabledPeriodUs(kGyroHandle), 20000);
+  EXPECT_EQ(hub->Unsubscribe(slow_id), OK);
+}
+
+}  // namespace camera_sensor_listener
+}  // namespace android
@@ -479,6 +479,14 @@ status_t EmulatedCameraDeviceSessionHwlImpl::Flush() {
   return request_processor_->Flush();
 }
 
+void EmulatedCameraDeviceSessionHwlImpl::RemoveCachedBuffers(
+    const native_handle_t* handle) {
+  std::lock_guard<std::mutex> lock(api_mutex_);
+  if (request_processor_ != nullptr) {
+    request_processor_->RemoveCachedBuffers(handle);
+  }
+}
+
 void EmulatedCameraDeviceSessionHwlImpl::RepeatingRequestEnd(
     int32_t /*frame_number*/, const std::vector<int32_t>& /*stream_ids*/) {
 }
@@ -129,6 +129,8 @@ class EmulatedCameraDeviceSessionHwlImpl : public CameraDeviceSessionHwl {
 
   status_t Flush() override;
 
+  void RemoveCachedBuffers(const native_handle_t* handle) override;
+
   void RepeatingRequestEnd(int32_t frame_number,
                            const std::vector<int32_t>& stream_ids) override;
 
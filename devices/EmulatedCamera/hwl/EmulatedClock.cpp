@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "EmulatedClock"
+#include "EmulatedClock.h"
+
+#include <log/log.h>
+#include <system/camera_metadata.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+namespace android {
+
+nsecs_t EmulatedRealClock::GetTime(uint32_t timestamp_source) {
+  if (timestamp_source == ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME) {
+    return systemTime(SYSTEM_TIME_BOOTTIME);
+  }
+  return systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
+void EmulatedRealClock::WaitUntil(uint32_t timestamp_source, nsecs_t time) {
+  nsecs_t now = GetTime(timestamp_source);
+  if (time <= now) {
+    return;
+  }
+
+  timespec t;
+  t.tv_sec = (time - now) / 1000000000L;
+  t.tv_nsec = (time - now) % 1000000000L;
+  // The remaining time is written back if a signal interrupts the sleep.
+  while (nanosleep(&t, &t) != 0) {
+    if (errno != EINTR) {
+      ALOGE("%s: nanosleep failed: %s (%d)", __FUNCTION__, strerror(errno),
+            errno);
+      return;
+    }
+  }
+}
+
+EmulatedVirtualClock::EmulatedVirtualClock()
+    : boot_time_base_(systemTime(SYSTEM_TIME_BOOTTIME)),
+      monotonic_base_(systemTime(SYSTEM_TIME_MONOTONIC)) {
+}
+
+nsecs_t EmulatedVirtualClock::GetTime(uint32_t timestamp_source) {
+  if (timestamp_source == ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME) {
+    return boot_time_base_ + elapsed_;
+  }
+  return monotonic_base_ + elapsed_;
+}
+
+void EmulatedVirtualClock::WaitUntil(uint32_t timestamp_source, nsecs_t time) {
+  nsecs_t base =
+      timestamp_source == ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME
+          ? boot_time_base_
+          : monotonic_base_;
+  nsecs_t elapsed = elapsed_;
+  while ((time - base > elapsed) &&
+         !elapsed_.compare_exchange_weak(elapsed, time - base)) {
+  }
+}
+
+}  // namespace android
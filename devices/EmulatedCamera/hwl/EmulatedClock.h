@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * EmulatedClock is the time base of the emulated sensor: sensor timestamps
+ * are read from it and frames are paced by waiting on it.
+ *
+ * EmulatedRealClock follows the system clocks. EmulatedVirtualClock starts at
+ * the system time and then only moves when the sensor waits for the end of a
+ * frame, which returns immediately. Frames then take only as long as their
+ * rendering and result delivery, while timestamps still advance by exactly
+ * the frame duration. Work times and deadlines are taken on the same clock,
+ * so with the virtual clock the frame rate governor sees no rendering or
+ * compression cost and the face detector never runs out of time.
+ */
+
+#ifndef HW_EMULATOR_CAMERA_CLOCK_H
+#define HW_EMULATOR_CAMERA_CLOCK_H
+
+#include <utils/Timers.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace android {
+
+class EmulatedClock {
+ public:
+  virtual ~EmulatedClock() = default;
+
+  // Current time of timestamp_source, an
+  // ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE value.
+  virtual nsecs_t GetTime(uint32_t timestamp_source) = 0;
+
+  // Wait until the time of timestamp_source reaches time.
+  virtual void WaitUntil(uint32_t timestamp_source, nsecs_t time) = 0;
+
+  // True if the clock doesn't follow the system time.
+  virtual bool IsVirtual() const = 0;
+};
+
+class EmulatedRealClock : public EmulatedClock {
+ public:
+  nsecs_t GetTime(uint32_t timestamp_source) override;
+  void WaitUntil(uint32_t timestamp_source, nsecs_t time) override;
+  bool IsVirtual() const override {
+    return false;
+  }
+};
+
+class EmulatedVirtualClock : public EmulatedClock {
+ public:
+  EmulatedVirtualClock();
+
+  nsecs_t GetTime(uint32_t timestamp_source) override;
+  void WaitUntil(uint32_t timestamp_source, nsecs_t time) override;
+  bool IsVirtual() const override {
+    return true;
+  }
+
+ private:
+  // System time of the boot time and monotonic clocks at creation.
+  const nsecs_t boot_time_base_;
+  const nsecs_t monotonic_base_;
+  // Virtual time elapsed since creation.
+  std::atomic<nsecs_t> elapsed_ = 0;
+};
+
+}  // namespace android
+
+#endif  // HW_EMULATOR_CAMERA_CLOCK_H
@@ -0,0 +1,510 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "EmulatedFaceDetector"
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+#include "EmulatedFaceDetector.h"
+
+#include <inttypes.h>
+#include <log/log.h>
+#include <system/camera_metadata.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace android {
+
+namespace {
+
+// Detection window size in cells, the features are laid out on this grid.
+constexpr int32_t kWindowCells = 24;
+// Scale step between two window sizes.
+constexpr float kScaleStep = 1.25f;
+// Windows with a lower luma variance are skipped.
+constexpr float kMinVariance = 100.f;
+// Overlapping windows needed to report a face.
+constexpr size_t kMinNeighbors = 3;
+
+// Rectangle in cells, right and bottom exclusive.
+struct Region {
+  int32_t left;
+  int32_t top;
+  int32_t right;
+  int32_t bottom;
+};
+
+constexpr Region kForehead = {4, 2, 20, 6};
+constexpr Region kLeftEye = {3, 7, 10, 11};
+constexpr Region kRightEye = {14, 7, 21, 11};
+constexpr Region kBridge = {10, 7, 14, 11};
+constexpr Region kCheeks = {3, 12, 21, 15};
+constexpr Region kUpperLip = {7, 15, 17, 17};
+constexpr Region kMouth = {7, 17, 17, 20};
+
+// Landmarks in cells.
+constexpr float kLeftEyeCenter[2] = {6.5f, 9.f};
+constexpr float kRightEyeCenter[2] = {17.5f, 9.f};
+constexpr float kMouthCenter[2] = {12.f, 18.5f};
+
+// Cascade stage thresholds, in units of the window standard deviation.
+constexpr float kEyesBelowCheeks = 0.35f;
+constexpr float kEyesBelowForehead = 0.25f;
+constexpr float kEyesBelowBridge = 0.25f;
+constexpr float kMouthBelowLip = 0.15f;
+
+struct Candidate {
+  int32_t x;
+  int32_t y;
+  int32_t size;
+  float margin;
+};
+
+float GetOverlap(int32_t a_left, int32_t a_top, int32_t a_right,
+                 int32_t a_bottom, int32_t b_left, int32_t b_top,
+                 int32_t b_right, int32_t b_bottom) {
+  int32_t width = std::min(a_right, b_right) - std::max(a_left, b_left);
+  int32_t height = std::min(a_bottom, b_bottom) - std::max(a_top, b_top);
+  if ((width <= 0) || (height <= 0)) {
+    return 0.f;
+  }
+  float intersection = static_cast<float>(width) * height;
+  float a_area = static_cast<float>(a_right - a_left) * (a_bottom - a_top);
+  float b_area = static_cast<float>(b_right - b_left) * (b_bottom - b_top);
+  return intersection / (a_area + b_area - intersection);
+}
+
+float GetOverlap(const EmulatedFaceDetector::Face& a,
+                 const EmulatedFaceDetector::Face& b) {
+  return GetOverlap(a.left, a.top, a.right, a.bottom, b.left, b.top, b.right,
+                    b.bottom);
+}
+
+}  // namespace
+
+std::unique_ptr<EmulatedFaceDetector> EmulatedFaceDetector::Create(
+    nsecs_t deadline, std::shared_ptr<EmulatedClock> clock) {
+  if (deadline <= 0) {
+    ALOGE("%s: Invalid deadline %" PRId64, __FUNCTION__, deadline);
+    return nullptr;
+  }
+  if (clock == nullptr) {
+    ALOGE("%s: clock is nullptr", __FUNCTION__);
+    return nullptr;
+  }
+
+  return std::unique_ptr<EmulatedFaceDetector>(
+      new EmulatedFaceDetector(deadline, std::move(clock)));
+}
+
+EmulatedFaceDetector::EmulatedFaceDetector(nsecs_t deadline,
+                                           std::shared_ptr<EmulatedClock> clock)
+    : deadline_(deadline), clock_(std::move(clock)) {
+  thread_ = std::thread([this] { this->ThreadLoop(); });
+}
+
+EmulatedFaceDetector::~EmulatedFaceDetector() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_ = true;
+  }
+  condition_.notify_one();
+  thread_.join();
+
+  for (const auto& it : stats_) {
+    const Stats& stats = it.second;
+    if (stats.frames == 0) {
+      continue;
+    }
+    ALOGI("%s: %ux%u: %" PRIu64 " frames, %" PRId64 " us average, %" PRId64
+          " us max, %" PRIu64 " over deadline, %" PRIu64 " dropped",
+          __FUNCTION__, it.first.first, it.first.second, stats.frames,
+          ns2us(stats.total_duration / static_cast<nsecs_t>(stats.frames)),
+          ns2us(stats.max_duration), stats.deadline_misses, stats.dropped);
+  }
+}
+
+bool EmulatedFaceDetector::Submit(const uint8_t* luma, uint32_t stride,
+                                  uint32_t width, uint32_t height,
+                                  const CropRegion& crop, nsecs_t timestamp) {
+  ATRACE_CALL();
+  if ((luma == nullptr) || (width == 0) || (height == 0)) {
+    return false;
+  }
+
+  auto resolution = std::make_pair(width, height);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (busy_ || has_pending_frame_) {
+      stats_[resolution].dropped++;
+      return false;
+    }
+  }
+
+  // Only the submitting thread queues frames, so the slot stays free while
+  // the frame is downscaled.
+  Frame frame;
+  uint32_t factor = (width + kDetectionWidth - 1) / kDetectionWidth;
+  frame.width = width / factor;
+  frame.height = height / factor;
+  frame.crop = crop;
+  frame.timestamp = timestamp;
+  frame.image.resize(frame.width * frame.height);
+  for (uint32_t y = 0; y < frame.height; y++) {
+    const uint8_t* row = luma + y * factor * stride;
+    const uint8_t* next_row = factor > 1 ? row + stride : row;
+    uint8_t* out = frame.image.data() + y * frame.width;
+    if (factor == 1) {
+      std::copy(row, row + frame.width, out);
+      continue;
+    }
+    for (uint32_t x = 0; x < frame.width; x++) {
+      uint32_t src_x = x * factor;
+      out[x] = (row[src_x] + row[src_x + 1] + next_row[src_x] +
+                next_row[src_x + 1] + 2) >>
+               2;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_frame_ = std::move(frame);
+    pending_resolution_ = resolution;
+    has_pending_frame_ = true;
+  }
+  condition_.notify_one();
+
+  return true;
+}
+
+bool EmulatedFaceDetector::GetFaces(size_t max_faces,
+                                    std::vector<Face>* faces,
+                                    nsecs_t* timestamp) {
+  if ((faces == nullptr) || (timestamp == nullptr)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!has_faces_) {
+    return false;
+  }
+
+  const CropRegion& crop = faces_crop_;
+  float scale_x = crop.width / faces_width_;
+  float scale_y = crop.height / faces_height_;
+  auto map_x = [&crop, scale_x](int32_t x) {
+    return static_cast<int32_t>(crop.left + x * scale_x);
+  };
+  auto map_y = [&crop, scale_y](int32_t y) {
+    return static_cast<int32_t>(crop.top + y * scale_y);
+  };
+  auto map = [&map_x, &map_y](const int32_t in[2], int32_t out[2]) {
+    out[0] = map_x(in[0]);
+    out[1] = map_y(in[1]);
+  };
+  faces->clear();
+  for (const auto& face : faces_) {
+    if (faces->size() >= max_faces) {
+      break;
+    }
+    Face mapped = face;
+    mapped.left = map_x(face.left);
+    mapped.top = map_y(face.top);
+    mapped.right = map_x(face.right);
+    mapped.bottom = map_y(face.bottom);
+    map(face.left_eye, mapped.left_eye);
+    map(face.right_eye, mapped.right_eye);
+    map(face.mouth, mapped.mouth);
+    faces->push_back(mapped);
+  }
+  *timestamp = faces_timestamp_;
+
+  return true;
+}
+
+void EmulatedFaceDetector::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  faces_.clear();
+  has_faces_ = false;
+  has_pending_frame_ = false;
+  generation_++;
+}
+
+std::vector<EmulatedFaceDetector::Face> EmulatedFaceDetector::Detect(
+    const uint8_t* image, uint32_t width, uint32_t height, EmulatedClock* clock,
+    nsecs_t deadline_time, bool* deadline_missed) {
+  ATRACE_CALL();
+  if (deadline_missed != nullptr) {
+    *deadline_missed = false;
+  }
+  std::vector<Face> faces;
+  if ((image == nullptr) || (clock == nullptr) ||
+      (std::min(width, height) < kWindowCells)) {
+    return faces;
+  }
+
+  // Integral images of the luma and the squared luma, with a zero first row
+  // and column.
+  const size_t stride = width + 1;
+  std::vector<uint32_t> sum(stride * (height + 1), 0);
+  std::vector<uint64_t> square_sum(stride * (height + 1), 0);
+  for (uint32_t y = 0; y < height; y++) {
+    uint32_t row_sum = 0;
+    uint64_t row_square_sum = 0;
+    const uint8_t* row = image + y * width;
+    for (uint32_t x = 0; x < width; x++) {
+      row_sum += row[x];
+      row_square_sum += row[x] * row[x];
+      sum[(y + 1) * stride + x + 1] = sum[y * stride + x + 1] + row_sum;
+      square_sum[(y + 1) * stride + x + 1] =
+          square_sum[y * stride + x + 1] + row_square_sum;
+    }
+  }
+  auto rect_sum = [&sum, stride](int32_t left, int32_t top, int32_t right,
+                                 int32_t bottom) {
+    return sum[bottom * stride + right] - sum[top * stride + right] -
+           sum[bottom * stride + left] + sum[top * stride + left];
+  };
+
+  // Largest windows first, the deadline cuts the many small windows. It is
+  // checked before every row of windows, so that a late scale of small
+  // windows doesn't overrun it.
+  std::vector<Candidate> candidates;
+  int32_t max_size = std::min(width, height);
+  bool expired = false;
+  for (float size_f = max_size; (size_f >= kWindowCells) && !expired;
+       size_f /= kScaleStep) {
+    const int32_t size = static_cast<int32_t>(size_f);
+    const float cell = static_cast<float>(size) / kWindowCells;
+    const int32_t step = std::max(1, size / 12);
+    auto to_pixels = [cell](const Region& region) {
+      return Region{static_cast<int32_t>(region.left * cell + 0.5f),
+                    static_cast<int32_t>(region.top * cell + 0.5f),
+                    static_cast<int32_t>(region.right * cell + 0.5f),
+                    static_cast<int32_t>(region.bottom * cell + 0.5f)};
+    };
+    const Region forehead = to_pixels(kForehead);
+    const Region left_eye = to_pixels(kLeftEye);
+    const Region right_eye = to_pixels(kRightEye);
+    const Region bridge = to_pixels(kBridge);
+    const Region cheeks = to_pixels(kCheeks);
+    const Region upper_lip = to_pixels(kUpperLip);
+    const Region mouth = to_pixels(kMouth);
+    const float area = static_cast<float>(size) * size;
+
+    for (int32_t y = 0; y + size <= static_cast<int32_t>(height); y += step) {
+      if (clock->GetTime(ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN) >
+          deadline_time) {
+        expired = true;
+        break;
+      }
+      for (int32_t x = 0; x + size <= static_cast<int32_t>(width);
+           x += step) {
+        auto mean = [&](const Region& region) {
+          return static_cast<float>(rect_sum(x + region.left, y + region.top,
+                                             x + region.right,
+                                             y + region.bottom)) /
+                 ((region.right - region.left) * (region.bottom - region.top));
+        };
+
+        float window_mean = rect_sum(x, y, x + size, y + size) / area;
+        float window_square_mean =
+            (square_sum[(y + size) * stride + x + size] -
+             square_sum[y * stride + x + size] -
+             square_sum[(y + size) * stride + x] + square_sum[y * stride + x]) /
+            area;
+        float variance = window_square_mean - window_mean * window_mean;
+        if (variance < kMinVariance) {
+          continue;
+        }
+        float inv_deviation = 1.f / std::sqrt(variance);
+
+        // Cascade stages, cheapest and most selective first.
+        float eyes = 0.5f * (mean(left_eye) + mean(right_eye));
+        float margin_cheeks =
+            (mean(cheeks) - eyes) * inv_deviation - kEyesBelowCheeks;
+        if (margin_cheeks <= 0) {
+          continue;
+        }
+        float margin_forehead =
+            (mean(forehead) - eyes) * inv_deviation - kEyesBelowForehead;
+        if (margin_forehead <= 0) {
+          continue;
+        }
+        float bridge_mean = mean(bridge);
+        float margin_bridge =
+            (bridge_mean - std::max(mean(left_eye), mean(right_eye))) *
+                inv_deviation -
+            kEyesBelowBridge;
+        if (margin_bridge <= 0) {
+          continue;
+        }
+        float margin_mouth =
+            (mean(upper_lip) - mean(mouth)) * inv_deviation - kMouthBelowLip;
+        if (margin_mouth <= 0) {
+          continue;
+        }
+
+        candidates.push_back(
+            {x, y, size,
+             margin_cheeks + margin_forehead + margin_bridge + margin_mouth});
+      }
+    }
+  }
+
+  if (expired && (deadline_missed != nullptr)) {
+    *deadline_missed = true;
+  }
+
+  // Merge overlapping candidates around the strongest ones.
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) {
+              return a.margin > b.margin;
+            });
+  std::vector<bool> merged(candidates.size(), false);
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (merged[i]) {
+      continue;
+    }
+    const Candidate& best = candidates[i];
+    float left = 0, top = 0, size = 0;
+    size_t neighbors = 0;
+    for (size_t j = i; j < candidates.size(); j++) {
+      const Candidate& c = candidates[j];
+      if (merged[j] ||
+          GetOverlap(best.x, best.y, best.x + best.size, best.y + best.size,
+                     c.x, c.y, c.x + c.size, c.y + c.size) < 0.4f) {
+        continue;
+      }
+      merged[j] = true;
+      left += c.x;
+      top += c.y;
+      size += c.size;
+      neighbors++;
+    }
+    if (neighbors < kMinNeighbors) {
+      continue;
+    }
+
+    left /= neighbors;
+    top /= neighbors;
+    size /= neighbors;
+    const float cell = size / kWindowCells;
+    auto landmark = [&](const float center[2], int32_t out[2]) {
+      out[0] = static_cast<int32_t>(left + center[0] * cell);
+      out[1] = static_cast<int32_t>(top + center[1] * cell);
+    };
+    Face face;
+    face.left = static_cast<int32_t>(left);
+    face.top = static_cast<int32_t>(top);
+    face.right = static_cast<int32_t>(left + size);
+    face.bottom = static_cast<int32_t>(top + size);
+    face.score = static_cast<uint8_t>(
+        std::clamp(4.f * neighbors + 10.f * best.margin, 1.f, 100.f));
+    landmark(kLeftEyeCenter, face.left_eye);
+    landmark(kRightEyeCenter, face.right_eye);
+    landmark(kMouthCenter, face.mouth);
+
+    // Windows over parts of a stronger face, e.g. with the brows matching
+    // the eyes, are merged separately.
+    int32_t center_x = (face.left + face.right) / 2;
+    int32_t center_y = (face.top + face.bottom) / 2;
+    bool overlaps = std::any_of(
+        faces.begin(), faces.end(), [&](const Face& other) {
+          return (GetOverlap(face, other) > 0.3f) ||
+                 ((center_x >= other.left) && (center_x < other.right) &&
+                  (center_y >= other.top) && (center_y < other.bottom));
+        });
+    if (!overlaps) {
+      faces.push_back(face);
+    }
+  }
+
+  std::sort(faces.begin(), faces.end(), [](const Face& a, const Face& b) {
+    return a.score > b.score;
+  });
+  return faces;
+}
+
+void EmulatedFaceDetector::AssignIds(std::vector<Face>* faces) {
+  for (auto& face : *faces) {
+    face.id = 0;
+    for (const auto& previous : faces_) {
+      if (GetOverlap(face, previous) > 0.3f) {
+        face.id = previous.id;
+        break;
+      }
+    }
+    if (face.id == 0) {
+      face.id = next_id_++;
+    }
+  }
+}
+
+void EmulatedFaceDetector::ThreadLoop() {
+  while (true) {
+    Frame frame;
+    std::pair<uint32_t, uint32_t> resolution;
+    uint32_t generation;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this] { return exit_ || has_pending_frame_; });
+      if (exit_) {
+        return;
+      }
+      frame = std::move(pending_frame_);
+      resolution = pending_resolution_;
+      generation = generation_;
+      has_pending_frame_ = false;
+      busy_ = true;
+    }
+
+    nsecs_t start = systemTime();
+    nsecs_t deadline_time =
+        clock_->GetTime(ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN) +
+        deadline_;
+    bool deadline_missed = false;
+    auto faces = Detect(frame.image.data(), frame.width, frame.height,
+                        clock_.get(), deadline_time, &deadline_missed);
+    nsecs_t duration = systemTime() - start;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    busy_ = false;
+    if (generation == generation_) {
+      if ((frame.width != faces_width_) || (frame.height != faces_height_)) {
+        faces_.clear();
+      }
+      AssignIds(&faces);
+      faces_ = std::move(faces);
+      faces_width_ = frame.width;
+      faces_height_ = frame.height;
+      faces_crop_ = frame.crop;
+      faces_timestamp_ = frame.timestamp;
+      has_faces_ = true;
+    }
+
+    Stats& stats = stats_[resolution];
+    stats.frames++;
+    stats.total_duration += duration;
+    stats.max_duration = std::max(stats.max_duration, duration);
+    if (deadline_missed) {
+      stats.deadline_misses++;
+    }
+  }
+}
+
+}  // namespace android
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * EmulatedFaceDetector finds frontal faces in the luma plane of preview
+ * frames, so sessions with face detection enabled carry a detection workload
+ * like real devices do.
+ *
+ * Frames are downscaled on submission and processed on a worker thread. The
+ * detector slides windows over an integral image at several scales and
+ * evaluates a small cascade of Haar-like features that compare the mean
+ * brightness of the eye band, forehead, cheeks, nose bridge and mouth,
+ * normalized by the window contrast. Overlapping detections are merged and
+ * windows without enough neighbors are rejected as false positives.
+ *
+ * The deadline is kept on the clock of the sensor, so with a virtual clock
+ * every frame is scanned completely.
+ */
+
+#ifndef HW_EMULATOR_CAMERA_FACE_DETECTOR_H
+#define HW_EMULATOR_CAMERA_FACE_DETECTOR_H
+
+#include <utils/Timers.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "EmulatedClock.h"
+
+namespace android {
+
+class EmulatedFaceDetector {
+ public:
+  struct Face {
+    // Bounds and landmarks in the coordinates requested from GetFaces().
+    int32_t left = 0;
+    int32_t top = 0;
+    int32_t right = 0;
+    int32_t bottom = 0;
+    // Confidence in [1, 100].
+    uint8_t score = 1;
+    // Stays the same while a face is tracked across frames.
+    int32_t id = 0;
+    int32_t left_eye[2] = {0};
+    int32_t right_eye[2] = {0};
+    int32_t mouth[2] = {0};
+  };
+
+  // Area of the reported coordinate space that a submitted frame shows.
+  // Frame coordinates are stretched to it along each axis.
+  struct CropRegion {
+    float left = 0;
+    float top = 0;
+    float width = 0;
+    float height = 0;
+  };
+
+  // Create a detector that stops scanning a frame once deadline has passed on
+  // clock.
+  static std::unique_ptr<EmulatedFaceDetector> Create(
+      nsecs_t deadline, std::shared_ptr<EmulatedClock> clock);
+
+  ~EmulatedFaceDetector();
+
+  // Queue the width x height luma plane of the frame captured at timestamp,
+  // which shows crop. Frames submitted while the previous one is still in
+  // progress are dropped. Returns true if the frame was queued.
+  bool Submit(const uint8_t* luma, uint32_t stride, uint32_t width,
+              uint32_t height, const CropRegion& crop, nsecs_t timestamp);
+
+  // Get up to max_faces faces of the latest processed frame, mapped through
+  // the crop region of that frame, and its timestamp. Returns false if no
+  // frame was processed since the last Clear().
+  bool GetFaces(size_t max_faces, std::vector<Face>* faces,
+                nsecs_t* timestamp);
+
+  // Drop the faces of the processed frames and of the frames in progress.
+  void Clear();
+
+  // Detect faces in the width x height image, scanning until the monotonic
+  // time of clock reaches deadline_time. Bounds are in image coordinates.
+  // Sets deadline_missed if not all scales were scanned.
+  static std::vector<Face> Detect(const uint8_t* image, uint32_t width,
+                                  uint32_t height, EmulatedClock* clock,
+                                  nsecs_t deadline_time,
+                                  bool* deadline_missed);
+
+ private:
+  // Frames are downscaled to at most this width before detection.
+  static constexpr uint32_t kDetectionWidth = 320;
+
+  struct Frame {
+    std::vector<uint8_t> image;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    CropRegion crop;
+    nsecs_t timestamp = 0;
+  };
+
+  // Cost of the frames of one input resolution.
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t dropped = 0;
+    uint64_t deadline_misses = 0;
+    nsecs_t total_duration = 0;
+    nsecs_t max_duration = 0;
+  };
+
+  EmulatedFaceDetector(nsecs_t deadline, std::shared_ptr<EmulatedClock> clock);
+
+  void ThreadLoop();
+
+  // Keep the ids of the faces that overlap faces of the previous frame.
+  void AssignIds(std::vector<Face>* faces);
+
+  const nsecs_t deadline_;
+  const std::shared_ptr<EmulatedClock> clock_;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool exit_ = false;
+  bool busy_ = false;
+  Frame pending_frame_;
+  // Input resolution of the pending frame.
+  std::pair<uint32_t, uint32_t> pending_resolution_;
+  bool has_pending_frame_ = false;
+  // Incremented by Clear(), so the frame in progress is not reported.
+  uint32_t generation_ = 0;
+
+  std::vector<Face> faces_;
+  uint32_t faces_width_ = 0;
+  uint32_t faces_height_ = 0;
+  CropRegion faces_crop_;
+  nsecs_t faces_timestamp_ = 0;
+  bool has_faces_ = false;
+  int32_t next_id_ = 1;
+
+  std::map<std::pair<uint32_t, uint32_t>, Stats> stats_;
+
+  std::thread thread_;
+
+  EmulatedFaceDetector(const EmulatedFaceDetector&) = delete;
+  EmulatedFaceDetector& operator=(const EmulatedFaceDetector&) = delete;
+};
+
+}  // namespace android
+
+#endif  // HW_EMULATOR_CAMERA_FACE_DETECTOR_H
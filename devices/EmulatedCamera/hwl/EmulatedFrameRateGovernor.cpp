@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "EmulatedFrameRateGovernor"
+#include "EmulatedFrameRateGovernor.h"
+
+#include <inttypes.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace android {
+
+std::unique_ptr<EmulatedFrameRateGovernor> EmulatedFrameRateGovernor::Create(
+    bool enabled) {
+  return std::unique_ptr<EmulatedFrameRateGovernor>(
+      new EmulatedFrameRateGovernor(enabled));
+}
+
+EmulatedFrameRateGovernor::EmulatedFrameRateGovernor(bool enabled)
+    : enabled_(enabled) {
+}
+
+nsecs_t EmulatedFrameRateGovernor::Quantize(nsecs_t duration) {
+  nsecs_t fps = ms2ns(1000) / std::max<nsecs_t>(duration, 1);
+  if (fps < 1) {
+    return duration;
+  }
+
+  return ms2ns(1000) / fps;
+}
+
+nsecs_t EmulatedFrameRateGovernor::GetFrameDuration(
+    nsecs_t frame_duration, nsecs_t max_frame_duration) {
+  nsecs_t new_frame_duration = frame_duration;
+  if (enabled_ && (max_frame_duration > frame_duration)) {
+    nsecs_t current =
+        std::clamp(frame_duration_, frame_duration, max_frame_duration);
+    nsecs_t peak_work_time = 0;
+    if (!work_times_.empty()) {
+      peak_work_time =
+          *std::max_element(work_times_.begin(), work_times_.end());
+    }
+
+    new_frame_duration = current;
+    if (peak_work_time > current * kTargetLoad) {
+      // Falling behind, slow down right away.
+      nsecs_t slower = static_cast<nsecs_t>(peak_work_time / kTargetLoad);
+      new_frame_duration = std::clamp(Quantize(slower), frame_duration,
+                                      max_frame_duration);
+      speed_up_frames_ = 0;
+    } else {
+      nsecs_t faster = static_cast<nsecs_t>(peak_work_time / kSpeedUpLoad);
+      faster =
+          std::clamp(Quantize(faster), frame_duration, max_frame_duration);
+      if (faster < current) {
+        if (++speed_up_frames_ >= kSpeedUpFrames) {
+          new_frame_duration = faster;
+          speed_up_frames_ = 0;
+        }
+      } else {
+        speed_up_frames_ = 0;
+      }
+    }
+  } else {
+    speed_up_frames_ = 0;
+  }
+
+  if (new_frame_duration != frame_duration_) {
+    if (frame_duration_ != 0) {
+      stats_.frame_duration_changes++;
+      ALOGV("%s: Frame duration %" PRId64 " -> %" PRId64 " ns", __FUNCTION__,
+            frame_duration_, new_frame_duration);
+    }
+    frame_duration_ = new_frame_duration;
+  }
+
+  return frame_duration_;
+}
+
+void EmulatedFrameRateGovernor::AddFrame(nsecs_t frame_interval,
+                                         nsecs_t work_time) {
+  stats_.frames++;
+  work_times_.push_back(work_time);
+  if (work_times_.size() > kWorkWindowSize) {
+    work_times_.pop_front();
+  }
+
+  if (frame_interval > 0) {
+    if (frame_interval > frame_duration_ + frame_duration_ / 2) {
+      stats_.slipped_frames++;
+    }
+    frame_intervals_.push_back(frame_interval);
+    if (frame_intervals_.size() > kStatsWindowSize) {
+      frame_intervals_.pop_front();
+    }
+  }
+}
+
+EmulatedFrameRateGovernor::Stats EmulatedFrameRateGovernor::GetStats() const {
+  Stats stats = stats_;
+  stats.frame_duration = frame_duration_;
+  if (frame_intervals_.empty()) {
+    return stats;
+  }
+
+  double sum = 0;
+  for (auto interval : frame_intervals_) {
+    sum += interval;
+  }
+  double mean = sum / frame_intervals_.size();
+  double square_sum = 0;
+  for (auto interval : frame_intervals_) {
+    square_sum += (interval - mean) * (interval - mean);
+  }
+  stats.mean_frame_interval = static_cast<nsecs_t>(mean);
+  stats.frame_interval_jitter =
+      static_cast<nsecs_t>(std::sqrt(square_sum / frame_intervals_.size()));
+
+  return stats;
+}
+
+}  // namespace android
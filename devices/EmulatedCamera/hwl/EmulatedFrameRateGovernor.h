@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * EmulatedFrameRateGovernor lowers the frame rate of the emulated sensor
+ * within the range the request allows when the host can't render and encode
+ * frames in time, instead of letting the sensor slip frames at random.
+ *
+ * The governor tracks the work time of the recent frames. When the peak of
+ * them takes more than kTargetLoad of the frame duration, the frame duration
+ * is stretched right away. It only shrinks back when the work fits in
+ * kSpeedUpLoad of the shorter duration for kSpeedUpFrames frames in a row.
+ * Frame durations are whole frames per second, so the frame rate settles
+ * instead of following every fluctuation of the load.
+ *
+ * Not thread safe.
+ */
+
+#ifndef HW_EMULATOR_CAMERA_FRAME_RATE_GOVERNOR_H
+#define HW_EMULATOR_CAMERA_FRAME_RATE_GOVERNOR_H
+
+#include <utils/Timers.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace android {
+
+class EmulatedFrameRateGovernor {
+ public:
+  struct Stats {
+    uint64_t frames = 0;
+    // Frames that started more than half a frame late.
+    uint64_t slipped_frames = 0;
+    uint64_t frame_duration_changes = 0;
+    nsecs_t frame_duration = 0;
+    // Over the last kStatsWindowSize frames.
+    nsecs_t mean_frame_interval = 0;
+    nsecs_t frame_interval_jitter = 0;  // Standard deviation
+  };
+
+  // A disabled governor keeps the requested frame durations but still
+  // collects statistics, for comparison.
+  static std::unique_ptr<EmulatedFrameRateGovernor> Create(bool enabled);
+
+  // Frame duration of the next frame, between the requested frame_duration
+  // and max_frame_duration, the longest the request allows.
+  nsecs_t GetFrameDuration(nsecs_t frame_duration, nsecs_t max_frame_duration);
+
+  // Record a frame that started frame_interval after the previous one, or 0
+  // if it is the first, and took work_time to render and encode.
+  void AddFrame(nsecs_t frame_interval, nsecs_t work_time);
+
+  Stats GetStats() const;
+
+ private:
+  static constexpr uint32_t kWorkWindowSize = 15;
+  static constexpr uint32_t kStatsWindowSize = 300;
+  static constexpr float kTargetLoad = 0.85f;
+  static constexpr float kSpeedUpLoad = 0.6f;
+  static constexpr uint32_t kSpeedUpFrames = 30;
+
+  explicit EmulatedFrameRateGovernor(bool enabled);
+
+  // Round duration up to whole frames per second.
+  static nsecs_t Quantize(nsecs_t duration);
+
+  const bool enabled_;
+  nsecs_t frame_duration_ = 0;
+  uint32_t speed_up_frames_ = 0;
+  std::deque<nsecs_t> work_times_;
+  std::deque<nsecs_t> frame_intervals_;
+  Stats stats_;
+};
+
+}  // namespace android
+
+#endif  // HW_EMULATOR_CAMERA_FRAME_RATE_GOVERNOR_H
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "EmulatedHlgEncoder"
+#include "EmulatedHlgEncoder.h"
+
+#include <endian.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace android {
+
+// BT.2020 non-constant luminance RGB->YCbCr
+static constexpr float kKr = 0.2627f;
+static constexpr float kKb = 0.0593f;
+static constexpr float kKg = 1.f - kKr - kKb;
+static constexpr float kCbScale = 0.5f / (1.f - kKb);
+static constexpr float kCrScale = 0.5f / (1.f - kKr);
+
+EmulatedHlgEncoder::EmulatedHlgEncoder() {
+  // BT.2100 HLG OETF of normalized scene light. Sampling at uniform steps of
+  // sqrt(E) makes the square root segment exact and keeps the interpolation
+  // error of the logarithmic segment below one 10-bit code.
+  const float a = 0.17883277f;
+  const float b = 0.28466892f;
+  const float c = 0.55991073f;
+  oetf_lut_.resize(kOetfLutSize + 1);
+  for (uint32_t i = 0; i <= kOetfLutSize; i++) {
+    float s = static_cast<float>(i) / kOetfLutSize;
+    float e = s * s;
+    oetf_lut_[i] =
+        (e <= 1.f / 12.f) ? std::sqrt(3.f) * s : a * std::log(12.f * e - b) + c;
+  }
+}
+
+void EmulatedHlgEncoder::ApplyOetf(float* values, uint32_t count) const {
+  const float* lut = oetf_lut_.data();
+  for (uint32_t i = 0; i < count; i++) {
+    float pos = std::sqrt(values[i]) * kOetfLutSize;
+    uint32_t index = std::min(static_cast<uint32_t>(pos), kOetfLutSize - 1);
+    float frac = pos - index;
+    values[i] = lut[index] + frac * (lut[index + 1] - lut[index]);
+  }
+}
+
+void EmulatedHlgEncoder::EncodeRows(float* const rgb[6], uint32_t width,
+                                    uint16_t* y_upper, uint16_t* y_lower,
+                                    uint8_t* cb, uint8_t* cr,
+                                    uint32_t cbcr_step) const {
+  for (size_t i = 0; i < 6; i++) {
+    ApplyOetf(rgb[i], width);
+  }
+
+  // 10-bit limited range
+  uint16_t* y_rows[2] = {y_upper, y_lower};
+  for (uint32_t row = 0; row < 2; row++) {
+    if (y_rows[row] == nullptr) {
+      continue;
+    }
+    const float* r = rgb[row * 3];
+    const float* g = rgb[row * 3 + 1];
+    const float* b = rgb[row * 3 + 2];
+    for (uint32_t x = 0; x < width; x++) {
+      float luma = kKr * r[x] + kKg * g[x] + kKb * b[x];
+      uint16_t y10 = static_cast<uint16_t>(64.f + 876.f * luma + 0.5f);
+      y_rows[row][x] = htole16(y10 << 6);
+    }
+  }
+
+  // Without a lower row, the upper one is used twice.
+  const uint32_t lower = (y_lower != nullptr) ? 3 : 0;
+  for (uint32_t x = 0; x < width; x += 2) {
+    uint32_t x1 = std::min(x + 1, width - 1);
+    float r_avg =
+        0.25f * (rgb[0][x] + rgb[0][x1] + rgb[lower][x] + rgb[lower][x1]);
+    float g_avg = 0.25f * (rgb[1][x] + rgb[1][x1] + rgb[lower + 1][x] +
+                           rgb[lower + 1][x1]);
+    float b_avg = 0.25f * (rgb[2][x] + rgb[2][x1] + rgb[lower + 2][x] +
+                           rgb[lower + 2][x1]);
+    float luma = kKr * r_avg + kKg * g_avg + kKb * b_avg;
+    uint16_t cb10 = static_cast<uint16_t>(
+        512.f + 896.f * kCbScale * (b_avg - luma) + 0.5f);
+    uint16_t cr10 = static_cast<uint16_t>(
+        512.f + 896.f * kCrScale * (r_avg - luma) + 0.5f);
+    *reinterpret_cast<uint16_t*>(cb) = htole16(cb10 << 6);
+    *reinterpret_cast<uint16_t*>(cr) = htole16(cr10 << 6);
+    cb += cbcr_step;
+    cr += cbcr_step;
+  }
+}
+
+}  // namespace android
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * EmulatedHlgEncoder writes 10-bit limited range BT.2020 HLG YCbCr into P010
+ * planes from linear BT.2020 RGB. The BT.2100 HLG OETF is applied through a
+ * LUT sampled at uniform steps of sqrt(E) with linear interpolation, which
+ * keeps the error below one 10-bit code. Chroma is averaged over 2x2 blocks.
+ */
+
+#ifndef HW_EMULATOR_CAMERA_HLG_ENCODER_H
+#define HW_EMULATOR_CAMERA_HLG_ENCODER_H
+
+#include <cstdint>
+#include <vector>
+
+namespace android {
+
+class EmulatedHlgEncoder {
+ public:
+  EmulatedHlgEncoder();
+
+  // Apply the HLG OETF in place to count linear values in [0, 1].
+  void ApplyOetf(float* values, uint32_t count) const;
+
+  // Encode two rows of width linear RGB values in [0, 1]. rgb holds the R, G
+  // and B of the upper row, then of the lower row, and is overwritten with
+  // the HLG values. y_lower is nullptr if the image ends with the upper row,
+  // which then also stands in for the lower row of the chroma. cbcr_step is
+  // in bytes.
+  void EncodeRows(float* const rgb[6], uint32_t width, uint16_t* y_upper,
+                  uint16_t* y_lower, uint8_t* cb, uint8_t* cr,
+                  uint32_t cbcr_step) const;
+
+ private:
+  static constexpr uint32_t kOetfLutSize = 1024;
+
+  // HLG OETF of (i / kOetfLutSize)^2.
+  std::vector<float> oetf_lut_;
+};
+
+}  // namespace android
+
+#endif  // HW_EMULATOR_CAMERA_HLG_ENCODER_H
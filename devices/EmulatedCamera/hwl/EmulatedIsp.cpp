@@ -0,0 +1,508 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+#define LOG_TAG "EmulatedIsp"
+#include "EmulatedIsp.h"
+
+#include <inttypes.h>
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace android {
+
+namespace {
+// Threads used when the count is not specified. Reprocessing shares the CPUs
+// with the sensor and JPEG threads.
+const uint32_t kMaxDefaultThreads = 4;
+
+// Mirror index i into [0, n) without changing its parity, so mirrored
+// pixels keep their Bayer color. Note that -2 and n + 1 land on 2 and n - 3,
+// but -1 and n land on 1 and n - 2.
+int32_t Reflect(int32_t i, int32_t n) {
+  if (i < 0) return -i;
+  if (i >= n) return 2 * n - 2 - i;
+  return i;
+}
+
+// The neighbor step away from i, or the one on the other side of i if that
+// is outside [0, n). Unlike Reflect, never returns i itself.
+int32_t Neighbor(int32_t i, int32_t step, int32_t n) {
+  int32_t j = i + step;
+  return (j < 0 || j >= n) ? i - step : j;
+}
+
+const char* const kDefectCorrectionNames[] = {"off", "fast", "high quality"};
+}  // namespace
+
+std::unique_ptr<EmulatedIsp> EmulatedIsp::Create(uint32_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::clamp(std::thread::hardware_concurrency(), 1u,
+                             kMaxDefaultThreads);
+  }
+  auto isp = std::unique_ptr<EmulatedIsp>(new EmulatedIsp(num_threads));
+  if (num_threads == 1) {
+    return isp;
+  }
+
+  // The calling thread is one of the workers. The shared render pool can't
+  // be used, ProcessRAW16() is called from its tasks and would wait for
+  // tasks queued behind itself.
+  isp->pool_ = EmulatedRenderPool::Create(
+      num_threads - 1, google_camera_hal::ThreadRole::kRender, "EmulatedIsp");
+  if (isp->pool_ == nullptr) {
+    ALOGE("%s: Failed to create the worker pool", __FUNCTION__);
+    return nullptr;
+  }
+  for (uint32_t id = 1; id < num_threads; id++) {
+    uint32_t client =
+        isp->pool_->AddClient("EmulatedIspWorker" + std::to_string(id));
+    if (client == EmulatedRenderPool::kInvalidClient) {
+      ALOGE("%s: Failed to add worker %u", __FUNCTION__, id);
+      return nullptr;
+    }
+    isp->pool_clients_.push_back(client);
+  }
+  return isp;
+}
+
+EmulatedIsp::EmulatedIsp(uint32_t num_threads)
+    : num_threads_(num_threads), scratch_(num_threads) {
+  for (auto& curve : tone_curves_) {
+    curve.resize(kToneCurveSize);
+  }
+  for (uint32_t i = 0; i < kToneCurveSize; i++) {
+    float value = static_cast<float>(i) / (kToneCurveSize - 1);
+    tone_curves_[static_cast<size_t>(ToneCurve::kSrgb)][i] =
+        255.0f * (value <= 0.0031308f
+                      ? value * 12.92f
+                      : 1.055f * std::pow(value, 0.4166667f) - 0.055f);
+    tone_curves_[static_cast<size_t>(ToneCurve::kSmpte170m)][i] =
+        255.0f * (value <= 0.018f ? value * 4.5f
+                                  : 1.099f * std::pow(value, 0.45f) - 0.099f);
+    tone_curves_[static_cast<size_t>(ToneCurve::kHlg)][i] =
+        255.0f * 0.5f * std::sqrt(value);
+  }
+}
+
+EmulatedIsp::~EmulatedIsp() {
+  for (size_t i = 0; i < stats_.size(); i++) {
+    if (stats_[i].frames > 0) {
+      ALOGI("%s: %" PRIu64
+            " frames with defect correction %s, %.2f ms on average, %.2f ms "
+            "at most",
+            __FUNCTION__, stats_[i].frames, kDefectCorrectionNames[i],
+            ns2us(stats_[i].total_duration) / (1000.0 * stats_[i].frames),
+            ns2us(stats_[i].max_duration) / 1000.0);
+    }
+  }
+}
+
+status_t EmulatedIsp::ProcessRAW16(const uint16_t* raw,
+                                   size_t raw_stride_in_bytes, uint32_t width,
+                                   uint32_t height, const Params& params,
+                                   const YCbCrPlanes& output) {
+  ATRACE_CALL();
+  if (raw == nullptr || output.img_y == nullptr ||
+      output.img_cb == nullptr || output.img_cr == nullptr) {
+    ALOGE("%s: Missing input or output image", __FUNCTION__);
+    return BAD_VALUE;
+  }
+  if ((width % 2) != 0 || (height % 2) != 0 || width <= kBorder ||
+      height <= kBorder || raw_stride_in_bytes < width * sizeof(uint16_t)) {
+    ALOGE("%s: Unsupported RAW16 image %ux%u with stride %zu", __FUNCTION__,
+          width, height, raw_stride_in_bytes);
+    return BAD_VALUE;
+  }
+  if (output.bytesPerPixel != 1) {
+    ALOGE("%s: Unsupported bytes per pixel value: %zu", __FUNCTION__,
+          output.bytesPerPixel);
+    return BAD_VALUE;
+  }
+  if (params.white_level == 0) {
+    ALOGE("%s: Invalid white level", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  nsecs_t start_time = systemTime(SYSTEM_TIME_MONOTONIC);
+  Job job{.raw = raw,
+          .raw_stride = raw_stride_in_bytes,
+          .width = width,
+          .height = height,
+          .params = &params,
+          .tone_curve =
+              tone_curves_[static_cast<size_t>(params.tone_curve)].data(),
+          .output = &output};
+  uint32_t num_strips = (height + kStripHeight - 1) / kStripHeight;
+  std::atomic<uint32_t> next_strip = 0;
+  auto worker = [&](uint32_t id) {
+    for (uint32_t strip = next_strip++; strip < num_strips;
+         strip = next_strip++) {
+      ProcessStrip(job, strip * kStripHeight, &scratch_[id]);
+    }
+  };
+
+  // The tasks of a client run one at a time, every worker has its own.
+  std::mutex done_lock;
+  std::condition_variable done_condition;
+  uint32_t pending_workers = 0;
+  std::unique_lock<std::mutex> lock(done_lock);
+  for (uint32_t id = 1; id < std::min(num_threads_, num_strips); id++) {
+    auto ret = pool_->Queue(pool_clients_[id - 1], start_time, [&, id]() {
+      worker(id);
+      std::lock_guard<std::mutex> worker_lock(done_lock);
+      pending_workers--;
+      done_condition.notify_one();
+    });
+    if (ret == OK) {
+      pending_workers++;
+    }
+  }
+  lock.unlock();
+  worker(0);
+  lock.lock();
+  done_condition.wait(lock, [&pending_workers] {
+    return pending_workers == 0;
+  });
+
+  nsecs_t duration = systemTime(SYSTEM_TIME_MONOTONIC) - start_time;
+  auto& stats = stats_[static_cast<size_t>(params.defect_correction)];
+  stats.frames++;
+  stats.total_duration += duration;
+  stats.max_duration = std::max(stats.max_duration, duration);
+
+  return OK;
+}
+
+status_t EmulatedIsp::CorrectLumaDefects(const YCbCrPlanes& planes,
+                                         uint32_t width, uint32_t height,
+                                         DefectCorrection mode) {
+  ATRACE_CALL();
+  if (planes.img_y == nullptr || planes.bytesPerPixel != 1 || width < 2 ||
+      height < 2) {
+    ALOGE("%s: Unsupported luma plane %ux%u", __FUNCTION__, width, height);
+    return BAD_VALUE;
+  }
+  if (mode == DefectCorrection::kOff) {
+    return OK;
+  }
+
+  const int32_t w = width;
+  const int32_t h = height;
+  const bool high_quality = mode == DefectCorrection::kHighQuality;
+  auto luma_row = [&planes](int32_t i) {
+    return planes.img_y + static_cast<size_t>(i) * planes.y_stride;
+  };
+  // Rows y - 1 and y before their correction.
+  std::vector<uint8_t> previous(width), current(width);
+  for (int32_t y = 0; y < h; y++) {
+    uint8_t* row = luma_row(y);
+    std::copy(row, row + w, current.begin());
+    const uint8_t* up = y > 0 ? previous.data() : luma_row(1);
+    const uint8_t* mid = current.data();
+    const uint8_t* down = y < h - 1 ? luma_row(y + 1) : previous.data();
+
+    auto correct = [=](int32_t x, int32_t left, int32_t right) {
+      int32_t low = std::min(std::min(mid[left], mid[right]),
+                             std::min(up[x], down[x]));
+      int32_t high = std::max(std::max(mid[left], mid[right]),
+                              std::max(up[x], down[x]));
+      if (high_quality) {
+        low = std::min<int32_t>(
+            low, std::min(std::min(up[left], up[right]),
+                          std::min(down[left], down[right])));
+        high = std::max<int32_t>(
+            high, std::max(std::max(up[left], up[right]),
+                           std::max(down[left], down[right])));
+      }
+      int32_t margin = (high - low) / 2;
+      return static_cast<uint8_t>(
+          std::clamp<int32_t>(mid[x], low - margin, high + margin));
+    };
+    row[0] = correct(0, 1, 1);
+    for (int32_t x = 1; x < w - 1; x++) {
+      row[x] = correct(x, x - 1, x + 1);
+    }
+    row[w - 1] = correct(w - 1, w - 2, w - 2);
+    std::swap(previous, current);
+  }
+
+  return OK;
+}
+
+void EmulatedIsp::ProcessStrip(const Job& job, uint32_t top,
+                               Scratch* scratch) {
+  uint32_t rows = std::min(kStripHeight, job.height - top);
+  size_t stride = job.width + 2 * kBorder;
+  size_t strip_size = (rows + 2 * kBorder) * stride;
+  scratch->cfa.resize(strip_size);
+  scratch->green.resize(strip_size);
+  scratch->row_gain.resize(job.width);
+  scratch->row_black.resize(job.width);
+  for (auto& plane : scratch->rgb) {
+    plane.resize(job.width);
+  }
+
+  // Rows of the strip and its border, mirrored at the image edges. Strips
+  // start at even rows and the border is even, so even rows of the buffers
+  // are R/Gr rows.
+  for (uint32_t i = 0; i < rows + 2 * kBorder; i++) {
+    int32_t y = Reflect(static_cast<int32_t>(top + i) -
+                            static_cast<int32_t>(kBorder),
+                        job.height);
+    float* cfa = &scratch->cfa[i * stride + kBorder];
+    NormalizeRow(job, y, scratch->row_gain.data(), scratch->row_black.data(),
+                 cfa);
+    for (int32_t k = 1; k <= static_cast<int32_t>(kBorder); k++) {
+      cfa[-k] = cfa[k];
+      cfa[job.width - 1 + k] = cfa[job.width - 1 - k];
+    }
+  }
+
+  // Green of the strip and one row and column around it, for the color
+  // differences of the red and blue interpolation.
+  for (uint32_t i = kBorder - 1; i < rows + kBorder + 1; i++) {
+    InterpolateGreenRow(&scratch->cfa[i * stride + kBorder], stride,
+                        (i % 2) == 0, -2, job.width + 2,
+                        &scratch->green[i * stride + kBorder]);
+  }
+
+  float* rgb[6];
+  for (size_t c = 0; c < 6; c++) {
+    rgb[c] = scratch->rgb[c].data();
+  }
+  for (uint32_t i = kBorder; i < rows + kBorder; i += 2) {
+    for (uint32_t row = 0; row < 2; row++) {
+      size_t offset = (i + row) * stride + kBorder;
+      float* r = rgb[row * 3];
+      float* g = rgb[row * 3 + 1];
+      float* b = rgb[row * 3 + 2];
+      InterpolateRedBlueRow(&scratch->cfa[offset], &scratch->green[offset],
+                            stride, row == 0, job.width, r, g, b);
+      ColorCorrectRow(*job.params, job.tone_curve, job.width, r, g, b);
+    }
+    ConvertRowsToYuv(*job.output, top + i - kBorder, job.width, rgb);
+  }
+}
+
+void EmulatedIsp::NormalizeRow(const Job& job, uint32_t y, float* row_gain,
+                               float* row_black, float* cfa) {
+  const Params& params = *job.params;
+  // Channel of the even pixels, the odd pixels are the next channel.
+  uint32_t channel = (y % 2) == 0 ? 0 : 2;
+  float gain[2] = {params.wb_gains[channel] / params.white_level,
+                   params.wb_gains[channel + 1] / params.white_level};
+  for (uint32_t x = 0; x < job.width; x += 2) {
+    row_gain[x] = gain[0];
+    row_gain[x + 1] = gain[1];
+    row_black[x] = params.black_level[channel];
+    row_black[x + 1] = params.black_level[channel + 1];
+  }
+
+  if (params.lens_shading_map != nullptr) {
+    uint32_t map_width = params.lens_shading_map_size[0];
+    uint32_t map_height = params.lens_shading_map_size[1];
+    float map_y = static_cast<float>(y) * (map_height - 1) / (job.height - 1);
+    uint32_t y0 = std::min(static_cast<uint32_t>(map_y), map_height - 1);
+    uint32_t y1 = std::min(y0 + 1, map_height - 1);
+    float wy = map_y - y0;
+    const float* map_row0 = params.lens_shading_map + y0 * map_width * 4;
+    const float* map_row1 = params.lens_shading_map + y1 * map_width * 4;
+    for (uint32_t x = 0; x < job.width; x++) {
+      uint32_t c = channel + (x % 2);
+      float map_x = static_cast<float>(x) * (map_width - 1) / (job.width - 1);
+      uint32_t x0 = std::min(static_cast<uint32_t>(map_x), map_width - 1);
+      uint32_t x1 = std::min(x0 + 1, map_width - 1);
+      float wx = map_x - x0;
+      float top = map_row0[x0 * 4 + c] * (1 - wx) + map_row0[x1 * 4 + c] * wx;
+      float bottom =
+          map_row1[x0 * 4 + c] * (1 - wx) + map_row1[x1 * 4 + c] * wx;
+      row_gain[x] *= top * (1 - wy) + bottom * wy;
+    }
+  }
+
+  if (params.defect_correction == DefectCorrection::kOff) {
+    const uint16_t* raw = reinterpret_cast<const uint16_t*>(
+        reinterpret_cast<const uint8_t*>(job.raw) + y * job.raw_stride);
+    for (uint32_t x = 0; x < job.width; x++) {
+      cfa[x] = raw[x];
+    }
+  } else {
+    CorrectDefectsRow(job, y, cfa);
+  }
+  for (uint32_t x = 0; x < job.width; x++) {
+    cfa[x] = (cfa[x] - row_black[x]) * row_gain[x];
+  }
+}
+
+void EmulatedIsp::CorrectDefectsRow(const Job& job, uint32_t y, float* row) {
+  const int32_t width = job.width;
+  const int32_t height = job.height;
+  auto raw_row = [&job](int32_t i) {
+    return reinterpret_cast<const uint16_t*>(
+        reinterpret_cast<const uint8_t*>(job.raw) + i * job.raw_stride);
+  };
+  const uint16_t* up = raw_row(Neighbor(y, -2, height));
+  const uint16_t* mid = raw_row(y);
+  const uint16_t* down = raw_row(Neighbor(y, 2, height));
+  const bool high_quality =
+      job.params->defect_correction == DefectCorrection::kHighQuality;
+
+  // The neighbors of the same color are two rows and columns away.
+  auto correct = [=](int32_t x, int32_t left, int32_t right) {
+    uint16_t low = std::min(std::min(mid[left], mid[right]),
+                            std::min(up[x], down[x]));
+    uint16_t high = std::max(std::max(mid[left], mid[right]),
+                             std::max(up[x], down[x]));
+    if (high_quality) {
+      low = std::min(low, std::min(std::min(up[left], up[right]),
+                                   std::min(down[left], down[right])));
+      high = std::max(high, std::max(std::max(up[left], up[right]),
+                                     std::max(down[left], down[right])));
+    }
+    // Pixels a little outside the range are likely details of the scene.
+    int32_t margin = (high - low) / 2;
+    return static_cast<float>(
+        std::clamp<int32_t>(mid[x], low - margin, high + margin));
+  };
+
+  // Mirror the columns only at the edges, so the interior loop vectorizes.
+  for (int32_t x = 0; x < 2; x++) {
+    row[x] = correct(x, Neighbor(x, -2, width), x + 2);
+  }
+  for (int32_t x = 2; x < width - 2; x++) {
+    row[x] = correct(x, x - 2, x + 2);
+  }
+  for (int32_t x = width - 2; x < width; x++) {
+    row[x] = correct(x, x - 2, Neighbor(x, 2, width));
+  }
+}
+
+void EmulatedIsp::InterpolateGreenRow(const float* cfa, size_t stride,
+                                      bool red_row, int32_t begin,
+                                      int32_t end, float* green) {
+  const ptrdiff_t s = stride;
+  // Red rows have red at even columns, blue rows have green there.
+  int32_t color_offset = red_row ? 0 : 1;
+  for (int32_t x = begin; x < end; x += 2) {
+    int32_t g = x + 1 - color_offset;
+    green[g] = cfa[g];
+
+    // Hamilton-Adams: the green gradient plus the color Laplacian, and the
+    // green average corrected by the color Laplacian, in each direction.
+    int32_t c = x + color_offset;
+    float laplacian_h = 2 * cfa[c] - cfa[c - 2] - cfa[c + 2];
+    float laplacian_v = 2 * cfa[c] - cfa[c - 2 * s] - cfa[c + 2 * s];
+    float gradient_h = std::fabs(cfa[c - 1] - cfa[c + 1]) +
+                       std::fabs(laplacian_h);
+    float gradient_v = std::fabs(cfa[c - s] - cfa[c + s]) +
+                       std::fabs(laplacian_v);
+    float green_h = (cfa[c - 1] + cfa[c + 1]) * 0.5f + laplacian_h * 0.25f;
+    float green_v = (cfa[c - s] + cfa[c + s]) * 0.5f + laplacian_v * 0.25f;
+    float weight_h = gradient_h < gradient_v   ? 1.0f
+                     : gradient_v < gradient_h ? 0.0f
+                                               : 0.5f;
+    green[c] = green_h * weight_h + green_v * (1.0f - weight_h);
+  }
+}
+
+void EmulatedIsp::InterpolateRedBlueRow(const float* cfa, const float* green,
+                                        size_t stride, bool red_row,
+                                        uint32_t width, float* r, float* g,
+                                        float* b) {
+  const ptrdiff_t s = stride;
+  // Color difference of the pixel at offset i from cfa.
+  auto diff = [cfa, green](ptrdiff_t i) { return cfa[i] - green[i]; };
+  // On red rows the even pixels are red and the rows above and below hold
+  // blue at odd pixels. Blue rows mirror that, so interpolate "same" (the
+  // color of the row) and "other" and swap them on blue rows.
+  float* same = red_row ? r : b;
+  float* other = red_row ? b : r;
+  int32_t color_offset = red_row ? 0 : 1;
+  for (int32_t x = 0; x < static_cast<int32_t>(width); x += 2) {
+    int32_t c = x + color_offset;
+    g[c] = green[c];
+    same[c] = cfa[c];
+    other[c] = green[c] + (diff(c - s - 1) + diff(c - s + 1) +
+                           diff(c + s - 1) + diff(c + s + 1)) *
+                              0.25f;
+
+    int32_t n = x + 1 - color_offset;
+    g[n] = cfa[n];
+    same[n] = green[n] + (diff(n - 1) + diff(n + 1)) * 0.5f;
+    other[n] = green[n] + (diff(n - s) + diff(n + s)) * 0.5f;
+  }
+}
+
+void EmulatedIsp::ColorCorrectRow(const Params& params,
+                                  const float* tone_curve, uint32_t width,
+                                  float* r, float* g, float* b) {
+  const float(&m)[3][3] = params.ccm;
+  const float max_index = kToneCurveSize - 1;
+  for (uint32_t x = 0; x < width; x++) {
+    float out_r = m[0][0] * r[x] + m[0][1] * g[x] + m[0][2] * b[x];
+    float out_g = m[1][0] * r[x] + m[1][1] * g[x] + m[1][2] * b[x];
+    float out_b = m[2][0] * r[x] + m[2][1] * g[x] + m[2][2] * b[x];
+    r[x] = std::clamp(out_r, 0.0f, 1.0f) * max_index + 0.5f;
+    g[x] = std::clamp(out_g, 0.0f, 1.0f) * max_index + 0.5f;
+    b[x] = std::clamp(out_b, 0.0f, 1.0f) * max_index + 0.5f;
+  }
+  for (uint32_t x = 0; x < width; x++) {
+    r[x] = tone_curve[static_cast<uint32_t>(r[x])];
+    g[x] = tone_curve[static_cast<uint32_t>(g[x])];
+    b[x] = tone_curve[static_cast<uint32_t>(b[x])];
+  }
+}
+
+void EmulatedIsp::ConvertRowsToYuv(const YCbCrPlanes& output, uint32_t y,
+                                   uint32_t width, float* const rgb[6]) {
+  // JFIF RGB to YCbCr, like EmulatedSensor::CaptureYUV420().
+  for (uint32_t row = 0; row < 2; row++) {
+    const float* r = rgb[row * 3];
+    const float* g = rgb[row * 3 + 1];
+    const float* b = rgb[row * 3 + 2];
+    uint8_t* out_y = output.img_y + (y + row) * output.y_stride;
+    for (uint32_t x = 0; x < width; x++) {
+      out_y[x] = static_cast<uint8_t>(0.299f * r[x] + 0.587f * g[x] +
+                                      0.114f * b[x] + 0.5f);
+    }
+  }
+
+  uint8_t* out_cb = output.img_cb + (y / 2) * output.cbcr_stride;
+  uint8_t* out_cr = output.img_cr + (y / 2) * output.cbcr_stride;
+  for (uint32_t x = 0; x < width; x += 2) {
+    float r = (rgb[0][x] + rgb[0][x + 1] + rgb[3][x] + rgb[3][x + 1]) * 0.25f;
+    float g = (rgb[1][x] + rgb[1][x + 1] + rgb[4][x] + rgb[4][x + 1]) * 0.25f;
+    float b = (rgb[2][x] + rgb[2][x + 1] + rgb[5][x] + rgb[5][x + 1]) * 0.25f;
+    float cb = -0.168736f * r - 0.331264f * g + 0.5f * b + 128.5f;
+    float cr = 0.5f * r - 0.418688f * g - 0.081312f * b + 128.5f;
+    out_cb[(x / 2) * output.cbcr_step] =
+        static_cast<uint8_t>(std::clamp(cb, 0.0f, 255.0f));
+    out_cr[(x / 2) * output.cbcr_step] =
+        static_cast<uint8_t>(std::clamp(cr, 0.0f, 255.0f));
+  }
+}
+
+}  // namespace android
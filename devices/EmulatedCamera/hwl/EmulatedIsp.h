@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * EmulatedIsp develops RGGB RAW16 images into YUV420 like the ISP of a real
+ * camera: defect pixel correction, black level subtraction, lens shading
+ * correction, white balance, edge-aware demosaic, color correction, tone
+ * mapping and RGB to YUV conversion.
+ *
+ * Images are processed in strips of rows, which keeps the intermediate
+ * planes in cache and lets several worker threads process one image. Each
+ * stage is a loop over float rows that the compiler can vectorize.
+ */
+
+#ifndef HW_EMULATOR_CAMERA_ISP_H
+#define HW_EMULATOR_CAMERA_ISP_H
+
+#include <utils/Errors.h>
+#include <utils/Timers.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Base.h"
+#include "EmulatedRenderPool.h"
+
+namespace android {
+
+class EmulatedIsp {
+ public:
+  enum class ToneCurve { kSrgb, kSmpte170m, kHlg };
+  // Defective pixels are clamped to the range of the 4 nearest pixels of the
+  // same color in kFast, and of the 8 nearest in kHighQuality.
+  enum class DefectCorrection { kOff, kFast, kHighQuality };
+
+  struct Params {
+    // Black level of the R, Gr, Gb and B pixels.
+    uint32_t black_level[4] = {0};
+    // Signal of a saturated pixel above the black level.
+    uint32_t white_level = 0;
+    // White balance gains of the R, Gr, Gb and B pixels.
+    float wb_gains[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    // Row major matrix from white balanced camera RGB to output RGB.
+    float ccm[3][3] = {{1.0f, 0, 0}, {0, 1.0f, 0}, {0, 0, 1.0f}};
+    // Optional R, Gr, Gb, B gain map in the android.statistics.lensShadingMap
+    // layout, stretched over the image.
+    const float* lens_shading_map = nullptr;
+    uint32_t lens_shading_map_size[2] = {0};
+    ToneCurve tone_curve = ToneCurve::kSrgb;
+    DefectCorrection defect_correction = DefectCorrection::kOff;
+  };
+
+  // Create an ISP that processes images with num_threads threads, including
+  // the calling thread. 0 selects a count based on the number of CPUs. The
+  // other threads are started once and kept for the lifetime of the ISP.
+  static std::unique_ptr<EmulatedIsp> Create(uint32_t num_threads = 0);
+
+  ~EmulatedIsp();
+
+  // Develop the width x height RGGB image raw into output, which must have
+  // 8-bit samples. Width and height must be even. Not thread safe.
+  status_t ProcessRAW16(const uint16_t* raw, size_t raw_stride_in_bytes,
+                        uint32_t width, uint32_t height, const Params& params,
+                        const YCbCrPlanes& output);
+
+  // Correct the defects of the 8-bit luma plane of a width x height YUV
+  // image in place, like ProcessRAW16 does with the RAW pixels. Luma has no
+  // color pattern, so the neighbors are the adjacent pixels.
+  static status_t CorrectLumaDefects(const YCbCrPlanes& planes,
+                                     uint32_t width, uint32_t height,
+                                     DefectCorrection mode);
+
+  uint32_t GetNumThreads() const {
+    return num_threads_;
+  }
+
+ private:
+  // Rows per strip. Even, so every strip starts on an R/Gr row.
+  static constexpr uint32_t kStripHeight = 32;
+  // Rows and columns of mirrored border around each strip.
+  static constexpr uint32_t kBorder = 4;
+  static constexpr uint32_t kToneCurveSize = 4096;
+
+  // Per thread intermediate planes of a strip.
+  struct Scratch {
+    std::vector<float> cfa;
+    std::vector<float> green;
+    std::vector<float> row_gain;
+    std::vector<float> row_black;
+    std::array<std::vector<float>, 6> rgb;
+  };
+
+  // Cost of the images processed with one defect correction mode.
+  struct Stats {
+    uint64_t frames = 0;
+    nsecs_t total_duration = 0;
+    nsecs_t max_duration = 0;
+  };
+
+  struct Job {
+    const uint16_t* raw;
+    size_t raw_stride;
+    uint32_t width;
+    uint32_t height;
+    const Params* params;
+    const float* tone_curve;
+    const YCbCrPlanes* output;
+  };
+
+  explicit EmulatedIsp(uint32_t num_threads);
+
+  void ProcessStrip(const Job& job, uint32_t top, Scratch* scratch);
+
+  // Defect correction, black level, lens shading and white balance of one
+  // row into cfa.
+  static void NormalizeRow(const Job& job, uint32_t y, float* row_gain,
+                           float* row_black, float* cfa);
+
+  // Clamp each pixel of row y to the range of its neighbors of the same
+  // color, into row.
+  static void CorrectDefectsRow(const Job& job, uint32_t y, float* row);
+
+  // Interpolate the missing greens of a row along the direction with the
+  // smaller gradient.
+  static void InterpolateGreenRow(const float* cfa, size_t stride,
+                                  bool red_row, int32_t begin, int32_t end,
+                                  float* green);
+
+  // Interpolate red and blue of a row from the color differences of the
+  // neighboring pixels.
+  static void InterpolateRedBlueRow(const float* cfa, const float* green,
+                                    size_t stride, bool red_row,
+                                    uint32_t width, float* r, float* g,
+                                    float* b);
+
+  // Color correction and tone mapping of a row, in place.
+  static void ColorCorrectRow(const Params& params, const float* tone_curve,
+                              uint32_t width, float* r, float* g, float* b);
+
+  // Write the Y rows and the subsampled CbCr row of two rows.
+  static void ConvertRowsToYuv(const YCbCrPlanes& output, uint32_t y,
+                               uint32_t width, float* const rgb[6]);
+
+  const uint32_t num_threads_;
+  std::vector<Scratch> scratch_;
+  std::array<std::vector<float>, 3> tone_curves_;
+  // Indexed by DefectCorrection.
+  std::array<Stats, 3> stats_;
+  // Workers besides the calling thread, with one client per worker so the
+  // strips run in parallel. Destroyed first, with the workers.
+  std::unique_ptr<EmulatedRenderPool> pool_;
+  std::vector<uint32_t> pool_clients_;
+};
+
+}  // namespace android
+
+#endif  // HW_EMULATOR_CAMERA_ISP_H
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "EmulatedLensShading"
+#include "EmulatedLensShading.h"
+
+#include <log/log.h>
+#include <utils/Trace.h>
+
+namespace android {
+
+// Half diagonal of the sensor over the focal length, used if the lens or the
+// sensor size is unknown. Matches a lens with a 62 degree diagonal field of
+// view.
+static const float kDefaultHalfDiagonal = 0.6f;
+
+std::unique_ptr<EmulatedLensShading> EmulatedLensShading::Create(
+    float focal_length, const float physical_size[2], uint32_t map_width,
+    uint32_t map_height) {
+  if ((map_width < 2) || (map_height < 2)) {
+    ALOGE("%s: Invalid lens shading map size %ux%u", __FUNCTION__, map_width,
+          map_height);
+    return nullptr;
+  }
+
+  float half_width, half_height;
+  if ((focal_length > 0) && (physical_size[0] > 0) && (physical_size[1] > 0)) {
+    half_width = physical_size[0] / (2 * focal_length);
+    half_height = physical_size[1] / (2 * focal_length);
+  } else {
+    // Assume a 4:3 sensor.
+    half_width = kDefaultHalfDiagonal * 0.8f;
+    half_height = kDefaultHalfDiagonal * 0.6f;
+  }
+
+  return std::unique_ptr<EmulatedLensShading>(
+      new EmulatedLensShading(half_width, half_height, map_width, map_height));
+}
+
+std::shared_ptr<const std::vector<float>> EmulatedLensShading::GetMap(
+    float zoom_ratio) {
+  auto it = maps_.find(zoom_ratio);
+  if (it != maps_.end()) {
+    return it->second;
+  }
+
+  ATRACE_CALL();
+  if (maps_.size() >= kMaxCachedTables) {
+    maps_.clear();
+  }
+
+  // The map samples include the borders of the area.
+  auto map = std::make_shared<std::vector<float>>(map_width_ * map_height_ * 4);
+  float* gains = map->data();
+  for (uint32_t y = 0; y < map_height_; y++) {
+    float v = (static_cast<float>(y) / (map_height_ - 1) - 0.5f) * 2 *
+              half_height_ / zoom_ratio;
+    for (uint32_t x = 0; x < map_width_; x++) {
+      float u = (static_cast<float>(x) / (map_width_ - 1) - 0.5f) * 2 *
+                half_width_ / zoom_ratio;
+      float r2 = u * u + v * v;
+      for (uint32_t c = 0; c < 4; c++) {
+        *gains++ = 1.0f / GetIllumination(c, r2);
+      }
+    }
+  }
+
+  maps_[zoom_ratio] = map;
+  return map;
+}
+
+std::shared_ptr<const EmulatedLensShading::Falloff>
+EmulatedLensShading::GetFalloff(uint32_t width, uint32_t height,
+                                float zoom_ratio) {
+  auto key = std::make_tuple(width, height, zoom_ratio);
+  auto it = falloffs_.find(key);
+  if (it != falloffs_.end()) {
+    return it->second;
+  }
+
+  ATRACE_CALL();
+  if (falloffs_.size() >= kMaxCachedTables) {
+    falloffs_.clear();
+  }
+
+  // Distances are measured at the pixel centers.
+  auto falloff = std::make_shared<Falloff>();
+  falloff->column_r2.resize(width);
+  for (uint32_t x = 0; x < width; x++) {
+    float u = ((x + 0.5f) / width - 0.5f) * 2 * half_width_ / zoom_ratio;
+    falloff->column_r2[x] = u * u;
+  }
+  falloff->row_r2.resize(height);
+  for (uint32_t y = 0; y < height; y++) {
+    float v = ((y + 0.5f) / height - 0.5f) * 2 * half_height_ / zoom_ratio;
+    falloff->row_r2[y] = v * v;
+  }
+
+  falloffs_[key] = falloff;
+  return falloff;
+}
+
+}  // namespace android
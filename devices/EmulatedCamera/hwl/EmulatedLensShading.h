@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * EmulatedLensShading models the vignetting of the emulated lens. The
+ * relative illumination follows the cos^4 law of the field angle, which is
+ * derived from the focal length and the physical size of the sensor. Red and
+ * blue fall off faster than green, like behind a real IR cut filter.
+ *
+ * The RAW render attenuates the scene by the relative illumination and the
+ * software ISP corrects it with the android.statistics.lensShadingMap gains,
+ * which are the inverse. Maps and render tables are computed once per size
+ * and zoom and cached.
+ *
+ * Not thread safe.
+ */
+
+#ifndef HW_EMULATOR_CAMERA_LENS_SHADING_H
+#define HW_EMULATOR_CAMERA_LENS_SHADING_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace android {
+
+class EmulatedLensShading {
+ public:
+  // Render table of one image size and zoom.
+  struct Falloff {
+    // Squared distance of each column and row from the optical center, in
+    // units of the focal length.
+    std::vector<float> column_r2;
+    std::vector<float> row_r2;
+  };
+
+  // Create the model of a lens with the focal length in mm over a sensor of
+  // physical_size mm, which are 0 if unknown. The shading map has
+  // map_width x map_height samples.
+  static std::unique_ptr<EmulatedLensShading> Create(
+      float focal_length, const float physical_size[2], uint32_t map_width,
+      uint32_t map_height);
+
+  // R, Gr, Gb, B gains in the android.statistics.lensShadingMap layout over
+  // the part of the active array seen at zoom_ratio. All gains are >= 1. The
+  // map stays valid while the caller holds it, even if it is dropped from
+  // the cache.
+  std::shared_ptr<const std::vector<float>> GetMap(float zoom_ratio);
+
+  // Render table of a width x height image of the part of the active array
+  // seen at zoom_ratio. Held like the map.
+  std::shared_ptr<const Falloff> GetFalloff(uint32_t width, uint32_t height,
+                                            float zoom_ratio);
+
+  // Relative illumination of the R, Gr, Gb or B channel at r2 from the
+  // Falloff table.
+  float GetIllumination(uint32_t channel, float r2) const {
+    float d = 1.0f + channel_falloff_[channel] * r2;
+    return 1.0f / (d * d);
+  }
+
+  uint32_t GetMapWidth() const {
+    return map_width_;
+  }
+
+  uint32_t GetMapHeight() const {
+    return map_height_;
+  }
+
+ private:
+  // Tables for more zoom ratios are dropped and computed again.
+  static constexpr size_t kMaxCachedTables = 8;
+
+  EmulatedLensShading(float half_width, float half_height, uint32_t map_width,
+                      uint32_t map_height)
+      : half_width_(half_width),
+        half_height_(half_height),
+        map_width_(map_width),
+        map_height_(map_height) {
+  }
+
+  // Half of the active array size in units of the focal length.
+  const float half_width_;
+  const float half_height_;
+  const uint32_t map_width_;
+  const uint32_t map_height_;
+  // Falloff speed of R, Gr, Gb and B relative to green.
+  const float channel_falloff_[4] = {1.15f, 1.0f, 1.0f, 1.08f};
+
+  std::map<float, std::shared_ptr<const std::vector<float>>> maps_;
+  std::map<std::tuple<uint32_t, uint32_t, float>,
+           std::shared_ptr<const Falloff>>
+      falloffs_;
+
+  EmulatedLensShading(const EmulatedLensShading&) = delete;
+  EmulatedLensShading& operator=(const EmulatedLensShading&) = delete;
+};
+
+}  // namespace android
+
+#endif  // HW_EMULATOR_CAMERA_LENS_SHADING_H
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "EmulatedPixelDefects"
+#include "EmulatedPixelDefects.h"
+
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace android {
+
+std::unique_ptr<EmulatedPixelDefects> EmulatedPixelDefects::Create(
+    uint32_t width, uint32_t height, uint32_t seed) {
+  if ((width <= 2 * kMinDefectDistance) || (height <= 2 * kMinDefectDistance)) {
+    ALOGE("%s: Pixel array %ux%u too small for defects", __FUNCTION__, width,
+          height);
+    return nullptr;
+  }
+
+  // std::minstd_rand produces the same sequence on every platform, unlike
+  // the standard distributions.
+  std::minstd_rand random(seed + 1);
+  uint64_t pixel_count = static_cast<uint64_t>(width) * height;
+  size_t defect_count =
+      std::max<uint64_t>(1, pixel_count * kDefectsPerMegapixel / 1000000);
+  std::vector<Defect> defects;
+  defects.reserve(defect_count);
+  // Candidates too close to a previous defect are skipped, give up after a
+  // bounded number of attempts on small arrays.
+  for (size_t attempt = 0;
+       (defects.size() < defect_count) && (attempt < defect_count * 4);
+       attempt++) {
+    Defect defect = {.x = static_cast<uint32_t>(random() % width),
+                     .y = static_cast<uint32_t>(random() % height),
+                     .hot = (random() % 2) == 0};
+    bool isolated = std::none_of(
+        defects.begin(), defects.end(), [&defect](const Defect& other) {
+          return (std::abs(static_cast<int64_t>(other.x) - defect.x) <
+                  kMinDefectDistance) &&
+                 (std::abs(static_cast<int64_t>(other.y) - defect.y) <
+                  kMinDefectDistance);
+        });
+    if (isolated) {
+      defects.push_back(defect);
+    }
+  }
+
+  return std::unique_ptr<EmulatedPixelDefects>(
+      new EmulatedPixelDefects(width, height, std::move(defects)));
+}
+
+EmulatedPixelDefects::EmulatedPixelDefects(uint32_t width, uint32_t height,
+                                           std::vector<Defect> defects)
+    : width_(width), height_(height), defects_(std::move(defects)) {
+  hot_pixel_map_.reserve(defects_.size() * 2);
+  for (const auto& defect : defects_) {
+    hot_pixel_map_.push_back(defect.x);
+    hot_pixel_map_.push_back(defect.y);
+  }
+}
+
+std::shared_ptr<const std::vector<EmulatedPixelDefects::Defect>>
+EmulatedPixelDefects::GetDefects(uint32_t width, uint32_t height,
+                                 float zoom_ratio) {
+  auto key = std::make_tuple(width, height, zoom_ratio);
+  auto it = image_defects_.find(key);
+  if (it != image_defects_.end()) {
+    return it->second;
+  }
+
+  ATRACE_CALL();
+  if (image_defects_.size() >= kMaxCachedTables) {
+    image_defects_.clear();
+  }
+
+  // Each defect spoils the image pixel that covers its center.
+  auto image_defects = std::make_shared<std::vector<Defect>>();
+  const float left_top = 0.5f - 0.5f / zoom_ratio;
+  for (const auto& defect : defects_) {
+    float x = ((defect.x + 0.5f) / width_ - left_top) * width * zoom_ratio;
+    float y = ((defect.y + 0.5f) / height_ - left_top) * height * zoom_ratio;
+    if ((x >= 0) && (x < width) && (y >= 0) && (y < height)) {
+      image_defects->push_back({.x = static_cast<uint32_t>(x),
+                                .y = static_cast<uint32_t>(y),
+                                .hot = defect.hot});
+    }
+  }
+  std::sort(image_defects->begin(), image_defects->end(),
+            [](const Defect& a, const Defect& b) {
+              return std::tie(a.y, a.x) < std::tie(b.y, b.x);
+            });
+
+  image_defects_[key] = image_defects;
+  return image_defects;
+}
+
+}  // namespace android
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * EmulatedPixelDefects places hot pixels, which always read saturated, and
+ * dead pixels, which always read black, on the pixel array of the emulated
+ * sensor. The defects are generated from a seed, so a camera has the same
+ * defects every time it is opened.
+ *
+ * Defects are at least kMinDefectDistance pixels apart, so each defect can
+ * be corrected from its neighbors of the same color. The RAW and YUV
+ * renders overwrite the defective pixels and results report them in
+ * android.statistics.hotPixelMap.
+ *
+ * Not thread safe.
+ */
+
+#ifndef HW_EMULATOR_CAMERA_PIXEL_DEFECTS_H
+#define HW_EMULATOR_CAMERA_PIXEL_DEFECTS_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace android {
+
+class EmulatedPixelDefects {
+ public:
+  struct Defect {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    // Saturated if true, black otherwise.
+    bool hot = false;
+  };
+
+  // Create the defects of a width x height pixel array.
+  static std::unique_ptr<EmulatedPixelDefects> Create(uint32_t width,
+                                                      uint32_t height,
+                                                      uint32_t seed);
+
+  // The x, y pairs of the defects in the pixel array, in the
+  // android.statistics.hotPixelMap layout.
+  const std::vector<int32_t>& GetHotPixelMap() const {
+    return hot_pixel_map_;
+  }
+
+  // Defects of a width x height image of the part of the pixel array seen
+  // at zoom_ratio, sorted by row and column. The table stays valid while
+  // the caller holds it, even if it is dropped from the cache.
+  std::shared_ptr<const std::vector<Defect>> GetDefects(uint32_t width,
+                                                        uint32_t height,
+                                                        float zoom_ratio);
+
+ private:
+  // Defects per million pixels.
+  static constexpr uint32_t kDefectsPerMegapixel = 20;
+  // Minimum distance between two defects in rows and columns.
+  static constexpr uint32_t kMinDefectDistance = 5;
+  // Tables for more image sizes are dropped and computed again.
+  static constexpr size_t kMaxCachedTables = 8;
+
+  EmulatedPixelDefects(uint32_t width, uint32_t height,
+                       std::vector<Defect> defects);
+
+  const uint32_t width_;
+  const uint32_t height_;
+  // Defects in the pixel array.
+  const std::vector<Defect> defects_;
+  std::vector<int32_t> hot_pixel_map_;
+
+  std::map<std::tuple<uint32_t, uint32_t, float>,
+           std::shared_ptr<const std::vector<Defect>>>
+      image_defects_;
+
+  EmulatedPixelDefects(const EmulatedPixelDefects&) = delete;
+  EmulatedPixelDefects& operator=(const EmulatedPixelDefects&) = delete;
+};
+
+}  // namespace android
+
+#endif  // HW_EMULATOR_CAMERA_PIXEL_DEFECTS_H
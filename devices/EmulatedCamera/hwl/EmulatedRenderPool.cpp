@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "EmulatedRenderPool"
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+#include "EmulatedRenderPool.h"
+
+#include <cutils/properties.h>
+#include <inttypes.h>
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+
+#include "thread_role_manager.h"
+
+namespace android {
+
+using google_camera_hal::ScopedThreadRole;
+using google_camera_hal::ThreadRole;
+
+bool EmulatedRenderPool::IsSharedPoolEnabled() {
+  return property_get_bool("persist.vendor.camera.emulated.render_pool", true);
+}
+
+std::shared_ptr<EmulatedRenderPool> EmulatedRenderPool::GetShared() {
+  static std::mutex shared_lock;
+  static std::weak_ptr<EmulatedRenderPool> shared_pool;
+
+  std::lock_guard<std::mutex> lock(shared_lock);
+  std::shared_ptr<EmulatedRenderPool> pool = shared_pool.lock();
+  if (pool != nullptr) {
+    return pool;
+  }
+
+  int32_t thread_count = property_get_int32(
+      "persist.vendor.camera.emulated.render_threads",
+      static_cast<int32_t>(
+          std::max(1u, std::thread::hardware_concurrency() / 2)));
+  pool = Create(std::max(thread_count, 1), ThreadRole::kRender,
+                "EmuRenderPool");
+  shared_pool = pool;
+  return pool;
+}
+
+std::unique_ptr<EmulatedRenderPool> EmulatedRenderPool::Create(
+    uint32_t thread_count, ThreadRole role, const std::string& name) {
+  if (thread_count == 0) {
+    ALOGE("%s: A pool needs at least one thread", __FUNCTION__);
+    return nullptr;
+  }
+
+  ALOGI("%s: %s runs on %u threads", __FUNCTION__, name.c_str(),
+        thread_count);
+  return std::unique_ptr<EmulatedRenderPool>(
+      new EmulatedRenderPool(thread_count, role, name));
+}
+
+EmulatedRenderPool::EmulatedRenderPool(uint32_t thread_count, ThreadRole role,
+                                       const std::string& name)
+    : thread_count_(thread_count) {
+  for (uint32_t i = 0; i < thread_count; i++) {
+    threads_.emplace_back(
+        [this, role, name] { this->ThreadLoop(role, name); });
+  }
+}
+
+EmulatedRenderPool::~EmulatedRenderPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_ = true;
+    for (auto& it : clients_) {
+      DropTasksLocked(&it.second);
+    }
+  }
+  work_condition_.notify_all();
+  done_condition_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+uint32_t EmulatedRenderPool::AddClient(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (exit_) {
+    return kInvalidClient;
+  }
+
+  uint32_t client = next_client_++;
+  clients_[client].name = name;
+  return client;
+}
+
+void EmulatedRenderPool::RemoveClient(uint32_t client) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = clients_.find(client);
+  if (it == clients_.end()) {
+    return;
+  }
+
+  DropTasksLocked(&it->second);
+  done_condition_.notify_all();
+  done_condition_.wait(lock, [&] { return !it->second.running; });
+
+  const Stats& stats = it->second.stats;
+  if (stats.tasks > 0) {
+    ALOGI("%s: %s: %" PRIu64 " tasks, %" PRId64 " us average wait, %" PRId64
+          " us max wait, %" PRId64 " us average run, %" PRIu64
+          " over deadline",
+          __FUNCTION__, it->second.name.c_str(), stats.tasks,
+          ns2us(stats.total_wait_time / static_cast<nsecs_t>(stats.tasks)),
+          ns2us(stats.max_wait_time),
+          ns2us(stats.total_run_time / static_cast<nsecs_t>(stats.tasks)),
+          stats.deadline_misses);
+  }
+  clients_.erase(it);
+}
+
+status_t EmulatedRenderPool::Queue(uint32_t client, nsecs_t deadline,
+                                   Task task) {
+  if (task == nullptr) {
+    ALOGE("%s: Invalid task", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = clients_.find(client);
+    if (it == clients_.end()) {
+      ALOGE("%s: Unknown client %u", __FUNCTION__, client);
+      return BAD_VALUE;
+    }
+
+    it->second.tasks.push_back(
+        {.task = std::move(task),
+         .deadline = deadline,
+         .queue_time = systemTime(SYSTEM_TIME_MONOTONIC),
+         .sequence = next_sequence_++});
+  }
+  work_condition_.notify_one();
+
+  return OK;
+}
+
+status_t EmulatedRenderPool::RunAndWait(uint32_t client, nsecs_t deadline,
+                                        Task task) {
+  ATRACE_CALL();
+  if (task == nullptr) {
+    ALOGE("%s: Invalid task", __FUNCTION__);
+    return BAD_VALUE;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = clients_.find(client);
+  if (it == clients_.end()) {
+    ALOGE("%s: Unknown client %u", __FUNCTION__, client);
+    return BAD_VALUE;
+  }
+
+  // Run right away on the calling thread if a worker would.
+  Client* caller = &it->second;
+  auto next = GetNextClientLocked();
+  if (!caller->running && caller->tasks.empty() &&
+      (running_tasks_ < thread_count_) &&
+      ((next == clients_.end()) ||
+       (deadline < next->second.tasks.front().deadline))) {
+    RunLocked(lock, caller,
+              {.task = std::move(task),
+               .deadline = deadline,
+               .queue_time = systemTime(SYSTEM_TIME_MONOTONIC),
+               .sequence = next_sequence_++});
+    lock.unlock();
+    // Tasks queued meanwhile may wait for a free worker or for the client.
+    work_condition_.notify_one();
+    return OK;
+  }
+
+  bool done = false;
+  caller->tasks.push_back({.task = std::move(task),
+                           .deadline = deadline,
+                           .queue_time = systemTime(SYSTEM_TIME_MONOTONIC),
+                           .sequence = next_sequence_++,
+                           .done = &done});
+  work_condition_.notify_one();
+  done_condition_.wait(lock, [&] { return done; });
+
+  return OK;
+}
+
+status_t EmulatedRenderPool::GetStats(uint32_t client, Stats* stats) {
+  if (stats == nullptr) {
+    return BAD_VALUE;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = clients_.find(client);
+  if (it == clients_.end()) {
+    return BAD_VALUE;
+  }
+
+  *stats = it->second.stats;
+  return OK;
+}
+
+std::map<uint32_t, EmulatedRenderPool::Client>::iterator
+EmulatedRenderPool::GetNextClientLocked() {
+  auto next = clients_.end();
+  for (auto it = clients_.begin(); it != clients_.end(); it++) {
+    if (it->second.running || it->second.tasks.empty()) {
+      continue;
+    }
+
+    const Entry& entry = it->second.tasks.front();
+    if (next == clients_.end()) {
+      next = it;
+      continue;
+    }
+    const Entry& next_entry = next->second.tasks.front();
+    if ((entry.deadline < next_entry.deadline) ||
+        ((entry.deadline == next_entry.deadline) &&
+         (entry.sequence < next_entry.sequence))) {
+      next = it;
+    }
+  }
+
+  return next;
+}
+
+void EmulatedRenderPool::DropTasksLocked(Client* client) {
+  for (auto& entry : client->tasks) {
+    if (entry.done != nullptr) {
+      *entry.done = true;
+    }
+  }
+  client->tasks.clear();
+}
+
+void EmulatedRenderPool::RunLocked(std::unique_lock<std::mutex>& lock,
+                                   Client* client, Entry entry) {
+  client->running = true;
+  running_tasks_++;
+  lock.unlock();
+
+  nsecs_t start_time = systemTime(SYSTEM_TIME_MONOTONIC);
+  entry.task();
+  nsecs_t end_time = systemTime(SYSTEM_TIME_MONOTONIC);
+  entry.task = nullptr;
+
+  lock.lock();
+  // Clients are only removed once their running task finished.
+  Stats& stats = client->stats;
+  stats.tasks++;
+  if (end_time > entry.deadline) {
+    stats.deadline_misses++;
+  }
+  nsecs_t wait_time = start_time - entry.queue_time;
+  stats.total_wait_time += wait_time;
+  stats.max_wait_time = std::max(stats.max_wait_time, wait_time);
+  stats.total_run_time += end_time - start_time;
+  client->running = false;
+  running_tasks_--;
+  if (entry.done != nullptr) {
+    *entry.done = true;
+  }
+  done_condition_.notify_all();
+}
+
+void EmulatedRenderPool::ThreadLoop(ThreadRole role, const std::string& name) {
+  ScopedThreadRole thread_role(role, name);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    auto client = clients_.end();
+    work_condition_.wait(lock, [&] {
+      if (running_tasks_ < thread_count_) {
+        client = GetNextClientLocked();
+      }
+      return exit_ || (client != clients_.end());
+    });
+    if (exit_) {
+      break;
+    }
+
+    Entry entry = std::move(client->second.tasks.front());
+    client->second.tasks.pop_front();
+    RunLocked(lock, &client->second, std::move(entry));
+  }
+}
+
+}  // namespace android
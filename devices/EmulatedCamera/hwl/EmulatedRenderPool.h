@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * EmulatedRenderPool runs the render and encode work of all open emulated
+ * cameras on one set of worker threads, so concurrent sessions share the
+ * host cores instead of each camera competing with its own threads.
+ *
+ * Work is queued by clients, e.g. the renderer of a sensor or a JPEG
+ * compressor. The tasks of a client run one at a time in the order they were
+ * queued, so a client needs no locking of its own and a single camera can't
+ * take over the pool. Workers aren't bound to a client: an idle worker takes
+ * the task with the earliest deadline among the first tasks of all clients,
+ * so the camera closest to missing its frame goes first and a late camera
+ * catches up at the expense of the ones that are ahead.
+ *
+ * RunAndWait() runs the task on the calling thread when a worker is free and
+ * no other task is due first, so an uncontended sensor renders without
+ * waking a worker and waiting for it. Otherwise the task waits for its turn
+ * on a worker. Either way at most GetThreadCount() tasks run at once.
+ *
+ * The pool shared by the sensors of the process has
+ * persist.vendor.camera.emulated.render_threads workers, by default half of
+ * the CPUs, with the render thread role. Unless
+ * persist.vendor.camera.emulated.render_pool is disabled, the sensors and the
+ * JPEG compressors of all cameras share it.
+ *
+ * Thread safe.
+ */
+
+#ifndef HW_EMULATOR_CAMERA_RENDER_POOL_H
+#define HW_EMULATOR_CAMERA_RENDER_POOL_H
+
+#include <utils/Errors.h>
+#include <utils/Timers.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "thread_role_manager.h"
+
+namespace android {
+
+class EmulatedRenderPool {
+ public:
+  using Task = std::function<void()>;
+
+  static constexpr uint32_t kInvalidClient = 0;
+
+  struct Stats {
+    uint64_t tasks = 0;
+    // Tasks that finished after their deadline.
+    uint64_t deadline_misses = 0;
+    // Time from queueing a task until a worker started it.
+    nsecs_t total_wait_time = 0;
+    nsecs_t max_wait_time = 0;
+    nsecs_t total_run_time = 0;
+  };
+
+  // Whether the sensors and JPEG compressors share the pool of GetShared().
+  static bool IsSharedPoolEnabled();
+
+  // Get the pool shared by the sensors of the process. The pool is created
+  // with its first user and destroyed with the last one.
+  static std::shared_ptr<EmulatedRenderPool> GetShared();
+
+  // The workers register with role under name.
+  static std::unique_ptr<EmulatedRenderPool> Create(
+      uint32_t thread_count, google_camera_hal::ThreadRole role,
+      const std::string& name);
+
+  // Drops the queued tasks and waits for the running ones.
+  ~EmulatedRenderPool();
+
+  // Add a client, name is used in the logs. Returns kInvalidClient on
+  // failure.
+  uint32_t AddClient(const std::string& name);
+
+  // Remove a client. Its queued tasks are dropped without running, and a
+  // running task is waited for.
+  void RemoveClient(uint32_t client);
+
+  // Queue task of client, due at deadline in SYSTEM_TIME_MONOTONIC.
+  status_t Queue(uint32_t client, nsecs_t deadline, Task task);
+
+  // Run task on the calling thread, or queue it and wait until it ran or was
+  // dropped by RemoveClient(). Must not be called from a task.
+  status_t RunAndWait(uint32_t client, nsecs_t deadline, Task task);
+
+  status_t GetStats(uint32_t client, Stats* stats);
+
+  uint32_t GetThreadCount() const {
+    return thread_count_;
+  }
+
+ private:
+  struct Entry {
+    Task task;
+    nsecs_t deadline = 0;
+    nsecs_t queue_time = 0;
+    // Orders the tasks with the same deadline.
+    uint64_t sequence = 0;
+    // Set once the task ran or was dropped, for RunAndWait().
+    bool* done = nullptr;
+  };
+
+  struct Client {
+    std::string name;
+    std::deque<Entry> tasks;
+    bool running = false;
+    Stats stats;
+  };
+
+  EmulatedRenderPool(uint32_t thread_count, google_camera_hal::ThreadRole role,
+                     const std::string& name);
+
+  void ThreadLoop(google_camera_hal::ThreadRole role, const std::string& name);
+
+  // Run entry of client without holding lock, and add it to the statistics
+  // of client.
+  void RunLocked(std::unique_lock<std::mutex>& lock, Client* client,
+                 Entry entry);
+
+  // Client whose next task is due first, or clients_.end() if no task can
+  // run.
+  std::map<uint32_t, Client>::iterator GetNextClientLocked();
+
+  // Drop the queued tasks of client.
+  void DropTasksLocked(Client* client);
+
+  const uint32_t thread_count_;
+
+  std::mutex mutex_;
+  // Signaled when a task is queued or can start, and on exit.
+  std::condition_variable work_condition_;
+  // Signaled when a task finished or was dropped.
+  std::condition_variable done_condition_;
+  bool exit_ = false;
+  uint32_t next_client_ = kInvalidClient + 1;
+  uint64_t next_sequence_ = 0;
+  // Tasks running on the workers and on the callers of RunAndWait().
+  uint32_t running_tasks_ = 0;
+  std::map<uint32_t, Client> clients_;
+
+  std::vector<std::thread> threads_;
+
+  EmulatedRenderPool(const EmulatedRenderPool&) = delete;
+  EmulatedRenderPool& operator=(const EmulatedRenderPool&) = delete;
+};
+
+}  // namespace android
+
+#endif  // HW_EMULATOR_CAMERA_RENDER_POOL_H
@@ -29,6 +29,7 @@
 #include <memory>
 
 #include "GrallocSensorBuffer.h"
+#include "thread_role_manager.h"
 
 namespace android {
 
@@ -41,6 +42,50 @@ using google_camera_hal::ErrorCode;
 using google_camera_hal::HwlPipelineResult;
 using google_camera_hal::MessageType;
 using google_camera_hal::NotifyMessage;
+using google_camera_hal::ScopedThreadRole;
+using google_camera_hal::ThreadRole;
+
+namespace {
+
+// GrallocLayoutCache::Importer backed by HandleImporter.
+class HandleImporterLayoutSource : public GrallocLayoutCache::Importer {
+ public:
+  explicit HandleImporterLayoutSource(std::shared_ptr<HandleImporter> importer)
+      : importer_(importer) {
+  }
+
+  uint8_t* Lock(buffer_handle_t buffer, uint64_t usage, int32_t width,
+                int32_t height) override {
+    android::Rect region{0, 0, width, height};
+    return static_cast<uint8_t*>(importer_->lock(buffer, usage, region));
+  }
+
+  bool LockYCbCr(buffer_handle_t buffer, uint64_t usage, int32_t width,
+                 int32_t height, YCbCrPlanes* planes /*out*/) override {
+    android::Rect map_rect = {0, 0, width, height};
+    auto yuv_layout = importer_->lockYCbCr(buffer, usage, map_rect);
+    if ((yuv_layout.y == nullptr) || (yuv_layout.cb == nullptr) ||
+        (yuv_layout.cr == nullptr)) {
+      return false;
+    }
+    planes->img_y = static_cast<uint8_t*>(yuv_layout.y);
+    planes->img_cb = static_cast<uint8_t*>(yuv_layout.cb);
+    planes->img_cr = static_cast<uint8_t*>(yuv_layout.cr);
+    planes->y_stride = yuv_layout.ystride;
+    planes->cbcr_stride = yuv_layout.cstride;
+    planes->cbcr_step = yuv_layout.chroma_step;
+    return true;
+  }
+
+  void Unlock(buffer_handle_t buffer) override {
+    importer_->unlock(buffer);
+  }
+
+ private:
+  std::shared_ptr<HandleImporter> importer_;
+};
+
+}  // namespace
 
 EmulatedRequestProcessor::EmulatedRequestProcessor(
     uint32_t camera_id, sp<EmulatedSensor> sensor,
@@ -52,6 +97,8 @@ EmulatedRequestProcessor::EmulatedRequestProcessor(
   ATRACE_CALL();
   request_thread_ = std::thread([this] { this->RequestProcessorLoop(); });
   importer_ = std::make_shared<HandleImporter>();
+  layout_cache_ = std::make_unique<GrallocLayoutCache>(
+      std::make_shared<HandleImporterLayoutSource>(importer_));
 }
 
 EmulatedRequestProcessor::~EmulatedRequestProcessor() {
@@ -122,21 +169,7 @@ status_t EmulatedRequestProcessor::ProcessPipelineRequests(
         pipelines[request.pipeline_id].cb, request.input_width,
         request.input_height);
 
-    // Check if there are any settings that need to be overridden.
-    camera_metadata_ro_entry_t entry;
-    if (request.settings.get() != nullptr) {
-      auto ret = request.settings.get()->Get(ANDROID_CONTROL_SETTINGS_OVERRIDE,
-                                             &entry);
-      if ((ret == OK) && (entry.count == 1)) {
-        std::unique_ptr<HalCameraMetadata> override_setting =
-            HalCameraMetadata::Clone(request.settings.get());
-        override_settings_.push({.settings = std::move(override_setting),
-                                 .frame_number = frame_number});
-      }
-    } else {
-      override_settings_.push(
-          {.settings = nullptr, .frame_number = frame_number});
-    }
+    zoom_override_.QueueRequest(frame_number, request.settings.get());
     pending_requests_.push(
         {.frame_number = frame_number,
          .pipeline_id = request.pipeline_id,
@@ -301,25 +334,16 @@ status_t EmulatedRequestProcessor::LockSensorBuffer(
   bool isP010 = static_cast<android_pixel_format_v1_1_t>(
                     stream.override_format) == HAL_PIXEL_FORMAT_YCBCR_P010;
   if ((isYUV_420_888) || (isP010)) {
-    android::Rect map_rect = {0, 0, width, height};
-    auto yuv_layout = importer_->lockYCbCr(buffer, usage, map_rect);
-    if ((yuv_layout.y != nullptr) && (yuv_layout.cb != nullptr) &&
-        (yuv_layout.cr != nullptr)) {
-      sensor_buffer->plane.img_y_crcb.img_y =
-          static_cast<uint8_t*>(yuv_layout.y);
-      sensor_buffer->plane.img_y_crcb.img_cb =
-          static_cast<uint8_t*>(yuv_layout.cb);
-      sensor_buffer->plane.img_y_crcb.img_cr =
-          static_cast<uint8_t*>(yuv_layout.cr);
-      sensor_buffer->plane.img_y_crcb.y_stride = yuv_layout.ystride;
-      sensor_buffer->plane.img_y_crcb.cbcr_stride = yuv_layout.cstride;
-      sensor_buffer->plane.img_y_crcb.cbcr_step = yuv_layout.chroma_step;
-      if (isYUV_420_888 && (yuv_layout.chroma_step == 2) &&
+    // The plane layout of recycled buffers is reused; the buffer is still
+    // locked and unlocked for every frame.
+    if (layout_cache_->LockYCbCr(stream.id, buffer, usage, width, height,
+                                 &sensor_buffer->plane.img_y_crcb)) {
+      if (isYUV_420_888 && (sensor_buffer->plane.img_y_crcb.cbcr_step == 2) &&
           std::abs(sensor_buffer->plane.img_y_crcb.img_cb -
                    sensor_buffer->plane.img_y_crcb.img_cr) != 1) {
         ALOGE(
-            "%s: Unsupported YUV layout, chroma step: %zu U/V plane delta: %u",
-            __FUNCTION__, yuv_layout.chroma_step,
+            "%s: Unsupported YUV layout, chroma step: %u U/V plane delta: %u",
+            __FUNCTION__, sensor_buffer->plane.img_y_crcb.cbcr_step,
             static_cast<unsigned>(
                 std::abs(sensor_buffer->plane.img_y_crcb.img_cb -
                          sensor_buffer->plane.img_y_crcb.img_cr)));
@@ -448,6 +472,7 @@ std::unique_ptr<Buffers> EmulatedRequestProcessor::AcquireBuffers(
 
 void EmulatedRequestProcessor::RequestProcessorLoop() {
   ATRACE_CALL();
+  ScopedThreadRole role(ThreadRole::kFramePacing, "EmulatedRequestProc");
 
   bool vsync_status_ = true;
   while (!processor_done_ && vsync_status_) {
@@ -481,7 +506,7 @@ void EmulatedRequestProcessor::RequestProcessorLoop() {
           // TODO: Add support for individual physical camera requests.
           if (request.settings.get() != nullptr) {
             auto override_frame_number =
-                ApplyOverrideSettings(frame_number, request.settings);
+                zoom_override_.Apply(frame_number, request.settings.get());
             ret = request_state_->InitializeLogicalSettings(
                 HalCameraMetadata::Clone(request.settings.get()),
                 std::move(physical_camera_output_ids), override_frame_number,
@@ -489,7 +514,7 @@ void EmulatedRequestProcessor::RequestProcessorLoop() {
             last_settings_ = HalCameraMetadata::Clone(request.settings.get());
           } else {
             auto override_frame_number =
-                ApplyOverrideSettings(frame_number, last_settings_);
+                zoom_override_.Apply(frame_number, last_settings_.get());
             ret = request_state_->InitializeLogicalSettings(
                 HalCameraMetadata::Clone(last_settings_.get()),
                 std::move(physical_camera_output_ids), override_frame_number,
@@ -561,81 +586,17 @@ void EmulatedRequestProcessor::SetSessionCallback(
   session_callback_ = hwl_session_callback;
 }
 
+void EmulatedRequestProcessor::RemoveCachedBuffers(
+    const native_handle_t* handle) {
+  layout_cache_->Remove(handle);
+}
+
 status_t EmulatedRequestProcessor::GetDefaultRequest(
     RequestTemplate type, std::unique_ptr<HalCameraMetadata>* default_settings) {
   std::lock_guard<std::mutex> lock(process_mutex_);
   return request_state_->GetDefaultRequest(type, default_settings);
 }
 
-uint32_t EmulatedRequestProcessor::ApplyOverrideSettings(
-    uint32_t frame_number,
-    const std::unique_ptr<HalCameraMetadata>& request_settings) {
-  while (!override_settings_.empty() && request_settings.get() != nullptr) {
-    auto override_frame_number = override_settings_.front().frame_number;
-    bool repeatingOverride = (override_settings_.front().settings == nullptr);
-    const auto& override_setting = repeatingOverride
-                                       ? last_override_settings_
-                                       : override_settings_.front().settings;
-
-    camera_metadata_ro_entry_t entry;
-    status_t ret =
-        override_setting->Get(ANDROID_CONTROL_SETTINGS_OVERRIDE, &entry);
-    bool overriding = false;
-    if ((ret == OK) && (entry.count == 1) &&
-        (entry.data.i32[0] == ANDROID_CONTROL_SETTINGS_OVERRIDE_ZOOM)) {
-      ApplyOverrideZoom(override_setting, request_settings,
-                        ANDROID_CONTROL_SETTINGS_OVERRIDE);
-      ApplyOverrideZoom(override_setting, request_settings,
-                        ANDROID_CONTROL_ZOOM_RATIO);
-      ApplyOverrideZoom(override_setting, request_settings,
-                        ANDROID_SCALER_CROP_REGION);
-      ApplyOverrideZoom(override_setting, request_settings,
-                        ANDROID_CONTROL_AE_REGIONS);
-      ApplyOverrideZoom(override_setting, request_settings,
-                        ANDROID_CONTROL_AWB_REGIONS);
-      ApplyOverrideZoom(override_setting, request_settings,
-                        ANDROID_CONTROL_AF_REGIONS);
-      overriding = true;
-    }
-    if (!repeatingOverride) {
-      last_override_settings_ = HalCameraMetadata::Clone(override_setting.get());
-    }
-
-    override_settings_.pop();
-    // If there are multiple queued override settings, skip until the speed-up
-    // is at least 2 frames.
-    if (override_frame_number - frame_number >= kZoomSpeedup) {
-      // If the request's settings override isn't ON, do not return
-      // override_frame_number. Return 0 to indicate there is no
-      // override happening.
-      return overriding ? override_frame_number : 0;
-    }
-  }
-  return 0;
-}
-
-void EmulatedRequestProcessor::ApplyOverrideZoom(
-    const std::unique_ptr<HalCameraMetadata>& override_setting,
-    const std::unique_ptr<HalCameraMetadata>& request_settings,
-    camera_metadata_tag tag) {
-  status_t ret;
-  camera_metadata_ro_entry_t entry;
-  ret = override_setting->Get(tag, &entry);
-  if (ret == OK) {
-    if (entry.type == TYPE_INT32) {
-      request_settings->Set(tag, entry.data.i32, entry.count);
-    } else if (entry.type == TYPE_FLOAT) {
-      request_settings->Set(tag, entry.data.f, entry.count);
-    } else {
-      ALOGE("%s: Unsupported override key %d", __FUNCTION__, tag);
-    }
-  } else {
-    auto missing_tag = get_camera_metadata_tag_name(tag);
-    ALOGE("%s: %s needs to be specified for overriding zoom", __func__,
-          missing_tag);
-  }
-}
-
 Return<void> EmulatedRequestProcessor::SensorHandler::onEvent(const Event& e) {
   auto processor = processor_.lock();
   if (processor.get() == nullptr) {
@@ -25,6 +25,8 @@
 
 #include "EmulatedLogicalRequestState.h"
 #include "EmulatedSensor.h"
+#include "EmulatedZoomOverride.h"
+#include "GrallocLayoutCache.h"
 #include "HandleImporter.h"
 #include "android/frameworks/sensorservice/1.0/ISensorManager.h"
 #include "android/frameworks/sensorservice/1.0/types.h"
@@ -53,10 +55,6 @@ struct PendingRequest {
   std::unique_ptr<Buffers> output_buffers;
 };
 
-struct OverrideRequest {
-  uint32_t frame_number;
-  std::unique_ptr<HalCameraMetadata> settings;
-};
 
 class EmulatedRequestProcessor {
  public:
@@ -84,6 +82,9 @@ class EmulatedRequestProcessor {
 
   void SetSessionCallback(const HwlSessionCallback& hwl_session_callback);
 
+  // Forget the cached layout of a buffer the framework no longer uses.
+  void RemoveCachedBuffers(const native_handle_t* handle);
+
  private:
   class SensorHandler : public IEventQueueCallback {
    public:
@@ -107,9 +108,6 @@ class EmulatedRequestProcessor {
   std::thread request_thread_;
   std::atomic_bool processor_done_ = false;
 
-  // Speed up zoom by 2 frames using settings override
-  const static uint32_t kZoomSpeedup = 2;
-
   // helper methods
   static uint32_t inline AlignTo(uint32_t value, uint32_t alignment) {
     uint32_t delta = value % alignment;
@@ -134,26 +132,21 @@ class EmulatedRequestProcessor {
       int32_t override_width, int32_t override_height);
   std::unique_ptr<Buffers> AcquireBuffers(Buffers* buffers);
   void NotifyFailedRequest(const PendingRequest& request);
-  uint32_t ApplyOverrideSettings(
-      uint32_t frame_number,
-      const std::unique_ptr<HalCameraMetadata>& request_settings);
-  void ApplyOverrideZoom(
-      const std::unique_ptr<HalCameraMetadata>& override_setting,
-      const std::unique_ptr<HalCameraMetadata>& request_settings,
-      camera_metadata_tag tag);
 
   std::mutex process_mutex_;
   std::condition_variable request_condition_;
   std::queue<PendingRequest> pending_requests_;
-  std::queue<OverrideRequest> override_settings_;
+  EmulatedZoomOverride zoom_override_;
   uint32_t camera_id_;
   sp<EmulatedSensor> sensor_;
   HwlSessionCallback session_callback_;
   std::unique_ptr<EmulatedLogicalRequestState>
       request_state_;  // Stores and handles 3A and related camera states.
   std::unique_ptr<HalCameraMetadata> last_settings_;
-  std::unique_ptr<HalCameraMetadata> last_override_settings_;
   std::shared_ptr<HandleImporter> importer_;
+  // Plane layouts of the YCbCr buffers for the lifetime of the
+  // configuration.
+  std::unique_ptr<GrallocLayoutCache> layout_cache_;
 
   EmulatedRequestProcessor(const EmulatedRequestProcessor&) = delete;
   EmulatedRequestProcessor& operator=(const EmulatedRequestProcessor&) = delete;
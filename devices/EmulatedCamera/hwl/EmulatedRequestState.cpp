@@ -145,6 +145,7 @@ status_t EmulatedRequestState::DoFakeAE() {
                       EmulatedSensor::kSupportedFrameDurationRange[0],
                       info.sensor_max_frame_duration_);
   info.sensor_frame_duration_ = (max_frame_duration + min_frame_duration) / 2;
+  ae_max_frame_duration_ = max_frame_duration;
 
   // Face priority mode usually changes the AE algorithm behavior by
   // using the regions of interest associated with detected faces.
@@ -456,6 +457,7 @@ status_t EmulatedRequestState::ProcessAF() {
 
 status_t EmulatedRequestState::ProcessAE() {
   auto& info = *device_info_;
+  ae_max_frame_duration_ = 0;
   if (info.max_ae_regions_ > 0) {
     auto ret =
         Update3AMeteringRegion(ANDROID_CONTROL_AE_REGIONS, *request_settings_,
@@ -835,6 +837,36 @@ status_t EmulatedRequestState::InitializeSensorSettings(
     }
   }
 
+  ret = request_settings_->Get(ANDROID_STATISTICS_FACE_DETECT_MODE, &entry);
+  if ((ret == OK) && (entry.count == 1)) {
+    if (info.available_face_detect_modes_.find(entry.data.u8[0]) !=
+        info.available_face_detect_modes_.end()) {
+      sensor_settings->face_detect_mode = entry.data.u8[0];
+    } else {
+      ALOGE("%s: Unsupported face detect mode!", __FUNCTION__);
+    }
+  }
+
+  ret = request_settings_->Get(ANDROID_HOT_PIXEL_MODE, &entry);
+  if ((ret == OK) && (entry.count == 1)) {
+    if (info.available_hot_pixel_modes_.find(entry.data.u8[0]) !=
+        info.available_hot_pixel_modes_.end()) {
+      sensor_settings->hot_pixel_mode = entry.data.u8[0];
+    } else {
+      ALOGE("%s: Unsupported hot pixel mode!", __FUNCTION__);
+    }
+  }
+
+  ret = request_settings_->Get(ANDROID_STATISTICS_HOT_PIXEL_MAP_MODE, &entry);
+  if ((ret == OK) && (entry.count == 1)) {
+    if (info.available_hot_pixel_map_modes_.find(entry.data.u8[0]) !=
+        info.available_hot_pixel_map_modes_.end()) {
+      sensor_settings->hot_pixel_map_mode = entry.data.u8[0];
+    } else {
+      ALOGE("%s: Unsupported hot pixel map mode!", __FUNCTION__);
+    }
+  }
+
   ret = info.static_metadata_->Get(ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE, &entry);
   if ((ret == OK) && (entry.count == 1)) {
     if (entry.data.u8[0] == ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME) {
@@ -846,6 +878,8 @@ status_t EmulatedRequestState::InitializeSensorSettings(
 
   sensor_settings->exposure_time = info.sensor_exposure_time_;
   sensor_settings->frame_duration = info.sensor_frame_duration_;
+  sensor_settings->max_frame_duration =
+      std::max(info.sensor_frame_duration_, ae_max_frame_duration_);
   sensor_settings->gain = info.sensor_sensitivity_;
   sensor_settings->report_neutral_color_point = info.report_neutral_color_point_;
   sensor_settings->report_green_split = info.report_green_split_;
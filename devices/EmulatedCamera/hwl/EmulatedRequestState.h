@@ -91,6 +91,8 @@ class EmulatedRequestState {
       10;  // Defines a threshold for reaching the AE target
   nsecs_t ae_target_exposure_time_ = EmulatedSensor::kDefaultExposureTime;
   nsecs_t current_exposure_time_ = EmulatedSensor::kDefaultExposureTime;
+  // Longest frame duration the AE target fps range allows, 0 without AE.
+  nsecs_t ae_max_frame_duration_ = 0;
   bool af_mode_changed_ = false;
   uint32_t settings_overriding_frame_number_ = 0;
 
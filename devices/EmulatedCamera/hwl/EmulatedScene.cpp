@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <utils/Log.h>
 
+#include <algorithm>
 #include <cmath>
 
 // TODO: This should probably be done host-side in OpenGL for speed and better
@@ -163,6 +164,12 @@ void EmulatedScene::SetExposureDuration(float seconds) {
   exposure_duration_ = seconds;
 }
 
+void EmulatedScene::SetTexture(
+    std::shared_ptr<const EmulatedSceneTexture> texture) {
+  texture_ = std::move(texture);
+  line_valid_ = false;
+}
+
 void EmulatedScene::SetTestPattern(bool enabled) {
   test_pattern_mode_ = enabled;
 }
@@ -287,6 +294,29 @@ void EmulatedScene::CalculateScene(nsecs_t time, int32_t handshake_divider) {
   ALOGV("Shade XYZ: %f, %f, %f", shade_illum_xyz[0], shade_illum_xyz[1],
         shade_illum_xyz[2]);
 
+  float lux_to_electrons =
+      sensor_sensitivity_ * exposure_duration_ / (kAperture * kAperture);
+  if (texture_ != nullptr) {
+    // Texels are linear sRGB reflectances. Convert them to XYZ normalized to
+    // the D65 white point, so a white texel reflects the illuminant, and
+    // then to electrons like the materials below.
+    const float kSrgbToXyz[3][3] = {{0.4124f, 0.3576f, 0.1805f},
+                                    {0.2126f, 0.7152f, 0.0722f},
+                                    {0.0193f, 0.1192f, 0.9505f}};
+    const float kD65WhiteXyz[3] = {0.9505f, 1.0f, 1.0890f};
+    const float* filters[4] = {filter_r_, filter_gr_, filter_gb_, filter_b_};
+    for (int k = 0; k < 4; k++) {
+      for (int i = 0; i < 3; i++) {
+        float sum = 0;
+        for (int j = 0; j < 3; j++) {
+          sum += filters[k][j] * direct_illum_xyz[j] * kSrgbToXyz[j][i] /
+                 kD65WhiteXyz[j];
+        }
+        texture_to_electrons_[k][i] = sum * lux_to_electrons;
+      }
+    }
+  }
+
   for (int i = 0; i < NUM_MATERIALS; i++) {
     // Converting for xyY to XYZ:
     // X = Y / y * x
@@ -309,8 +339,6 @@ void EmulatedScene::CalculateScene(nsecs_t time, int32_t handshake_divider) {
     }  // else if (kMaterialsFlags[i] * kSelfLit), do nothing
 
     ALOGV("Mat %d XYZ: %f, %f, %f", i, mat_xyz[0], mat_xyz[1], mat_xyz[2]);
-    float lux_to_electrons =
-        sensor_sensitivity_ * exposure_duration_ / (kAperture * kAperture);
     current_colors_[i * NUM_CHANNELS + 0] =
         (filter_r_[0] * mat_xyz[0] + filter_r_[1] * mat_xyz[1] +
          filter_r_[2] * mat_xyz[2]) *
@@ -368,6 +396,10 @@ void EmulatedScene::CalculateScene(nsecs_t time, int32_t handshake_divider) {
       current_scene_ = scene_rot0_;
   }
 
+  if (texture_ != nullptr) {
+    UpdateTextureMapping(scene_rotation);
+  }
+
   // Set starting pixel
   SetReadoutPixel(0, 0);
 }
@@ -405,9 +437,145 @@ void EmulatedScene::InitiliazeSceneRotation(bool clock_wise) {
   }
 }
 
+void EmulatedScene::UpdateTextureMapping(int32_t scene_rotation) {
+  // The built-in scene rotates the other way for front facing cameras.
+  bool clock_wise = !is_front_facing_;
+  if (!clock_wise && (scene_rotation == 90 || scene_rotation == 270)) {
+    scene_rotation = 360 - scene_rotation;
+  }
+  bool transposed = scene_rotation == 90 || scene_rotation == 270;
+  int64_t scene_width = transposed ? sensor_height_ : sensor_width_;
+  int64_t scene_height = transposed ? sensor_width_ : sensor_height_;
+
+  // Use the smallest level that still has a texel per sensor pixel.
+  texture_level_ = 0;
+  for (size_t level = texture_->GetNumLevels(); level-- > 0;) {
+    const auto& l = texture_->GetLevel(level);
+    if (l.width >= scene_width && l.height >= scene_height) {
+      texture_level_ = level;
+      break;
+    }
+  }
+
+  // Fit the scene inside the level, cropping the level on one axis.
+  const auto& l = texture_->GetLevel(texture_level_);
+  float scale = std::min(static_cast<float>(l.width) / scene_width,
+                         static_cast<float>(l.height) / scene_height);
+  int64_t step = static_cast<int64_t>(scale * 65536.0f);
+  int64_t u_offset = ((int64_t{l.width} << 16) - step * scene_width) / 2;
+  int64_t v_offset = ((int64_t{l.height} << 16) - step * scene_height) / 2;
+  // Sample at pixel centers.
+  u_offset += step / 2;
+  v_offset += step / 2;
+
+  texture_dudx_ = texture_dudy_ = texture_dvdx_ = texture_dvdy_ = 0;
+  switch (scene_rotation) {
+    case 90:
+      texture_u0_ = u_offset + step * (scene_width - 1 - handshake_y_);
+      texture_dudy_ = -step;
+      texture_v0_ = v_offset + step * handshake_x_;
+      texture_dvdx_ = step;
+      break;
+    case 180:
+      texture_u0_ = u_offset + step * (scene_width - 1 - handshake_x_);
+      texture_dudx_ = -step;
+      texture_v0_ = v_offset + step * (scene_height - 1 - handshake_y_);
+      texture_dvdy_ = -step;
+      break;
+    case 270:
+      texture_u0_ = u_offset + step * handshake_y_;
+      texture_dudy_ = step;
+      texture_v0_ = v_offset + step * (scene_height - 1 - handshake_x_);
+      texture_dvdx_ = -step;
+      break;
+    default:
+      texture_u0_ = u_offset + step * handshake_x_;
+      texture_dudx_ = step;
+      texture_v0_ = v_offset + step * handshake_y_;
+      texture_dvdy_ = step;
+  }
+  line_valid_ = false;
+}
+
+void EmulatedScene::FillTextureLine(bool column, int count) {
+  int64_t u = texture_u0_ + int64_t{texture_dudx_} * current_x_ +
+              int64_t{texture_dudy_} * current_y_;
+  int64_t v = texture_v0_ + int64_t{texture_dvdx_} * current_x_ +
+              int64_t{texture_dvdy_} * current_y_;
+  texture_->SampleLine(texture_level_, static_cast<int32_t>(u),
+                       static_cast<int32_t>(v),
+                       column ? texture_dudy_ : texture_dudx_,
+                       column ? texture_dvdy_ : texture_dvdx_, count,
+                       line_rgb_[EmulatedSceneTexture::kRed],
+                       line_rgb_[EmulatedSceneTexture::kGreen],
+                       line_rgb_[EmulatedSceneTexture::kBlue]);
+
+  // Planar loops so the color conversion vectorizes.
+  const float* r = line_rgb_[EmulatedSceneTexture::kRed];
+  const float* g = line_rgb_[EmulatedSceneTexture::kGreen];
+  const float* b = line_rgb_[EmulatedSceneTexture::kBlue];
+  for (int k = 0; k < 4; k++) {
+    const float* m = texture_to_electrons_[k];
+    for (int i = 0; i < count; i++) {
+      line_channel_[i] =
+          std::max(m[0] * r[i] + m[1] * g[i] + m[2] * b[i], 0.0f);
+    }
+    for (int i = 0; i < count; i++) {
+      line_electrons_[i * NUM_CHANNELS + k] =
+          static_cast<uint32_t>(line_channel_[i]);
+    }
+  }
+
+  line_valid_ = true;
+  line_column_ = column;
+  line_x_ = current_x_;
+  line_y_ = current_y_;
+  line_length_ = count;
+}
+
+const uint32_t* EmulatedScene::GetTexturePixelElectrons(bool column) {
+  int line_offset = column ? current_y_ - line_y_ : current_x_ - line_x_;
+  bool in_line = line_valid_ && line_column_ == column &&
+                 (column ? current_x_ == line_x_ : current_y_ == line_y_) &&
+                 line_offset >= 0 && line_offset < line_length_;
+  if (!in_line) {
+    // Render ahead only when the pixels are read in sequence, random reads
+    // after SetReadoutPixel() render a single pixel.
+    int remaining = column ? sensor_height_ - current_y_
+                           : sensor_width_ - current_x_;
+    FillTextureLine(column, sequential_readout_
+                                ? std::min(remaining, kTextureLineLength)
+                                : 1);
+    line_offset = 0;
+  }
+  const uint32_t* pixel = &line_electrons_[line_offset * NUM_CHANNELS];
+  sequential_readout_ = true;
+
+  if (column) {
+    current_y_++;
+    if (current_y_ >= sensor_height_) {
+      current_y_ = 0;
+      current_x_++;
+      if (current_x_ >= sensor_width_) current_x_ = 0;
+    }
+  } else {
+    current_x_++;
+    if (current_x_ >= sensor_width_) {
+      current_x_ = 0;
+      current_y_++;
+      if (current_y_ >= sensor_height_) current_y_ = 0;
+    }
+  }
+  return pixel;
+}
+
 void EmulatedScene::SetReadoutPixel(int x, int y) {
   current_x_ = x;
   current_y_ = y;
+  if (texture_ != nullptr) {
+    sequential_readout_ = false;
+    return;
+  }
   sub_x_ = (x + offset_x_ + handshake_x_) % map_div_;
   sub_y_ = (y + offset_y_ + handshake_y_) % map_div_;
   scene_x_ = (x + offset_x_ + handshake_x_) / map_div_;
@@ -418,6 +586,7 @@ void EmulatedScene::SetReadoutPixel(int x, int y) {
 
 const uint32_t* EmulatedScene::GetPixelElectrons() {
   if (test_pattern_mode_) return test_pattern_data_;
+  if (texture_ != nullptr) return GetTexturePixelElectrons(/*column=*/false);
 
   const uint32_t* pixel = current_scene_material_;
   current_x_++;
@@ -437,6 +606,8 @@ const uint32_t* EmulatedScene::GetPixelElectrons() {
 }
 
 const uint32_t* EmulatedScene::GetPixelElectronsColumn() {
+  if (texture_ != nullptr) return GetTexturePixelElectrons(/*column=*/true);
+
   const uint32_t* pixel = current_scene_material_;
   current_y_++;
   sub_y_++;
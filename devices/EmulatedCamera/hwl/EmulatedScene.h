@@ -26,6 +26,9 @@
 #ifndef HW_EMULATOR_CAMERA2_SCENE_H
 #define HW_EMULATOR_CAMERA2_SCENE_H
 
+#include <memory>
+
+#include "EmulatedSceneTexture.h"
 #include "utils/Timers.h"
 
 namespace android {
@@ -61,6 +64,13 @@ class EmulatedScene {
   // Must be called before calculateScene
   void SetExposureDuration(float seconds);
 
+  // Render the scene from texture instead of the built-in tile map. The
+  // texture is fitted to cover the sensor. Pass nullptr to use the tile map.
+  void SetTexture(std::shared_ptr<const EmulatedSceneTexture> texture);
+  bool HasTexture() const {
+    return texture_ != nullptr;
+  }
+
   // Set test pattern mode; this draws a solid-color image set to the color
   // defined by test pattern data
   void SetTestPattern(bool enabled);
@@ -70,6 +80,13 @@ class EmulatedScene {
   // the hour. Resets pixel readout location to 0,0
   void CalculateScene(nsecs_t time, int32_t handshake_divider);
 
+  // Get the viewpoint offset of the handshake in sensor pixels, as of the
+  // last CalculateScene().
+  void GetHandshake(int32_t* x, int32_t* y) const {
+    *x = handshake_x_;
+    *y = handshake_y_;
+  }
+
   // Set sensor pixel readout location.
   void SetReadoutPixel(int x, int y);
 
@@ -93,6 +110,17 @@ class EmulatedScene {
  private:
   void InitiliazeSceneRotation(bool clock_wise);
 
+  // Select the texture level and the mapping from sensor pixels to texels
+  // for scene_rotation and the current handshake.
+  void UpdateTextureMapping(int32_t scene_rotation);
+
+  // Texture counterpart of GetPixelElectrons() and GetPixelElectronsColumn().
+  const uint32_t* GetTexturePixelElectrons(bool column);
+
+  // Render count pixels starting at the readout pixel into line_electrons_,
+  // along the row or the column.
+  void FillTextureLine(bool column, int count);
+
   uint8_t scene_rot0_[kSceneWidth*kSceneHeight];
   uint8_t scene_rot90_[kSceneWidth*kSceneHeight];
   uint8_t scene_rot180_[kSceneWidth*kSceneHeight];
@@ -148,6 +176,36 @@ class EmulatedScene {
 
   uint32_t current_colors_[NUM_MATERIALS * NUM_CHANNELS];
 
+  // Optional high resolution scene, see SetTexture().
+  std::shared_ptr<const EmulatedSceneTexture> texture_;
+  size_t texture_level_ = 0;
+  // Texel coordinates of sensor pixel (x, y) in 16.16 fixed point are
+  // (u0 + x * dudx + y * dudy, v0 + x * dvdx + y * dvdy).
+  int64_t texture_u0_ = 0;
+  int64_t texture_v0_ = 0;
+  int32_t texture_dudx_ = 0;
+  int32_t texture_dudy_ = 0;
+  int32_t texture_dvdx_ = 0;
+  int32_t texture_dvdy_ = 0;
+  // Linear RGB reflectance to R, Gr, Gb, B electrons for the current
+  // illumination and exposure.
+  float texture_to_electrons_[4][3] = {};
+
+  // Rendered texture pixels from (line_x_, line_y_) along a row or column.
+  static const int kTextureLineLength = 64;
+  float line_rgb_[EmulatedSceneTexture::kNumChannels][kTextureLineLength];
+  float line_channel_[kTextureLineLength];
+  uint32_t line_electrons_[kTextureLineLength * NUM_CHANNELS] = {};
+  bool line_valid_ = false;
+  bool line_column_ = false;
+  int line_x_ = 0;
+  int line_y_ = 0;
+  int line_length_ = 0;
+  // True if the readout pixel was reached by reading the previous pixel
+  // rather than by SetReadoutPixel(), i.e. the next pixels will likely be
+  // read as well.
+  bool sequential_readout_ = false;
+
   /**
    * Constants for scene definition. These are various degrees of approximate.
    */
@@ -0,0 +1,515 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "EmulatedSceneTexture"
+#include "EmulatedSceneTexture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <log/log.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "thread_role_manager.h"
+
+namespace android {
+
+using google_camera_hal::ScopedThreadRole;
+using google_camera_hal::ThreadRole;
+
+namespace {
+
+// Linear sRGB reflectances of the 24 color checker patches, row by row.
+const float kColorCheckerRgb[24][3] = {
+    {0.171f, 0.084f, 0.057f}, {0.539f, 0.305f, 0.223f},
+    {0.122f, 0.195f, 0.337f}, {0.095f, 0.150f, 0.056f},
+    {0.235f, 0.216f, 0.436f}, {0.134f, 0.509f, 0.402f},
+    {0.672f, 0.206f, 0.025f}, {0.080f, 0.104f, 0.381f},
+    {0.533f, 0.102f, 0.125f}, {0.112f, 0.045f, 0.150f},
+    {0.341f, 0.503f, 0.052f}, {0.745f, 0.371f, 0.027f},
+    {0.040f, 0.047f, 0.305f}, {0.061f, 0.296f, 0.067f},
+    {0.429f, 0.037f, 0.045f}, {0.799f, 0.571f, 0.013f},
+    {0.497f, 0.093f, 0.301f}, {0.002f, 0.231f, 0.356f},
+    {0.896f, 0.896f, 0.887f}, {0.578f, 0.578f, 0.578f},
+    {0.352f, 0.352f, 0.352f}, {0.195f, 0.195f, 0.191f},
+    {0.091f, 0.091f, 0.091f}, {0.034f, 0.034f, 0.034f},
+};
+
+inline uint16_t ToTexel(float reflectance) {
+  return static_cast<uint16_t>(
+      std::clamp(reflectance, 0.0f, 1.0f) *
+          EmulatedSceneTexture::kMaxValue +
+      0.5f);
+}
+
+inline uint32_t Hash(int32_t x, int32_t y, uint32_t seed) {
+  uint32_t h = static_cast<uint32_t>(x) * 0x8da6b343u ^
+               static_cast<uint32_t>(y) * 0xd8163841u ^ seed * 0xcb1ab31fu;
+  h ^= h >> 13;
+  h *= 0x85ebca6bu;
+  h ^= h >> 16;
+  return h;
+}
+
+// Smoothly interpolated lattice noise in [-1, 1] with one lattice point per
+// cell_size texels.
+inline float ValueNoise(float x, float y, float cell_size, uint32_t seed) {
+  float fx = x / cell_size;
+  float fy = y / cell_size;
+  int32_t ix = static_cast<int32_t>(std::floor(fx));
+  int32_t iy = static_cast<int32_t>(std::floor(fy));
+  float tx = fx - ix;
+  float ty = fy - iy;
+  tx = tx * tx * (3.0f - 2.0f * tx);
+  ty = ty * ty * (3.0f - 2.0f * ty);
+
+  auto lattice = [seed](int32_t lx, int32_t ly) {
+    return (Hash(lx, ly, seed) & 0xFFFF) / 32767.5f - 1.0f;
+  };
+  float top = lattice(ix, iy) + (lattice(ix + 1, iy) - lattice(ix, iy)) * tx;
+  float bottom = lattice(ix, iy + 1) +
+                 (lattice(ix + 1, iy + 1) - lattice(ix, iy + 1)) * tx;
+  return top + (bottom - top) * ty;
+}
+
+// Sum of octaves with halving amplitude, i.e. a 1/f amplitude spectrum.
+// Normalized to about [-1, 1].
+inline float FractalNoise(float x, float y, float cell_size,
+                          uint32_t num_octaves, uint32_t seed) {
+  float sum = 0.0f;
+  float amplitude = 1.0f;
+  float total_amplitude = 0.0f;
+  for (uint32_t i = 0; i < num_octaves && cell_size >= 1.0f; i++) {
+    sum += amplitude * ValueNoise(x, y, cell_size, seed + i);
+    total_amplitude += amplitude;
+    amplitude *= 0.5f;
+    cell_size *= 0.5f;
+  }
+  return total_amplitude > 0.0f ? sum / total_amplitude : 0.0f;
+}
+
+inline size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+EmulatedSceneTexture::~EmulatedSceneTexture() {
+  if (mapped_data_ != nullptr) {
+    munmap(mapped_data_, mapped_size_);
+  }
+}
+
+uint32_t EmulatedSceneTexture::GetNumLevels(uint32_t width, uint32_t height) {
+  uint32_t num_levels = 1;
+  while (num_levels < kMaxLevels &&
+         std::min(width >> num_levels, height >> num_levels) >= kMinLevelSize) {
+    num_levels++;
+  }
+  return num_levels;
+}
+
+size_t EmulatedSceneTexture::GetLayout(uint32_t width, uint32_t height,
+                                       uint32_t num_levels,
+                                       std::vector<size_t>* plane_offsets) {
+  plane_offsets->clear();
+  size_t offset = AlignUp(sizeof(FileHeader), kPlaneAlignment);
+  for (uint32_t level = 0; level < num_levels; level++) {
+    size_t level_width = std::max(width >> level, 1u);
+    size_t level_height = std::max(height >> level, 1u);
+    for (uint32_t c = 0; c < kNumChannels; c++) {
+      plane_offsets->push_back(offset);
+      offset = AlignUp(offset + level_width * level_height * sizeof(uint16_t),
+                       kPlaneAlignment);
+    }
+  }
+  return offset;
+}
+
+void EmulatedSceneTexture::SetLevels(const uint8_t* data, uint32_t width,
+                                     uint32_t height, uint32_t num_levels,
+                                     const std::vector<size_t>& plane_offsets) {
+  width_ = width;
+  height_ = height;
+  levels_.resize(num_levels);
+  for (uint32_t level = 0; level < num_levels; level++) {
+    levels_[level].width = std::max(width >> level, 1u);
+    levels_[level].height = std::max(height >> level, 1u);
+    for (uint32_t c = 0; c < kNumChannels; c++) {
+      levels_[level].planes[c] = reinterpret_cast<const uint16_t*>(
+          data + plane_offsets[level * kNumChannels + c]);
+    }
+  }
+}
+
+std::unique_ptr<EmulatedSceneTexture> EmulatedSceneTexture::Load(
+    const char* path) {
+  ATRACE_CALL();
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    ALOGE("%s: Opening %s failed: %s", __FUNCTION__, path, strerror(errno));
+    return nullptr;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      static_cast<size_t>(file_stat.st_size) < sizeof(FileHeader)) {
+    ALOGE("%s: %s is not a scene texture", __FUNCTION__, path);
+    close(fd);
+    return nullptr;
+  }
+
+  size_t file_size = file_stat.st_size;
+  void* data = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    ALOGE("%s: Mapping %s failed: %s", __FUNCTION__, path, strerror(errno));
+    return nullptr;
+  }
+
+  std::unique_ptr<EmulatedSceneTexture> texture(new EmulatedSceneTexture());
+  texture->mapped_data_ = data;
+  texture->mapped_size_ = file_size;
+
+  FileHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != kMagic || header.version != kVersion ||
+      header.width == 0 || header.height == 0 || header.num_levels == 0 ||
+      header.num_levels > GetNumLevels(header.width, header.height)) {
+    ALOGE("%s: %s has an invalid header", __FUNCTION__, path);
+    return nullptr;
+  }
+
+  std::vector<size_t> plane_offsets;
+  size_t size = GetLayout(header.width, header.height, header.num_levels,
+                          &plane_offsets);
+  if (size > file_size) {
+    ALOGE("%s: %s is truncated: %zu bytes, expected %zu", __FUNCTION__, path,
+          file_size, size);
+    return nullptr;
+  }
+
+  texture->SetLevels(static_cast<const uint8_t*>(data), header.width,
+                     header.height, header.num_levels, plane_offsets);
+  ALOGI("%s: Mapped %ux%u scene texture with %u levels from %s", __FUNCTION__,
+        header.width, header.height, header.num_levels, path);
+  return texture;
+}
+
+std::unique_ptr<EmulatedSceneTexture> EmulatedSceneTexture::Generate(
+    Pattern pattern, uint32_t width, uint32_t height) {
+  ATRACE_CALL();
+  if (width == 0 || height == 0) {
+    ALOGE("%s: Invalid texture size %ux%u", __FUNCTION__, width, height);
+    return nullptr;
+  }
+
+  std::unique_ptr<EmulatedSceneTexture> texture(new EmulatedSceneTexture());
+  uint32_t num_levels = GetNumLevels(width, height);
+  std::vector<size_t> plane_offsets;
+  size_t size = GetLayout(width, height, num_levels, &plane_offsets);
+  texture->storage_.resize(size);
+
+  FileHeader header = {.magic = kMagic,
+                       .version = kVersion,
+                       .width = width,
+                       .height = height,
+                       .num_levels = num_levels,
+                       .reserved = 0};
+  memcpy(texture->storage_.data(), &header, sizeof(header));
+  texture->SetLevels(texture->storage_.data(), width, height, num_levels,
+                     plane_offsets);
+  texture->GeneratePattern(pattern);
+  texture->GenerateMipmaps();
+  return texture;
+}
+
+status_t EmulatedSceneTexture::Save(const char* path) const {
+  ATRACE_CALL();
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    ALOGE("%s: Opening %s failed: %s", __FUNCTION__, path, strerror(errno));
+    return -errno;
+  }
+
+  // Rebuild the file from the levels so mapped and generated textures are
+  // written the same way.
+  std::vector<size_t> plane_offsets;
+  size_t size = GetLayout(width_, height_, levels_.size(), &plane_offsets);
+  std::vector<uint8_t> data(size, 0);
+  FileHeader header = {.magic = kMagic,
+                       .version = kVersion,
+                       .width = width_,
+                       .height = height_,
+                       .num_levels = static_cast<uint32_t>(levels_.size()),
+                       .reserved = 0};
+  memcpy(data.data(), &header, sizeof(header));
+  for (size_t level = 0; level < levels_.size(); level++) {
+    size_t plane_size =
+        levels_[level].width * levels_[level].height * sizeof(uint16_t);
+    for (uint32_t c = 0; c < kNumChannels; c++) {
+      memcpy(data.data() + plane_offsets[level * kNumChannels + c],
+             levels_[level].planes[c], plane_size);
+    }
+  }
+
+  size_t written = 0;
+  while (written < size) {
+    ssize_t res = write(fd, data.data() + written, size - written);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ALOGE("%s: Writing %s failed: %s", __FUNCTION__, path, strerror(errno));
+      close(fd);
+      return -errno;
+    }
+    written += res;
+  }
+  close(fd);
+  return OK;
+}
+
+void EmulatedSceneTexture::GeneratePattern(Pattern pattern) {
+  ATRACE_CALL();
+  std::array<uint16_t*, kNumChannels> planes;
+  for (uint32_t c = 0; c < kNumChannels; c++) {
+    planes[c] = const_cast<uint16_t*>(levels_[0].planes[c]);
+  }
+
+  const float width = width_;
+  const float height = height_;
+  switch (pattern) {
+    case Pattern::kTestChart: {
+      // Geometry in units of the texture height, so the chart keeps its
+      // proportions for any aspect ratio.
+      const float unit = height;
+      const float chart_left = width * 0.5f - unit * 0.62f;
+      const float chart_top = unit * 0.12f;
+      const float patch_pitch = unit * 0.1f;
+      const float patch_size = patch_pitch * 0.85f;
+      const float star_x = width * 0.5f + unit * 0.45f;
+      const float star_y = unit * 0.32f;
+      const float star_radius = unit * 0.2f;
+      const float edge_x = width * 0.5f + unit * 0.45f;
+      const float edge_y = unit * 0.75f;
+      const float edge_half_size = unit * 0.12f;
+      const float edge_cos = std::cos(5.0f * M_PI / 180.0f);
+      const float edge_sin = std::sin(5.0f * M_PI / 180.0f);
+      const float ramp_top = unit * 0.6f;
+      const float ramp_bottom = unit * 0.7f;
+      const float ramp_left = chart_left;
+      const float ramp_right = chart_left + patch_pitch * 6;
+
+      for (uint32_t y = 0; y < height_; y++) {
+        for (uint32_t x = 0; x < width_; x++) {
+          float px = x + 0.5f;
+          float py = y + 0.5f;
+          const float* rgb = nullptr;
+          float gray = 0.18f;
+
+          float cx = (px - chart_left) / patch_pitch;
+          float cy = (py - chart_top) / patch_pitch;
+          float star_dx = px - star_x;
+          float star_dy = py - star_y;
+          float edge_u = (px - edge_x) * edge_cos + (py - edge_y) * edge_sin;
+          float edge_v = -(px - edge_x) * edge_sin + (py - edge_y) * edge_cos;
+          if (cx >= 0 && cx < 6 && cy >= 0 && cy < 4) {
+            // Color checker with dark gaps between the patches.
+            if ((cx - std::floor(cx)) * patch_pitch < patch_size &&
+                (cy - std::floor(cy)) * patch_pitch < patch_size) {
+              rgb = kColorCheckerRgb[static_cast<int>(cy) * 6 +
+                                     static_cast<int>(cx)];
+            } else {
+              gray = 0.03f;
+            }
+          } else if (py >= ramp_top && py < ramp_bottom && px >= ramp_left &&
+                     px < ramp_right) {
+            gray = 0.005f + 0.9f * (px - ramp_left) / (ramp_right - ramp_left);
+          } else if (star_dx * star_dx + star_dy * star_dy <
+                     star_radius * star_radius) {
+            // 36 cycle resolution star.
+            float angle = std::atan2(star_dy, star_dx);
+            gray = std::sin(angle * 36.0f) >= 0.0f ? 0.85f : 0.04f;
+          } else if (std::abs(edge_u) < edge_half_size &&
+                     std::abs(edge_v) < edge_half_size) {
+            // 5 degree slanted edge square.
+            gray = edge_u < 0.0f ? 0.04f : 0.85f;
+          }
+
+          size_t index = static_cast<size_t>(y) * width_ + x;
+          for (uint32_t c = 0; c < kNumChannels; c++) {
+            planes[c][index] = ToTexel(rgb != nullptr ? rgb[c] : gray);
+          }
+        }
+      }
+      break;
+    }
+    case Pattern::kNaturalImage: {
+      // Large structures of a quarter of the frame down to single texels.
+      const float cell_size = std::max(width, height) / 4.0f;
+      const uint32_t num_octaves =
+          static_cast<uint32_t>(std::log2(std::max(cell_size, 1.0f))) + 1;
+      for (uint32_t y = 0; y < height_; y++) {
+        for (uint32_t x = 0; x < width_; x++) {
+          float luma_noise = FractalNoise(x, y, cell_size, num_octaves,
+                                          /*seed=*/1);
+          // Chroma varies slower than luma in natural images.
+          float red_noise = FractalNoise(x, y, cell_size, /*num_octaves=*/4,
+                                         /*seed=*/101);
+          float blue_noise = FractalNoise(x, y, cell_size, /*num_octaves=*/4,
+                                          /*seed=*/201);
+          // Log-normal reflectances around middle gray.
+          float luma = 0.18f * std::exp(2.5f * luma_noise);
+          size_t index = static_cast<size_t>(y) * width_ + x;
+          planes[kRed][index] = ToTexel(luma * std::exp(0.6f * red_noise));
+          planes[kGreen][index] = ToTexel(luma);
+          planes[kBlue][index] = ToTexel(luma * std::exp(0.6f * blue_noise));
+        }
+      }
+      break;
+    }
+  }
+}
+
+void EmulatedSceneTexture::GenerateMipmaps() {
+  ATRACE_CALL();
+  for (size_t level = 1; level < levels_.size(); level++) {
+    const Level& src = levels_[level - 1];
+    const Level& dst = levels_[level];
+    for (uint32_t c = 0; c < kNumChannels; c++) {
+      const uint16_t* src_plane = src.planes[c];
+      uint16_t* dst_plane = const_cast<uint16_t*>(dst.planes[c]);
+      for (uint32_t y = 0; y < dst.height; y++) {
+        const uint16_t* row0 =
+            src_plane + static_cast<size_t>(2 * y) * src.width;
+        const uint16_t* row1 =
+            src_plane +
+            static_cast<size_t>(std::min(2 * y + 1, src.height - 1)) *
+                src.width;
+        uint16_t* out = dst_plane + static_cast<size_t>(y) * dst.width;
+        for (uint32_t x = 0; x < dst.width; x++) {
+          uint32_t x1 = std::min(2 * x + 1, src.width - 1);
+          out[x] = (row0[2 * x] + row0[x1] + row1[2 * x] + row1[x1] + 2) / 4;
+        }
+      }
+    }
+  }
+}
+
+void EmulatedSceneTexture::SampleLine(size_t level, int32_t u, int32_t v,
+                                      int32_t du, int32_t dv, size_t count,
+                                      float* r, float* g, float* b) const {
+  const Level& l = levels_[level];
+  const int32_t max_x = static_cast<int32_t>(l.width) - 1;
+  const int32_t max_y = static_cast<int32_t>(l.height) - 1;
+  const float scale = 1.0f / kMaxValue;
+  for (size_t i = 0; i < count; i++) {
+    int32_t x = std::clamp(u >> 16, 0, max_x);
+    int32_t y = std::clamp(v >> 16, 0, max_y);
+    size_t index = static_cast<size_t>(y) * l.width + x;
+    r[i] = l.planes[kRed][index] * scale;
+    g[i] = l.planes[kGreen][index] * scale;
+    b[i] = l.planes[kBlue][index] * scale;
+    u += du;
+    v += dv;
+  }
+}
+
+EmulatedSceneTextureCache& EmulatedSceneTextureCache::GetInstance() {
+  static EmulatedSceneTextureCache instance;
+  return instance;
+}
+
+EmulatedSceneTextureCache::TextureFuture EmulatedSceneTextureCache::Get(
+    const std::string& name, uint32_t width, uint32_t height) {
+  bool generated = name == "testchart" || name == "natural";
+  Key key = generated ? std::make_tuple(name, width, height)
+                      : std::make_tuple(name, 0u, 0u);
+
+  std::lock_guard<std::mutex> lock(lock_);
+  auto texture = textures_[key].lock();
+  if (texture != nullptr) {
+    last_texture_ = texture;
+    std::promise<std::shared_ptr<const EmulatedSceneTexture>> promise;
+    promise.set_value(texture);
+    return promise.get_future().share();
+  }
+
+  auto pending = pending_.find(key);
+  if (pending != pending_.end()) {
+    return pending->second;
+  }
+
+  std::promise<std::shared_ptr<const EmulatedSceneTexture>> promise;
+  TextureFuture future = promise.get_future().share();
+  pending_[key] = future;
+  std::thread([this, key, promise = std::move(promise)]() mutable {
+    std::shared_ptr<const EmulatedSceneTexture> texture;
+    {
+      ScopedThreadRole role(ThreadRole::kHousekeeping, "SceneTexture");
+      texture = Build(key);
+    }
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      if (texture != nullptr) {
+        textures_[key] = texture;
+        last_texture_ = texture;
+      }
+      pending_.erase(key);
+      build_count_++;
+    }
+    // Waiters may destroy the cache once the value is set, so it is the
+    // last thing the thread does.
+    promise.set_value(std::move(texture));
+  }).detach();
+  return future;
+}
+
+uint32_t EmulatedSceneTextureCache::GetBuildCount() {
+  std::lock_guard<std::mutex> lock(lock_);
+  return build_count_;
+}
+
+std::shared_ptr<const EmulatedSceneTexture> EmulatedSceneTextureCache::Build(
+    const Key& key) {
+  ATRACE_CALL();
+  const auto& [name, width, height] = key;
+  std::shared_ptr<const EmulatedSceneTexture> texture;
+  if (name == "testchart" || name == "natural") {
+    texture = EmulatedSceneTexture::Generate(
+        name == "testchart" ? EmulatedSceneTexture::Pattern::kTestChart
+                            : EmulatedSceneTexture::Pattern::kNaturalImage,
+        width, height);
+  } else {
+    texture = EmulatedSceneTexture::Load(name.c_str());
+  }
+  if (texture == nullptr) {
+    ALOGE("%s: Unable to get scene texture \"%s\"", __FUNCTION__,
+          name.c_str());
+  }
+  return texture;
+}
+
+}  // namespace android
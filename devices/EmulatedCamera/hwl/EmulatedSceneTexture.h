@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * EmulatedSceneTexture holds a high resolution scene as a chain of
+ * mipmapped, linear-light RGB reflectance images. Each level stores the R, G
+ * and B channels in separate 16-bit planes, so a run of texels along a row
+ * converts to floats with simple vectorizable loops.
+ *
+ * Textures are either memory-mapped from an asset file or generated
+ * procedurally. The asset file layout, all values little-endian:
+ *
+ *   FileHeader (see below)
+ *   for each level, for each channel R, G, B:
+ *     width(level) * height(level) uint16_t reflectances, 65535 == 1.0,
+ *     starting at a 64-byte aligned offset from the start of the file.
+ *
+ * width(level) = max(1, width >> level), likewise for the height.
+ */
+
+#ifndef HW_EMULATOR_CAMERA_SCENE_TEXTURE_H
+#define HW_EMULATOR_CAMERA_SCENE_TEXTURE_H
+
+#include <utils/Errors.h>
+
+#include <array>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace android {
+
+class EmulatedSceneTexture {
+ public:
+  enum class Pattern {
+    // Color checker, gray ramp, resolution star and slanted edge.
+    kTestChart,
+    // Fractal noise with the 1/f amplitude spectrum and log-normal
+    // reflectance distribution of natural images.
+    kNaturalImage,
+  };
+
+  enum Channel { kRed = 0, kGreen, kBlue, kNumChannels };
+
+  struct Level {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::array<const uint16_t*, kNumChannels> planes = {};
+  };
+
+  // Texel value of a reflectance of 1.0.
+  static constexpr uint16_t kMaxValue = 0xFFFF;
+
+  // Map a texture asset. Returns nullptr if the file is missing or invalid.
+  static std::unique_ptr<EmulatedSceneTexture> Load(const char* path);
+
+  // Generate a texture of pattern with a level 0 of width x height.
+  static std::unique_ptr<EmulatedSceneTexture> Generate(Pattern pattern,
+                                                        uint32_t width,
+                                                        uint32_t height);
+
+  ~EmulatedSceneTexture();
+
+  // Write the texture as an asset that can be passed to Load().
+  status_t Save(const char* path) const;
+
+  size_t GetNumLevels() const {
+    return levels_.size();
+  }
+
+  const Level& GetLevel(size_t level) const {
+    return levels_[level];
+  }
+
+  // Sample count texels of level with nearest filtering, starting at texel
+  // coordinates (u, v) and stepping by (du, dv) per texel. Coordinates are
+  // 16.16 fixed point and clamped to the level. Reflectances are written to
+  // the planar outputs r, g and b.
+  void SampleLine(size_t level, int32_t u, int32_t v, int32_t du, int32_t dv,
+                  size_t count, float* r, float* g, float* b) const;
+
+ private:
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_levels;
+    uint32_t reserved;
+  };
+
+  static constexpr uint32_t kMagic = 0x58545345;  // "ESTX"
+  static constexpr uint32_t kVersion = 1;
+  static constexpr size_t kPlaneAlignment = 64;
+  // Levels smaller than this in either dimension are not generated.
+  static constexpr uint32_t kMinLevelSize = 16;
+  static constexpr uint32_t kMaxLevels = 16;
+
+  EmulatedSceneTexture() = default;
+
+  static uint32_t GetNumLevels(uint32_t width, uint32_t height);
+
+  // Compute the byte offsets of all planes in the asset layout. Returns the
+  // total size in bytes.
+  static size_t GetLayout(uint32_t width, uint32_t height, uint32_t num_levels,
+                          std::vector<size_t>* plane_offsets);
+
+  // Point levels_ into data laid out by GetLayout().
+  void SetLevels(const uint8_t* data, uint32_t width, uint32_t height,
+                 uint32_t num_levels, const std::vector<size_t>& plane_offsets);
+
+  // Fill level 0 of storage_ with pattern.
+  void GeneratePattern(Pattern pattern);
+
+  // Fill all levels after 0 by 2x2 box filtering the previous level.
+  void GenerateMipmaps();
+
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  std::vector<Level> levels_;
+
+  // Backing store of generated textures.
+  std::vector<uint8_t> storage_;
+
+  // Mapping of loaded textures.
+  void* mapped_data_ = nullptr;
+  size_t mapped_size_ = 0;
+};
+
+/**
+ * EmulatedSceneTextureCache shares scene textures between the sensors of the
+ * process. Textures are built on a background thread, so opening a camera
+ * doesn't wait for a full resolution texture to be generated. The most
+ * recently built texture stays cached after its last user released it, so
+ * reopening a camera doesn't build it again.
+ *
+ * Thread safe.
+ */
+class EmulatedSceneTextureCache {
+ public:
+  using TextureFuture =
+      std::shared_future<std::shared_ptr<const EmulatedSceneTexture>>;
+
+  // Cache shared by the sensors of the process.
+  static EmulatedSceneTextureCache& GetInstance();
+
+  EmulatedSceneTextureCache() = default;
+
+  // Get the texture name, "testchart" or "natural" for a generated texture
+  // of width x height, or the path of a texture asset. The future holds
+  // nullptr if the texture can't be built.
+  TextureFuture Get(const std::string& name, uint32_t width, uint32_t height);
+
+  // Number of textures built so far.
+  uint32_t GetBuildCount();
+
+  // Disallow copy and assignment operators
+  EmulatedSceneTextureCache(const EmulatedSceneTextureCache&) = delete;
+  EmulatedSceneTextureCache& operator=(const EmulatedSceneTextureCache&) =
+      delete;
+
+ private:
+  // Name, width and height. The size of assets is 0x0.
+  using Key = std::tuple<std::string, uint32_t, uint32_t>;
+
+  static std::shared_ptr<const EmulatedSceneTexture> Build(const Key& key);
+
+  std::mutex lock_;
+  // Textures being built. Protected by lock_.
+  std::map<Key, TextureFuture> pending_;
+  // Built textures. Protected by lock_.
+  std::map<Key, std::weak_ptr<const EmulatedSceneTexture>> textures_;
+  // Protected by lock_.
+  std::shared_ptr<const EmulatedSceneTexture> last_texture_;
+  // Protected by lock_.
+  uint32_t build_count_ = 0;
+};
+
+}  // namespace android
+
+#endif  // HW_EMULATOR_CAMERA_SCENE_TEXTURE_H
@@ -35,10 +35,16 @@
 #include <utils/Log.h>
 #include <utils/Trace.h>
 
+#include <chrono>
 #include <cmath>
 #include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
 
 #include "EmulatedSensor.h"
+#include "thread_role_manager.h"
 #include "utils/ExifUtils.h"
 #include "utils/HWLUtils.h"
 
@@ -72,7 +78,11 @@ enum ColorSpaceNamed {
 };
 
 const uint32_t EmulatedSensor::kRegularSceneHandshake = 1; // Scene handshake divider
-const uint32_t EmulatedSensor::kReducedSceneHandshake = 2; // Scene handshake divider
+const nsecs_t EmulatedSensor::kStabilizationLatencyBudget = 5000000;  // 5 ms
+const float EmulatedSensor::kStabilizationMargin = 0.1f;
+const nsecs_t EmulatedSensor::kFaceDetectionDeadline = 15000000;  // 15 ms
+const nsecs_t EmulatedSensor::kVirtualClockIdleFrameTime = 1000000;  // 1 ms
+const uint64_t EmulatedSensor::kFrameRateStatsInterval = 300;
 
 // 1 us - 30 sec
 const nsecs_t EmulatedSensor::kSupportedExposureTimeRange[2] = {1000LL,
@@ -192,7 +202,10 @@ float sqrtf_approx(float r) {
   return *(float*)(&r_i);
 }
 
-EmulatedSensor::EmulatedSensor() : Thread(false), got_vsync_(false) {
+EmulatedSensor::EmulatedSensor()
+    : Thread(false),
+      got_vsync_(false),
+      clock_(std::make_shared<EmulatedRealClock>()) {
   gamma_table_sRGB_.resize(kSaturationPoint + 1);
   gamma_table_smpte170m_.resize(kSaturationPoint + 1);
   gamma_table_hlg_.resize(kSaturationPoint + 1);
@@ -666,7 +679,56 @@ status_t EmulatedSensor::StartUp(
       device_chars->second.full_res_width, device_chars->second.full_res_height,
       kElectronsPerLuxSecond, device_chars->second.orientation,
       device_chars->second.is_front_facing);
-  jpeg_compressor_ = std::make_unique<JpegCompressor>();
+  // The built-in scene renders until the texture is built, see
+  // UpdateSceneTexture().
+  scene_texture_ = {};
+  char scene_texture[PROPERTY_VALUE_MAX];
+  if (property_get("persist.vendor.camera.emulated.scene_texture",
+                   scene_texture, "") > 0) {
+    scene_texture_ = EmulatedSceneTextureCache::GetInstance().Get(
+        scene_texture, device_chars->second.full_res_width,
+        device_chars->second.full_res_height);
+  }
+  // The virtual clock lets long test runs go as fast as frames render.
+  if (property_get_bool("persist.vendor.camera.emulated.virtual_clock",
+                        false)) {
+    clock_ = std::make_shared<EmulatedVirtualClock>();
+  } else {
+    clock_ = std::make_shared<EmulatedRealClock>();
+  }
+  jpeg_compressor_ = std::make_unique<JpegCompressor>(clock_);
+  isp_ = EmulatedIsp::Create();
+  lens_shading_.clear();
+  pixel_defects_.clear();
+  stabilization_.clear();
+  for (const auto& it : *chars_) {
+    // Seeded with the camera id, so every sensor has its own defects.
+    pixel_defects_[it.first] = EmulatedPixelDefects::Create(
+        it.second.width, it.second.height, /*seed*/ it.first);
+    if ((it.second.lens_shading_map_size[0] > 0) &&
+        (it.second.lens_shading_map_size[1] > 0)) {
+      lens_shading_[it.first] = EmulatedLensShading::Create(
+          it.second.focal_length, it.second.physical_size,
+          it.second.lens_shading_map_size[0],
+          it.second.lens_shading_map_size[1]);
+    }
+  }
+  if (device_chars->second.max_face_count > 0) {
+    face_detector_ =
+        EmulatedFaceDetector::Create(kFaceDetectionDeadline, clock_);
+  }
+  frame_rate_governor_ = EmulatedFrameRateGovernor::Create(property_get_bool(
+      "persist.vendor.camera.emulated.fps_governor", true));
+  governor_frame_start_time_ = 0;
+  // Frames of all sensors render on the shared pool, unless disabled to
+  // compare against rendering on the sensor threads.
+  render_pool_ = nullptr;
+  render_client_ = EmulatedRenderPool::kInvalidClient;
+  if (EmulatedRenderPool::IsSharedPoolEnabled()) {
+    render_pool_ = EmulatedRenderPool::GetShared();
+    render_client_ = render_pool_->AddClient(
+        "Sensor " + std::to_string(logical_camera_id));
+  }
 
   auto res = run(LOG_TAG, ANDROID_PRIORITY_URGENT_DISPLAY);
   if (res != OK) {
@@ -682,6 +744,15 @@ status_t EmulatedSensor::ShutDown() {
   if (res != OK) {
     ALOGE("Unable to shut down sensor capture thread: %d", res);
   }
+  if ((res == OK) && (render_pool_ != nullptr)) {
+    render_pool_->RemoveClient(render_client_);
+    render_pool_ = nullptr;
+  }
+  if (res == OK) {
+    // The stabilizers and their frame buffers are only used by the capture
+    // thread.
+    stabilization_.clear();
+  }
   return res;
 }
 
@@ -724,7 +795,7 @@ status_t EmulatedSensor::Flush() {
 
   // First recreate the jpeg compressor. This will abort any ongoing processing
   // and flush any pending jobs.
-  jpeg_compressor_ = std::make_unique<JpegCompressor>();
+  jpeg_compressor_ = std::make_unique<JpegCompressor>(clock_);
 
   // Then return any pending frames here
   if ((current_input_buffers_.get() != nullptr) &&
@@ -760,10 +831,29 @@ status_t EmulatedSensor::Flush() {
 }
 
 nsecs_t EmulatedSensor::getSystemTimeWithSource(uint32_t timestamp_source) {
-  if (timestamp_source == ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME) {
-    return systemTime(SYSTEM_TIME_BOOTTIME);
+  return clock_->GetTime(timestamp_source);
+}
+
+status_t EmulatedSensor::readyToRun() {
+  // The sensor runs even if the policy of its role can't be applied. With a
+  // render pool the sensor thread paces the frames, and renders them itself
+  // only while the pool has a free worker.
+  google_camera_hal::ThreadRoleManager::GetInstance().RegisterCurrentThread(
+      render_pool_ != nullptr ? google_camera_hal::ThreadRole::kFramePacing
+                              : google_camera_hal::ThreadRole::kRender,
+      "EmulatedSensor");
+  return OK;
+}
+
+void EmulatedSensor::UpdateSceneTexture() {
+  if (!scene_texture_.valid() ||
+      scene_texture_.wait_for(std::chrono::seconds(0)) !=
+          std::future_status::ready) {
+    return;
   }
-  return systemTime(SYSTEM_TIME_MONOTONIC);
+
+  scene_->SetTexture(scene_texture_.get());
+  scene_texture_ = {};
 }
 
 bool EmulatedSensor::threadLoop() {
@@ -801,15 +891,36 @@ bool EmulatedSensor::threadLoop() {
   }
 
   auto frame_duration = EmulatedSensor::kSupportedFrameDurationRange[0];
+  nsecs_t max_frame_duration = 0;
   auto exposure_time = EmulatedSensor::kSupportedExposureTimeRange[0];
   uint32_t timestamp_source = ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN;
   // Frame duration must always be the same among all physical devices
   if ((settings.get() != nullptr) && (!settings->empty())) {
     frame_duration = settings->begin()->second.frame_duration;
+    max_frame_duration = settings->begin()->second.max_frame_duration;
     exposure_time = settings->begin()->second.exposure_time;
     timestamp_source = settings->begin()->second.timestamp_source;
   }
 
+  // Frames without buffers don't load the host and aren't governed.
+  bool governed_frame = (frame_rate_governor_.get() != nullptr) &&
+                        (next_buffers.get() != nullptr) &&
+                        (settings.get() != nullptr);
+  if (governed_frame) {
+    frame_duration = frame_rate_governor_->GetFrameDuration(frame_duration,
+                                                            max_frame_duration);
+    camera_metadata_ro_entry_t entry;
+    if ((next_result.get() != nullptr) &&
+        (next_result->result_metadata.get() != nullptr) &&
+        (next_result->result_metadata->Get(ANDROID_SENSOR_FRAME_DURATION,
+                                           &entry) == OK)) {
+      next_result->result_metadata->Set(ANDROID_SENSOR_FRAME_DURATION,
+                                        &frame_duration, 1);
+    }
+  }
+
+  nsecs_t start_work_time =
+      clock_->GetTime(ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN);
   nsecs_t start_real_time = getSystemTimeWithSource(timestamp_source);
   // Stagefright cares about system time for timestamps, so base simulated
   // time on that.
@@ -818,6 +929,7 @@ bool EmulatedSensor::threadLoop() {
   /**
    * Stage 2: Capture new image
    */
+  UpdateSceneTexture();
   next_capture_time_ = frame_end_real_time;
   next_readout_time_ = frame_end_real_time + exposure_time;
 
@@ -861,227 +973,379 @@ bool EmulatedSensor::threadLoop() {
                   static_cast<uint64_t>(next_readout_time_)}};
       callback.notify(next_result->pipeline_id, msg);
     }
-    auto b = next_buffers->begin();
-    while (b != next_buffers->end()) {
-      auto device_settings = settings->find((*b)->camera_id);
-      if (device_settings == settings->end()) {
-        ALOGE("%s: Sensor settings absent for device: %d", __func__,
-              (*b)->camera_id);
-        b = next_buffers->erase(b);
-        continue;
-      }
+    auto render = [&] {
+      RenderOutputBuffers(settings.get(), reprocess_request,
+                          next_buffers.get(), next_input_buffer.get(),
+                          next_result.get());
+    };
+    // The frame is due at the end of its frame duration.
+    if ((render_pool_ == nullptr) ||
+        (render_pool_->RunAndWait(render_client_,
+                                  start_work_time + frame_duration,
+                                  render) != OK)) {
+      render();
+    }
+  }
 
-      auto device_chars = chars_->find((*b)->camera_id);
-      if (device_chars == chars_->end()) {
-        ALOGE("%s: Sensor characteristics absent for device: %d", __func__,
-              (*b)->camera_id);
-        b = next_buffers->erase(b);
-        continue;
-      }
+  if (reprocess_request) {
+    auto input_buffer = next_input_buffer->begin();
+    while (input_buffer != next_input_buffer->end()) {
+      (*input_buffer++)->stream_buffer.status = BufferStatus::kOk;
+    }
+    next_input_buffer->clear();
+  }
 
-      sensor_binning_factor_info_[(*b)->camera_id].quad_bayer_sensor =
-          device_chars->second.quad_bayer_sensor;
-
-      ALOGVV("Starting next capture: Exposure: %" PRIu64 " ms, gain: %d",
-             ns2ms(device_settings->second.exposure_time),
-             device_settings->second.gain);
-
-      scene_->Initialize(device_chars->second.full_res_width,
-                         device_chars->second.full_res_height,
-                         kElectronsPerLuxSecond);
-      scene_->SetExposureDuration((float)device_settings->second.exposure_time /
-                                  1e9);
-      scene_->SetColorFilterXYZ(device_chars->second.color_filter.rX,
-                                device_chars->second.color_filter.rY,
-                                device_chars->second.color_filter.rZ,
-                                device_chars->second.color_filter.grX,
-                                device_chars->second.color_filter.grY,
-                                device_chars->second.color_filter.grZ,
-                                device_chars->second.color_filter.gbX,
-                                device_chars->second.color_filter.gbY,
-                                device_chars->second.color_filter.gbZ,
-                                device_chars->second.color_filter.bX,
-                                device_chars->second.color_filter.bY,
-                                device_chars->second.color_filter.bZ);
-      scene_->SetTestPattern(device_settings->second.test_pattern_mode ==
-                             ANDROID_SENSOR_TEST_PATTERN_MODE_SOLID_COLOR);
-      scene_->SetTestPatternData(device_settings->second.test_pattern_data);
-      scene_->SetScreenRotation(device_settings->second.screen_rotation);
-
-      uint32_t handshake_divider =
-          (device_settings->second.video_stab ==
-           ANDROID_CONTROL_VIDEO_STABILIZATION_MODE_ON) ||
-                  (device_settings->second.video_stab ==
-                   ANDROID_CONTROL_VIDEO_STABILIZATION_MODE_PREVIEW_STABILIZATION)
-              ? kReducedSceneHandshake
-              : kRegularSceneHandshake;
-      scene_->CalculateScene(next_capture_time_, handshake_divider);
-
-      (*b)->stream_buffer.status = BufferStatus::kOk;
-      bool max_res_mode = device_settings->second.sensor_pixel_mode;
-      sensor_binning_factor_info_[(*b)->camera_id].max_res_request =
-          max_res_mode;
-      switch ((*b)->format) {
-        case PixelFormat::RAW16:
-          sensor_binning_factor_info_[(*b)->camera_id].has_raw_stream = true;
-          if (!sensor_binning_factor_info_[(*b)->camera_id]
-                   .has_cropped_raw_stream &&
-              (*b)->use_case ==
-                  ANDROID_SCALER_AVAILABLE_STREAM_USE_CASES_CROPPED_RAW) {
-            sensor_binning_factor_info_[(*b)->camera_id].has_cropped_raw_stream =
-                true;
-          }
-          break;
-        default:
-          sensor_binning_factor_info_[(*b)->camera_id].has_non_raw_stream = true;
+  if (governed_frame) {
+    UpdateFrameRateGovernor(start_real_time, start_work_time);
+  } else {
+    governor_frame_start_time_ = 0;
+  }
+
+  nsecs_t work_done_real_time = getSystemTimeWithSource(timestamp_source);
+  // Returning the results at this point is not entirely correct from timing
+  // perspective. Under ideal conditions where 'ReturnResults' completes
+  // in less than 'time_accuracy' we need to return the results after the
+  // frame cycle expires. However under real conditions various system
+  // components like SurfaceFlinger, Encoder, LMK etc. could be consuming most
+  // of the resources and the duration of "ReturnResults" can get comparable to
+  // 'kDefaultFrameDuration'. This will skew the frame cycle and can result in
+  // potential frame drops. To avoid this scenario when we are running under
+  // tight deadlines (less than 'kReturnResultThreshod') try to return the
+  // results immediately. In all other cases with more relaxed deadlines
+  // the occasional bump during 'ReturnResults' should not have any
+  // noticeable effect.
+  if ((work_done_real_time + kReturnResultThreshod) > frame_end_real_time) {
+    ReturnResults(callback, std::move(settings), std::move(next_result),
+                  reprocess_request, std::move(partial_result));
+  }
+
+  work_done_real_time = getSystemTimeWithSource(timestamp_source);
+  ALOGVV("Sensor vertical blanking interval");
+  const nsecs_t time_accuracy = 2e6;  // 2 ms of imprecision is ok
+  if (work_done_real_time < frame_end_real_time - time_accuracy) {
+    clock_->WaitUntil(timestamp_source, frame_end_real_time);
+  }
+  if (clock_->IsVirtual() && (next_buffers.get() == nullptr)) {
+    std::this_thread::sleep_for(
+        std::chrono::nanoseconds(kVirtualClockIdleFrameTime));
+  }
+
+  ReturnResults(callback, std::move(settings), std::move(next_result),
+                reprocess_request, std::move(partial_result));
+
+  return true;
+};
+
+void EmulatedSensor::RenderOutputBuffers(LogicalCameraSettings* settings,
+                                         bool reprocess_request,
+                                         Buffers* next_buffers,
+                                         Buffers* next_input_buffer,
+                                         HwlPipelineResult* next_result) {
+  ATRACE_CALL();
+  // RAW16 reprocess input developed by the ISP, shared by the outputs
+  // with the same color space.
+  std::vector<uint8_t> developed_yuv;
+  YUV420Frame developed_input{};
+  int32_t developed_color_space = 0;
+  // Cameras whose stabilizers got the gyro samples of this frame.
+  std::set<uint32_t> gyro_updated_cameras;
+  // Only one output per frame is passed to the face detector.
+  bool face_frame_submitted = reprocess_request;
+  auto b = next_buffers->begin();
+  while (b != next_buffers->end()) {
+    auto device_settings = settings->find((*b)->camera_id);
+    if (device_settings == settings->end()) {
+      ALOGE("%s: Sensor settings absent for device: %d", __func__,
+            (*b)->camera_id);
+      b = next_buffers->erase(b);
+      continue;
+    }
+
+    auto device_chars = chars_->find((*b)->camera_id);
+    if (device_chars == chars_->end()) {
+      ALOGE("%s: Sensor characteristics absent for device: %d", __func__,
+            (*b)->camera_id);
+      b = next_buffers->erase(b);
+      continue;
+    }
+
+    sensor_binning_factor_info_[(*b)->camera_id].quad_bayer_sensor =
+        device_chars->second.quad_bayer_sensor;
+
+    ALOGVV("Starting next capture: Exposure: %" PRIu64 " ms, gain: %d",
+           ns2ms(device_settings->second.exposure_time),
+           device_settings->second.gain);
+
+    scene_->Initialize(device_chars->second.full_res_width,
+                       device_chars->second.full_res_height,
+                       kElectronsPerLuxSecond);
+    scene_->SetExposureDuration((float)device_settings->second.exposure_time /
+                                1e9);
+    scene_->SetColorFilterXYZ(device_chars->second.color_filter.rX,
+                              device_chars->second.color_filter.rY,
+                              device_chars->second.color_filter.rZ,
+                              device_chars->second.color_filter.grX,
+                              device_chars->second.color_filter.grY,
+                              device_chars->second.color_filter.grZ,
+                              device_chars->second.color_filter.gbX,
+                              device_chars->second.color_filter.gbY,
+                              device_chars->second.color_filter.gbZ,
+                              device_chars->second.color_filter.bX,
+                              device_chars->second.color_filter.bY,
+                              device_chars->second.color_filter.bZ);
+    scene_->SetTestPattern(device_settings->second.test_pattern_mode ==
+                           ANDROID_SENSOR_TEST_PATTERN_MODE_SOLID_COLOR);
+    scene_->SetTestPatternData(device_settings->second.test_pattern_data);
+    scene_->SetScreenRotation(device_settings->second.screen_rotation);
+
+    // Stabilized streams are rendered with the full handshake and
+    // corrected afterwards.
+    bool stabilize =
+        !reprocess_request &&
+        ((device_settings->second.video_stab ==
+          ANDROID_CONTROL_VIDEO_STABILIZATION_MODE_ON) ||
+         (device_settings->second.video_stab ==
+          ANDROID_CONTROL_VIDEO_STABILIZATION_MODE_PREVIEW_STABILIZATION));
+    scene_->CalculateScene(next_capture_time_, kRegularSceneHandshake);
+    if (stabilize) {
+      if (gyro_updated_cameras.insert((*b)->camera_id).second) {
+        UpdateGyroSamples((*b)->camera_id, device_chars->second);
       }
+    } else if (!reprocess_request) {
+      stabilization_.erase((*b)->camera_id);
+    }
 
-      // TODO: remove hack. Implement RAW -> YUV / JPEG reprocessing http://b/192382904
-      bool treat_as_reprocess =
-          (device_chars->second.quad_bayer_sensor && reprocess_request &&
-           (*next_input_buffer->begin())->format == PixelFormat::RAW16)
-              ? false
-              : reprocess_request;
-      ProcessType process_type = treat_as_reprocess ? REPROCESS
-                                 : (device_settings->second.edge_mode ==
-                                    ANDROID_EDGE_MODE_HIGH_QUALITY)
-                                     ? HIGH_QUALITY
-                                     : REGULAR;
-
-      if ((*b)->color_space !=
-          ANDROID_REQUEST_AVAILABLE_COLOR_SPACE_PROFILES_MAP_UNSPECIFIED) {
-        CalculateRgbRgbMatrix((*b)->color_space, device_chars->second);
+    (*b)->stream_buffer.status = BufferStatus::kOk;
+    bool max_res_mode = device_settings->second.sensor_pixel_mode;
+    sensor_binning_factor_info_[(*b)->camera_id].max_res_request =
+        max_res_mode;
+    switch ((*b)->format) {
+      case PixelFormat::RAW16:
+        sensor_binning_factor_info_[(*b)->camera_id].has_raw_stream = true;
+        if (!sensor_binning_factor_info_[(*b)->camera_id]
+                 .has_cropped_raw_stream &&
+            (*b)->use_case ==
+                ANDROID_SCALER_AVAILABLE_STREAM_USE_CASES_CROPPED_RAW) {
+          sensor_binning_factor_info_[(*b)->camera_id].has_cropped_raw_stream =
+              true;
+        }
+        break;
+      default:
+        sensor_binning_factor_info_[(*b)->camera_id].has_non_raw_stream = true;
+    }
+
+    ProcessType process_type = reprocess_request ? REPROCESS
+                               : (device_settings->second.edge_mode ==
+                                  ANDROID_EDGE_MODE_HIGH_QUALITY)
+                                   ? HIGH_QUALITY
+                                   : REGULAR;
+
+    if ((*b)->color_space !=
+        ANDROID_REQUEST_AVAILABLE_COLOR_SPACE_PROFILES_MAP_UNSPECIFIED) {
+      CalculateRgbRgbMatrix((*b)->color_space, device_chars->second);
+    }
+
+    // Processed outputs of RAW16 inputs are scaled from the developed
+    // input by the YUV reprocess path.
+    YUV420Frame reprocess_input{};
+    if (reprocess_request) {
+      const auto& input = *next_input_buffer->begin();
+      if (input->format != PixelFormat::RAW16) {
+        reprocess_input = {.width = input->width,
+                           .height = input->height,
+                           .planes = input->plane.img_y_crcb};
+      } else if ((*b)->format != PixelFormat::RAW16) {
+        if (developed_yuv.empty() ||
+            developed_color_space != (*b)->color_space) {
+          developed_yuv.clear();
+          if (DevelopRAW16(*input, (*b)->color_space, device_chars->second,
+                           (*b)->camera_id,
+                           device_settings->second.hot_pixel_mode,
+                           &developed_yuv, &developed_input) != OK) {
+            (*b)->stream_buffer.status = BufferStatus::kError;
+            b = next_buffers->erase(b);
+            continue;
+          }
+          developed_color_space = (*b)->color_space;
+        }
+        reprocess_input = developed_input;
       }
+    }
 
-      switch ((*b)->format) {
-        case PixelFormat::RAW16:
-          if (!reprocess_request) {
-            uint64_t min_full_res_raw_size =
-                2 * device_chars->second.full_res_width *
-                device_chars->second.full_res_height;
-            uint64_t min_default_raw_size =
-                2 * device_chars->second.width * device_chars->second.height;
-            bool default_mode_for_qb =
-                device_chars->second.quad_bayer_sensor && !max_res_mode;
-            size_t buffer_size = (*b)->plane.img.buffer_size;
-            if (default_mode_for_qb) {
-              if (buffer_size < min_default_raw_size) {
-                ALOGE(
-                    "%s: Output buffer size too small for RAW capture in "
-                    "default "
-                    "mode, "
-                    "expected %" PRIu64 ", got %zu, for camera id %d",
-                    __FUNCTION__, min_default_raw_size, buffer_size,
-                    (*b)->camera_id);
-                (*b)->stream_buffer.status = BufferStatus::kError;
-                break;
-              }
-            } else if (buffer_size < min_full_res_raw_size) {
+    switch ((*b)->format) {
+      case PixelFormat::RAW16:
+        if (!reprocess_request) {
+          uint64_t min_full_res_raw_size =
+              2 * device_chars->second.full_res_width *
+              device_chars->second.full_res_height;
+          uint64_t min_default_raw_size =
+              2 * device_chars->second.width * device_chars->second.height;
+          bool default_mode_for_qb =
+              device_chars->second.quad_bayer_sensor && !max_res_mode;
+          size_t buffer_size = (*b)->plane.img.buffer_size;
+          if (default_mode_for_qb) {
+            if (buffer_size < min_default_raw_size) {
               ALOGE(
-                  "%s: Output buffer size too small for RAW capture in max res "
+                  "%s: Output buffer size too small for RAW capture in "
+                  "default "
                   "mode, "
                   "expected %" PRIu64 ", got %zu, for camera id %d",
-                  __FUNCTION__, min_full_res_raw_size, buffer_size,
+                  __FUNCTION__, min_default_raw_size, buffer_size,
                   (*b)->camera_id);
               (*b)->stream_buffer.status = BufferStatus::kError;
               break;
             }
-            if (default_mode_for_qb) {
-              if (device_settings->second.zoom_ratio > 2.0f &&
-                  ((*b)->use_case ==
-                   ANDROID_SCALER_AVAILABLE_STREAM_USE_CASES_CROPPED_RAW)) {
-                sensor_binning_factor_info_[(*b)->camera_id]
-                    .raw_in_sensor_zoom_applied = true;
-                CaptureRawInSensorZoom(
-                    (*b)->plane.img.img, (*b)->plane.img.stride_in_bytes,
-                    device_settings->second.gain, device_chars->second);
-
-              } else {
-                CaptureRawBinned(
-                    (*b)->plane.img.img, (*b)->plane.img.stride_in_bytes,
-                    device_settings->second.gain, device_chars->second);
-              }
+          } else if (buffer_size < min_full_res_raw_size) {
+            ALOGE(
+                "%s: Output buffer size too small for RAW capture in max res "
+                "mode, "
+                "expected %" PRIu64 ", got %zu, for camera id %d",
+                __FUNCTION__, min_full_res_raw_size, buffer_size,
+                (*b)->camera_id);
+            (*b)->stream_buffer.status = BufferStatus::kError;
+            break;
+          }
+          if (default_mode_for_qb) {
+            if (device_settings->second.zoom_ratio > 2.0f &&
+                ((*b)->use_case ==
+                 ANDROID_SCALER_AVAILABLE_STREAM_USE_CASES_CROPPED_RAW)) {
+              sensor_binning_factor_info_[(*b)->camera_id]
+                  .raw_in_sensor_zoom_applied = true;
+              CaptureRawInSensorZoom(
+                  (*b)->plane.img.img, (*b)->plane.img.stride_in_bytes,
+                  device_settings->second.gain, device_chars->second,
+                  (*b)->camera_id);
+
             } else {
-              CaptureRawFullRes(
+              CaptureRawBinned(
                   (*b)->plane.img.img, (*b)->plane.img.stride_in_bytes,
-                  device_settings->second.gain, device_chars->second);
+                  device_settings->second.gain, device_chars->second,
+                  (*b)->camera_id);
             }
           } else {
-            if (!device_chars->second.quad_bayer_sensor) {
-              ALOGE(
-                  "%s: Reprocess requests with output format %x no supported!",
-                  __FUNCTION__, (*b)->format);
-              (*b)->stream_buffer.status = BufferStatus::kError;
-              break;
-            }
-            // Remosaic the RAW input buffer
-            if ((*next_input_buffer->begin())->width != (*b)->width ||
-                (*next_input_buffer->begin())->height != (*b)->height) {
-              ALOGE(
-                  "%s: RAW16 input dimensions %dx%d don't match output buffer "
-                  "dimensions %dx%d",
-                  __FUNCTION__, (*next_input_buffer->begin())->width,
-                  (*next_input_buffer->begin())->height, (*b)->width,
-                  (*b)->height);
-              (*b)->stream_buffer.status = BufferStatus::kError;
-              break;
-            }
-            ALOGV("%s remosaic Raw16 Image", __FUNCTION__);
-            RemosaicRAW16Image(
-                (uint16_t*)(*next_input_buffer->begin())->plane.img.img,
-                (uint16_t*)(*b)->plane.img.img, (*b)->plane.img.stride_in_bytes,
-                device_chars->second);
+            CaptureRawFullRes(
+                (*b)->plane.img.img, (*b)->plane.img.stride_in_bytes,
+                device_settings->second.gain, device_chars->second,
+                (*b)->camera_id);
           }
-          break;
-        case PixelFormat::RGB_888:
-          if (!reprocess_request) {
-            CaptureRGB((*b)->plane.img.img, (*b)->width, (*b)->height,
-                       (*b)->plane.img.stride_in_bytes, RGBLayout::RGB,
-                       device_settings->second.gain, (*b)->color_space,
-                       device_chars->second);
-          } else {
-            ALOGE("%s: Reprocess requests with output format %x no supported!",
-                  __FUNCTION__, (*b)->format);
+        } else {
+          if (!device_chars->second.quad_bayer_sensor) {
+            ALOGE(
+                "%s: Reprocess requests with output format %x no supported!",
+                __FUNCTION__, (*b)->format);
             (*b)->stream_buffer.status = BufferStatus::kError;
+            break;
           }
-          break;
-        case PixelFormat::RGBA_8888:
-          if (!reprocess_request) {
-            CaptureRGB((*b)->plane.img.img, (*b)->width, (*b)->height,
-                       (*b)->plane.img.stride_in_bytes, RGBLayout::RGBA,
-                       device_settings->second.gain, (*b)->color_space,
-                       device_chars->second);
-          } else {
-            ALOGE("%s: Reprocess requests with output format %x no supported!",
-                  __FUNCTION__, (*b)->format);
+          // Remosaic the RAW input buffer
+          if ((*next_input_buffer->begin())->width != (*b)->width ||
+              (*next_input_buffer->begin())->height != (*b)->height) {
+            ALOGE(
+                "%s: RAW16 input dimensions %dx%d don't match output buffer "
+                "dimensions %dx%d",
+                __FUNCTION__, (*next_input_buffer->begin())->width,
+                (*next_input_buffer->begin())->height, (*b)->width,
+                (*b)->height);
             (*b)->stream_buffer.status = BufferStatus::kError;
+            break;
           }
-          break;
-        case PixelFormat::BLOB:
-          if ((*b)->dataSpace == HAL_DATASPACE_V0_JFIF) {
-            YUV420Frame yuv_input{
-                .width = treat_as_reprocess
-                             ? (*next_input_buffer->begin())->width
-                             : 0,
-                .height = treat_as_reprocess
-                              ? (*next_input_buffer->begin())->height
-                              : 0,
-                .planes = treat_as_reprocess
-                              ? (*next_input_buffer->begin())->plane.img_y_crcb
-                              : YCbCrPlanes{}};
+          ALOGV("%s remosaic Raw16 Image", __FUNCTION__);
+          RemosaicRAW16Image(
+              (uint16_t*)(*next_input_buffer->begin())->plane.img.img,
+              (uint16_t*)(*b)->plane.img.img, (*b)->plane.img.stride_in_bytes,
+              device_chars->second);
+        }
+        break;
+      case PixelFormat::RGB_888:
+        if (!reprocess_request) {
+          CaptureRGB((*b)->plane.img.img, (*b)->width, (*b)->height,
+                     (*b)->plane.img.stride_in_bytes, RGBLayout::RGB,
+                     device_settings->second.gain, (*b)->color_space,
+                     device_chars->second);
+        } else {
+          ALOGE("%s: Reprocess requests with output format %x no supported!",
+                __FUNCTION__, (*b)->format);
+          (*b)->stream_buffer.status = BufferStatus::kError;
+        }
+        break;
+      case PixelFormat::RGBA_8888:
+        if (!reprocess_request) {
+          CaptureRGB((*b)->plane.img.img, (*b)->width, (*b)->height,
+                     (*b)->plane.img.stride_in_bytes, RGBLayout::RGBA,
+                     device_settings->second.gain, (*b)->color_space,
+                     device_chars->second);
+        } else {
+          ALOGE("%s: Reprocess requests with output format %x no supported!",
+                __FUNCTION__, (*b)->format);
+          (*b)->stream_buffer.status = BufferStatus::kError;
+        }
+        break;
+      case PixelFormat::BLOB:
+        if ((*b)->dataSpace == HAL_DATASPACE_V0_JFIF) {
+          auto jpeg_input = std::make_unique<JpegYUV420Input>();
+          jpeg_input->width = (*b)->width;
+          jpeg_input->height = (*b)->height;
+          jpeg_input->color_space = (*b)->color_space;
+          auto img =
+              new uint8_t[(jpeg_input->width * jpeg_input->height * 3) / 2];
+          jpeg_input->yuv_planes = {
+              .img_y = img,
+              .img_cb = img + jpeg_input->width * jpeg_input->height,
+              .img_cr = img + (jpeg_input->width * jpeg_input->height * 5) / 4,
+              .y_stride = jpeg_input->width,
+              .cbcr_stride = jpeg_input->width / 2,
+              .cbcr_step = 1};
+          jpeg_input->buffer_owner = true;
+          YUV420Frame yuv_output{.width = jpeg_input->width,
+                                 .height = jpeg_input->height,
+                                 .planes = jpeg_input->yuv_planes};
+
+          bool rotate = device_settings->second.rotate_and_crop ==
+                        ANDROID_SCALER_ROTATE_AND_CROP_90;
+          auto ret = ProcessYUV420(reprocess_input, yuv_output,
+                                   device_settings->second.gain, process_type,
+                                   device_settings->second.zoom_ratio, rotate,
+                                   (*b)->color_space, device_chars->second);
+          if (ret != 0) {
+            (*b)->stream_buffer.status = BufferStatus::kError;
+            break;
+          }
+          if (!reprocess_request && !rotate) {
+            ApplyPixelDefects(yuv_output, (*b)->camera_id,
+                              device_settings->second.zoom_ratio,
+                              device_settings->second.hot_pixel_mode);
+          }
+
+          auto jpeg_job = std::make_unique<JpegYUV420Job>();
+          jpeg_job->exif_utils = std::unique_ptr<ExifUtils>(
+              ExifUtils::Create(device_chars->second));
+          jpeg_job->input = std::move(jpeg_input);
+          // If jpeg compression is successful, then the jpeg compressor
+          // must set the corresponding status.
+          (*b)->stream_buffer.status = BufferStatus::kError;
+          std::swap(jpeg_job->output, *b);
+          jpeg_job->result_metadata =
+              HalCameraMetadata::Clone(next_result->result_metadata.get());
+
+          Mutex::Autolock lock(control_mutex_);
+          jpeg_compressor_->QueueYUV420(std::move(jpeg_job));
+        } else if ((*b)->dataSpace == static_cast<android_dataspace_t>(
+                                          aidl::android::hardware::graphics::
+                                              common::Dataspace::JPEG_R)) {
+          if (!reprocess_request) {
+            YUV420Frame yuv_input{};
             auto jpeg_input = std::make_unique<JpegYUV420Input>();
             jpeg_input->width = (*b)->width;
             jpeg_input->height = (*b)->height;
             jpeg_input->color_space = (*b)->color_space;
-            auto img =
-                new uint8_t[(jpeg_input->width * jpeg_input->height * 3) / 2];
+            auto img = new uint8_t[(*b)->width * (*b)->height * 3];
             jpeg_input->yuv_planes = {
                 .img_y = img,
-                .img_cb = img + jpeg_input->width * jpeg_input->height,
-                .img_cr = img + (jpeg_input->width * jpeg_input->height * 5) / 4,
-                .y_stride = jpeg_input->width,
-                .cbcr_stride = jpeg_input->width / 2,
-                .cbcr_step = 1};
+                .img_cb = img + (*b)->width * (*b)->height * 2,
+                .img_cr = img + (*b)->width * (*b)->height * 2 + 2,
+                .y_stride = (*b)->width * 2,
+                .cbcr_stride = (*b)->width * 2,
+                .cbcr_step = 4,
+                .bytesPerPixel = 2};
             jpeg_input->buffer_owner = true;
             YUV420Frame yuv_output{.width = jpeg_input->width,
                                    .height = jpeg_input->height,
@@ -1089,10 +1353,10 @@ bool EmulatedSensor::threadLoop() {
 
             bool rotate = device_settings->second.rotate_and_crop ==
                           ANDROID_SCALER_ROTATE_AND_CROP_90;
-            auto ret = ProcessYUV420(yuv_input, yuv_output,
-                                     device_settings->second.gain, process_type,
-                                     device_settings->second.zoom_ratio, rotate,
-                                     (*b)->color_space, device_chars->second);
+            auto ret = ProcessYUV420(
+                yuv_input, yuv_output, device_settings->second.gain,
+                process_type, device_settings->second.zoom_ratio, rotate,
+                (*b)->color_space, device_chars->second);
             if (ret != 0) {
               (*b)->stream_buffer.status = BufferStatus::kError;
               break;
@@ -1111,180 +1375,147 @@ bool EmulatedSensor::threadLoop() {
 
             Mutex::Autolock lock(control_mutex_);
             jpeg_compressor_->QueueYUV420(std::move(jpeg_job));
-          } else if ((*b)->dataSpace == static_cast<android_dataspace_t>(
-                                            aidl::android::hardware::graphics::
-                                                common::Dataspace::JPEG_R)) {
-            if (!reprocess_request) {
-              YUV420Frame yuv_input{};
-              auto jpeg_input = std::make_unique<JpegYUV420Input>();
-              jpeg_input->width = (*b)->width;
-              jpeg_input->height = (*b)->height;
-              jpeg_input->color_space = (*b)->color_space;
-              auto img = new uint8_t[(*b)->width * (*b)->height * 3];
-              jpeg_input->yuv_planes = {
-                  .img_y = img,
-                  .img_cb = img + (*b)->width * (*b)->height * 2,
-                  .img_cr = img + (*b)->width * (*b)->height * 2 + 2,
-                  .y_stride = (*b)->width * 2,
-                  .cbcr_stride = (*b)->width * 2,
-                  .cbcr_step = 2,
-                  .bytesPerPixel = 2};
-              jpeg_input->buffer_owner = true;
-              YUV420Frame yuv_output{.width = jpeg_input->width,
-                                     .height = jpeg_input->height,
-                                     .planes = jpeg_input->yuv_planes};
-
-              bool rotate = device_settings->second.rotate_and_crop ==
-                            ANDROID_SCALER_ROTATE_AND_CROP_90;
-              auto ret = ProcessYUV420(
-                  yuv_input, yuv_output, device_settings->second.gain,
-                  process_type, device_settings->second.zoom_ratio, rotate,
-                  (*b)->color_space, device_chars->second);
-              if (ret != 0) {
-                (*b)->stream_buffer.status = BufferStatus::kError;
-                break;
-              }
-
-              auto jpeg_job = std::make_unique<JpegYUV420Job>();
-              jpeg_job->exif_utils = std::unique_ptr<ExifUtils>(
-                  ExifUtils::Create(device_chars->second));
-              jpeg_job->input = std::move(jpeg_input);
-              // If jpeg compression is successful, then the jpeg compressor
-              // must set the corresponding status.
-              (*b)->stream_buffer.status = BufferStatus::kError;
-              std::swap(jpeg_job->output, *b);
-              jpeg_job->result_metadata =
-                  HalCameraMetadata::Clone(next_result->result_metadata.get());
-
-              Mutex::Autolock lock(control_mutex_);
-              jpeg_compressor_->QueueYUV420(std::move(jpeg_job));
-            } else {
-              ALOGE(
-                  "%s: Reprocess requests with output format JPEG_R are not "
-                  "supported!",
-                  __FUNCTION__);
-              (*b)->stream_buffer.status = BufferStatus::kError;
-            }
           } else {
-            ALOGE("%s: Format %x with dataspace %x is TODO", __FUNCTION__,
-                  (*b)->format, (*b)->dataSpace);
+            ALOGE(
+                "%s: Reprocess requests with output format JPEG_R are not "
+                "supported!",
+                __FUNCTION__);
             (*b)->stream_buffer.status = BufferStatus::kError;
           }
-          break;
-        case PixelFormat::YCRCB_420_SP:
-        case PixelFormat::YCBCR_420_888: {
-          YUV420Frame yuv_input{
-              .width =
-                  treat_as_reprocess ? (*next_input_buffer->begin())->width : 0,
-              .height =
-                  treat_as_reprocess ? (*next_input_buffer->begin())->height : 0,
-              .planes = treat_as_reprocess
-                            ? (*next_input_buffer->begin())->plane.img_y_crcb
-                            : YCbCrPlanes{}};
-          YUV420Frame yuv_output{.width = (*b)->width,
-                                 .height = (*b)->height,
-                                 .planes = (*b)->plane.img_y_crcb};
-          bool rotate = device_settings->second.rotate_and_crop ==
-                        ANDROID_SCALER_ROTATE_AND_CROP_90;
-          auto ret =
-              ProcessYUV420(yuv_input, yuv_output, device_settings->second.gain,
-                            process_type, device_settings->second.zoom_ratio,
-                            rotate, (*b)->color_space, device_chars->second);
-          if (ret != 0) {
+        } else {
+          ALOGE("%s: Format %x with dataspace %x is TODO", __FUNCTION__,
+                (*b)->format, (*b)->dataSpace);
+          (*b)->stream_buffer.status = BufferStatus::kError;
+        }
+        break;
+      case PixelFormat::YCRCB_420_SP:
+      case PixelFormat::YCBCR_420_888: {
+        YUV420Frame yuv_output{.width = (*b)->width,
+                               .height = (*b)->height,
+                               .planes = (*b)->plane.img_y_crcb};
+        bool rotate = device_settings->second.rotate_and_crop ==
+                      ANDROID_SCALER_ROTATE_AND_CROP_90;
+        status_t ret;
+        google_camera_hal::StabilizationCorrection correction;
+        if (stabilize) {
+          ret = ProcessStabilizedYUV420(
+              (*b)->camera_id, yuv_output, device_settings->second.gain,
+              process_type, device_settings->second.zoom_ratio, rotate,
+              (*b)->color_space, device_settings->second.hot_pixel_mode,
+              device_chars->second, &correction);
+        } else {
+          ret = ProcessYUV420(
+              reprocess_input, yuv_output, device_settings->second.gain,
+              process_type, device_settings->second.zoom_ratio, rotate,
+              (*b)->color_space, device_chars->second);
+          if ((ret == OK) && !reprocess_request && !rotate) {
+            ApplyPixelDefects(yuv_output, (*b)->camera_id,
+                              device_settings->second.zoom_ratio,
+                              device_settings->second.hot_pixel_mode);
+          }
+        }
+        if (ret != 0) {
+          (*b)->stream_buffer.status = BufferStatus::kError;
+        } else if (!face_frame_submitted && (face_detector_ != nullptr) &&
+                   ((*b)->camera_id == logical_camera_id_) && !rotate &&
+                   (yuv_output.planes.bytesPerPixel == 1) &&
+                   (device_settings->second.face_detect_mode !=
+                    ANDROID_STATISTICS_FACE_DETECT_MODE_OFF)) {
+          face_detector_->Submit(
+              yuv_output.planes.img_y, yuv_output.planes.y_stride,
+              yuv_output.width, yuv_output.height,
+              GetRenderedRegion(yuv_output.width, yuv_output.height,
+                                device_settings->second.zoom_ratio,
+                                stabilize ? &correction : nullptr,
+                                device_chars->second),
+              next_capture_time_);
+          face_frame_submitted = true;
+        }
+      } break;
+      case PixelFormat::Y16:
+        if (!reprocess_request) {
+          if ((*b)->dataSpace == HAL_DATASPACE_DEPTH) {
+            CaptureDepth((*b)->plane.img.img, device_settings->second.gain,
+                         (*b)->width, (*b)->height,
+                         (*b)->plane.img.stride_in_bytes,
+                         device_chars->second);
+          } else {
+            ALOGE("%s: Format %x with dataspace %x is TODO", __FUNCTION__,
+                  (*b)->format, (*b)->dataSpace);
             (*b)->stream_buffer.status = BufferStatus::kError;
           }
-        } break;
-        case PixelFormat::Y16:
+        } else {
+          ALOGE("%s: Reprocess requests with output format %x no supported!",
+                __FUNCTION__, (*b)->format);
+          (*b)->stream_buffer.status = BufferStatus::kError;
+        }
+        break;
+      case PixelFormat::YCBCR_P010:
           if (!reprocess_request) {
-            if ((*b)->dataSpace == HAL_DATASPACE_DEPTH) {
-              CaptureDepth((*b)->plane.img.img, device_settings->second.gain,
-                           (*b)->width, (*b)->height,
-                           (*b)->plane.img.stride_in_bytes,
-                           device_chars->second);
-            } else {
-              ALOGE("%s: Format %x with dataspace %x is TODO", __FUNCTION__,
-                    (*b)->format, (*b)->dataSpace);
-              (*b)->stream_buffer.status = BufferStatus::kError;
-            }
+            bool rotate = device_settings->second.rotate_and_crop ==
+                          ANDROID_SCALER_ROTATE_AND_CROP_90;
+            YUV420Frame yuv_input{};
+            YUV420Frame yuv_output{.width = (*b)->width,
+                                   .height = (*b)->height,
+                                   .planes = (*b)->plane.img_y_crcb};
+            ProcessYUV420(yuv_input, yuv_output, device_settings->second.gain,
+                          process_type, device_settings->second.zoom_ratio,
+                          rotate, (*b)->color_space, device_chars->second);
           } else {
-            ALOGE("%s: Reprocess requests with output format %x no supported!",
-                  __FUNCTION__, (*b)->format);
+            ALOGE(
+                "%s: Reprocess requests with output format %x no supported!",
+                __FUNCTION__, (*b)->format);
             (*b)->stream_buffer.status = BufferStatus::kError;
           }
           break;
-        case PixelFormat::YCBCR_P010:
-            if (!reprocess_request) {
-              bool rotate = device_settings->second.rotate_and_crop ==
-                            ANDROID_SCALER_ROTATE_AND_CROP_90;
-              YUV420Frame yuv_input{};
-              YUV420Frame yuv_output{.width = (*b)->width,
-                                     .height = (*b)->height,
-                                     .planes = (*b)->plane.img_y_crcb};
-              ProcessYUV420(yuv_input, yuv_output, device_settings->second.gain,
-                            process_type, device_settings->second.zoom_ratio,
-                            rotate, (*b)->color_space, device_chars->second);
-            } else {
-              ALOGE(
-                  "%s: Reprocess requests with output format %x no supported!",
-                  __FUNCTION__, (*b)->format);
-              (*b)->stream_buffer.status = BufferStatus::kError;
-            }
-            break;
-        default:
-          ALOGE("%s: Unknown format %x, no output", __FUNCTION__, (*b)->format);
-          (*b)->stream_buffer.status = BufferStatus::kError;
-          break;
-      }
-
-      b = next_buffers->erase(b);
+      default:
+        ALOGE("%s: Unknown format %x, no output", __FUNCTION__, (*b)->format);
+        (*b)->stream_buffer.status = BufferStatus::kError;
+        break;
     }
-  }
 
-  if (reprocess_request) {
-    auto input_buffer = next_input_buffer->begin();
-    while (input_buffer != next_input_buffer->end()) {
-      (*input_buffer++)->stream_buffer.status = BufferStatus::kOk;
-    }
-    next_input_buffer->clear();
+    b = next_buffers->erase(b);
   }
+}
 
-  nsecs_t work_done_real_time = getSystemTimeWithSource(timestamp_source);
-  // Returning the results at this point is not entirely correct from timing
-  // perspective. Under ideal conditions where 'ReturnResults' completes
-  // in less than 'time_accuracy' we need to return the results after the
-  // frame cycle expires. However under real conditions various system
-  // components like SurfaceFlinger, Encoder, LMK etc. could be consuming most
-  // of the resources and the duration of "ReturnResults" can get comparable to
-  // 'kDefaultFrameDuration'. This will skew the frame cycle and can result in
-  // potential frame drops. To avoid this scenario when we are running under
-  // tight deadlines (less than 'kReturnResultThreshod') try to return the
-  // results immediately. In all other cases with more relaxed deadlines
-  // the occasional bump during 'ReturnResults' should not have any
-  // noticeable effect.
-  if ((work_done_real_time + kReturnResultThreshod) > frame_end_real_time) {
-    ReturnResults(callback, std::move(settings), std::move(next_result),
-                  reprocess_request, std::move(partial_result));
+void EmulatedSensor::UpdateFrameRateGovernor(nsecs_t start_real_time,
+                                             nsecs_t start_work_time) {
+  // Rendering and JPEG encoding run in parallel, the slower one limits the
+  // frame rate.
+  nsecs_t work_time = std::max(
+      clock_->GetTime(ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN) -
+          start_work_time,
+      jpeg_compressor_->TakeCompressTime());
+  nsecs_t frame_interval = 0;
+  if (governor_frame_start_time_ != 0) {
+    frame_interval = start_real_time - governor_frame_start_time_;
   }
-
-  work_done_real_time = getSystemTimeWithSource(timestamp_source);
-  ALOGVV("Sensor vertical blanking interval");
-  const nsecs_t time_accuracy = 2e6;  // 2 ms of imprecision is ok
-  if (work_done_real_time < frame_end_real_time - time_accuracy) {
-    timespec t;
-    t.tv_sec = (frame_end_real_time - work_done_real_time) / 1000000000L;
-    t.tv_nsec = (frame_end_real_time - work_done_real_time) % 1000000000L;
-
-    int ret;
-    do {
-      ret = nanosleep(&t, &t);
-    } while (ret != 0);
+  governor_frame_start_time_ = start_real_time;
+  frame_rate_governor_->AddFrame(frame_interval, work_time);
+
+  auto stats = frame_rate_governor_->GetStats();
+  if ((stats.frames % kFrameRateStatsInterval) == 0) {
+    ALOGI("%s: %.2f fps, jitter %.2f ms, %" PRIu64 " of %" PRIu64
+          " frames slipped, %" PRIu64 " frame duration changes",
+          __FUNCTION__,
+          stats.mean_frame_interval > 0 ? 1e9 / stats.mean_frame_interval : 0.,
+          stats.frame_interval_jitter / 1e6, stats.slipped_frames,
+          stats.frames, stats.frame_duration_changes);
+    EmulatedRenderPool::Stats render_stats;
+    if ((render_pool_ != nullptr) &&
+        (render_pool_->GetStats(render_client_, &render_stats) == OK) &&
+        (render_stats.tasks > 0)) {
+      ALOGI("%s: Rendered on %u pool threads, %" PRId64
+            " us average wait, %" PRId64 " us max wait, %" PRIu64 " of %" PRIu64
+            " frames over deadline",
+            __FUNCTION__, render_pool_->GetThreadCount(),
+            ns2us(render_stats.total_wait_time /
+                  static_cast<nsecs_t>(render_stats.tasks)),
+            ns2us(render_stats.max_wait_time), render_stats.deadline_misses,
+            render_stats.tasks);
+    }
   }
-
-  ReturnResults(callback, std::move(settings), std::move(next_result),
-                reprocess_request, std::move(partial_result));
-
-  return true;
-};
+}
 
 void EmulatedSensor::ReturnResults(
     HwlPipelineCallback callback,
@@ -1342,17 +1573,34 @@ void EmulatedSensor::ReturnResults(
     }
     if (logical_settings->second.lens_shading_map_mode ==
         ANDROID_STATISTICS_LENS_SHADING_MAP_MODE_ON) {
-      if ((device_chars->second.lens_shading_map_size[0] > 0) &&
-          (device_chars->second.lens_shading_map_size[1] > 0)) {
-        // Perfect lens, no actual shading needed.
-        std::vector<float> lens_shading_map(
-            device_chars->second.lens_shading_map_size[0] *
-                device_chars->second.lens_shading_map_size[1] * 4,
-            1.f);
-
+      auto lens_shading = GetLensShading(logical_camera_id_);
+      if (lens_shading != nullptr) {
+        // The map covers the active array regardless of the crop region.
+        auto lens_shading_map = lens_shading->GetMap(/*zoom_ratio*/ 1.0f);
         result->result_metadata->Set(ANDROID_STATISTICS_LENS_SHADING_MAP,
-                                     lens_shading_map.data(),
-                                     lens_shading_map.size());
+                                     lens_shading_map->data(),
+                                     lens_shading_map->size());
+      }
+    }
+    if (logical_settings->second.hot_pixel_map_mode ==
+        ANDROID_STATISTICS_HOT_PIXEL_MAP_MODE_ON) {
+      auto pixel_defects = GetPixelDefects(logical_camera_id_);
+      if (pixel_defects != nullptr) {
+        const auto& hot_pixel_map = pixel_defects->GetHotPixelMap();
+        result->result_metadata->Set(ANDROID_STATISTICS_HOT_PIXEL_MAP,
+                                     hot_pixel_map.data(),
+                                     hot_pixel_map.size());
+      }
+    }
+    if (face_detector_ != nullptr) {
+      if (logical_settings->second.face_detect_mode !=
+          ANDROID_STATISTICS_FACE_DETECT_MODE_OFF) {
+        ReportFaces(logical_settings->second.face_detect_mode,
+                    device_chars->second, result->result_metadata.get());
+      } else {
+        // Faces found before detection was turned off are stale once it is
+        // turned on again.
+        face_detector_->Clear();
       }
     }
     if (logical_settings->second.report_video_stab) {
@@ -1452,6 +1700,46 @@ void EmulatedSensor::CalculateAndAppendNoiseProfile(
   }
 }
 
+void EmulatedSensor::ReportFaces(uint8_t face_detect_mode,
+                                 const SensorCharacteristics& chars,
+                                 HalCameraMetadata* result /*out*/) {
+  ATRACE_CALL();
+  if (result == nullptr) {
+    return;
+  }
+
+  // Faces are detected asynchronously, so the result carries the faces of
+  // the latest frame the detector completed.
+  std::vector<EmulatedFaceDetector::Face> faces;
+  nsecs_t timestamp;
+  if (!face_detector_->GetFaces(chars.max_face_count, &faces, &timestamp)) {
+    return;
+  }
+
+  std::vector<int32_t> rectangles;
+  std::vector<uint8_t> scores;
+  std::vector<int32_t> landmarks;
+  std::vector<int32_t> ids;
+  for (const auto& face : faces) {
+    rectangles.insert(rectangles.end(),
+                      {face.left, face.top, face.right, face.bottom});
+    scores.push_back(face.score);
+    landmarks.insert(landmarks.end(),
+                     {face.left_eye[0], face.left_eye[1], face.right_eye[0],
+                      face.right_eye[1], face.mouth[0], face.mouth[1]});
+    ids.push_back(face.id);
+  }
+
+  result->Set(ANDROID_STATISTICS_FACE_RECTANGLES, rectangles.data(),
+              rectangles.size());
+  result->Set(ANDROID_STATISTICS_FACE_SCORES, scores.data(), scores.size());
+  if (face_detect_mode == ANDROID_STATISTICS_FACE_DETECT_MODE_FULL) {
+    result->Set(ANDROID_STATISTICS_FACE_LANDMARKS, landmarks.data(),
+                landmarks.size());
+    result->Set(ANDROID_STATISTICS_FACE_IDS, ids.data(), ids.size());
+  }
+}
+
 EmulatedScene::ColorChannels EmulatedSensor::GetQuadBayerColor(uint32_t x,
                                                                uint32_t y) {
   // Row within larger set of quad bayer filter
@@ -1516,35 +1804,168 @@ status_t EmulatedSensor::RemosaicRAW16Image(uint16_t* img_in, uint16_t* img_out,
   return OK;
 }
 
+status_t EmulatedSensor::DevelopRAW16(const SensorBuffer& input,
+                                      int32_t color_space,
+                                      const SensorCharacteristics& chars,
+                                      uint32_t camera_id,
+                                      uint8_t hot_pixel_mode,
+                                      std::vector<uint8_t>* yuv,
+                                      YUV420Frame* frame) {
+  ATRACE_CALL();
+  if (isp_ == nullptr) {
+    ALOGE("%s: The ISP is not available", __FUNCTION__);
+    return NO_INIT;
+  }
+  const uint16_t* raw = reinterpret_cast<uint16_t*>(input.plane.img.img);
+  uint32_t raw_stride = input.plane.img.stride_in_bytes;
+  std::vector<uint8_t> remosaiced;
+  if (chars.quad_bayer_sensor && input.width == chars.full_res_width &&
+      input.height == chars.full_res_height) {
+    remosaiced.resize(static_cast<size_t>(raw_stride) * input.height);
+    auto ret = RemosaicRAW16Image(
+        reinterpret_cast<uint16_t*>(input.plane.img.img),
+        reinterpret_cast<uint16_t*>(remosaiced.data()), raw_stride, chars);
+    if (ret != OK) {
+      return ret;
+    }
+    raw = reinterpret_cast<uint16_t*>(remosaiced.data());
+  }
+
+  // The emulated sensor renders white balanced images, so the default gains
+  // and identity transform match the regular captures. The vignetting of the
+  // RAW render is corrected with the lens shading map of the full array.
+  EmulatedIsp::Params params;
+  std::copy(std::begin(chars.black_level_pattern),
+            std::end(chars.black_level_pattern), params.black_level);
+  params.white_level = chars.max_raw_value;
+  // Held until the ISP is done with it.
+  std::shared_ptr<const std::vector<float>> lens_shading_map;
+  auto lens_shading = GetLensShading(camera_id);
+  if (lens_shading != nullptr) {
+    lens_shading_map = lens_shading->GetMap(/*zoom_ratio*/ 1.0f);
+    params.lens_shading_map = lens_shading_map->data();
+    params.lens_shading_map_size[0] = lens_shading->GetMapWidth();
+    params.lens_shading_map_size[1] = lens_shading->GetMapHeight();
+  }
+  params.defect_correction = GetDefectCorrection(hot_pixel_mode);
+  std::copy(std::begin(kDefaultColorCorrectionGains),
+            std::end(kDefaultColorCorrectionGains), params.wb_gains);
+  if (color_space !=
+      ANDROID_REQUEST_AVAILABLE_COLOR_SPACE_PROFILES_MAP_UNSPECIFIED) {
+    params.ccm[0][0] = rgb_rgb_matrix_.rR;
+    params.ccm[0][1] = rgb_rgb_matrix_.gR;
+    params.ccm[0][2] = rgb_rgb_matrix_.bR;
+    params.ccm[1][0] = rgb_rgb_matrix_.rG;
+    params.ccm[1][1] = rgb_rgb_matrix_.gG;
+    params.ccm[1][2] = rgb_rgb_matrix_.bG;
+    params.ccm[2][0] = rgb_rgb_matrix_.rB;
+    params.ccm[2][1] = rgb_rgb_matrix_.gB;
+    params.ccm[2][2] = rgb_rgb_matrix_.bB;
+  }
+  switch (color_space) {
+    case ColorSpaceNamed::BT709:
+      params.tone_curve = EmulatedIsp::ToneCurve::kSmpte170m;
+      break;
+    case ColorSpaceNamed::BT2020:
+      params.tone_curve = EmulatedIsp::ToneCurve::kHlg;
+      break;
+    default:
+      params.tone_curve = EmulatedIsp::ToneCurve::kSrgb;
+  }
+
+  size_t luma_size = static_cast<size_t>(input.width) * input.height;
+  yuv->resize((luma_size * 3) / 2);
+  *frame = {.width = input.width,
+            .height = input.height,
+            .planes = {.img_y = yuv->data(),
+                       .img_cb = yuv->data() + luma_size,
+                       .img_cr = yuv->data() + (luma_size * 5) / 4,
+                       .y_stride = input.width,
+                       .cbcr_stride = input.width / 2,
+                       .cbcr_step = 1}};
+  return isp_->ProcessRAW16(raw, raw_stride, input.width, input.height,
+                            params, frame->planes);
+}
+
 void EmulatedSensor::CaptureRawBinned(uint8_t* img, size_t row_stride_in_bytes,
                                       uint32_t gain,
-                                      const SensorCharacteristics& chars) {
+                                      const SensorCharacteristics& chars,
+                                      uint32_t camera_id) {
   CaptureRaw(img, row_stride_in_bytes, gain, chars, /*in_sensor_zoom*/ false,
-             /*binned*/ true);
+             /*binned*/ true, camera_id);
   return;
 }
 
 void EmulatedSensor::CaptureRawInSensorZoom(uint8_t* img,
                                             size_t row_stride_in_bytes,
                                             uint32_t gain,
-                                            const SensorCharacteristics& chars) {
+                                            const SensorCharacteristics& chars,
+                                            uint32_t camera_id) {
   CaptureRaw(img, row_stride_in_bytes, gain, chars, /*in_sensor_zoom*/ true,
-             /*binned*/ false);
+             /*binned*/ false, camera_id);
   return;
 }
 
 void EmulatedSensor::CaptureRawFullRes(uint8_t* img, size_t row_stride_in_bytes,
                                        uint32_t gain,
-                                       const SensorCharacteristics& chars) {
+                                       const SensorCharacteristics& chars,
+                                       uint32_t camera_id) {
   CaptureRaw(img, row_stride_in_bytes, gain, chars, /*inSensorZoom*/ false,
-             /*binned*/ false);
+             /*binned*/ false, camera_id);
   return;
 }
 
+EmulatedLensShading* EmulatedSensor::GetLensShading(uint32_t camera_id) {
+  auto it = lens_shading_.find(camera_id);
+  return it != lens_shading_.end() ? it->second.get() : nullptr;
+}
+
+EmulatedPixelDefects* EmulatedSensor::GetPixelDefects(uint32_t camera_id) {
+  auto it = pixel_defects_.find(camera_id);
+  return it != pixel_defects_.end() ? it->second.get() : nullptr;
+}
+
+EmulatedIsp::DefectCorrection EmulatedSensor::GetDefectCorrection(
+    uint8_t hot_pixel_mode) {
+  switch (hot_pixel_mode) {
+    case ANDROID_HOT_PIXEL_MODE_FAST:
+      return EmulatedIsp::DefectCorrection::kFast;
+    case ANDROID_HOT_PIXEL_MODE_HIGH_QUALITY:
+      return EmulatedIsp::DefectCorrection::kHighQuality;
+    default:
+      return EmulatedIsp::DefectCorrection::kOff;
+  }
+}
+
+void EmulatedSensor::ApplyPixelDefects(const YUV420Frame& frame,
+                                       uint32_t camera_id, float zoom_ratio,
+                                       uint8_t hot_pixel_mode) {
+  auto pixel_defects = GetPixelDefects(camera_id);
+  if ((pixel_defects == nullptr) || (frame.planes.bytesPerPixel != 1)) {
+    return;
+  }
+
+  ATRACE_CALL();
+  auto defects =
+      pixel_defects->GetDefects(frame.width, frame.height, zoom_ratio);
+  for (const auto& defect : *defects) {
+    frame.planes.img_y[defect.y * frame.planes.y_stride + defect.x] =
+        defect.hot ? 255 : 0;
+  }
+  auto ret = EmulatedIsp::CorrectLumaDefects(
+      frame.planes, frame.width, frame.height,
+      GetDefectCorrection(hot_pixel_mode));
+  if (ret != OK) {
+    ALOGE("%s: Failed to correct the defects of a %ux%u output: %d",
+          __FUNCTION__, frame.width, frame.height, ret);
+  }
+}
+
 void EmulatedSensor::CaptureRaw(uint8_t* img, size_t row_stride_in_bytes,
                                 uint32_t gain,
                                 const SensorCharacteristics& chars,
-                                bool in_sensor_zoom, bool binned) {
+                                bool in_sensor_zoom, bool binned,
+                                uint32_t camera_id) {
   ATRACE_CALL();
   if (in_sensor_zoom && binned) {
     ALOGE("%s: Can't perform in-sensor zoom in binned mode", __FUNCTION__);
@@ -1565,6 +1986,17 @@ void EmulatedSensor::CaptureRaw(uint8_t* img, size_t row_stride_in_bytes,
   unsigned int image_height =
       in_sensor_zoom || binned ? chars.height : chars.full_res_height;
   const float norm_left_top = 0.5f - 0.5f / raw_zoom_ratio;
+  auto lens_shading = GetLensShading(camera_id);
+  auto falloff = lens_shading != nullptr
+                     ? lens_shading->GetFalloff(image_width, image_height,
+                                                raw_zoom_ratio)
+                     : nullptr;
+  auto pixel_defects = GetPixelDefects(camera_id);
+  auto defects = pixel_defects != nullptr
+                     ? pixel_defects->GetDefects(image_width, image_height,
+                                                 raw_zoom_ratio)
+                     : nullptr;
+  size_t next_defect = 0;
   for (unsigned int out_y = 0; out_y < image_height; out_y++) {
     int* bayer_row = bayer_select + (out_y & 0x1) * 2;
     uint16_t* px = (uint16_t*)img + out_y * (row_stride_in_bytes / 2);
@@ -1584,6 +2016,10 @@ void EmulatedSensor::CaptureRaw(uint8_t* img, size_t row_stride_in_bytes,
       uint32_t electron_count;
       scene_->SetReadoutPixel(x, y);
       electron_count = scene_->GetPixelElectrons()[color_idx];
+      if (falloff != nullptr) {
+        electron_count *= lens_shading->GetIllumination(
+            color_idx, falloff->column_r2[out_x] + falloff->row_r2[out_y]);
+      }
 
       // TODO: Better pixel saturation curve?
       electron_count = (electron_count < kSaturationElectrons)
@@ -1607,6 +2043,18 @@ void EmulatedSensor::CaptureRaw(uint8_t* img, size_t row_stride_in_bytes,
 
       *px++ = raw_count;
     }
+
+    // Defective pixels read saturated or black regardless of the scene.
+    while ((defects != nullptr) && (next_defect < defects->size()) &&
+           ((*defects)[next_defect].y == out_y)) {
+      const auto& defect = (*defects)[next_defect++];
+      int color_idx = chars.quad_bayer_sensor && !(in_sensor_zoom || binned)
+                          ? GetQuadBayerColor(defect.x, out_y)
+                          : bayer_row[defect.x & 0x1];
+      uint16_t* row = (uint16_t*)img + out_y * (row_stride_in_bytes / 2);
+      row[defect.x] = chars.black_level_pattern[color_idx] +
+                      (defect.hot ? chars.max_raw_value : 0);
+    }
     // TODO: Handle this better
     // simulatedTime += mRowReadoutTime;
   }
@@ -1678,6 +2126,16 @@ void EmulatedSensor::CaptureYUV420(YCbCrPlanes yuv_layout, uint32_t width,
                                    int32_t color_space,
                                    const SensorCharacteristics& chars) {
   ATRACE_CALL();
+  if (yuv_layout.bytesPerPixel == 2) {
+    // 16-bit planes are only used for HLG10
+    CaptureP010(yuv_layout, width, height, gain, zoom_ratio, rotate, chars);
+    return;
+  } else if (yuv_layout.bytesPerPixel != 1) {
+    ALOGE("%s: Unsupported bytes per pixel value: %zu", __func__,
+          yuv_layout.bytesPerPixel);
+    return;
+  }
+
   float total_gain = gain / 100.0 * GetBaseGainFactor(chars.max_raw_value);
   // Using fixed-point math with 6 bits of fractional precision.
   // In fixed-point math, calculate total scaling from electrons to 8bpp
@@ -1752,16 +2210,7 @@ void EmulatedSensor::CaptureYUV420(YCbCrPlanes yuv_layout, uint32_t width,
       uint8_t y8 = (rgb_to_y[0] * r_count + rgb_to_y[1] * g_count +
                     rgb_to_y[2] * b_count) /
                    scale_out_sq;
-      if (yuv_layout.bytesPerPixel == 1) {
-        *px_y = y8;
-      } else if (yuv_layout.bytesPerPixel == 2) {
-        *(reinterpret_cast<uint16_t*>(px_y)) = htole16(y8 << 8);
-      } else {
-        ALOGE("%s: Unsupported bytes per pixel value: %zu", __func__,
-              yuv_layout.bytesPerPixel);
-        return;
-      }
-      px_y += yuv_layout.bytesPerPixel;
+      *px_y++ = y8;
 
       if (out_y % 2 == 0 && out_x % 2 == 0) {
         uint8_t cb8 = (rgb_to_cb[0] * r_count + rgb_to_cb[1] * g_count +
@@ -1770,17 +2219,8 @@ void EmulatedSensor::CaptureYUV420(YCbCrPlanes yuv_layout, uint32_t width,
         uint8_t cr8 = (rgb_to_cr[0] * r_count + rgb_to_cr[1] * g_count +
                        rgb_to_cr[2] * b_count + rgb_to_cr[3]) /
                       scale_out_sq;
-        if (yuv_layout.bytesPerPixel == 1) {
-          *px_cb = cb8;
-          *px_cr = cr8;
-        } else if (yuv_layout.bytesPerPixel == 2) {
-          *(reinterpret_cast<uint16_t*>(px_cb)) = htole16(cb8 << 8);
-          *(reinterpret_cast<uint16_t*>(px_cr)) = htole16(cr8 << 8);
-        } else {
-          ALOGE("%s: Unsupported bytes per pixel value: %zu", __func__,
-                yuv_layout.bytesPerPixel);
-          return;
-        }
+        *px_cb = cb8;
+        *px_cr = cr8;
         px_cr += yuv_layout.cbcr_step;
         px_cb += yuv_layout.cbcr_step;
       }
@@ -1789,6 +2229,248 @@ void EmulatedSensor::CaptureYUV420(YCbCrPlanes yuv_layout, uint32_t width,
   ALOGVV("YUV420 sensor image captured");
 }
 
+void EmulatedSensor::CaptureP010(YCbCrPlanes yuv_layout, uint32_t width,
+                                 uint32_t height, uint32_t gain,
+                                 float zoom_ratio, bool rotate,
+                                 const SensorCharacteristics& chars) {
+  ATRACE_CALL();
+  float total_gain = gain / 100.0 * GetBaseGainFactor(chars.max_raw_value);
+  // Scene light normalized to the sensor saturation
+  const float scale = total_gain / chars.max_raw_value;
+  // HLG10 content always uses the BT.2020 primaries, whatever the color space
+  // of the other outputs of the request.
+  const RgbRgbMatrix m = GetRgbRgbMatrix(ColorSpaceNamed::BT2020, chars);
+
+  const float aspect_ratio = static_cast<float>(width) / height;
+  const float norm_left_top = 0.5f - 0.5f / zoom_ratio;
+  const float norm_rot_top = norm_left_top;
+  const float norm_width = 1 / zoom_ratio;
+  const float norm_rot_width = norm_width / aspect_ratio;
+  const float norm_rot_height = norm_width;
+  const float norm_rot_left =
+      norm_left_top + (norm_width + norm_rot_width) * 0.5f;
+
+  // R, G and B of two rows, chroma is subsampled from 2x2 blocks
+  std::vector<float> rows(6 * width);
+  float* rgb[6];
+  for (size_t i = 0; i < 6; i++) {
+    rgb[i] = rows.data() + i * width;
+  }
+
+  for (uint32_t out_y = 0; out_y < height; out_y += 2) {
+    // Odd heights end with a single row
+    const uint32_t row_count = std::min(height - out_y, 2u);
+    for (uint32_t row = 0; row < row_count; row++) {
+      uint32_t y_pos = out_y + row;
+      float* r = rgb[row * 3];
+      float* g = rgb[row * 3 + 1];
+      float* b = rgb[row * 3 + 2];
+      for (uint32_t out_x = 0; out_x < width; out_x++) {
+        int x, y;
+        float norm_x = out_x / (width * zoom_ratio);
+        float norm_y = y_pos / (height * zoom_ratio);
+        if (rotate) {
+          x = static_cast<int>(chars.full_res_width *
+                               (norm_rot_left - norm_y * norm_rot_width));
+          y = static_cast<int>(chars.full_res_height *
+                               (norm_rot_top + norm_x * norm_rot_height));
+        } else {
+          x = static_cast<int>(chars.full_res_width * (norm_left_top + norm_x));
+          y = static_cast<int>(chars.full_res_height *
+                               (norm_left_top + norm_y));
+        }
+        x = std::min(std::max(x, 0), (int)chars.full_res_width - 1);
+        y = std::min(std::max(y, 0), (int)chars.full_res_height - 1);
+        scene_->SetReadoutPixel(x, y);
+
+        const uint32_t* pixel = rotate ? scene_->GetPixelElectronsColumn()
+                                       : scene_->GetPixelElectrons();
+        r[out_x] = pixel[EmulatedScene::R];
+        g[out_x] = pixel[EmulatedScene::Gr];
+        b[out_x] = pixel[EmulatedScene::B];
+      }
+
+      // Linear camera RGB to linear BT.2020
+      for (uint32_t x = 0; x < width; x++) {
+        float cr = r[x] * scale;
+        float cg = g[x] * scale;
+        float cb = b[x] * scale;
+        r[x] = std::clamp(m.rR * cr + m.gR * cg + m.bR * cb, 0.f, 1.f);
+        g[x] = std::clamp(m.rG * cr + m.gG * cg + m.bG * cb, 0.f, 1.f);
+        b[x] = std::clamp(m.rB * cr + m.gB * cg + m.bB * cb, 0.f, 1.f);
+      }
+    }
+
+    uint16_t* px_y = reinterpret_cast<uint16_t*>(
+        yuv_layout.img_y + out_y * yuv_layout.y_stride);
+    uint16_t* px_y_lower =
+        (row_count < 2) ? nullptr
+                        : reinterpret_cast<uint16_t*>(
+                              yuv_layout.img_y +
+                              (out_y + 1) * yuv_layout.y_stride);
+    hlg_encoder_.EncodeRows(
+        rgb, width, px_y, px_y_lower,
+        yuv_layout.img_cb + (out_y / 2) * yuv_layout.cbcr_stride,
+        yuv_layout.img_cr + (out_y / 2) * yuv_layout.cbcr_stride,
+        yuv_layout.cbcr_step);
+  }
+  ALOGVV("P010 sensor image captured");
+}
+
+void EmulatedSensor::UpdateGyroSamples(uint32_t camera_id,
+                                       const SensorCharacteristics& chars) {
+  auto& stabilization = stabilization_[camera_id];
+
+  // The handshake moves the readout over the scene as if the camera turned
+  // right and down. The full resolution width stands in for the focal
+  // length in pixels, which makes the angles independent of the sensor size.
+  int32_t handshake_x, handshake_y;
+  scene_->GetHandshake(&handshake_x, &handshake_y);
+  float angle[2] = {
+      -std::atan(static_cast<float>(handshake_y) / chars.full_res_width),
+      std::atan(static_cast<float>(handshake_x) / chars.full_res_width)};
+
+  nsecs_t gyro_time = stabilization.gyro_time;
+  if ((gyro_time > 0) && (next_capture_time_ > gyro_time + 1)) {
+    // Constant angular velocity since the previous frame.
+    float dt = (next_capture_time_ - gyro_time) * 1e-9f;
+    GyroSample sample{
+        .timestamp_ns = gyro_time + 1,
+        .x = (angle[0] - stabilization.gyro_angle[0]) / dt,
+        .y = (angle[1] - stabilization.gyro_angle[1]) / dt};
+    std::vector<GyroSample> samples = {sample};
+    sample.timestamp_ns = next_capture_time_;
+    samples.push_back(sample);
+    for (auto& it : stabilization.stabilizers) {
+      if (it.second.stabilizer->AddGyroSamples(samples) != OK) {
+        it.second.stabilizer->Reset();
+      }
+    }
+  }
+
+  stabilization.gyro_angle[0] = angle[0];
+  stabilization.gyro_angle[1] = angle[1];
+  stabilization.gyro_time = next_capture_time_;
+}
+
+status_t EmulatedSensor::ProcessStabilizedYUV420(
+    uint32_t camera_id, const YUV420Frame& output, uint32_t gain,
+    ProcessType process_type, float zoom_ratio, bool rotate_and_crop,
+    int32_t color_space, uint8_t hot_pixel_mode,
+    const SensorCharacteristics& chars,
+    google_camera_hal::StabilizationCorrection* correction /*out*/) {
+  ATRACE_CALL();
+  if (correction == nullptr) {
+    return BAD_VALUE;
+  }
+
+  // The gyro samples use the full resolution width as the focal length, see
+  // UpdateGyroSamples(). The output stretches the 1 / zoom_ratio crop of
+  // the full resolution width over its own width.
+  const float focal_length_px = output.width * zoom_ratio;
+  auto& stabilizers = stabilization_[camera_id].stabilizers;
+  auto stabilizer =
+      stabilizers.find(std::make_pair(output.width, output.height));
+  if (stabilizer == stabilizers.end()) {
+    GyroVideoStabilizer::Config config{
+        .width = output.width,
+        .height = output.height,
+        .focal_length_px = focal_length_px,
+        .margin = kStabilizationMargin,
+        .latency_budget_ns = kStabilizationLatencyBudget};
+    YUVStabilizer new_stabilizer{
+        .stabilizer = GyroVideoStabilizer::Create(config),
+        .input = std::vector<uint8_t>(output.width * output.height * 3 / 2)};
+    if (new_stabilizer.stabilizer.get() == nullptr) {
+      ALOGE("%s: Failed to create stabilizer for %ux%u", __FUNCTION__,
+            output.width, output.height);
+      return BAD_VALUE;
+    }
+    stabilizer =
+        stabilizers
+            .emplace(std::make_pair(output.width, output.height),
+                     std::move(new_stabilizer))
+            .first;
+  }
+
+  uint8_t* temp_yuv = stabilizer->second.input.data();
+  YUV420Frame temp_frame{
+      .width = output.width,
+      .height = output.height,
+      .planes = {.img_y = temp_yuv,
+                 .img_cb = temp_yuv + output.width * output.height,
+                 .img_cr = temp_yuv + output.width * output.height * 5 / 4,
+                 .y_stride = output.width,
+                 .cbcr_stride = output.width / 2,
+                 .cbcr_step = 1}};
+  YUV420Frame input{};
+  auto ret = ProcessYUV420(input, temp_frame, gain, process_type, zoom_ratio,
+                           rotate_and_crop, color_space, chars);
+  if (ret != OK) {
+    return ret;
+  }
+  if (!rotate_and_crop) {
+    ApplyPixelDefects(temp_frame, camera_id, zoom_ratio, hot_pixel_mode);
+  }
+
+  auto& yuv_stabilizer = stabilizer->second.stabilizer;
+  // Zooming keeps the camera path, only the pixels per radian change.
+  ret = yuv_stabilizer->SetFocalLength(focal_length_px);
+  if (ret != OK) {
+    return ret;
+  }
+  ret = yuv_stabilizer->ComputeCorrection(next_capture_time_, correction);
+  if (ret != OK) {
+    // Timestamps went back, restart the camera path.
+    yuv_stabilizer->Reset();
+    ret = yuv_stabilizer->ComputeCorrection(next_capture_time_, correction);
+    if (ret != OK) {
+      return ret;
+    }
+  }
+
+  auto to_stabilizer_image = [&output](const YCbCrPlanes& planes) {
+    return google_camera_hal::StabilizerImage{
+        .y = planes.img_y,
+        .cb = planes.img_cb,
+        .cr = planes.img_cr,
+        .y_stride = planes.y_stride,
+        .cbcr_stride = planes.cbcr_stride,
+        .cbcr_step = planes.cbcr_step,
+        .width = output.width,
+        .height = output.height};
+  };
+  return yuv_stabilizer->Warp(to_stabilizer_image(temp_frame.planes),
+                              *correction, to_stabilizer_image(output.planes));
+}
+
+EmulatedFaceDetector::CropRegion EmulatedSensor::GetRenderedRegion(
+    uint32_t width, uint32_t height, float zoom_ratio,
+    const google_camera_hal::StabilizationCorrection* correction,
+    const SensorCharacteristics& chars) const {
+  // CaptureYUV420() stretches the centered 1 / zoom_ratio crop of the array
+  // to the output along each axis.
+  float norm_left = 0.5f - 0.5f / zoom_ratio;
+  float norm_top = norm_left;
+  float norm_width = 1.f / zoom_ratio;
+  float norm_height = norm_width;
+  if (correction != nullptr) {
+    // The stabilized output shows the rendered frame without the margin,
+    // shifted by the correction. The roll is small enough to ignore for
+    // face rectangles.
+    float scale = 1.f - 2.f * kStabilizationMargin;
+    norm_left += norm_width * (0.5f - 0.5f * scale + correction->dx / width);
+    norm_top += norm_height * (0.5f - 0.5f * scale + correction->dy / height);
+    norm_width *= scale;
+    norm_height *= scale;
+  }
+
+  return {.left = norm_left * chars.width,
+          .top = norm_top * chars.height,
+          .width = norm_width * chars.width,
+          .height = norm_height * chars.height};
+}
+
 void EmulatedSensor::CaptureDepth(uint8_t* img, uint32_t gain, uint32_t width,
                                   uint32_t height, uint32_t stride,
                                   const SensorCharacteristics& chars) {
@@ -1836,6 +2518,11 @@ status_t EmulatedSensor::ProcessYUV420(const YUV420Frame& input,
       !property_get_bool("ro.boot.qemu.camera_hq_edge_processing", true)) {
     process_type = REGULAR;
   }
+  // The downscaled REGULAR frame only preserves the detail of the built-in
+  // scene, render textures at the output size.
+  if (process_type == REGULAR && scene_->HasTexture()) {
+    process_type = HIGH_QUALITY;
+  }
 
   size_t bytes_per_pixel = output.planes.bytesPerPixel;
   switch (process_type) {
@@ -1888,7 +2575,7 @@ status_t EmulatedSensor::ProcessYUV420(const YUV420Frame& input,
           .y_stride = static_cast<uint32_t>(input_width * bytes_per_pixel),
           .cbcr_stride =
               static_cast<uint32_t>(input_width * bytes_per_pixel) / 2,
-          .cbcr_step = 1,
+          .cbcr_step = static_cast<uint32_t>(bytes_per_pixel),
           .bytesPerPixel = bytes_per_pixel};
       CaptureYUV420(input_planes, input_width, input_height, gain, zoom_ratio,
                     rotate_and_crop, color_space, chars);
@@ -1898,7 +2585,9 @@ status_t EmulatedSensor::ProcessYUV420(const YUV420Frame& input,
   // libyuv only supports planar YUV420 during scaling.
   // Treat the output UV space as planar first and then
   // interleave in the second step.
-  if (output_planes.cbcr_step == 2) {
+  const bool interleaved_output =
+      output_planes.cbcr_step == 2 * bytes_per_pixel;
+  if (interleaved_output) {
     temp_output_uv.resize(output.width * output.height * bytes_per_pixel / 2);
     auto temp_uv_buffer = temp_output_uv.data();
     output_planes.img_cb = temp_uv_buffer;
@@ -1938,7 +2627,7 @@ status_t EmulatedSensor::ProcessYUV420(const YUV420Frame& input,
   }
 
   // Merge U/V Planes for the interleaved case
-  if (output_planes.cbcr_step == 2) {
+  if (interleaved_output) {
     if (output.planes.img_cb < output.planes.img_cr) {
       if (bytes_per_pixel == 2) {
         libyuv::MergeUVPlane_16((const uint16_t*)output_planes.img_cb,
@@ -2044,6 +2733,11 @@ void EmulatedSensor::RgbToRgb(uint32_t* r_count, uint32_t* g_count,
 
 void EmulatedSensor::CalculateRgbRgbMatrix(int32_t color_space,
                                            const SensorCharacteristics& chars) {
+  rgb_rgb_matrix_ = GetRgbRgbMatrix(color_space, chars);
+}
+
+RgbRgbMatrix EmulatedSensor::GetRgbRgbMatrix(
+    int32_t color_space, const SensorCharacteristics& chars) {
   const XyzMatrix* xyzMatrix;
   switch (color_space) {
     case ColorSpaceNamed::DISPLAY_P3:
@@ -2061,33 +2755,35 @@ void EmulatedSensor::CalculateRgbRgbMatrix(int32_t color_space,
       break;
   }
 
-  rgb_rgb_matrix_.rR = xyzMatrix->xR * chars.forward_matrix.rX +
-                       xyzMatrix->yR * chars.forward_matrix.rY +
-                       xyzMatrix->zR * chars.forward_matrix.rZ;
-  rgb_rgb_matrix_.gR = xyzMatrix->xR * chars.forward_matrix.gX +
-                       xyzMatrix->yR * chars.forward_matrix.gY +
-                       xyzMatrix->zR * chars.forward_matrix.gZ;
-  rgb_rgb_matrix_.bR = xyzMatrix->xR * chars.forward_matrix.bX +
-                       xyzMatrix->yR * chars.forward_matrix.bY +
-                       xyzMatrix->zR * chars.forward_matrix.bZ;
-  rgb_rgb_matrix_.rG = xyzMatrix->xG * chars.forward_matrix.rX +
-                       xyzMatrix->yG * chars.forward_matrix.rY +
-                       xyzMatrix->zG * chars.forward_matrix.rZ;
-  rgb_rgb_matrix_.gG = xyzMatrix->xG * chars.forward_matrix.gX +
-                       xyzMatrix->yG * chars.forward_matrix.gY +
-                       xyzMatrix->zG * chars.forward_matrix.gZ;
-  rgb_rgb_matrix_.bG = xyzMatrix->xG * chars.forward_matrix.bX +
-                       xyzMatrix->yG * chars.forward_matrix.bY +
-                       xyzMatrix->zG * chars.forward_matrix.bZ;
-  rgb_rgb_matrix_.rB = xyzMatrix->xB * chars.forward_matrix.rX +
-                       xyzMatrix->yB * chars.forward_matrix.rY +
-                       xyzMatrix->zB * chars.forward_matrix.rZ;
-  rgb_rgb_matrix_.gB = xyzMatrix->xB * chars.forward_matrix.gX +
-                       xyzMatrix->yB * chars.forward_matrix.gY +
-                       xyzMatrix->zB * chars.forward_matrix.gZ;
-  rgb_rgb_matrix_.bB = xyzMatrix->xB * chars.forward_matrix.bX +
-                       xyzMatrix->yB * chars.forward_matrix.bY +
-                       xyzMatrix->zB * chars.forward_matrix.bZ;
+  RgbRgbMatrix matrix;
+  matrix.rR = xyzMatrix->xR * chars.forward_matrix.rX +
+              xyzMatrix->yR * chars.forward_matrix.rY +
+              xyzMatrix->zR * chars.forward_matrix.rZ;
+  matrix.gR = xyzMatrix->xR * chars.forward_matrix.gX +
+              xyzMatrix->yR * chars.forward_matrix.gY +
+              xyzMatrix->zR * chars.forward_matrix.gZ;
+  matrix.bR = xyzMatrix->xR * chars.forward_matrix.bX +
+              xyzMatrix->yR * chars.forward_matrix.bY +
+              xyzMatrix->zR * chars.forward_matrix.bZ;
+  matrix.rG = xyzMatrix->xG * chars.forward_matrix.rX +
+              xyzMatrix->yG * chars.forward_matrix.rY +
+              xyzMatrix->zG * chars.forward_matrix.rZ;
+  matrix.gG = xyzMatrix->xG * chars.forward_matrix.gX +
+              xyzMatrix->yG * chars.forward_matrix.gY +
+              xyzMatrix->zG * chars.forward_matrix.gZ;
+  matrix.bG = xyzMatrix->xG * chars.forward_matrix.bX +
+              xyzMatrix->yG * chars.forward_matrix.bY +
+              xyzMatrix->zG * chars.forward_matrix.bZ;
+  matrix.rB = xyzMatrix->xB * chars.forward_matrix.rX +
+              xyzMatrix->yB * chars.forward_matrix.rY +
+              xyzMatrix->zB * chars.forward_matrix.rZ;
+  matrix.gB = xyzMatrix->xB * chars.forward_matrix.gX +
+              xyzMatrix->yB * chars.forward_matrix.gY +
+              xyzMatrix->zB * chars.forward_matrix.gZ;
+  matrix.bB = xyzMatrix->xB * chars.forward_matrix.bX +
+              xyzMatrix->yB * chars.forward_matrix.bY +
+              xyzMatrix->zB * chars.forward_matrix.bZ;
+  return matrix;
 }
 
 }  // namespace android
@@ -80,10 +80,21 @@
 
 #include <algorithm>
 #include <functional>
+#include <map>
+#include <utility>
 
 #include "Base.h"
+#include "EmulatedClock.h"
+#include "EmulatedFaceDetector.h"
+#include "EmulatedFrameRateGovernor.h"
+#include "EmulatedHlgEncoder.h"
+#include "EmulatedIsp.h"
+#include "EmulatedLensShading.h"
+#include "EmulatedPixelDefects.h"
+#include "EmulatedRenderPool.h"
 #include "EmulatedScene.h"
 #include "JpegCompressor.h"
+#include "gyro_video_stabilizer.h"
 #include "utils/Mutex.h"
 #include "utils/StreamConfigurationMap.h"
 #include "utils/Thread.h"
@@ -93,6 +104,8 @@ namespace android {
 
 using google_camera_hal::ColorSpaceProfile;
 using google_camera_hal::DynamicRangeProfile;
+using google_camera_hal::GyroSample;
+using google_camera_hal::GyroVideoStabilizer;
 using google_camera_hal::HwlPipelineCallback;
 using google_camera_hal::HwlPipelineResult;
 using google_camera_hal::StreamConfiguration;
@@ -168,12 +181,15 @@ struct SensorCharacteristics {
   uint32_t max_processed_streams = 0;
   uint32_t max_stalling_streams = 0;
   uint32_t max_input_streams = 0;
-  uint32_t physical_size[2] = {0};
+  // Sensor size and focal length in mm.
+  float physical_size[2] = {0};
+  float focal_length = 0;
   bool is_flash_supported = false;
   uint32_t lens_shading_map_size[2] = {0};
   uint32_t max_pipeline_depth = 0;
   uint32_t orientation = 0;
   bool is_front_facing = false;
+  uint32_t max_face_count = 0;
   bool quad_bayer_sensor = false;
   bool is_10bit_dynamic_range_capable = false;
   DynamicRangeProfileMap dynamic_range_profiles;
@@ -226,7 +242,9 @@ class EmulatedSensor : private Thread, public virtual RefBase {
     }
 
     if (HAL_PIXEL_FORMAT_RAW16 == input_format &&
-        HAL_PIXEL_FORMAT_RAW16 == output_format) {
+        ((HAL_PIXEL_FORMAT_RAW16 == output_format) ||
+         (HAL_PIXEL_FORMAT_YCBCR_420_888 == output_format) ||
+         (HAL_PIXEL_FORMAT_BLOB == output_format))) {
       return true;
     }
 
@@ -263,8 +281,13 @@ class EmulatedSensor : private Thread, public virtual RefBase {
   struct SensorSettings {
     nsecs_t exposure_time = 0;
     nsecs_t frame_duration = 0;
+    // Longest frame duration the frame rate governor may stretch to.
+    nsecs_t max_frame_duration = 0;
     uint32_t gain = 0;  // ISO
     uint32_t lens_shading_map_mode;
+    uint8_t face_detect_mode = ANDROID_STATISTICS_FACE_DETECT_MODE_OFF;
+    uint8_t hot_pixel_mode = ANDROID_HOT_PIXEL_MODE_OFF;
+    uint8_t hot_pixel_map_mode = ANDROID_STATISTICS_HOT_PIXEL_MAP_MODE_OFF;
     bool report_neutral_color_point = false;
     bool report_green_split = false;
     bool report_noise_profile = false;
@@ -322,7 +345,16 @@ class EmulatedSensor : private Thread, public virtual RefBase {
  private:
   // Scene stabilization
   static const uint32_t kRegularSceneHandshake;
-  static const uint32_t kReducedSceneHandshake;
+  static const nsecs_t kStabilizationLatencyBudget;
+  // Fraction of stabilized outputs cropped on each side for the correction
+  static const float kStabilizationMargin;
+  // Time limit for the face detection of a frame
+  static const nsecs_t kFaceDetectionDeadline;
+  // Real time an idle frame takes with the virtual clock, so the sensor
+  // doesn't spin while the request processor queues the next request.
+  static const nsecs_t kVirtualClockIdleFrameTime;
+  // Governed frames between frame rate statistics logs
+  static const uint64_t kFrameRateStatsInterval;
 
   /**
    * Logical characteristics
@@ -358,6 +390,7 @@ class EmulatedSensor : private Thread, public virtual RefBase {
   std::vector<int32_t> gamma_table_sRGB_;
   std::vector<int32_t> gamma_table_smpte170m_;
   std::vector<int32_t> gamma_table_hlg_;
+  EmulatedHlgEncoder hlg_encoder_;
 
   Mutex control_mutex_;  // Lock before accessing control parameters
   // Start of control parameters
@@ -379,10 +412,26 @@ class EmulatedSensor : private Thread, public virtual RefBase {
    * processing thread
    */
   bool threadLoop() override;
+  // Render the scene texture once it is built.
+  void UpdateSceneTexture();
+  // Registers the thread with ThreadRoleManager, which drops it once it exits.
+  status_t readyToRun() override;
 
   nsecs_t next_capture_time_;
   nsecs_t next_readout_time_;
 
+  // Render pool shared with the other sensors and the JPEG compressors, or
+  // nullptr to render on the sensor thread.
+  std::shared_ptr<EmulatedRenderPool> render_pool_;
+  uint32_t render_client_ = EmulatedRenderPool::kInvalidClient;
+  // Render the output buffers of a frame and queue the JPEG outputs for
+  // compression. Erases the rendered buffers from next_buffers, which returns
+  // them.
+  void RenderOutputBuffers(LogicalCameraSettings* settings,
+                           bool reprocess_request, Buffers* next_buffers,
+                           Buffers* next_input_buffer,
+                           HwlPipelineResult* next_result);
+
   struct SensorBinningFactorInfo {
     bool has_raw_stream = false;
     bool has_non_raw_stream = false;
@@ -395,6 +444,40 @@ class EmulatedSensor : private Thread, public virtual RefBase {
   std::map<uint32_t, SensorBinningFactorInfo> sensor_binning_factor_info_;
 
   std::unique_ptr<EmulatedScene> scene_;
+  // Scene texture being built for scene_, invalid once it is set.
+  EmulatedSceneTextureCache::TextureFuture scene_texture_;
+  std::unique_ptr<EmulatedIsp> isp_;
+  // Vignetting of the lens and defects of the sensor of each camera id
+  std::map<uint32_t, std::unique_ptr<EmulatedLensShading>> lens_shading_;
+  std::map<uint32_t, std::unique_ptr<EmulatedPixelDefects>> pixel_defects_;
+  // Created when the logical camera reports faces
+  std::unique_ptr<EmulatedFaceDetector> face_detector_;
+
+  // Stretches the frame duration within the AE target fps range when frames
+  // can't be rendered and encoded in time.
+  std::unique_ptr<EmulatedFrameRateGovernor> frame_rate_governor_;
+  // Start of the previous governed frame, 0 after a frame without buffers.
+  nsecs_t governor_frame_start_time_ = 0;
+  // Add the render and encode time of the frame to the governor.
+  void UpdateFrameRateGovernor(nsecs_t start_real_time,
+                               nsecs_t start_work_time);
+
+  // Electronic image stabilization of one YUV output size.
+  struct YUVStabilizer {
+    std::unique_ptr<GyroVideoStabilizer> stabilizer;
+    // Frame rendered before the warp, reused across frames.
+    std::vector<uint8_t> input;
+  };
+  // Stabilization of the YUV outputs of one camera, driven by gyro samples
+  // synthesized from the scene handshake.
+  struct CameraStabilization {
+    std::map<std::pair<uint32_t, uint32_t>, YUVStabilizer> stabilizers;
+    // Camera orientation around x and y at gyro_time.
+    float gyro_angle[2] = {0};
+    nsecs_t gyro_time = 0;
+  };
+  // By camera id, only for cameras with stabilization on.
+  std::map<uint32_t, CameraStabilization> stabilization_;
 
   RgbRgbMatrix rgb_rgb_matrix_;
 
@@ -408,16 +491,20 @@ class EmulatedSensor : private Thread, public virtual RefBase {
                                      size_t row_stride_in_bytes,
                                      const SensorCharacteristics& chars);
 
+  // Render the RAW image of camera_id, with the vignetting and the defects
+  // of its lens and sensor.
   void CaptureRawBinned(uint8_t* img, size_t row_stride_in_bytes, uint32_t gain,
-                        const SensorCharacteristics& chars);
+                        const SensorCharacteristics& chars, uint32_t camera_id);
 
   void CaptureRawFullRes(uint8_t* img, size_t row_stride_in_bytes,
-                         uint32_t gain, const SensorCharacteristics& chars);
+                         uint32_t gain, const SensorCharacteristics& chars,
+                         uint32_t camera_id);
   void CaptureRawInSensorZoom(uint8_t* img, size_t row_stride_in_bytes,
-                              uint32_t gain, const SensorCharacteristics& chars);
+                              uint32_t gain, const SensorCharacteristics& chars,
+                              uint32_t camera_id);
   void CaptureRaw(uint8_t* img, size_t row_stride_in_bytes, uint32_t gain,
                   const SensorCharacteristics& chars, bool in_sensor_zoom,
-                  bool binned);
+                  bool binned, uint32_t camera_id);
 
   enum RGBLayout { RGB, RGBA, ARGB };
   void CaptureRGB(uint8_t* img, uint32_t width, uint32_t height,
@@ -426,11 +513,18 @@ class EmulatedSensor : private Thread, public virtual RefBase {
   void CaptureYUV420(YCbCrPlanes yuv_layout, uint32_t width, uint32_t height,
                      uint32_t gain, float zoom_ratio, bool rotate,
                      int32_t color_space, const SensorCharacteristics& chars);
+  // Render 10-bit BT.2020 HLG YCbCr from linear scene light into P010
+  // planes. cbcr_step is in bytes.
+  void CaptureP010(YCbCrPlanes yuv_layout, uint32_t width, uint32_t height,
+                   uint32_t gain, float zoom_ratio, bool rotate,
+                   const SensorCharacteristics& chars);
   void CaptureDepth(uint8_t* img, uint32_t gain, uint32_t width, uint32_t height,
                     uint32_t stride, const SensorCharacteristics& chars);
   void RgbToRgb(uint32_t* r_count, uint32_t* g_count, uint32_t* b_count);
   void CalculateRgbRgbMatrix(int32_t color_space,
                              const SensorCharacteristics& chars);
+  static RgbRgbMatrix GetRgbRgbMatrix(int32_t color_space,
+                                      const SensorCharacteristics& chars);
 
   struct YUV420Frame {
     uint32_t width = 0;
@@ -438,6 +532,28 @@ class EmulatedSensor : private Thread, public virtual RefBase {
     YCbCrPlanes planes;
   };
 
+  // Develop the RAW16 reprocess input of camera_id with the software ISP
+  // into a YUV420 frame of the same size, backed by yuv. The vignetting of
+  // the lens is corrected, and the defective pixels unless hot_pixel_mode is
+  // off.
+  status_t DevelopRAW16(const SensorBuffer& input, int32_t color_space,
+                        const SensorCharacteristics& chars, uint32_t camera_id,
+                        uint8_t hot_pixel_mode, std::vector<uint8_t>* yuv,
+                        YUV420Frame* frame);
+
+  // Lens shading model of camera_id, nullptr if there is none.
+  EmulatedLensShading* GetLensShading(uint32_t camera_id);
+  // Defects of the sensor of camera_id, nullptr if there are none.
+  EmulatedPixelDefects* GetPixelDefects(uint32_t camera_id);
+  static EmulatedIsp::DefectCorrection GetDefectCorrection(
+      uint8_t hot_pixel_mode);
+  // Overwrite the luma of the defective pixels of camera_id in an 8-bit YUV
+  // output rendered at zoom_ratio, and correct them unless hot_pixel_mode is
+  // off, like the ISP of a camera that outputs YUV. The defect positions
+  // don't apply to outputs rotated by rotate_and_crop.
+  void ApplyPixelDefects(const YUV420Frame& frame, uint32_t camera_id,
+                         float zoom_ratio, uint8_t hot_pixel_mode);
+
   enum ProcessType { REPROCESS, HIGH_QUALITY, REGULAR };
   status_t ProcessYUV420(const YUV420Frame& input, const YUV420Frame& output,
                          uint32_t gain, ProcessType process_type,
@@ -445,6 +561,27 @@ class EmulatedSensor : private Thread, public virtual RefBase {
                          int32_t color_space,
                          const SensorCharacteristics& chars);
 
+  // Pass the camera motion since the previous frame, as rendered by the scene
+  // handshake, to the stabilizers of camera_id as gyro samples.
+  void UpdateGyroSamples(uint32_t camera_id,
+                         const SensorCharacteristics& chars);
+
+  // Render a YUV420 output of camera_id and stabilize it with the
+  // stabilizer of its size. Returns the applied correction in correction.
+  status_t ProcessStabilizedYUV420(
+      uint32_t camera_id, const YUV420Frame& output, uint32_t gain,
+      ProcessType process_type, float zoom_ratio, bool rotate_and_crop,
+      int32_t color_space, uint8_t hot_pixel_mode,
+      const SensorCharacteristics& chars,
+      google_camera_hal::StabilizationCorrection* correction /*out*/);
+
+  // Area of the active array rendered into a width x height YUV output at
+  // zoom_ratio, optionally stabilized with correction.
+  EmulatedFaceDetector::CropRegion GetRenderedRegion(
+      uint32_t width, uint32_t height, float zoom_ratio,
+      const google_camera_hal::StabilizationCorrection* correction,
+      const SensorCharacteristics& chars) const;
+
   inline int32_t ApplysRGBGamma(int32_t value, int32_t saturation);
   inline int32_t ApplySMPTE170MGamma(int32_t value, int32_t saturation);
   inline int32_t ApplyST2084Gamma(int32_t value, int32_t saturation);
@@ -455,6 +592,9 @@ class EmulatedSensor : private Thread, public virtual RefBase {
   void CalculateAndAppendNoiseProfile(float gain /*in ISO*/,
                                       float base_gain_factor,
                                       HalCameraMetadata* result /*out*/);
+  // Append the faces of the latest frame processed by the face detector.
+  void ReportFaces(uint8_t face_detect_mode, const SensorCharacteristics& chars,
+                   HalCameraMetadata* result /*out*/);
 
   void ReturnResults(HwlPipelineCallback callback,
                      std::unique_ptr<LogicalCameraSettings> settings,
@@ -467,6 +607,10 @@ class EmulatedSensor : private Thread, public virtual RefBase {
   }
 
   nsecs_t getSystemTimeWithSource(uint32_t timestamp_source);
+
+  // Time base of the sensor timestamps, frame pacing, work times and
+  // deadlines. Shared with the JPEG compressor and the face detector.
+  std::shared_ptr<EmulatedClock> clock_;
 };
 
 }  // namespace android
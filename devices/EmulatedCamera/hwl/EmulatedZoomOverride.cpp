@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "EmulatedZoomOverride"
+#include "EmulatedZoomOverride.h"
+
+#include <inttypes.h>
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace android {
+
+// Keys applied from the overriding request.
+static const camera_metadata_tag kZoomTags[] = {
+    ANDROID_CONTROL_SETTINGS_OVERRIDE, ANDROID_CONTROL_ZOOM_RATIO,
+    ANDROID_SCALER_CROP_REGION,        ANDROID_CONTROL_AE_REGIONS,
+    ANDROID_CONTROL_AWB_REGIONS,       ANDROID_CONTROL_AF_REGIONS};
+
+// Room for the keys above with one region each.
+static const size_t kZoomSettingsDataSize = 128;
+
+EmulatedZoomOverride::~EmulatedZoomOverride() {
+  if (overridden_requests_ > 0) {
+    ALOGI("%s: Zoom of %" PRIu64
+          " requests overridden, %.2f frames earlier on average, at most %u",
+          __FUNCTION__, overridden_requests_,
+          static_cast<double>(total_frames_saved_) / overridden_requests_,
+          max_frames_saved_);
+  }
+}
+
+void EmulatedZoomOverride::QueueRequest(uint32_t frame_number,
+                                        const HalCameraMetadata* settings) {
+  ATRACE_CALL();
+  if (settings == nullptr) {
+    queued_requests_.push_back({.frame_number = frame_number,
+                                .zoom_settings = last_zoom_settings_});
+    return;
+  }
+
+  last_zoom_settings_ = nullptr;
+  camera_metadata_ro_entry_t entry;
+  auto ret = settings->Get(ANDROID_CONTROL_SETTINGS_OVERRIDE, &entry);
+  if ((ret == OK) && (entry.count == 1) &&
+      (entry.data.i32[0] == ANDROID_CONTROL_SETTINGS_OVERRIDE_ZOOM)) {
+    std::shared_ptr<HalCameraMetadata> zoom_settings =
+        HalCameraMetadata::Create(std::size(kZoomTags), kZoomSettingsDataSize);
+    if (zoom_settings.get() == nullptr) {
+      ALOGE("%s: Failed to allocate the zoom settings of request %u",
+            __FUNCTION__, frame_number);
+    } else {
+      for (auto tag : kZoomTags) {
+        if (settings->Get(tag, &entry) == OK) {
+          zoom_settings->Set(entry);
+        } else {
+          ALOGE("%s: %s needs to be specified for overriding zoom",
+                __FUNCTION__, get_camera_metadata_tag_name(tag));
+        }
+      }
+      last_zoom_settings_ = std::move(zoom_settings);
+    }
+  }
+
+  queued_requests_.push_back({.frame_number = frame_number,
+                              .zoom_settings = last_zoom_settings_});
+}
+
+uint32_t EmulatedZoomOverride::Apply(uint32_t frame_number,
+                                     HalCameraMetadata* request_settings) {
+  ATRACE_CALL();
+  while (!queued_requests_.empty() &&
+         (queued_requests_.front().frame_number < frame_number)) {
+    queued_requests_.pop_front();
+  }
+
+  if (request_settings == nullptr) {
+    return 0;
+  }
+
+  // The zoom can move forward up to the end of the run of zoom override
+  // requests that follow this one, by kZoomSpeedup frames at most.
+  const QueuedRequest* target = nullptr;
+  for (const auto& request : queued_requests_) {
+    if (request.frame_number <= frame_number) {
+      continue;
+    }
+    if ((request.frame_number - frame_number > kZoomSpeedup) ||
+        (request.zoom_settings.get() == nullptr)) {
+      break;
+    }
+    target = &request;
+  }
+
+  if (target == nullptr) {
+    return 0;
+  }
+
+  const auto& zoom_settings = *target->zoom_settings;
+  size_t entry_count = zoom_settings.GetEntryCount();
+  for (size_t i = 0; i < entry_count; i++) {
+    camera_metadata_ro_entry_t entry;
+    if (zoom_settings.GetByIndex(&entry, i) == OK) {
+      request_settings->Set(entry);
+    }
+  }
+
+  uint32_t frames_saved = target->frame_number - frame_number;
+  overridden_requests_++;
+  total_frames_saved_ += frames_saved;
+  max_frames_saved_ = std::max(max_frames_saved_, frames_saved);
+  ALOGV("%s: Request %u uses the zoom of request %u", __FUNCTION__,
+        frame_number, target->frame_number);
+
+  return target->frame_number;
+}
+
+}  // namespace android
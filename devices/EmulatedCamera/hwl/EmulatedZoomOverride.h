@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * EmulatedZoomOverride implements ANDROID_CONTROL_SETTINGS_OVERRIDE_ZOOM.
+ * Requests that enable the override let the HAL apply their zoom to earlier
+ * requests that are still queued, so pinch zoom shows up in the output as
+ * soon as the app sends it.
+ *
+ * Only the zoom keys of each queued request are kept. When a request is
+ * processed, the queued requests that follow it are scanned for the run of
+ * consecutive zoom override requests. The zoom of the newest one at most
+ * kZoomSpeedup frames ahead is written to the settings of the processed
+ * request in a single pass. With a steady pipeline every output is then the
+ * same number of frames ahead, so a pinch keeps its pace instead of jumping
+ * to the end of a long queue and stalling there. Since the target only moves
+ * forward, the zoom of the output never goes back.
+ *
+ * Not thread safe.
+ */
+
+#ifndef HW_EMULATOR_ZOOM_OVERRIDE_H
+#define HW_EMULATOR_ZOOM_OVERRIDE_H
+
+#include <hwl_types.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace android {
+
+using google_camera_hal::HalCameraMetadata;
+
+class EmulatedZoomOverride {
+ public:
+  EmulatedZoomOverride() = default;
+  ~EmulatedZoomOverride();
+
+  // Queue request frame_number. settings is nullptr if the request repeats
+  // the settings of the previous request.
+  void QueueRequest(uint32_t frame_number, const HalCameraMetadata* settings);
+
+  // Write the zoom of the newest queued request, at most kZoomSpeedup frames
+  // ahead, that overrides the zoom of request frame_number to
+  // request_settings. Returns the frame number of that request, or 0 if the
+  // zoom is not overridden.
+  uint32_t Apply(uint32_t frame_number, HalCameraMetadata* request_settings);
+
+ private:
+  // Frames by which the zoom of a request can move forward.
+  static const uint32_t kZoomSpeedup = 2;
+
+  struct QueuedRequest {
+    uint32_t frame_number = 0;
+    // Zoom keys of the request, nullptr if the request doesn't override the
+    // zoom. Repeating requests share the keys of the request they repeat.
+    std::shared_ptr<const HalCameraMetadata> zoom_settings;
+  };
+
+  std::deque<QueuedRequest> queued_requests_;
+  std::shared_ptr<const HalCameraMetadata> last_zoom_settings_;
+
+  // Requests whose zoom was overridden and the number of frames by which
+  // their zoom was moved forward.
+  uint64_t overridden_requests_ = 0;
+  uint64_t total_frames_saved_ = 0;
+  uint32_t max_frames_saved_ = 0;
+
+  EmulatedZoomOverride(const EmulatedZoomOverride&) = delete;
+  EmulatedZoomOverride& operator=(const EmulatedZoomOverride&) = delete;
+};
+
+}  // namespace android
+
+#endif  // HW_EMULATOR_ZOOM_OVERRIDE_H
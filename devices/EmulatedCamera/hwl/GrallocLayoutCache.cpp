@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "GrallocLayoutCache"
+#include "GrallocLayoutCache.h"
+
+#include <inttypes.h>
+#include <log/log.h>
+
+namespace android {
+
+GrallocLayoutCache::~GrallocLayoutCache() {
+  if (hit_count_ > 0) {
+    ALOGI("%s: %" PRIu64 " of %" PRIu64 " YCbCr locks reused a cached layout",
+          __FUNCTION__, hit_count_, hit_count_ + miss_count_);
+  }
+}
+
+bool GrallocLayoutCache::LockAndQueryLayout(buffer_handle_t buffer,
+                                            uint64_t usage, int32_t width,
+                                            int32_t height,
+                                            YCbCrPlanes* planes /*out*/,
+                                            Layout* layout /*out*/,
+                                            bool* cacheable /*out*/) {
+  *cacheable = false;
+  // The plane addresses are only meaningful relative to the address a plain
+  // lock maps the buffer at, so map it once to learn that address.
+  uint8_t* base = importer_->Lock(buffer, usage, width, height);
+  if (base == nullptr) {
+    return false;
+  }
+  importer_->Unlock(buffer);
+
+  if (!importer_->LockYCbCr(buffer, usage, width, height, planes)) {
+    return false;
+  }
+
+  *layout = {.width = width,
+             .height = height,
+             .y_offset = planes->img_y - base,
+             .cb_offset = planes->img_cb - base,
+             .cr_offset = planes->img_cr - base,
+             .y_stride = planes->y_stride,
+             .cbcr_stride = planes->cbcr_stride,
+             .cbcr_step = planes->cbcr_step};
+
+  // The offsets are only valid if the mapper keeps the buffer at the same
+  // address across locks. Lock it once more to check, and fall back to a
+  // layout query for every frame otherwise.
+  importer_->Unlock(buffer);
+  uint8_t* new_base = importer_->Lock(buffer, usage, width, height);
+  if (new_base == base) {
+    *cacheable = true;
+    return true;
+  }
+  if (new_base != nullptr) {
+    importer_->Unlock(buffer);
+  }
+  return importer_->LockYCbCr(buffer, usage, width, height, planes);
+}
+
+bool GrallocLayoutCache::LockYCbCr(int32_t stream_id, buffer_handle_t buffer,
+                                   uint64_t usage, int32_t width,
+                                   int32_t height,
+                                   YCbCrPlanes* planes /*out*/) {
+  if ((buffer == nullptr) || (planes == nullptr)) {
+    return false;
+  }
+
+  auto key = std::make_pair(stream_id, buffer);
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  auto it = layouts_.find(key);
+  if ((it != layouts_.end()) && (it->second.width == width) &&
+      (it->second.height == height)) {
+    uint8_t* base = importer_->Lock(buffer, usage, width, height);
+    if (base != nullptr) {
+      const Layout& layout = it->second;
+      planes->img_y = base + layout.y_offset;
+      planes->img_cb = base + layout.cb_offset;
+      planes->img_cr = base + layout.cr_offset;
+      planes->y_stride = layout.y_stride;
+      planes->cbcr_stride = layout.cbcr_stride;
+      planes->cbcr_step = layout.cbcr_step;
+      hit_count_++;
+      return true;
+    }
+    ALOGW("%s: Locking buffer %p of stream %d failed, querying its layout",
+          __FUNCTION__, buffer, stream_id);
+  }
+  if (it != layouts_.end()) {
+    layouts_.erase(it);
+  }
+
+  Layout layout;
+  bool cacheable = false;
+  if (!LockAndQueryLayout(buffer, usage, width, height, planes, &layout,
+                          &cacheable)) {
+    return false;
+  }
+  miss_count_++;
+  if (cacheable) {
+    layouts_.emplace(key, layout);
+  } else {
+    ALOGV("%s: Buffer %p of stream %d moved between locks, not caching it",
+          __FUNCTION__, buffer, stream_id);
+  }
+  return true;
+}
+
+void GrallocLayoutCache::Remove(buffer_handle_t buffer) {
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  for (auto it = layouts_.begin(); it != layouts_.end();) {
+    if (it->first.second == buffer) {
+      it = layouts_.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+uint64_t GrallocLayoutCache::GetHitCount() {
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  return hit_count_;
+}
+
+uint64_t GrallocLayoutCache::GetMissCount() {
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  return miss_count_;
+}
+
+}  // namespace android
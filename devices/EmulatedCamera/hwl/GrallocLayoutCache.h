@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HW_EMULATOR_GRALLOC_LAYOUT_CACHE_H
+#define HW_EMULATOR_GRALLOC_LAYOUT_CACHE_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "Base.h"
+
+namespace android {
+
+// Caches the plane layout of YCbCr buffers that the framework recycles, so a
+// buffer's layout is queried once per stream configuration instead of once
+// per frame. Buffers are still locked for every frame and must be unlocked
+// before they are returned; only the offsets and strides of the planes
+// relative to the locked address are reused.
+class GrallocLayoutCache {
+ public:
+  // Gralloc operations used by the cache.
+  class Importer {
+   public:
+    virtual ~Importer() = default;
+
+    // Lock buffer and return the address it is mapped at, or nullptr.
+    virtual uint8_t* Lock(buffer_handle_t buffer, uint64_t usage,
+                          int32_t width, int32_t height) = 0;
+
+    // Lock buffer and return its planes. Returns false on failure.
+    virtual bool LockYCbCr(buffer_handle_t buffer, uint64_t usage,
+                           int32_t width, int32_t height,
+                           YCbCrPlanes* planes /*out*/) = 0;
+
+    virtual void Unlock(buffer_handle_t buffer) = 0;
+  };
+
+  explicit GrallocLayoutCache(std::shared_ptr<Importer> importer)
+      : importer_(importer) {
+  }
+
+  GrallocLayoutCache(const GrallocLayoutCache&) = delete;
+  GrallocLayoutCache& operator=(const GrallocLayoutCache&) = delete;
+
+  ~GrallocLayoutCache();
+
+  // Lock buffer of stream_id at width x height and return its planes. The
+  // caller unlocks the buffer with Importer::Unlock as after any other lock.
+  // bytesPerPixel of planes is left unchanged.
+  bool LockYCbCr(int32_t stream_id, buffer_handle_t buffer, uint64_t usage,
+                 int32_t width, int32_t height, YCbCrPlanes* planes /*out*/);
+
+  // Forget the layout of buffer.
+  void Remove(buffer_handle_t buffer);
+
+  // Number of locks that reused a cached layout, and that queried it.
+  uint64_t GetHitCount();
+  uint64_t GetMissCount();
+
+ private:
+  struct Layout {
+    int32_t width;
+    int32_t height;
+    // Plane offsets relative to the address returned by Importer::Lock.
+    ptrdiff_t y_offset;
+    ptrdiff_t cb_offset;
+    ptrdiff_t cr_offset;
+    uint32_t y_stride;
+    uint32_t cbcr_stride;
+    uint32_t cbcr_step;
+  };
+
+  // Query the layout of buffer and leave it locked with planes. cacheable is
+  // set if the buffer stays at the same address across locks, so layout can
+  // be reused.
+  bool LockAndQueryLayout(buffer_handle_t buffer, uint64_t usage,
+                          int32_t width, int32_t height,
+                          YCbCrPlanes* planes /*out*/, Layout* layout /*out*/,
+                          bool* cacheable /*out*/);
+
+  std::shared_ptr<Importer> importer_;
+
+  std::mutex cache_lock_;
+  // Layouts by stream id and buffer.
+  std::map<std::pair<int32_t, buffer_handle_t>, Layout> layouts_;
+  uint64_t hit_count_ = 0;
+  uint64_t miss_count_ = 0;
+};
+
+}  // namespace android
+
+#endif
@@ -26,11 +26,15 @@
 #include <utils/Log.h>
 #include <utils/Trace.h>
 
+#include "memory_tracker.h"
+
 namespace android {
 
 using google_camera_hal::CameraBlob;
 using google_camera_hal::CameraBlobId;
 using google_camera_hal::ErrorCode;
+using google_camera_hal::MemoryCategory;
+using google_camera_hal::MemoryTracker;
 using google_camera_hal::MessageType;
 using google_camera_hal::NotifyMessage;
 
@@ -160,7 +164,8 @@ static constexpr uint8_t kIccProfileSrgb[] = {
     0x00, 0x03, 0x00, 0x00, 0x00, 0x02, 0x66, 0x69, 0x00, 0x00, 0xf2, 0xa7,
     0x00, 0x00, 0x0d, 0x59, 0x00, 0x00, 0x13, 0xd0, 0x00, 0x00, 0x0a, 0x5b};
 
-JpegCompressor::JpegCompressor() {
+JpegCompressor::JpegCompressor(std::shared_ptr<EmulatedClock> clock)
+    : clock_(std::move(clock)) {
   ATRACE_CALL();
   char value[PROPERTY_VALUE_MAX];
   if (property_get("ro.product.manufacturer", value, "unknown") <= 0) {
@@ -173,7 +178,15 @@ JpegCompressor::JpegCompressor() {
   }
   exif_model_ = std::string(value);
 
-  jpeg_processing_thread_ = std::thread([this] { this->ThreadLoop(); });
+  if (EmulatedRenderPool::IsSharedPoolEnabled()) {
+    pool_ = EmulatedRenderPool::GetShared();
+  } else {
+    // Compress on a thread of its own, like the sensor renders on its own.
+    pool_ = EmulatedRenderPool::Create(
+        /*thread_count=*/1, google_camera_hal::ThreadRole::kEncode,
+        "JpegCompressor");
+  }
+  pool_client_ = pool_->AddClient("JpegCompressor");
 }
 
 JpegCompressor::~JpegCompressor() {
@@ -181,15 +194,28 @@ JpegCompressor::~JpegCompressor() {
 
   // Abort the ongoing compression and flush any pending jobs
   jpeg_done_ = true;
-  condition_.notify_one();
-  jpeg_processing_thread_.join();
+  pool_->RemoveClient(pool_client_);
   while (!pending_yuv_jobs_.empty()) {
     auto job = std::move(pending_yuv_jobs_.front());
     job->output->stream_buffer.status = BufferStatus::kError;
+    MemoryTracker::GetInstance().Update(MemoryCategory::kJpegStaging,
+                                        MemoryTracker::kNoSession,
+                                        -GetStagingBytes(*job));
     pending_yuv_jobs_.pop();
   }
 }
 
+int64_t JpegCompressor::GetStagingBytes(const JpegYUV420Job& job) {
+  if ((job.input.get() == nullptr) || !job.input->buffer_owner) {
+    return 0;
+  }
+
+  // Both the YUV420 and the P010 copies have chroma planes of half the size
+  // of the luma plane.
+  return static_cast<int64_t>(job.input->yuv_planes.y_stride) *
+         job.input->height * 3 / 2;
+}
+
 status_t JpegCompressor::QueueYUV420(std::unique_ptr<JpegYUV420Job> job) {
   ATRACE_CALL();
 
@@ -204,35 +230,42 @@ status_t JpegCompressor::QueueYUV420(std::unique_ptr<JpegYUV420Job> job) {
     return BAD_VALUE;
   }
 
-  std::unique_lock<std::mutex> lock(mutex_);
-  pending_yuv_jobs_.push(std::move(job));
-  condition_.notify_one();
+  MemoryTracker::GetInstance().Update(MemoryCategory::kJpegStaging,
+                                      MemoryTracker::kNoSession,
+                                      GetStagingBytes(*job));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_yuv_jobs_.push(std::move(job));
+  }
 
-  return OK;
+  // The tasks of the client run in order, each compresses the oldest job.
+  nsecs_t now = clock_->GetTime(ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN);
+  return pool_->Queue(pool_client_, now + kEncodeDeadline,
+                      [this] { this->CompressNextYUV420(); });
 }
 
-void JpegCompressor::ThreadLoop() {
+void JpegCompressor::CompressNextYUV420() {
   ATRACE_CALL();
-
-  while (!jpeg_done_) {
-    std::unique_ptr<JpegYUV420Job> current_yuv_job = nullptr;
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      if (!pending_yuv_jobs_.empty()) {
-        current_yuv_job = std::move(pending_yuv_jobs_.front());
-        pending_yuv_jobs_.pop();
-      }
-    }
-
-    if (current_yuv_job.get() != nullptr) {
-      CompressYUV420(std::move(current_yuv_job));
+  std::unique_ptr<JpegYUV420Job> current_yuv_job = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!pending_yuv_jobs_.empty()) {
+      current_yuv_job = std::move(pending_yuv_jobs_.front());
+      pending_yuv_jobs_.pop();
     }
+  }
 
-    std::unique_lock<std::mutex> lock(mutex_);
-    auto ret = condition_.wait_for(lock, std::chrono::milliseconds(10));
-    if (ret == std::cv_status::timeout) {
-      ALOGV("%s: Jpeg thread timeout", __FUNCTION__);
-    }
+  if (current_yuv_job.get() != nullptr) {
+    int64_t staging_bytes = GetStagingBytes(*current_yuv_job);
+    nsecs_t start_time =
+        clock_->GetTime(ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN);
+    CompressYUV420(std::move(current_yuv_job));
+    compress_time_ +=
+        clock_->GetTime(ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN) -
+        start_time;
+    MemoryTracker::GetInstance().Update(MemoryCategory::kJpegStaging,
+                                        MemoryTracker::kNoSession,
+                                        -staging_bytes);
   }
 }
 
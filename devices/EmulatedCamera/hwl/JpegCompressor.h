@@ -18,13 +18,16 @@
 #define HW_EMULATOR_CAMERA_JPEG_H
 
 #include <hwl_types.h>
+#include <utils/Timers.h>
 
-#include <condition_variable>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <queue>
-#include <thread>
 
 #include "Base.h"
+#include "EmulatedClock.h"
+#include "EmulatedRenderPool.h"
 
 extern "C" {
 #include <jpeglib.h>
@@ -66,16 +69,30 @@ struct JpegYUV420Job {
 
 class JpegCompressor {
  public:
-  JpegCompressor();
+  // Deadlines and compression time are kept on clock, the clock of the
+  // sensor.
+  explicit JpegCompressor(std::shared_ptr<EmulatedClock> clock);
   virtual ~JpegCompressor();
 
   status_t QueueYUV420(std::unique_ptr<JpegYUV420Job> job);
 
+  // Time spent compressing since the previous call.
+  nsecs_t TakeCompressTime() {
+    return compress_time_.exchange(0);
+  }
+
  private:
+  // Jobs are compressed on the render pool shared with the sensors, or on an
+  // encode thread of the compressor if the pool isn't shared, due this long
+  // after they were queued.
+  static constexpr nsecs_t kEncodeDeadline = 100000000;  // 100 ms
+
+  const std::shared_ptr<EmulatedClock> clock_;
   std::mutex mutex_;
-  std::condition_variable condition_;
   std::atomic_bool jpeg_done_ = false;
-  std::thread jpeg_processing_thread_;
+  std::atomic<nsecs_t> compress_time_ = 0;
+  std::shared_ptr<EmulatedRenderPool> pool_;
+  uint32_t pool_client_ = EmulatedRenderPool::kInvalidClient;
   std::queue<std::unique_ptr<JpegYUV420Job>> pending_yuv_jobs_;
   std::string exif_make_, exif_model_;
 
@@ -94,7 +111,10 @@ class JpegCompressor {
   };
   size_t CompressYUV420Frame(YUV420Frame frame);
   size_t JpegRCompressYUV420Frame(YUV420Frame p010_frame);
-  void ThreadLoop();
+  // Bytes of the input frame copy owned by job, reported to MemoryTracker.
+  static int64_t GetStagingBytes(const JpegYUV420Job& job);
+  // Compress the oldest pending job.
+  void CompressNextYUV420();
 
   JpegCompressor(const JpegCompressor&) = delete;
   JpegCompressor& operator=(const JpegCompressor&) = delete;
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EmulatedClockTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+#include <pthread.h>
+#include <signal.h>
+#include <system/camera_metadata.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "EmulatedClock.h"
+
+namespace android {
+
+static constexpr uint32_t kMonotonic =
+    ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN;
+static constexpr uint32_t kBootTime =
+    ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME;
+
+TEST(EmulatedClockTests, RealClockFollowsSystemTime) {
+  EmulatedRealClock clock;
+  EXPECT_FALSE(clock.IsVirtual());
+  EXPECT_NEAR(clock.GetTime(kMonotonic), systemTime(SYSTEM_TIME_MONOTONIC),
+              ms2ns(10));
+  EXPECT_NEAR(clock.GetTime(kBootTime), systemTime(SYSTEM_TIME_BOOTTIME),
+              ms2ns(10));
+}
+
+TEST(EmulatedClockTests, RealClockWaitUntil) {
+  EmulatedRealClock clock;
+  for (uint32_t source : {kMonotonic, kBootTime}) {
+    nsecs_t time = clock.GetTime(source) + ms2ns(20);
+    clock.WaitUntil(source, time);
+    EXPECT_GE(clock.GetTime(source), time);
+
+    // Times that passed return right away.
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    clock.WaitUntil(source, time - s2ns(1));
+    EXPECT_LT(systemTime(SYSTEM_TIME_MONOTONIC) - start, ms2ns(10));
+  }
+}
+
+static std::atomic<uint32_t> signal_count = 0;
+
+static void CountSignal(int) {
+  signal_count++;
+}
+
+TEST(EmulatedClockTests, RealClockWaitsThroughSignals) {
+  // Without SA_RESTART, every signal interrupts the sleep with EINTR.
+  struct sigaction action = {};
+  struct sigaction old_action = {};
+  action.sa_handler = CountSignal;
+  ASSERT_EQ(sigaction(SIGUSR1, &action, &old_action), 0);
+
+  EmulatedRealClock clock;
+  pthread_t waiter = pthread_self();
+  std::atomic_bool done = false;
+  std::thread interrupter([waiter, &done] {
+    while (!done) {
+      pthread_kill(waiter, SIGUSR1);
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  });
+
+  nsecs_t time = clock.GetTime(kMonotonic) + ms2ns(100);
+  clock.WaitUntil(kMonotonic, time);
+  nsecs_t end = clock.GetTime(kMonotonic);
+  done = true;
+  interrupter.join();
+  sigaction(SIGUSR1, &old_action, nullptr);
+
+  EXPECT_GT(signal_count, 1u);
+  EXPECT_GE(end, time);
+}
+
+TEST(EmulatedClockTests, VirtualClockAdvancesOnWait) {
+  EmulatedVirtualClock clock;
+  EXPECT_TRUE(clock.IsVirtual());
+  nsecs_t monotonic = clock.GetTime(kMonotonic);
+  nsecs_t boot_time = clock.GetTime(kBootTime);
+  EXPECT_NEAR(monotonic, systemTime(SYSTEM_TIME_MONOTONIC), ms2ns(10));
+  EXPECT_NEAR(boot_time, systemTime(SYSTEM_TIME_BOOTTIME), ms2ns(10));
+
+  // The time doesn't move on its own.
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_EQ(clock.GetTime(kMonotonic), monotonic);
+
+  // A wait of a minute returns right away, and both sources move by exactly
+  // the waited time.
+  nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+  clock.WaitUntil(kMonotonic, monotonic + s2ns(60));
+  EXPECT_LT(systemTime(SYSTEM_TIME_MONOTONIC) - start, ms2ns(10));
+  EXPECT_EQ(clock.GetTime(kMonotonic), monotonic + s2ns(60));
+  EXPECT_EQ(clock.GetTime(kBootTime), boot_time + s2ns(60));
+
+  // Waiting for the boot time source moves the monotonic one too, and the
+  // time never goes back.
+  clock.WaitUntil(kBootTime, boot_time + s2ns(61));
+  EXPECT_EQ(clock.GetTime(kMonotonic), monotonic + s2ns(61));
+  clock.WaitUntil(kMonotonic, monotonic);
+  EXPECT_EQ(clock.GetTime(kMonotonic), monotonic + s2ns(61));
+}
+
+TEST(EmulatedClockTests, VirtualClockConcurrentWaits) {
+  EmulatedVirtualClock clock;
+  const nsecs_t base = clock.GetTime(kMonotonic);
+  constexpr uint32_t kNumThreads = 4;
+  constexpr uint32_t kNumWaits = 1000;
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&clock, base, t] {
+      for (uint32_t i = 1; i <= kNumWaits; i++) {
+        clock.WaitUntil(kMonotonic, base + ms2ns(i * kNumThreads + t));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // The clock ends at the latest time waited for.
+  EXPECT_EQ(clock.GetTime(kMonotonic),
+            base + ms2ns(kNumWaits * kNumThreads + kNumThreads - 1));
+}
+
+}  // namespace android
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Cost per frame of face detection by preview resolution, from submitting
+// the luma plane to the faces being available, without a deadline.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "EmulatedFaceDetector.h"
+
+namespace android {
+namespace {
+
+// Gray luma plane with a frontal face a quarter of the width wide.
+std::vector<uint8_t> GetFaceFrame(uint32_t width, uint32_t height) {
+  std::vector<uint8_t> luma(width * height, 128);
+  const uint32_t cell = width / 4 / 24;
+  const uint32_t face_left = width / 2 - 12 * cell;
+  const uint32_t face_top = height / 2 - 12 * cell;
+  auto fill = [&](uint32_t left, uint32_t top, uint32_t right,
+                  uint32_t bottom, uint8_t value) {
+    for (uint32_t y = face_top + top * cell; y < face_top + bottom * cell;
+         y++) {
+      for (uint32_t x = face_left + left * cell;
+           x < face_left + right * cell; x++) {
+        luma[y * width + x] = value;
+      }
+    }
+  };
+  fill(0, 0, 24, 24, 180);
+  fill(3, 7, 10, 11, 40);   // Left eye
+  fill(14, 7, 21, 11, 40);  // Right eye
+  fill(7, 17, 17, 20, 60);  // Mouth
+  return luma;
+}
+
+void BM_DetectFrame(benchmark::State& state) {
+  const uint32_t width = static_cast<uint32_t>(state.range(0));
+  const uint32_t height = static_cast<uint32_t>(state.range(1));
+  auto detector = EmulatedFaceDetector::Create(
+      s2ns(10), std::make_shared<EmulatedRealClock>());
+  if (detector == nullptr) {
+    state.SkipWithError("Failed to create the face detector");
+    return;
+  }
+
+  const std::vector<uint8_t> luma = GetFaceFrame(width, height);
+  const EmulatedFaceDetector::CropRegion crop{
+      .left = 0,
+      .top = 0,
+      .width = static_cast<float>(width),
+      .height = static_cast<float>(height)};
+  std::vector<EmulatedFaceDetector::Face> faces;
+  nsecs_t timestamp = 0;
+  for (auto _ : state) {
+    detector->Clear();
+    if (!detector->Submit(luma.data(), width, width, height, crop,
+                          /*timestamp=*/1)) {
+      state.SkipWithError("Failed to submit the frame");
+      return;
+    }
+    while (!detector->GetFaces(/*max_faces=*/10, &faces, &timestamp)) {
+      std::this_thread::yield();
+    }
+    if (faces.empty()) {
+      state.SkipWithError("No face detected");
+      return;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_DetectFrame)
+    ->ArgNames({"width", "height"})
+    ->Args({320, 240})
+    ->Args({640, 480})
+    ->Args({1280, 720})
+    ->Args({1920, 1080})
+    ->Args({4032, 3024})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace android
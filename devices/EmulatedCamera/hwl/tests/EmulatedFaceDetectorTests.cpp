@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EmulatedFaceDetectorTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+#include <system/camera_metadata.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "EmulatedFaceDetector.h"
+
+namespace android {
+
+static constexpr uint32_t kWidth = 320;
+static constexpr uint32_t kHeight = 240;
+// The face is drawn on the 24 x 24 cell grid of the detection window.
+static constexpr int32_t kCell = 4;
+static constexpr int32_t kFaceSize = 24 * kCell;
+static constexpr int32_t kFaceLeft = 120;
+static constexpr int32_t kFaceTop = 60;
+
+// Deadline on clock far enough away for any scan.
+static nsecs_t GetDeadline(EmulatedClock& clock) {
+  return clock.GetTime(ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN) +
+         s2ns(10);
+}
+
+// Gray image with a frontal face pattern: dark eyes and mouth on brighter
+// skin.
+static std::vector<uint8_t> GetFaceImage() {
+  std::vector<uint8_t> image(kWidth * kHeight, 128);
+  auto fill = [&image](int32_t left, int32_t top, int32_t right,
+                       int32_t bottom, uint8_t value) {
+    for (int32_t y = kFaceTop + top * kCell; y < kFaceTop + bottom * kCell;
+         y++) {
+      for (int32_t x = kFaceLeft + left * kCell;
+           x < kFaceLeft + right * kCell; x++) {
+        image[y * kWidth + x] = value;
+      }
+    }
+  };
+  fill(0, 0, 24, 24, 180);
+  fill(3, 7, 10, 11, 40);   // Left eye
+  fill(14, 7, 21, 11, 40);  // Right eye
+  fill(7, 17, 17, 20, 60);  // Mouth
+  return image;
+}
+
+TEST(EmulatedFaceDetectorTests, DetectFace) {
+  auto image = GetFaceImage();
+  EmulatedRealClock clock;
+  bool deadline_missed = true;
+  auto faces = EmulatedFaceDetector::Detect(image.data(), kWidth, kHeight,
+                                            &clock, GetDeadline(clock),
+                                            &deadline_missed);
+  EXPECT_FALSE(deadline_missed);
+  ASSERT_EQ(faces.size(), 1u);
+
+  const auto& face = faces[0];
+  EXPECT_NEAR(face.left, kFaceLeft, 2 * kCell);
+  EXPECT_NEAR(face.top, kFaceTop, 2 * kCell);
+  EXPECT_NEAR(face.right, kFaceLeft + kFaceSize, 2 * kCell);
+  EXPECT_NEAR(face.bottom, kFaceTop + kFaceSize, 2 * kCell);
+  EXPECT_GE(face.score, 1);
+  EXPECT_LE(face.score, 100);
+  EXPECT_NEAR(face.left_eye[0], kFaceLeft + 6.5f * kCell, 2 * kCell);
+  EXPECT_NEAR(face.left_eye[1], kFaceTop + 9 * kCell, 2 * kCell);
+  EXPECT_NEAR(face.right_eye[0], kFaceLeft + 17.5f * kCell, 2 * kCell);
+  EXPECT_NEAR(face.mouth[1], kFaceTop + 18.5f * kCell, 2 * kCell);
+}
+
+TEST(EmulatedFaceDetectorTests, RejectImagesWithoutFaces) {
+  std::vector<uint8_t> image(kWidth * kHeight, 128);
+  EmulatedRealClock clock;
+  EXPECT_TRUE(EmulatedFaceDetector::Detect(image.data(), kWidth, kHeight,
+                                           &clock, GetDeadline(clock), nullptr)
+                  .empty());
+
+  // Vertical stripes have contrast but no face layout.
+  for (uint32_t y = 0; y < kHeight; y++) {
+    for (uint32_t x = 0; x < kWidth; x++) {
+      image[y * kWidth + x] = (x / 8) % 2 ? 200 : 50;
+    }
+  }
+  EXPECT_TRUE(EmulatedFaceDetector::Detect(image.data(), kWidth, kHeight,
+                                           &clock, GetDeadline(clock), nullptr)
+                  .empty());
+
+  // Smaller than the detection window.
+  EXPECT_TRUE(EmulatedFaceDetector::Detect(image.data(), 16, 16, &clock,
+                                           GetDeadline(clock), nullptr)
+                  .empty());
+}
+
+TEST(EmulatedFaceDetectorTests, StopAtDeadline) {
+  auto image = GetFaceImage();
+  EmulatedRealClock clock;
+  bool deadline_missed = false;
+  auto faces = EmulatedFaceDetector::Detect(image.data(), kWidth, kHeight,
+                                            &clock, /*deadline_time=*/0,
+                                            &deadline_missed);
+  EXPECT_TRUE(deadline_missed);
+  EXPECT_TRUE(faces.empty());
+}
+
+// Clock that moves by 1 ns every time it is read.
+class TickingClock : public EmulatedClock {
+ public:
+  nsecs_t GetTime(uint32_t /*timestamp_source*/) override {
+    return ++time_;
+  }
+  void WaitUntil(uint32_t /*timestamp_source*/, nsecs_t time) override {
+    time_ = std::max(time_, time);
+  }
+  bool IsVirtual() const override {
+    return true;
+  }
+
+  nsecs_t time_ = 0;
+};
+
+TEST(EmulatedFaceDetectorTests, StopWithinScale) {
+  // A strip as wide as the smallest window is scanned at a single scale,
+  // with over a hundred rows. The deadline passes after 5 of them.
+  constexpr uint32_t kStripWidth = 24;
+  std::vector<uint8_t> image(kStripWidth * kHeight, 128);
+  TickingClock clock;
+  bool deadline_missed = false;
+  EmulatedFaceDetector::Detect(image.data(), kStripWidth, kHeight, &clock,
+                               /*deadline_time=*/5, &deadline_missed);
+  EXPECT_TRUE(deadline_missed);
+  EXPECT_EQ(clock.time_, 6);
+}
+
+TEST(EmulatedFaceDetectorTests, VirtualClockScansWholeFrame) {
+  // The virtual time doesn't move while scanning, so even a deadline of
+  // 1 ns is met.
+  auto image = GetFaceImage();
+  EmulatedVirtualClock clock;
+  bool deadline_missed = true;
+  auto faces = EmulatedFaceDetector::Detect(
+      image.data(), kWidth, kHeight, &clock,
+      clock.GetTime(ANDROID_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN) + 1,
+      &deadline_missed);
+  EXPECT_FALSE(deadline_missed);
+  EXPECT_EQ(faces.size(), 1u);
+
+  EXPECT_EQ(EmulatedFaceDetector::Create(s2ns(10), nullptr), nullptr);
+}
+
+// Wait for the detector thread to process the submitted frame.
+static bool WaitForFaces(EmulatedFaceDetector* detector,
+                         std::vector<EmulatedFaceDetector::Face>* faces,
+                         nsecs_t* timestamp) {
+  for (int i = 0; i < 500; i++) {
+    if (detector->GetFaces(/*max_faces=*/10, faces, timestamp)) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+TEST(EmulatedFaceDetectorTests, MapFacesThroughCrop) {
+  auto detector = EmulatedFaceDetector::Create(
+      s2ns(10), std::make_shared<EmulatedRealClock>());
+  ASSERT_NE(detector, nullptr);
+
+  // The frame shows a 2x zoomed, centered crop of a 1280 x 960 array.
+  auto image = GetFaceImage();
+  EmulatedFaceDetector::CropRegion crop{
+      .left = 320, .top = 240, .width = 640, .height = 480};
+  ASSERT_TRUE(
+      detector->Submit(image.data(), kWidth, kWidth, kHeight, crop, 1234));
+
+  std::vector<EmulatedFaceDetector::Face> faces;
+  nsecs_t timestamp = 0;
+  ASSERT_TRUE(WaitForFaces(detector.get(), &faces, &timestamp));
+  EXPECT_EQ(timestamp, 1234);
+  ASSERT_EQ(faces.size(), 1u);
+  EXPECT_NEAR(faces[0].left, 320 + 2 * kFaceLeft, 4 * kCell);
+  EXPECT_NEAR(faces[0].top, 240 + 2 * kFaceTop, 4 * kCell);
+  EXPECT_NEAR(faces[0].right, 320 + 2 * (kFaceLeft + kFaceSize), 4 * kCell);
+  EXPECT_NEAR(faces[0].bottom, 240 + 2 * (kFaceTop + kFaceSize), 4 * kCell);
+  EXPECT_NEAR(faces[0].mouth[1], 240 + 2 * (kFaceTop + 18.5f * kCell),
+              4 * kCell);
+
+  EXPECT_TRUE(detector->GetFaces(/*max_faces=*/0, &faces, &timestamp));
+  EXPECT_TRUE(faces.empty());
+
+  detector->Clear();
+  EXPECT_FALSE(detector->GetFaces(/*max_faces=*/10, &faces, &timestamp));
+}
+
+}  // namespace android
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EmulatedFrameRateGovernorTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <random>
+
+#include "EmulatedFrameRateGovernor.h"
+
+namespace android {
+
+// 30 fps requested, the request allows down to 15 fps.
+static const nsecs_t kFrameDuration = ms2ns(1000) / 30;
+static const nsecs_t kMaxFrameDuration = ms2ns(1000) / 15;
+
+static bool IsWholeFps(nsecs_t duration) {
+  return ms2ns(1000) / (ms2ns(1000) / duration) == duration;
+}
+
+// Run frames that take work_time, the way the sensor does: a frame starts
+// one frame duration after the previous one, or when the previous one is
+// done if that is later. Return the last frame duration.
+static nsecs_t RunFrames(EmulatedFrameRateGovernor* governor,
+                         nsecs_t* previous_interval, uint32_t frames,
+                         nsecs_t work_time) {
+  nsecs_t frame_duration = 0;
+  for (uint32_t i = 0; i < frames; i++) {
+    frame_duration =
+        governor->GetFrameDuration(kFrameDuration, kMaxFrameDuration);
+    governor->AddFrame(*previous_interval, work_time);
+    *previous_interval = std::max(frame_duration, work_time);
+  }
+  return frame_duration;
+}
+
+TEST(EmulatedFrameRateGovernorTests, DisabledKeepsRequestedDuration) {
+  auto governor = EmulatedFrameRateGovernor::Create(/*enabled=*/false);
+  ASSERT_NE(governor, nullptr);
+  nsecs_t interval = 0;
+  EXPECT_EQ(RunFrames(governor.get(), &interval, 20, ms2ns(50)),
+            kFrameDuration);
+  EXPECT_EQ(governor->GetStats().frame_duration_changes, 0u);
+}
+
+TEST(EmulatedFrameRateGovernorTests, FixedFrameRateIsKept) {
+  auto governor = EmulatedFrameRateGovernor::Create(/*enabled=*/true);
+  ASSERT_NE(governor, nullptr);
+  for (uint32_t i = 0; i < 20; i++) {
+    EXPECT_EQ(governor->GetFrameDuration(kFrameDuration, kFrameDuration),
+              kFrameDuration);
+    governor->AddFrame(0, ms2ns(50));
+  }
+}
+
+TEST(EmulatedFrameRateGovernorTests, SlowDownRightAway) {
+  auto governor = EmulatedFrameRateGovernor::Create(/*enabled=*/true);
+  ASSERT_NE(governor, nullptr);
+  nsecs_t interval = 0;
+  EXPECT_EQ(RunFrames(governor.get(), &interval, 1, ms2ns(40)),
+            kFrameDuration);
+
+  // 40 ms is 85% of 47.06 ms, rounded up to 21 fps.
+  nsecs_t frame_duration = RunFrames(governor.get(), &interval, 1, ms2ns(40));
+  EXPECT_EQ(frame_duration, ms2ns(1000) / 21);
+  EXPECT_TRUE(IsWholeFps(frame_duration));
+
+  // Never slower than the request allows. A frame duration is picked before
+  // the frame, so the slow frame counts from the next one.
+  frame_duration = RunFrames(governor.get(), &interval, 2, ms2ns(100));
+  EXPECT_EQ(frame_duration, kMaxFrameDuration);
+}
+
+TEST(EmulatedFrameRateGovernorTests, DurationsAreWholeFps) {
+  auto governor = EmulatedFrameRateGovernor::Create(/*enabled=*/true);
+  ASSERT_NE(governor, nullptr);
+  nsecs_t interval = 0;
+  for (nsecs_t work_time = ms2ns(20); work_time <= ms2ns(70);
+       work_time += ms2ns(1) + 7) {
+    nsecs_t frame_duration =
+        RunFrames(governor.get(), &interval, 2, work_time);
+    EXPECT_TRUE(IsWholeFps(frame_duration)) << frame_duration;
+    EXPECT_GE(frame_duration, kFrameDuration);
+    EXPECT_LE(frame_duration, kMaxFrameDuration);
+  }
+}
+
+TEST(EmulatedFrameRateGovernorTests, SpeedUpAfterLightFrames) {
+  auto governor = EmulatedFrameRateGovernor::Create(/*enabled=*/true);
+  ASSERT_NE(governor, nullptr);
+  nsecs_t interval = 0;
+  nsecs_t slow_duration = RunFrames(governor.get(), &interval, 20, ms2ns(60));
+  EXPECT_EQ(slow_duration, kMaxFrameDuration);
+
+  // The slow frames leave the work window after 15 frames, then it takes 30
+  // light frames in a row to speed up.
+  uint32_t light_frames = 0;
+  nsecs_t frame_duration = slow_duration;
+  while ((frame_duration == slow_duration) && (light_frames < 100)) {
+    frame_duration = RunFrames(governor.get(), &interval, 1, ms2ns(10));
+    light_frames++;
+  }
+  EXPECT_GE(light_frames, 30u);
+  EXPECT_LT(light_frames, 100u);
+  EXPECT_EQ(frame_duration, kFrameDuration);
+}
+
+TEST(EmulatedFrameRateGovernorTests, HeavyFrameResetsSpeedUp) {
+  auto governor = EmulatedFrameRateGovernor::Create(/*enabled=*/true);
+  ASSERT_NE(governor, nullptr);
+  nsecs_t interval = 0;
+  nsecs_t slow_duration = RunFrames(governor.get(), &interval, 20, ms2ns(60));
+
+  // A heavy frame every 20 frames keeps the peak high and the speed up
+  // count from reaching 30.
+  for (uint32_t i = 0; i < 10; i++) {
+    EXPECT_EQ(RunFrames(governor.get(), &interval, 19, ms2ns(10)),
+              slow_duration);
+    EXPECT_EQ(RunFrames(governor.get(), &interval, 1, ms2ns(60)),
+              slow_duration);
+  }
+}
+
+TEST(EmulatedFrameRateGovernorTests, StableBetweenThresholds) {
+  auto governor = EmulatedFrameRateGovernor::Create(/*enabled=*/true);
+  ASSERT_NE(governor, nullptr);
+  nsecs_t interval = 0;
+  nsecs_t slow_duration = RunFrames(governor.get(), &interval, 20, ms2ns(40));
+
+  // 30 ms fits in 85% of the frame duration, but not in 60% of any faster
+  // one, so the frame rate doesn't move.
+  EXPECT_EQ(RunFrames(governor.get(), &interval, 200, ms2ns(30)),
+            slow_duration);
+  EXPECT_EQ(governor->GetStats().frame_duration_changes, 1u);
+}
+
+TEST(EmulatedFrameRateGovernorTests, LessJitterThanDisabled) {
+  auto enabled = EmulatedFrameRateGovernor::Create(/*enabled=*/true);
+  auto disabled = EmulatedFrameRateGovernor::Create(/*enabled=*/false);
+  ASSERT_NE(enabled, nullptr);
+  ASSERT_NE(disabled, nullptr);
+
+  // The same fluctuating load, between 25 and 60 ms a frame.
+  std::mt19937 rand_engine(1);
+  std::uniform_int_distribution<nsecs_t> work_time(ms2ns(25), ms2ns(60));
+  nsecs_t enabled_interval = 0;
+  nsecs_t disabled_interval = 0;
+  for (uint32_t i = 0; i < 400; i++) {
+    nsecs_t work = work_time(rand_engine);
+    RunFrames(enabled.get(), &enabled_interval, 1, work);
+    RunFrames(disabled.get(), &disabled_interval, 1, work);
+  }
+
+  auto enabled_stats = enabled->GetStats();
+  auto disabled_stats = disabled->GetStats();
+  EXPECT_EQ(enabled_stats.frames, 400u);
+  EXPECT_EQ(disabled_stats.frames, 400u);
+  EXPECT_EQ(enabled_stats.frame_duration, kMaxFrameDuration);
+  EXPECT_EQ(enabled_stats.slipped_frames, 0u);
+  EXPECT_GT(disabled_stats.slipped_frames, 0u);
+  EXPECT_LT(enabled_stats.frame_interval_jitter,
+            disabled_stats.frame_interval_jitter / 10);
+  EXPECT_GT(enabled_stats.mean_frame_interval,
+            disabled_stats.mean_frame_interval);
+}
+
+}  // namespace android
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EmulatedHlgEncoderTests"
+#include <endian.h>
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include <cmath>
+#include <vector>
+
+#include "EmulatedHlgEncoder.h"
+
+namespace android {
+
+// BT.2100 HLG OETF
+static float GetHlg(float e) {
+  const float a = 0.17883277f;
+  const float b = 0.28466892f;
+  const float c = 0.55991073f;
+  return (e <= 1.f / 12.f) ? std::sqrt(3.f * e)
+                            : a * std::log(12.f * e - b) + c;
+}
+
+static uint32_t GetCode(uint16_t value) {
+  return le16toh(value) >> 6;
+}
+
+// Two rows of width pixels, P010 chroma interleaved like NV12.
+class Frame {
+ public:
+  explicit Frame(uint32_t width)
+      : width_(width), rows_(6 * width), luma_(2 * width), chroma_(width + 1) {
+    for (size_t i = 0; i < 6; i++) {
+      rgb_[i] = rows_.data() + i * width;
+    }
+  }
+
+  void Fill(uint32_t row, uint32_t x, float r, float g, float b) {
+    rgb_[row * 3][x] = r;
+    rgb_[row * 3 + 1][x] = g;
+    rgb_[row * 3 + 2][x] = b;
+  }
+
+  void FillAll(float r, float g, float b) {
+    for (uint32_t row = 0; row < 2; row++) {
+      for (uint32_t x = 0; x < width_; x++) {
+        Fill(row, x, r, g, b);
+      }
+    }
+  }
+
+  void Encode(const EmulatedHlgEncoder& encoder, bool lower_row = true) {
+    auto chroma = reinterpret_cast<uint8_t*>(chroma_.data());
+    encoder.EncodeRows(rgb_, width_, luma_.data(),
+                       lower_row ? luma_.data() + width_ : nullptr, chroma,
+                       chroma + 2, /*cbcr_step=*/4);
+  }
+
+  uint32_t GetY(uint32_t row, uint32_t x) const {
+    return GetCode(luma_[row * width_ + x]);
+  }
+  uint32_t GetCb(uint32_t x) const {
+    return GetCode(chroma_[x / 2 * 2]);
+  }
+  uint32_t GetCr(uint32_t x) const {
+    return GetCode(chroma_[x / 2 * 2 + 1]);
+  }
+
+ private:
+  uint32_t width_;
+  std::vector<float> rows_;
+  float* rgb_[6];
+  std::vector<uint16_t> luma_;
+  std::vector<uint16_t> chroma_;
+};
+
+TEST(EmulatedHlgEncoderTests, OetfMatchesBt2100) {
+  EmulatedHlgEncoder encoder;
+  constexpr uint32_t kNumValues = 4096;
+  std::vector<float> values(kNumValues + 1);
+  for (uint32_t i = 0; i <= kNumValues; i++) {
+    values[i] = static_cast<float>(i) / kNumValues;
+  }
+  encoder.ApplyOetf(values.data(), values.size());
+
+  // Less than a 10-bit code off in both segments.
+  for (uint32_t i = 0; i <= kNumValues; i++) {
+    float e = static_cast<float>(i) / kNumValues;
+    EXPECT_NEAR(values[i], GetHlg(e), 0.5f / 1023.f) << "E " << e;
+  }
+  EXPECT_FLOAT_EQ(values[0], 0.f);
+  EXPECT_NEAR(values[kNumValues], 1.f, 1e-5f);
+}
+
+TEST(EmulatedHlgEncoderTests, GrayIsNeutral) {
+  EmulatedHlgEncoder encoder;
+  Frame frame(4);
+  for (float e : {0.f, 1.f / 48.f, 1.f / 12.f, 0.26f, 1.f}) {
+    frame.FillAll(e, e, e);
+    frame.Encode(encoder);
+    uint32_t y = static_cast<uint32_t>(64.f + 876.f * GetHlg(e) + 0.5f);
+    for (uint32_t x = 0; x < 4; x++) {
+      EXPECT_NEAR(frame.GetY(0, x), y, 1) << "E " << e;
+      EXPECT_NEAR(frame.GetY(1, x), y, 1) << "E " << e;
+      EXPECT_EQ(frame.GetCb(x), 512u) << "E " << e;
+      EXPECT_EQ(frame.GetCr(x), 512u) << "E " << e;
+    }
+  }
+
+  // Limited range black and white
+  frame.FillAll(0.f, 0.f, 0.f);
+  frame.Encode(encoder);
+  EXPECT_EQ(frame.GetY(0, 0), 64u);
+  frame.FillAll(1.f, 1.f, 1.f);
+  frame.Encode(encoder);
+  EXPECT_EQ(frame.GetY(0, 0), 940u);
+}
+
+TEST(EmulatedHlgEncoderTests, Primaries) {
+  EmulatedHlgEncoder encoder;
+  Frame frame(2);
+
+  // Pure BT.2020 primaries land on the edges of the limited chroma range.
+  frame.FillAll(1.f, 0.f, 0.f);
+  frame.Encode(encoder);
+  EXPECT_EQ(frame.GetY(0, 0),
+            static_cast<uint32_t>(64.f + 876.f * 0.2627f + 0.5f));
+  EXPECT_EQ(frame.GetCr(0), 960u);
+  EXPECT_LT(frame.GetCb(0), 512u);
+
+  frame.FillAll(0.f, 0.f, 1.f);
+  frame.Encode(encoder);
+  EXPECT_EQ(frame.GetY(0, 0),
+            static_cast<uint32_t>(64.f + 876.f * 0.0593f + 0.5f));
+  EXPECT_EQ(frame.GetCb(0), 960u);
+  EXPECT_LT(frame.GetCr(0), 512u);
+
+  frame.FillAll(0.f, 1.f, 0.f);
+  frame.Encode(encoder);
+  EXPECT_LT(frame.GetCb(0), 512u);
+  EXPECT_LT(frame.GetCr(0), 512u);
+  EXPECT_GE(frame.GetCb(0), 64u);
+  EXPECT_GE(frame.GetCr(0), 64u);
+}
+
+TEST(EmulatedHlgEncoderTests, ChromaAveragesBlocks) {
+  EmulatedHlgEncoder encoder;
+  Frame frame(3);
+  frame.FillAll(0.f, 0.f, 0.f);
+  // A single red pixel in the first block, a red column on the odd edge.
+  frame.Fill(1, 1, 1.f, 0.f, 0.f);
+  frame.Fill(0, 2, 1.f, 0.f, 0.f);
+  frame.Fill(1, 2, 1.f, 0.f, 0.f);
+  frame.Encode(encoder);
+
+  EXPECT_EQ(frame.GetY(0, 0), 64u);
+  EXPECT_GT(frame.GetY(1, 1), 64u);
+  // Red is 448 codes above neutral Cr, a quarter of it in the first block.
+  EXPECT_NEAR(frame.GetCr(0), 512u + 448u / 4, 1);
+  EXPECT_EQ(frame.GetCr(2), 960u);
+}
+
+TEST(EmulatedHlgEncoderTests, SingleRow) {
+  EmulatedHlgEncoder encoder;
+  Frame frame(2);
+  frame.FillAll(0.f, 0.f, 0.f);
+  frame.Encode(encoder);
+  frame.Fill(0, 0, 1.f, 0.f, 0.f);
+  frame.Fill(0, 1, 1.f, 0.f, 0.f);
+  frame.Fill(1, 0, 0.f, 0.f, 1.f);
+  frame.Fill(1, 1, 0.f, 0.f, 1.f);
+  frame.Encode(encoder, /*lower_row=*/false);
+
+  // The lower row is neither written nor averaged into the chroma.
+  EXPECT_EQ(frame.GetY(1, 0), 64u);
+  EXPECT_EQ(frame.GetCr(0), 960u);
+}
+
+}  // namespace android
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Develop time of a 12 MP RAW16 test chart with each defect correction
+// mode, on one thread so the modes compare per core.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "EmulatedIsp.h"
+#include "EmulatedPixelDefects.h"
+
+namespace android {
+namespace {
+
+constexpr uint32_t kWidth = 4000;
+constexpr uint32_t kHeight = 3000;
+constexpr uint32_t kBlackLevel = 64;
+constexpr uint32_t kWhiteLevel = 1023 - kBlackLevel;
+
+// Gray patches with a smooth gradient and the defects of a camera.
+std::vector<uint16_t> GetTestChart() {
+  std::vector<uint16_t> raw(kWidth * kHeight);
+  for (uint32_t y = 0; y < kHeight; y++) {
+    for (uint32_t x = 0; x < kWidth; x++) {
+      float patch = ((x / 250) + (y / 250)) % 6 / 6.f;
+      float gradient = 0.2f * std::sin(x * 0.01f) * std::cos(y * 0.01f);
+      float value = std::clamp(patch + gradient, 0.f, 1.f);
+      raw[y * kWidth + x] =
+          static_cast<uint16_t>(kBlackLevel + value * kWhiteLevel);
+    }
+  }
+
+  auto defects = EmulatedPixelDefects::Create(kWidth, kHeight, /*seed=*/0);
+  if (defects != nullptr) {
+    for (const auto& defect :
+         *defects->GetDefects(kWidth, kHeight, /*zoom_ratio=*/1.f)) {
+      raw[defect.y * kWidth + defect.x] =
+          defect.hot ? kBlackLevel + kWhiteLevel : kBlackLevel;
+    }
+  }
+  return raw;
+}
+
+void BM_ProcessRAW16(benchmark::State& state) {
+  auto isp = EmulatedIsp::Create(/*num_threads=*/1);
+  if (isp == nullptr) {
+    state.SkipWithError("Failed to create the ISP");
+    return;
+  }
+
+  static const std::vector<uint16_t> raw = GetTestChart();
+  std::vector<uint8_t> yuv(kWidth * kHeight * 3 / 2);
+  YCbCrPlanes output{.img_y = yuv.data(),
+                     .img_cb = yuv.data() + kWidth * kHeight,
+                     .img_cr = yuv.data() + kWidth * kHeight * 5 / 4,
+                     .y_stride = kWidth,
+                     .cbcr_stride = kWidth / 2,
+                     .cbcr_step = 1};
+  EmulatedIsp::Params params;
+  for (auto& black_level : params.black_level) {
+    black_level = kBlackLevel;
+  }
+  params.white_level = kWhiteLevel;
+  params.defect_correction =
+      static_cast<EmulatedIsp::DefectCorrection>(state.range(0));
+
+  for (auto _ : state) {
+    if (isp->ProcessRAW16(raw.data(), kWidth * sizeof(uint16_t), kWidth,
+                          kHeight, params, output) != OK) {
+      state.SkipWithError("Failed to develop the image");
+      return;
+    }
+    benchmark::DoNotOptimize(yuv.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kWidth * kHeight);
+}
+
+BENCHMARK(BM_ProcessRAW16)
+    ->ArgName("defect_correction")
+    ->Arg(static_cast<int64_t>(EmulatedIsp::DefectCorrection::kOff))
+    ->Arg(static_cast<int64_t>(EmulatedIsp::DefectCorrection::kFast))
+    ->Arg(static_cast<int64_t>(EmulatedIsp::DefectCorrection::kHighQuality))
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EmulatedIspTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include <array>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "EmulatedIsp.h"
+
+namespace android {
+
+using DefectCorrection = EmulatedIsp::DefectCorrection;
+
+static constexpr uint32_t kBlackLevel = 64;
+static constexpr uint32_t kWhiteLevel = 1023 - kBlackLevel;
+
+// A YUV420 image backed by its own memory.
+struct YuvImage {
+  YuvImage(uint32_t width, uint32_t height)
+      : width(width), height(height), data(width * height * 3 / 2) {
+    planes = {.img_y = data.data(),
+              .img_cb = data.data() + width * height,
+              .img_cr = data.data() + width * height * 5 / 4,
+              .y_stride = width,
+              .cbcr_stride = width / 2,
+              .cbcr_step = 1};
+  }
+
+  uint8_t GetY(uint32_t x, uint32_t y) const {
+    return data[y * width + x];
+  }
+
+  uint32_t width;
+  uint32_t height;
+  std::vector<uint8_t> data;
+  YCbCrPlanes planes;
+};
+
+static EmulatedIsp::Params GetParams(DefectCorrection defect_correction) {
+  EmulatedIsp::Params params;
+  for (auto& black_level : params.black_level) {
+    black_level = kBlackLevel;
+  }
+  params.white_level = kWhiteLevel;
+  params.defect_correction = defect_correction;
+  return params;
+}
+
+// RGGB image sampling color(x, y), which returns the R, G and B reflectance
+// of a pixel.
+static std::vector<uint16_t> GetBayerImage(
+    uint32_t width, uint32_t height,
+    std::function<std::array<float, 3>(uint32_t, uint32_t)> color) {
+  std::vector<uint16_t> raw(width * height);
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t x = 0; x < width; x++) {
+      // R at even rows and columns, B at odd ones, G elsewhere.
+      size_t channel = (y % 2) + (x % 2);
+      raw[y * width + x] = static_cast<uint16_t>(
+          kBlackLevel + color(x, y)[channel] * kWhiteLevel + 0.5f);
+    }
+  }
+  return raw;
+}
+
+TEST(EmulatedIspTests, DemosaicFlatColors) {
+  auto isp = EmulatedIsp::Create(/*num_threads=*/1);
+  ASSERT_NE(isp, nullptr);
+
+  constexpr uint32_t kWidth = 32;
+  constexpr uint32_t kHeight = 16;
+  struct {
+    std::array<float, 3> rgb;
+    int32_t cb_sign;
+    int32_t cr_sign;
+  } const fields[] = {{{0.25f, 0.25f, 0.25f}, 0, 0},
+                      {{0.5f, 0.2f, 0.1f}, -1, 1},
+                      {{0.1f, 0.2f, 0.5f}, 1, -1}};
+  for (const auto& field : fields) {
+    auto raw = GetBayerImage(kWidth, kHeight, [&field](uint32_t, uint32_t) {
+      return field.rgb;
+    });
+    YuvImage image(kWidth, kHeight);
+    ASSERT_EQ(isp->ProcessRAW16(raw.data(), kWidth * sizeof(uint16_t), kWidth,
+                                kHeight, GetParams(DefectCorrection::kOff),
+                                image.planes),
+              OK);
+
+    // Every pixel gets the color of the field back.
+    const size_t luma_size = kWidth * kHeight;
+    for (size_t i = 1; i < luma_size; i++) {
+      ASSERT_EQ(image.data[i], image.data[0]) << i;
+    }
+    const uint8_t cb = image.data[luma_size];
+    const uint8_t cr = image.data[luma_size * 5 / 4];
+    for (size_t i = 0; i < luma_size / 4; i++) {
+      ASSERT_EQ(image.data[luma_size + i], cb) << i;
+      ASSERT_EQ(image.data[luma_size * 5 / 4 + i], cr) << i;
+    }
+    EXPECT_EQ(field.cb_sign, (cb > 128) - (cb < 128));
+    EXPECT_EQ(field.cr_sign, (cr > 128) - (cr < 128));
+  }
+}
+
+TEST(EmulatedIspTests, DemosaicEdgeWithoutFringes) {
+  auto isp = EmulatedIsp::Create(/*num_threads=*/1);
+  ASSERT_NE(isp, nullptr);
+
+  // Gray vertical and horizontal edges, starting at an odd column and row.
+  constexpr uint32_t kWidth = 32;
+  constexpr uint32_t kHeight = 16;
+  constexpr uint32_t kEdge = 9;
+  for (bool vertical : {true, false}) {
+    auto gray = [vertical](uint32_t x, uint32_t y) {
+      float value = (vertical ? x : y) < kEdge ? 0.1f : 0.6f;
+      return std::array<float, 3>{value, value, value};
+    };
+    auto raw = GetBayerImage(kWidth, kHeight, gray);
+    YuvImage image(kWidth, kHeight);
+    ASSERT_EQ(isp->ProcessRAW16(raw.data(), kWidth * sizeof(uint16_t), kWidth,
+                                kHeight, GetParams(DefectCorrection::kOff),
+                                image.planes),
+              OK);
+
+    // The interpolation follows the edge, so both sides keep their level
+    // up to the edge and there are no false colors.
+    const uint8_t dark = image.GetY(0, 0);
+    const uint8_t bright = image.GetY(kWidth - 1, kHeight - 1);
+    EXPECT_LT(dark, bright);
+    for (uint32_t y = 0; y < kHeight; y++) {
+      for (uint32_t x = 0; x < kWidth; x++) {
+        ASSERT_EQ(image.GetY(x, y), (vertical ? x : y) < kEdge ? dark : bright)
+            << x << "x" << y;
+      }
+    }
+    const size_t luma_size = kWidth * kHeight;
+    for (size_t i = luma_size; i < image.data.size(); i++) {
+      ASSERT_NEAR(image.data[i], 128, 1) << i;
+    }
+  }
+}
+
+TEST(EmulatedIspTests, WorkersMatchSingleThread) {
+  auto single = EmulatedIsp::Create(/*num_threads=*/1);
+  auto multi = EmulatedIsp::Create(/*num_threads=*/4);
+  ASSERT_NE(single, nullptr);
+  ASSERT_NE(multi, nullptr);
+  EXPECT_EQ(multi->GetNumThreads(), 4u);
+
+  // Enough rows for several strips per worker.
+  constexpr uint32_t kWidth = 64;
+  constexpr uint32_t kHeight = 300;
+  std::minstd_rand random(1);
+  std::vector<uint16_t> raw(kWidth * kHeight);
+  for (auto& value : raw) {
+    value = kBlackLevel + random() % kWhiteLevel;
+  }
+  YuvImage expected(kWidth, kHeight);
+  auto params = GetParams(DefectCorrection::kHighQuality);
+  ASSERT_EQ(single->ProcessRAW16(raw.data(), kWidth * sizeof(uint16_t), kWidth,
+                                 kHeight, params, expected.planes),
+            OK);
+
+  // The workers are kept between images.
+  for (int i = 0; i < 3; i++) {
+    YuvImage image(kWidth, kHeight);
+    ASSERT_EQ(multi->ProcessRAW16(raw.data(), kWidth * sizeof(uint16_t),
+                                  kWidth, kHeight, params, image.planes),
+              OK);
+    EXPECT_EQ(image.data, expected.data);
+  }
+}
+
+TEST(EmulatedIspTests, CorrectDefectsOnBorders) {
+  auto isp = EmulatedIsp::Create(/*num_threads=*/1);
+  ASSERT_NE(isp, nullptr);
+
+  // Hot pixels on the second and next to last rows and columns, where the
+  // mirrored neighbor of the same color is the pixel itself, and in the
+  // corners.
+  constexpr uint32_t kWidth = 16;
+  constexpr uint32_t kHeight = 12;
+  const uint32_t defects[][2] = {{1, 5},  {kWidth - 2, 6}, {6, 1},
+                                 {7, kHeight - 2}, {0, 0},
+                                 {kWidth - 1, kHeight - 1}};
+  std::vector<uint16_t> flat(kWidth * kHeight, kBlackLevel + kWhiteLevel / 4);
+  std::vector<uint16_t> raw = flat;
+  for (const auto& defect : defects) {
+    raw[defect[1] * kWidth + defect[0]] = kBlackLevel + kWhiteLevel;
+  }
+
+  YuvImage expected(kWidth, kHeight);
+  ASSERT_EQ(isp->ProcessRAW16(flat.data(), kWidth * sizeof(uint16_t), kWidth,
+                              kHeight, GetParams(DefectCorrection::kOff),
+                              expected.planes),
+            OK);
+  YuvImage uncorrected(kWidth, kHeight);
+  ASSERT_EQ(isp->ProcessRAW16(raw.data(), kWidth * sizeof(uint16_t), kWidth,
+                              kHeight, GetParams(DefectCorrection::kOff),
+                              uncorrected.planes),
+            OK);
+  for (const auto& defect : defects) {
+    EXPECT_NE(uncorrected.GetY(defect[0], defect[1]),
+              expected.GetY(defect[0], defect[1]));
+  }
+
+  for (auto mode : {DefectCorrection::kFast, DefectCorrection::kHighQuality}) {
+    YuvImage corrected(kWidth, kHeight);
+    ASSERT_EQ(isp->ProcessRAW16(raw.data(), kWidth * sizeof(uint16_t), kWidth,
+                                kHeight, GetParams(mode), corrected.planes),
+              OK);
+    EXPECT_EQ(corrected.data, expected.data);
+  }
+}
+
+TEST(EmulatedIspTests, CorrectLumaDefects) {
+  constexpr uint32_t kWidth = 8;
+  constexpr uint32_t kHeight = 6;
+  YuvImage image(kWidth, kHeight);
+  const uint32_t defects[][2] = {{0, 3}, {kWidth - 1, 2}, {3, 0},
+                                 {4, kHeight - 1}, {2, 2}};
+  std::fill(image.data.begin(), image.data.end(), 128);
+  for (const auto& defect : defects) {
+    image.data[defect[1] * kWidth + defect[0]] = defect[0] == 2 ? 0 : 255;
+  }
+  std::vector<uint8_t> defective = image.data;
+
+  EXPECT_EQ(EmulatedIsp::CorrectLumaDefects(image.planes, kWidth, kHeight,
+                                            DefectCorrection::kOff),
+            OK);
+  EXPECT_EQ(image.data, defective);
+
+  for (auto mode : {DefectCorrection::kFast, DefectCorrection::kHighQuality}) {
+    image.data = defective;
+    ASSERT_EQ(
+        EmulatedIsp::CorrectLumaDefects(image.planes, kWidth, kHeight, mode),
+        OK);
+    for (uint32_t y = 0; y < kHeight; y++) {
+      for (uint32_t x = 0; x < kWidth; x++) {
+        ASSERT_EQ(image.GetY(x, y), 128) << x << "x" << y;
+      }
+    }
+  }
+
+  // Ramps are within the range of the neighbors and stay untouched.
+  for (uint32_t y = 0; y < kHeight; y++) {
+    for (uint32_t x = 0; x < kWidth; x++) {
+      image.data[y * kWidth + x] = x * 20 + y * 5;
+    }
+  }
+  std::vector<uint8_t> ramp = image.data;
+  ASSERT_EQ(EmulatedIsp::CorrectLumaDefects(image.planes, kWidth, kHeight,
+                                            DefectCorrection::kHighQuality),
+            OK);
+  EXPECT_EQ(image.data, ramp);
+
+  EXPECT_NE(EmulatedIsp::CorrectLumaDefects(image.planes, 1, kHeight,
+                                            DefectCorrection::kFast),
+            OK);
+}
+
+}  // namespace android
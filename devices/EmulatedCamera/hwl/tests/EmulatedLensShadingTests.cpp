@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EmulatedLensShadingTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include <vector>
+
+#include "EmulatedLensShading.h"
+
+namespace android {
+
+// 4.38 mm lens over a 4:3 sensor of 5.6 x 4.2 mm
+static constexpr float kFocalLength = 4.38f;
+static constexpr float kPhysicalSize[2] = {5.6f, 4.2f};
+// Odd, so that the map has a sample on the optical center.
+static constexpr uint32_t kMapWidth = 17;
+static constexpr uint32_t kMapHeight = 13;
+
+static float GetGain(const std::vector<float>& map, uint32_t x, uint32_t y,
+                     uint32_t channel) {
+  return map[(y * kMapWidth + x) * 4 + channel];
+}
+
+TEST(EmulatedLensShadingTests, InvalidMapSize) {
+  EXPECT_EQ(EmulatedLensShading::Create(kFocalLength, kPhysicalSize, 1, 1),
+            nullptr);
+  EXPECT_EQ(EmulatedLensShading::Create(kFocalLength, kPhysicalSize, 0, 8),
+            nullptr);
+  const float unknown_size[2] = {0, 0};
+  EXPECT_NE(EmulatedLensShading::Create(0, unknown_size, 2, 2), nullptr);
+}
+
+TEST(EmulatedLensShadingTests, Map) {
+  auto lens_shading = EmulatedLensShading::Create(kFocalLength, kPhysicalSize,
+                                                  kMapWidth, kMapHeight);
+  ASSERT_NE(lens_shading, nullptr);
+  EXPECT_EQ(lens_shading->GetMapWidth(), kMapWidth);
+  EXPECT_EQ(lens_shading->GetMapHeight(), kMapHeight);
+  auto map = lens_shading->GetMap(/*zoom_ratio=*/1.f);
+  ASSERT_NE(map, nullptr);
+  ASSERT_EQ(map->size(), kMapWidth * kMapHeight * 4);
+
+  // No correction on the optical center, growing gains towards the corners.
+  const uint32_t center_x = kMapWidth / 2;
+  const uint32_t center_y = kMapHeight / 2;
+  for (uint32_t c = 0; c < 4; c++) {
+    EXPECT_FLOAT_EQ(GetGain(*map, center_x, center_y, c), 1.f);
+    for (uint32_t x = center_x + 1; x < kMapWidth; x++) {
+      EXPECT_GT(GetGain(*map, x, center_y, c),
+                GetGain(*map, x - 1, center_y, c));
+    }
+    for (uint32_t y = center_y + 1; y < kMapHeight; y++) {
+      EXPECT_GT(GetGain(*map, center_x, y, c),
+                GetGain(*map, center_x, y - 1, c));
+    }
+  }
+  for (float gain : *map) {
+    EXPECT_GE(gain, 1.f);
+  }
+
+  // Symmetric around the center.
+  for (uint32_t y = 0; y < kMapHeight; y++) {
+    for (uint32_t x = 0; x < kMapWidth; x++) {
+      for (uint32_t c = 0; c < 4; c++) {
+        EXPECT_FLOAT_EQ(
+            GetGain(*map, x, y, c),
+            GetGain(*map, kMapWidth - 1 - x, kMapHeight - 1 - y, c));
+      }
+    }
+  }
+
+  // Red and blue fall off faster than green, and the map is the inverse of
+  // the relative illumination.
+  float corner_gains[4];
+  for (uint32_t c = 0; c < 4; c++) {
+    corner_gains[c] = GetGain(*map, 0, 0, c);
+  }
+  EXPECT_GT(corner_gains[0], corner_gains[3]);
+  EXPECT_GT(corner_gains[3], corner_gains[1]);
+  EXPECT_FLOAT_EQ(corner_gains[1], corner_gains[2]);
+  const float half_width = kPhysicalSize[0] / (2 * kFocalLength);
+  const float half_height = kPhysicalSize[1] / (2 * kFocalLength);
+  const float corner_r2 = half_width * half_width + half_height * half_height;
+  for (uint32_t c = 0; c < 4; c++) {
+    EXPECT_FLOAT_EQ(corner_gains[c],
+                    1.f / lens_shading->GetIllumination(c, corner_r2));
+  }
+}
+
+TEST(EmulatedLensShadingTests, ZoomedMap) {
+  auto lens_shading = EmulatedLensShading::Create(kFocalLength, kPhysicalSize,
+                                                  kMapWidth, kMapHeight);
+  ASSERT_NE(lens_shading, nullptr);
+  auto full = lens_shading->GetMap(/*zoom_ratio=*/1.f);
+  auto zoomed = lens_shading->GetMap(/*zoom_ratio=*/2.f);
+  ASSERT_NE(full, nullptr);
+  ASSERT_NE(zoomed, nullptr);
+  EXPECT_NE(full, zoomed);
+
+  // The corners at 2x zoom are halfway between the center and the corners
+  // of the full array.
+  for (uint32_t c = 0; c < 4; c++) {
+    EXPECT_FLOAT_EQ(GetGain(*zoomed, 0, 0, c),
+                    GetGain(*full, kMapWidth / 4, kMapHeight / 4, c));
+    EXPECT_FLOAT_EQ(
+        GetGain(*zoomed, kMapWidth - 1, kMapHeight - 1, c),
+        GetGain(*full, kMapWidth - 1 - kMapWidth / 4,
+                kMapHeight - 1 - kMapHeight / 4, c));
+  }
+}
+
+TEST(EmulatedLensShadingTests, CachedAcrossZoomRatios) {
+  auto lens_shading = EmulatedLensShading::Create(kFocalLength, kPhysicalSize,
+                                                  kMapWidth, kMapHeight);
+  ASSERT_NE(lens_shading, nullptr);
+  auto map = lens_shading->GetMap(/*zoom_ratio=*/1.f);
+  auto falloff = lens_shading->GetFalloff(640, 480, /*zoom_ratio=*/1.f);
+  ASSERT_NE(map, nullptr);
+  ASSERT_NE(falloff, nullptr);
+  EXPECT_EQ(lens_shading->GetMap(/*zoom_ratio=*/1.f), map);
+  EXPECT_EQ(lens_shading->GetFalloff(640, 480, /*zoom_ratio=*/1.f), falloff);
+  EXPECT_NE(lens_shading->GetFalloff(320, 240, /*zoom_ratio=*/1.f), falloff);
+  const std::vector<float> map_copy = *map;
+  const std::vector<float> column_r2 = falloff->column_r2;
+
+  // Smooth zoom drops the first tables from the cache, but the held ones stay
+  // valid and unchanged.
+  for (uint32_t i = 1; i <= 32; i++) {
+    float zoom_ratio = 1.f + i * 0.25f;
+    auto zoomed_map = lens_shading->GetMap(zoom_ratio);
+    auto zoomed_falloff = lens_shading->GetFalloff(640, 480, zoom_ratio);
+    ASSERT_NE(zoomed_map, nullptr);
+    ASSERT_NE(zoomed_falloff, nullptr);
+    EXPECT_LT(zoomed_map->back(), map->back());
+    EXPECT_LT(zoomed_falloff->column_r2.front(), falloff->column_r2.front());
+  }
+  EXPECT_EQ(*map, map_copy);
+  EXPECT_EQ(falloff->column_r2, column_r2);
+
+  // Dropped tables are computed again with the same values.
+  auto new_map = lens_shading->GetMap(/*zoom_ratio=*/1.f);
+  auto new_falloff = lens_shading->GetFalloff(640, 480, /*zoom_ratio=*/1.f);
+  EXPECT_NE(new_map, map);
+  EXPECT_EQ(*new_map, map_copy);
+  EXPECT_NE(new_falloff, falloff);
+  EXPECT_EQ(new_falloff->column_r2, column_r2);
+}
+
+TEST(EmulatedLensShadingTests, Falloff) {
+  auto lens_shading = EmulatedLensShading::Create(kFocalLength, kPhysicalSize,
+                                                  kMapWidth, kMapHeight);
+  ASSERT_NE(lens_shading, nullptr);
+  auto falloff = lens_shading->GetFalloff(640, 480, /*zoom_ratio=*/1.f);
+  ASSERT_NE(falloff, nullptr);
+  ASSERT_EQ(falloff->column_r2.size(), 640u);
+  ASSERT_EQ(falloff->row_r2.size(), 480u);
+
+  // Distances are measured at the pixel centers, symmetric around the
+  // optical center.
+  for (uint32_t x = 0; x < 320; x++) {
+    EXPECT_NEAR(falloff->column_r2[x], falloff->column_r2[639 - x], 1e-6f);
+  }
+  for (uint32_t y = 0; y < 240; y++) {
+    EXPECT_NEAR(falloff->row_r2[y], falloff->row_r2[479 - y], 1e-6f);
+  }
+  EXPECT_LT(falloff->column_r2[320], 1e-4f);
+  EXPECT_LT(falloff->row_r2[240], 1e-4f);
+
+  // The render attenuation is corrected by the map at the center and close
+  // to the corners.
+  auto map = lens_shading->GetMap(/*zoom_ratio=*/1.f);
+  ASSERT_NE(map, nullptr);
+  for (uint32_t c = 0; c < 4; c++) {
+    float center = lens_shading->GetIllumination(
+        c, falloff->column_r2[320] + falloff->row_r2[240]);
+    EXPECT_NEAR(center * GetGain(*map, kMapWidth / 2, kMapHeight / 2, c), 1.f,
+                1e-3f);
+    float corner = lens_shading->GetIllumination(
+        c, falloff->column_r2[0] + falloff->row_r2[0]);
+    EXPECT_NEAR(corner * GetGain(*map, 0, 0, c), 1.f, 1e-2f);
+  }
+}
+
+}  // namespace android
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EmulatedPixelDefectsTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include <tuple>
+
+#include "EmulatedPixelDefects.h"
+
+namespace android {
+
+using Defect = EmulatedPixelDefects::Defect;
+
+TEST(EmulatedPixelDefectsTests, SameDefectsForSeed) {
+  EXPECT_EQ(EmulatedPixelDefects::Create(8, 8, /*seed=*/0), nullptr);
+
+  auto defects = EmulatedPixelDefects::Create(4000, 3000, /*seed=*/1);
+  auto other = EmulatedPixelDefects::Create(4000, 3000, /*seed=*/1);
+  ASSERT_NE(defects, nullptr);
+  ASSERT_NE(other, nullptr);
+  EXPECT_FALSE(defects->GetHotPixelMap().empty());
+  EXPECT_EQ(defects->GetHotPixelMap(), other->GetHotPixelMap());
+}
+
+TEST(EmulatedPixelDefectsTests, ImageDefects) {
+  auto defects = EmulatedPixelDefects::Create(4000, 3000, /*seed=*/1);
+  ASSERT_NE(defects, nullptr);
+  const auto& hot_pixel_map = defects->GetHotPixelMap();
+
+  // Every defect at full size, sorted by row and column.
+  auto full = defects->GetDefects(4000, 3000, /*zoom_ratio=*/1.f);
+  ASSERT_EQ(full->size() * 2, hot_pixel_map.size());
+  for (size_t i = 1; i < full->size(); i++) {
+    EXPECT_LT(std::tie((*full)[i - 1].y, (*full)[i - 1].x),
+              std::tie((*full)[i].y, (*full)[i].x));
+  }
+
+  // Only the center is seen at 2x zoom.
+  auto zoomed = defects->GetDefects(2000, 1500, /*zoom_ratio=*/2.f);
+  EXPECT_LT(zoomed->size(), full->size());
+  for (const auto& defect : *zoomed) {
+    EXPECT_LT(defect.x, 2000u);
+    EXPECT_LT(defect.y, 1500u);
+  }
+}
+
+TEST(EmulatedPixelDefectsTests, TablesOutliveCache) {
+  auto defects = EmulatedPixelDefects::Create(4000, 3000, /*seed=*/1);
+  ASSERT_NE(defects, nullptr);
+
+  auto table = defects->GetDefects(1920, 1080, /*zoom_ratio=*/1.f);
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(defects->GetDefects(1920, 1080, /*zoom_ratio=*/1.f), table);
+  const std::vector<Defect> copy = *table;
+
+  // Enough other sizes to drop the cached tables.
+  for (uint32_t i = 1; i <= 16; i++) {
+    defects->GetDefects(1920, 1080, /*zoom_ratio=*/1.f + i * 0.25f);
+  }
+  ASSERT_EQ(table->size(), copy.size());
+  for (size_t i = 0; i < copy.size(); i++) {
+    EXPECT_EQ((*table)[i].x, copy[i].x);
+    EXPECT_EQ((*table)[i].y, copy[i].y);
+    EXPECT_EQ((*table)[i].hot, copy[i].hot);
+  }
+}
+
+}  // namespace android
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EmulatedRenderPoolTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "EmulatedRenderPool.h"
+
+namespace android {
+
+using google_camera_hal::ThreadRole;
+
+// Blocks the threads that wait on it until it is opened.
+class Gate {
+ public:
+  void Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = true;
+    condition_.notify_all();
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return open_; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool open_ = false;
+};
+
+// Occupy the only worker of pool with a task of client until release opens.
+static void BlockWorker(EmulatedRenderPool* pool, uint32_t client,
+                        Gate* release) {
+  Gate started;
+  ASSERT_EQ(pool->Queue(client, /*deadline=*/0,
+                        [&started, release] {
+                          started.Open();
+                          release->Wait();
+                        }),
+            OK);
+  started.Wait();
+}
+
+TEST(EmulatedRenderPoolTests, Create) {
+  EXPECT_EQ(EmulatedRenderPool::Create(0, ThreadRole::kRender, "Test"),
+            nullptr);
+  auto pool = EmulatedRenderPool::Create(2, ThreadRole::kRender, "Test");
+  ASSERT_NE(pool, nullptr);
+  EXPECT_EQ(pool->GetThreadCount(), 2u);
+  EXPECT_NE(pool->AddClient("Client"), EmulatedRenderPool::kInvalidClient);
+  EXPECT_NE(pool->Queue(EmulatedRenderPool::kInvalidClient, 0, [] {}), OK);
+  EXPECT_NE(pool->RunAndWait(EmulatedRenderPool::kInvalidClient, 0, [] {}),
+            OK);
+}
+
+TEST(EmulatedRenderPoolTests, EarliestDeadlineFirst) {
+  auto pool = EmulatedRenderPool::Create(1, ThreadRole::kRender, "Test");
+  ASSERT_NE(pool, nullptr);
+  uint32_t blocker = pool->AddClient("Blocker");
+  Gate release;
+  BlockWorker(pool.get(), blocker, &release);
+
+  // Clients and deadlines of the queued tasks, the ties run in queue order.
+  const nsecs_t deadlines[] = {300, 100, 200, 100};
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<uint32_t> order;
+  for (uint32_t i = 0; i < std::size(deadlines); i++) {
+    uint32_t client = pool->AddClient("Client " + std::to_string(i));
+    ASSERT_EQ(pool->Queue(client, deadlines[i],
+                          [&, i] {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            order.push_back(i);
+                            condition.notify_one();
+                          }),
+              OK);
+  }
+  release.Open();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  condition.wait(lock, [&] { return order.size() == std::size(deadlines); });
+  EXPECT_EQ(order, std::vector<uint32_t>({1, 3, 2, 0}));
+}
+
+TEST(EmulatedRenderPoolTests, ClientTasksRunInOrder) {
+  auto pool = EmulatedRenderPool::Create(4, ThreadRole::kRender, "Test");
+  ASSERT_NE(pool, nullptr);
+  uint32_t client = pool->AddClient("Client");
+
+  // Later tasks are due first, but a client's tasks still run one at a time
+  // in the order they were queued.
+  constexpr uint32_t kNumTasks = 100;
+  std::atomic_bool running = false;
+  std::atomic_uint32_t overlaps = 0;
+  std::vector<uint32_t> order;
+  for (uint32_t i = 0; i < kNumTasks; i++) {
+    ASSERT_EQ(pool->Queue(client, kNumTasks - i,
+                          [&, i] {
+                            if (running.exchange(true)) {
+                              overlaps++;
+                            }
+                            order.push_back(i);
+                            std::this_thread::yield();
+                            running = false;
+                          }),
+              OK);
+  }
+  // Queued behind the others, so it returns after all of them ran.
+  ASSERT_EQ(pool->RunAndWait(client, 0, [] {}), OK);
+
+  EXPECT_EQ(overlaps, 0u);
+  ASSERT_EQ(order.size(), kNumTasks);
+  for (uint32_t i = 0; i < kNumTasks; i++) {
+    EXPECT_EQ(order[i], i);
+  }
+  EmulatedRenderPool::Stats stats;
+  ASSERT_EQ(pool->GetStats(client, &stats), OK);
+  EXPECT_EQ(stats.tasks, kNumTasks + 1);
+}
+
+TEST(EmulatedRenderPoolTests, RemoveClientDropsTasks) {
+  auto pool = EmulatedRenderPool::Create(1, ThreadRole::kRender, "Test");
+  ASSERT_NE(pool, nullptr);
+  uint32_t blocker = pool->AddClient("Blocker");
+  uint32_t client = pool->AddClient("Client");
+  Gate release;
+  BlockWorker(pool.get(), blocker, &release);
+
+  std::atomic_uint32_t ran = 0;
+  for (uint32_t i = 0; i < 3; i++) {
+    ASSERT_EQ(pool->Queue(client, 0, [&ran] { ran++; }), OK);
+  }
+  pool->RemoveClient(client);
+  release.Open();
+  // The pool is idle once a task of another client ran.
+  ASSERT_EQ(pool->RunAndWait(blocker, 0, [] {}), OK);
+
+  EXPECT_EQ(ran, 0u);
+  EXPECT_NE(pool->Queue(client, 0, [&ran] { ran++; }), OK);
+  EmulatedRenderPool::Stats stats;
+  EXPECT_NE(pool->GetStats(client, &stats), OK);
+}
+
+TEST(EmulatedRenderPoolTests, RunAndWaitOnFreeCaller) {
+  auto pool = EmulatedRenderPool::Create(1, ThreadRole::kRender, "Test");
+  ASSERT_NE(pool, nullptr);
+  uint32_t client = pool->AddClient("Client");
+
+  // An idle pool runs the task on the calling thread.
+  std::thread::id task_thread;
+  ASSERT_EQ(pool->RunAndWait(
+                client, 0, [&] { task_thread = std::this_thread::get_id(); }),
+            OK);
+  EXPECT_EQ(task_thread, std::this_thread::get_id());
+
+  // A busy pool runs no more tasks than it has workers, not even on the
+  // calling thread.
+  uint32_t blocker = pool->AddClient("Blocker");
+  Gate release;
+  BlockWorker(pool.get(), blocker, &release);
+  std::atomic_bool ran = false;
+  std::thread caller([&] {
+    EXPECT_EQ(pool->RunAndWait(client, 0, [&ran] { ran = true; }), OK);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_FALSE(ran);
+  release.Open();
+  caller.join();
+  EXPECT_TRUE(ran);
+}
+
+}  // namespace android
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EmulatedSceneTextureTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <string>
+
+#include "EmulatedSceneTexture.h"
+
+namespace android {
+
+using Pattern = EmulatedSceneTexture::Pattern;
+
+static uint16_t GetTexel(const EmulatedSceneTexture& texture, size_t level,
+                         EmulatedSceneTexture::Channel channel, uint32_t x,
+                         uint32_t y) {
+  const auto& l = texture.GetLevel(level);
+  return l.planes[channel][static_cast<size_t>(y) * l.width + x];
+}
+
+static uint16_t ToTexel(float reflectance) {
+  return static_cast<uint16_t>(reflectance * EmulatedSceneTexture::kMaxValue +
+                               0.5f);
+}
+
+TEST(EmulatedSceneTextureTests, GenerateLevels) {
+  EXPECT_EQ(EmulatedSceneTexture::Generate(Pattern::kTestChart, 0, 480),
+            nullptr);
+
+  auto texture = EmulatedSceneTexture::Generate(Pattern::kTestChart, 640, 480);
+  ASSERT_NE(texture, nullptr);
+  // Levels down to 20x15, the next one would be smaller than 16 texels.
+  ASSERT_EQ(texture->GetNumLevels(), 5u);
+  for (size_t level = 0; level < texture->GetNumLevels(); level++) {
+    EXPECT_EQ(texture->GetLevel(level).width, 640u >> level);
+    EXPECT_EQ(texture->GetLevel(level).height, 480u >> level);
+  }
+
+  // Every texel of a level is the rounded mean of 2x2 texels of the previous
+  // one.
+  for (size_t level = 1; level < texture->GetNumLevels(); level++) {
+    const auto& l = texture->GetLevel(level);
+    for (uint32_t c = 0; c < EmulatedSceneTexture::kNumChannels; c++) {
+      auto channel = static_cast<EmulatedSceneTexture::Channel>(c);
+      for (uint32_t y = 0; y < l.height; y += 7) {
+        for (uint32_t x = 0; x < l.width; x += 5) {
+          uint32_t sum = GetTexel(*texture, level - 1, channel, 2 * x, 2 * y) +
+                         GetTexel(*texture, level - 1, channel, 2 * x + 1,
+                                  2 * y) +
+                         GetTexel(*texture, level - 1, channel, 2 * x,
+                                  2 * y + 1) +
+                         GetTexel(*texture, level - 1, channel, 2 * x + 1,
+                                  2 * y + 1);
+          ASSERT_EQ(GetTexel(*texture, level, channel, x, y), (sum + 2) / 4);
+        }
+      }
+    }
+  }
+}
+
+TEST(EmulatedSceneTextureTests, TestChart) {
+  auto texture = EmulatedSceneTexture::Generate(Pattern::kTestChart, 640, 480);
+  ASSERT_NE(texture, nullptr);
+
+  // The chart starts at (22.4, 57.6) with 48 texel patches. The first patch
+  // is dark skin, followed by a dark gap.
+  EXPECT_EQ(GetTexel(*texture, 0, EmulatedSceneTexture::kRed, 42, 77),
+            ToTexel(0.171f));
+  EXPECT_EQ(GetTexel(*texture, 0, EmulatedSceneTexture::kGreen, 42, 77),
+            ToTexel(0.084f));
+  EXPECT_EQ(GetTexel(*texture, 0, EmulatedSceneTexture::kBlue, 42, 77),
+            ToTexel(0.057f));
+  for (uint32_t c = 0; c < EmulatedSceneTexture::kNumChannels; c++) {
+    auto channel = static_cast<EmulatedSceneTexture::Channel>(c);
+    EXPECT_EQ(GetTexel(*texture, 0, channel, 66, 77), ToTexel(0.03f));
+    // Middle gray background.
+    EXPECT_EQ(GetTexel(*texture, 0, channel, 2, 2), ToTexel(0.18f));
+  }
+
+  // The gray ramp increases from left to right.
+  uint16_t previous = 0;
+  for (uint32_t x = 25; x < 310; x += 15) {
+    uint16_t value = GetTexel(*texture, 0, EmulatedSceneTexture::kGreen, x, 310);
+    EXPECT_GT(value, previous);
+    previous = value;
+  }
+}
+
+TEST(EmulatedSceneTextureTests, NaturalImage) {
+  auto texture =
+      EmulatedSceneTexture::Generate(Pattern::kNaturalImage, 256, 128);
+  auto other = EmulatedSceneTexture::Generate(Pattern::kNaturalImage, 256, 128);
+  ASSERT_NE(texture, nullptr);
+  ASSERT_NE(other, nullptr);
+
+  // Deterministic, with log-normal reflectances around middle gray.
+  const auto& level = texture->GetLevel(0);
+  size_t count = level.width * level.height;
+  double sum = 0;
+  uint16_t min_value = EmulatedSceneTexture::kMaxValue;
+  uint16_t max_value = 0;
+  for (uint32_t c = 0; c < EmulatedSceneTexture::kNumChannels; c++) {
+    ASSERT_EQ(memcmp(level.planes[c], other->GetLevel(0).planes[c],
+                     count * sizeof(uint16_t)),
+              0);
+  }
+  for (size_t i = 0; i < count; i++) {
+    uint16_t value = level.planes[EmulatedSceneTexture::kGreen][i];
+    sum += value;
+    min_value = std::min(min_value, value);
+    max_value = std::max(max_value, value);
+  }
+  double mean = sum / count / EmulatedSceneTexture::kMaxValue;
+  EXPECT_GT(mean, 0.1);
+  EXPECT_LT(mean, 0.4);
+  EXPECT_LT(min_value, ToTexel(0.1f));
+  EXPECT_GT(max_value, ToTexel(0.4f));
+}
+
+TEST(EmulatedSceneTextureTests, SaveAndLoad) {
+  auto texture = EmulatedSceneTexture::Generate(Pattern::kTestChart, 200, 100);
+  ASSERT_NE(texture, nullptr);
+  char path[] = "/tmp/EmulatedSceneTextureTestsXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_EQ(texture->Save(path), OK);
+
+  auto loaded = EmulatedSceneTexture::Load(path);
+  unlink(path);
+  ASSERT_NE(loaded, nullptr);
+  ASSERT_EQ(loaded->GetNumLevels(), texture->GetNumLevels());
+  for (size_t level = 0; level < texture->GetNumLevels(); level++) {
+    const auto& expected = texture->GetLevel(level);
+    const auto& actual = loaded->GetLevel(level);
+    ASSERT_EQ(actual.width, expected.width);
+    ASSERT_EQ(actual.height, expected.height);
+    for (uint32_t c = 0; c < EmulatedSceneTexture::kNumChannels; c++) {
+      EXPECT_EQ(memcmp(actual.planes[c], expected.planes[c],
+                       actual.width * actual.height * sizeof(uint16_t)),
+                0);
+    }
+  }
+
+  EXPECT_EQ(EmulatedSceneTexture::Load("/nonexistent/texture"), nullptr);
+}
+
+TEST(EmulatedSceneTextureTests, SampleLine) {
+  auto texture = EmulatedSceneTexture::Generate(Pattern::kTestChart, 640, 480);
+  ASSERT_NE(texture, nullptr);
+
+  // From the dark skin patch to the left edge, and clamped past it.
+  float r[4], g[4], b[4];
+  texture->SampleLine(0, 42 << 16, 77 << 16, -(21 << 16), 0, 4, r, g, b);
+  const float scale = 1.0f / EmulatedSceneTexture::kMaxValue;
+  EXPECT_FLOAT_EQ(r[0], ToTexel(0.171f) * scale);
+  EXPECT_FLOAT_EQ(g[0], ToTexel(0.084f) * scale);
+  EXPECT_FLOAT_EQ(b[0], ToTexel(0.057f) * scale);
+  EXPECT_FLOAT_EQ(g[2], GetTexel(*texture, 0, EmulatedSceneTexture::kGreen, 0,
+                                 77) * scale);
+  EXPECT_FLOAT_EQ(g[3], g[2]);
+}
+
+TEST(EmulatedSceneTextureTests, CacheSharesTextures) {
+  EmulatedSceneTextureCache cache;
+  auto first = cache.Get("testchart", 320, 240);
+  auto second = cache.Get("testchart", 320, 240);
+  auto other_size = cache.Get("testchart", 160, 120);
+  ASSERT_NE(first.get(), nullptr);
+  EXPECT_EQ(second.get(), first.get());
+  ASSERT_NE(other_size.get(), nullptr);
+  EXPECT_NE(other_size.get(), first.get());
+  EXPECT_EQ(other_size.get()->GetLevel(0).width, 160u);
+  EXPECT_EQ(cache.GetBuildCount(), 2u);
+
+  // A built texture is returned right away.
+  auto cached = cache.Get("testchart", 320, 240);
+  EXPECT_EQ(cached.wait_for(std::chrono::seconds(0)),
+            std::future_status::ready);
+  EXPECT_EQ(cached.get(), first.get());
+  EXPECT_EQ(cache.GetBuildCount(), 2u);
+}
+
+TEST(EmulatedSceneTextureTests, CacheKeepsLastTexture) {
+  EmulatedSceneTextureCache cache;
+  const EmulatedSceneTexture* small = cache.Get("natural", 64, 48).get().get();
+  const EmulatedSceneTexture* large =
+      cache.Get("natural", 128, 96).get().get();
+  ASSERT_NE(small, nullptr);
+  ASSERT_NE(large, nullptr);
+
+  // Nothing else holds the textures, but the last one stays cached.
+  EXPECT_EQ(cache.Get("natural", 128, 96).get().get(), large);
+  EXPECT_EQ(cache.GetBuildCount(), 2u);
+  ASSERT_NE(cache.Get("natural", 64, 48).get(), nullptr);
+  EXPECT_EQ(cache.GetBuildCount(), 3u);
+}
+
+TEST(EmulatedSceneTextureTests, CacheAssets) {
+  auto texture = EmulatedSceneTexture::Generate(Pattern::kTestChart, 64, 32);
+  ASSERT_NE(texture, nullptr);
+  char path[] = "/tmp/EmulatedSceneTextureTestsXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_EQ(texture->Save(path), OK);
+
+  // Assets keep their size for any sensor resolution.
+  EmulatedSceneTextureCache cache;
+  auto asset = cache.Get(path, 640, 480).get();
+  unlink(path);
+  ASSERT_NE(asset, nullptr);
+  EXPECT_EQ(asset->GetLevel(0).width, 64u);
+  EXPECT_EQ(cache.Get(path, 320, 240).get(), asset);
+  EXPECT_EQ(cache.GetBuildCount(), 1u);
+
+  EXPECT_EQ(cache.Get("/nonexistent/texture", 640, 480).get(), nullptr);
+}
+
+}  // namespace android
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EmulatedZoomOverrideTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "EmulatedZoomOverride.h"
+
+namespace android {
+
+// Request settings with the zoom keys, overriding the zoom if override_zoom.
+static std::unique_ptr<HalCameraMetadata> GetSettings(float zoom_ratio,
+                                                      bool override_zoom) {
+  auto settings = HalCameraMetadata::Create(/*entry_capacity=*/8,
+                                            /*data_capacity=*/128);
+  if (settings == nullptr) {
+    return nullptr;
+  }
+
+  int32_t settings_override = override_zoom
+                                  ? ANDROID_CONTROL_SETTINGS_OVERRIDE_ZOOM
+                                  : ANDROID_CONTROL_SETTINGS_OVERRIDE_OFF;
+  int32_t crop_width = static_cast<int32_t>(1000 / zoom_ratio);
+  int32_t crop[4] = {(1000 - crop_width) / 2, (1000 - crop_width) / 2,
+                     crop_width, crop_width};
+  int32_t region[5] = {crop[0], crop[1], crop[0] + crop[2], crop[1] + crop[3],
+                       1};
+  settings->Set(ANDROID_CONTROL_SETTINGS_OVERRIDE, &settings_override, 1);
+  settings->Set(ANDROID_CONTROL_ZOOM_RATIO, &zoom_ratio, 1);
+  settings->Set(ANDROID_SCALER_CROP_REGION, crop, 4);
+  settings->Set(ANDROID_CONTROL_AE_REGIONS, region, 5);
+  settings->Set(ANDROID_CONTROL_AWB_REGIONS, region, 5);
+  settings->Set(ANDROID_CONTROL_AF_REGIONS, region, 5);
+  return settings;
+}
+
+static float GetZoomRatio(const HalCameraMetadata& settings) {
+  camera_metadata_ro_entry_t entry;
+  if ((settings.Get(ANDROID_CONTROL_ZOOM_RATIO, &entry) != OK) ||
+      (entry.count != 1)) {
+    return 0.f;
+  }
+  return entry.data.f[0];
+}
+
+TEST(EmulatedZoomOverrideTests, KeepZoomWithoutOverride) {
+  EmulatedZoomOverride zoom_override;
+  for (uint32_t frame_number = 1; frame_number <= 3; frame_number++) {
+    auto settings = GetSettings(frame_number, /*override_zoom=*/false);
+    ASSERT_NE(settings, nullptr);
+    zoom_override.QueueRequest(frame_number, settings.get());
+  }
+
+  auto settings = GetSettings(1.f, /*override_zoom=*/false);
+  ASSERT_NE(settings, nullptr);
+  EXPECT_EQ(zoom_override.Apply(1, settings.get()), 0u);
+  EXPECT_EQ(GetZoomRatio(*settings), 1.f);
+}
+
+TEST(EmulatedZoomOverrideTests, ApplyZoomTwoFramesAhead) {
+  EmulatedZoomOverride zoom_override;
+  auto settings = GetSettings(1.f, /*override_zoom=*/false);
+  ASSERT_NE(settings, nullptr);
+  zoom_override.QueueRequest(1, settings.get());
+  for (uint32_t frame_number = 2; frame_number <= 4; frame_number++) {
+    auto zoom_settings = GetSettings(frame_number, /*override_zoom=*/true);
+    ASSERT_NE(zoom_settings, nullptr);
+    zoom_override.QueueRequest(frame_number, zoom_settings.get());
+  }
+
+  // Request 4 is 3 frames ahead, too far to apply.
+  EXPECT_EQ(zoom_override.Apply(1, settings.get()), 3u);
+  EXPECT_EQ(GetZoomRatio(*settings), 3.f);
+
+  // The crop region and 3A regions move with the zoom ratio.
+  auto expected = GetSettings(3.f, /*override_zoom=*/true);
+  ASSERT_NE(expected, nullptr);
+  for (auto tag : {ANDROID_SCALER_CROP_REGION, ANDROID_CONTROL_AE_REGIONS,
+                   ANDROID_CONTROL_AWB_REGIONS, ANDROID_CONTROL_AF_REGIONS}) {
+    camera_metadata_ro_entry_t entry, expected_entry;
+    ASSERT_EQ(settings->Get(tag, &entry), OK);
+    ASSERT_EQ(expected->Get(tag, &expected_entry), OK);
+    ASSERT_EQ(entry.count, expected_entry.count);
+    for (size_t i = 0; i < entry.count; i++) {
+      EXPECT_EQ(entry.data.i32[i], expected_entry.data.i32[i]);
+    }
+  }
+}
+
+TEST(EmulatedZoomOverrideTests, StopAtRequestWithoutOverride) {
+  EmulatedZoomOverride zoom_override;
+  const bool override_zoom[] = {false, true, true, false, true};
+  for (uint32_t i = 0; i < std::size(override_zoom); i++) {
+    auto settings = GetSettings(i + 1, override_zoom[i]);
+    ASSERT_NE(settings, nullptr);
+    zoom_override.QueueRequest(i + 1, settings.get());
+  }
+
+  auto settings = GetSettings(1.f, /*override_zoom=*/false);
+  ASSERT_NE(settings, nullptr);
+  EXPECT_EQ(zoom_override.Apply(1, settings.get()), 3u);
+  EXPECT_EQ(GetZoomRatio(*settings), 3.f);
+
+  // Request 3 is followed by a request that doesn't override the zoom.
+  settings = GetSettings(3.f, /*override_zoom=*/true);
+  ASSERT_NE(settings, nullptr);
+  EXPECT_EQ(zoom_override.Apply(3, settings.get()), 0u);
+  EXPECT_EQ(GetZoomRatio(*settings), 3.f);
+
+  settings = GetSettings(4.f, /*override_zoom=*/false);
+  ASSERT_NE(settings, nullptr);
+  EXPECT_EQ(zoom_override.Apply(4, settings.get()), 5u);
+  EXPECT_EQ(GetZoomRatio(*settings), 5.f);
+}
+
+TEST(EmulatedZoomOverrideTests, RepeatingRequestsKeepOverride) {
+  EmulatedZoomOverride zoom_override;
+  auto settings = GetSettings(1.f, /*override_zoom=*/false);
+  ASSERT_NE(settings, nullptr);
+  zoom_override.QueueRequest(1, settings.get());
+  auto zoom_settings = GetSettings(2.f, /*override_zoom=*/true);
+  ASSERT_NE(zoom_settings, nullptr);
+  zoom_override.QueueRequest(2, zoom_settings.get());
+  // Repeating requests have no settings.
+  zoom_override.QueueRequest(3, nullptr);
+  zoom_override.QueueRequest(4, nullptr);
+
+  EXPECT_EQ(zoom_override.Apply(1, settings.get()), 3u);
+  EXPECT_EQ(GetZoomRatio(*settings), 2.f);
+}
+
+TEST(EmulatedZoomOverrideTests, ZoomNeverGoesBack) {
+  EmulatedZoomOverride zoom_override;
+  constexpr uint32_t kNumRequests = 8;
+  std::vector<std::unique_ptr<HalCameraMetadata>> requests;
+  for (uint32_t frame_number = 1; frame_number <= kNumRequests;
+       frame_number++) {
+    requests.push_back(
+        GetSettings(1.f + 0.25f * frame_number, /*override_zoom=*/true));
+    ASSERT_NE(requests.back(), nullptr);
+  }
+
+  // The app queues up to 4 requests ahead of the processed one while
+  // pinching, every processed request moves 2 frames ahead.
+  float last_zoom_ratio = 0.f;
+  uint32_t queued = 0;
+  for (uint32_t frame_number = 1; frame_number <= kNumRequests;
+       frame_number++) {
+    for (; (queued < kNumRequests) && (queued < frame_number + 3); queued++) {
+      zoom_override.QueueRequest(queued + 1, requests[queued].get());
+    }
+    auto settings = HalCameraMetadata::Clone(requests[frame_number - 1].get());
+    ASSERT_NE(settings, nullptr);
+    uint32_t target = zoom_override.Apply(frame_number, settings.get());
+    float zoom_ratio = GetZoomRatio(*settings);
+    if (frame_number < kNumRequests) {
+      uint32_t expected = std::min(frame_number + 2, queued);
+      EXPECT_EQ(target, expected);
+      EXPECT_EQ(zoom_ratio, 1.f + 0.25f * expected);
+    } else {
+      EXPECT_EQ(target, 0u);
+    }
+    EXPECT_GE(zoom_ratio, last_zoom_ratio);
+    last_zoom_ratio = zoom_ratio;
+  }
+}
+
+TEST(EmulatedZoomOverrideTests, KeepPaceWithLongQueue) {
+  EmulatedZoomOverride zoom_override;
+  // A pinch of 30 requests, all queued before the first one is processed.
+  constexpr uint32_t kNumRequests = 30;
+  std::vector<std::unique_ptr<HalCameraMetadata>> requests;
+  for (uint32_t frame_number = 1; frame_number <= kNumRequests;
+       frame_number++) {
+    requests.push_back(
+        GetSettings(1.f + 0.1f * frame_number, /*override_zoom=*/true));
+    ASSERT_NE(requests.back(), nullptr);
+    zoom_override.QueueRequest(frame_number, requests.back().get());
+  }
+
+  // The zoom moves by one step per frame, 2 frames ahead of the requests,
+  // instead of jumping to the end of the pinch.
+  for (uint32_t frame_number = 1; frame_number <= kNumRequests;
+       frame_number++) {
+    auto settings = HalCameraMetadata::Clone(requests[frame_number - 1].get());
+    ASSERT_NE(settings, nullptr);
+    uint32_t target = zoom_override.Apply(frame_number, settings.get());
+    uint32_t expected = std::min(frame_number + 2, kNumRequests);
+    EXPECT_EQ(target, expected == frame_number ? 0u : expected);
+    EXPECT_FLOAT_EQ(GetZoomRatio(*settings), 1.f + 0.1f * expected);
+  }
+}
+
+TEST(EmulatedZoomOverrideTests, DropProcessedRequests) {
+  EmulatedZoomOverride zoom_override;
+  for (uint32_t frame_number = 1; frame_number <= 3; frame_number++) {
+    auto settings = GetSettings(frame_number, /*override_zoom=*/true);
+    ASSERT_NE(settings, nullptr);
+    zoom_override.QueueRequest(frame_number, settings.get());
+  }
+
+  // Request 3 is the last one queued, nothing overrides it.
+  auto settings = GetSettings(3.f, /*override_zoom=*/true);
+  ASSERT_NE(settings, nullptr);
+  EXPECT_EQ(zoom_override.Apply(3, settings.get()), 0u);
+  EXPECT_EQ(GetZoomRatio(*settings), 3.f);
+
+  // Later requests are not overridden by the dropped ones.
+  auto next_settings = GetSettings(4.f, /*override_zoom=*/false);
+  ASSERT_NE(next_settings, nullptr);
+  zoom_override.QueueRequest(4, next_settings.get());
+  EXPECT_EQ(zoom_override.Apply(4, next_settings.get()), 0u);
+  EXPECT_EQ(GetZoomRatio(*next_settings), 4.f);
+  EXPECT_EQ(zoom_override.Apply(5, nullptr), 0u);
+}
+
+}  // namespace android
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "GrallocLayoutCacheTests"
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "GrallocLayoutCache.h"
+
+namespace android {
+
+// Importer mapping NV21 buffers in a heap arena. Like an imported gralloc
+// buffer, each buffer is mapped at the same address by every lock unless
+// move_on_lock_ is set.
+class FakeImporter : public GrallocLayoutCache::Importer {
+ public:
+  static constexpr uint32_t kWidth = 64;
+  static constexpr uint32_t kHeight = 48;
+  static constexpr uint32_t kStride = 80;
+  static constexpr size_t kBufferSize = kStride * kHeight * 3 / 2;
+  static constexpr size_t kNumMappings = 4;
+
+  FakeImporter() : arena_(kBufferSize * kNumMappings) {
+  }
+
+  uint8_t* Lock(buffer_handle_t buffer, uint64_t /*usage*/, int32_t /*width*/,
+                int32_t /*height*/) override {
+    lock_count_++;
+    return Map(buffer);
+  }
+
+  bool LockYCbCr(buffer_handle_t buffer, uint64_t /*usage*/,
+                 int32_t /*width*/, int32_t /*height*/,
+                 YCbCrPlanes* planes /*out*/) override {
+    layout_query_count_++;
+    uint8_t* base = Map(buffer);
+    if (base == nullptr) {
+      return false;
+    }
+    planes->img_y = base;
+    planes->img_cr = base + kStride * kHeight;
+    planes->img_cb = planes->img_cr + 1;
+    planes->y_stride = kStride;
+    planes->cbcr_stride = kStride;
+    planes->cbcr_step = 2;
+    return true;
+  }
+
+  void Unlock(buffer_handle_t buffer) override {
+    EXPECT_EQ(locked_.erase(buffer), 1u) << "Unlocking an unlocked buffer";
+  }
+
+  bool IsLocked(buffer_handle_t buffer) const {
+    return locked_.find(buffer) != locked_.end();
+  }
+
+  // Base address the buffer is currently mapped at.
+  uint8_t* GetMapping(buffer_handle_t buffer) {
+    auto it = locked_.find(buffer);
+    return it == locked_.end() ? nullptr : it->second;
+  }
+
+  uint32_t lock_count_ = 0;
+  uint32_t layout_query_count_ = 0;
+  bool fail_locks_ = false;
+  bool move_on_lock_ = false;
+
+ private:
+  uint8_t* Map(buffer_handle_t buffer) {
+    EXPECT_FALSE(IsLocked(buffer)) << "Locking a locked buffer";
+    if (fail_locks_) {
+      return nullptr;
+    }
+    auto slot = slots_.emplace(buffer, slots_.size() % kNumMappings).first;
+    if (move_on_lock_) {
+      slot->second = (slot->second + 1) % kNumMappings;
+    }
+    uint8_t* base = arena_.data() + slot->second * kBufferSize;
+    locked_[buffer] = base;
+    return base;
+  }
+
+  std::vector<uint8_t> arena_;
+  // Arena slot of each buffer.
+  std::map<buffer_handle_t, size_t> slots_;
+  std::map<buffer_handle_t, uint8_t*> locked_;
+};
+
+static buffer_handle_t GetHandle(uintptr_t id) {
+  return reinterpret_cast<buffer_handle_t>(id);
+}
+
+static void ExpectNV21Planes(const YCbCrPlanes& planes, uint8_t* base) {
+  EXPECT_EQ(planes.img_y, base);
+  EXPECT_EQ(planes.img_cr, base + FakeImporter::kStride * FakeImporter::kHeight);
+  EXPECT_EQ(planes.img_cb, planes.img_cr + 1);
+  EXPECT_EQ(planes.y_stride, FakeImporter::kStride);
+  EXPECT_EQ(planes.cbcr_stride, FakeImporter::kStride);
+  EXPECT_EQ(planes.cbcr_step, 2u);
+}
+
+TEST(GrallocLayoutCacheTests, ReuseLayoutAndUnlockEveryFrame) {
+  auto importer = std::make_shared<FakeImporter>();
+  GrallocLayoutCache cache(importer);
+  const std::vector<buffer_handle_t> buffers = {GetHandle(1), GetHandle(2),
+                                                GetHandle(3)};
+
+  static const uint32_t kNumFrames = 30;
+  for (uint32_t frame = 0; frame < kNumFrames; frame++) {
+    buffer_handle_t buffer = buffers[frame % buffers.size()];
+    YCbCrPlanes planes;
+    ASSERT_TRUE(cache.LockYCbCr(/*stream_id=*/0, buffer, /*usage=*/0,
+                                FakeImporter::kWidth, FakeImporter::kHeight,
+                                &planes));
+    ASSERT_TRUE(importer->IsLocked(buffer));
+    ExpectNV21Planes(planes, importer->GetMapping(buffer));
+    importer->Unlock(buffer);
+  }
+
+  EXPECT_EQ(importer->layout_query_count_, buffers.size());
+  EXPECT_EQ(cache.GetMissCount(), buffers.size());
+  EXPECT_EQ(cache.GetHitCount(), kNumFrames - buffers.size());
+}
+
+TEST(GrallocLayoutCacheTests, QueryAgainAfterRemoveOrResize) {
+  auto importer = std::make_shared<FakeImporter>();
+  GrallocLayoutCache cache(importer);
+  buffer_handle_t buffer = GetHandle(1);
+  YCbCrPlanes planes;
+
+  auto lock = [&](int32_t stream_id, int32_t width, int32_t height) {
+    ASSERT_TRUE(
+        cache.LockYCbCr(stream_id, buffer, /*usage=*/0, width, height, &planes));
+    importer->Unlock(buffer);
+  };
+
+  lock(/*stream_id=*/0, FakeImporter::kWidth, FakeImporter::kHeight);
+  lock(/*stream_id=*/0, FakeImporter::kWidth, FakeImporter::kHeight);
+  EXPECT_EQ(importer->layout_query_count_, 1u);
+
+  cache.Remove(buffer);
+  lock(/*stream_id=*/0, FakeImporter::kWidth, FakeImporter::kHeight);
+  EXPECT_EQ(importer->layout_query_count_, 2u);
+
+  lock(/*stream_id=*/0, FakeImporter::kWidth / 2, FakeImporter::kHeight / 2);
+  EXPECT_EQ(importer->layout_query_count_, 3u);
+
+  // Layouts are kept per stream.
+  lock(/*stream_id=*/1, FakeImporter::kWidth / 2, FakeImporter::kHeight / 2);
+  EXPECT_EQ(importer->layout_query_count_, 4u);
+}
+
+TEST(GrallocLayoutCacheTests, QueryEveryFrameIfBufferMoves) {
+  auto importer = std::make_shared<FakeImporter>();
+  importer->move_on_lock_ = true;
+  GrallocLayoutCache cache(importer);
+  buffer_handle_t buffer = GetHandle(1);
+
+  static const uint32_t kNumFrames = 5;
+  for (uint32_t frame = 0; frame < kNumFrames; frame++) {
+    YCbCrPlanes planes;
+    ASSERT_TRUE(cache.LockYCbCr(/*stream_id=*/0, buffer, /*usage=*/0,
+                                FakeImporter::kWidth, FakeImporter::kHeight,
+                                &planes));
+    ASSERT_TRUE(importer->IsLocked(buffer));
+    ExpectNV21Planes(planes, importer->GetMapping(buffer));
+    importer->Unlock(buffer);
+  }
+
+  EXPECT_EQ(cache.GetHitCount(), 0u);
+  EXPECT_EQ(cache.GetMissCount(), kNumFrames);
+}
+
+TEST(GrallocLayoutCacheTests, LockFailureLeavesBufferUnlocked) {
+  auto importer = std::make_shared<FakeImporter>();
+  GrallocLayoutCache cache(importer);
+  buffer_handle_t buffer = GetHandle(1);
+  YCbCrPlanes planes;
+
+  ASSERT_TRUE(cache.LockYCbCr(/*stream_id=*/0, buffer, /*usage=*/0,
+                              FakeImporter::kWidth, FakeImporter::kHeight,
+                              &planes));
+  importer->Unlock(buffer);
+
+  importer->fail_locks_ = true;
+  EXPECT_FALSE(cache.LockYCbCr(/*stream_id=*/0, buffer, /*usage=*/0,
+                               FakeImporter::kWidth, FakeImporter::kHeight,
+                               &planes));
+  EXPECT_FALSE(importer->IsLocked(buffer));
+
+  // The layout is queried again once locking works.
+  importer->fail_locks_ = false;
+  ASSERT_TRUE(cache.LockYCbCr(/*stream_id=*/0, buffer, /*usage=*/0,
+                              FakeImporter::kWidth, FakeImporter::kHeight,
+                              &planes));
+  EXPECT_EQ(importer->layout_query_count_, 2u);
+  importer->Unlock(buffer);
+}
+
+}  // namespace android
@@ -256,6 +256,17 @@ status_t GetSensorCharacteristics(const HalCameraMetadata* metadata,
            sizeof(sensor_chars->sensitivity_range));
   }
 
+  ret = metadata->Get(ANDROID_SENSOR_INFO_PHYSICAL_SIZE, &entry);
+  if ((ret == OK) && (entry.count == 2)) {
+    sensor_chars->physical_size[0] = entry.data.f[0];
+    sensor_chars->physical_size[1] = entry.data.f[1];
+  }
+
+  ret = metadata->Get(ANDROID_LENS_INFO_AVAILABLE_FOCAL_LENGTHS, &entry);
+  if ((ret == OK) && (entry.count > 0)) {
+    sensor_chars->focal_length = entry.data.f[0];
+  }
+
   if (HasCapability(metadata, ANDROID_REQUEST_AVAILABLE_CAPABILITIES_RAW)) {
     ret = metadata->Get(ANDROID_SENSOR_INFO_COLOR_FILTER_ARRANGEMENT, &entry);
     if ((ret != OK) || (entry.count != 1)) {
@@ -384,6 +395,13 @@ status_t GetSensorCharacteristics(const HalCameraMetadata* metadata,
     return BAD_VALUE;
   }
 
+  ret = metadata->Get(ANDROID_STATISTICS_INFO_MAX_FACE_COUNT, &entry);
+  if ((ret == OK) && (entry.count == 1) && (entry.data.i32[0] > 0)) {
+    sensor_chars->max_face_count = entry.data.i32[0];
+  } else {
+    sensor_chars->max_face_count = 0;
+  }
+
   if (HasCapability(metadata,
                     ANDROID_REQUEST_AVAILABLE_CAPABILITIES_STREAM_USE_CASE)) {
     sensor_chars->support_stream_use_case = true;